@@ -0,0 +1,91 @@
+## Program:   VMTK
+## Language:  Python
+## Date:      $Date$
+## Version:   $Revision$
+
+##   Copyright (c) Luca Antiga, David Steinman. All rights reserved.
+##   See LICENCE file for details.
+
+##      This software is distributed WITHOUT ANY WARRANTY; without even
+##      the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+##      PURPOSE.  See the above copyright notices for more information.
+
+from __future__ import absolute_import #NEEDS TO STAY AS TOP LEVEL MODULE FOR Py2-3 COMPATIBILITY
+import pytest
+import vtk
+from vmtk import vmtklineartoquadratic as lineartoquadratic
+
+
+def sphere_surface(resolution):
+    sphere = vtk.vtkSphereSource()
+    sphere.SetRadius(1.0)
+    sphere.SetThetaResolution(resolution)
+    sphere.SetPhiResolution(resolution)
+    sphere.Update()
+    return sphere.GetOutput()
+
+
+@pytest.fixture(scope='module')
+def tetra_mesh():
+    # tetrahedra of a coarse sphere plus its boundary triangles, tagged with
+    # entity id 1 so that the midside nodes on the boundary get projected
+    delaunay = vtk.vtkDelaunay3D()
+    delaunay.SetInputData(sphere_surface(8))
+    delaunay.Update()
+
+    surfaceFilter = vtk.vtkDataSetSurfaceFilter()
+    surfaceFilter.SetInputConnection(delaunay.GetOutputPort())
+    surfaceFilter.PassThroughPointIdsOn()
+    surfaceFilter.Update()
+    boundary = surfaceFilter.GetOutput()
+    originalPointIds = boundary.GetPointData().GetArray(surfaceFilter.GetOriginalPointIdsName())
+
+    tetras = delaunay.GetOutput()
+    mesh = vtk.vtkUnstructuredGrid()
+    mesh.SetPoints(tetras.GetPoints())
+    mesh.Allocate(tetras.GetNumberOfCells() + boundary.GetNumberOfCells())
+    entityIds = vtk.vtkIntArray()
+    entityIds.SetName('CellEntityIds')
+    for i in range(tetras.GetNumberOfCells()):
+        mesh.InsertNextCell(tetras.GetCellType(i), tetras.GetCell(i).GetPointIds())
+        entityIds.InsertNextValue(0)
+    for i in range(boundary.GetNumberOfCells()):
+        cellPointIds = boundary.GetCell(i).GetPointIds()
+        pointIds = vtk.vtkIdList()
+        for j in range(cellPointIds.GetNumberOfIds()):
+            pointIds.InsertNextId(int(originalPointIds.GetTuple1(cellPointIds.GetId(j))))
+        mesh.InsertNextCell(vtk.VTK_TRIANGLE, pointIds)
+        entityIds.InsertNextValue(1)
+    mesh.GetCellData().AddArray(entityIds)
+    return mesh
+
+
+def convert(mesh, useFlatEdgeTable):
+    converter = lineartoquadratic.vmtkLinearToQuadratic()
+    converter.Mesh = mesh
+    converter.Surface = sphere_surface(64)
+    converter.CellEntityIdsArrayName = 'CellEntityIds'
+    converter.ProjectedCellEntityId = 1
+    converter.JacobianRelaxation = 1
+    converter.UseFlatEdgeTable = useFlatEdgeTable
+    converter.Execute()
+    return converter.Mesh
+
+
+def test_flat_edge_table_matches_default(tetra_mesh):
+    default = convert(tetra_mesh, False)
+    flat = convert(tetra_mesh, True)
+
+    assert flat.GetNumberOfPoints() == default.GetNumberOfPoints()
+    assert flat.GetNumberOfCells() == default.GetNumberOfCells()
+
+    for i in range(default.GetNumberOfPoints()):
+        assert flat.GetPoint(i) == pytest.approx(default.GetPoint(i), abs=1E-9)
+
+    for i in range(default.GetNumberOfCells()):
+        assert flat.GetCellType(i) == default.GetCellType(i)
+        defaultIds = default.GetCell(i).GetPointIds()
+        flatIds = flat.GetCell(i).GetPointIds()
+        assert flatIds.GetNumberOfIds() == defaultIds.GetNumberOfIds()
+        for j in range(defaultIds.GetNumberOfIds()):
+            assert flatIds.GetId(j) == defaultIds.GetId(j)
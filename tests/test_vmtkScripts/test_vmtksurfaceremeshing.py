@@ -0,0 +1,80 @@
+## Program:   VMTK
+## Language:  Python
+## Date:      $Date$
+## Version:   $Revision$
+
+##   Copyright (c) Luca Antiga, David Steinman. All rights reserved.
+##   See LICENCE file for details.
+
+##      This software is distributed WITHOUT ANY WARRANTY; without even
+##      the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+##      PURPOSE.  See the above copyright notices for more information.
+
+from __future__ import absolute_import #NEEDS TO STAY AS TOP LEVEL MODULE FOR Py2-3 COMPATIBILITY
+import pytest
+import vtk
+from vmtk import vmtksurfaceremeshing as surfaceremeshing
+
+
+@pytest.fixture(scope='module')
+def open_surface():
+    # hemisphere, open at z = 0
+    sphere = vtk.vtkSphereSource()
+    sphere.SetRadius(1.0)
+    sphere.SetThetaResolution(48)
+    sphere.SetPhiResolution(48)
+
+    plane = vtk.vtkPlane()
+    plane.SetOrigin(0.0, 0.0, 0.0)
+    plane.SetNormal(0.0, 0.0, 1.0)
+
+    clipper = vtk.vtkClipPolyData()
+    clipper.SetInputConnection(sphere.GetOutputPort())
+    clipper.SetClipFunction(plane)
+    clipper.Update()
+    return clipper.GetOutput()
+
+
+def remesh(surface, parallel):
+    remeshing = surfaceremeshing.vmtkSurfaceRemeshing()
+    remeshing.Surface = surface
+    remeshing.ElementSizeMode = 'edgelength'
+    remeshing.TargetEdgeLength = 0.1
+    remeshing.Parallel = parallel
+    remeshing.Execute()
+    return remeshing.Surface
+
+
+def surface_area(surface):
+    massProperties = vtk.vtkMassProperties()
+    massProperties.SetInputData(surface)
+    massProperties.Update()
+    return massProperties.GetSurfaceArea()
+
+
+def mean_boundary_height(surface):
+    edges = vtk.vtkFeatureEdges()
+    edges.SetInputData(surface)
+    edges.BoundaryEdgesOn()
+    edges.FeatureEdgesOff()
+    edges.NonManifoldEdgesOff()
+    edges.ManifoldEdgesOff()
+    edges.Update()
+    boundary = edges.GetOutput()
+    assert boundary.GetNumberOfPoints() > 0
+    height = 0.0
+    for i in range(boundary.GetNumberOfPoints()):
+        height += boundary.GetPoint(i)[2]
+    return height / boundary.GetNumberOfPoints()
+
+
+def test_parallel_relocation_matches_serial_on_open_surface(open_surface):
+    # parallel passes batch edge operations and relocate points from the
+    # positions of the previous pass, so meshes are not identical; boundary
+    # points however must be relocated by the same rule in both modes
+    serial = remesh(open_surface, 0)
+    parallel = remesh(open_surface, 1)
+
+    assert parallel.GetNumberOfCells() == pytest.approx(serial.GetNumberOfCells(), rel=0.05)
+    assert surface_area(parallel) == pytest.approx(surface_area(serial), rel=0.02)
+    assert mean_boundary_height(parallel) == pytest.approx(mean_boundary_height(serial), abs=0.025)
@@ -75,10 +75,22 @@ class vmtkBranchMetrics(pypes.pypeScript):
         if self.Centerlines == None:
             self.PrintError('Error: No input centerlines.')
 
+        surface = self.Surface
+
+        closestPointMap = vtkvmtk.vtkvmtkPolyDataCenterlineClosestPointMap()
+        closestPointMap.SetSurface(surface)
+        closestPointMap.SetCenterlines(self.Centerlines)
+        closestPointMap.UseRadiusInformationOff()
+        closestPointMap.SetGroupIdsArrayName(self.GroupIdsArrayName)
+        closestPointMap.SetCenterlineGroupIdsArrayName(self.GroupIdsArrayName)
+        closestPointMap.SetBlankingArrayName(self.BlankingArrayName)
+        closestPointMap.SetCenterlineIdsArrayName(self.CenterlineIdsArrayName)
+        closestPointMap.SetCenterlineTractIdsArrayName(self.TractIdsArrayName)
+
         if self.ComputeAngularMetric == 1:
             self.PrintLog('Computing angular metric')
             angularMetricFilter = vtkvmtk.vtkvmtkPolyDataCenterlineAngularMetricFilter()
-            angularMetricFilter.SetInputData(self.Surface)
+            angularMetricFilter.SetInputData(surface)
             angularMetricFilter.SetMetricArrayName(self.AngularMetricArrayName)
             angularMetricFilter.SetGroupIdsArrayName(self.GroupIdsArrayName)
             angularMetricFilter.SetCenterlines(self.Centerlines)
@@ -90,13 +102,14 @@ class vmtkBranchMetrics(pypes.pypeScript):
             angularMetricFilter.IncludeBifurcationsOff()
             angularMetricFilter.SetBlankingArrayName(self.BlankingArrayName)
             angularMetricFilter.SetCenterlineIdsArrayName(self.CenterlineIdsArrayName)
+            angularMetricFilter.SetClosestPointMap(closestPointMap)
             angularMetricFilter.Update()
             self.Surface = angularMetricFilter.GetOutput()
 
         if self.ComputeAbscissaMetric == 1:
             self.PrintLog('Computing abscissa metric')
             abscissaMetricFilter = vtkvmtk.vtkvmtkPolyDataCenterlineAbscissaMetricFilter()
-            abscissaMetricFilter.SetInputData(self.Surface)
+            abscissaMetricFilter.SetInputData(surface)
             abscissaMetricFilter.SetMetricArrayName(self.AbscissaMetricArrayName)
             abscissaMetricFilter.SetGroupIdsArrayName(self.GroupIdsArrayName)
             abscissaMetricFilter.SetCenterlines(self.Centerlines)
@@ -108,8 +121,12 @@ class vmtkBranchMetrics(pypes.pypeScript):
             abscissaMetricFilter.IncludeBifurcationsOn()
             abscissaMetricFilter.SetBlankingArrayName(self.BlankingArrayName)
             abscissaMetricFilter.SetCenterlineIdsArrayName(self.CenterlineIdsArrayName)
+            abscissaMetricFilter.SetClosestPointMap(closestPointMap)
             abscissaMetricFilter.Update()
-            self.Surface = abscissaMetricFilter.GetOutput()
+            abscissaSurface = abscissaMetricFilter.GetOutput()
+            if self.ComputeAngularMetric == 1:
+                abscissaSurface.GetPointData().AddArray(self.Surface.GetPointData().GetArray(self.AngularMetricArrayName))
+            self.Surface = abscissaSurface
 
 
 if __name__=='__main__':
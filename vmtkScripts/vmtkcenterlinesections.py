@@ -37,6 +37,8 @@ class vmtkCenterlineSections(pypes.pypeScript):
         self.CenterlineSectionShapeArrayName = 'CenterlineSectionShape'
         self.CenterlineSectionClosedArrayName = 'CenterlineSectionClosed'
 
+        self.UseSectionLocator = 0
+
         self.SetScriptName('vmtkcenterlinesections')
         self.SetScriptDoc('compute geometric properties of sections located along centerlines. The script takes in input the surface and the relative centerlines.')
         self.SetInputMembers([
@@ -46,7 +48,8 @@ class vmtkCenterlineSections(pypes.pypeScript):
             ['CenterlineSectionMinSizeArrayName','branchsectionminsize','str',1,'','name of the array where the minimum diameter of each section has to be stored'],
             ['CenterlineSectionMaxSizeArrayName','branchsectionmaxsize','str',1,'','name of the array where the maximum diameter of each bifurcation sections has to be stored'],
             ['CenterlineSectionShapeArrayName','centerlinesectionshape','str',1,'','name of the array where the shape index, i.e. the ratio between minimum and maximum diameter, of each bifurcation section has to be stored'],
-            ['CenterlineSectionClosedArrayName','branchsectionclosed','str',1,'','name of the array containing 1 if a section is closed and 0 otherwise']
+            ['CenterlineSectionClosedArrayName','branchsectionclosed','str',1,'','name of the array containing 1 if a section is closed and 0 otherwise'],
+            ['UseSectionLocator','sectionlocator','bool',1,'','only cut the surface triangles close to each centerline point, extracting sections in parallel (requires a triangulated surface)']
             ])
         self.SetOutputMembers([
             ['CenterlineSections','o','vtkPolyData',1,'','the output sections','vmtksurfacewriter'],
@@ -74,6 +77,7 @@ class vmtkCenterlineSections(pypes.pypeScript):
         centerlineSections.SetCenterlineSectionMaxSizeArrayName(self.CenterlineSectionMaxSizeArrayName)
         centerlineSections.SetCenterlineSectionShapeArrayName(self.CenterlineSectionShapeArrayName)
         centerlineSections.SetCenterlineSectionClosedArrayName(self.CenterlineSectionClosedArrayName)
+        centerlineSections.SetUseSectionLocator(self.UseSectionLocator)
         centerlineSections.Update()
 
         self.CenterlineSections = centerlineSections.GetOutput()
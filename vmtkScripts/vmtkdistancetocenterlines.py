@@ -36,6 +36,10 @@ class vmtkDistanceToCenterlines(pypes.pypeScript):
         self.ProjectPointArrays = 0
         self.DistanceToCenterlinesArrayName = 'DistanceToCenterlines'
         self.RadiusArrayName = ''
+        self.EvaluateCenterlineAbscissas = 0
+        self.AbscissasArrayName = 'Abscissas'
+        self.ClosestCenterlineIdsArrayName = None
+        self.ProjectedPointsArrayName = None
         
         self.SetScriptName('vmtkdistancetocenterlines')
         self.SetInputMembers([
@@ -47,7 +51,11 @@ class vmtkDistanceToCenterlines(pypes.pypeScript):
             ['UseCombinedDistance','combined','bool',1,'','combines local radius with maximum inscribed sphere radius'],
             ['ProjectPointArrays','projectarrays','bool',1],
             ['DistanceToCenterlinesArrayName','distancetocenterlinesarray','str',1],
-            ['RadiusArrayName','radiusarray','str',1]
+            ['RadiusArrayName','radiusarray','str',1],
+            ['EvaluateCenterlineAbscissas','centerlineabscissas','bool',1,'','also output centerline abscissas interpolated at the closest centerline point'],
+            ['AbscissasArrayName','abscissasarray','str',1],
+            ['ClosestCenterlineIdsArrayName','closestcenterlineidsarray','str',1,'','if set, also output the id of the closest centerline cell with this name'],
+            ['ProjectedPointsArrayName','projectedpointsarray','str',1,'','if set, also output the closest centerline point with this name']
             ])
         self.SetOutputMembers([
             ['Surface','o','vtkPolyData',1,'','','vmtksurfacewriter']
@@ -72,6 +80,10 @@ class vmtkDistanceToCenterlines(pypes.pypeScript):
             distanceToCenterlinesFilter.SetProjectPointArrays(self.ProjectPointArrays)
             distanceToCenterlinesFilter.SetDistanceToCenterlinesArrayName(self.DistanceToCenterlinesArrayName)
             distanceToCenterlinesFilter.SetCenterlineRadiusArrayName(self.RadiusArrayName)
+            distanceToCenterlinesFilter.SetEvaluateCenterlineAbscissas(self.EvaluateCenterlineAbscissas)
+            distanceToCenterlinesFilter.SetCenterlineAbscissasArrayName(self.AbscissasArrayName)
+            distanceToCenterlinesFilter.SetClosestCenterlineIdsArrayName(self.ClosestCenterlineIdsArrayName)
+            distanceToCenterlinesFilter.SetProjectedPointsArrayName(self.ProjectedPointsArrayName)
             distanceToCenterlinesFilter.Update()    
             
             surface = distanceToCenterlinesFilter.GetOutput()
@@ -98,6 +110,10 @@ class vmtkDistanceToCenterlines(pypes.pypeScript):
             distanceToCenterlinesFilter.SetProjectPointArrays(self.ProjectPointArrays)
             distanceToCenterlinesFilter.SetDistanceToCenterlinesArrayName(self.DistanceToCenterlinesArrayName)
             distanceToCenterlinesFilter.SetCenterlineRadiusArrayName(self.RadiusArrayName)
+            distanceToCenterlinesFilter.SetEvaluateCenterlineAbscissas(self.EvaluateCenterlineAbscissas)
+            distanceToCenterlinesFilter.SetCenterlineAbscissasArrayName(self.AbscissasArrayName)
+            distanceToCenterlinesFilter.SetClosestCenterlineIdsArrayName(self.ClosestCenterlineIdsArrayName)
+            distanceToCenterlinesFilter.SetProjectedPointsArrayName(self.ProjectedPointsArrayName)
             distanceToCenterlinesFilter.Update()
     
             self.Surface = distanceToCenterlinesFilter.GetOutput()
@@ -40,6 +40,7 @@ class vmtkImageCurvedMPR(pypes.pypeScript):
         self.InplaneOutputSize = 100
         self.InplaneOutputSpacing = 1.0
         self.ReslicingBackgroundLevel = 0.0
+        self.Interpolation = 'cubic'
 
         self.SetScriptName('vtkvmtkimagecurvedmpr')
         self.SetScriptDoc('Make an MPR image from a centerline and an input image')
@@ -51,7 +52,8 @@ class vmtkImageCurvedMPR(pypes.pypeScript):
             ['InplaneOutputSize','size','int',1,'(1,)','size of the square in pixels that each resulting MPR image should have'],
             ['ReslicingBackgroundLevel','background','float',1,'','value of the pixels in the mpr image that are outside of the inputimage'],
             ['InplaneOutputSpacing','spacing','float',1,'(0.001,)','spacing between the pixels in the output MPR images'],
-            ['FrenetTangentArrayName','frenettangentarray','str',1,'','name of the array where tangent vectors of the Frenet reference system are stored']
+            ['FrenetTangentArrayName','frenettangentarray','str',1,'','name of the array where tangent vectors of the Frenet reference system are stored'],
+            ['Interpolation','interpolation','str',1,'["linear","cubic"]','interpolation used to sample the input image']
             ])
         self.SetOutputMembers([
             ['Image','o','vtkImageData',1,'','the output image','vmtkimagewriter']])
@@ -72,6 +74,10 @@ class vmtkImageCurvedMPR(pypes.pypeScript):
         curvedMPRImageFilter.SetInplaneOutputSpacing(self.InplaneOutputSpacing, self.InplaneOutputSpacing)
         curvedMPRImageFilter.SetInplaneOutputSize(self.InplaneOutputSize, self.InplaneOutputSize)
         curvedMPRImageFilter.SetReslicingBackgroundLevel(self.ReslicingBackgroundLevel)
+        if self.Interpolation == 'linear':
+            curvedMPRImageFilter.SetInterpolationModeToLinear()
+        else:
+            curvedMPRImageFilter.SetInterpolationModeToCubic()
         curvedMPRImageFilter.Update()
 
         self.Image = curvedMPRImageFilter.GetOutput()
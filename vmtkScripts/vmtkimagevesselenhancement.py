@@ -51,6 +51,7 @@ class vmtkImageVesselEnhancement(pypes.pypeScript):
         self.Sensitivity = 5.0
         self.NumberOfIterations = 0
         self.NumberOfDiffusionSubIterations = 0
+        self.ConvergenceThreshold = 0.0
 
         self.SetScriptName('vmtkimagevesselenhancement')
         self.SetScriptDoc('compute a feature image for use in segmentation')
@@ -73,7 +74,8 @@ class vmtkImageVesselEnhancement(pypes.pypeScript):
             ['WStrength','wstrength','float',1,'(0.0,)','(ved, vedm)'],
             ['Sensitivity','sensitivity','float',1,'(0.0,)','(ved, vedm)'],
             ['NumberOfIterations','iterations','int',1,'(0,)','(ved, vedm)'],
-            ['NumberOfDiffusionSubIterations','subiterations','int',1,'(1,)','(ved, vedm)']
+            ['NumberOfDiffusionSubIterations','subiterations','int',1,'(1,)','(ved, vedm)'],
+            ['ConvergenceThreshold','convergence','float',1,'(0.0,)','root mean square change of the image below which iterations stop; 0 disables (vedm)']
             ])
         self.SetOutputMembers([
             ['Image','o','vtkImageData',1,'','the output image','vmtkimagewriter']
@@ -159,6 +161,7 @@ class vmtkImageVesselEnhancement(pypes.pypeScript):
         vesselness.SetSensitivity(self.Sensitivity)
         vesselness.SetNumberOfIterations(self.NumberOfIterations)
         vesselness.SetRecalculateVesselness(self.NumberOfDiffusionSubIterations)
+        vesselness.SetConvergenceThreshold(self.ConvergenceThreshold)
         if self.SigmaStepMethod == 'equispaced':
             vesselness.SetSigmaStepMethodToEquispaced()
         elif self.SigmaStepMethod == 'logarithmic':
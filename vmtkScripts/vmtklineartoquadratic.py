@@ -39,6 +39,7 @@ class vmtkLinearToQuadratic(pypes.pypeScript):
         self.JacobianRelaxation = 0
         self.NegativeJacobianTolerance = 0.0
         self.QuadratureOrder = 10
+        self.UseFlatEdgeTable = False
 
         self.SetScriptName('vmtklineartoquadratic')
         self.SetScriptDoc('convert the elements of a mesh from linear to quadratic')
@@ -53,6 +54,7 @@ class vmtkLinearToQuadratic(pypes.pypeScript):
             ['ProjectedCellEntityId','projectedid','int',1,'','id of the entity that is to be projected onto the reference surface'],
             ['QuadratureOrder','quadratureorder','int',1,'','quadrature order for checking negative Jacobians'],
             ['NegativeJacobianTolerance','jacobiantolerance','float',1,'','tolerance for the evaluation of negative Jacobians'],
+            ['UseFlatEdgeTable','flatedgetable','bool',1,'','if on, convert meshes made of tetrahedra and triangles with a parallel flat edge table (faster on large meshes, same output numbering)'],
             ['SubdivisionMethod','subdivisionmethod','str',1,'["linear","butterfly"]','subdivision method for surface elements'],
             ['NumberOfNodesHexahedra','hexahedranodes','int',1,'','Output hexahedral element type by # of nodes: 20 or 27 (see vtkQuadraticHexahedron and vtkTriQuadraticHexahedron classes in VTK documentation)']
             ])
@@ -83,6 +85,7 @@ class vmtkLinearToQuadratic(pypes.pypeScript):
             linearToQuadraticFilter.SetQuadratureOrder(self.QuadratureOrder)
             linearToQuadraticFilter.SetNegativeJacobianTolerance(self.NegativeJacobianTolerance)
             linearToQuadraticFilter.SetNumberOfNodesHexahedra(self.NumberOfNodesHexahedra)
+            linearToQuadraticFilter.SetUseFlatEdgeTable(self.UseFlatEdgeTable)
         elif self.Mode == 'surface':
             linearToQuadraticFilter = vtkvmtk.vtkvmtkLinearToQuadraticSurfaceMeshFilter()
             if self.SubdivisionMethod == 'linear':
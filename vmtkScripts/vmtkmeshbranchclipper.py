@@ -45,6 +45,7 @@ class vmtkMeshBranchClipper(pypes.pypeScript):
         self.InsideOut = 0
 
         self.UseRadiusInformation = 1
+        self.UseNearestTubes = 0
 
         self.vmtkRenderer = None
         self.OwnRenderer = 0
@@ -59,6 +60,7 @@ class vmtkMeshBranchClipper(pypes.pypeScript):
             ['GroupIds','groupids','int',-1],
             ['InsideOut','insideout','bool',1],
             ['UseRadiusInformation','useradius','bool',1],
+            ['UseNearestTubes','nearesttubes','bool',1,'','find the two nearest group tubes of each point once and derive all clipping arrays from them'],
             ['RadiusArrayName','radiusarray','str',1],
             ['BlankingArrayName','blankingarray','str',1],
             ['CutoffRadiusFactor','cutoffradiusfactor','float',1,'(0.0,)'],
@@ -123,6 +125,7 @@ class vmtkMeshBranchClipper(pypes.pypeScript):
         clipper.SetCutoffRadiusFactor(self.CutoffRadiusFactor)
         clipper.SetClipValue(self.ClipValue)
         clipper.SetUseRadiusInformation(self.UseRadiusInformation)
+        clipper.SetUseNearestTubes(self.UseNearestTubes)
         if self.GroupIds:
             groupIds = vtk.vtkIdList()
             for groupId in self.GroupIds:
@@ -0,0 +1,119 @@
+#!/usr/bin/env python
+
+## Program:   VMTK
+## Module:    $RCSfile: vmtkmeshvelocityderivatives.py,v $
+## Language:  Python
+## Date:      $Date: 2005/09/14 09:49:59 $
+## Version:   $Revision: 1.6 $
+
+##   Copyright (c) Luca Antiga, David Steinman. All rights reserved.
+##   See LICENCE file for details.
+
+##      This software is distributed WITHOUT ANY WARRANTY; without even
+##      the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+##      PURPOSE.  See the above copyright notices for more information.
+
+from __future__ import absolute_import #NEEDS TO STAY AS TOP LEVEL MODULE FOR Py2-3 COMPATIBILITY
+from vmtk import vtkvmtk
+import vtk
+import sys
+
+from vmtk import pypes
+
+
+class vmtkMeshVelocityDerivatives(pypes.pypeScript):
+
+    def __init__(self):
+
+        pypes.pypeScript.__init__(self)
+
+        self.Mesh = None
+        self.Surface = None
+
+        self.VelocityArrayName = None
+        self.VelocityGradientArrayName = None
+        self.Lambda2ArrayName = 'Lambda2'
+        self.VorticityArrayName = 'Vorticity'
+        self.QCriterionArrayName = 'QCriterion'
+        self.HelicityArrayName = 'Helicity'
+        self.WallShearRateArrayName = 'WallShearRate'
+
+        self.ComputeLambda2 = 1
+        self.ComputeVorticity = 1
+        self.ComputeQCriterion = 1
+        self.ComputeHelicity = 1
+        self.ComputeWallShearRate = 0
+
+        self.ConvergenceTolerance = 1E-6
+        self.QuadratureOrder = 3
+        self.ReuseMassMatrix = 0
+
+        self.DerivativesFilter = None
+
+        self.SetScriptName('vmtkmeshvelocityderivatives')
+        self.SetScriptDoc('compute the velocity gradient once and derive lambda2, vorticity, Q-criterion, helicity and wall shear rate from it')
+        self.SetInputMembers([
+            ['Mesh','i','vtkUnstructuredGrid',1,'','the input mesh','vmtkmeshreader'],
+            ['VelocityArrayName','velocityarray','str',1,'',''],
+            ['VelocityGradientArrayName','gradientarray','str',1,'','if set, also store the velocity gradient with this name'],
+            ['ComputeLambda2','lambda2','bool',1,'',''],
+            ['ComputeVorticity','vorticity','bool',1,'',''],
+            ['ComputeQCriterion','qcriterion','bool',1,'',''],
+            ['ComputeHelicity','helicity','bool',1,'',''],
+            ['ComputeWallShearRate','wsr','bool',1,'','also compute wall shear rate, producing a surface in output'],
+            ['Lambda2ArrayName','lambda2array','str',1,'',''],
+            ['VorticityArrayName','vorticityarray','str',1,'',''],
+            ['QCriterionArrayName','qcriterionarray','str',1,'',''],
+            ['HelicityArrayName','helicityarray','str',1,'',''],
+            ['WallShearRateArrayName','wsrarray','str',1,'',''],
+            ['ConvergenceTolerance','tolerance','float',1,'',''],
+            ['QuadratureOrder','quadratureorder','int',1,'',''],
+            ['ReuseMassMatrix','reusemassmatrix','bool',1,'','reuse the assembled operators for meshes with the same number of points and cells, e.g. the time steps of a simulation processed by repeated executions']
+            ])
+        self.SetOutputMembers([
+            ['Mesh','o','vtkUnstructuredGrid',1,'','the output mesh','vmtkmeshwriter'],
+            ['Surface','osurface','vtkPolyData',1,'','the output surface','vmtksurfacewriter']
+            ])
+
+    def Execute(self):
+
+        if (self.Mesh == None):
+            self.PrintError('Error: no Mesh.')
+
+        # the filter is kept across executions so that its assembled
+        # operators can be reused
+        if not self.ReuseMassMatrix or self.DerivativesFilter == None:
+            self.DerivativesFilter = vtkvmtk.vtkvmtkMeshVelocityDerivatives()
+        derivativesFilter = self.DerivativesFilter
+        derivativesFilter.SetInputData(self.Mesh)
+        derivativesFilter.SetVelocityArrayName(self.VelocityArrayName)
+        derivativesFilter.SetVelocityGradientArrayName(self.VelocityGradientArrayName)
+        derivativesFilter.SetLambda2ArrayName(self.Lambda2ArrayName)
+        derivativesFilter.SetVorticityArrayName(self.VorticityArrayName)
+        derivativesFilter.SetQCriterionArrayName(self.QCriterionArrayName)
+        derivativesFilter.SetHelicityArrayName(self.HelicityArrayName)
+        derivativesFilter.SetWallShearRateArrayName(self.WallShearRateArrayName)
+        derivativesFilter.SetComputeLambda2(self.ComputeLambda2)
+        derivativesFilter.SetComputeVorticity(self.ComputeVorticity)
+        derivativesFilter.SetComputeQCriterion(self.ComputeQCriterion)
+        derivativesFilter.SetComputeHelicity(self.ComputeHelicity)
+        derivativesFilter.SetComputeWallShearRate(self.ComputeWallShearRate)
+        derivativesFilter.SetConvergenceTolerance(self.ConvergenceTolerance)
+        derivativesFilter.SetQuadratureOrder(self.QuadratureOrder)
+        derivativesFilter.SetReuseMassMatrix(self.ReuseMassMatrix)
+        derivativesFilter.Update()
+
+        # outputs are copied, as a reused filter overwrites them on the next execution
+        self.Mesh = vtk.vtkUnstructuredGrid()
+        self.Mesh.ShallowCopy(derivativesFilter.GetOutput())
+
+        if self.ComputeWallShearRate:
+            self.Surface = vtk.vtkPolyData()
+            self.Surface.ShallowCopy(derivativesFilter.GetSurfaceOutput())
+
+
+
+if __name__=='__main__':
+    main = pypes.pypeMain()
+    main.Arguments = sys.argv
+    main.Execute()
@@ -0,0 +1,111 @@
+#!/usr/bin/env python
+
+## Program:   VMTK
+## Module:    $RCSfile: vmtkmeshvelocitystatistics.py,v $
+## Language:  Python
+## Date:      $Date: 2013/07/15 12:59:27 $
+## Version:   $Revision: 1.6 $
+
+##   Copyright (c) Luca Antiga, David Steinman. All rights reserved.
+##   See LICENCE file for details.
+
+##      This software is distributed WITHOUT ANY WARRANTY; without even
+##      the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+##      PURPOSE.  See the above copyright notices for more information.
+
+from __future__ import absolute_import #NEEDS TO STAY AS TOP LEVEL MODULE FOR Py2-3 COMPATIBILITY
+import vtk
+import sys
+import os
+
+from vmtk import vtkvmtk
+from vmtk import vmtkmeshreader
+from vmtk import pypes
+
+
+class vmtkMeshVelocityStatistics(pypes.pypeScript):
+
+    def __init__(self):
+
+        pypes.pypeScript.__init__(self)
+
+        self.Mesh = None
+        self.InputDirectoryName = None
+        self.Pattern = None
+        self.FirstTimeStep = None
+        self.LastTimeStep = None
+        self.IntervalTimeStep = 1
+        self.VelocityArrayName = 'velocity'
+        self.ComputeMinMax = 0
+        self.ComputeOscillatoryIndex = 0
+        self.SetScriptName('vmtkmeshvelocitystatistics')
+        self.SetScriptDoc('compute velocity statistics over a series of mesh files, reading one timestep at a time')
+
+        self.SetInputMembers([
+            ['InputDirectoryName','directory','str',1,''],
+            ['Pattern','pattern','str',1,''],
+            ['FirstTimeStep','firststep','int',1,'(0,)'],
+            ['LastTimeStep','laststep','int',1,'(0,)'],
+            ['IntervalTimeStep','intervalstep','int',1,'(0,)'],
+            ['VelocityArrayName','velocityarray','str',1,'','name of the velocity vector array'],
+            ['ComputeMinMax','minmax','bool',1,'','also compute component-wise minimum and maximum velocity'],
+            ['ComputeOscillatoryIndex','oscillatoryindex','bool',1,'','also compute time-averaged velocity magnitude and oscillatory index']
+            ])
+        self.SetOutputMembers([
+            ['Mesh','o','vtkUnstructuredGrid',1,'','the output mesh','vmtkmeshwriter']
+            ])
+
+    def Execute(self):
+
+        if (self.InputDirectoryName == None):
+            self.PrintError('Error: no directory.')
+
+        if (self.Pattern == None):
+            self.PrintError('Error: no pattern.')
+
+        if (self.FirstTimeStep == None):
+            self.PrintError('Error: no first timestep.')
+
+        if (self.LastTimeStep == None):
+            self.PrintError('Error: no last timestep.')
+
+        fileList = [x for x in os.listdir(self.InputDirectoryName) if not (x.startswith('.'))]
+
+        timeIndexList = list(range(self.FirstTimeStep,self.LastTimeStep+1,self.IntervalTimeStep))
+        reader = vmtkmeshreader.vmtkMeshReader()
+
+        statistics = vtkvmtk.vtkvmtkMeshVelocityStatistics()
+        statistics.SetComputeMinMax(self.ComputeMinMax)
+        statistics.SetComputeOscillatoryIndex(self.ComputeOscillatoryIndex)
+        statistics.ResetStatistics()
+
+        for step in timeIndexList:
+            fileName = (self.Pattern%step).replace(' ','0')
+            if fileName not in fileList:
+                continue
+
+            reader.InputFileName = os.path.abspath(os.path.join(self.InputDirectoryName,fileName))
+            reader.Execute()
+            mesh = reader.Mesh
+
+            velocityArray = mesh.GetPointData().GetArray(self.VelocityArrayName)
+            if velocityArray == None:
+                self.PrintError('Error: no array named ' + self.VelocityArrayName + ' in ' + fileName + '.')
+
+            if not statistics.AccumulateVelocity(velocityArray):
+                self.PrintError('Error: cannot accumulate velocity from ' + fileName + '.')
+
+            if self.Mesh == None:
+                self.Mesh = vtk.vtkUnstructuredGrid()
+                self.Mesh.CopyStructure(mesh)
+
+        if self.Mesh == None:
+            self.PrintError('Error: no timestep found.')
+
+        statistics.AddStatisticsArrays(self.Mesh.GetPointData())
+        statistics.ResetStatistics()
+
+if __name__=='__main__':
+    main = pypes.pypeMain()
+    main.Arguments = sys.argv
+    main.Execute()
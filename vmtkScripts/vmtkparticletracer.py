@@ -54,6 +54,7 @@ class vmtkParticleTracer(pypes.pypeScript):
         self.Component0Prefix = "u_"
         self.Component1Prefix = "v_"
         self.Component2Prefix = "w_"
+        self.Parallel = 1
         self.SetScriptName('vmtkparticletracer')
         self.SetScriptDoc('Generate streamlines')
         
@@ -76,6 +77,7 @@ class vmtkParticleTracer(pypes.pypeScript):
             ['Component0Prefix','component0prefix','str',1,''],
             ['Component1Prefix','component1prefix','str',1,''],
             ['Component2Prefix','component2prefix','str',1,''],
+            ['Parallel','parallel','bool',1,'','integrate particles on multiple threads'],
             ['FirstTimeStep','firststep','int',1,'(0.0,)','first timestep'],
             ['LastTimeStep','laststep','int',1,'(0.0,)','last timestep'],
             ['IntervalTimeStep','interval','int',1,'(0.0,)','interval time step'],
@@ -179,6 +181,7 @@ class vmtkParticleTracer(pypes.pypeScript):
         tracer.SetComponent2Prefix(self.Component2Prefix)
         if self.Periodic:
             tracer.PeriodicOn()
+        tracer.SetParallelIntegration(self.Parallel)
         tracer.Update()
 
         self.Traces = tracer.GetOutput()
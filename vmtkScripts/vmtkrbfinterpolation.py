@@ -29,6 +29,7 @@ class vmtkRBFInterpolation(pypes.pypeScript):
         
         self.Seeds = None
         self.RBFType = 'biharmonic'
+        self.SupportRadius = 0.0
 
         self.Image = None
 
@@ -42,7 +43,8 @@ class vmtkRBFInterpolation(pypes.pypeScript):
             ['Image','r','vtkImageData',1,'','the reference image','vmtkimagereader'],
             ['Dimensions','dimensions','int',3,''],
             ['Bounds','bounds','float',6,''],
-            ['RBFType','rbftype','str',1,'["thinplatespline","biharmonic","triharmonic"]','the type of RBF interpolation']
+            ['RBFType','rbftype','str',1,'["thinplatespline","biharmonic","triharmonic","wendland"]','the type of RBF interpolation; wendland is compactly supported and scales to large numbers of seeds'],
+            ['SupportRadius','supportradius','float',1,'(0.0,)','support radius of the wendland kernel (0 for a tenth of the seed bounds diagonal)']
 
             ])
         self.SetOutputMembers([
@@ -62,6 +64,9 @@ class vmtkRBFInterpolation(pypes.pypeScript):
             rbf.SetRBFTypeToBiharmonic()
         elif self.RBFType == "triharmonic":
             rbf.SetRBFTypeToTriharmonic()
+        elif self.RBFType == "wendland":
+            rbf.SetRBFTypeToWendland()
+            rbf.SetSupportRadius(self.SupportRadius)
         rbf.ComputeCoefficients()
 
         if self.Image:
@@ -82,6 +82,8 @@ __all__ = [
     'vmtk.vmtkmeshtransform',
     'vmtk.vmtkmeshtransformtoras',
     'vmtk.vmtkmeshvectorfromcomponents',
+    'vmtk.vmtkmeshvelocityderivatives',
+    'vmtk.vmtkmeshvelocitystatistics',
     'vmtk.vmtkmeshviewer',
     'vmtk.vmtkmeshvolume',
     'vmtk.vmtkmeshvorticityhelicity',
@@ -52,6 +52,11 @@ class vmtkSurfaceRemeshing(pypes.pypeScript):
         self.Relaxation = 0.5
         self.PreserveBoundaryEdges = 0
         self.ExcludeEntityIds = []
+        self.Parallel = 0
+        self.Convergence = 0
+        self.ConvergenceChangeRatio = 1E-3
+        self.ConvergenceDisplacementRatio = 1E-2
+        self.PassStatistics = 0
 
         self.SetScriptName('vmtksurfaceremeshing')
         self.SetScriptDoc('remesh a surface using quality triangles')
@@ -77,12 +82,20 @@ class vmtkSurfaceRemeshing(pypes.pypeScript):
             ['CollapseAngleThreshold','collapseangle','float',1,'(0.0,)'],
             ['Relaxation','relaxation','float',1,'(0.5,)'],
             ['ExcludeEntityIds','exclude','int',-1,''],
-            ['PreserveBoundaryEdges','preserveboundary','bool',1]
+            ['PreserveBoundaryEdges','preserveboundary','bool',1],
+            ['Parallel','parallel','bool',1,'','test edge operations and relocate points in parallel, applying non overlapping operations in batches'],
+            ['Convergence','convergence','bool',1,'','stop remeshing passes once operations and relocation displacement fall below the convergence ratios'],
+            ['ConvergenceChangeRatio','convergencechangeratio','float',1,'(0.0,)','number of collapses, flips and splits per triangle below which a pass is converged'],
+            ['ConvergenceDisplacementRatio','convergencedisplacementratio','float',1,'(0.0,)','mean relocation displacement, relative to the square root of the mean triangle area, below which a pass is converged'],
+            ['PassStatistics','passstatistics','bool',1,'','store per pass operation counts, mean relocation displacement and area quality histogram in the output field data']
             ])
         self.SetOutputMembers([
             ['Surface','o','vtkPolyData',1,'','the output surface','vmtksurfacewriter']
             ])
 
+    def PrintProgress(self,obj,event):
+        self.OutputProgress(obj.GetProgress(),10)
+
     def Execute(self):
 
         if self.Surface == None:
@@ -142,8 +155,16 @@ class vmtkSurfaceRemeshing(pypes.pypeScript):
         surfaceRemeshing.SetCollapseAngleThreshold(self.CollapseAngleThreshold)
         surfaceRemeshing.SetPreserveBoundaryEdges(self.PreserveBoundaryEdges)
         surfaceRemeshing.SetExcludedEntityIds(excludedIds)
+        surfaceRemeshing.SetUseParallelOperations(self.Parallel)
+        surfaceRemeshing.SetUseConvergenceCriterion(self.Convergence)
+        surfaceRemeshing.SetConvergenceChangeRatio(self.ConvergenceChangeRatio)
+        surfaceRemeshing.SetConvergenceDisplacementRatio(self.ConvergenceDisplacementRatio)
+        surfaceRemeshing.SetGeneratePassStatistics(self.PassStatistics)
+        surfaceRemeshing.AddObserver("ProgressEvent", self.PrintProgress)
         surfaceRemeshing.Update()
 
+        self.EndProgress()
+
         self.Surface = surfaceRemeshing.GetOutput()
 
 
@@ -21,6 +21,7 @@ Version:   $Revision: 1.8 $
 
 #include "vtkvmtkCenterlineBifurcationReferenceSystems.h"
 #include "vtkPolyData.h"
+#include "vtkIdList.h"
 #include "vtkDoubleArray.h"
 #include "vtkIntArray.h"
 #include "vtkPointData.h"
@@ -35,9 +36,13 @@ Version:   $Revision: 1.8 $
 #include "vtkInformation.h"
 #include "vtkInformationVector.h"
 #include "vtkObjectFactory.h"
+#include "vtkSMPTools.h"
 
 #include "vtkvmtkCenterlineUtilities.h"
 
+#include <map>
+#include <vector>
+
 
 vtkStandardNewMacro(vtkvmtkCenterlineBifurcationReferenceSystems);
 
@@ -84,6 +89,39 @@ vtkvmtkCenterlineBifurcationReferenceSystems::~vtkvmtkCenterlineBifurcationRefer
     }
 }
 
+// Computes the reference systems of a range of blanked groups into the
+// per-group slots of origins, normals and upNormals.
+class vtkvmtkCenterlineBifurcationReferenceSystemsFunctor
+{
+public:
+  vtkvmtkCenterlineBifurcationReferenceSystemsFunctor(vtkvmtkCenterlineBifurcationReferenceSystems* filter, vtkPolyData* input, const std::vector<vtkIdType>* groupCellIds, double* origins, double* normals, double* upNormals, int* computed) :
+    Filter(filter), Input(input), GroupCellIds(groupCellIds), Origins(origins), Normals(normals), UpNormals(upNormals), Computed(computed) {}
+
+  void operator()(vtkIdType begin, vtkIdType end)
+  {
+    vtkIdList* cellIds = vtkIdList::New();
+    for (vtkIdType i=begin; i<end; i++)
+      {
+      const std::vector<vtkIdType>& groupCellIds = this->GroupCellIds[i];
+      cellIds->Reset();
+      for (size_t j=0; j<groupCellIds.size(); j++)
+        {
+        cellIds->InsertNextId(groupCellIds[j]);
+        }
+      this->Computed[i] = this->Filter->ComputeGroupReferenceSystem(this->Input,cellIds,this->Origins+3*i,this->Normals+3*i,this->UpNormals+3*i);
+      }
+    cellIds->Delete();
+  }
+
+  vtkvmtkCenterlineBifurcationReferenceSystems* Filter;
+  vtkPolyData* Input;
+  const std::vector<vtkIdType>* GroupCellIds;
+  double* Origins;
+  double* Normals;
+  double* UpNormals;
+  int* Computed;
+};
+
 int vtkvmtkCenterlineBifurcationReferenceSystems::RequestData(
   vtkInformation *vtkNotUsed(request),
   vtkInformationVector **inputVector,
@@ -167,13 +205,56 @@ int vtkvmtkCenterlineBifurcationReferenceSystems::RequestData(
 
   vtkIntArray* referenceGroupIdsArray = vtkIntArray::New();
   referenceGroupIdsArray->SetName(this->GroupIdsArrayName);
+
+  // cell links are built once, so that groups can be processed concurrently
+  input->BuildCells();
+
   vtkIdList* blankedGroupIds = vtkIdList::New();
   vtkvmtkCenterlineUtilities::GetBlankedGroupsIdList(input,this->GroupIdsArrayName,this->BlankingArrayName,blankedGroupIds);
+  vtkIdType numberOfBlankedGroups = blankedGroupIds->GetNumberOfIds();
+
+  // cells of each blanked group, in cell order, gathered in a single pass
+  std::map<vtkIdType,vtkIdType> blankedGroupIndices;
   int i;
-  for (i=0; i<blankedGroupIds->GetNumberOfIds(); i++)
+  for (i=0; i<numberOfBlankedGroups; i++)
     {
-    vtkIdType groupId = blankedGroupIds->GetId(i);
-    this->ComputeGroupReferenceSystem(input,groupId,outputPoints,normalArray,upNormalArray,referenceGroupIdsArray);
+    blankedGroupIndices[blankedGroupIds->GetId(i)] = i;
+    }
+
+  std::vector<std::vector<vtkIdType> > groupCellIds(numberOfBlankedGroups);
+  vtkIdType numberOfCells = input->GetNumberOfCells();
+  vtkIdType cellId;
+  for (cellId=0; cellId<numberOfCells; cellId++)
+    {
+    vtkIdType groupId = static_cast<int>(groupIdsArray->GetComponent(cellId,0));
+    std::map<vtkIdType,vtkIdType>::const_iterator it = blankedGroupIndices.find(groupId);
+    if (it != blankedGroupIndices.end())
+      {
+      groupCellIds[it->second].push_back(cellId);
+      }
+    }
+
+  std::vector<double> origins(3*numberOfBlankedGroups);
+  std::vector<double> normals(3*numberOfBlankedGroups);
+  std::vector<double> upNormals(3*numberOfBlankedGroups);
+  std::vector<int> computed(numberOfBlankedGroups,0);
+
+  if (numberOfBlankedGroups > 0)
+    {
+    vtkvmtkCenterlineBifurcationReferenceSystemsFunctor functor(this,input,&groupCellIds[0],&origins[0],&normals[0],&upNormals[0],&computed[0]);
+    vtkSMPTools::For(0,numberOfBlankedGroups,functor);
+    }
+
+  for (i=0; i<numberOfBlankedGroups; i++)
+    {
+    if (!computed[i])
+      {
+      continue;
+      }
+    outputPoints->InsertNextPoint(&origins[3*i]);
+    normalArray->InsertNextTuple(&normals[3*i]);
+    upNormalArray->InsertNextTuple(&upNormals[3*i]);
+    referenceGroupIdsArray->InsertNextTuple1(blankedGroupIds->GetId(i));
     }
   blankedGroupIds->Delete();
   
@@ -201,15 +282,11 @@ int vtkvmtkCenterlineBifurcationReferenceSystems::RequestData(
   return 1;
 }
 
-void vtkvmtkCenterlineBifurcationReferenceSystems::ComputeGroupReferenceSystem(vtkPolyData* input, int referenceGroupId, vtkPoints* outputPoints, vtkDoubleArray* normalArray, vtkDoubleArray* upNormalArray, vtkIntArray* referenceGroupIdsArray)
+int vtkvmtkCenterlineBifurcationReferenceSystems::ComputeGroupReferenceSystem(vtkPolyData* input, vtkIdList* groupCellIds, double bifurcationOrigin[3], double bifurcationNormal[3], double bifurcationUpNormal[3])
 {
   vtkDataArray* radiusArray;
-  vtkDataArray* groupIdsArray;
-  vtkDataArray* blankingArray;
 
   radiusArray = input->GetPointData()->GetArray(this->RadiusArrayName);
-  groupIdsArray = input->GetCellData()->GetArray(this->GroupIdsArrayName);
-  blankingArray = input->GetCellData()->GetArray(this->BlankingArrayName);
 
   vtkIdType point0Id, point1Id;
 
@@ -222,23 +299,24 @@ void vtkvmtkCenterlineBifurcationReferenceSystems::ComputeGroupReferenceSystem(v
   vtkPoints* bifurcationPoints = vtkPoints::New();
   vtkDoubleArray* bifurcationRadii = vtkDoubleArray::New();
 
-  vtkIdList* groupCellIds = vtkIdList::New();
-//  vtkvmtkCenterlineUtilities::GetGroupCellIds(input,this->GroupIdsArrayName,referenceGroupId,groupCellIds);
-  vtkvmtkCenterlineUtilities::GetGroupUniqueCellIds(input,this->GroupIdsArrayName,referenceGroupId,groupCellIds);
+  vtkIdList* uniqueCellIds = vtkIdList::New();
+  vtkvmtkCenterlineUtilities::GetUniqueCellIds(input,groupCellIds,uniqueCellIds);
   int i;
-  for (i=0; i<groupCellIds->GetNumberOfIds(); i++)
+  for (i=0; i<uniqueCellIds->GetNumberOfIds(); i++)
     {
-    vtkIdType cellId = groupCellIds->GetId(i);
-    vtkCell* polyLine = input->GetCell(cellId);
+    vtkIdType cellId = uniqueCellIds->GetId(i);
+    int cellType = input->GetCellType(cellId);
 
-    if (polyLine->GetCellType() != VTK_LINE && polyLine->GetCellType() != VTK_POLY_LINE)
+    if (cellType != VTK_LINE && cellType != VTK_POLY_LINE)
       {
       continue;
       }
 
-    point0Id = polyLine->GetPointId(0);
+    vtkIdType npts, *pts;
+    input->GetCellPoints(cellId,npts,pts);
+    point0Id = pts[0];
     input->GetPoint(point0Id,point0);
-    point1Id = polyLine->GetPointId(polyLine->GetNumberOfPoints()-1);
+    point1Id = pts[npts-1];
     input->GetPoint(point1Id,point1);
 
     bool skip = false;
@@ -266,14 +344,10 @@ void vtkvmtkCenterlineBifurcationReferenceSystems::ComputeGroupReferenceSystem(v
     bifurcationPoints->InsertNextPoint(point1);
     bifurcationRadii->InsertNextTuple1(radius1);
     }
-  groupCellIds->Delete();
+  uniqueCellIds->Delete();
 
   int numberOfBifurcationPoints = bifurcationPoints->GetNumberOfPoints();
 
-  double bifurcationOrigin[3];
-  double bifurcationNormal[3];
-  double bifurcationUpNormal[3];
-
   double point[3];
   double radius;
   double weight;
@@ -370,6 +444,7 @@ void vtkvmtkCenterlineBifurcationReferenceSystems::ComputeGroupReferenceSystem(v
 
   if (bifurcationNormals->GetNumberOfTuples() == 0)
     {
+    int computed = 0;
     if (bifurcationPoints->GetNumberOfPoints() > 1)
       {
       bifurcationPoints->GetPoint(1,point1);
@@ -383,10 +458,12 @@ void vtkvmtkCenterlineBifurcationReferenceSystems::ComputeGroupReferenceSystem(v
       double lineNormal[3], dummy[3];
       vtkMath::Perpendiculars(lineUpNormal,lineNormal,dummy,0.0);
 
-      outputPoints->InsertNextPoint(bifurcationOrigin);
-      normalArray->InsertNextTuple(lineNormal);
-      upNormalArray->InsertNextTuple(lineUpNormal);
-      referenceGroupIdsArray->InsertNextTuple1(referenceGroupId);
+      for (int k=0; k<3; k++)
+        {
+        bifurcationNormal[k] = lineNormal[k];
+        bifurcationUpNormal[k] = lineUpNormal[k];
+        }
+      computed = 1;
       }
 
     vertexPoints->Delete();
@@ -394,7 +471,7 @@ void vtkvmtkCenterlineBifurcationReferenceSystems::ComputeGroupReferenceSystem(v
     bifurcationRadii->Delete();
     bifurcationNormals->Delete();
 
-    return;
+    return computed;
     }
 
   int numberOfNormals = bifurcationNormals->GetNumberOfTuples();
@@ -461,16 +538,13 @@ void vtkvmtkCenterlineBifurcationReferenceSystems::ComputeGroupReferenceSystem(v
     }
 
   vtkMath::Normalize(bifurcationUpNormal);
-  
-  outputPoints->InsertNextPoint(bifurcationOrigin);
-  normalArray->InsertNextTuple(bifurcationNormal);
-  upNormalArray->InsertNextTuple(bifurcationUpNormal);
-  referenceGroupIdsArray->InsertNextTuple1(referenceGroupId);
 
   vertexPoints->Delete();
   bifurcationPoints->Delete();
   bifurcationRadii->Delete();
   bifurcationNormals->Delete();
+
+  return 1;
 }
 
 void vtkvmtkCenterlineBifurcationReferenceSystems::PrintSelf(ostream& os, vtkIndent indent)
@@ -29,9 +29,7 @@ Version:   $Revision: 1.5 $
 //#include "vtkvmtkComputationalGeometryWin32Header.h"
 #include "vtkvmtkWin32Header.h"
 
-class vtkPoints;
-class vtkDoubleArray;
-class vtkIntArray;
+class vtkIdList;
   
 class VTK_VMTK_COMPUTATIONAL_GEOMETRY_EXPORT vtkvmtkCenterlineBifurcationReferenceSystems : public vtkPolyDataAlgorithm
 {
@@ -62,7 +60,13 @@ class VTK_VMTK_COMPUTATIONAL_GEOMETRY_EXPORT vtkvmtkCenterlineBifurcationReferen
 
   virtual int RequestData(vtkInformation *, vtkInformationVector **, vtkInformationVector *) VTK_OVERRIDE;
 
-  void ComputeGroupReferenceSystem(vtkPolyData* input, int referenceGroupId, vtkPoints* outputPoints, vtkDoubleArray* normalArray, vtkDoubleArray* upNormalArray, vtkIntArray* referenceGroupIdsArray);
+  // Description:
+  // Computes the reference system of the bifurcation group made of
+  // groupCellIds. Returns 0 if the group yields no reference system. Safe
+  // to call concurrently once the cells of input are built.
+  int ComputeGroupReferenceSystem(vtkPolyData* input, vtkIdList* groupCellIds, double bifurcationOrigin[3], double bifurcationNormal[3], double bifurcationUpNormal[3]);
+
+  friend class vtkvmtkCenterlineBifurcationReferenceSystemsFunctor;
 
   char* RadiusArrayName;
   char* GroupIdsArrayName;
@@ -34,9 +34,13 @@ Version:   $Revision: 1.1 $
 #include "vtkInformation.h"
 #include "vtkInformationVector.h"
 #include "vtkObjectFactory.h"
+#include "vtkSMPTools.h"
 
 #include "vtkvmtkCenterlineUtilities.h"
-#include "vtkvmtkReferenceSystemUtilities.h"
+
+#include <map>
+#include <utility>
+#include <vector>
 
 
 vtkStandardNewMacro(vtkvmtkCenterlineBifurcationVectors);
@@ -165,6 +169,59 @@ vtkvmtkCenterlineBifurcationVectors::~vtkvmtkCenterlineBifurcationVectors()
   }
 }
 
+// Bifurcation vectors of a bifurcation group, with their components and
+// angles in its reference system.
+struct vtkvmtkCenterlineBifurcationVectorsBifurcation
+{
+  vtkIdType GroupId;
+  vtkIdType ReferenceSystemPointId;
+  vtkIdList* GroupIds;
+  vtkIntArray* Orientation;
+  vtkDoubleArray* Vectors;
+  vtkPoints* Points;
+  vtkDoubleArray* InPlaneVectors;
+  vtkDoubleArray* OutOfPlaneVectors;
+  vtkDoubleArray* InPlaneVectorAngles;
+  vtkDoubleArray* OutOfPlaneVectorAngles;
+};
+
+// Computes the bifurcation vectors of a range of bifurcations, whose
+// adjacent groups have already been found, from the unique cells of each
+// group.
+class vtkvmtkCenterlineBifurcationVectorsFunctor
+{
+public:
+  vtkvmtkCenterlineBifurcationVectorsFunctor(vtkvmtkCenterlineBifurcationVectors* filter, vtkPolyData* input, const std::map<vtkIdType,vtkIdType>* groupIndices, vtkIdList* const* uniqueGroupCellIds, vtkvmtkCenterlineBifurcationVectorsBifurcation* bifurcations) :
+    Filter(filter), Input(input), GroupIndices(groupIndices), UniqueGroupCellIds(uniqueGroupCellIds), Bifurcations(bifurcations) {}
+
+  void operator()(vtkIdType begin, vtkIdType end)
+  {
+    for (vtkIdType i=begin; i<end; i++)
+      {
+      vtkvmtkCenterlineBifurcationVectorsBifurcation& bifurcation = this->Bifurcations[i];
+      int numberOfBifurcationVectors = bifurcation.GroupIds->GetNumberOfIds();
+      for (int j=0; j<numberOfBifurcationVectors; j++)
+        {
+        vtkIdType groupIndex = this->GroupIndices->find(bifurcation.GroupIds->GetId(j))->second;
+        double bifurcationVector[3], bifurcationVectorPoint[3];
+        bifurcationVector[0] = bifurcationVector[1] = bifurcationVector[2] = 0.0;
+        bifurcationVectorPoint[0] = bifurcationVectorPoint[1] = bifurcationVectorPoint[2] = 0.0;
+        this->Filter->ComputeBifurcationVector(this->Input,this->UniqueGroupCellIds[groupIndex],bifurcation.Orientation->GetValue(j),bifurcationVector,bifurcationVectorPoint);
+        bifurcation.Vectors->InsertNextTuple(bifurcationVector);
+        bifurcation.Points->InsertNextPoint(bifurcationVectorPoint);
+        }
+      this->Filter->ComputeBifurcationVectorComponents(bifurcation.ReferenceSystemPointId,bifurcation.Vectors,bifurcation.InPlaneVectors,bifurcation.OutOfPlaneVectors);
+      this->Filter->ComputeBifurcationVectorAngles(bifurcation.ReferenceSystemPointId,bifurcation.Vectors,bifurcation.InPlaneVectors,bifurcation.OutOfPlaneVectors,bifurcation.InPlaneVectorAngles,bifurcation.OutOfPlaneVectorAngles);
+      }
+  }
+
+  vtkvmtkCenterlineBifurcationVectors* Filter;
+  vtkPolyData* Input;
+  const std::map<vtkIdType,vtkIdType>* GroupIndices;
+  vtkIdList* const* UniqueGroupCellIds;
+  vtkvmtkCenterlineBifurcationVectorsBifurcation* Bifurcations;
+};
+
 int vtkvmtkCenterlineBifurcationVectors::RequestData(
   vtkInformation *vtkNotUsed(request),
   vtkInformationVector **inputVector,
@@ -379,54 +436,194 @@ int vtkvmtkCenterlineBifurcationVectors::RequestData(
   output->GetPointData()->AddArray(bifurcationVectorsGroupIdsArray);
   output->GetPointData()->AddArray(bifurcationVectorsBifurcationGroupIdsArray);
 
+  // cell links are built once, so that bifurcations can be processed
+  // concurrently
+  input->BuildCells();
+
+  // cells of each group and of each centerline tract, in cell order,
+  // gathered in a single pass
+  vtkIdType numberOfCells = input->GetNumberOfCells();
+  std::vector<vtkIdType> cellGroupIds(numberOfCells);
+  std::vector<vtkIdType> cellCenterlineIds(numberOfCells);
+  std::vector<vtkIdType> cellTractIds(numberOfCells);
+  std::map<vtkIdType,vtkIdType> groupIndices;
+  std::vector<std::vector<vtkIdType> > groupCellIds;
+  std::map<std::pair<vtkIdType,vtkIdType>,std::vector<vtkIdType> > tractCellIds;
+  vtkIdType cellId;
+  for (cellId=0; cellId<numberOfCells; cellId++)
+    {
+    vtkIdType groupId = static_cast<int>(groupIdsArray->GetComponent(cellId,0));
+    cellGroupIds[cellId] = groupId;
+    cellCenterlineIds[cellId] = static_cast<int>(centerlineIdsArray->GetComponent(cellId,0));
+    cellTractIds[cellId] = static_cast<int>(tractIdsArray->GetComponent(cellId,0));
+    std::map<vtkIdType,vtkIdType>::iterator it = groupIndices.find(groupId);
+    if (it == groupIndices.end())
+      {
+      it = groupIndices.insert(std::make_pair(groupId,static_cast<vtkIdType>(groupCellIds.size()))).first;
+      groupCellIds.push_back(std::vector<vtkIdType>());
+      }
+    groupCellIds[it->second].push_back(cellId);
+    tractCellIds[std::make_pair(cellCenterlineIds[cellId],cellTractIds[cellId])].push_back(cellId);
+    }
+
+  vtkIdType numberOfGroups = static_cast<vtkIdType>(groupCellIds.size());
+  std::vector<vtkIdList*> uniqueGroupCellIds(numberOfGroups);
+  vtkIdList* cellIds = vtkIdList::New();
+  vtkIdType groupIndex;
+  for (groupIndex=0; groupIndex<numberOfGroups; groupIndex++)
+    {
+    cellIds->Reset();
+    for (size_t j=0; j<groupCellIds[groupIndex].size(); j++)
+      {
+      cellIds->InsertNextId(groupCellIds[groupIndex][j]);
+      }
+    uniqueGroupCellIds[groupIndex] = vtkIdList::New();
+    vtkvmtkCenterlineUtilities::GetUniqueCellIds(input,cellIds,uniqueGroupCellIds[groupIndex]);
+    }
+  cellIds->Delete();
+
+  // first reference system of each group
+  std::map<vtkIdType,vtkIdType> referenceSystemPointIds;
+  vtkIdType pointId;
+  for (pointId=this->ReferenceSystems->GetNumberOfPoints()-1; pointId>=0; pointId--)
+    {
+    referenceSystemPointIds[static_cast<int>(referenceSystemGroupIdsArray->GetComponent(pointId,0))] = pointId;
+    }
+
   vtkIdList* blankedGroupIds = vtkIdList::New();
   vtkvmtkCenterlineUtilities::GetBlankedGroupsIdList(input,this->GroupIdsArrayName,this->BlankingArrayName,blankedGroupIds);
+
+  std::vector<vtkvmtkCenterlineBifurcationVectorsBifurcation> bifurcations;
+  vtkIdList* upStreamGroupIds = vtkIdList::New();
+  vtkIdList* downStreamGroupIds = vtkIdList::New();
   int i;
   for (i=0; i<blankedGroupIds->GetNumberOfIds(); i++)
   {
     vtkIdType bifurcationGroupId = blankedGroupIds->GetId(i);
-    
-    vtkIdList* groupBifurcationVectorsGroupIds = vtkIdList::New();
-    vtkIntArray* groupBifurcationVectorsOrientation = vtkIntArray::New();
-    vtkDoubleArray* groupBifurcationVectors = vtkDoubleArray::New();
-    vtkPoints* groupBifurcationVectorsPoints = vtkPoints::New();
-    vtkDoubleArray* groupInPlaneBifurcationVectors = vtkDoubleArray::New();
-    vtkDoubleArray* groupOutOfPlaneBifurcationVectors = vtkDoubleArray::New();
-    vtkDoubleArray* groupInPlaneBifurcationVectorAngles = vtkDoubleArray::New();
-    vtkDoubleArray* groupOutOfPlaneBifurcationVectorAngles = vtkDoubleArray::New();
-
-    this->ComputeBifurcationVectors(input,bifurcationGroupId,groupBifurcationVectorsGroupIds,groupBifurcationVectorsOrientation,groupBifurcationVectors,groupBifurcationVectorsPoints);
-    this->ComputeBifurcationVectorComponents(bifurcationGroupId,groupBifurcationVectors,groupInPlaneBifurcationVectors,groupOutOfPlaneBifurcationVectors);
-    this->ComputeBifurcationVectorAngles(bifurcationGroupId,groupBifurcationVectors,groupInPlaneBifurcationVectors,groupOutOfPlaneBifurcationVectors,groupInPlaneBifurcationVectorAngles,groupOutOfPlaneBifurcationVectorAngles);
-    
+
+    std::map<vtkIdType,vtkIdType>::const_iterator referenceSystemIt = referenceSystemPointIds.find(bifurcationGroupId);
+    if (referenceSystemIt == referenceSystemPointIds.end())
+      {
+      vtkErrorMacro(<<"No reference system for bifurcation group "<<bifurcationGroupId<<", skipping.");
+      continue;
+      }
+
+    // upstream and downstream groups: groups of the tracts preceding and
+    // following the tracts of the bifurcation on the same centerline
+    upStreamGroupIds->Reset();
+    downStreamGroupIds->Reset();
+    const std::vector<vtkIdType>& bifurcationCellIds = groupCellIds[groupIndices[bifurcationGroupId]];
+    size_t j, k;
+    for (j=0; j<bifurcationCellIds.size(); j++)
+      {
+      cellId = bifurcationCellIds[j];
+      int cellType = input->GetCellType(cellId);
+      if (cellType != VTK_LINE && cellType != VTK_POLY_LINE)
+        {
+        continue;
+        }
+      //WARNING: this assumes that tract ids are adjacent
+      std::map<std::pair<vtkIdType,vtkIdType>,std::vector<vtkIdType> >::const_iterator tractIt;
+      tractIt = tractCellIds.find(std::make_pair(cellCenterlineIds[cellId],cellTractIds[cellId]-1));
+      if (tractIt != tractCellIds.end())
+        {
+        for (k=0; k<tractIt->second.size(); k++)
+          {
+          if (cellGroupIds[tractIt->second[k]] != bifurcationGroupId)
+            {
+            upStreamGroupIds->InsertUniqueId(cellGroupIds[tractIt->second[k]]);
+            }
+          }
+        }
+      tractIt = tractCellIds.find(std::make_pair(cellCenterlineIds[cellId],cellTractIds[cellId]+1));
+      if (tractIt != tractCellIds.end())
+        {
+        for (k=0; k<tractIt->second.size(); k++)
+          {
+          if (cellGroupIds[tractIt->second[k]] != bifurcationGroupId)
+            {
+            downStreamGroupIds->InsertUniqueId(cellGroupIds[tractIt->second[k]]);
+            }
+          }
+        }
+      }
+
+    vtkvmtkCenterlineBifurcationVectorsBifurcation bifurcation;
+    bifurcation.GroupId = bifurcationGroupId;
+    bifurcation.ReferenceSystemPointId = referenceSystemIt->second;
+    bifurcation.GroupIds = vtkIdList::New();
+    bifurcation.Orientation = vtkIntArray::New();
+    bifurcation.Vectors = vtkDoubleArray::New();
+    bifurcation.Vectors->SetNumberOfComponents(3);
+    bifurcation.Points = vtkPoints::New();
+    bifurcation.InPlaneVectors = vtkDoubleArray::New();
+    bifurcation.OutOfPlaneVectors = vtkDoubleArray::New();
+    bifurcation.InPlaneVectorAngles = vtkDoubleArray::New();
+    bifurcation.OutOfPlaneVectorAngles = vtkDoubleArray::New();
+
+    for (k=0; k<static_cast<size_t>(upStreamGroupIds->GetNumberOfIds()); k++)
+      {
+      bifurcation.GroupIds->InsertNextId(upStreamGroupIds->GetId(k));
+      bifurcation.Orientation->InsertNextValue(VTK_VMTK_UPSTREAM_ORIENTATION);
+      }
+    for (k=0; k<static_cast<size_t>(downStreamGroupIds->GetNumberOfIds()); k++)
+      {
+      bifurcation.GroupIds->InsertNextId(downStreamGroupIds->GetId(k));
+      bifurcation.Orientation->InsertNextValue(VTK_VMTK_DOWNSTREAM_ORIENTATION);
+      }
+
+    bifurcations.push_back(bifurcation);
+  }
+  upStreamGroupIds->Delete();
+  downStreamGroupIds->Delete();
+  blankedGroupIds->Delete();
+
+  vtkIdType numberOfBifurcations = static_cast<vtkIdType>(bifurcations.size());
+  if (numberOfBifurcations > 0)
+    {
+    vtkvmtkCenterlineBifurcationVectorsFunctor functor(this,input,&groupIndices,&uniqueGroupCellIds[0],&bifurcations[0]);
+    vtkSMPTools::For(0,numberOfBifurcations,functor);
+    }
+
+  for (i=0; i<numberOfBifurcations; i++)
+  {
+    vtkvmtkCenterlineBifurcationVectorsBifurcation& bifurcation = bifurcations[i];
+
     int j;
-    for (j=0; j<groupBifurcationVectorsGroupIds->GetNumberOfIds(); j++)
+    for (j=0; j<bifurcation.GroupIds->GetNumberOfIds(); j++)
     {
-      vtkIdType pointId = outputPoints->InsertNextPoint(groupBifurcationVectorsPoints->GetPoint(j));
+      double tuple[3];
+      pointId = outputPoints->InsertNextPoint(bifurcation.Points->GetPoint(j));
       outputVerts->InsertNextCell(1);
       outputVerts->InsertCellPoint(pointId);
 
-      bifurcationVectorsArray->InsertNextTuple(groupBifurcationVectors->GetTuple(j));
-      inPlaneBifurcationVectorsArray->InsertNextTuple(groupInPlaneBifurcationVectors->GetTuple(j));
-      outOfPlaneBifurcationVectorsArray->InsertNextTuple(groupOutOfPlaneBifurcationVectors->GetTuple(j));
-      inPlaneBifurcationVectorAnglesArray->InsertNextTuple(groupInPlaneBifurcationVectorAngles->GetTuple(j));
-      outOfPlaneBifurcationVectorAnglesArray->InsertNextTuple(groupOutOfPlaneBifurcationVectorAngles->GetTuple(j));
-      bifurcationVectorsOrientationArray->InsertNextValue(groupBifurcationVectorsOrientation->GetValue(j));
-      bifurcationVectorsGroupIdsArray->InsertNextValue(groupBifurcationVectorsGroupIds->GetId(j));
-      bifurcationVectorsBifurcationGroupIdsArray->InsertNextValue(bifurcationGroupId);
+      bifurcation.Vectors->GetTuple(j,tuple);
+      bifurcationVectorsArray->InsertNextTuple(tuple);
+      bifurcation.InPlaneVectors->GetTuple(j,tuple);
+      inPlaneBifurcationVectorsArray->InsertNextTuple(tuple);
+      bifurcation.OutOfPlaneVectors->GetTuple(j,tuple);
+      outOfPlaneBifurcationVectorsArray->InsertNextTuple(tuple);
+      inPlaneBifurcationVectorAnglesArray->InsertNextValue(bifurcation.InPlaneVectorAngles->GetValue(j));
+      outOfPlaneBifurcationVectorAnglesArray->InsertNextValue(bifurcation.OutOfPlaneVectorAngles->GetValue(j));
+      bifurcationVectorsOrientationArray->InsertNextValue(bifurcation.Orientation->GetValue(j));
+      bifurcationVectorsGroupIdsArray->InsertNextValue(bifurcation.GroupIds->GetId(j));
+      bifurcationVectorsBifurcationGroupIdsArray->InsertNextValue(bifurcation.GroupId);
     }
     
-    groupBifurcationVectorsGroupIds->Delete();
-    groupBifurcationVectorsOrientation->Delete();
-    groupBifurcationVectors->Delete();
-    groupBifurcationVectorsPoints->Delete();
-    groupInPlaneBifurcationVectors->Delete();
-    groupOutOfPlaneBifurcationVectors->Delete();
-    groupInPlaneBifurcationVectorAngles->Delete();
-    groupOutOfPlaneBifurcationVectorAngles->Delete();
+    bifurcation.GroupIds->Delete();
+    bifurcation.Orientation->Delete();
+    bifurcation.Vectors->Delete();
+    bifurcation.Points->Delete();
+    bifurcation.InPlaneVectors->Delete();
+    bifurcation.OutOfPlaneVectors->Delete();
+    bifurcation.InPlaneVectorAngles->Delete();
+    bifurcation.OutOfPlaneVectorAngles->Delete();
   }
 
-  blankedGroupIds->Delete();
+  for (groupIndex=0; groupIndex<numberOfGroups; groupIndex++)
+    {
+    uniqueGroupCellIds[groupIndex]->Delete();
+    }
 
   outputPoints->Delete();
   outputVerts->Delete();
@@ -443,164 +640,111 @@ int vtkvmtkCenterlineBifurcationVectors::RequestData(
   return 1;
 }
 
-void vtkvmtkCenterlineBifurcationVectors::ComputeBifurcationVectors(vtkPolyData* input, int bifurcationGroupId, vtkIdList* bifurcationVectorsGroupIds, vtkIntArray* bifurcationVectorsOrientation, vtkDoubleArray* bifurcationVectors, vtkPoints* bifurcationVectorsPoints)
+void vtkvmtkCenterlineBifurcationVectors::ComputeBifurcationVector(vtkPolyData* input, vtkIdList* groupCellIds, int bifurcationVectorOrientation, double bifurcationVector[3], double bifurcationVectorPoint[3])
 {
   vtkDataArray* radiusArray = input->GetPointData()->GetArray(this->RadiusArrayName);
 
-  bifurcationVectorsGroupIds->Initialize();
-  bifurcationVectorsOrientation->Initialize();
-
-  vtkIdList* upStreamGroupIds = vtkIdList::New();
-  vtkIdList* downStreamGroupIds = vtkIdList::New();
-  
-  vtkvmtkCenterlineUtilities::FindAdjacentCenterlineGroupIds(input,this->GroupIdsArrayName,this->CenterlineIdsArrayName,this->TractIdsArrayName,bifurcationGroupId,upStreamGroupIds,downStreamGroupIds);
-
-  int numberOfUpStreamGroupIds = upStreamGroupIds->GetNumberOfIds();
-  int numberOfDownStreamGroupIds = downStreamGroupIds->GetNumberOfIds();
-
-  int i;
-  for (i=0; i<numberOfUpStreamGroupIds; i++)
-  {
-    bifurcationVectorsGroupIds->InsertNextId(upStreamGroupIds->GetId(i));
-    bifurcationVectorsOrientation->InsertNextValue(VTK_VMTK_UPSTREAM_ORIENTATION);
-  }
-  for (i=0; i<numberOfDownStreamGroupIds; i++)
-  {
-    bifurcationVectorsGroupIds->InsertNextId(downStreamGroupIds->GetId(i));
-    bifurcationVectorsOrientation->InsertNextValue(VTK_VMTK_DOWNSTREAM_ORIENTATION);
-  }
+  double averageLastPoint[3], averageTouchingPoint[3];
+  averageLastPoint[0] = averageLastPoint[1] = averageLastPoint[2] = 0.0;
+  averageTouchingPoint[0] = averageTouchingPoint[1] = averageTouchingPoint[2] = 0.0;
+  double lastPointWeightSum = 0.0;
+  double touchingPointWeightSum = 0.0;
+  for (int j=0; j<groupCellIds->GetNumberOfIds(); j++)
+    {
+    vtkIdType cellId = groupCellIds->GetId(j);
+    vtkIdType npts, *pts;
+    input->GetCellPoints(cellId,npts,pts);
+    int numberOfCellPoints = npts;
+    
+    vtkIdType touchingSubId = -1;
+    double touchingPCoord = 0.0;
  
-  upStreamGroupIds->Delete();
-  downStreamGroupIds->Delete();
-
-  bifurcationVectors->Initialize();
-  bifurcationVectors->SetNumberOfComponents(3);
+    vtkIdType pointSubId = -1;
+    double pointPCoord = 0.0;
+    bool forward = true;
+ 
+    double lastPoint[3];
+    double lastPointRadius = 0.0; 
 
-  int numberOfBifurcationVectors = bifurcationVectorsGroupIds->GetNumberOfIds();
-  
-  for (i=0; i<numberOfBifurcationVectors; i++)
+    if (bifurcationVectorOrientation == VTK_VMTK_UPSTREAM_ORIENTATION)
     {
-    int bifurcationVectorGroupId = bifurcationVectorsGroupIds->GetId(i);
-    int bifurcationVectorOrientation = bifurcationVectorsOrientation->GetValue(i);
-    double averageLastPoint[3], averageTouchingPoint[3];
-    averageLastPoint[0] = averageLastPoint[1] = averageLastPoint[2] = 0.0;
-    averageTouchingPoint[0] = averageTouchingPoint[1] = averageTouchingPoint[2] = 0.0;
-    double lastPointWeightSum = 0.0;
-    double touchingPointWeightSum = 0.0;
-    vtkIdList* groupCellIds = vtkIdList::New();
-    vtkvmtkCenterlineUtilities::GetGroupUniqueCellIds(input,this->GroupIdsArrayName,bifurcationVectorGroupId,groupCellIds);
-    for (int j=0; j<groupCellIds->GetNumberOfIds(); j++)
-      {
-      vtkIdType cellId = groupCellIds->GetId(j);
-      vtkCell* cell = input->GetCell(cellId);
-      int numberOfCellPoints = cell->GetNumberOfPoints();
-      
-      vtkIdType touchingSubId = -1;
-      double touchingPCoord = 0.0;
-   
-      vtkIdType pointSubId = -1;
-      double pointPCoord = 0.0;
-      bool forward = true;
- 
-      double lastPoint[3];
-      double lastPointRadius = 0.0; 
+      pointSubId = numberOfCellPoints-2;
+      pointPCoord = 1.0;
+      forward = true;
+      input->GetPoint(pts[numberOfCellPoints-1],lastPoint);
+      lastPointRadius = radiusArray->GetComponent(pts[numberOfCellPoints-1],0);
+    }
+    else
+    {
+      pointSubId = 0;
+      pointPCoord = 0.0;
+      forward = false;
+      input->GetPoint(pts[0],lastPoint);
+      lastPointRadius = radiusArray->GetComponent(pts[0],0);
+    }
+    
+    vtkvmtkCenterlineSphereDistance::FindTouchingSphereCenter(input,this->RadiusArrayName,cellId,pointSubId,pointPCoord,touchingSubId,touchingPCoord,forward);
 
-      if (bifurcationVectorOrientation == VTK_VMTK_UPSTREAM_ORIENTATION)
-      {
-        pointSubId = numberOfCellPoints-2;
-        pointPCoord = 1.0;
-        forward = true;
-        cell->GetPoints()->GetPoint(numberOfCellPoints-1,lastPoint);
-        lastPointRadius = radiusArray->GetComponent(cell->GetPointId(numberOfCellPoints-1),0);
-      }
-      else if (bifurcationVectorOrientation == VTK_VMTK_DOWNSTREAM_ORIENTATION)
-      {
-        pointSubId = 0;
-        pointPCoord = 0.0;
-        forward = false;
-        cell->GetPoints()->GetPoint(0,lastPoint);
-        lastPointRadius = radiusArray->GetComponent(cell->GetPointId(0),0);
-      }
-      else
+    if (touchingSubId == -1)
       {
-        vtkErrorMacro("Error: invalid BifurcationVectorOrientation");
-        return;
+      touchingSubId = numberOfCellPoints-2;
+      touchingPCoord = 1.0;
       }
-      
-      vtkvmtkCenterlineSphereDistance::FindTouchingSphereCenter(input,this->RadiusArrayName,cellId,pointSubId,pointPCoord,touchingSubId,touchingPCoord,forward);
-
-      if (touchingSubId == -1)
-        {
-        touchingSubId = numberOfCellPoints-2;
-        touchingPCoord = 1.0;
-        }
 
-      //accumulate last point and touching point (weighted with radius^2)
+    //accumulate last point and touching point (weighted with radius^2)
 
-      averageLastPoint[0] += lastPointRadius * lastPointRadius * lastPoint[0];
-      averageLastPoint[1] += lastPointRadius * lastPointRadius * lastPoint[1];
-      averageLastPoint[2] += lastPointRadius * lastPointRadius * lastPoint[2];
-
-      lastPointWeightSum += lastPointRadius * lastPointRadius;
-      double touchingPoint[3], touchingPointRadius;
-      vtkvmtkCenterlineUtilities::InterpolatePoint(input,cellId,touchingSubId,touchingPCoord,touchingPoint);
-      vtkvmtkCenterlineUtilities::InterpolateTuple(input,this->RadiusArrayName,cellId,touchingSubId,touchingPCoord,&touchingPointRadius);
-      
-      averageTouchingPoint[0] += touchingPointRadius * touchingPointRadius * touchingPoint[0];
-      averageTouchingPoint[1] += touchingPointRadius * touchingPointRadius * touchingPoint[1];
-      averageTouchingPoint[2] += touchingPointRadius * touchingPointRadius * touchingPoint[2];
-
-      touchingPointWeightSum += touchingPointRadius * touchingPointRadius;
-      }
-    groupCellIds->Delete();
+    averageLastPoint[0] += lastPointRadius * lastPointRadius * lastPoint[0];
+    averageLastPoint[1] += lastPointRadius * lastPointRadius * lastPoint[1];
+    averageLastPoint[2] += lastPointRadius * lastPointRadius * lastPoint[2];
 
-    averageLastPoint[0] /= lastPointWeightSum;
-    averageLastPoint[1] /= lastPointWeightSum;
-    averageLastPoint[2] /= lastPointWeightSum;
-
-    averageTouchingPoint[0] /= touchingPointWeightSum;
-    averageTouchingPoint[1] /= touchingPointWeightSum;
-    averageTouchingPoint[2] /= touchingPointWeightSum;
+    lastPointWeightSum += lastPointRadius * lastPointRadius;
+    double touchingPoint[3], touchingPointRadius;
+    vtkvmtkCenterlineUtilities::InterpolatePoint(input,cellId,touchingSubId,touchingPCoord,touchingPoint);
+    vtkvmtkCenterlineUtilities::InterpolateTuple(input,this->RadiusArrayName,cellId,touchingSubId,touchingPCoord,&touchingPointRadius);
     
-    //build and store bifurcationVector for this group
+    averageTouchingPoint[0] += touchingPointRadius * touchingPointRadius * touchingPoint[0];
+    averageTouchingPoint[1] += touchingPointRadius * touchingPointRadius * touchingPoint[1];
+    averageTouchingPoint[2] += touchingPointRadius * touchingPointRadius * touchingPoint[2];
 
-    double bifurcationVector[3], bifurcationVectorPoint[3];
+    touchingPointWeightSum += touchingPointRadius * touchingPointRadius;
+    }
 
-    if (bifurcationVectorOrientation == VTK_VMTK_UPSTREAM_ORIENTATION)
-      {
-      bifurcationVector[0] = averageLastPoint[0] - averageTouchingPoint[0];
-      bifurcationVector[1] = averageLastPoint[1] - averageTouchingPoint[1];
-      bifurcationVector[2] = averageLastPoint[2] - averageTouchingPoint[2];
-      bifurcationVectorPoint[0] = averageTouchingPoint[0]; 
-      bifurcationVectorPoint[1] = averageTouchingPoint[1]; 
-      bifurcationVectorPoint[2] = averageTouchingPoint[2]; 
-      }
-    else if (bifurcationVectorOrientation == VTK_VMTK_DOWNSTREAM_ORIENTATION)
-      {
-      bifurcationVector[0] = averageTouchingPoint[0] - averageLastPoint[0];
-      bifurcationVector[1] = averageTouchingPoint[1] - averageLastPoint[1];
-      bifurcationVector[2] = averageTouchingPoint[2] - averageLastPoint[2];
-      bifurcationVectorPoint[0] = averageLastPoint[0]; 
-      bifurcationVectorPoint[1] = averageLastPoint[1]; 
-      bifurcationVectorPoint[2] = averageLastPoint[2]; 
-      }
-    else
-      {
-      vtkErrorMacro("Error: invalid BifurcationVectorOrientation");
-      return;
-      }
+  averageLastPoint[0] /= lastPointWeightSum;
+  averageLastPoint[1] /= lastPointWeightSum;
+  averageLastPoint[2] /= lastPointWeightSum;
 
-    if (this->NormalizeBifurcationVectors)
-      {
-      vtkMath::Normalize(bifurcationVector);
-      }
+  averageTouchingPoint[0] /= touchingPointWeightSum;
+  averageTouchingPoint[1] /= touchingPointWeightSum;
+  averageTouchingPoint[2] /= touchingPointWeightSum;
+  
+  //build and store bifurcationVector for this group
 
-    bifurcationVectors->InsertNextTuple(bifurcationVector);
-    bifurcationVectorsPoints->InsertNextPoint(bifurcationVectorPoint);
+  if (bifurcationVectorOrientation == VTK_VMTK_UPSTREAM_ORIENTATION)
+    {
+    bifurcationVector[0] = averageLastPoint[0] - averageTouchingPoint[0];
+    bifurcationVector[1] = averageLastPoint[1] - averageTouchingPoint[1];
+    bifurcationVector[2] = averageLastPoint[2] - averageTouchingPoint[2];
+    bifurcationVectorPoint[0] = averageTouchingPoint[0]; 
+    bifurcationVectorPoint[1] = averageTouchingPoint[1]; 
+    bifurcationVectorPoint[2] = averageTouchingPoint[2]; 
+    }
+  else
+    {
+    bifurcationVector[0] = averageTouchingPoint[0] - averageLastPoint[0];
+    bifurcationVector[1] = averageTouchingPoint[1] - averageLastPoint[1];
+    bifurcationVector[2] = averageTouchingPoint[2] - averageLastPoint[2];
+    bifurcationVectorPoint[0] = averageLastPoint[0]; 
+    bifurcationVectorPoint[1] = averageLastPoint[1]; 
+    bifurcationVectorPoint[2] = averageLastPoint[2]; 
+    }
+
+  if (this->NormalizeBifurcationVectors)
+    {
+    vtkMath::Normalize(bifurcationVector);
     }
 }
 
-void vtkvmtkCenterlineBifurcationVectors::ComputeBifurcationVectorComponents(int bifurcationGroupId, vtkDoubleArray* bifurcationVectors, vtkDoubleArray* inPlaneBifurcationVectors, vtkDoubleArray* outOfPlaneBifurcationVectors)
+void vtkvmtkCenterlineBifurcationVectors::ComputeBifurcationVectorComponents(vtkIdType referenceSystemPointId, vtkDoubleArray* bifurcationVectors, vtkDoubleArray* inPlaneBifurcationVectors, vtkDoubleArray* outOfPlaneBifurcationVectors)
 {
   // get the reference system, get the normal, project the angles.
 
@@ -612,8 +756,6 @@ void vtkvmtkCenterlineBifurcationVectors::ComputeBifurcationVectorComponents(int
   outOfPlaneBifurcationVectors->Initialize();
   outOfPlaneBifurcationVectors->SetNumberOfComponents(3);
   
-  int referenceSystemPointId = vtkvmtkReferenceSystemUtilities::GetReferenceSystemPointId(this->ReferenceSystems,this->ReferenceSystemGroupIdsArrayName,bifurcationGroupId); 
-  
   double bifurcationPlaneNormal[3];
   referenceSystemNormalArray->GetTuple(referenceSystemPointId,bifurcationPlaneNormal);
 
@@ -644,13 +786,11 @@ void vtkvmtkCenterlineBifurcationVectors::ComputeBifurcationVectorComponents(int
     }
 }
 
-void vtkvmtkCenterlineBifurcationVectors::ComputeBifurcationVectorAngles(int bifurcationGroupId, vtkDoubleArray* bifurcationVectors, vtkDoubleArray* inPlaneBifurcationVectors, vtkDoubleArray* outOfPlaneBifurcationVectors, vtkDoubleArray* inPlaneBifurcationVectorAngles, vtkDoubleArray* outOfPlaneBifurcationVectorAngles)
+void vtkvmtkCenterlineBifurcationVectors::ComputeBifurcationVectorAngles(vtkIdType referenceSystemPointId, vtkDoubleArray* bifurcationVectors, vtkDoubleArray* inPlaneBifurcationVectors, vtkDoubleArray* outOfPlaneBifurcationVectors, vtkDoubleArray* inPlaneBifurcationVectorAngles, vtkDoubleArray* outOfPlaneBifurcationVectorAngles)
 {
   vtkDataArray* referenceSystemNormalArray = this->ReferenceSystems->GetPointData()->GetArray(this->ReferenceSystemNormalArrayName);
   vtkDataArray* referenceSystemUpNormalArray = this->ReferenceSystems->GetPointData()->GetArray(this->ReferenceSystemUpNormalArrayName);
 
-  int referenceSystemPointId = vtkvmtkReferenceSystemUtilities::GetReferenceSystemPointId(this->ReferenceSystems,this->ReferenceSystemGroupIdsArrayName,bifurcationGroupId); 
-  
   double bifurcationPlaneNormal[3], bifurcationUpNormal[3];
   
   referenceSystemNormalArray->GetTuple(referenceSystemPointId,bifurcationPlaneNormal);
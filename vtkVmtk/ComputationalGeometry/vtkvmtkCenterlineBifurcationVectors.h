@@ -30,9 +30,8 @@ Version:   $Revision: 1.1 $
 #include "vtkvmtkWin32Header.h"
 #include "vtkPolyData.h"
 
-class vtkPoints;
+class vtkIdList;
 class vtkDoubleArray;
-class vtkIntArray;
   
 class VTK_VMTK_COMPUTATIONAL_GEOMETRY_EXPORT vtkvmtkCenterlineBifurcationVectors : public vtkPolyDataAlgorithm
 {
@@ -106,11 +105,18 @@ class VTK_VMTK_COMPUTATIONAL_GEOMETRY_EXPORT vtkvmtkCenterlineBifurcationVectors
 
   virtual int RequestData(vtkInformation *, vtkInformationVector **, vtkInformationVector *) VTK_OVERRIDE;
 
-  void ComputeBifurcationVectors(vtkPolyData* input, int bifurcationGroupId, vtkIdList* bifurcationVectorsGroupIds, vtkIntArray* bifurcationVectorsOrientation, vtkDoubleArray* bifurcationVectors, vtkPoints* bifurcationVectorsPoints);
+  // Description:
+  // Computes the bifurcation vector of the group made of the unique cells
+  // groupCellIds with the given orientation. Safe to call concurrently once
+  // the cells of input are built. The orientation is not checked: any value
+  // other than VTK_VMTK_UPSTREAM_ORIENTATION is taken as downstream.
+  void ComputeBifurcationVector(vtkPolyData* input, vtkIdList* groupCellIds, int bifurcationVectorOrientation, double bifurcationVector[3], double bifurcationVectorPoint[3]);
 
-  void ComputeBifurcationVectorComponents(int bifurcationGroupId, vtkDoubleArray* bifurcationVectors, vtkDoubleArray* inPlaneBifurcationVectors, vtkDoubleArray* outOfPlaneBifurcationVectors);
+  void ComputeBifurcationVectorComponents(vtkIdType referenceSystemPointId, vtkDoubleArray* bifurcationVectors, vtkDoubleArray* inPlaneBifurcationVectors, vtkDoubleArray* outOfPlaneBifurcationVectors);
   
-  void ComputeBifurcationVectorAngles(int bifurcationGroupId, vtkDoubleArray* bifurcationVectors, vtkDoubleArray* inPlaneBifurcationVectors, vtkDoubleArray* outOfPlaneBifurcationVectors, vtkDoubleArray* inPlaneBifurcationVectorAngles, vtkDoubleArray* outOfPlaneBifurcationVectorAngles);
+  void ComputeBifurcationVectorAngles(vtkIdType referenceSystemPointId, vtkDoubleArray* bifurcationVectors, vtkDoubleArray* inPlaneBifurcationVectors, vtkDoubleArray* outOfPlaneBifurcationVectors, vtkDoubleArray* inPlaneBifurcationVectorAngles, vtkDoubleArray* outOfPlaneBifurcationVectorAngles);
+
+  friend class vtkvmtkCenterlineBifurcationVectorsFunctor;
 
   char* RadiusArrayName;
   char* GroupIdsArrayName;
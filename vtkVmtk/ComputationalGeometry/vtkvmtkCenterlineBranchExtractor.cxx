@@ -21,7 +21,7 @@ Version:   $Revision: 1.10 $
 
 #include "vtkvmtkCenterlineBranchExtractor.h"
 #include "vtkvmtkCenterlineSphereDistance.h"
-#include "vtkvmtkPolyBallLine.h"
+#include "vtkvmtkPolyBallLineLocator.h"
 #include "vtkPolyData.h"
 #include "vtkPolyLine.h"
 #include "vtkPointData.h"
@@ -30,6 +30,9 @@ Version:   $Revision: 1.10 $
 #include "vtkDoubleArray.h"
 #include "vtkMath.h"
 #include "vtkObjectFactory.h"
+#include "vtkSMPTools.h"
+
+#include <algorithm>
 
 
 vtkStandardNewMacro(vtkvmtkCenterlineBranchExtractor);
@@ -42,94 +45,72 @@ vtkvmtkCenterlineBranchExtractor::~vtkvmtkCenterlineBranchExtractor()
 {
 }
 
-void vtkvmtkCenterlineBranchExtractor::ComputeCenterlineSplitting(vtkPolyData* input, vtkIdType cellId)
+class vtkvmtkCenterlineBranchExtractorIntersectionFunctor
 {
-  this->NumberOfSplittingPoints = 0;
-
-  if (this->SubIds)
-    {
-    delete[] this->SubIds;
-    this->SubIds = NULL;
-    }
-
-  if (this->PCoords)
-    {
-    delete[] this->PCoords;
-    this->PCoords = NULL;
-    }
-
-  if (this->TractBlanking)
-    {
-    delete[] this->TractBlanking;
-    this->TractBlanking = NULL;
-    }
-
-  if (!this->RadiusArrayName)
-    {
-    return;
-    }
-
-  if (input->GetCell(cellId)->GetCellType() != VTK_LINE && input->GetCell(cellId)->GetCellType() != VTK_POLY_LINE)
-    {
-    return;
-    }
-
-  vtkDataArray* radiusArray = input->GetPointData()->GetArray(this->RadiusArrayName);
-  
-  if (!radiusArray)
-    {
-    return;
-    }
-
-  // TODO: remove assumption: centerlines organized in a tree, parent branches as sources and children as targets
-
-  vtkvmtkPolyBallLine* tube = vtkvmtkPolyBallLine::New();
-
-  tube->SetInput(input);
-  tube->SetPolyBallRadiusArrayName(this->RadiusArrayName);
-
-  vtkIdList* tubeCellIds = vtkIdList::New();
-
-  vtkIdList* intersectionSubIds = vtkIdList::New();
-  vtkDoubleArray* intersectionPCoords = vtkDoubleArray::New();
-
-  vtkIdType numberOfCells = input->GetNumberOfCells();
-
-  //for every other cell than cellId, find intersection of cellId with the tube function of the other cell
-  int j;
-  for (j=0; j<numberOfCells; j++)
-    {
-    if (j==cellId)
-      {
-      continue;
-      }
-
-    if (input->GetCell(j)->GetCellType() != VTK_LINE && input->GetCell(j)->GetCellType() != VTK_POLY_LINE)
+public:
+  vtkvmtkCenterlineBranchExtractorIntersectionFunctor(vtkvmtkPolyBallLineLocator* tube, vtkPolyData* input, vtkDataArray* radiusArray, std::vector<vtkIdType>* intersectionSubIds, std::vector<double>* intersectionPCoords) :
+    Tube(tube), Input(input), RadiusArray(radiusArray), IntersectionSubIds(intersectionSubIds), IntersectionPCoords(intersectionPCoords) {}
+
+  void operator()(vtkIdType begin, vtkIdType end)
+  {
+    vtkIdList* tubeCellIds = vtkIdList::New();
+    std::vector<vtkIdType> previousTubeCellIds, currentTubeCellIds;
+    std::vector<std::pair<vtkIdType,vtkIdType> > exits;
+    for (vtkIdType cellId=begin; cellId<end; cellId++)
       {
-      continue;
-      }
+      if (this->Input->GetCellType(cellId) != VTK_LINE && this->Input->GetCellType(cellId) != VTK_POLY_LINE)
+        {
+        continue;
+        }
 
-    tubeCellIds->Initialize();
-    tubeCellIds->InsertNextId(j);
-    tube->SetInputCellIds(tubeCellIds);
+      vtkIdType npts, *pts;
+      this->Input->GetCellPoints(cellId,npts,pts);
 
-    int numberOfCellPoints = input->GetCell(cellId)->GetNumberOfPoints();
+      // segments of cellId going from inside to outside the tube of another cell
+      exits.clear();
+      double point[3];
+      int k;
+      for (k=0; k<npts; k++)
+        {
+        this->Input->GetPoint(pts[k],point);
+        this->Tube->FindTubeCells(point,tubeCellIds);
+        currentTubeCellIds.assign(tubeCellIds->GetPointer(0),tubeCellIds->GetPointer(0)+tubeCellIds->GetNumberOfIds());
+        if (k > 0)
+          {
+          std::vector<vtkIdType>::const_iterator it = currentTubeCellIds.begin();
+          for (size_t l=0; l<previousTubeCellIds.size(); l++)
+            {
+            vtkIdType j = previousTubeCellIds[l];
+            while (it != currentTubeCellIds.end() && *it < j)
+              {
+              ++it;
+              }
+            if (j != cellId && (it == currentTubeCellIds.end() || *it != j))
+              {
+              exits.push_back(std::make_pair(j,static_cast<vtkIdType>(k-1)));
+              }
+            }
+          }
+        previousTubeCellIds.swap(currentTubeCellIds);
+        }
 
-    double point0[3], point1[3];
-    double tubeValue0, tubeValue1;
-    for (int k=0; k<numberOfCellPoints-1; k++)
-      {
-      input->GetCell(cellId)->GetPoints()->GetPoint(k,point0);
-      input->GetCell(cellId)->GetPoints()->GetPoint(k+1,point1);
-      tubeValue0 = tube->EvaluateFunction(point0);
-      tubeValue1 = tube->EvaluateFunction(point1);
+      // in the order in which each other cell is considered separately
+      std::sort(exits.begin(),exits.end());
 
-//       if (tubeValue0 * tubeValue1 <= 0.0)
-      if ((tubeValue0 <= 0.0) && (tubeValue1 > 0.0))  // this is for divergent networks
+      std::vector<vtkIdType>& intersectionSubIds = this->IntersectionSubIds[cellId];
+      std::vector<double>& intersectionPCoords = this->IntersectionPCoords[cellId];
+      for (size_t e=0; e<exits.size(); e++)
         {
+        vtkIdType j = exits[e].first;
+        k = exits[e].second;
+
+        double point0[3], point1[3];
+        this->Input->GetPoint(pts[k],point0);
+        this->Input->GetPoint(pts[k+1],point1);
+
         double radius0, radius1;
-        radius0 = radiusArray->GetComponent(input->GetCell(cellId)->GetPointId(k),0);
-        radius1 = radiusArray->GetComponent(input->GetCell(cellId)->GetPointId(k+1),0);
+        radius0 = this->RadiusArray->GetComponent(pts[k],0);
+        radius1 = this->RadiusArray->GetComponent(pts[k+1],0);
 
         //TODO: use Newton iterations
         double segmentLength, stepSize, pcoordStepSize;
@@ -139,42 +120,42 @@ void vtkvmtkCenterlineBranchExtractor::ComputeCenterlineSplitting(vtkPolyData* i
         segmentLength = vtkMath::Distance2BetweenPoints(point0,point1);
         stepSize = 1E-2 * (radius0 + radius1) / 2.0;
         numberOfSteps = (int)ceil(segmentLength / stepSize);
-        stepSize = segmentLength / numberOfSteps;
         pcoordStepSize = 1.0 / (double)numberOfSteps;
-        
+
+        vtkIdType closestCellId, closestSubId;
+        double closestPCoord, closestCenter[3], closestCenterRadius;
         double pcoord = 0.0;
         int s;
         for (s=0; s<numberOfSteps; s++)
           {
-          for (int d=0; d<3; d++) 
+          for (int d=0; d<3; d++)
             {
             subPoint0[d] = point0[d] + pcoord * (point1[d] - point0[d]);
             subPoint1[d] = point0[d] + (pcoord + pcoordStepSize) * (point1[d] - point0[d]);
             }
-          
-          subTubeValue0 = tube->EvaluateFunction(subPoint0);
-          subTubeValue1 = tube->EvaluateFunction(subPoint1);
 
-//           if (subTubeValue0 * subTubeValue1 <= 0.0)
+          subTubeValue0 = this->Tube->EvaluateFunction(subPoint0,&j,1,closestCellId,closestSubId,closestPCoord,closestCenter,closestCenterRadius);
+          subTubeValue1 = this->Tube->EvaluateFunction(subPoint1,&j,1,closestCellId,closestSubId,closestPCoord,closestCenter,closestCenterRadius);
+
           if ((subTubeValue0 <= 0.0) && (subTubeValue1 > 0.0))  // this is for divergent networks
             {
             pcoord += pcoordStepSize;
             break;
             }
 
-          pcoord += pcoordStepSize; 
+          pcoord += pcoordStepSize;
           }
 
         //since we are considering each other cell separately, we need to decide where to put the intersection point in order to have them sorted along cellId
-        int numberOfIntersections = intersectionSubIds->GetNumberOfIds();
+        int numberOfIntersections = static_cast<int>(intersectionSubIds.size());
         int insertLocation = 0;
         for (s=0; s<numberOfIntersections; s++)
           {
-          bool afterThis = (k > intersectionSubIds->GetId(s)) || (k==intersectionSubIds->GetId(s) && pcoord > intersectionPCoords->GetValue(s));
+          bool afterThis = (k > intersectionSubIds[s]) || (k==intersectionSubIds[s] && pcoord > intersectionPCoords[s]);
           bool beforeNext = true;
           if (s<numberOfIntersections-1)
             {
-            beforeNext = (k < intersectionSubIds->GetId(s+1)) || (k==intersectionSubIds->GetId(s+1) && pcoord <= intersectionPCoords->GetValue(s+1));
+            beforeNext = (k < intersectionSubIds[s+1]) || (k==intersectionSubIds[s+1] && pcoord <= intersectionPCoords[s+1]);
             }
           if (afterThis && beforeNext)
             {
@@ -182,15 +163,126 @@ void vtkvmtkCenterlineBranchExtractor::ComputeCenterlineSplitting(vtkPolyData* i
             break;
             }
           }
-        for (s=numberOfIntersections-1; s>=insertLocation; s--)
-          {
-          intersectionSubIds->InsertId(s+1,intersectionSubIds->GetId(s));
-          intersectionPCoords->InsertValue(s+1,intersectionPCoords->GetValue(s));
-          }
-        intersectionSubIds->InsertId(insertLocation,k);
-        intersectionPCoords->InsertValue(insertLocation,pcoord);
+        intersectionSubIds.insert(intersectionSubIds.begin()+insertLocation,k);
+        intersectionPCoords.insert(intersectionPCoords.begin()+insertLocation,pcoord);
         }
       }
+    tubeCellIds->Delete();
+  }
+
+private:
+  vtkvmtkPolyBallLineLocator* Tube;
+  vtkPolyData* Input;
+  vtkDataArray* RadiusArray;
+  std::vector<vtkIdType>* IntersectionSubIds;
+  std::vector<double>* IntersectionPCoords;
+};
+
+void vtkvmtkCenterlineBranchExtractor::InitializeCenterlineSplitting(vtkPolyData* input)
+{
+  vtkIdType numberOfCells = input->GetNumberOfCells();
+
+  this->IntersectionOffsets.assign(numberOfCells+1,0);
+  this->IntersectionSubIds.clear();
+  this->IntersectionPCoords.clear();
+
+  if (!this->RadiusArrayName)
+    {
+    return;
+    }
+
+  vtkDataArray* radiusArray = input->GetPointData()->GetArray(this->RadiusArrayName);
+
+  if (!radiusArray)
+    {
+    return;
+    }
+
+  // Where each cell leaves the tube of each other cell is found from the
+  // tubes containing its points, all queried on one hierarchy, rather than
+  // by sweeping the cell through the tube of every other cell in turn.
+  input->BuildCells();
+  vtkvmtkPolyBallLineLocator* tube = vtkvmtkPolyBallLineLocator::New();
+  tube->SetInput(input);
+  tube->SetPolyBallRadiusArrayName(this->RadiusArrayName);
+  tube->Build();
+
+  std::vector<std::vector<vtkIdType> > intersectionSubIds(numberOfCells);
+  std::vector<std::vector<double> > intersectionPCoords(numberOfCells);
+
+  if (numberOfCells > 0)
+    {
+    vtkvmtkCenterlineBranchExtractorIntersectionFunctor functor(tube,input,radiusArray,&intersectionSubIds[0],&intersectionPCoords[0]);
+    vtkSMPTools::For(0,numberOfCells,functor);
+    }
+
+  tube->Delete();
+
+  for (vtkIdType i=0; i<numberOfCells; i++)
+    {
+    this->IntersectionSubIds.insert(this->IntersectionSubIds.end(),intersectionSubIds[i].begin(),intersectionSubIds[i].end());
+    this->IntersectionPCoords.insert(this->IntersectionPCoords.end(),intersectionPCoords[i].begin(),intersectionPCoords[i].end());
+    this->IntersectionOffsets[i+1] = static_cast<vtkIdType>(this->IntersectionSubIds.size());
+    }
+}
+
+void vtkvmtkCenterlineBranchExtractor::ComputeCenterlineSplitting(vtkPolyData* input, vtkIdType cellId)
+{
+  this->NumberOfSplittingPoints = 0;
+
+  if (this->SubIds)
+    {
+    delete[] this->SubIds;
+    this->SubIds = NULL;
+    }
+
+  if (this->PCoords)
+    {
+    delete[] this->PCoords;
+    this->PCoords = NULL;
+    }
+
+  if (this->TractBlanking)
+    {
+    delete[] this->TractBlanking;
+    this->TractBlanking = NULL;
+    }
+
+  if (!this->RadiusArrayName)
+    {
+    return;
+    }
+
+  if (input->GetCell(cellId)->GetCellType() != VTK_LINE && input->GetCell(cellId)->GetCellType() != VTK_POLY_LINE)
+    {
+    return;
+    }
+
+  vtkDataArray* radiusArray = input->GetPointData()->GetArray(this->RadiusArrayName);
+  
+  if (!radiusArray)
+    {
+    return;
+    }
+
+  // TODO: remove assumption: centerlines organized in a tree, parent branches as sources and children as targets
+
+  vtkIdType numberOfCells = input->GetNumberOfCells();
+
+  if (static_cast<vtkIdType>(this->IntersectionOffsets.size()) != numberOfCells+1)
+    {
+    this->InitializeCenterlineSplitting(input);
+    }
+
+  //intersections of cellId with the tube functions of the other cells, sorted along cellId
+  vtkIdList* intersectionSubIds = vtkIdList::New();
+  vtkDoubleArray* intersectionPCoords = vtkDoubleArray::New();
+
+  int j;
+  for (j=this->IntersectionOffsets[cellId]; j<this->IntersectionOffsets[cellId+1]; j++)
+    {
+    intersectionSubIds->InsertNextId(this->IntersectionSubIds[j]);
+    intersectionPCoords->InsertNextValue(this->IntersectionPCoords[j]);
     }
   
   // For each branch, find point at one-sphere distance upstream (i.e. touching forward). 
@@ -335,9 +427,6 @@ void vtkvmtkCenterlineBranchExtractor::ComputeCenterlineSplitting(vtkPolyData* i
     this->TractBlanking[i] = blankingFlags->GetId(i);
     }
 
-  tube->Delete();
-  tubeCellIds->Delete();
-
   intersectionSubIds->Delete();
   intersectionPCoords->Delete();
 
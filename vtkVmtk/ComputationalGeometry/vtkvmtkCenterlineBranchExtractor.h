@@ -28,6 +28,8 @@ Version:   $Revision: 1.5 $
 #include "vtkvmtkCenterlineSplittingAndGroupingFilter.h"
 //#include "vtkvmtkComputationalGeometryWin32Header.h"
 #include "vtkvmtkWin32Header.h"
+
+#include <vector>
   
 class VTK_VMTK_COMPUTATIONAL_GEOMETRY_EXPORT vtkvmtkCenterlineBranchExtractor : public vtkvmtkCenterlineSplittingAndGroupingFilter
 {
@@ -41,9 +43,16 @@ class VTK_VMTK_COMPUTATIONAL_GEOMETRY_EXPORT vtkvmtkCenterlineBranchExtractor :
   vtkvmtkCenterlineBranchExtractor();
   ~vtkvmtkCenterlineBranchExtractor();  
 
+  virtual void InitializeCenterlineSplitting(vtkPolyData* input) VTK_OVERRIDE;
   virtual void ComputeCenterlineSplitting(vtkPolyData* input, vtkIdType cellId) VTK_OVERRIDE;
   virtual void GroupTracts(vtkPolyData* input, vtkPolyData* centerlineTracts) VTK_OVERRIDE;
 
+  // points where each input cell leaves the tubes of the other cells,
+  // sorted along the cell
+  std::vector<vtkIdType> IntersectionOffsets;
+  std::vector<vtkIdType> IntersectionSubIds;
+  std::vector<double> IntersectionPCoords;
+
   private:
   vtkvmtkCenterlineBranchExtractor(const vtkvmtkCenterlineBranchExtractor&);  // Not implemented.
   void operator=(const vtkvmtkCenterlineBranchExtractor&);  // Not implemented.
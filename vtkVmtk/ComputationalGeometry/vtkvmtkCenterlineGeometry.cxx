@@ -32,10 +32,224 @@ Version:   $Revision: 1.5 $
 #include "vtkInformation.h"
 #include "vtkInformationVector.h"
 #include "vtkObjectFactory.h"
+#include "vtkSMPTools.h"
+#include "vtkSMPThreadLocal.h"
+
+#include <vector>
 
 
 vtkStandardNewMacro(vtkvmtkCenterlineGeometry);
 
+// Computes the geometry of a range of lines. Each line is gathered into
+// per thread coordinate buffers (one per component), smoothed there, and
+// the segment vectors, first and second derivatives, curvature, torsion
+// and Frenet frame are computed in sweeps over the buffers, with the same
+// formulas as ComputeLineCurvature, ComputeLineTorsion and
+// ComputeLineFrenetReferenceSystem. Point values are stored from
+// LineOffsets[i] on, line values at i.
+class vtkvmtkCenterlineGeometryLineFunctor
+{
+public:
+  vtkvmtkCenterlineGeometryLineFunctor(vtkPolyData* lines, const vtkIdType* lineOffsets, int lineSmoothing, int numberOfSmoothingIterations, double smoothingFactor, double* linePoints, double* curvatures, double* torsions, double* tangents, double* normals, double* binormals, double* lengths, double* tortuosities) :
+    Lines(lines), LineOffsets(lineOffsets), LineSmoothing(lineSmoothing), NumberOfSmoothingIterations(numberOfSmoothingIterations), SmoothingFactor(smoothingFactor), LinePoints(linePoints), Curvatures(curvatures), Torsions(torsions), Tangents(tangents), Normals(normals), Binormals(binormals), Lengths(lengths), Tortuosities(tortuosities) {}
+
+  void Initialize()
+  {
+  }
+
+  void operator()(vtkIdType begin, vtkIdType end)
+  {
+    std::vector<double>& buffer = this->LocalBuffer.Local();
+    vtkPoints* points = this->Lines->GetPoints();
+    vtkIdType npts, *pts;
+    double point[3];
+    for (vtkIdType i=begin; i<end; i++)
+      {
+      int numberOfPoints = static_cast<int>(this->LineOffsets[i+1] - this->LineOffsets[i]);
+      if (numberOfPoints == 0)
+        {
+        continue;
+        }
+      this->Lines->GetCellPoints(i,npts,pts);
+
+      // x, y, z; segment vectors and norms; first and second derivatives
+      buffer.resize(13*numberOfPoints);
+      double* x = &buffer[0];
+      double* y = x + numberOfPoints;
+      double* z = y + numberOfPoints;
+      double* dx = z + numberOfPoints;
+      double* dy = dx + numberOfPoints;
+      double* dz = dy + numberOfPoints;
+      double* norms = dz + numberOfPoints;
+      double* xps = norms + numberOfPoints;
+      double* xpps = xps + 3*numberOfPoints;
+
+      int j;
+      for (j=0; j<numberOfPoints; j++)
+        {
+        points->GetPoint(pts[j],point);
+        x[j] = point[0];
+        y[j] = point[1];
+        z[j] = point[2];
+        }
+
+      if (this->LineSmoothing)
+        {
+        double relaxation = this->SmoothingFactor;
+        for (int k=0; k<this->NumberOfSmoothingIterations; k++)
+          {
+          for (j=1; j<numberOfPoints-1; j++)
+            {
+            x[j] += relaxation * (0.5 * (x[j-1] + x[j+1]) - x[j]);
+            y[j] += relaxation * (0.5 * (y[j-1] + y[j+1]) - y[j]);
+            z[j] += relaxation * (0.5 * (z[j-1] + z[j+1]) - z[j]);
+            }
+          }
+        }
+
+      double length = 0.0;
+      for (j=0; j<numberOfPoints-1; j++)
+        {
+        dx[j] = x[j+1] - x[j];
+        dy[j] = y[j+1] - y[j];
+        dz[j] = z[j+1] - z[j];
+        norms[j] = sqrt(dx[j]*dx[j] + dy[j]*dy[j] + dz[j]*dz[j]);
+        length += norms[j];
+        }
+
+      vtkIdType offset = this->LineOffsets[i];
+      double* lineCurvatures = this->Curvatures + offset;
+      double* lineTorsions = this->Torsions + offset;
+      double* lineTangents = this->Tangents + 3*offset;
+      double* lineNormals = this->Normals + 3*offset;
+      double* lineBinormals = this->Binormals + 3*offset;
+
+      for (j=0; j<numberOfPoints; j++)
+        {
+        this->LinePoints[3*(offset+j)+0] = x[j];
+        this->LinePoints[3*(offset+j)+1] = y[j];
+        this->LinePoints[3*(offset+j)+2] = z[j];
+        }
+
+      for (j=0; j<3*numberOfPoints; j++)
+        {
+        xps[j] = xpps[j] = 0.0;
+        lineTangents[j] = lineNormals[j] = lineBinormals[j] = 0.0;
+        }
+
+      for (j=0; j<numberOfPoints; j++)
+        {
+        lineCurvatures[j] = lineTorsions[j] = 0.0;
+        }
+
+      for (j=1; j<numberOfPoints-1; j++)
+        {
+        double norm0 = norms[j-1];
+        double norm1 = norms[j];
+
+        if (norm0 < VTK_VMTK_DOUBLE_TOL || norm1 < VTK_VMTK_DOUBLE_TOL)
+          {
+          continue;
+          }
+
+        double* xp = xps + 3*j;
+        xp[0] = (x[j+1] - x[j-1]) / (norm0 + norm1);
+        xp[1] = (y[j+1] - y[j-1]) / (norm0 + norm1);
+        xp[2] = (z[j+1] - z[j-1]) / (norm0 + norm1);
+
+        double* xpp = xpps + 3*j;
+        xpp[0] = (dx[j] / norm1 - dx[j-1] / norm0) / ((norm0 + norm1) / 2.0);
+        xpp[1] = (dy[j] / norm1 - dy[j-1] / norm0) / ((norm0 + norm1) / 2.0);
+        xpp[2] = (dz[j] / norm1 - dz[j-1] / norm0) / ((norm0 + norm1) / 2.0);
+
+        double xpxppcross[3];
+        vtkMath::Cross(xp,xpp,xpxppcross);
+
+        lineCurvatures[j] = vtkMath::Norm(xpxppcross) / pow(vtkMath::Norm(xp),3.0);
+
+        double* tangent = lineTangents + 3*j;
+        double* normal = lineNormals + 3*j;
+        double* binormal = lineBinormals + 3*j;
+
+        tangent[0] = xp[0];
+        tangent[1] = xp[1];
+        tangent[2] = xp[2];
+        vtkMath::Normalize(tangent);
+
+        binormal[0] = xpxppcross[0];
+        binormal[1] = xpxppcross[1];
+        binormal[2] = xpxppcross[2];
+        vtkMath::Normalize(binormal);
+
+        vtkMath::Cross(binormal,tangent,normal);
+        vtkMath::Normalize(normal);
+        }
+
+      for (j=2; j<numberOfPoints-2; j++)
+        {
+        double norm0 = norms[j-1];
+        double norm1 = norms[j];
+
+        if (norm0 < VTK_VMTK_DOUBLE_TOL || norm1 < VTK_VMTK_DOUBLE_TOL)
+          {
+          continue;
+          }
+
+        double xpxppcross[3];
+        vtkMath::Cross(xps+3*j,xpps+3*j,xpxppcross);
+
+        double xppp[3];
+        xppp[0] = (xpps[3*(j+1)+0] - xpps[3*(j-1)+0]) / (norm0 + norm1);
+        xppp[1] = (xpps[3*(j+1)+1] - xpps[3*(j-1)+1]) / (norm0 + norm1);
+        xppp[2] = (xpps[3*(j+1)+2] - xpps[3*(j-1)+2]) / (norm0 + norm1);
+
+        lineTorsions[j] = vtkMath::Dot(xpxppcross,xppp) / pow(vtkMath::Norm(xpxppcross),2.0);
+        }
+
+      if (numberOfPoints > 1)
+        {
+        for (int k=0; k<3; k++)
+          {
+          lineTangents[k] = lineTangents[3+k];
+          lineNormals[k] = lineNormals[3+k];
+          lineBinormals[k] = lineBinormals[3+k];
+          lineTangents[3*(numberOfPoints-1)+k] = lineTangents[3*(numberOfPoints-2)+k];
+          lineNormals[3*(numberOfPoints-1)+k] = lineNormals[3*(numberOfPoints-2)+k];
+          lineBinormals[3*(numberOfPoints-1)+k] = lineBinormals[3*(numberOfPoints-2)+k];
+          }
+        }
+
+      double endToEnd[3];
+      endToEnd[0] = x[numberOfPoints-1] - x[0];
+      endToEnd[1] = y[numberOfPoints-1] - y[0];
+      endToEnd[2] = z[numberOfPoints-1] - z[0];
+
+      this->Lengths[i] = length;
+      this->Tortuosities[i] = length / vtkMath::Norm(endToEnd) - 1.0;
+      }
+  }
+
+  void Reduce()
+  {
+  }
+
+private:
+  vtkPolyData* Lines;
+  const vtkIdType* LineOffsets;
+  int LineSmoothing;
+  int NumberOfSmoothingIterations;
+  double SmoothingFactor;
+  double* LinePoints;
+  double* Curvatures;
+  double* Torsions;
+  double* Tangents;
+  double* Normals;
+  double* Binormals;
+  double* Lengths;
+  double* Tortuosities;
+  vtkSMPThreadLocal<std::vector<double> > LocalBuffer;
+};
+
 vtkvmtkCenterlineGeometry::vtkvmtkCenterlineGeometry()
 {
   this->LengthArrayName = NULL;
@@ -222,76 +436,69 @@ int vtkvmtkCenterlineGeometry::RequestData(
 
   output->GetPointData()->AddArray(frenetBinormalArray);
  
-  for (int i=0; i<input->GetNumberOfCells(); i++)
+  // lines are computed in parallel into contiguous buffers and then
+  // scattered to the output in cell order, so that points shared by lines
+  // take the values of the last line as when computed one line at a time
+  std::vector<vtkIdType> lineOffsets(numberOfInputCells+1);
+  lineOffsets[0] = 0;
+  vtkIdType npts, *pts;
+  for (int i=0; i<numberOfInputCells; i++)
     {
-    vtkCell* line = input->GetCell(i);
-    if (line->GetCellType() != VTK_LINE && line->GetCellType() != VTK_POLY_LINE)
+    int cellType = output->GetCellType(i);
+    lineOffsets[i+1] = lineOffsets[i];
+    if (cellType != VTK_LINE && cellType != VTK_POLY_LINE)
       {
       continue;
       }
+    output->GetCellPoints(i,npts,pts);
+    lineOffsets[i+1] += npts;
+    }
 
-    vtkDoubleArray* lineCurvatureArray = vtkDoubleArray::New();
-    vtkDoubleArray* lineTorsionArray = vtkDoubleArray::New();
-    vtkDoubleArray* lineTangentArray = vtkDoubleArray::New();
-    vtkDoubleArray* lineNormalArray = vtkDoubleArray::New();
-    vtkDoubleArray* lineBinormalArray = vtkDoubleArray::New();
- 
-    vtkPoints* linePoints = vtkPoints::New();
-    linePoints->DeepCopy(line->GetPoints());
-    
-    if (this->LineSmoothing)
-      {
-      vtkPoints* smoothLinePoints = vtkPoints::New();
-      vtkvmtkCenterlineSmoothing::SmoothLine(linePoints,smoothLinePoints,this->NumberOfSmoothingIterations,this->SmoothingFactor);
-      linePoints->DeepCopy(smoothLinePoints);
-      smoothLinePoints->Delete();
-      }
-   
-    this->ComputeLineCurvature(linePoints,lineCurvatureArray);
-    this->ComputeLineTorsion(linePoints,lineTorsionArray);
-    this->ComputeLineFrenetReferenceSystem(linePoints,lineTangentArray,lineNormalArray,lineBinormalArray);
-    
-    int numberOfLinePoints = linePoints->GetNumberOfPoints();
-
-    double length = 0.0;
-    double point0[3], point1[3];
-    for (int j=0; j<numberOfLinePoints; j++)
+  vtkIdType numberOfLinePoints = lineOffsets[numberOfInputCells];
+  if (numberOfLinePoints > 0)
+    {
+    std::vector<double> linePoints(3*numberOfLinePoints);
+    std::vector<double> lineCurvatures(numberOfLinePoints);
+    std::vector<double> lineTorsions(numberOfLinePoints);
+    std::vector<double> lineTangents(3*numberOfLinePoints);
+    std::vector<double> lineNormals(3*numberOfLinePoints);
+    std::vector<double> lineBinormals(3*numberOfLinePoints);
+
+    vtkvmtkCenterlineGeometryLineFunctor functor(output,&lineOffsets[0],this->LineSmoothing,this->NumberOfSmoothingIterations,this->SmoothingFactor,&linePoints[0],&lineCurvatures[0],&lineTorsions[0],&lineTangents[0],&lineNormals[0],&lineBinormals[0],lengthArray->GetPointer(0),tortuosityArray->GetPointer(0));
+    vtkSMPTools::For(0,numberOfInputCells,functor);
+
+    vtkPoints* outputPoints = output->GetPoints();
+    double* curvatures = curvatureArray->GetPointer(0);
+    double* torsions = torsionArray->GetPointer(0);
+    double* tangents = frenetTangentArray->GetPointer(0);
+    double* normals = frenetNormalArray->GetPointer(0);
+    double* binormals = frenetBinormalArray->GetPointer(0);
+    for (int i=0; i<numberOfInputCells; i++)
       {
-      vtkIdType pointId = line->GetPointId(j);
-      if (this->OutputSmoothedLines)
+      vtkIdType offset = lineOffsets[i];
+      if (lineOffsets[i+1] == offset)
         {
-        output->GetPoints()->SetPoint(pointId,linePoints->GetPoint(j));
+        continue;
         }
-      if (j>0)
+      output->GetCellPoints(i,npts,pts);
+      for (int j=0; j<npts; j++)
         {
-        linePoints->GetPoint(j-1,point0);
-        linePoints->GetPoint(j,point1);
-        length += sqrt(vtkMath::Distance2BetweenPoints(point0,point1));
+        vtkIdType pointId = pts[j];
+        vtkIdType linePointId = offset + j;
+        if (this->OutputSmoothedLines)
+          {
+          outputPoints->SetPoint(pointId,&linePoints[3*linePointId]);
+          }
+        curvatures[pointId] = lineCurvatures[linePointId];
+        torsions[pointId] = lineTorsions[linePointId];
+        for (int k=0; k<3; k++)
+          {
+          tangents[3*pointId+k] = lineTangents[3*linePointId+k];
+          normals[3*pointId+k] = lineNormals[3*linePointId+k];
+          binormals[3*pointId+k] = lineBinormals[3*linePointId+k];
+          }
         }
-      curvatureArray->SetComponent(pointId,0,lineCurvatureArray->GetComponent(j,0));
-      torsionArray->SetComponent(pointId,0,lineTorsionArray->GetComponent(j,0));
-      double tuple[3];
-      lineTangentArray->GetTuple(j,tuple);
-      frenetTangentArray->SetTuple(pointId,tuple);
-      lineNormalArray->GetTuple(j,tuple);
-      frenetNormalArray->SetTuple(pointId,tuple);
-      lineBinormalArray->GetTuple(j,tuple);
-      frenetBinormalArray->SetTuple(pointId,tuple);
       }
-
-    linePoints->GetPoint(0,point0);
-    linePoints->GetPoint(numberOfLinePoints-1,point1);
-    double tortuosity = length / sqrt(vtkMath::Distance2BetweenPoints(point0,point1)) - 1.0;
-
-    lengthArray->SetComponent(i,0,length);
-    tortuosityArray->SetComponent(i,0,tortuosity);
-
-    lineCurvatureArray->Delete();
-    lineTorsionArray->Delete();
-    linePoints->Delete();
-    lineTangentArray->Delete();
-    lineNormalArray->Delete();
-    lineBinormalArray->Delete();
     }
 
   lengthArray->Delete();
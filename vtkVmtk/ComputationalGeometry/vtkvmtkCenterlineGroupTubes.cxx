@@ -0,0 +1,552 @@
+/*=========================================================================
+
+Program:   VMTK
+Module:    $RCSfile: vtkvmtkCenterlineGroupTubes.cxx,v $
+Language:  C++
+Date:      $Date: 2006/04/06 16:46:43 $
+Version:   $Revision: 1.4 $
+
+  Copyright (c) Luca Antiga, David Steinman. All rights reserved.
+  See LICENCE file for details.
+
+  Portions of this code are covered under the VTK copyright.
+  See VTKCopyright.txt or http://www.kitware.com/VTKCopyright.htm
+  for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+
+#include "vtkvmtkCenterlineGroupTubes.h"
+#include "vtkvmtkConstants.h"
+#include "vtkvmtkPolyBallSegmentHierarchy.h"
+#include "vtkPointData.h"
+#include "vtkCellData.h"
+#include "vtkDataSet.h"
+#include "vtkDoubleArray.h"
+#include "vtkMath.h"
+#include "vtkObjectFactory.h"
+#include "vtkSMPTools.h"
+
+#include <algorithm>
+
+
+vtkStandardNewMacro(vtkvmtkCenterlineGroupTubes);
+
+vtkvmtkCenterlineGroupTubes::vtkvmtkCenterlineGroupTubes()
+{
+  this->Centerlines = NULL;
+  this->CenterlineGroupIdsArrayName = NULL;
+  this->CenterlineRadiusArrayName = NULL;
+  this->BlankingArrayName = NULL;
+  this->UseRadiusInformation = 1;
+  this->CutoffRadiusFactor = VTK_VMTK_LARGE_DOUBLE;
+  this->ClipValue = 0.0;
+}
+
+vtkvmtkCenterlineGroupTubes::~vtkvmtkCenterlineGroupTubes()
+{
+  if (this->Centerlines)
+    {
+    this->Centerlines->Delete();
+    this->Centerlines = NULL;
+    }
+
+  if (this->CenterlineGroupIdsArrayName)
+    {
+    delete[] this->CenterlineGroupIdsArrayName;
+    this->CenterlineGroupIdsArrayName = NULL;
+    }
+
+  if (this->CenterlineRadiusArrayName)
+    {
+    delete[] this->CenterlineRadiusArrayName;
+    this->CenterlineRadiusArrayName = NULL;
+    }
+
+  if (this->BlankingArrayName)
+    {
+    delete[] this->BlankingArrayName;
+    this->BlankingArrayName = NULL;
+    }
+}
+
+double vtkvmtkCenterlineGroupTubes::CutGroupTubeValue(double value)
+{
+  if (value > this->CutoffRadiusFactor * this->CutoffRadiusFactor - 1)
+    {
+    return VTK_VMTK_LARGE_DOUBLE;
+    }
+  return value;
+}
+
+static void vtkvmtkCenterlineGroupTubesInsert(double value, vtkIdType groupId, double values[2], vtkIdType groupIds[2])
+{
+  if (groupId == groupIds[0])
+    {
+    if (value < values[0])
+      {
+      values[0] = value;
+      }
+    return;
+    }
+  if (groupId == groupIds[1])
+    {
+    if (value < values[1])
+      {
+      values[1] = value;
+      if (values[1] < values[0])
+        {
+        std::swap(values[0],values[1]);
+        std::swap(groupIds[0],groupIds[1]);
+        }
+      }
+    return;
+    }
+  if (value < values[0])
+    {
+    values[1] = values[0];
+    groupIds[1] = groupIds[0];
+    values[0] = value;
+    groupIds[0] = groupId;
+    }
+  else if (value < values[1])
+    {
+    values[1] = value;
+    groupIds[1] = groupId;
+    }
+}
+
+int vtkvmtkCenterlineGroupTubes::Build()
+{
+  this->NodeBounds.clear();
+  this->NodeMaxRadius.clear();
+  this->NodeFirst.clear();
+  this->NodeCount.clear();
+  this->Segments.clear();
+  this->SegmentGroupIds.clear();
+
+  if (!this->Centerlines)
+    {
+    vtkErrorMacro(<< "Centerlines not set.");
+    return 0;
+    }
+
+  if (!this->CenterlineGroupIdsArrayName)
+    {
+    vtkErrorMacro(<< "CenterlineGroupIdsArrayName not set.");
+    return 0;
+    }
+
+  vtkDataArray* centerlineGroupIdsArray = this->Centerlines->GetCellData()->GetArray(this->CenterlineGroupIdsArrayName);
+
+  if (!centerlineGroupIdsArray)
+    {
+    vtkErrorMacro(<< "CenterlineGroupIdsArray with name specified does not exist");
+    return 0;
+    }
+
+  vtkDataArray* blankingArray = NULL;
+  if (this->BlankingArrayName)
+    {
+    blankingArray = this->Centerlines->GetCellData()->GetArray(this->BlankingArrayName);
+    if (!blankingArray)
+      {
+      vtkErrorMacro(<< "BlankingArray with name specified does not exist");
+      return 0;
+      }
+    }
+
+  vtkDataArray* radiusArray = NULL;
+  if (this->UseRadiusInformation)
+    {
+    if (!this->CenterlineRadiusArrayName)
+      {
+      vtkErrorMacro(<< "CenterlineRadiusArrayName not set.");
+      return 0;
+      }
+    radiusArray = this->Centerlines->GetPointData()->GetArray(this->CenterlineRadiusArrayName);
+    if (!radiusArray)
+      {
+      vtkErrorMacro(<< "CenterlineRadiusArray with name specified does not exist");
+      return 0;
+      }
+    }
+
+  this->Centerlines->BuildCells();
+
+  std::vector<double> segments;
+  std::vector<vtkIdType> segmentGroupIds;
+  vtkIdType npts, *pts;
+  vtkIdType i;
+  for (i=0; i<this->Centerlines->GetNumberOfCells(); i++)
+    {
+    if (blankingArray && vtkMath::Round(blankingArray->GetComponent(i,0)) == 1)
+      {
+      continue;
+      }
+    if (this->Centerlines->GetCellType(i) != VTK_LINE && this->Centerlines->GetCellType(i) != VTK_POLY_LINE)
+      {
+      continue;
+      }
+    vtkIdType groupId = static_cast<vtkIdType>(vtkMath::Round(centerlineGroupIdsArray->GetComponent(i,0)));
+    this->Centerlines->GetCellPoints(i,npts,pts);
+    for (vtkIdType j=0; j<npts-1; j++)
+      {
+      double segment[8];
+      this->Centerlines->GetPoint(pts[j],segment);
+      this->Centerlines->GetPoint(pts[j+1],segment+3);
+      segment[6] = radiusArray ? radiusArray->GetComponent(pts[j],0) : 0.0;
+      segment[7] = radiusArray ? radiusArray->GetComponent(pts[j+1],0) : 0.0;
+      segments.insert(segments.end(),segment,segment+8);
+      segmentGroupIds.push_back(groupId);
+      }
+    }
+
+  vtkIdType numberOfSegments = static_cast<vtkIdType>(segmentGroupIds.size());
+
+  // hierarchy of the segments, which are then stored in leaf order
+  std::vector<vtkIdType> order(numberOfSegments);
+  for (i=0; i<numberOfSegments; i++)
+    {
+    order[i] = i;
+    }
+
+  if (numberOfSegments > 0)
+    {
+    vtkvmtkPolyBallSegmentHierarchy::Build(&segments[0],&order[0],0,numberOfSegments,this->NodeBounds,this->NodeMaxRadius,this->NodeFirst,this->NodeCount);
+    }
+
+  this->Segments.resize(8*numberOfSegments);
+  this->SegmentGroupIds.resize(numberOfSegments);
+  for (i=0; i<numberOfSegments; i++)
+    {
+    std::copy(&segments[8*order[i]],&segments[8*order[i]]+8,&this->Segments[8*i]);
+    this->SegmentGroupIds[i] = segmentGroupIds[order[i]];
+    }
+
+  return 1;
+}
+
+void vtkvmtkCenterlineGroupTubes::EvaluateBestTubes(const double x[3], double values[2], vtkIdType groupIds[2])
+{
+  values[0] = values[1] = VTK_VMTK_LARGE_DOUBLE;
+  groupIds[0] = groupIds[1] = -1;
+
+  if (this->NodeFirst.empty())
+    {
+    return;
+    }
+
+  vtkIdType stack[vtkvmtkPolyBallSegmentHierarchy::StackSize];
+  double stackBounds[vtkvmtkPolyBallSegmentHierarchy::StackSize];
+  int stackSize = 0;
+  stack[stackSize] = 0;
+  stackBounds[stackSize++] = -VTK_DOUBLE_MAX;
+  while (stackSize > 0)
+    {
+    stackSize--;
+    vtkIdType node = stack[stackSize];
+    // nothing below the second best can change either of the two
+    if (stackBounds[stackSize] >= values[1])
+      {
+      continue;
+      }
+    if (this->NodeCount[node] < 0)
+      {
+      vtkIdType first = this->NodeFirst[node];
+      vtkIdType last = first - this->NodeCount[node];
+      for (vtkIdType s=first; s<last; s++)
+        {
+        double value, t, closestPoint[4];
+        if (!vtkvmtkPolyBallSegmentHierarchy::SegmentValue(x,&this->Segments[8*s],value,t,closestPoint))
+          {
+          continue;
+          }
+        vtkvmtkCenterlineGroupTubesInsert(value,this->SegmentGroupIds[s],values,groupIds);
+        }
+      continue;
+      }
+    vtkIdType child = this->NodeFirst[node];
+    double bound0 = vtkvmtkPolyBallSegmentHierarchy::LowerBound(x,&this->NodeBounds[6*child],this->NodeMaxRadius[child]);
+    double bound1 = vtkvmtkPolyBallSegmentHierarchy::LowerBound(x,&this->NodeBounds[6*(child+1)],this->NodeMaxRadius[child+1]);
+    // visit the more promising child first
+    if (bound0 < bound1)
+      {
+      stack[stackSize] = child+1;
+      stackBounds[stackSize++] = bound1;
+      stack[stackSize] = child;
+      stackBounds[stackSize++] = bound0;
+      }
+    else
+      {
+      stack[stackSize] = child;
+      stackBounds[stackSize++] = bound0;
+      stack[stackSize] = child+1;
+      stackBounds[stackSize++] = bound1;
+      }
+    }
+}
+
+double vtkvmtkCenterlineGroupTubes::EvaluateGroupTube(const double x[3], vtkIdType groupId)
+{
+  double minValue = VTK_VMTK_LARGE_DOUBLE;
+
+  if (this->NodeFirst.empty())
+    {
+    return minValue;
+    }
+
+  vtkIdType stack[vtkvmtkPolyBallSegmentHierarchy::StackSize];
+  double stackBounds[vtkvmtkPolyBallSegmentHierarchy::StackSize];
+  int stackSize = 0;
+  stack[stackSize] = 0;
+  stackBounds[stackSize++] = -VTK_DOUBLE_MAX;
+  while (stackSize > 0)
+    {
+    stackSize--;
+    vtkIdType node = stack[stackSize];
+    if (stackBounds[stackSize] >= minValue)
+      {
+      continue;
+      }
+    if (this->NodeCount[node] < 0)
+      {
+      vtkIdType first = this->NodeFirst[node];
+      vtkIdType last = first - this->NodeCount[node];
+      for (vtkIdType s=first; s<last; s++)
+        {
+        if (this->SegmentGroupIds[s] != groupId)
+          {
+          continue;
+          }
+        double value, t, closestPoint[4];
+        if (!vtkvmtkPolyBallSegmentHierarchy::SegmentValue(x,&this->Segments[8*s],value,t,closestPoint))
+          {
+          continue;
+          }
+        if (value < minValue)
+          {
+          minValue = value;
+          }
+        }
+      continue;
+      }
+    vtkIdType child = this->NodeFirst[node];
+    double bound0 = vtkvmtkPolyBallSegmentHierarchy::LowerBound(x,&this->NodeBounds[6*child],this->NodeMaxRadius[child]);
+    double bound1 = vtkvmtkPolyBallSegmentHierarchy::LowerBound(x,&this->NodeBounds[6*(child+1)],this->NodeMaxRadius[child+1]);
+    if (bound0 < bound1)
+      {
+      stack[stackSize] = child+1;
+      stackBounds[stackSize++] = bound1;
+      stack[stackSize] = child;
+      stackBounds[stackSize++] = bound0;
+      }
+    else
+      {
+      stack[stackSize] = child;
+      stackBounds[stackSize++] = bound0;
+      stack[stackSize] = child+1;
+      stackBounds[stackSize++] = bound1;
+      }
+    }
+
+  return minValue;
+}
+
+class vtkvmtkCenterlineGroupTubesBestFunctor
+{
+public:
+  vtkvmtkCenterlineGroupTubesBestFunctor(vtkvmtkCenterlineGroupTubes* tubes, vtkDataSet* dataSet, double* bestValues, vtkIdType* bestGroupIds) :
+    Tubes(tubes), DataSet(dataSet), BestValues(bestValues), BestGroupIds(bestGroupIds) {}
+
+  void operator()(vtkIdType begin, vtkIdType end)
+  {
+    double point[3];
+    for (vtkIdType i=begin; i<end; i++)
+      {
+      this->DataSet->GetPoint(i,point);
+      this->Tubes->EvaluateBestTubes(point,this->BestValues+2*i,this->BestGroupIds+2*i);
+      }
+  }
+
+private:
+  vtkvmtkCenterlineGroupTubes* Tubes;
+  vtkDataSet* DataSet;
+  double* BestValues;
+  vtkIdType* BestGroupIds;
+};
+
+void vtkvmtkCenterlineGroupTubes::ComputeBestTubes(vtkDataSet* dataSet)
+{
+  vtkIdType numberOfPoints = dataSet->GetNumberOfPoints();
+  vtkIdType numberOfCells = dataSet->GetNumberOfCells();
+
+  this->BestValues.resize(2*numberOfPoints);
+  this->BestGroupIds.resize(2*numberOfPoints);
+  this->GroupCellIds.clear();
+
+  if (numberOfPoints == 0)
+    {
+    return;
+    }
+
+  // make GetPoint thread safe
+  double point[3];
+  dataSet->GetPoint(0,point);
+
+  vtkvmtkCenterlineGroupTubesBestFunctor bestFunctor(this,dataSet,&this->BestValues[0],&this->BestGroupIds[0]);
+  vtkSMPTools::For(0,numberOfPoints,bestFunctor);
+
+  // a cell may only be clipped for the groups reaching ClipValue at one of
+  // its points, which are among the two best tubes there
+  vtkIdList* pointIds = vtkIdList::New();
+  std::vector<vtkIdType> cellGroupIds;
+  for (vtkIdType c=0; c<numberOfCells; c++)
+    {
+    dataSet->GetCellPoints(c,pointIds);
+    cellGroupIds.clear();
+    for (vtkIdType j=0; j<pointIds->GetNumberOfIds(); j++)
+      {
+      vtkIdType pointId = pointIds->GetId(j);
+      const double* values = &this->BestValues[2*pointId];
+      const vtkIdType* groupIds = &this->BestGroupIds[2*pointId];
+      if (groupIds[0] != -1 && values[1] - this->CutGroupTubeValue(values[0]) >= this->ClipValue)
+        {
+        cellGroupIds.push_back(groupIds[0]);
+        }
+      if (groupIds[1] != -1 && values[0] - this->CutGroupTubeValue(values[1]) >= this->ClipValue)
+        {
+        cellGroupIds.push_back(groupIds[1]);
+        }
+      }
+    std::sort(cellGroupIds.begin(),cellGroupIds.end());
+    cellGroupIds.erase(std::unique(cellGroupIds.begin(),cellGroupIds.end()),cellGroupIds.end());
+    for (size_t k=0; k<cellGroupIds.size(); k++)
+      {
+      this->GroupCellIds[cellGroupIds[k]].push_back(c);
+      }
+    }
+  pointIds->Delete();
+}
+
+void vtkvmtkCenterlineGroupTubes::GetGroupCellIds(vtkIdType groupId, vtkIdList* cellIds)
+{
+  cellIds->Initialize();
+  std::map<vtkIdType,std::vector<vtkIdType> >::const_iterator it = this->GroupCellIds.find(groupId);
+  if (it == this->GroupCellIds.end())
+    {
+    return;
+    }
+  cellIds->SetNumberOfIds(static_cast<vtkIdType>(it->second.size()));
+  for (size_t k=0; k<it->second.size(); k++)
+    {
+    cellIds->SetId(static_cast<vtkIdType>(k),it->second[k]);
+    }
+}
+
+class vtkvmtkCenterlineGroupTubesClippingFunctor
+{
+public:
+  vtkvmtkCenterlineGroupTubesClippingFunctor(vtkvmtkCenterlineGroupTubes* tubes, vtkDataSet* dataSet, vtkIdType groupId, double cutoffValue, const double* bestValues, const vtkIdType* bestGroupIds, const vtkIdType* exactPointIds, double* clippingValues) :
+    Tubes(tubes), DataSet(dataSet), GroupId(groupId), CutoffValue(cutoffValue), BestValues(bestValues), BestGroupIds(bestGroupIds), ExactPointIds(exactPointIds), ClippingValues(clippingValues) {}
+
+  double Cut(double value)
+  {
+    return value > this->CutoffValue ? VTK_VMTK_LARGE_DOUBLE : value;
+  }
+
+  // without exact point ids, fills all points from the best tubes; with
+  // them, evaluates the group tube at the listed points
+  void operator()(vtkIdType begin, vtkIdType end)
+  {
+    double point[3];
+    for (vtkIdType k=begin; k<end; k++)
+      {
+      vtkIdType i = this->ExactPointIds ? this->ExactPointIds[k] : k;
+      const double* values = this->BestValues + 2*i;
+      const vtkIdType* groupIds = this->BestGroupIds + 2*i;
+      if (this->ExactPointIds)
+        {
+        this->DataSet->GetPoint(i,point);
+        this->ClippingValues[i] = values[0] - this->Cut(this->Tubes->EvaluateGroupTube(point,this->GroupId));
+        }
+      else if (groupIds[0] == this->GroupId)
+        {
+        this->ClippingValues[i] = values[1] - this->Cut(values[0]);
+        }
+      else
+        {
+        // exact if the group is second, an upper bound otherwise
+        this->ClippingValues[i] = values[0] - this->Cut(values[1]);
+        }
+      }
+  }
+
+private:
+  vtkvmtkCenterlineGroupTubes* Tubes;
+  vtkDataSet* DataSet;
+  vtkIdType GroupId;
+  double CutoffValue;
+  const double* BestValues;
+  const vtkIdType* BestGroupIds;
+  const vtkIdType* ExactPointIds;
+  double* ClippingValues;
+};
+
+void vtkvmtkCenterlineGroupTubes::ComputeGroupClippingArray(vtkDataSet* dataSet, vtkIdType groupId, vtkDoubleArray* clippingArray)
+{
+  vtkIdType numberOfPoints = dataSet->GetNumberOfPoints();
+  if (numberOfPoints == 0 || static_cast<vtkIdType>(this->BestValues.size()) != 2*numberOfPoints)
+    {
+    return;
+    }
+
+  double cutoffValue = this->CutoffRadiusFactor * this->CutoffRadiusFactor - 1;
+  double* clippingValues = clippingArray->GetPointer(0);
+
+  vtkvmtkCenterlineGroupTubesClippingFunctor bestFunctor(this,dataSet,groupId,cutoffValue,&this->BestValues[0],&this->BestGroupIds[0],NULL,clippingValues);
+  vtkSMPTools::For(0,numberOfPoints,bestFunctor);
+
+  // points of the cells that may be clipped where the group is not among
+  // the two best tubes
+  std::vector<vtkIdType> exactPointIds;
+  std::map<vtkIdType,std::vector<vtkIdType> >::const_iterator it = this->GroupCellIds.find(groupId);
+  if (it == this->GroupCellIds.end())
+    {
+    return;
+    }
+  std::vector<char> visited(numberOfPoints,0);
+  vtkIdList* pointIds = vtkIdList::New();
+  for (size_t k=0; k<it->second.size(); k++)
+    {
+    dataSet->GetCellPoints(it->second[k],pointIds);
+    for (vtkIdType j=0; j<pointIds->GetNumberOfIds(); j++)
+      {
+      vtkIdType pointId = pointIds->GetId(j);
+      if (visited[pointId])
+        {
+        continue;
+        }
+      visited[pointId] = 1;
+      if (this->BestGroupIds[2*pointId] != groupId && this->BestGroupIds[2*pointId+1] != groupId)
+        {
+        exactPointIds.push_back(pointId);
+        }
+      }
+    }
+  pointIds->Delete();
+
+  if (!exactPointIds.empty())
+    {
+    vtkvmtkCenterlineGroupTubesClippingFunctor exactFunctor(this,dataSet,groupId,cutoffValue,&this->BestValues[0],&this->BestGroupIds[0],&exactPointIds[0],clippingValues);
+    vtkSMPTools::For(0,static_cast<vtkIdType>(exactPointIds.size()),exactFunctor);
+    }
+}
+
+void vtkvmtkCenterlineGroupTubes::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os,indent);
+}
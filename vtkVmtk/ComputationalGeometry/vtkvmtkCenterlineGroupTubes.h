@@ -0,0 +1,147 @@
+/*=========================================================================
+
+Program:   VMTK
+Module:    $RCSfile: vtkvmtkCenterlineGroupTubes.h,v $
+Language:  C++
+Date:      $Date: 2006/04/06 16:46:43 $
+Version:   $Revision: 1.4 $
+
+  Copyright (c) Luca Antiga, David Steinman. All rights reserved.
+  See LICENCE file for details.
+
+  Portions of this code are covered under the VTK copyright.
+  See VTKCopyright.txt or http://www.kitware.com/VTKCopyright.htm
+  for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+  // .NAME vtkvmtkCenterlineGroupTubes - Nearest group tubes of a set of points, used to clip a surface or a mesh into centerline groups in one pass.
+  // .SECTION Description
+  // The tube function of a group is the vtkvmtkPolyBallLine function of
+  // the non-blanked centerline cells of the group. Centerline segments are
+  // kept in a bounding volume hierarchy, so that the smallest and second
+  // smallest tube function values over distinct groups, with their group
+  // ids, can be found for a point without visiting every segment.
+  //
+  // ComputeBestTubes evaluates them, in parallel, at all points of a
+  // dataset. The clipping array of a group (the tube function of all other
+  // groups minus the one of the group, as computed by
+  // vtkvmtkPolyDataCenterlineGroupsClipper) then follows from them at
+  // every point where the group is one of the two nearest. Elsewhere it is
+  // not larger than zero, and it is only evaluated exactly at the points of
+  // the cells that may be clipped for the group, i.e. having a point where
+  // the clipping array is not smaller than ClipValue (which must be
+  // non-negative). Other points get the upper bound.
+
+#ifndef __vtkvmtkCenterlineGroupTubes_h
+#define __vtkvmtkCenterlineGroupTubes_h
+
+#include "vtkObject.h"
+#include "vtkPolyData.h"
+#include "vtkIdList.h"
+#include "vtkvmtkWin32Header.h"
+
+#include <map>
+#include <vector>
+
+class vtkDataSet;
+class vtkDoubleArray;
+
+class VTK_VMTK_COMPUTATIONAL_GEOMETRY_EXPORT vtkvmtkCenterlineGroupTubes : public vtkObject
+{
+  public:
+  vtkTypeMacro(vtkvmtkCenterlineGroupTubes,vtkObject);
+  void PrintSelf(ostream& os, vtkIndent indent) VTK_OVERRIDE;
+
+  static vtkvmtkCenterlineGroupTubes *New();
+
+  vtkSetObjectMacro(Centerlines,vtkPolyData);
+  vtkGetObjectMacro(Centerlines,vtkPolyData);
+
+  vtkSetStringMacro(CenterlineGroupIdsArrayName);
+  vtkGetStringMacro(CenterlineGroupIdsArrayName);
+
+  vtkSetStringMacro(CenterlineRadiusArrayName);
+  vtkGetStringMacro(CenterlineRadiusArrayName);
+
+  vtkSetStringMacro(BlankingArrayName);
+  vtkGetStringMacro(BlankingArrayName);
+
+  vtkSetMacro(UseRadiusInformation,int);
+  vtkGetMacro(UseRadiusInformation,int);
+  vtkBooleanMacro(UseRadiusInformation,int);
+
+  // Description:
+  // Group tube function values larger than CutoffRadiusFactor^2 - 1 are
+  // replaced by VTK_VMTK_LARGE_DOUBLE in the clipping arrays.
+  vtkSetMacro(CutoffRadiusFactor,double);
+  vtkGetMacro(CutoffRadiusFactor,double);
+
+  vtkSetMacro(ClipValue,double);
+  vtkGetMacro(ClipValue,double);
+
+  // Description:
+  // Builds the segment hierarchy. Returns 0 if the arrays are missing.
+  int Build();
+
+  // Description:
+  // Thread safe queries, after Build. Best tubes of a point: smallest and
+  // second smallest tube function values over distinct groups, with the
+  // group ids (-1, and VTK_VMTK_LARGE_DOUBLE, if none).
+  void EvaluateBestTubes(const double x[3], double values[2], vtkIdType groupIds[2]);
+  double EvaluateGroupTube(const double x[3], vtkIdType groupId);
+
+  // Description:
+  // Evaluates the best tubes at all points of dataSet and collects, for
+  // each group, the cells that may be clipped for it.
+  void ComputeBestTubes(vtkDataSet* dataSet);
+
+  // Description:
+  // Cells of the dataset passed to ComputeBestTubes that may be clipped for
+  // groupId.
+  void GetGroupCellIds(vtkIdType groupId, vtkIdList* cellIds);
+
+  // Description:
+  // Fills clippingArray (one component, one tuple per point) with the
+  // clipping array of groupId.
+  void ComputeGroupClippingArray(vtkDataSet* dataSet, vtkIdType groupId, vtkDoubleArray* clippingArray);
+
+  protected:
+  vtkvmtkCenterlineGroupTubes();
+  ~vtkvmtkCenterlineGroupTubes();
+
+  double CutGroupTubeValue(double value);
+
+  vtkPolyData* Centerlines;
+  char* CenterlineGroupIdsArrayName;
+  char* CenterlineRadiusArrayName;
+  char* BlankingArrayName;
+  int UseRadiusInformation;
+  double CutoffRadiusFactor;
+  double ClipValue;
+
+  // hierarchy: node bounds and largest radius, children (or first segment
+  // for leaves, with a negative count); segments in leaf order as end
+  // points and radii (8 values) with their group ids
+  std::vector<double> NodeBounds;
+  std::vector<double> NodeMaxRadius;
+  std::vector<vtkIdType> NodeFirst;
+  std::vector<vtkIdType> NodeCount;
+  std::vector<double> Segments;
+  std::vector<vtkIdType> SegmentGroupIds;
+
+  // best tubes per point of the last ComputeBestTubes, and cells that may
+  // be clipped per group
+  std::vector<double> BestValues;
+  std::vector<vtkIdType> BestGroupIds;
+  std::map<vtkIdType,std::vector<vtkIdType> > GroupCellIds;
+
+  private:
+  vtkvmtkCenterlineGroupTubes(const vtkvmtkCenterlineGroupTubes&);  // Not implemented.
+  void operator=(const vtkvmtkCenterlineGroupTubes&);  // Not implemented.
+};
+
+#endif
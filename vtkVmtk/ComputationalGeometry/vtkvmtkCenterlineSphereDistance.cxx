@@ -75,9 +75,11 @@ void vtkvmtkCenterlineSphereDistance::FindTouchingSphereCenter(vtkPolyData* cent
   touchingSubId = -1;
   touchingPCoord = 0.0;
 
-  vtkCell* centerline = centerlines->GetCell(cellId);
-  
-  if (centerline->GetCellType() != VTK_LINE && centerline->GetCellType() != VTK_POLY_LINE)
+  // cell points are accessed through the cell links rather than GetCell,
+  // so that the function can be called concurrently on built centerlines
+  int cellType = centerlines->GetCellType(cellId);
+
+  if (cellType != VTK_LINE && cellType != VTK_POLY_LINE)
     {
     return;
     }
@@ -94,6 +96,9 @@ void vtkvmtkCenterlineSphereDistance::FindTouchingSphereCenter(vtkPolyData* cent
     return;
     }
 
+  vtkIdType npts, *pts;
+  centerlines->GetCellPoints(cellId,npts,pts);
+
   vtkIdList* subIds = vtkIdList::New();
 
   int k;
@@ -106,15 +111,15 @@ void vtkvmtkCenterlineSphereDistance::FindTouchingSphereCenter(vtkPolyData* cent
     }
   else
     {
-    for (k=centerline->GetNumberOfPoints()-2; k>subId; k--)
+    for (k=npts-2; k>subId; k--)
       {
       subIds->InsertNextId(k);
       }
     }
 
   double point[3], point0[3], point1[3];
-  centerline->GetPoints()->GetPoint(subId,point0);
-  centerline->GetPoints()->GetPoint(subId+1,point1);
+  centerlines->GetPoint(pts[subId],point0);
+  centerlines->GetPoint(pts[subId+1],point1);
   for (k=0; k<3; k++) 
     {
     point[k] = point0[k] + pcoord*(point1[k] - point0[k]);
@@ -134,8 +139,8 @@ void vtkvmtkCenterlineSphereDistance::FindTouchingSphereCenter(vtkPolyData* cent
     {
     currentSubId = subIds->GetId(i);
     
-    centerId0 = centerline->GetPointId(currentSubId);
-    centerId1 = centerline->GetPointId(currentSubId+1);
+    centerId0 = pts[currentSubId];
+    centerId1 = pts[currentSubId+1];
     centerlines->GetPoint(centerId0,center0);
     centerlines->GetPoint(centerId1,center1);
     radius0 = radiusArray->GetComponent(centerId0,0);
@@ -163,8 +168,8 @@ void vtkvmtkCenterlineSphereDistance::FindTouchingSphereCenter(vtkPolyData* cent
 
   if (touchingSubId == -1)
     {
-    centerId0 = centerline->GetPointId(subId);
-    centerId1 = centerline->GetPointId(subId+1);
+    centerId0 = pts[subId];
+    centerId1 = pts[subId+1];
     centerlines->GetPoint(centerId0,center0);
     centerlines->GetPoint(centerId1,center1);
     radius0 = radiusArray->GetComponent(centerId0,0);
@@ -176,6 +181,7 @@ void vtkvmtkCenterlineSphereDistance::FindTouchingSphereCenter(vtkPolyData* cent
     if ((sphereDistance0<=0.0) && (sphereDistance1<=0.0))
       {
       touchingSubId = -1;
+      subIds->Delete();
       return;
       }
 
@@ -186,8 +192,8 @@ void vtkvmtkCenterlineSphereDistance::FindTouchingSphereCenter(vtkPolyData* cent
 
   // linear search, step proportional to sphere radius.
 
-  centerId0 = centerline->GetPointId(touchingSubId);
-  centerId1 = centerline->GetPointId(touchingSubId+1);
+  centerId0 = pts[touchingSubId];
+  centerId1 = pts[touchingSubId+1];
   centerlines->GetPoint(centerId0,center0);
   centerlines->GetPoint(centerId1,center1);
   radius0 = radiusArray->GetComponent(centerId0,0);
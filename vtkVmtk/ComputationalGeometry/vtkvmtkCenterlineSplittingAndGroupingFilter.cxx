@@ -20,7 +20,7 @@ Version:   $Revision: 1.11 $
 =========================================================================*/
 
 #include "vtkvmtkCenterlineSplittingAndGroupingFilter.h"
-#include "vtkvmtkPolyBallLine.h"
+#include "vtkvmtkPolyBallLineLocator.h"
 #include "vtkvmtkCenterlineUtilities.h"
 #include "vtkPolyData.h"
 #include "vtkPolyLine.h"
@@ -40,6 +40,23 @@ Version:   $Revision: 1.11 $
 #include "vtkObjectFactory.h"
 #include "vtkVersion.h"
 
+#include <algorithm>
+#include <vector>
+
+
+class vtkvmtkCenterlineSplittingAndGroupingFilterTractIdCompare
+{
+public:
+  vtkvmtkCenterlineSplittingAndGroupingFilterTractIdCompare(const vtkIdType* tractIds) : TractIds(tractIds) {}
+
+  bool operator()(vtkIdType cellId0, vtkIdType cellId1) const
+  {
+    return this->TractIds[cellId0] < this->TractIds[cellId1];
+  }
+
+private:
+  const vtkIdType* TractIds;
+};
 
 vtkvmtkCenterlineSplittingAndGroupingFilter::vtkvmtkCenterlineSplittingAndGroupingFilter()
 {
@@ -163,6 +180,8 @@ int vtkvmtkCenterlineSplittingAndGroupingFilter::RequestData(
 
   vtkAppendPolyData* appendCenterlinesFilter  = vtkAppendPolyData::New();
 
+  this->InitializeCenterlineSplitting(input);
+
   for (int i=0; i<numberOfInputCells; i++)
     {
     this->ComputeCenterlineSplitting(input,i);
@@ -196,6 +215,10 @@ int vtkvmtkCenterlineSplittingAndGroupingFilter::RequestData(
   return 1;
 }
 
+void vtkvmtkCenterlineSplittingAndGroupingFilter::InitializeCenterlineSplitting(vtkPolyData* vtkNotUsed(input))
+{
+}
+
 void vtkvmtkCenterlineSplittingAndGroupingFilter::MergeTracts(vtkPolyData* centerlineTracts)
 {
   int numberOfCenterlineCells = centerlineTracts->GetNumberOfCells();
@@ -209,12 +232,35 @@ void vtkvmtkCenterlineSplittingAndGroupingFilter::MergeTracts(vtkPolyData* cente
   vtkCellArray* mergedCellArray = vtkCellArray::New();
 
   vtkIntArray* groupIdsArray = vtkIntArray::SafeDownCast(centerlineTracts->GetCellData()->GetArray(this->GroupIdsArrayName));
-  vtkIdList* centerlineCellIds = vtkIdList::New();
+  vtkDataArray* centerlineIdsArray = centerlineTracts->GetCellData()->GetArray(this->CenterlineIdsArrayName);
+  vtkDataArray* tractIdsArray = centerlineTracts->GetCellData()->GetArray(this->TractIdsArrayName);
+
+  // tracts of each centerline sorted by tract id, in one pass rather than
+  // one vtkvmtkCenterlineUtilities::GetCenterlineCellIds per centerline
+  std::vector<vtkIdType> tractIds(numberOfCenterlineCells);
+  std::vector<std::vector<vtkIdType> > centerlineTractCellIds(numberOfCenterlineCells);
   int i;
   for (i=0; i<numberOfCenterlineCells; i++)
     {
-    centerlineCellIds->Initialize();
-    vtkvmtkCenterlineUtilities::GetCenterlineCellIds(centerlineTracts,this->CenterlineIdsArrayName,this->TractIdsArrayName,i,centerlineCellIds);
+    tractIds[i] = static_cast<int>(tractIdsArray->GetComponent(i,0));
+    vtkIdType centerlineId = static_cast<int>(centerlineIdsArray->GetComponent(i,0));
+    if (centerlineId >= 0 && centerlineId < numberOfCenterlineCells)
+      {
+      centerlineTractCellIds[centerlineId].push_back(i);
+      }
+    }
+  vtkvmtkCenterlineSplittingAndGroupingFilterTractIdCompare tractIdCompare(numberOfCenterlineCells > 0 ? &tractIds[0] : NULL);
+
+  vtkIdList* centerlineCellIds = vtkIdList::New();
+  for (i=0; i<numberOfCenterlineCells; i++)
+    {
+    std::vector<vtkIdType>& cellIds = centerlineTractCellIds[i];
+    std::stable_sort(cellIds.begin(),cellIds.end(),tractIdCompare);
+    centerlineCellIds->SetNumberOfIds(static_cast<vtkIdType>(cellIds.size()));
+    for (size_t c=0; c<cellIds.size(); c++)
+      {
+      centerlineCellIds->SetId(static_cast<vtkIdType>(c),cellIds[c]);
+      }
     int numberOfCenterlineTracts = centerlineCellIds->GetNumberOfIds();
     //loop over groupids and keep track of merges (a bit redundant, but clearer)
     int j;
@@ -386,33 +432,56 @@ void vtkvmtkCenterlineSplittingAndGroupingFilter::PointInTubeGroupTracts(vtkPoly
     groupIdsArray->SetValue(i,i);
     }
 
-  vtkvmtkPolyBallLine* tube = vtkvmtkPolyBallLine::New();
+  int numberOfCenterlineCells = input->GetNumberOfCells();
+
+  // tracts of each centerline, in cell order
+  std::vector<std::vector<vtkIdType> > centerlineTractCellIds(numberOfCenterlineCells);
+  for (i=0; i<numberOfCells; i++)
+    {
+    int centerlineId = centerlineIdsArray->GetValue(i);
+    if (centerlineId >= 0 && centerlineId < numberOfCenterlineCells)
+      {
+      centerlineTractCellIds[centerlineId].push_back(i);
+      }
+    }
+
+  // tube functions of single tracts, as vtkvmtkPolyBallLine with one input
+  // cell id, evaluated through per-tract hierarchies
+  centerlineTracts->BuildCells();
+  vtkvmtkPolyBallLineLocator* tube = vtkvmtkPolyBallLineLocator::New();
   tube->SetInput(centerlineTracts);
   tube->SetPolyBallRadiusArrayName(this->RadiusArrayName);
+  tube->Build();
 
   vtkIdList* tubeCellIds = vtkIdList::New();
 
-  vtkvmtkPolyBallLine* centerlineTube = vtkvmtkPolyBallLine::New();
-  centerlineTube->SetInput(centerlineTracts);
-  centerlineTube->SetPolyBallRadiusArrayName(this->RadiusArrayName);
-
-  vtkIdList* centerlineTubeCellIds = vtkIdList::New();
-
-  int numberOfCenterlineCells = input->GetNumberOfCells();
-
   // group based on point-in-tube criterion
   for (i=0; i<numberOfCells; i++)
     {
     // for all points in the present cell, check if there's one which contains it. If yes, put current id equal to the other's group.
     // Alternative: for the first point present cell (i.e. the first reference point), check if there's one tube which contains it. If yes, put current id equal to the other's group.
-    if (centerlineTracts->GetCell(i)->GetCellType() != VTK_LINE && centerlineTracts->GetCell(i)->GetCellType() != VTK_POLY_LINE)
+    if (centerlineTracts->GetCellType(i) != VTK_LINE && centerlineTracts->GetCellType(i) != VTK_POLY_LINE)
       {
       continue;
       }
 
-    centerlineTubeCellIds->Initialize();
-    centerlineTubeCellIds->InsertNextId(i);
-    centerlineTube->SetInputCellIds(centerlineTubeCellIds);
+    vtkIdType npts, *pts;
+    centerlineTracts->GetCellPoints(i,npts,pts);
+    if (npts == 0)
+      {
+      continue;
+      }
+
+    // first point in tube criterion (divergent networks only)
+    double point[3];
+    centerlineTracts->GetPoint(pts[0],point);
+
+    // only tracts whose tube contains the point can satisfy the criterion
+    tube->FindTubeCells(point,tubeCellIds);
+    const vtkIdType* tubeCellIdsBegin = tubeCellIds->GetPointer(0);
+    const vtkIdType* tubeCellIdsEnd = tubeCellIdsBegin + tubeCellIds->GetNumberOfIds();
+
+    vtkIdType centerlineTubeCellId = i;
 
     int centerlineGroupId = groupIdsArray->GetValue(i);
     
@@ -424,23 +493,19 @@ void vtkvmtkCenterlineSplittingAndGroupingFilter::PointInTubeGroupTracts(vtkPoly
         {
         continue;
         }
+
+      const std::vector<vtkIdType>& tractCellIds = centerlineTractCellIds[k];
       
       bool centerlineTractAlreadyInGroup = false;
-      int j;
-      for (j=0; j<numberOfCells; j++)
+      size_t t;
+      for (t=0; t<tractCellIds.size(); t++)
         {
+        vtkIdType j = tractCellIds[t];
         if (j==i)
           {
           continue;
           }
 
-        int tubeCenterlineId = centerlineIdsArray->GetValue(j);
-
-        if (tubeCenterlineId != k)
-          {
-          continue;
-          }
-
         int tubeCenterlineGroupId = groupIdsArray->GetValue(j);
         if (tubeCenterlineGroupId == centerlineGroupId)
           {
@@ -455,27 +520,21 @@ void vtkvmtkCenterlineSplittingAndGroupingFilter::PointInTubeGroupTracts(vtkPoly
       
       int sameGroupTubeGroupId = -1;
 
-      for (j=0; j<numberOfCells; j++)
+      for (t=0; t<tractCellIds.size(); t++)
         {
+        vtkIdType j = tractCellIds[t];
         if (j==i)
           {
           continue;
           }
 
-        int tubeCenterlineId = centerlineIdsArray->GetValue(j);
-
-        if (tubeCenterlineId != k)
-          {
-          continue;
-          }
-
         // don't group blanked tracts with non-blanked ones and vice-versa
         if (blankingArray->GetValue(i) != blankingArray->GetValue(j))
           {
           continue;
           }
 
-        if ((centerlineTracts->GetCell(j)->GetCellType() != VTK_POLY_LINE) && (centerlineTracts->GetCell(j)->GetCellType() != VTK_LINE))
+        if ((centerlineTracts->GetCellType(j) != VTK_POLY_LINE) && (centerlineTracts->GetCellType(j) != VTK_LINE))
           {
           continue;
           }
@@ -487,32 +546,19 @@ void vtkvmtkCenterlineSplittingAndGroupingFilter::PointInTubeGroupTracts(vtkPoly
           continue;
           }
 
-        tubeCellIds->Initialize();
-        tubeCellIds->InsertNextId(j);
-        tube->SetInputCellIds(tubeCellIds);
-        bool pointInTube = false;
-        double minTubeValue = VTK_VMTK_LARGE_DOUBLE;
-        double minCenterlineTubeValue = VTK_VMTK_LARGE_DOUBLE;
-        int l;
-//        for (l=0; l<centerlineTracts->GetCell(i)->GetNumberOfPoints(); l++)  // any point in tube criterion
-        for (l=0; l<=0; l++)  // first point in tube criterion (divergent networks only)
+        if (!std::binary_search(tubeCellIdsBegin,tubeCellIdsEnd,j))
           {
-          double tubeValue = tube->EvaluateFunction(centerlineTracts->GetCell(i)->GetPoints()->GetPoint(l));
-          double centerlineTubeValue = centerlineTube->EvaluateFunction(tube->GetLastPolyBallCenter());
+          continue;
+          }
 
-          if ((tubeValue < -VTK_VMTK_DOUBLE_TOL) && (centerlineTubeValue < -VTK_VMTK_DOUBLE_TOL))
-            {
-            pointInTube = true;
-            if (tubeValue < minTubeValue)
-              {
-              minTubeValue = tubeValue;
-              }
-            if (centerlineTubeValue < minCenterlineTubeValue)
-              {
-              minCenterlineTubeValue = centerlineTubeValue;
-              sameGroupTubeGroupId = tubeGroupId;
-              }
-            }
+        vtkIdType closestCellId, closestSubId;
+        double closestPCoord, tubeCenter[3], centerlineTubeCenter[3], centerRadius;
+        double tubeValue = tube->EvaluateFunction(point,&j,1,closestCellId,closestSubId,closestPCoord,tubeCenter,centerRadius);
+        double centerlineTubeValue = tube->EvaluateFunction(tubeCenter,&centerlineTubeCellId,1,closestCellId,closestSubId,closestPCoord,centerlineTubeCenter,centerRadius);
+
+        if ((tubeValue < -VTK_VMTK_DOUBLE_TOL) && (centerlineTubeValue < -VTK_VMTK_DOUBLE_TOL))
+          {
+          sameGroupTubeGroupId = tubeGroupId;
           }
         }
 
@@ -521,7 +567,7 @@ void vtkvmtkCenterlineSplittingAndGroupingFilter::PointInTubeGroupTracts(vtkPoly
         continue;
         }
 
-      for (j=0; j<groupIdsArray->GetNumberOfTuples(); j++)
+      for (int j=0; j<groupIdsArray->GetNumberOfTuples(); j++)
         {
         if (groupIdsArray->GetValue(j) == sameGroupTubeGroupId)
           {
@@ -542,27 +588,27 @@ void vtkvmtkCenterlineSplittingAndGroupingFilter::MakeGroupIdsAdjacent(vtkPolyDa
 {
   vtkIntArray* groupIdsArray = vtkIntArray::SafeDownCast(centerlineTracts->GetCellData()->GetArray(this->GroupIdsArrayName));
 
-  int currentGroupId = 0;
-  for (int i=0; i<groupIdsArray->GetNumberOfTuples(); i++)
+  // non-negative group ids are replaced by their rank
+  std::vector<int> groupIds;
+  int i;
+  for (i=0; i<groupIdsArray->GetNumberOfTuples(); i++)
     {
-    int minGroupId = VTK_VMTK_LARGE_INTEGER;
-    int j;
-    for (j=0; j<groupIdsArray->GetNumberOfTuples(); j++)
+    if (groupIdsArray->GetValue(i) >= 0)
       {
-      int groupId = groupIdsArray->GetValue(j);
-      if ((groupId<minGroupId) && (groupId >= currentGroupId))
-        {
-        minGroupId = groupId;
-        }
+      groupIds.push_back(groupIdsArray->GetValue(i));
       }
-    for (j=0; j<groupIdsArray->GetNumberOfTuples(); j++)
+    }
+  std::sort(groupIds.begin(),groupIds.end());
+  groupIds.erase(std::unique(groupIds.begin(),groupIds.end()),groupIds.end());
+
+  for (i=0; i<groupIdsArray->GetNumberOfTuples(); i++)
+    {
+    int groupId = groupIdsArray->GetValue(i);
+    if (groupId < 0)
       {
-      if (groupIdsArray->GetValue(j)==minGroupId)
-        {
-        groupIdsArray->SetValue(j,currentGroupId);
-        }
+      continue;
       }
-    ++currentGroupId;
+    groupIdsArray->SetValue(i,static_cast<int>(std::lower_bound(groupIds.begin(),groupIds.end(),groupId) - groupIds.begin()));
     }
 }
 
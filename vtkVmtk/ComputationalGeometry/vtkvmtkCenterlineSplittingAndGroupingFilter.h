@@ -73,6 +73,11 @@ class VTK_VMTK_COMPUTATIONAL_GEOMETRY_EXPORT vtkvmtkCenterlineSplittingAndGroupi
 
   virtual int RequestData(vtkInformation *, vtkInformationVector **, vtkInformationVector *) VTK_OVERRIDE;
 
+  // Description:
+  // Called once before ComputeCenterlineSplitting is invoked on each input
+  // cell, for subclasses to compute what is shared among cells.
+  virtual void InitializeCenterlineSplitting(vtkPolyData* input);
+
   virtual void ComputeCenterlineSplitting(vtkPolyData* input, vtkIdType cellId) = 0;
 
   virtual void GroupTracts(vtkPolyData* input, vtkPolyData* centerlineTracts);
@@ -29,6 +29,8 @@ Version:   $Revision: 1.5 $
 #include "vtkvmtkConstants.h"
 #include "vtkObjectFactory.h"
 
+#include <set>
+
 
 vtkStandardNewMacro(vtkvmtkCenterlineUtilities);
 
@@ -67,6 +69,10 @@ void vtkvmtkCenterlineUtilities::GetGroupsIdList(vtkPolyData* centerlines, const
 
   groupIds->Initialize();
 
+  // ids are kept in order of first appearance, visited ones are looked up
+  // in a set instead of the list
+  std::set<vtkIdType> visitedGroupIds;
+
   int i;
   for (i=0; i<numberOfCells; i++)
     {
@@ -80,7 +86,10 @@ void vtkvmtkCenterlineUtilities::GetGroupsIdList(vtkPolyData* centerlines, const
         continue;
       }
     }
-    groupIds->InsertUniqueId(groupId);
+    if (visitedGroupIds.insert(groupId).second)
+    {
+      groupIds->InsertNextId(groupId);
+    }
     }
 }
  
@@ -120,32 +129,38 @@ void vtkvmtkCenterlineUtilities::GetGroupCellIds(vtkPolyData* centerlines, const
 
 void vtkvmtkCenterlineUtilities::GetGroupUniqueCellIds(vtkPolyData* centerlines, const char* groupIdsArrayName, vtkIdType groupId, vtkIdList* groupCellIds)
 {
-  vtkDataArray* groupIdsArray = centerlines->GetCellData()->GetArray(groupIdsArrayName);
-  int numberOfCells = centerlines->GetNumberOfCells();
+  vtkIdList* cellIds = vtkIdList::New();
+  vtkvmtkCenterlineUtilities::GetGroupCellIds(centerlines,groupIdsArrayName,groupId,cellIds);
+  vtkvmtkCenterlineUtilities::GetUniqueCellIds(centerlines,cellIds,groupCellIds);
+  cellIds->Delete();
+}
 
-  groupCellIds->Initialize();
+void vtkvmtkCenterlineUtilities::GetUniqueCellIds(vtkPolyData* centerlines, vtkIdList* cellIds, vtkIdList* uniqueCellIds)
+{
+  // cells sharing their first and last points with a previous cell are
+  // duplicates; cell points are read without GetCell, so that this can be
+  // called concurrently once the cells of centerlines are built
+  uniqueCellIds->Initialize();
 
+  int numberOfCellIds = cellIds->GetNumberOfIds();
   int i;
-  for (i=0; i<numberOfCells; i++)
+  for (i=0; i<numberOfCellIds; i++)
     {
-    vtkIdType current_groupId = static_cast<int>(groupIdsArray->GetComponent(i,0));
-    if (current_groupId != groupId)
-      {
-      continue;
-      }
-    int currentNumberOfGroupCellIds = groupCellIds->GetNumberOfIds();
+    vtkIdType npts, *pts;
+    double cellFirstPoint[3], cellLastPoint[3];
+    centerlines->GetCellPoints(cellIds->GetId(i),npts,pts);
+    centerlines->GetPoint(pts[0],cellFirstPoint);
+    centerlines->GetPoint(pts[npts-1],cellLastPoint);
+    int currentNumberOfUniqueCellIds = uniqueCellIds->GetNumberOfIds();
     bool duplicate = false;
     int j;
-    for (j=0; j<currentNumberOfGroupCellIds; j++)
+    for (j=0; j<currentNumberOfUniqueCellIds; j++)
       {
+      vtkIdType currentNpts, *currentPts;
       double currentCellFirstPoint[3], currentCellLastPoint[3];
-      double cellFirstPoint[3], cellLastPoint[3];
-      vtkCell* cell = centerlines->GetCell(groupCellIds->GetId(j));
-      cell->GetPoints()->GetPoint(0,currentCellFirstPoint);
-      cell->GetPoints()->GetPoint(cell->GetNumberOfPoints()-1,currentCellLastPoint);
-      cell = centerlines->GetCell(i);
-      cell->GetPoints()->GetPoint(0,cellFirstPoint);
-      cell->GetPoints()->GetPoint(cell->GetNumberOfPoints()-1,cellLastPoint);
+      centerlines->GetCellPoints(uniqueCellIds->GetId(j),currentNpts,currentPts);
+      centerlines->GetPoint(currentPts[0],currentCellFirstPoint);
+      centerlines->GetPoint(currentPts[currentNpts-1],currentCellLastPoint);
       if ((vtkMath::Distance2BetweenPoints(currentCellFirstPoint,cellFirstPoint) < VTK_VMTK_DOUBLE_TOL) &&
           (vtkMath::Distance2BetweenPoints(currentCellLastPoint,cellLastPoint) < VTK_VMTK_DOUBLE_TOL))
         {
@@ -157,7 +172,7 @@ void vtkvmtkCenterlineUtilities::GetGroupUniqueCellIds(vtkPolyData* centerlines,
       {
       continue;
       }
-    groupCellIds->InsertNextId(i);
+    uniqueCellIds->InsertNextId(cellIds->GetId(i));
     }
 }
 
@@ -281,8 +296,8 @@ void vtkvmtkCenterlineUtilities::FindAdjacentCenterlineGroupIds(vtkPolyData* cen
       continue;
       }
 
-    vtkCell* centerlineBranch = centerlines->GetCell(i);
-    if (centerlineBranch->GetCellType() != VTK_LINE && centerlineBranch->GetCellType() != VTK_POLY_LINE)
+    int cellType = centerlines->GetCellType(i);
+    if (cellType != VTK_LINE && cellType != VTK_POLY_LINE)
       {
       continue;
       }
@@ -323,10 +338,12 @@ void vtkvmtkCenterlineUtilities::FindAdjacentCenterlineGroupIds(vtkPolyData* cen
 
 void vtkvmtkCenterlineUtilities::InterpolatePoint(vtkPolyData* centerlines, int cellId, int subId, double pcoord, double interpolatedPoint[3])
 {
+  vtkIdType npts, *pts;
+  centerlines->GetCellPoints(cellId,npts,pts);
+
   double point0[3], point1[3];
-  vtkPoints* centerlineCellPoints = centerlines->GetCell(cellId)->GetPoints();
-  centerlineCellPoints->GetPoint(subId,point0);
-  centerlineCellPoints->GetPoint(subId+1,point1);
+  centerlines->GetPoint(pts[subId],point0);
+  centerlines->GetPoint(pts[subId+1],point1);
       
   interpolatedPoint[0] = (1.0 - pcoord) * point0[0] + pcoord * point1[0];
   interpolatedPoint[1] = (1.0 - pcoord) * point0[1] + pcoord * point1[1];
@@ -337,15 +354,17 @@ void vtkvmtkCenterlineUtilities::InterpolateTuple(vtkPolyData* centerlines, cons
 {
   vtkDataArray* array = centerlines->GetPointData()->GetArray(arrayName);
   int numberOfComponents = array->GetNumberOfComponents();
-  vtkIdType pointId0 = centerlines->GetCell(cellId)->GetPointId(subId);
-  vtkIdType pointId1 = centerlines->GetCell(cellId)->GetPointId(subId+1);
-  double* tuple0 = array->GetTuple(pointId0);
-  double* tuple1 = array->GetTuple(pointId1);
+  vtkIdType npts, *pts;
+  centerlines->GetCellPoints(cellId,npts,pts);
+  vtkIdType pointId0 = pts[subId];
+  vtkIdType pointId1 = pts[subId+1];
 
+  // components are read one by one, GetTuple(id) returns a buffer shared by
+  // both tuples and by concurrent callers
   int i;
   for (i=0; i<numberOfComponents; i++)
   {
-    interpolatedTuple[i] = (1.0 - pcoord) * tuple0[i] + pcoord * tuple1[i];
+    interpolatedTuple[i] = (1.0 - pcoord) * array->GetComponent(pointId0,i) + pcoord * array->GetComponent(pointId1,i);
   }
 }
 
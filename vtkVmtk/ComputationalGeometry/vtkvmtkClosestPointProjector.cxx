@@ -0,0 +1,622 @@
+/*=========================================================================
+
+Program:   VMTK
+Module:    $RCSfile: vtkvmtkClosestPointProjector.cxx,v $
+Language:  C++
+Date:      $Date: 2006/04/06 16:47:48 $
+Version:   $Revision: 1.1 $
+
+  Copyright (c) Luca Antiga, David Steinman. All rights reserved.
+  See LICENCE file for details.
+
+  Portions of this code are covered under the VTK copyright.
+  See VTKCopyright.txt or http://www.kitware.com/VTKCopyright.htm
+  for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+
+#include "vtkvmtkClosestPointProjector.h"
+
+#include "vtkCellArray.h"
+#include "vtkDataSet.h"
+#include "vtkGenericCell.h"
+#include "vtkIdList.h"
+#include "vtkMath.h"
+#include "vtkPointData.h"
+#include "vtkPoints.h"
+#include "vtkPolyData.h"
+#include "vtkUnstructuredGrid.h"
+#include "vtkObjectFactory.h"
+#include "vtkSMPTools.h"
+#include "vtkSMPThreadLocal.h"
+#include "vtkSMPThreadLocalObject.h"
+
+#include <algorithm>
+
+
+vtkStandardNewMacro(vtkvmtkClosestPointProjector);
+
+vtkCxxSetObjectMacro(vtkvmtkClosestPointProjector,DataSet,vtkDataSet);
+
+vtkvmtkClosestPointProjector::vtkvmtkClosestPointProjector()
+{
+  this->DataSet = NULL;
+  this->NumberOfCellsPerLeaf = 8;
+  this->SnapToPolyLineVertices = 0;
+  this->MaximumCellSize = 0;
+  this->BuiltDataSet = NULL;
+  this->BuiltGeometryMTime = 0;
+  this->ProjectedPoints = NULL;
+}
+
+vtkvmtkClosestPointProjector::~vtkvmtkClosestPointProjector()
+{
+  if (this->DataSet)
+    {
+    this->DataSet->Delete();
+    this->DataSet = NULL;
+    }
+}
+
+unsigned long vtkvmtkClosestPointProjector::GetGeometryMTime()
+{
+  // point data is not part of the geometry, so that arrays can be replaced
+  // on DataSet without rebuilding the hierarchy
+  vtkPolyData* polyData = vtkPolyData::SafeDownCast(this->DataSet);
+  if (polyData)
+    {
+    unsigned long mtime = polyData->GetPoints() ? polyData->GetPoints()->GetMTime() : 0;
+    mtime = std::max(mtime,static_cast<unsigned long>(polyData->GetVerts()->GetMTime()));
+    mtime = std::max(mtime,static_cast<unsigned long>(polyData->GetLines()->GetMTime()));
+    mtime = std::max(mtime,static_cast<unsigned long>(polyData->GetPolys()->GetMTime()));
+    mtime = std::max(mtime,static_cast<unsigned long>(polyData->GetStrips()->GetMTime()));
+    return mtime;
+    }
+  vtkUnstructuredGrid* grid = vtkUnstructuredGrid::SafeDownCast(this->DataSet);
+  if (grid)
+    {
+    unsigned long mtime = grid->GetPoints() ? grid->GetPoints()->GetMTime() : 0;
+    if (grid->GetCells())
+      {
+      mtime = std::max(mtime,static_cast<unsigned long>(grid->GetCells()->GetMTime()));
+      }
+    return mtime;
+    }
+  return this->DataSet->GetMTime();
+}
+
+// Squared distance between x and its closest point on triangle abc, with the
+// barycentric coordinates of the closest point (Ericson, Real-Time Collision
+// Detection, 5.1.5).
+static double vtkvmtkClosestPointOnTriangle(const double x[3], const double* a, const double* b, const double* c, double closestPoint[3], double weights[3])
+{
+  double ab[3], ac[3], ax[3], bx[3], cx[3];
+  for (int i=0; i<3; i++)
+    {
+    ab[i] = b[i] - a[i];
+    ac[i] = c[i] - a[i];
+    ax[i] = x[i] - a[i];
+    bx[i] = x[i] - b[i];
+    cx[i] = x[i] - c[i];
+    }
+
+  double d1 = vtkMath::Dot(ab,ax);
+  double d2 = vtkMath::Dot(ac,ax);
+  double d3 = vtkMath::Dot(ab,bx);
+  double d4 = vtkMath::Dot(ac,bx);
+  double d5 = vtkMath::Dot(ab,cx);
+  double d6 = vtkMath::Dot(ac,cx);
+
+  double va = d3*d6 - d5*d4;
+  double vb = d5*d2 - d1*d6;
+  double vc = d1*d4 - d3*d2;
+
+  double v, w;
+  if (d1 <= 0.0 && d2 <= 0.0)
+    {
+    v = 0.0;
+    w = 0.0;
+    }
+  else if (d3 >= 0.0 && d4 <= d3)
+    {
+    v = 1.0;
+    w = 0.0;
+    }
+  else if (vc <= 0.0 && d1 >= 0.0 && d3 <= 0.0)
+    {
+    v = d1 / (d1 - d3);
+    w = 0.0;
+    }
+  else if (d6 >= 0.0 && d5 <= d6)
+    {
+    v = 0.0;
+    w = 1.0;
+    }
+  else if (vb <= 0.0 && d2 >= 0.0 && d6 <= 0.0)
+    {
+    v = 0.0;
+    w = d2 / (d2 - d6);
+    }
+  else if (va <= 0.0 && (d4 - d3) >= 0.0 && (d5 - d6) >= 0.0)
+    {
+    w = (d4 - d3) / ((d4 - d3) + (d5 - d6));
+    v = 1.0 - w;
+    }
+  else
+    {
+    double denom = 1.0 / (va + vb + vc);
+    v = vb * denom;
+    w = vc * denom;
+    }
+
+  weights[0] = 1.0 - v - w;
+  weights[1] = v;
+  weights[2] = w;
+
+  double dist2 = 0.0;
+  for (int i=0; i<3; i++)
+    {
+    closestPoint[i] = a[i] + v * ab[i] + w * ac[i];
+    dist2 += (x[i] - closestPoint[i]) * (x[i] - closestPoint[i]);
+    }
+  return dist2;
+}
+
+static double vtkvmtkBoundsDistance2(const double x[3], const double* bounds)
+{
+  double dist2 = 0.0;
+  for (int i=0; i<3; i++)
+    {
+    double d = 0.0;
+    if (x[i] < bounds[2*i])
+      {
+      d = bounds[2*i] - x[i];
+      }
+    else if (x[i] > bounds[2*i+1])
+      {
+      d = x[i] - bounds[2*i+1];
+      }
+    dist2 += d * d;
+    }
+  return dist2;
+}
+
+class vtkvmtkClosestPointProjectorCenterCompare
+{
+public:
+  vtkvmtkClosestPointProjectorCenterCompare(const double* centers, int axis) : Centers(centers), Axis(axis) {}
+
+  bool operator()(vtkIdType c0, vtkIdType c1) const
+  {
+    return this->Centers[3*c0+this->Axis] < this->Centers[3*c1+this->Axis];
+  }
+
+private:
+  const double* Centers;
+  int Axis;
+};
+
+void vtkvmtkClosestPointProjector::BuildLocator()
+{
+  if (!this->DataSet)
+    {
+    vtkErrorMacro(<<"No dataset set.");
+    return;
+    }
+
+  unsigned long geometryMTime = this->GetGeometryMTime();
+  if (this->BuiltDataSet == this->DataSet && this->BuiltGeometryMTime == geometryMTime && this->BuildTime > this->GetMTime())
+    {
+    return;
+    }
+
+  vtkPolyData* polyData = vtkPolyData::SafeDownCast(this->DataSet);
+  if (polyData)
+    {
+    polyData->BuildCells();
+    }
+
+  vtkIdType numberOfCells = this->DataSet->GetNumberOfCells();
+  this->MaximumCellSize = std::max(this->DataSet->GetMaxCellSize(),3);
+
+  std::vector<double> cellBounds(6*numberOfCells);
+  std::vector<double> cellCenters(3*numberOfCells);
+  std::vector<vtkIdType> cellIds(numberOfCells);
+  std::vector<char> cellIsTriangle(numberOfCells,0);
+  std::vector<double> triangleCoords(9*numberOfCells,0.0);
+  vtkIdList* pointIds = vtkIdList::New();
+  vtkIdType i;
+  vtkIdType numberOfValidCells = 0;
+  for (i=0; i<numberOfCells; i++)
+    {
+    this->DataSet->GetCellPoints(i,pointIds);
+    vtkIdType npts = pointIds->GetNumberOfIds();
+    if (npts == 0)
+      {
+      continue;
+      }
+    double* bounds = &cellBounds[6*numberOfValidCells];
+    bounds[0] = bounds[2] = bounds[4] = VTK_DOUBLE_MAX;
+    bounds[1] = bounds[3] = bounds[5] = -VTK_DOUBLE_MAX;
+    double x[3];
+    for (vtkIdType j=0; j<npts; j++)
+      {
+      this->DataSet->GetPoint(pointIds->GetId(j),x);
+      for (int k=0; k<3; k++)
+        {
+        bounds[2*k] = std::min(bounds[2*k],x[k]);
+        bounds[2*k+1] = std::max(bounds[2*k+1],x[k]);
+        }
+      }
+    if (this->DataSet->GetCellType(i) == VTK_TRIANGLE)
+      {
+      double* coords = &triangleCoords[9*numberOfValidCells];
+      this->DataSet->GetPoint(pointIds->GetId(0),coords);
+      this->DataSet->GetPoint(pointIds->GetId(1),coords+3);
+      this->DataSet->GetPoint(pointIds->GetId(2),coords+6);
+      double v1[3], v2[3], normal[3];
+      for (int k=0; k<3; k++)
+        {
+        v1[k] = coords[3+k] - coords[k];
+        v2[k] = coords[6+k] - coords[k];
+        }
+      vtkMath::Cross(v1,v2,normal);
+      // degenerate triangles are skipped, as vtkTriangle::EvaluatePosition
+      // fails on them
+      if (vtkMath::Dot(normal,normal) == 0.0)
+        {
+        continue;
+        }
+      cellIsTriangle[numberOfValidCells] = 1;
+      }
+    for (int k=0; k<3; k++)
+      {
+      cellCenters[3*numberOfValidCells+k] = 0.5 * (bounds[2*k] + bounds[2*k+1]);
+      }
+    cellIds[numberOfValidCells] = i;
+    numberOfValidCells++;
+    }
+  pointIds->Delete();
+
+  // top-down median split along the largest extent of the cell centers
+  std::vector<vtkIdType> order(numberOfValidCells);
+  for (i=0; i<numberOfValidCells; i++)
+    {
+    order[i] = i;
+    }
+
+  this->NodeBounds.clear();
+  this->NodeFirst.clear();
+  this->NodeCount.clear();
+
+  struct BuildItem
+  {
+    vtkIdType Node;
+    vtkIdType Begin;
+    vtkIdType End;
+  };
+  std::vector<BuildItem> stack;
+  if (numberOfValidCells > 0)
+    {
+    this->NodeBounds.resize(6);
+    this->NodeFirst.push_back(0);
+    this->NodeCount.push_back(0);
+    BuildItem root = {0, 0, numberOfValidCells};
+    stack.push_back(root);
+    }
+  while (!stack.empty())
+    {
+    BuildItem item = stack.back();
+    stack.pop_back();
+
+    double bounds[6], centerBounds[6];
+    bounds[0] = bounds[2] = bounds[4] = centerBounds[0] = centerBounds[2] = centerBounds[4] = VTK_DOUBLE_MAX;
+    bounds[1] = bounds[3] = bounds[5] = centerBounds[1] = centerBounds[3] = centerBounds[5] = -VTK_DOUBLE_MAX;
+    for (i=item.Begin; i<item.End; i++)
+      {
+      const double* cb = &cellBounds[6*order[i]];
+      const double* cc = &cellCenters[3*order[i]];
+      for (int k=0; k<3; k++)
+        {
+        bounds[2*k] = std::min(bounds[2*k],cb[2*k]);
+        bounds[2*k+1] = std::max(bounds[2*k+1],cb[2*k+1]);
+        centerBounds[2*k] = std::min(centerBounds[2*k],cc[k]);
+        centerBounds[2*k+1] = std::max(centerBounds[2*k+1],cc[k]);
+        }
+      }
+    std::copy(bounds,bounds+6,&this->NodeBounds[6*item.Node]);
+
+    int axis = 0;
+    for (int k=1; k<3; k++)
+      {
+      if (centerBounds[2*k+1] - centerBounds[2*k] > centerBounds[2*axis+1] - centerBounds[2*axis])
+        {
+        axis = k;
+        }
+      }
+
+    vtkIdType count = item.End - item.Begin;
+    if (count <= this->NumberOfCellsPerLeaf || centerBounds[2*axis+1] - centerBounds[2*axis] <= 0.0)
+      {
+      this->NodeFirst[item.Node] = item.Begin;
+      this->NodeCount[item.Node] = -count;
+      continue;
+      }
+
+    vtkIdType middle = item.Begin + count / 2;
+    vtkvmtkClosestPointProjectorCenterCompare compare(&cellCenters[0],axis);
+    std::nth_element(order.begin()+item.Begin,order.begin()+middle,order.begin()+item.End,compare);
+
+    vtkIdType child = static_cast<vtkIdType>(this->NodeFirst.size());
+    this->NodeFirst[item.Node] = child;
+    this->NodeCount[item.Node] = 0;
+    this->NodeFirst.push_back(0);
+    this->NodeCount.push_back(0);
+    this->NodeFirst.push_back(0);
+    this->NodeCount.push_back(0);
+    this->NodeBounds.resize(6*(child+2));
+    BuildItem left = {child, item.Begin, middle};
+    BuildItem right = {child+1, middle, item.End};
+    stack.push_back(left);
+    stack.push_back(right);
+    }
+
+  this->LeafCellIds.resize(numberOfValidCells);
+  this->LeafCellIsTriangle.resize(numberOfValidCells);
+  this->LeafTriangleCoords.resize(9*numberOfValidCells);
+  for (i=0; i<numberOfValidCells; i++)
+    {
+    this->LeafCellIds[i] = cellIds[order[i]];
+    this->LeafCellIsTriangle[i] = cellIsTriangle[order[i]];
+    std::copy(&triangleCoords[9*order[i]],&triangleCoords[9*order[i]]+9,&this->LeafTriangleCoords[9*i]);
+    }
+
+  this->BuiltDataSet = this->DataSet;
+  this->BuiltGeometryMTime = geometryMTime;
+  this->BuildTime.Modified();
+}
+
+void vtkvmtkClosestPointProjector::FindClosestPoint(const double x[3], double closestPoint[3], vtkGenericCell* cell, vtkIdType& cellId, int& subId, double& dist2, double* weights)
+{
+  cellId = -1;
+  subId = 0;
+  dist2 = VTK_DOUBLE_MAX;
+  closestPoint[0] = x[0];
+  closestPoint[1] = x[1];
+  closestPoint[2] = x[2];
+
+  if (this->NodeFirst.empty())
+    {
+    return;
+    }
+
+  double point[3];
+  point[0] = x[0];
+  point[1] = x[1];
+  point[2] = x[2];
+
+  vtkIdType bestLeafIndex = -1;
+  double bestWeights[3];
+  double testPoint[3], testWeights[3], pcoords[3];
+  int testSubId;
+  double testDist2;
+
+  vtkIdType stack[128];
+  int stackSize = 0;
+  stack[stackSize++] = 0;
+  while (stackSize > 0)
+    {
+    vtkIdType node = stack[--stackSize];
+    if (vtkvmtkBoundsDistance2(point,&this->NodeBounds[6*node]) > dist2)
+      {
+      continue;
+      }
+    if (this->NodeCount[node] < 0)
+      {
+      vtkIdType first = this->NodeFirst[node];
+      vtkIdType last = first - this->NodeCount[node];
+      for (vtkIdType i=first; i<last; i++)
+        {
+        if (this->LeafCellIsTriangle[i])
+          {
+          const double* coords = &this->LeafTriangleCoords[9*i];
+          testDist2 = vtkvmtkClosestPointOnTriangle(point,coords,coords+3,coords+6,testPoint,testWeights);
+          if (testDist2 < dist2)
+            {
+            dist2 = testDist2;
+            bestLeafIndex = i;
+            subId = 0;
+            closestPoint[0] = testPoint[0];
+            closestPoint[1] = testPoint[1];
+            closestPoint[2] = testPoint[2];
+            bestWeights[0] = testWeights[0];
+            bestWeights[1] = testWeights[1];
+            bestWeights[2] = testWeights[2];
+            }
+          continue;
+          }
+        this->DataSet->GetCell(this->LeafCellIds[i],cell);
+        int status = cell->EvaluatePosition(point,testPoint,testSubId,pcoords,testDist2,weights);
+        if (status != -1 && testDist2 < dist2)
+          {
+          dist2 = testDist2;
+          bestLeafIndex = i;
+          subId = testSubId;
+          closestPoint[0] = testPoint[0];
+          closestPoint[1] = testPoint[1];
+          closestPoint[2] = testPoint[2];
+          }
+        }
+      continue;
+      }
+    // visit the nearest child first
+    vtkIdType child0 = this->NodeFirst[node];
+    vtkIdType child1 = child0 + 1;
+    double childDist0 = vtkvmtkBoundsDistance2(point,&this->NodeBounds[6*child0]);
+    double childDist1 = vtkvmtkBoundsDistance2(point,&this->NodeBounds[6*child1]);
+    if (childDist0 < childDist1)
+      {
+      std::swap(child0,child1);
+      }
+    stack[stackSize++] = child0;
+    stack[stackSize++] = child1;
+    }
+
+  if (bestLeafIndex == -1)
+    {
+    return;
+    }
+
+  cellId = this->LeafCellIds[bestLeafIndex];
+  this->DataSet->GetCell(cellId,cell);
+  if (this->LeafCellIsTriangle[bestLeafIndex])
+    {
+    weights[0] = bestWeights[0];
+    weights[1] = bestWeights[1];
+    weights[2] = bestWeights[2];
+    }
+  else
+    {
+    double closestDist2;
+    cell->EvaluatePosition(closestPoint,NULL,testSubId,pcoords,closestDist2,weights);
+    }
+}
+
+class vtkvmtkClosestPointProjectorFunctor
+{
+public:
+  vtkvmtkClosestPointProjectorFunctor(vtkvmtkClosestPointProjector* projector, vtkPoints* points, vtkDataSet* dataSet, int snapToPolyLineVertices, int stride, vtkIdType* cellIds, int* numberOfPoints, vtkIdType* pointIds, double* weights) :
+    Projector(projector), Points(points), DataSet(dataSet), SnapToPolyLineVertices(snapToPolyLineVertices), Stride(stride), CellIds(cellIds), NumberOfPoints(numberOfPoints), PointIds(pointIds), Weights(weights) {}
+
+  void Initialize()
+  {
+    this->LocalWeights.Local().resize(this->Stride);
+  }
+
+  void operator()(vtkIdType begin, vtkIdType end)
+  {
+    vtkGenericCell* cell = this->LocalCell.Local();
+    std::vector<double>& weights = this->LocalWeights.Local();
+    double point[3], closestPoint[3];
+    vtkIdType cellId;
+    int subId;
+    double dist2;
+    for (vtkIdType i=begin; i<end; i++)
+      {
+      this->Points->GetPoint(i,point);
+      this->Projector->FindClosestPoint(point,closestPoint,cell,cellId,subId,dist2,&weights[0]);
+      this->CellIds[i] = cellId;
+      vtkIdType* pointIds = this->PointIds + i*this->Stride;
+      double* pointWeights = this->Weights + i*this->Stride;
+      if (cellId == -1)
+        {
+        this->NumberOfPoints[i] = 0;
+        continue;
+        }
+      if (this->SnapToPolyLineVertices && cell->GetCellType() == VTK_POLY_LINE)
+        {
+        double testPoint0[3], testPoint1[3];
+        vtkIdType pointId = cell->GetPointId(subId);
+        this->DataSet->GetPoint(cell->GetPointId(subId),testPoint0);
+        this->DataSet->GetPoint(cell->GetPointId(subId+1),testPoint1);
+        if (vtkMath::Distance2BetweenPoints(closestPoint,testPoint1) < vtkMath::Distance2BetweenPoints(closestPoint,testPoint0))
+          {
+          pointId = cell->GetPointId(subId+1);
+          }
+        this->NumberOfPoints[i] = 1;
+        pointIds[0] = pointId;
+        pointWeights[0] = 1.0;
+        continue;
+        }
+      vtkIdType numberOfCellPoints = cell->GetNumberOfPoints();
+      this->NumberOfPoints[i] = static_cast<int>(numberOfCellPoints);
+      for (vtkIdType j=0; j<numberOfCellPoints; j++)
+        {
+        pointIds[j] = cell->GetPointId(j);
+        pointWeights[j] = weights[j];
+        }
+      }
+  }
+
+  void Reduce()
+  {
+  }
+
+private:
+  vtkvmtkClosestPointProjector* Projector;
+  vtkPoints* Points;
+  vtkDataSet* DataSet;
+  int SnapToPolyLineVertices;
+  int Stride;
+  vtkIdType* CellIds;
+  int* NumberOfPoints;
+  vtkIdType* PointIds;
+  double* Weights;
+  vtkSMPThreadLocalObject<vtkGenericCell> LocalCell;
+  vtkSMPThreadLocal<std::vector<double> > LocalWeights;
+};
+
+void vtkvmtkClosestPointProjector::ComputeProjection(vtkPoints* points)
+{
+  this->BuildLocator();
+
+  if (!points)
+    {
+    this->ProjectedPoints = NULL;
+    this->ProjectionCellIds.clear();
+    return;
+    }
+
+  if (points == this->ProjectedPoints && this->ProjectionTime > points->GetMTime() && this->ProjectionTime > this->BuildTime && this->ProjectionTime > this->GetMTime())
+    {
+    return;
+    }
+
+  vtkIdType numberOfPoints = points->GetNumberOfPoints();
+  int stride = this->MaximumCellSize;
+  this->ProjectionCellIds.resize(numberOfPoints);
+  this->ProjectionNumberOfPoints.resize(numberOfPoints);
+  this->ProjectionPointIds.resize(numberOfPoints*stride);
+  this->ProjectionWeights.resize(numberOfPoints*stride);
+
+  if (numberOfPoints > 0)
+    {
+    vtkvmtkClosestPointProjectorFunctor functor(this,points,this->DataSet,this->SnapToPolyLineVertices,stride,&this->ProjectionCellIds[0],&this->ProjectionNumberOfPoints[0],&this->ProjectionPointIds[0],&this->ProjectionWeights[0]);
+    vtkSMPTools::For(0,numberOfPoints,functor);
+    }
+
+  this->ProjectedPoints = points;
+  this->ProjectionTime.Modified();
+}
+
+void vtkvmtkClosestPointProjector::InterpolatePointData(vtkPointData* source, vtkPointData* target)
+{
+  vtkIdType numberOfPoints = this->GetNumberOfProjectedPoints();
+  int stride = this->MaximumCellSize;
+  vtkIdList* pointIds = vtkIdList::New();
+  for (vtkIdType i=0; i<numberOfPoints; i++)
+    {
+    int numberOfCellPoints = this->ProjectionNumberOfPoints[i];
+    if (numberOfCellPoints == 0)
+      {
+      target->NullPoint(i);
+      continue;
+      }
+    pointIds->SetNumberOfIds(numberOfCellPoints);
+    for (int j=0; j<numberOfCellPoints; j++)
+      {
+      pointIds->SetId(j,this->ProjectionPointIds[i*stride+j]);
+      }
+    target->InterpolatePoint(source,i,pointIds,&this->ProjectionWeights[i*stride]);
+    }
+  pointIds->Delete();
+}
+
+void vtkvmtkClosestPointProjector::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os,indent);
+}
@@ -0,0 +1,144 @@
+/*=========================================================================
+
+Program:   VMTK
+Module:    $RCSfile: vtkvmtkClosestPointProjector.h,v $
+Language:  C++
+Date:      $Date: 2006/04/06 16:47:48 $
+Version:   $Revision: 1.1 $
+
+  Copyright (c) Luca Antiga, David Steinman. All rights reserved.
+  See LICENCE file for details.
+
+  Portions of this code are covered under the VTK copyright.
+  See VTKCopyright.txt or http://www.kitware.com/VTKCopyright.htm
+  for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+  // .NAME vtkvmtkClosestPointProjector - Thread safe closest point queries and reusable point projections onto a dataset.
+  // .SECTION Description
+  // Builds a static bounding volume hierarchy over the cells of DataSet.
+  // FindClosestPoint can be called concurrently from several threads, each
+  // passing its own vtkGenericCell and weights buffer. Triangles are tested
+  // with a dedicated point-triangle distance on coordinates packed at build
+  // time; other cells go through vtkCell::EvaluatePosition, skipping
+  // degenerate cells as vtkCellLocator does.
+  //
+  // ComputeProjection finds, in parallel, the closest cell and the
+  // interpolation weights of the closest point for a set of points. The
+  // result is kept and InterpolatePointData can then be called for any
+  // number of point data sets defined on DataSet (e.g. the time steps of a
+  // simulation) without further queries. The hierarchy is only rebuilt when
+  // the points or the cells of DataSet change, and the projection only when
+  // the projected points change as well, so point data can be replaced on
+  // DataSet between executions at no cost.
+
+#ifndef __vtkvmtkClosestPointProjector_h
+#define __vtkvmtkClosestPointProjector_h
+
+#include "vtkObject.h"
+#include "vtkvmtkWin32Header.h"
+
+#include <vector>
+
+class vtkDataSet;
+class vtkGenericCell;
+class vtkPoints;
+class vtkPointData;
+
+class VTK_VMTK_COMPUTATIONAL_GEOMETRY_EXPORT vtkvmtkClosestPointProjector : public vtkObject
+{
+  public:
+  vtkTypeMacro(vtkvmtkClosestPointProjector,vtkObject);
+  void PrintSelf(ostream& os, vtkIndent indent) VTK_OVERRIDE;
+
+  static vtkvmtkClosestPointProjector *New();
+
+  // Description:
+  // Set/Get the dataset onto which points are projected.
+  virtual void SetDataSet(vtkDataSet*);
+  vtkGetObjectMacro(DataSet,vtkDataSet);
+
+  // Description:
+  // Set/Get the maximum number of cells in a leaf of the hierarchy.
+  vtkSetClampMacro(NumberOfCellsPerLeaf,int,1,VTK_INT_MAX);
+  vtkGetMacro(NumberOfCellsPerLeaf,int);
+
+  // Description:
+  // If on, points whose closest cell is a poly line are assigned to the
+  // closest vertex of the closest segment instead of being interpolated.
+  vtkSetMacro(SnapToPolyLineVertices,int);
+  vtkGetMacro(SnapToPolyLineVertices,int);
+  vtkBooleanMacro(SnapToPolyLineVertices,int);
+
+  // Description:
+  // Builds the hierarchy if the geometry of DataSet changed since the last
+  // build. Must be called before FindClosestPoint.
+  void BuildLocator();
+
+  // Description:
+  // Thread safe closest point query. cell and weights (at least
+  // GetMaximumCellSize() entries) are scratch space owned by the caller. On
+  // return cell holds the closest cell and weights the interpolation weights
+  // of closestPoint on it. cellId is -1 if no cell was found.
+  void FindClosestPoint(const double x[3], double closestPoint[3], vtkGenericCell* cell, vtkIdType& cellId, int& subId, double& dist2, double* weights);
+
+  int GetMaximumCellSize() { return this->MaximumCellSize; }
+
+  // Description:
+  // Projects points onto DataSet, building the locator if needed. The
+  // projection is kept until points or DataSet geometry change.
+  void ComputeProjection(vtkPoints* points);
+
+  // Description:
+  // Interpolates source, defined on the points of DataSet, onto the projected
+  // points, writing into target (allocated by the caller, e.g. with
+  // InterpolateAllocate). Points without a closest cell get null values.
+  void InterpolatePointData(vtkPointData* source, vtkPointData* target);
+
+  vtkIdType GetNumberOfProjectedPoints() { return static_cast<vtkIdType>(this->ProjectionCellIds.size()); }
+  vtkIdType GetProjectionCellId(vtkIdType i) { return this->ProjectionCellIds[i]; }
+
+  protected:
+  vtkvmtkClosestPointProjector();
+  ~vtkvmtkClosestPointProjector();
+
+  unsigned long GetGeometryMTime();
+
+  vtkDataSet* DataSet;
+  int NumberOfCellsPerLeaf;
+  int SnapToPolyLineVertices;
+  int MaximumCellSize;
+
+  // hierarchy: node bounds, children (or first cell for leaves, with a
+  // negative count) and cell ids in leaf order; triangles keep their point
+  // coordinates packed in the same order
+  std::vector<double> NodeBounds;
+  std::vector<vtkIdType> NodeFirst;
+  std::vector<vtkIdType> NodeCount;
+  std::vector<vtkIdType> LeafCellIds;
+  std::vector<char> LeafCellIsTriangle;
+  std::vector<double> LeafTriangleCoords;
+
+  vtkDataSet* BuiltDataSet;
+  unsigned long BuiltGeometryMTime;
+  vtkTimeStamp BuildTime;
+
+  // projection: per point closest cell and weights, with a stride of
+  // MaximumCellSize
+  std::vector<vtkIdType> ProjectionCellIds;
+  std::vector<int> ProjectionNumberOfPoints;
+  std::vector<vtkIdType> ProjectionPointIds;
+  std::vector<double> ProjectionWeights;
+  vtkPoints* ProjectedPoints;
+  vtkTimeStamp ProjectionTime;
+
+  private:
+  vtkvmtkClosestPointProjector(const vtkvmtkClosestPointProjector&);  // Not implemented.
+  void operator=(const vtkvmtkClosestPointProjector&);  // Not implemented.
+};
+
+#endif
@@ -20,9 +20,8 @@ Version:   $Revision: 1.4 $
 =========================================================================*/
 
 #include "vtkvmtkMergeCenterlines.h"
-#include "vtkvmtkCenterlineUtilities.h"
 #include "vtkvmtkCenterlineBifurcationReferenceSystems.h"
-#include "vtkvmtkReferenceSystemUtilities.h"
+#include "vtkvmtkConstants.h"
 #include "vtkSplineFilter.h"
 #include "vtkCleanPolyData.h"
 #include "vtkDoubleArray.h"
@@ -30,10 +29,15 @@ Version:   $Revision: 1.4 $
 #include "vtkCellData.h"
 #include "vtkCellArray.h"
 #include "vtkIdList.h"
+#include "vtkMath.h"
 #include "vtkInformation.h"
 #include "vtkInformationVector.h"
 #include "vtkObjectFactory.h"
 #include "vtkVersion.h"
+#include "vtkSMPTools.h"
+
+#include <map>
+#include <vector>
 
 
 vtkStandardNewMacro(vtkvmtkMergeCenterlines);
@@ -82,6 +86,98 @@ vtkvmtkMergeCenterlines::~vtkvmtkMergeCenterlines()
     }
 }
 
+// Merges the tracts of each non-blanked group: duplicate tracts (same end
+// points as a previous one) are dropped, the others are averaged point by
+// point with squared radius weights up to the length of the shortest one.
+class vtkvmtkMergeCenterlinesFunctor
+{
+public:
+  vtkvmtkMergeCenterlinesFunctor(vtkPolyData* centerlines, vtkDataArray* radiusArray, const vtkIdType* groupIds, const std::vector<vtkIdType>* groupCellIds, std::vector<double>* mergedPoints) :
+    Centerlines(centerlines), RadiusArray(radiusArray), GroupIds(groupIds), GroupCellIds(groupCellIds), MergedPoints(mergedPoints) {}
+
+  void operator()(vtkIdType begin, vtkIdType end)
+  {
+    std::vector<vtkIdType> uniqueCellIds;
+    for (vtkIdType i=begin; i<end; i++)
+      {
+      const std::vector<vtkIdType>& cellIds = this->GroupCellIds[this->GroupIds[i]];
+      uniqueCellIds.clear();
+      size_t j;
+      for (j=0; j<cellIds.size(); j++)
+        {
+        vtkIdType npts, *pts;
+        this->Centerlines->GetCellPoints(cellIds[j],npts,pts);
+        double cellFirstPoint[3], cellLastPoint[3];
+        this->Centerlines->GetPoint(pts[0],cellFirstPoint);
+        this->Centerlines->GetPoint(pts[npts-1],cellLastPoint);
+        bool duplicate = false;
+        for (size_t l=0; l<uniqueCellIds.size(); l++)
+          {
+          vtkIdType currentNpts, *currentPts;
+          this->Centerlines->GetCellPoints(uniqueCellIds[l],currentNpts,currentPts);
+          double currentCellFirstPoint[3], currentCellLastPoint[3];
+          this->Centerlines->GetPoint(currentPts[0],currentCellFirstPoint);
+          this->Centerlines->GetPoint(currentPts[currentNpts-1],currentCellLastPoint);
+          if ((vtkMath::Distance2BetweenPoints(currentCellFirstPoint,cellFirstPoint) < VTK_VMTK_DOUBLE_TOL) &&
+              (vtkMath::Distance2BetweenPoints(currentCellLastPoint,cellLastPoint) < VTK_VMTK_DOUBLE_TOL))
+            {
+            duplicate = true;
+            break;
+            }
+          }
+        if (!duplicate)
+          {
+          uniqueCellIds.push_back(cellIds[j]);
+          }
+        }
+
+      vtkIdType numberOfMergedCellPoints = 0;
+      for (j=0; j<uniqueCellIds.size(); j++)
+        {
+        vtkIdType npts, *pts;
+        this->Centerlines->GetCellPoints(uniqueCellIds[j],npts,pts);
+        if ((j==0) || (npts < numberOfMergedCellPoints))
+          {
+          numberOfMergedCellPoints = npts;
+          }
+        }
+
+      std::vector<double>& mergedPoints = this->MergedPoints[i];
+      mergedPoints.assign(3*numberOfMergedCellPoints,0.0);
+      std::vector<double> weightSums(numberOfMergedCellPoints,0.0);
+      for (j=0; j<uniqueCellIds.size(); j++)
+        {
+        vtkIdType npts, *pts;
+        this->Centerlines->GetCellPoints(uniqueCellIds[j],npts,pts);
+        for (vtkIdType k=0; k<numberOfMergedCellPoints; k++)
+          {
+          double point[3];
+          this->Centerlines->GetPoint(pts[k],point);
+          double radius = this->RadiusArray->GetComponent(pts[k],0);
+          double weight = radius*radius;
+          mergedPoints[3*k+0] += weight * point[0];
+          mergedPoints[3*k+1] += weight * point[1];
+          mergedPoints[3*k+2] += weight * point[2];
+          weightSums[k] += weight;
+          }
+        }
+      for (vtkIdType k=0; k<numberOfMergedCellPoints; k++)
+        {
+        mergedPoints[3*k+0] /= weightSums[k];
+        mergedPoints[3*k+1] /= weightSums[k];
+        mergedPoints[3*k+2] /= weightSums[k];
+        }
+      }
+  }
+
+private:
+  vtkPolyData* Centerlines;
+  vtkDataArray* RadiusArray;
+  const vtkIdType* GroupIds;
+  const std::vector<vtkIdType>* GroupCellIds;
+  std::vector<double>* MergedPoints;
+};
+
 int vtkvmtkMergeCenterlines::RequestData(vtkInformation *vtkNotUsed(request), vtkInformationVector **inputVector, vtkInformationVector *outputVector)
 {
   vtkInformation *inInfo = inputVector[0]->GetInformationObject(0);
@@ -185,10 +281,75 @@ int vtkvmtkMergeCenterlines::RequestData(vtkInformation *vtkNotUsed(request), vt
 
   vtkPolyData* resampledCenterlines = vtkPolyData::New();
   resampledCenterlines->DeepCopy(resampler->GetOutput());
+  resampledCenterlines->BuildCells();
 
   resampler->Delete(); 
+  cleaner->Delete();
 
   radiusArray = resampledCenterlines->GetPointData()->GetArray(this->RadiusArrayName);
+  groupIdsArray = resampledCenterlines->GetCellData()->GetArray(this->GroupIdsArrayName);
+  centerlineIdsArray = resampledCenterlines->GetCellData()->GetArray(this->CenterlineIdsArrayName);
+  tractIdsArray = resampledCenterlines->GetCellData()->GetArray(this->TractIdsArrayName);
+  blankingArray = resampledCenterlines->GetCellData()->GetArray(this->BlankingArrayName);
+
+  // group, centerline and tract indices, built in one pass: the cells of
+  // each group, the non-blanked and blanked groups in order of first
+  // appearance, and the cells of each tract of each centerline
+  int numberOfCells = resampledCenterlines->GetNumberOfCells();
+  vtkIdType maxGroupId = -1;
+  int i;
+  for (i=0; i<numberOfCells; i++)
+    {
+    vtkIdType groupId = static_cast<int>(groupIdsArray->GetComponent(i,0));
+    if (groupId > maxGroupId)
+      {
+      maxGroupId = groupId;
+      }
+    }
+
+  std::vector<std::vector<vtkIdType> > groupCellIds(maxGroupId+1);
+  std::vector<vtkIdType> nonBlankedGroupIds;
+  std::vector<vtkIdType> blankedGroupIds;
+  std::vector<char> nonBlankedGroupFound(maxGroupId+1,0);
+  std::vector<char> blankedGroupFound(maxGroupId+1,0);
+  std::map<std::pair<vtkIdType,vtkIdType>,std::vector<vtkIdType> > tractCellIds;
+  for (i=0; i<numberOfCells; i++)
+    {
+    vtkIdType groupId = static_cast<int>(groupIdsArray->GetComponent(i,0));
+    if (groupId < 0)
+      {
+      continue;
+      }
+    groupCellIds[groupId].push_back(i);
+    if (static_cast<int>(blankingArray->GetComponent(i,0)) == 0)
+      {
+      if (!nonBlankedGroupFound[groupId])
+        {
+        nonBlankedGroupFound[groupId] = 1;
+        nonBlankedGroupIds.push_back(groupId);
+        }
+      }
+    else if (static_cast<int>(blankingArray->GetComponent(i,0)) == 1)
+      {
+      if (!blankedGroupFound[groupId])
+        {
+        blankedGroupFound[groupId] = 1;
+        blankedGroupIds.push_back(groupId);
+        }
+      }
+    vtkIdType centerlineId = static_cast<int>(centerlineIdsArray->GetComponent(i,0));
+    vtkIdType tractId = static_cast<int>(tractIdsArray->GetComponent(i,0));
+    tractCellIds[std::make_pair(centerlineId,tractId)].push_back(i);
+    }
+
+  vtkIdType numberOfNonBlankedGroups = static_cast<vtkIdType>(nonBlankedGroupIds.size());
+
+  std::vector<std::vector<double> > mergedPoints(numberOfNonBlankedGroups);
+  if (numberOfNonBlankedGroups > 0)
+    {
+    vtkvmtkMergeCenterlinesFunctor functor(resampledCenterlines,radiusArray,&nonBlankedGroupIds[0],&groupCellIds[0],&mergedPoints[0]);
+    vtkSMPTools::For(0,numberOfNonBlankedGroups,functor);
+    }
 
   vtkPoints* outputPoints = vtkPoints::New();
   vtkCellArray* outputLines = vtkCellArray::New();
@@ -199,92 +360,34 @@ int vtkvmtkMergeCenterlines::RequestData(vtkInformation *vtkNotUsed(request), vt
   output->GetPointData()->CopyAllocate(resampledCenterlines->GetPointData());
   output->GetCellData()->CopyAllocate(resampledCenterlines->GetCellData());
 
-  vtkIdList* nonBlankedGroupIds = vtkIdList::New();
-  vtkvmtkCenterlineUtilities::GetNonBlankedGroupsIdList(resampledCenterlines,this->GroupIdsArrayName,this->BlankingArrayName,nonBlankedGroupIds);
+  std::vector<vtkIdType> groupIdsToMergedCells(maxGroupId+1,-1);
 
-  vtkIdList* groupIdsToMergedCells = vtkIdList::New();
-  vtkIdType maxGroupId = vtkvmtkCenterlineUtilities::GetMaxGroupId(resampledCenterlines,this->GroupIdsArrayName);
-  groupIdsToMergedCells->SetNumberOfIds(maxGroupId);
-  int i;
-  for (i=0; i<maxGroupId; i++)
+  // point and cell data come from the first tract of each group
+  for (i=0; i<numberOfNonBlankedGroups; i++)
     {
-    groupIdsToMergedCells->SetId(i,-1);
-    }
-
-  vtkIdTypeArray* cellEndPointIds = vtkIdTypeArray::New();
-  cellEndPointIds->SetNumberOfComponents(2);
-
-  for (i=0; i<nonBlankedGroupIds->GetNumberOfIds(); i++)
-    {
-    vtkIdType groupId = nonBlankedGroupIds->GetId(i);
-    vtkIdList* groupUniqueCellIds = vtkIdList::New();
-
-    vtkvmtkCenterlineUtilities::GetGroupUniqueCellIds(resampledCenterlines,this->GroupIdsArrayName,groupId,groupUniqueCellIds);
-
-    int numberOfMergedCellPoints = 0;
-    int j;
-    for (j=0; j<groupUniqueCellIds->GetNumberOfIds(); j++)
-      {
-      vtkIdType cellId = groupUniqueCellIds->GetId(j);
-      int numberOfCellPoints = resampledCenterlines->GetCell(cellId)->GetNumberOfPoints();
-      if ((j==0) || (numberOfCellPoints < numberOfMergedCellPoints))
-        {
-        numberOfMergedCellPoints = numberOfCellPoints;
-        }
-      }
+    vtkIdType groupId = nonBlankedGroupIds[i];
+    vtkIdType cellId = groupCellIds[groupId][0];
+    vtkIdType npts, *pts;
+    resampledCenterlines->GetCellPoints(cellId,npts,pts);
 
+    vtkIdType numberOfMergedCellPoints = static_cast<vtkIdType>(mergedPoints[i].size() / 3);
     vtkIdType mergedCellId = outputLines->InsertNextCell(numberOfMergedCellPoints);
-    groupIdsToMergedCells->InsertId(groupId,mergedCellId);
-    int k;
-    for (k=0; k<numberOfMergedCellPoints; k++)
+    groupIdsToMergedCells[groupId] = mergedCellId;
+    for (vtkIdType k=0; k<numberOfMergedCellPoints; k++)
       {
-      double mergedPoint[3];
-      mergedPoint[0] = 0.0;
-      mergedPoint[1] = 0.0;
-      mergedPoint[2] = 0.0;
-      double weightSum = 0.0;
-      for (j=0; j<groupUniqueCellIds->GetNumberOfIds(); j++)
-        {
-        vtkIdType cellId = groupUniqueCellIds->GetId(j);
-        double point[3];
-        vtkIdType pointId = resampledCenterlines->GetCell(cellId)->GetPointId(k);
-        resampledCenterlines->GetPoint(pointId,point);
-        double radius = radiusArray->GetTuple1(pointId);
-        double weight = radius*radius;
-        resampledCenterlines->GetCell(cellId)->GetPoints()->GetPoint(k,point);
-        mergedPoint[0] += weight * point[0];
-        mergedPoint[1] += weight * point[1];
-        mergedPoint[2] += weight * point[2];
-        weightSum += weight;
-        }
-      mergedPoint[0] /= weightSum;
-      mergedPoint[1] /= weightSum;
-      mergedPoint[2] /= weightSum;
-      vtkIdType mergedPointId = outputPoints->InsertNextPoint(mergedPoint);
+      vtkIdType mergedPointId = outputPoints->InsertNextPoint(&mergedPoints[i][3*k]);
       outputLines->InsertCellPoint(mergedPointId);
-      vtkIdType cellId = groupUniqueCellIds->GetId(0);
-      vtkIdType pointId = resampledCenterlines->GetCell(cellId)->GetPointId(k);
-      output->GetPointData()->CopyData(resampledCenterlines->GetPointData(),pointId,mergedPointId);
-      if (k==0 || k==numberOfMergedCellPoints-1)
-        {
-        cellEndPointIds->InsertNextValue(mergedPointId);
-        }
+      output->GetPointData()->CopyData(resampledCenterlines->GetPointData(),pts[k],mergedPointId);
       }
 
-    vtkIdType cellId = groupUniqueCellIds->GetId(0);
     output->GetCellData()->CopyData(resampledCenterlines->GetCellData(),cellId,mergedCellId);
-
-    groupUniqueCellIds->Delete();
     }
 
   if (!this->MergeBlanked)
     {
-    nonBlankedGroupIds->Delete();
     resampledCenterlines->Delete();
     outputPoints->Delete();
     outputLines->Delete();
-    groupIdsToMergedCells->Delete();
-    cellEndPointIds->Delete();
     return 1;
     }
 
@@ -303,35 +406,75 @@ int vtkvmtkMergeCenterlines::RequestData(vtkInformation *vtkNotUsed(request), vt
 
   vtkPolyData* referenceSystems = referenceSystemsFilter->GetOutput();
 
-  int numberOfMergedCells = outputLines->GetNumberOfCells();
-
-  vtkIdList* blankedGroupIds = vtkIdList::New();
-  vtkvmtkCenterlineUtilities::GetBlankedGroupsIdList(resampledCenterlines,this->GroupIdsArrayName,this->BlankingArrayName,blankedGroupIds);
-  vtkIdList* groupIdsToBifurcationPointIds = vtkIdList::New();
-  vtkIdTypeArray* cellAdditionalEndPointIds = vtkIdTypeArray::New();
-  cellAdditionalEndPointIds->SetNumberOfComponents(2);
-  cellAdditionalEndPointIds->SetNumberOfTuples(numberOfMergedCells);
-  vtkIdType tupleValue[2];
-  tupleValue[0] = tupleValue[1] = -1;
-  for (i=0; i<numberOfMergedCells; i++)
+  // first reference system point of each group
+  vtkDataArray* referenceSystemGroupIdsArray = referenceSystems->GetPointData()->GetArray(this->GroupIdsArrayName);
+  std::vector<vtkIdType> groupIdsToReferenceSystemPointIds(maxGroupId+1,-1);
+  for (i=referenceSystems->GetNumberOfPoints()-1; i>=0; i--)
     {
-#if VTK_MAJOR_VERSION >= 7 && VTK_MINOR_VERSION >= 1
-    cellAdditionalEndPointIds->SetTypedTuple(i, tupleValue);
-#else
-    cellAdditionalEndPointIds->SetTupleValue(i, tupleValue);
-#endif
+    vtkIdType groupId = static_cast<int>(referenceSystemGroupIdsArray->GetComponent(i,0));
+    if (groupId >= 0 && groupId <= maxGroupId)
+      {
+      groupIdsToReferenceSystemPointIds[groupId] = i;
+      }
     }
 
-  for (i=0; i<blankedGroupIds->GetNumberOfIds(); i++)
-    {
-    vtkIdType groupId = blankedGroupIds->GetId(i);
+  int numberOfMergedCells = outputLines->GetNumberOfCells();
+
+  // bifurcation points added before and after each merged cell
+  std::vector<vtkIdType> cellAdditionalEndPointIds(2*numberOfMergedCells,-1);
 
-    vtkIdType referenceSystemPointId = vtkvmtkReferenceSystemUtilities::GetReferenceSystemPointId(referenceSystems,this->GroupIdsArrayName,groupId);
+  vtkIdList* upStreamGroupIds = vtkIdList::New();
+  vtkIdList* downStreamGroupIds = vtkIdList::New();
 
-    vtkIdList* upStreamGroupIds = vtkIdList::New();
-    vtkIdList* downStreamGroupIds = vtkIdList::New();
+  for (size_t b=0; b<blankedGroupIds.size(); b++)
+    {
+    vtkIdType groupId = blankedGroupIds[b];
 
-    vtkvmtkCenterlineUtilities::FindAdjacentCenterlineGroupIds(resampledCenterlines,this->GroupIdsArrayName,this->CenterlineIdsArrayName,this->TractIdsArrayName,groupId,upStreamGroupIds,downStreamGroupIds);
+    vtkIdType referenceSystemPointId = groupIdsToReferenceSystemPointIds[groupId];
+    if (referenceSystemPointId == -1)
+      {
+      continue;
+      }
+
+    // groups of the previous and next tracts along the centerlines through
+    // the group, as vtkvmtkCenterlineUtilities::FindAdjacentCenterlineGroupIds
+    upStreamGroupIds->Initialize();
+    downStreamGroupIds->Initialize();
+    const std::vector<vtkIdType>& cellIds = groupCellIds[groupId];
+    for (size_t c=0; c<cellIds.size(); c++)
+      {
+      vtkIdType cellId = cellIds[c];
+      if (resampledCenterlines->GetCellType(cellId) != VTK_LINE && resampledCenterlines->GetCellType(cellId) != VTK_POLY_LINE)
+        {
+        continue;
+        }
+      vtkIdType centerlineId = static_cast<int>(centerlineIdsArray->GetComponent(cellId,0));
+      vtkIdType tractId = static_cast<int>(tractIdsArray->GetComponent(cellId,0));
+      for (int direction=-1; direction<=1; direction+=2)
+        {
+        std::map<std::pair<vtkIdType,vtkIdType>,std::vector<vtkIdType> >::const_iterator it = tractCellIds.find(std::make_pair(centerlineId,tractId+direction));
+        if (it == tractCellIds.end())
+          {
+          continue;
+          }
+        for (size_t t=0; t<it->second.size(); t++)
+          {
+          vtkIdType adjacentGroupId = static_cast<int>(groupIdsArray->GetComponent(it->second[t],0));
+          if (adjacentGroupId == groupId)
+            {
+            continue;
+            }
+          if (direction == -1)
+            {
+            upStreamGroupIds->InsertUniqueId(adjacentGroupId);
+            }
+          else
+            {
+            downStreamGroupIds->InsertUniqueId(adjacentGroupId);
+            }
+          }
+        }
+      }
 
     double bifurcationPoint[3];
     referenceSystems->GetPoint(referenceSystemPointId,bifurcationPoint);
@@ -342,74 +485,45 @@ int vtkvmtkMergeCenterlines::RequestData(vtkInformation *vtkNotUsed(request), vt
     int j;
     for (j=0; j<upStreamGroupIds->GetNumberOfIds(); j++)
       {
-      vtkIdType mergedCellId = groupIdsToMergedCells->GetId(upStreamGroupIds->GetId(j));
+      vtkIdType upStreamGroupId = upStreamGroupIds->GetId(j);
+      vtkIdType mergedCellId = upStreamGroupId >= 0 ? groupIdsToMergedCells[upStreamGroupId] : -1;
       if (mergedCellId == -1)
         {
         continue;
         }
       if (sourcePointId == -1)
         {
-        vtkIdList* groupUniqueCellIds = vtkIdList::New();
-        vtkvmtkCenterlineUtilities::GetGroupUniqueCellIds(resampledCenterlines,this->GroupIdsArrayName,upStreamGroupIds->GetId(j),groupUniqueCellIds);
-        vtkCell* resampledCell = resampledCenterlines->GetCell(groupUniqueCellIds->GetId(0));
-        sourcePointId = resampledCell->GetPointId(resampledCell->GetNumberOfPoints()-1);
-        groupUniqueCellIds->Delete();
+        vtkIdType npts, *pts;
+        resampledCenterlines->GetCellPoints(groupCellIds[upStreamGroupId][0],npts,pts);
+        sourcePointId = pts[npts-1];
         }
-      vtkIdType tupleValue[2];
-#if VTK_MAJOR_VERSION >= 7 && VTK_MINOR_VERSION >= 1
-      cellAdditionalEndPointIds->GetTypedTuple(mergedCellId,tupleValue);
-#else
-      cellAdditionalEndPointIds->GetTupleValue(mergedCellId, tupleValue);
-#endif
-      tupleValue[1] = bifurcationPointId;
-#if VTK_MAJOR_VERSION >= 7 && VTK_MINOR_VERSION >= 1
-      cellAdditionalEndPointIds->SetTypedTuple(mergedCellId, tupleValue);
-#else
-      cellAdditionalEndPointIds->SetTupleValue(mergedCellId, tupleValue);
-#endif
-
+      cellAdditionalEndPointIds[2*mergedCellId+1] = bifurcationPointId;
       }
 
     for (j=0; j<downStreamGroupIds->GetNumberOfIds(); j++)
       {
-      vtkIdType mergedCellId = groupIdsToMergedCells->GetId(downStreamGroupIds->GetId(j));
+      vtkIdType downStreamGroupId = downStreamGroupIds->GetId(j);
+      vtkIdType mergedCellId = downStreamGroupId >= 0 ? groupIdsToMergedCells[downStreamGroupId] : -1;
       if (mergedCellId == -1)
         {
         continue;
         }
       if (sourcePointId == -1)
         {
-        vtkIdList* groupUniqueCellIds = vtkIdList::New();
-        vtkvmtkCenterlineUtilities::GetGroupUniqueCellIds(resampledCenterlines,this->GroupIdsArrayName,downStreamGroupIds->GetId(j),groupUniqueCellIds);
-        vtkCell* resampledCell = resampledCenterlines->GetCell(groupUniqueCellIds->GetId(0));
-        sourcePointId = resampledCell->GetPointId(0);
-        groupUniqueCellIds->Delete();
+        vtkIdType npts, *pts;
+        resampledCenterlines->GetCellPoints(groupCellIds[downStreamGroupId][0],npts,pts);
+        sourcePointId = pts[0];
         }
-      vtkIdType tupleValue[2];
-#if VTK_MAJOR_VERSION >= 7 && VTK_MINOR_VERSION >= 1
-      cellAdditionalEndPointIds->GetTypedTuple(mergedCellId, tupleValue);
-#else
-      cellAdditionalEndPointIds->GetTupleValue(mergedCellId,tupleValue);
-#endif
-      tupleValue[0] = bifurcationPointId;
-#if VTK_MAJOR_VERSION >= 7 && VTK_MINOR_VERSION >= 1
-      cellAdditionalEndPointIds->SetTypedTuple(mergedCellId, tupleValue);
-#else
-      cellAdditionalEndPointIds->SetTupleValue(mergedCellId,tupleValue);
-#endif
-    }
+      cellAdditionalEndPointIds[2*mergedCellId] = bifurcationPointId;
+      }
+
     if (sourcePointId == -1)
       {
-      upStreamGroupIds->Delete();
-      downStreamGroupIds->Delete();
       continue;
       }
 
     // TODO: interpolate point data instead of copying from first upstream point - good enough for now
     output->GetPointData()->CopyData(resampledCenterlines->GetPointData(),sourcePointId,bifurcationPointId);
-
-    upStreamGroupIds->Delete();
-    downStreamGroupIds->Delete();
     }
  
   vtkCellArray* extendedOutputLines = vtkCellArray::New();
@@ -420,50 +534,42 @@ int vtkvmtkMergeCenterlines::RequestData(vtkInformation *vtkNotUsed(request), vt
     npts = 0;
     pts = NULL;
     outputLines->GetNextCell(npts,pts);
-    vtkIdType tupleValue[2];
-#if VTK_MAJOR_VERSION >= 7 && VTK_MINOR_VERSION >= 1
-    cellAdditionalEndPointIds->GetTypedTuple(i, tupleValue);
-#else
-    cellAdditionalEndPointIds->GetTupleValue(i,tupleValue);
-#endif
+    vtkIdType firstPointId = cellAdditionalEndPointIds[2*i];
+    vtkIdType lastPointId = cellAdditionalEndPointIds[2*i+1];
     vtkIdType extendedNpts = npts;
-    if (tupleValue[0] != -1)
+    if (firstPointId != -1)
       {
       extendedNpts += 1;
       }
-    if (tupleValue[1] != -1)
+    if (lastPointId != -1)
       {
       extendedNpts += 1;
       }
     extendedOutputLines->InsertNextCell(extendedNpts);
-    if (tupleValue[0] != -1)
+    if (firstPointId != -1)
       {
-      extendedOutputLines->InsertCellPoint(tupleValue[0]);
+      extendedOutputLines->InsertCellPoint(firstPointId);
       }
     int j;
     for (j=0; j<npts; j++)
       {
       extendedOutputLines->InsertCellPoint(pts[j]);
       }
-    if (tupleValue[1] != -1)
+    if (lastPointId != -1)
       {
-      extendedOutputLines->InsertCellPoint(tupleValue[1]);
+      extendedOutputLines->InsertCellPoint(lastPointId);
       }
     }
 
   output->SetLines(extendedOutputLines);
 
-  nonBlankedGroupIds->Delete();
   resampledCenterlines->Delete();
   outputPoints->Delete();
   outputLines->Delete();
-  groupIdsToMergedCells->Delete();
-  cellEndPointIds->Delete();
 
   referenceSystemsFilter->Delete();
-  blankedGroupIds->Delete();
-  groupIdsToBifurcationPointIds->Delete();
-  cellAdditionalEndPointIds->Delete();
+  upStreamGroupIds->Delete();
+  downStreamGroupIds->Delete();
   extendedOutputLines->Delete();
  
   return 1;
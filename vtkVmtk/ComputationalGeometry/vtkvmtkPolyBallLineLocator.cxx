@@ -0,0 +1,355 @@
+/*=========================================================================
+
+Program:   VMTK
+Module:    $RCSfile: vtkvmtkPolyBallLineLocator.cxx,v $
+Language:  C++
+Date:      $Date: 2006/04/06 16:46:43 $
+Version:   $Revision: 1.4 $
+
+  Copyright (c) Luca Antiga, David Steinman. All rights reserved.
+  See LICENCE file for details.
+
+  Portions of this code are covered under the VTK copyright.
+  See VTKCopyright.txt or http://www.kitware.com/VTKCopyright.htm
+  for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+
+#include "vtkvmtkPolyBallLineLocator.h"
+#include "vtkvmtkConstants.h"
+#include "vtkvmtkPolyBallSegmentHierarchy.h"
+#include "vtkPointData.h"
+#include "vtkIdList.h"
+#include "vtkMath.h"
+#include "vtkObjectFactory.h"
+
+#include <algorithm>
+
+
+vtkStandardNewMacro(vtkvmtkPolyBallLineLocator);
+
+vtkvmtkPolyBallLineLocator::vtkvmtkPolyBallLineLocator()
+{
+  this->Input = NULL;
+  this->PolyBallRadiusArrayName = NULL;
+  this->UseRadiusInformation = 1;
+}
+
+vtkvmtkPolyBallLineLocator::~vtkvmtkPolyBallLineLocator()
+{
+  if (this->Input)
+    {
+    this->Input->Delete();
+    this->Input = NULL;
+    }
+
+  if (this->PolyBallRadiusArrayName)
+    {
+    delete[] this->PolyBallRadiusArrayName;
+    this->PolyBallRadiusArrayName = NULL;
+    }
+}
+
+int vtkvmtkPolyBallLineLocator::Build()
+{
+  this->NodeBounds.clear();
+  this->NodeMaxRadius.clear();
+  this->NodeFirst.clear();
+  this->NodeCount.clear();
+  this->Segments.clear();
+  this->SegmentCellIds.clear();
+  this->SegmentSubIds.clear();
+  this->CellRootNodes.clear();
+  this->CellNodeBounds.clear();
+  this->CellNodeMaxRadius.clear();
+  this->CellNodeFirst.clear();
+  this->CellNodeCount.clear();
+  this->CellSegmentIds.clear();
+
+  if (!this->Input)
+    {
+    vtkErrorMacro(<< "Input not set.");
+    return 0;
+    }
+
+  vtkDataArray* radiusArray = NULL;
+  if (this->UseRadiusInformation)
+    {
+    if (!this->PolyBallRadiusArrayName)
+      {
+      vtkErrorMacro(<< "PolyBallRadiusArrayName not set.");
+      return 0;
+      }
+    radiusArray = this->Input->GetPointData()->GetArray(this->PolyBallRadiusArrayName);
+    if (!radiusArray)
+      {
+      vtkErrorMacro(<< "PolyBallRadiusArray with name specified does not exist");
+      return 0;
+      }
+    }
+
+  this->Input->BuildCells();
+
+  vtkIdType numberOfInputCells = this->Input->GetNumberOfCells();
+
+  // segments in cell and point order
+  std::vector<double> segments;
+  std::vector<vtkIdType> segmentCellIds;
+  std::vector<vtkIdType> segmentSubIds;
+  std::vector<vtkIdType> cellSegmentOffsets(numberOfInputCells+1,0);
+  vtkIdType npts, *pts;
+  vtkIdType i;
+  for (i=0; i<numberOfInputCells; i++)
+    {
+    cellSegmentOffsets[i] = static_cast<vtkIdType>(segmentCellIds.size());
+    if (this->Input->GetCellType(i) != VTK_LINE && this->Input->GetCellType(i) != VTK_POLY_LINE)
+      {
+      continue;
+      }
+    this->Input->GetCellPoints(i,npts,pts);
+    for (vtkIdType j=0; j<npts-1; j++)
+      {
+      double segment[8];
+      this->Input->GetPoint(pts[j],segment);
+      this->Input->GetPoint(pts[j+1],segment+3);
+      segment[6] = radiusArray ? radiusArray->GetComponent(pts[j],0) : 0.0;
+      segment[7] = radiusArray ? radiusArray->GetComponent(pts[j+1],0) : 0.0;
+      segments.insert(segments.end(),segment,segment+8);
+      segmentCellIds.push_back(i);
+      segmentSubIds.push_back(j);
+      }
+    }
+
+  vtkIdType numberOfSegments = static_cast<vtkIdType>(segmentCellIds.size());
+  cellSegmentOffsets[numberOfInputCells] = numberOfSegments;
+
+  this->CellRootNodes.resize(numberOfInputCells,-1);
+
+  if (numberOfSegments == 0)
+    {
+    return 1;
+    }
+
+  // hierarchy of all segments, which are then stored in leaf order
+  std::vector<vtkIdType> order(numberOfSegments);
+  for (i=0; i<numberOfSegments; i++)
+    {
+    order[i] = i;
+    }
+
+  vtkvmtkPolyBallSegmentHierarchy::Build(&segments[0],&order[0],0,numberOfSegments,this->NodeBounds,this->NodeMaxRadius,this->NodeFirst,this->NodeCount);
+
+  this->Segments.resize(8*numberOfSegments);
+  this->SegmentCellIds.resize(numberOfSegments);
+  this->SegmentSubIds.resize(numberOfSegments);
+  this->CellSegmentIds.resize(numberOfSegments);
+  for (i=0; i<numberOfSegments; i++)
+    {
+    std::copy(&segments[8*order[i]],&segments[8*order[i]]+8,&this->Segments[8*i]);
+    this->SegmentCellIds[i] = segmentCellIds[order[i]];
+    this->SegmentSubIds[i] = segmentSubIds[order[i]];
+    this->CellSegmentIds[order[i]] = i;
+    }
+
+  // one hierarchy per cell, over the segments of the cell in leaf order
+  for (i=0; i<numberOfInputCells; i++)
+    {
+    if (cellSegmentOffsets[i+1] == cellSegmentOffsets[i])
+      {
+      continue;
+      }
+    this->CellRootNodes[i] = vtkvmtkPolyBallSegmentHierarchy::Build(&this->Segments[0],&this->CellSegmentIds[0],cellSegmentOffsets[i],cellSegmentOffsets[i+1],this->CellNodeBounds,this->CellNodeMaxRadius,this->CellNodeFirst,this->CellNodeCount);
+    }
+
+  return 1;
+}
+
+void vtkvmtkPolyBallLineLocator::VisitHierarchy(const double x[3], vtkIdType root, bool cellHierarchy, double& minValue, vtkIdType& cellId, vtkIdType& subId, double& pcoord, double center[3], double& centerRadius)
+{
+  const double* nodeBounds = cellHierarchy ? &this->CellNodeBounds[0] : &this->NodeBounds[0];
+  const double* nodeMaxRadius = cellHierarchy ? &this->CellNodeMaxRadius[0] : &this->NodeMaxRadius[0];
+  const vtkIdType* nodeFirst = cellHierarchy ? &this->CellNodeFirst[0] : &this->NodeFirst[0];
+  const vtkIdType* nodeCount = cellHierarchy ? &this->CellNodeCount[0] : &this->NodeCount[0];
+
+  vtkIdType stack[vtkvmtkPolyBallSegmentHierarchy::StackSize];
+  double stackBounds[vtkvmtkPolyBallSegmentHierarchy::StackSize];
+  int stackSize = 0;
+  stack[stackSize] = root;
+  stackBounds[stackSize++] = -VTK_DOUBLE_MAX;
+  while (stackSize > 0)
+    {
+    stackSize--;
+    vtkIdType node = stack[stackSize];
+    // bounds are strictly below the values of their segments, so segments
+    // tying with the minimum are never pruned
+    if (stackBounds[stackSize] >= minValue)
+      {
+      continue;
+      }
+    if (nodeCount[node] < 0)
+      {
+      vtkIdType first = nodeFirst[node];
+      vtkIdType last = first - nodeCount[node];
+      for (vtkIdType l=first; l<last; l++)
+        {
+        vtkIdType s = cellHierarchy ? this->CellSegmentIds[l] : l;
+        double value, t, closestPoint[4];
+        if (!vtkvmtkPolyBallSegmentHierarchy::SegmentValue(x,&this->Segments[8*s],value,t,closestPoint))
+          {
+          continue;
+          }
+        vtkIdType segmentCellId = this->SegmentCellIds[s];
+        vtkIdType segmentSubId = this->SegmentSubIds[s];
+        // first segment in cell and point order among equal values, as
+        // vtkvmtkPolyBallLine; a cell hierarchy only competes on ties with
+        // its own segments, cells visited before it come first
+        bool first = false;
+        if (value == minValue && cellId != -1)
+          {
+          if (cellHierarchy)
+            {
+            first = segmentCellId == cellId && segmentSubId < subId;
+            }
+          else
+            {
+            first = segmentCellId < cellId || (segmentCellId == cellId && segmentSubId < subId);
+            }
+          }
+        if (value < minValue || first)
+          {
+          minValue = value;
+          cellId = segmentCellId;
+          subId = segmentSubId;
+          pcoord = t;
+          center[0] = closestPoint[0];
+          center[1] = closestPoint[1];
+          center[2] = closestPoint[2];
+          centerRadius = closestPoint[3];
+          }
+        }
+      continue;
+      }
+    vtkIdType child = nodeFirst[node];
+    double bound0 = vtkvmtkPolyBallSegmentHierarchy::LowerBound(x,&nodeBounds[6*child],nodeMaxRadius[child]);
+    double bound1 = vtkvmtkPolyBallSegmentHierarchy::LowerBound(x,&nodeBounds[6*(child+1)],nodeMaxRadius[child+1]);
+    // visit the more promising child first
+    if (bound0 < bound1)
+      {
+      stack[stackSize] = child+1;
+      stackBounds[stackSize++] = bound1;
+      stack[stackSize] = child;
+      stackBounds[stackSize++] = bound0;
+      }
+    else
+      {
+      stack[stackSize] = child;
+      stackBounds[stackSize++] = bound0;
+      stack[stackSize] = child+1;
+      stackBounds[stackSize++] = bound1;
+      }
+    }
+}
+
+double vtkvmtkPolyBallLineLocator::EvaluateFunction(const double x[3], vtkIdType& cellId, vtkIdType& subId, double& pcoord, double center[3], double& centerRadius)
+{
+  double minValue = VTK_VMTK_LARGE_DOUBLE;
+  cellId = -1;
+  subId = -1;
+  pcoord = 0.0;
+  center[0] = center[1] = center[2] = 0.0;
+  centerRadius = 0.0;
+
+  if (this->NodeFirst.empty())
+    {
+    return minValue;
+    }
+
+  this->VisitHierarchy(x,0,false,minValue,cellId,subId,pcoord,center,centerRadius);
+
+  return minValue;
+}
+
+double vtkvmtkPolyBallLineLocator::EvaluateFunction(const double x[3], const vtkIdType* cellIds, vtkIdType numberOfCellIds, vtkIdType& cellId, vtkIdType& subId, double& pcoord, double center[3], double& centerRadius)
+{
+  double minValue = VTK_VMTK_LARGE_DOUBLE;
+  cellId = -1;
+  subId = -1;
+  pcoord = 0.0;
+  center[0] = center[1] = center[2] = 0.0;
+  centerRadius = 0.0;
+
+  vtkIdType numberOfInputCells = static_cast<vtkIdType>(this->CellRootNodes.size());
+  for (vtkIdType k=0; k<numberOfCellIds; k++)
+    {
+    vtkIdType inputCellId = cellIds[k];
+    if (inputCellId < 0 || inputCellId >= numberOfInputCells || this->CellRootNodes[inputCellId] == -1)
+      {
+      continue;
+      }
+    this->VisitHierarchy(x,this->CellRootNodes[inputCellId],true,minValue,cellId,subId,pcoord,center,centerRadius);
+    }
+
+  return minValue;
+}
+
+void vtkvmtkPolyBallLineLocator::FindTubeCells(const double x[3], vtkIdList* cellIds)
+{
+  cellIds->Initialize();
+
+  if (this->NodeFirst.empty())
+    {
+    return;
+    }
+
+  std::vector<vtkIdType> tubeCellIds;
+  vtkIdType stack[vtkvmtkPolyBallSegmentHierarchy::StackSize];
+  int stackSize = 0;
+  stack[stackSize++] = 0;
+  while (stackSize > 0)
+    {
+    vtkIdType node = stack[--stackSize];
+    // bounds are strictly below the values of their segments
+    if (vtkvmtkPolyBallSegmentHierarchy::LowerBound(x,&this->NodeBounds[6*node],this->NodeMaxRadius[node]) > 0.0)
+      {
+      continue;
+      }
+    if (this->NodeCount[node] < 0)
+      {
+      vtkIdType first = this->NodeFirst[node];
+      vtkIdType last = first - this->NodeCount[node];
+      for (vtkIdType s=first; s<last; s++)
+        {
+        double value, t, closestPoint[4];
+        if (!vtkvmtkPolyBallSegmentHierarchy::SegmentValue(x,&this->Segments[8*s],value,t,closestPoint))
+          {
+          continue;
+          }
+        if (value <= 0.0)
+          {
+          tubeCellIds.push_back(this->SegmentCellIds[s]);
+          }
+        }
+      continue;
+      }
+    stack[stackSize++] = this->NodeFirst[node];
+    stack[stackSize++] = this->NodeFirst[node]+1;
+    }
+
+  std::sort(tubeCellIds.begin(),tubeCellIds.end());
+  tubeCellIds.erase(std::unique(tubeCellIds.begin(),tubeCellIds.end()),tubeCellIds.end());
+
+  cellIds->SetNumberOfIds(static_cast<vtkIdType>(tubeCellIds.size()));
+  for (size_t i=0; i<tubeCellIds.size(); i++)
+    {
+    cellIds->SetId(static_cast<vtkIdType>(i),tubeCellIds[i]);
+    }
+}
+
+void vtkvmtkPolyBallLineLocator::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os,indent);
+}
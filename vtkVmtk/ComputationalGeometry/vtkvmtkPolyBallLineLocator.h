@@ -0,0 +1,124 @@
+/*=========================================================================
+
+Program:   VMTK
+Module:    $RCSfile: vtkvmtkPolyBallLineLocator.h,v $
+Language:  C++
+Date:      $Date: 2006/04/06 16:46:43 $
+Version:   $Revision: 1.4 $
+
+  Copyright (c) Luca Antiga, David Steinman. All rights reserved.
+  See LICENCE file for details.
+
+  Portions of this code are covered under the VTK copyright.
+  See VTKCopyright.txt or http://www.kitware.com/VTKCopyright.htm
+  for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+  // .NAME vtkvmtkPolyBallLineLocator - Thread safe evaluation of the vtkvmtkPolyBallLine function through a hierarchy of line segments.
+  // .SECTION Description
+  // The segments of the line cells of Input are kept in a bounding volume
+  // hierarchy, with the largest radius of each node, so that the poly ball
+  // line function of a point, and the segment attaining it, can be found
+  // without visiting every segment. Values, cell ids, sub ids, parametric
+  // coordinates and centers are those of vtkvmtkPolyBallLine::
+  // EvaluateFunction, including the choice of the first segment, in cell
+  // and point order, among segments attaining the same value.
+  //
+  // EvaluateFunction is thread safe after Build, so a single hierarchy can
+  // be shared by concurrent queries. The function can also be restricted to
+  // a list of cells, as with vtkvmtkPolyBallLine::SetInputCellIds, through
+  // a separate hierarchy for the segments of each cell.
+
+#ifndef __vtkvmtkPolyBallLineLocator_h
+#define __vtkvmtkPolyBallLineLocator_h
+
+#include "vtkObject.h"
+#include "vtkPolyData.h"
+#include "vtkvmtkWin32Header.h"
+
+#include <vector>
+
+class vtkIdList;
+
+class VTK_VMTK_COMPUTATIONAL_GEOMETRY_EXPORT vtkvmtkPolyBallLineLocator : public vtkObject
+{
+  public:
+  vtkTypeMacro(vtkvmtkPolyBallLineLocator,vtkObject);
+  void PrintSelf(ostream& os, vtkIndent indent) VTK_OVERRIDE;
+
+  static vtkvmtkPolyBallLineLocator *New();
+
+  vtkSetObjectMacro(Input,vtkPolyData);
+  vtkGetObjectMacro(Input,vtkPolyData);
+
+  vtkSetStringMacro(PolyBallRadiusArrayName);
+  vtkGetStringMacro(PolyBallRadiusArrayName);
+
+  vtkSetMacro(UseRadiusInformation,int);
+  vtkGetMacro(UseRadiusInformation,int);
+  vtkBooleanMacro(UseRadiusInformation,int);
+
+  // Description:
+  // Builds the segment hierarchy. Returns 0 if Input is not set or the
+  // radius array is missing.
+  int Build();
+
+  // Description:
+  // Thread safe, after Build. Returns the poly ball line function value at
+  // x, with the cell id, sub id and parametric coordinate of the closest
+  // segment, the poly ball center and its radius (VTK_VMTK_LARGE_DOUBLE
+  // and a cell id of -1 if there are no segments).
+  double EvaluateFunction(const double x[3], vtkIdType& cellId, vtkIdType& subId, double& pcoord, double center[3], double& centerRadius);
+
+  // Description:
+  // Thread safe, after Build. Same as above, restricted to the segments of
+  // the given cells. Among equal values the first segment in list and point
+  // order is chosen, as vtkvmtkPolyBallLine with InputCellIds set.
+  double EvaluateFunction(const double x[3], const vtkIdType* cellIds, vtkIdType numberOfCellIds, vtkIdType& cellId, vtkIdType& subId, double& pcoord, double center[3], double& centerRadius);
+
+  // Description:
+  // Thread safe, after Build. Fills cellIds with the cells whose poly ball
+  // line function is not positive at x, i.e. the cells whose tube contains
+  // x, in increasing order.
+  void FindTubeCells(const double x[3], vtkIdList* cellIds);
+
+  protected:
+  vtkvmtkPolyBallLineLocator();
+  ~vtkvmtkPolyBallLineLocator();
+
+  void VisitHierarchy(const double x[3], vtkIdType root, bool cellHierarchy, double& minValue, vtkIdType& cellId, vtkIdType& subId, double& pcoord, double center[3], double& centerRadius);
+
+  vtkPolyData* Input;
+  char* PolyBallRadiusArrayName;
+  int UseRadiusInformation;
+
+  // hierarchy: node bounds and largest radius, children (or first segment
+  // for leaves, with a negative count); segments in leaf order as end
+  // points and radii (8 values) with their cell and sub ids
+  std::vector<double> NodeBounds;
+  std::vector<double> NodeMaxRadius;
+  std::vector<vtkIdType> NodeFirst;
+  std::vector<vtkIdType> NodeCount;
+  std::vector<double> Segments;
+  std::vector<vtkIdType> SegmentCellIds;
+  std::vector<vtkIdType> SegmentSubIds;
+
+  // one hierarchy per input cell (root -1 if the cell has no segments),
+  // with leaves referring to ranges of segment indices in leaf order
+  std::vector<vtkIdType> CellRootNodes;
+  std::vector<double> CellNodeBounds;
+  std::vector<double> CellNodeMaxRadius;
+  std::vector<vtkIdType> CellNodeFirst;
+  std::vector<vtkIdType> CellNodeCount;
+  std::vector<vtkIdType> CellSegmentIds;
+
+  private:
+  vtkvmtkPolyBallLineLocator(const vtkvmtkPolyBallLineLocator&);  // Not implemented.
+  void operator=(const vtkvmtkPolyBallLineLocator&);  // Not implemented.
+};
+
+#endif
@@ -0,0 +1,240 @@
+/*=========================================================================
+
+  Program:   VMTK
+  Module:    $RCSfile: vtkvmtkPolyBallSegmentHierarchy.h,v $
+  Language:  C++
+  Date:      $Date: 2006/04/06 16:46:43 $
+  Version:   $Revision: 1.1 $
+
+  Copyright (c) Luca Antiga, David Steinman. All rights reserved.
+  See LICENCE file for details.
+
+  Portions of this code are covered under the VTK copyright.
+  See VTKCopyright.txt or http://www.kitware.com/VTKCopyright.htm
+  for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+// .NAME vtkvmtkPolyBallSegmentHierarchy - bounding volume hierarchy over poly ball line segments
+// .SECTION Description
+// Helpers shared by vtkvmtkPolyBallLineLocator and
+// vtkvmtkCenterlineGroupTubes. A segment is stored as 8 doubles: its two end
+// points followed by their radii. Nodes are stored in flat arrays: 6 bounds
+// and a maximum radius per node; inner nodes have NodeCount 0 and their two
+// children at NodeFirst and NodeFirst+1, leaves have NodeCount -n and refer
+// to the n items starting at NodeFirst. Not wrapped.
+
+#ifndef __vtkvmtkPolyBallSegmentHierarchy_h
+#define __vtkvmtkPolyBallSegmentHierarchy_h
+
+#include "vtkvmtkConstants.h"
+#include "vtkType.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+class vtkvmtkPolyBallSegmentHierarchy
+{
+public:
+
+  enum
+  {
+    SegmentsPerLeaf = 8,
+    // median splits keep the depth logarithmic, far below this for any
+    // number of segments representable in a vtkIdType
+    StackSize = 128
+  };
+
+  // Description:
+  // Poly ball function of a segment, evaluated as in
+  // vtkvmtkPolyBallLine::EvaluateFunction so that values match exactly.
+  // Returns 0 for degenerate segments, which vtkvmtkPolyBallLine skips.
+  static int SegmentValue(const double x[3], const double* segment, double& value, double& t, double closestPoint[4])
+    {
+    const double* point0 = segment;
+    const double* point1 = segment + 3;
+    double radius0 = segment[6];
+    double radius1 = segment[7];
+    double vector0[4], vector1[4];
+
+    vector0[0] = point1[0] - point0[0];
+    vector0[1] = point1[1] - point0[1];
+    vector0[2] = point1[2] - point0[2];
+    vector0[3] = radius1 - radius0;
+    vector1[0] = x[0] - point0[0];
+    vector1[1] = x[1] - point0[1];
+    vector1[2] = x[2] - point0[2];
+    vector1[3] = 0.0 - radius0;
+
+    double num = vector0[0]*vector1[0] + vector0[1]*vector1[1] + vector0[2]*vector1[2] - vector0[3]*vector1[3];
+    double den = vector0[0]*vector0[0] + vector0[1]*vector0[1] + vector0[2]*vector0[2] - vector0[3]*vector0[3];
+
+    if (fabs(den)<VTK_VMTK_DOUBLE_TOL)
+      {
+      return 0;
+      }
+
+    t = num / den;
+
+    if (t<VTK_VMTK_DOUBLE_TOL)
+      {
+      t = 0.0;
+      closestPoint[0] = point0[0];
+      closestPoint[1] = point0[1];
+      closestPoint[2] = point0[2];
+      closestPoint[3] = radius0;
+      }
+    else if (1.0-t<VTK_VMTK_DOUBLE_TOL)
+      {
+      t = 1.0;
+      closestPoint[0] = point1[0];
+      closestPoint[1] = point1[1];
+      closestPoint[2] = point1[2];
+      closestPoint[3] = radius1;
+      }
+    else
+      {
+      closestPoint[0] = point0[0] + t * vector0[0];
+      closestPoint[1] = point0[1] + t * vector0[1];
+      closestPoint[2] = point0[2] + t * vector0[2];
+      closestPoint[3] = radius0 + t * vector0[3];
+      }
+
+    value = (x[0]-closestPoint[0])*(x[0]-closestPoint[0]) + (x[1]-closestPoint[1])*(x[1]-closestPoint[1]) + (x[2]-closestPoint[2])*(x[2]-closestPoint[2]) - closestPoint[3]*closestPoint[3];
+
+    return 1;
+    }
+
+  // Description:
+  // Lower bound of the poly ball function of the segments in a node: the
+  // closest point lies within the node bounds and its radius is not larger
+  // than the largest one. The bound is loosened by a relative tolerance so
+  // that rounding never prunes a segment attaining the current minimum.
+  static double LowerBound(const double x[3], const double* bounds, double maxRadius)
+    {
+    double dist2 = 0.0;
+    for (int i=0; i<3; i++)
+      {
+      double d = 0.0;
+      if (x[i] < bounds[2*i])
+        {
+        d = bounds[2*i] - x[i];
+        }
+      else if (x[i] > bounds[2*i+1])
+        {
+        d = x[i] - bounds[2*i+1];
+        }
+      dist2 += d * d;
+      }
+    double maxRadius2 = maxRadius * maxRadius;
+    return dist2 - maxRadius2 - 1E-9 * (1.0 + dist2 + maxRadius2);
+    }
+
+  // Description:
+  // Appends to the node arrays a hierarchy over the segments in
+  // items[begin,end), split at the median of the segment midpoints along
+  // their largest extent. Leaves refer to ranges of items, which are
+  // reordered accordingly. Returns the root node.
+  static vtkIdType Build(const double* segments, vtkIdType* items, vtkIdType begin, vtkIdType end, std::vector<double>& nodeBounds, std::vector<double>& nodeMaxRadius, std::vector<vtkIdType>& nodeFirst, std::vector<vtkIdType>& nodeCount)
+    {
+    vtkIdType root = static_cast<vtkIdType>(nodeFirst.size());
+    nodeBounds.resize(6*(root+1));
+    nodeMaxRadius.push_back(0.0);
+    nodeFirst.push_back(0);
+    nodeCount.push_back(0);
+
+    std::vector<BuildItem> stack;
+    BuildItem rootItem = {root, begin, end};
+    stack.push_back(rootItem);
+    while (!stack.empty())
+      {
+      BuildItem item = stack.back();
+      stack.pop_back();
+
+      double bounds[6], centerBounds[6];
+      double maxRadius = 0.0;
+      bounds[0] = bounds[2] = bounds[4] = centerBounds[0] = centerBounds[2] = centerBounds[4] = VTK_DOUBLE_MAX;
+      bounds[1] = bounds[3] = bounds[5] = centerBounds[1] = centerBounds[3] = centerBounds[5] = -VTK_DOUBLE_MAX;
+      for (vtkIdType i=item.Begin; i<item.End; i++)
+        {
+        const double* segment = &segments[8*items[i]];
+        for (int k=0; k<3; k++)
+          {
+          bounds[2*k] = std::min(bounds[2*k],std::min(segment[k],segment[3+k]));
+          bounds[2*k+1] = std::max(bounds[2*k+1],std::max(segment[k],segment[3+k]));
+          double center = 0.5 * (segment[k] + segment[3+k]);
+          centerBounds[2*k] = std::min(centerBounds[2*k],center);
+          centerBounds[2*k+1] = std::max(centerBounds[2*k+1],center);
+          }
+        maxRadius = std::max(maxRadius,std::max(fabs(segment[6]),fabs(segment[7])));
+        }
+      std::copy(bounds,bounds+6,&nodeBounds[6*item.Node]);
+      nodeMaxRadius[item.Node] = maxRadius;
+
+      int axis = 0;
+      for (int k=1; k<3; k++)
+        {
+        if (centerBounds[2*k+1] - centerBounds[2*k] > centerBounds[2*axis+1] - centerBounds[2*axis])
+          {
+          axis = k;
+          }
+        }
+
+      vtkIdType count = item.End - item.Begin;
+      if (count <= SegmentsPerLeaf || centerBounds[2*axis+1] - centerBounds[2*axis] <= 0.0)
+        {
+        nodeFirst[item.Node] = item.Begin;
+        nodeCount[item.Node] = -count;
+        continue;
+        }
+
+      vtkIdType middle = item.Begin + count / 2;
+      CenterCompare compare(segments,axis);
+      std::nth_element(items+item.Begin,items+middle,items+item.End,compare);
+
+      vtkIdType child = static_cast<vtkIdType>(nodeFirst.size());
+      nodeFirst[item.Node] = child;
+      nodeCount[item.Node] = 0;
+      nodeFirst.resize(child+2,0);
+      nodeCount.resize(child+2,0);
+      nodeMaxRadius.resize(child+2,0.0);
+      nodeBounds.resize(6*(child+2));
+      BuildItem left = {child, item.Begin, middle};
+      BuildItem right = {child+1, middle, item.End};
+      stack.push_back(left);
+      stack.push_back(right);
+      }
+
+    return root;
+    }
+
+private:
+
+  struct BuildItem
+  {
+    vtkIdType Node;
+    vtkIdType Begin;
+    vtkIdType End;
+  };
+
+  class CenterCompare
+  {
+  public:
+    CenterCompare(const double* segments, int axis) : Segments(segments), Axis(axis) {}
+
+    bool operator()(vtkIdType s0, vtkIdType s1) const
+    {
+      return this->Segments[8*s0+this->Axis] + this->Segments[8*s0+3+this->Axis] < this->Segments[8*s1+this->Axis] + this->Segments[8*s1+3+this->Axis];
+    }
+
+  private:
+    const double* Segments;
+    int Axis;
+  };
+};
+
+#endif
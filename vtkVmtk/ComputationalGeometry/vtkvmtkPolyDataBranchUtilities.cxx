@@ -27,6 +27,9 @@ Version:   $Revision: 1.3 $
 #include "vtkIdList.h"
 #include "vtkObjectFactory.h"
 #include "vtkVersion.h"
+#include "vtkSMPTools.h"
+
+#include <vector>
 
 
 vtkStandardNewMacro(vtkvmtkPolyDataBranchUtilities);
@@ -76,6 +79,38 @@ void vtkvmtkPolyDataBranchUtilities::GetGroupsIdList(vtkPolyData* surface, const
   isGroupList->Delete();
 }
 
+// Flags the polys of surface whose points all belong to the group.
+class vtkvmtkPolyDataBranchUtilitiesGroupCellsFunctor
+{
+public:
+  vtkvmtkPolyDataBranchUtilitiesGroupCellsFunctor(vtkPolyData* surface, vtkDataArray* groupIdsArray, vtkIdType groupId, unsigned char* insertCells) :
+    Surface(surface), GroupIdsArray(groupIdsArray), GroupId(groupId), InsertCells(insertCells) {}
+
+  void operator()(vtkIdType begin, vtkIdType end)
+  {
+    vtkIdType npts, *pts;
+    for (vtkIdType j=begin; j<end; j++)
+      {
+      this->Surface->GetCellPoints(j,npts,pts);
+      unsigned char insertCell = 1;
+      for (int k=0; k<npts; k++)
+        {
+        if (this->GroupIdsArray->GetComponent(pts[k],0) != this->GroupId)
+          {
+          insertCell = 0;
+          break;
+          }
+        }
+      this->InsertCells[j] = insertCell;
+      }
+  }
+
+  vtkPolyData* Surface;
+  vtkDataArray* GroupIdsArray;
+  vtkIdType GroupId;
+  unsigned char* InsertCells;
+};
+
 void vtkvmtkPolyDataBranchUtilities::ExtractGroup(vtkPolyData* surface, const char* groupIdsArrayName, vtkIdType groupId, bool cleanGroupSurface, vtkPolyData* groupSurface)
 {
   groupSurface->DeepCopy(surface);
@@ -86,25 +121,24 @@ void vtkvmtkPolyDataBranchUtilities::ExtractGroup(vtkPolyData* surface, const ch
 
   surface->BuildCells();
 
+  // cells are tested concurrently and inserted in order
+  std::vector<unsigned char> insertCells(numberOfCells,0);
+  if (numberOfCells > 0)
+    {
+    vtkvmtkPolyDataBranchUtilitiesGroupCellsFunctor functor(surface,groupIdsArray,groupId,&insertCells[0]);
+    vtkSMPTools::For(0,numberOfCells,functor);
+    }
+
   vtkCellArray* polys = groupSurface->GetPolys();
   polys->Reset();
   vtkIdType npts, *pts;
   for (int j=0; j<numberOfCells; j++)
     {
-    surface->GetCellPoints(j,npts,pts);
-    bool insertCell = true;
-    for (int k=0; k<npts; k++)
-      {
-      if (static_cast<int>(groupIdsArray->GetComponent(pts[k],0) != groupId))
-        {
-        insertCell = false;
-        break;
-        }
-      }
-    if (!insertCell)
+    if (!insertCells[j])
       {
       continue;
       }
+    surface->GetCellPoints(j,npts,pts);
     polys->InsertNextCell(npts,pts);
     }
   polys->Squeeze();
@@ -23,7 +23,6 @@
 #include "vtkPointData.h"
 #include "vtkCellData.h"
 #include "vtkDoubleArray.h"
-#include "vtkvmtkPolyBallLine.h"
 #include "vtkCell.h"
 #include "vtkMath.h"
 #include "vtkvmtkConstants.h"
@@ -50,84 +49,19 @@ vtkvmtkPolyDataCenterlineAbscissaMetricFilter::~vtkvmtkPolyDataCenterlineAbsciss
 
 void vtkvmtkPolyDataCenterlineAbscissaMetricFilter::EvaluateMetric(vtkIdType pointId, double point[3], vtkIdType groupId, vtkDataArray* metricArray) 
 {
-  vtkDataArray* centerlineGroupIdsArray = this->Centerlines->GetCellData()->GetArray(this->CenterlineGroupIdsArrayName);
-  vtkDataArray* centerlineTractIdsArray = this->Centerlines->GetCellData()->GetArray(this->CenterlineTractIdsArrayName);
-  vtkDataArray* blankingArray = this->Centerlines->GetCellData()->GetArray(this->BlankingArrayName);
-  vtkDataArray* centerlineIdsArray = this->Centerlines->GetCellData()->GetArray(this->CenterlineIdsArrayName);
-
-  vtkvmtkPolyBallLine* tube = vtkvmtkPolyBallLine::New();
-  vtkIdList* centerlineGroupCellIds = vtkIdList::New();
-
-  tube->SetInput(this->Centerlines);
-  tube->SetInputCellIds(centerlineGroupCellIds);
-  tube->SetUseRadiusInformation(this->UseRadiusInformation);
-  if (this->UseRadiusInformation)
-    {
-    tube->SetPolyBallRadiusArrayName(this->RadiusArrayName);
-    }
+  std::vector<vtkIdType> centerlineCellIds;
+  std::vector<vtkIdType> centerlineSubIds;
+  std::vector<double> centerlinePCoords;
+  this->EvaluateGroupCellClosestPoints(pointId,point,groupId,centerlineCellIds,centerlineSubIds,centerlinePCoords);
 
   double averageAbscissa = 0.0;
   double weightSum = 0.0;
 
-  int numberOfCenterlineCells = this->Centerlines->GetNumberOfCells();
-  for (int i=0; i<numberOfCenterlineCells; i++)
+  for (size_t i=0; i<centerlineCellIds.size(); i++)
     {
-    int centerlineGroupId = static_cast<int>(centerlineGroupIdsArray->GetComponent(i,0));
-    if (centerlineGroupId != groupId)
-      {
-      continue;
-      }
-
-    centerlineGroupCellIds->Initialize();
-    centerlineGroupCellIds->InsertNextId(i);
-
-    if (this->IncludeBifurcations)
-      {
-      int centerlineId = static_cast<int>(centerlineIdsArray->GetComponent(i,0));
-      int centerlineTractId = static_cast<int>(centerlineTractIdsArray->GetComponent(i,0));
-
-      for (int j=0; j<numberOfCenterlineCells; j++)
-        {
-        if (j==i)
-          {
-          continue;
-          }
-
-        int adjacentCenterlineGroupId = static_cast<int>(centerlineGroupIdsArray->GetComponent(j,0));
-        int adjacentCenterlineId = static_cast<int>(centerlineIdsArray->GetComponent(j,0));
-        int adjacentCenterlineTractId = static_cast<int>(centerlineTractIdsArray->GetComponent(j,0));
-        int adjacentBlanking = static_cast<int>(blankingArray->GetComponent(j,0));
-        
-        if (adjacentBlanking == 0)
-          {
-          continue;
-          }
-
-        if (adjacentCenterlineGroupId == centerlineGroupId)
-          {
-          continue;
-          }
-
-        if (adjacentCenterlineId != centerlineId)
-          {
-          continue;
-          }
-        
-        if (!((adjacentCenterlineTractId == centerlineTractId - 1) || 
-              (adjacentCenterlineTractId == centerlineTractId + 1)))
-          {
-          continue;
-          }
-
-        centerlineGroupCellIds->InsertNextId(j);
-        }
-      }
-
-    tube->EvaluateFunction(point);
-
-    vtkIdType centerlineCellId = tube->GetLastPolyBallCellId();
-    vtkIdType centerlineSubId = tube->GetLastPolyBallCellSubId();
-    double centerlinePCoord = tube->GetLastPolyBallCellPCoord();
+    vtkIdType centerlineCellId = centerlineCellIds[i];
+    vtkIdType centerlineSubId = centerlineSubIds[i];
+    double centerlinePCoord = centerlinePCoords[i];
     double radius = 0.0;
     vtkvmtkCenterlineUtilities::InterpolateTuple1(this->Centerlines,this->RadiusArrayName,centerlineCellId,centerlineSubId,centerlinePCoord,radius);
     double weight = radius * radius;
@@ -142,7 +76,4 @@ void vtkvmtkPolyDataCenterlineAbscissaMetricFilter::EvaluateMetric(vtkIdType poi
   averageAbscissa /= weightSum;
 
   metricArray->SetComponent(pointId,0,averageAbscissa);
-
-  centerlineGroupCellIds->Delete();
-  tube->Delete();
 }
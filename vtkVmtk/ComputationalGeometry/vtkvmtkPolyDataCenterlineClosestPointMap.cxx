@@ -0,0 +1,433 @@
+/*=========================================================================
+
+Program:   VMTK
+Module:    $RCSfile: vtkvmtkPolyDataCenterlineClosestPointMap.cxx,v $
+Language:  C++
+Date:      $Date: 2006/04/06 16:46:43 $
+Version:   $Revision: 1.4 $
+
+  Copyright (c) Luca Antiga, David Steinman. All rights reserved.
+  See LICENCE file for details.
+
+  Portions of this code are covered under the VTK copyright.
+  See VTKCopyright.txt or http://www.kitware.com/VTKCopyright.htm
+  for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+
+#include "vtkvmtkPolyDataCenterlineClosestPointMap.h"
+#include "vtkvmtkPolyBallLineLocator.h"
+#include "vtkvmtkConstants.h"
+#include "vtkPointData.h"
+#include "vtkCellData.h"
+#include "vtkDataArray.h"
+#include "vtkMath.h"
+#include "vtkObjectFactory.h"
+#include "vtkSMPTools.h"
+
+#include <map>
+
+
+vtkStandardNewMacro(vtkvmtkPolyDataCenterlineClosestPointMap);
+
+vtkvmtkPolyDataCenterlineClosestPointMap::vtkvmtkPolyDataCenterlineClosestPointMap()
+{
+  this->Surface = NULL;
+  this->Centerlines = NULL;
+
+  this->UseRadiusInformation = 1;
+  this->RadiusArrayName = NULL;
+
+  this->GroupIdsArrayName = NULL;
+  this->CenterlineGroupIdsArrayName = NULL;
+
+  this->BlankingArrayName = NULL;
+  this->CenterlineIdsArrayName = NULL;
+  this->CenterlineTractIdsArrayName = NULL;
+}
+
+vtkvmtkPolyDataCenterlineClosestPointMap::~vtkvmtkPolyDataCenterlineClosestPointMap()
+{
+  if (this->Surface)
+    {
+    this->Surface->Delete();
+    this->Surface = NULL;
+    }
+
+  if (this->Centerlines)
+    {
+    this->Centerlines->Delete();
+    this->Centerlines = NULL;
+    }
+
+  if (this->RadiusArrayName)
+    {
+    delete[] this->RadiusArrayName;
+    this->RadiusArrayName = NULL;
+    }
+
+  if (this->GroupIdsArrayName)
+    {
+    delete[] this->GroupIdsArrayName;
+    this->GroupIdsArrayName = NULL;
+    }
+
+  if (this->CenterlineGroupIdsArrayName)
+    {
+    delete[] this->CenterlineGroupIdsArrayName;
+    this->CenterlineGroupIdsArrayName = NULL;
+    }
+
+  if (this->BlankingArrayName)
+    {
+    delete[] this->BlankingArrayName;
+    this->BlankingArrayName = NULL;
+    }
+
+  if (this->CenterlineIdsArrayName)
+    {
+    delete[] this->CenterlineIdsArrayName;
+    this->CenterlineIdsArrayName = NULL;
+    }
+
+  if (this->CenterlineTractIdsArrayName)
+    {
+    delete[] this->CenterlineTractIdsArrayName;
+    this->CenterlineTractIdsArrayName = NULL;
+    }
+}
+
+// Closest centerline points of a range of surface points: over all cells,
+// then over each group cell and over its adjacent blanked cells.
+class vtkvmtkPolyDataCenterlineClosestPointMapFunctor
+{
+public:
+  vtkvmtkPolyDataCenterlineClosestPointMapFunctor(vtkvmtkPolyBallLineLocator* locator, vtkPolyData* surface, vtkIdType numberOfPoints, const vtkIdType* groupCellOffsets, const vtkIdType* groupCellIds, const vtkIdType* bifurcationCellOffsets, const vtkIdType* bifurcationCellIds, vtkIdType* cellIds, vtkIdType* subIds, double* pcoords, double* values, double* distances) :
+    Locator(locator), Surface(surface), NumberOfPoints(numberOfPoints), GroupCellOffsets(groupCellOffsets), GroupCellIds(groupCellIds), BifurcationCellOffsets(bifurcationCellOffsets), BifurcationCellIds(bifurcationCellIds), CellIds(cellIds), SubIds(subIds), PCoords(pcoords), Values(values), Distances(distances) {}
+
+  void operator()(vtkIdType begin, vtkIdType end)
+  {
+    double point[3], center[3];
+    double value, pcoord, centerRadius;
+    vtkIdType cellId, subId;
+    for (vtkIdType i=begin; i<end; i++)
+      {
+      this->Surface->GetPoint(i,point);
+
+      value = this->Locator->EvaluateFunction(point,cellId,subId,pcoord,center,centerRadius);
+      this->Store(i,point,value,cellId,subId,pcoord,center);
+
+      for (vtkIdType e=this->GroupCellOffsets[i]; e<this->GroupCellOffsets[i+1]; e++)
+        {
+        vtkIdType groupCellId = this->GroupCellIds[e];
+        value = this->Locator->EvaluateFunction(point,&groupCellId,1,cellId,subId,pcoord,center,centerRadius);
+        this->Store(this->NumberOfPoints+2*e,point,value,cellId,subId,pcoord,center);
+
+        vtkIdType firstBifurcationCell = this->BifurcationCellOffsets[groupCellId];
+        vtkIdType numberOfBifurcationCells = this->BifurcationCellOffsets[groupCellId+1] - firstBifurcationCell;
+        value = this->Locator->EvaluateFunction(point,this->BifurcationCellIds+firstBifurcationCell,numberOfBifurcationCells,cellId,subId,pcoord,center,centerRadius);
+        this->Store(this->NumberOfPoints+2*e+1,point,value,cellId,subId,pcoord,center);
+        }
+      }
+  }
+
+private:
+  void Store(vtkIdType entryId, const double point[3], double value, vtkIdType cellId, vtkIdType subId, double pcoord, const double center[3])
+  {
+    this->CellIds[entryId] = cellId;
+    this->SubIds[entryId] = subId;
+    this->PCoords[entryId] = pcoord;
+    this->Values[entryId] = value;
+    this->Distances[entryId] = cellId != -1 ? sqrt(vtkMath::Distance2BetweenPoints(point,center)) : VTK_VMTK_LARGE_DOUBLE;
+  }
+
+  vtkvmtkPolyBallLineLocator* Locator;
+  vtkPolyData* Surface;
+  vtkIdType NumberOfPoints;
+  const vtkIdType* GroupCellOffsets;
+  const vtkIdType* GroupCellIds;
+  const vtkIdType* BifurcationCellOffsets;
+  const vtkIdType* BifurcationCellIds;
+  vtkIdType* CellIds;
+  vtkIdType* SubIds;
+  double* PCoords;
+  double* Values;
+  double* Distances;
+};
+
+void vtkvmtkPolyDataCenterlineClosestPointMap::Initialize()
+{
+  this->CellIds.clear();
+  this->SubIds.clear();
+  this->PCoords.clear();
+  this->Values.clear();
+  this->Distances.clear();
+  this->GroupCellOffsets.clear();
+  this->GroupCellIds.clear();
+}
+
+int vtkvmtkPolyDataCenterlineClosestPointMap::Update()
+{
+  if (!this->Surface)
+    {
+    vtkErrorMacro(<< "Surface not set.");
+    return 0;
+    }
+
+  if (!this->Centerlines)
+    {
+    vtkErrorMacro(<< "Centerlines not set.");
+    return 0;
+    }
+
+  if (this->BuildTime.GetMTime() > this->GetMTime() && this->BuildTime.GetMTime() > this->Surface->GetMTime() && this->BuildTime.GetMTime() > this->Centerlines->GetMTime())
+    {
+    return 1;
+    }
+
+  this->Initialize();
+
+  vtkDataArray* groupIdsArray = NULL;
+  vtkDataArray* centerlineGroupIdsArray = NULL;
+  if (this->GroupIdsArrayName && this->CenterlineGroupIdsArrayName)
+    {
+    groupIdsArray = this->Surface->GetPointData()->GetArray(this->GroupIdsArrayName);
+    if (!groupIdsArray)
+      {
+      vtkErrorMacro(<< "GroupIdsArray with name specified does not exist.");
+      return 0;
+      }
+
+    centerlineGroupIdsArray = this->Centerlines->GetCellData()->GetArray(this->CenterlineGroupIdsArrayName);
+    if (!centerlineGroupIdsArray)
+      {
+      vtkErrorMacro(<< "CenterlineGroupIdsArray with name specified does not exist.");
+      return 0;
+      }
+    }
+
+  vtkDataArray* blankingArray = NULL;
+  vtkDataArray* centerlineIdsArray = NULL;
+  vtkDataArray* centerlineTractIdsArray = NULL;
+  if (groupIdsArray && this->BlankingArrayName && this->CenterlineIdsArrayName && this->CenterlineTractIdsArrayName)
+    {
+    blankingArray = this->Centerlines->GetCellData()->GetArray(this->BlankingArrayName);
+    if (!blankingArray)
+      {
+      vtkErrorMacro(<< "BlankingArray with name specified does not exist.");
+      return 0;
+      }
+
+    centerlineIdsArray = this->Centerlines->GetCellData()->GetArray(this->CenterlineIdsArrayName);
+    if (!centerlineIdsArray)
+      {
+      vtkErrorMacro(<< "CenterlineIdsArray with name specified does not exist.");
+      return 0;
+      }
+
+    centerlineTractIdsArray = this->Centerlines->GetCellData()->GetArray(this->CenterlineTractIdsArrayName);
+    if (!centerlineTractIdsArray)
+      {
+      vtkErrorMacro(<< "CenterlineTractIdsArray with name specified does not exist.");
+      return 0;
+      }
+    }
+
+  vtkvmtkPolyBallLineLocator* locator = vtkvmtkPolyBallLineLocator::New();
+  locator->SetInput(this->Centerlines);
+  locator->SetUseRadiusInformation(this->UseRadiusInformation);
+  if (this->UseRadiusInformation)
+    {
+    locator->SetPolyBallRadiusArrayName(this->RadiusArrayName);
+    }
+  if (!locator->Build())
+    {
+    locator->Delete();
+    return 0;
+    }
+
+  vtkIdType numberOfPoints = this->Surface->GetNumberOfPoints();
+  vtkIdType numberOfCenterlineCells = this->Centerlines->GetNumberOfCells();
+
+  // centerline cells of each group, in cell order, and blanked cells adjacent
+  // to each cell along its centerline, as in the centerline metric filters
+  std::map<int,std::vector<vtkIdType> > centerlineGroupCellIds;
+  std::vector<vtkIdType> bifurcationCellOffsets(numberOfCenterlineCells+1,0);
+  std::vector<vtkIdType> bifurcationCellIds;
+  vtkIdType i, j;
+  for (i=0; i<numberOfCenterlineCells; i++)
+    {
+    bifurcationCellOffsets[i] = static_cast<vtkIdType>(bifurcationCellIds.size());
+
+    if (!centerlineGroupIdsArray)
+      {
+      continue;
+      }
+
+    int centerlineGroupId = static_cast<int>(centerlineGroupIdsArray->GetComponent(i,0));
+    centerlineGroupCellIds[centerlineGroupId].push_back(i);
+
+    if (!blankingArray)
+      {
+      continue;
+      }
+
+    int centerlineId = static_cast<int>(centerlineIdsArray->GetComponent(i,0));
+    int centerlineTractId = static_cast<int>(centerlineTractIdsArray->GetComponent(i,0));
+    for (j=0; j<numberOfCenterlineCells; j++)
+      {
+      if (j==i)
+        {
+        continue;
+        }
+
+      if (static_cast<int>(blankingArray->GetComponent(j,0)) == 0)
+        {
+        continue;
+        }
+
+      if (static_cast<int>(centerlineGroupIdsArray->GetComponent(j,0)) == centerlineGroupId)
+        {
+        continue;
+        }
+
+      if (static_cast<int>(centerlineIdsArray->GetComponent(j,0)) != centerlineId)
+        {
+        continue;
+        }
+
+      int adjacentCenterlineTractId = static_cast<int>(centerlineTractIdsArray->GetComponent(j,0));
+      if (!((adjacentCenterlineTractId == centerlineTractId - 1) || (adjacentCenterlineTractId == centerlineTractId + 1)))
+        {
+        continue;
+        }
+
+      bifurcationCellIds.push_back(j);
+      }
+    }
+  bifurcationCellOffsets[numberOfCenterlineCells] = static_cast<vtkIdType>(bifurcationCellIds.size());
+
+  this->GroupCellOffsets.resize(numberOfPoints+1,0);
+  for (i=0; i<numberOfPoints; i++)
+    {
+    this->GroupCellOffsets[i] = static_cast<vtkIdType>(this->GroupCellIds.size());
+
+    if (!groupIdsArray)
+      {
+      continue;
+      }
+
+    std::map<int,std::vector<vtkIdType> >::const_iterator it = centerlineGroupCellIds.find(static_cast<int>(groupIdsArray->GetComponent(i,0)));
+    if (it != centerlineGroupCellIds.end())
+      {
+      this->GroupCellIds.insert(this->GroupCellIds.end(),it->second.begin(),it->second.end());
+      }
+    }
+  this->GroupCellOffsets[numberOfPoints] = static_cast<vtkIdType>(this->GroupCellIds.size());
+
+  vtkIdType numberOfEntries = numberOfPoints + 2 * static_cast<vtkIdType>(this->GroupCellIds.size());
+  this->CellIds.resize(numberOfEntries);
+  this->SubIds.resize(numberOfEntries);
+  this->PCoords.resize(numberOfEntries);
+  this->Values.resize(numberOfEntries);
+  this->Distances.resize(numberOfEntries);
+
+  if (numberOfPoints > 0)
+    {
+    vtkvmtkPolyDataCenterlineClosestPointMapFunctor functor(locator,this->Surface,numberOfPoints,
+      &this->GroupCellOffsets[0],this->GroupCellIds.empty() ? NULL : &this->GroupCellIds[0],
+      &bifurcationCellOffsets[0],bifurcationCellIds.empty() ? NULL : &bifurcationCellIds[0],
+      &this->CellIds[0],&this->SubIds[0],&this->PCoords[0],&this->Values[0],&this->Distances[0]);
+    vtkSMPTools::For(0,numberOfPoints,functor);
+    }
+
+  locator->Delete();
+
+  this->BuildTime.Modified();
+
+  return 1;
+}
+
+vtkIdType vtkvmtkPolyDataCenterlineClosestPointMap::GetNumberOfPoints()
+{
+  if (this->GroupCellOffsets.empty())
+    {
+    return 0;
+    }
+  return static_cast<vtkIdType>(this->GroupCellOffsets.size()) - 1;
+}
+
+void vtkvmtkPolyDataCenterlineClosestPointMap::GetEntry(vtkIdType entryId, vtkIdType& cellId, vtkIdType& subId, double& pcoord, double& distance)
+{
+  if (entryId == -1)
+    {
+    cellId = -1;
+    subId = -1;
+    pcoord = 0.0;
+    distance = VTK_VMTK_LARGE_DOUBLE;
+    return;
+    }
+
+  cellId = this->CellIds[entryId];
+  subId = this->SubIds[entryId];
+  pcoord = this->PCoords[entryId];
+  distance = this->Distances[entryId];
+}
+
+void vtkvmtkPolyDataCenterlineClosestPointMap::GetClosestPoint(vtkIdType pointId, vtkIdType& cellId, vtkIdType& subId, double& pcoord, double& distance)
+{
+  this->GetEntry(pointId,cellId,subId,pcoord,distance);
+}
+
+void vtkvmtkPolyDataCenterlineClosestPointMap::GetGroupClosestPoint(vtkIdType pointId, vtkIdType& cellId, vtkIdType& subId, double& pcoord, double& distance)
+{
+  vtkIdType numberOfPoints = this->GetNumberOfPoints();
+  vtkIdType closestEntryId = -1;
+  for (vtkIdType e=this->GroupCellOffsets[pointId]; e<this->GroupCellOffsets[pointId+1]; e++)
+    {
+    vtkIdType entryId = numberOfPoints + 2 * e;
+    if (this->CellIds[entryId] == -1)
+      {
+      continue;
+      }
+    // first group cell among equal values
+    if (closestEntryId == -1 || this->Values[entryId] < this->Values[closestEntryId])
+      {
+      closestEntryId = entryId;
+      }
+    }
+
+  this->GetEntry(closestEntryId,cellId,subId,pcoord,distance);
+}
+
+vtkIdType vtkvmtkPolyDataCenterlineClosestPointMap::GetNumberOfGroupCells(vtkIdType pointId)
+{
+  return this->GroupCellOffsets[pointId+1] - this->GroupCellOffsets[pointId];
+}
+
+vtkIdType vtkvmtkPolyDataCenterlineClosestPointMap::GetGroupCellId(vtkIdType pointId, vtkIdType k)
+{
+  return this->GroupCellIds[this->GroupCellOffsets[pointId]+k];
+}
+
+void vtkvmtkPolyDataCenterlineClosestPointMap::GetGroupCellClosestPoint(vtkIdType pointId, vtkIdType k, int includeBifurcations, vtkIdType& cellId, vtkIdType& subId, double& pcoord, double& distance)
+{
+  vtkIdType entryId = this->GetNumberOfPoints() + 2 * (this->GroupCellOffsets[pointId] + k);
+  // the group cell comes first in the cell list of vtkvmtkPolyBallLine, so
+  // adjacent blanked cells only win if strictly closer
+  if (includeBifurcations && this->CellIds[entryId+1] != -1 && (this->CellIds[entryId] == -1 || this->Values[entryId+1] < this->Values[entryId]))
+    {
+    entryId += 1;
+    }
+
+  this->GetEntry(entryId,cellId,subId,pcoord,distance);
+}
+
+void vtkvmtkPolyDataCenterlineClosestPointMap::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os,indent);
+}
@@ -0,0 +1,159 @@
+/*=========================================================================
+
+Program:   VMTK
+Module:    $RCSfile: vtkvmtkPolyDataCenterlineClosestPointMap.h,v $
+Language:  C++
+Date:      $Date: 2006/04/06 16:46:43 $
+Version:   $Revision: 1.4 $
+
+  Copyright (c) Luca Antiga, David Steinman. All rights reserved.
+  See LICENCE file for details.
+
+  Portions of this code are covered under the VTK copyright.
+  See VTKCopyright.txt or http://www.kitware.com/VTKCopyright.htm
+  for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+  // .NAME vtkvmtkPolyDataCenterlineClosestPointMap - Cached closest centerline points of the points of a surface.
+  // .SECTION Description
+  // For every point of Surface, stores the cell id, sub id, parametric
+  // coordinate and distance of the closest point on Centerlines, in the
+  // sense of the vtkvmtkPolyBallLine function (with or without radius
+  // information). The map is computed in parallel by Update and kept until
+  // the map, Surface or Centerlines are modified, so that it can be shared
+  // by vtkvmtkPolyDataCenterlineAbscissaMetricFilter,
+  // vtkvmtkPolyDataCenterlineAngularMetricFilter,
+  // vtkvmtkPolyDataCenterlineProjection and
+  // vtkvmtkPolyDataReferenceSystemBoundaryMetricFilter working on the same
+  // surface.
+  //
+  // If GroupIdsArrayName and CenterlineGroupIdsArrayName are set, the closest
+  // point is also stored for each centerline cell of the group of the point,
+  // as evaluated by the centerline metric filters. If BlankingArrayName,
+  // CenterlineIdsArrayName and CenterlineTractIdsArrayName are set as well,
+  // the closest point on the blanked cells adjacent to each of those cells
+  // is stored too, so that queries with and without bifurcations are both
+  // answered by the same map. The map then holds two entries per group cell
+  // of each point, so its size grows as the number of points times the
+  // number of centerline cells in their groups.
+  //
+  // Filters given a map set on it the parameters they depend on, so the
+  // map is only recomputed when these differ from the cached ones.
+
+#ifndef __vtkvmtkPolyDataCenterlineClosestPointMap_h
+#define __vtkvmtkPolyDataCenterlineClosestPointMap_h
+
+#include "vtkObject.h"
+#include "vtkPolyData.h"
+#include "vtkvmtkWin32Header.h"
+
+#include <vector>
+
+class VTK_VMTK_COMPUTATIONAL_GEOMETRY_EXPORT vtkvmtkPolyDataCenterlineClosestPointMap : public vtkObject
+{
+  public:
+  vtkTypeMacro(vtkvmtkPolyDataCenterlineClosestPointMap,vtkObject);
+  void PrintSelf(ostream& os, vtkIndent indent) VTK_OVERRIDE;
+
+  static vtkvmtkPolyDataCenterlineClosestPointMap *New();
+
+  vtkSetObjectMacro(Surface,vtkPolyData);
+  vtkGetObjectMacro(Surface,vtkPolyData);
+
+  vtkSetObjectMacro(Centerlines,vtkPolyData);
+  vtkGetObjectMacro(Centerlines,vtkPolyData);
+
+  vtkSetMacro(UseRadiusInformation,int);
+  vtkGetMacro(UseRadiusInformation,int);
+  vtkBooleanMacro(UseRadiusInformation,int);
+
+  vtkSetStringMacro(RadiusArrayName);
+  vtkGetStringMacro(RadiusArrayName);
+
+  vtkSetStringMacro(GroupIdsArrayName);
+  vtkGetStringMacro(GroupIdsArrayName);
+
+  vtkSetStringMacro(CenterlineGroupIdsArrayName);
+  vtkGetStringMacro(CenterlineGroupIdsArrayName);
+
+  vtkSetStringMacro(BlankingArrayName);
+  vtkGetStringMacro(BlankingArrayName);
+
+  vtkSetStringMacro(CenterlineIdsArrayName);
+  vtkGetStringMacro(CenterlineIdsArrayName);
+
+  vtkSetStringMacro(CenterlineTractIdsArrayName);
+  vtkGetStringMacro(CenterlineTractIdsArrayName);
+
+  // Description:
+  // Computes the map if it is out of date with respect to its parameters,
+  // Surface and Centerlines. Returns 0 if inputs or arrays are missing.
+  int Update();
+
+  // Description:
+  // Number of surface points in the map.
+  vtkIdType GetNumberOfPoints();
+
+  // Description:
+  // Closest point over all centerline cells. The cell id is -1 if there
+  // are no centerline segments.
+  void GetClosestPoint(vtkIdType pointId, vtkIdType& cellId, vtkIdType& subId, double& pcoord, double& distance);
+
+  // Description:
+  // Closest point over the centerline cells of the group of the point, as
+  // vtkvmtkPolyBallLine with the group cell ids as input cell ids.
+  void GetGroupClosestPoint(vtkIdType pointId, vtkIdType& cellId, vtkIdType& subId, double& pcoord, double& distance);
+
+  // Description:
+  // Centerline cells of the group of the point, in cell order, and the
+  // closest point for each of them, with the adjacent blanked cells if
+  // includeBifurcations is set.
+  vtkIdType GetNumberOfGroupCells(vtkIdType pointId);
+  vtkIdType GetGroupCellId(vtkIdType pointId, vtkIdType k);
+  void GetGroupCellClosestPoint(vtkIdType pointId, vtkIdType k, int includeBifurcations, vtkIdType& cellId, vtkIdType& subId, double& pcoord, double& distance);
+
+  protected:
+  vtkvmtkPolyDataCenterlineClosestPointMap();
+  ~vtkvmtkPolyDataCenterlineClosestPointMap();
+
+  void Initialize();
+  void GetEntry(vtkIdType entryId, vtkIdType& cellId, vtkIdType& subId, double& pcoord, double& distance);
+
+  vtkPolyData* Surface;
+  vtkPolyData* Centerlines;
+
+  int UseRadiusInformation;
+  char* RadiusArrayName;
+
+  char* GroupIdsArrayName;
+  char* CenterlineGroupIdsArrayName;
+
+  char* BlankingArrayName;
+  char* CenterlineIdsArrayName;
+  char* CenterlineTractIdsArrayName;
+
+  // closest points: the first one of each surface point over all cells,
+  // then two for each group cell of each point, on the cell itself and on
+  // its adjacent blanked cells
+  std::vector<vtkIdType> CellIds;
+  std::vector<vtkIdType> SubIds;
+  std::vector<double> PCoords;
+  std::vector<double> Values;
+  std::vector<double> Distances;
+
+  // group cells of each surface point
+  std::vector<vtkIdType> GroupCellOffsets;
+  std::vector<vtkIdType> GroupCellIds;
+
+  vtkTimeStamp BuildTime;
+
+  private:
+  vtkvmtkPolyDataCenterlineClosestPointMap(const vtkvmtkPolyDataCenterlineClosestPointMap&);  // Not implemented.
+  void operator=(const vtkvmtkPolyDataCenterlineClosestPointMap&);  // Not implemented.
+};
+
+#endif
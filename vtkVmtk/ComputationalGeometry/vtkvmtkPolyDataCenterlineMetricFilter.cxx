@@ -24,12 +24,15 @@
 #include "vtkCellData.h"
 #include "vtkDoubleArray.h"
 #include "vtkvmtkPolyBallLine.h"
+#include "vtkvmtkPolyDataCenterlineClosestPointMap.h"
 #include "vtkCell.h"
 #include "vtkInformation.h"
 #include "vtkInformationVector.h"
 #include "vtkObjectFactory.h"
 
 
+vtkCxxSetObjectMacro(vtkvmtkPolyDataCenterlineMetricFilter,ClosestPointMap,vtkvmtkPolyDataCenterlineClosestPointMap);
+
 
 vtkvmtkPolyDataCenterlineMetricFilter::vtkvmtkPolyDataCenterlineMetricFilter() 
 {
@@ -47,6 +50,8 @@ vtkvmtkPolyDataCenterlineMetricFilter::vtkvmtkPolyDataCenterlineMetricFilter()
 
   this->UseRadiusInformation = 1;
   this->IncludeBifurcations = 1;
+
+  this->ClosestPointMap = NULL;
 }
 
 vtkvmtkPolyDataCenterlineMetricFilter::~vtkvmtkPolyDataCenterlineMetricFilter()
@@ -98,6 +103,12 @@ vtkvmtkPolyDataCenterlineMetricFilter::~vtkvmtkPolyDataCenterlineMetricFilter()
     delete[] this->CenterlineIdsArrayName;
     this->CenterlineIdsArrayName = NULL;
     }
+
+  if (this->ClosestPointMap)
+    {
+    this->ClosestPointMap->Delete();
+    this->ClosestPointMap = NULL;
+    }
 }
 
 int vtkvmtkPolyDataCenterlineMetricFilter::RequestData(
@@ -217,6 +228,39 @@ int vtkvmtkPolyDataCenterlineMetricFilter::RequestData(
 
   int numberOfInputPoints = input->GetNumberOfPoints();
 
+  if (this->ClosestPointMap)
+    {
+    if (!this->ClosestPointMap->GetSurface())
+      {
+      this->ClosestPointMap->SetSurface(input);
+      }
+    else if (this->ClosestPointMap->GetSurface() != input)
+      {
+      vtkErrorMacro(<<"ClosestPointMap is set on a surface other than the input.");
+      return 1;
+      }
+    this->ClosestPointMap->SetCenterlines(this->Centerlines);
+    this->ClosestPointMap->SetUseRadiusInformation(this->UseRadiusInformation);
+    if (this->UseRadiusInformation)
+      {
+      this->ClosestPointMap->SetRadiusArrayName(this->RadiusArrayName);
+      }
+    this->ClosestPointMap->SetGroupIdsArrayName(this->GroupIdsArrayName);
+    this->ClosestPointMap->SetCenterlineGroupIdsArrayName(this->CenterlineGroupIdsArrayName);
+    if (this->IncludeBifurcations)
+      {
+      this->ClosestPointMap->SetBlankingArrayName(this->BlankingArrayName);
+      this->ClosestPointMap->SetCenterlineIdsArrayName(this->CenterlineIdsArrayName);
+      this->ClosestPointMap->SetCenterlineTractIdsArrayName(this->CenterlineTractIdsArrayName);
+      }
+
+    if (!this->ClosestPointMap->Update())
+      {
+      vtkErrorMacro(<<"Could not update ClosestPointMap.");
+      return 1;
+      }
+    }
+
   output->DeepCopy(input);
 
   vtkDoubleArray* metricArray = vtkDoubleArray::New();
@@ -238,3 +282,105 @@ int vtkvmtkPolyDataCenterlineMetricFilter::RequestData(
 
   return 1;
 }
+
+void vtkvmtkPolyDataCenterlineMetricFilter::EvaluateGroupCellClosestPoints(vtkIdType pointId, double point[3], vtkIdType groupId, std::vector<vtkIdType>& cellIds, std::vector<vtkIdType>& subIds, std::vector<double>& pcoords)
+{
+  cellIds.clear();
+  subIds.clear();
+  pcoords.clear();
+
+  if (this->ClosestPointMap)
+    {
+    vtkIdType numberOfGroupCells = this->ClosestPointMap->GetNumberOfGroupCells(pointId);
+    for (vtkIdType k=0; k<numberOfGroupCells; k++)
+      {
+      vtkIdType centerlineCellId, centerlineSubId;
+      double centerlinePCoord, distance;
+      this->ClosestPointMap->GetGroupCellClosestPoint(pointId,k,this->IncludeBifurcations,centerlineCellId,centerlineSubId,centerlinePCoord,distance);
+      cellIds.push_back(centerlineCellId);
+      subIds.push_back(centerlineSubId);
+      pcoords.push_back(centerlinePCoord);
+      }
+    return;
+    }
+
+  vtkDataArray* centerlineGroupIdsArray = this->Centerlines->GetCellData()->GetArray(this->CenterlineGroupIdsArrayName);
+  vtkDataArray* centerlineTractIdsArray = this->Centerlines->GetCellData()->GetArray(this->CenterlineTractIdsArrayName);
+  vtkDataArray* blankingArray = this->Centerlines->GetCellData()->GetArray(this->BlankingArrayName);
+  vtkDataArray* centerlineIdsArray = this->Centerlines->GetCellData()->GetArray(this->CenterlineIdsArrayName);
+
+  vtkvmtkPolyBallLine* tube = vtkvmtkPolyBallLine::New();
+  vtkIdList* centerlineGroupCellIds = vtkIdList::New();
+
+  tube->SetInput(this->Centerlines);
+  tube->SetInputCellIds(centerlineGroupCellIds);
+  tube->SetUseRadiusInformation(this->UseRadiusInformation);
+  if (this->UseRadiusInformation)
+    {
+    tube->SetPolyBallRadiusArrayName(this->RadiusArrayName);
+    }
+
+  int numberOfCenterlineCells = this->Centerlines->GetNumberOfCells();
+  for (int i=0; i<numberOfCenterlineCells; i++)
+    {
+    int centerlineGroupId = static_cast<int>(centerlineGroupIdsArray->GetComponent(i,0));
+    if (centerlineGroupId != groupId)
+      {
+      continue;
+      }
+
+    centerlineGroupCellIds->Initialize();
+    centerlineGroupCellIds->InsertNextId(i);
+
+    if (this->IncludeBifurcations)
+      {
+      int centerlineId = static_cast<int>(centerlineIdsArray->GetComponent(i,0));
+      int centerlineTractId = static_cast<int>(centerlineTractIdsArray->GetComponent(i,0));
+
+      for (int j=0; j<numberOfCenterlineCells; j++)
+        {
+        if (j==i)
+          {
+          continue;
+          }
+
+        int adjacentCenterlineGroupId = static_cast<int>(centerlineGroupIdsArray->GetComponent(j,0));
+        int adjacentCenterlineId = static_cast<int>(centerlineIdsArray->GetComponent(j,0));
+        int adjacentCenterlineTractId = static_cast<int>(centerlineTractIdsArray->GetComponent(j,0));
+        int adjacentBlanking = static_cast<int>(blankingArray->GetComponent(j,0));
+        
+        if (adjacentBlanking == 0)
+          {
+          continue;
+          }
+
+        if (adjacentCenterlineGroupId == centerlineGroupId)
+          {
+          continue;
+          }
+
+        if (adjacentCenterlineId != centerlineId)
+          {
+          continue;
+          }
+        
+        if (!((adjacentCenterlineTractId == centerlineTractId - 1) || 
+              (adjacentCenterlineTractId == centerlineTractId + 1)))
+          {
+          continue;
+          }
+
+        centerlineGroupCellIds->InsertNextId(j);
+        }
+      }
+
+    tube->EvaluateFunction(point);
+
+    cellIds.push_back(tube->GetLastPolyBallCellId());
+    subIds.push_back(tube->GetLastPolyBallCellSubId());
+    pcoords.push_back(tube->GetLastPolyBallCellPCoord());
+    }
+
+  centerlineGroupCellIds->Delete();
+  tube->Delete();
+}
@@ -31,7 +31,10 @@
 
 #include "vtkPolyData.h"
 
+#include <vector>
+
 class vtkDataArray;
+class vtkvmtkPolyDataCenterlineClosestPointMap;
 
 class VTK_VMTK_COMPUTATIONAL_GEOMETRY_EXPORT vtkvmtkPolyDataCenterlineMetricFilter : public vtkPolyDataAlgorithm
 {
@@ -70,6 +73,14 @@ public:
   vtkGetMacro(IncludeBifurcations,int);
   vtkBooleanMacro(IncludeBifurcations,int);
 
+  // Description:
+  // Optional closest centerline points of the input, shared with other
+  // filters working on the same surface. The filter sets on the map the
+  // parameters it depends on and only recomputes it if they changed. The
+  // map Surface must be the input itself; it is set to the input if unset.
+  virtual void SetClosestPointMap(vtkvmtkPolyDataCenterlineClosestPointMap*);
+  vtkGetObjectMacro(ClosestPointMap,vtkvmtkPolyDataCenterlineClosestPointMap);
+
 protected:
   vtkvmtkPolyDataCenterlineMetricFilter();
   ~vtkvmtkPolyDataCenterlineMetricFilter();
@@ -78,6 +89,12 @@ protected:
 
   virtual void EvaluateMetric(vtkIdType pointId, double point[3], vtkIdType groupId, vtkDataArray* metricArray) = 0;
 
+  // Description:
+  // Closest point on each centerline cell of the group, together with its
+  // adjacent blanked cells if IncludeBifurcations is on, from
+  // ClosestPointMap if set.
+  void EvaluateGroupCellClosestPoints(vtkIdType pointId, double point[3], vtkIdType groupId, std::vector<vtkIdType>& cellIds, std::vector<vtkIdType>& subIds, std::vector<double>& pcoords);
+
   char* MetricArrayName;
   char* BlankingArrayName;
 
@@ -93,6 +110,8 @@ protected:
   int UseRadiusInformation;
   int IncludeBifurcations;
 
+  vtkvmtkPolyDataCenterlineClosestPointMap* ClosestPointMap;
+
 private:
   vtkvmtkPolyDataCenterlineMetricFilter(const vtkvmtkPolyDataCenterlineMetricFilter&);  // Not implemented.
   void operator=(const vtkvmtkPolyDataCenterlineMetricFilter&);  // Not implemented.
@@ -21,14 +21,18 @@
 
 #include "vtkvmtkPolyDataCenterlineProjection.h"
 #include "vtkPointData.h"
-#include "vtkvmtkPolyBallLine.h"
-#include "vtkCell.h"
+#include "vtkvmtkPolyBallLineLocator.h"
+#include "vtkvmtkPolyDataCenterlineClosestPointMap.h"
 #include "vtkInformation.h"
 #include "vtkInformationVector.h"
 #include "vtkObjectFactory.h"
+#include "vtkSMPTools.h"
+
+#include <vector>
 
 
 vtkStandardNewMacro(vtkvmtkPolyDataCenterlineProjection);
+vtkCxxSetObjectMacro(vtkvmtkPolyDataCenterlineProjection,ClosestPointMap,vtkvmtkPolyDataCenterlineClosestPointMap);
 
 vtkvmtkPolyDataCenterlineProjection::vtkvmtkPolyDataCenterlineProjection() 
 {
@@ -36,6 +40,8 @@ vtkvmtkPolyDataCenterlineProjection::vtkvmtkPolyDataCenterlineProjection()
   this->CenterlineRadiusArrayName = NULL;
 
   this->UseRadiusInformation = 1;
+
+  this->ClosestPointMap = NULL;
 }
 
 vtkvmtkPolyDataCenterlineProjection::~vtkvmtkPolyDataCenterlineProjection()
@@ -51,8 +57,56 @@ vtkvmtkPolyDataCenterlineProjection::~vtkvmtkPolyDataCenterlineProjection()
     delete[] this->CenterlineRadiusArrayName;
     this->CenterlineRadiusArrayName = NULL;
     }
+
+  if (this->ClosestPointMap)
+    {
+    this->ClosestPointMap->Delete();
+    this->ClosestPointMap = NULL;
+    }
 }
 
+// Closest centerline point id of each input point: the end of the closest
+// segment nearest to the poly ball center.
+class vtkvmtkPolyDataCenterlineProjectionFunctor
+{
+public:
+  vtkvmtkPolyDataCenterlineProjectionFunctor(vtkvmtkPolyBallLineLocator* locator, vtkPolyData* input, vtkPolyData* centerlines, vtkIdType* centerlinePointIds) :
+    Locator(locator), Input(input), Centerlines(centerlines), CenterlinePointIds(centerlinePointIds) {}
+
+  void operator()(vtkIdType begin, vtkIdType end)
+  {
+    double point[3], center[3];
+    vtkIdType cellId, subId;
+    double pcoord, centerRadius;
+    vtkIdType npts, *pts;
+    for (vtkIdType i=begin; i<end; i++)
+      {
+      this->Input->GetPoint(i,point);
+      this->Locator->EvaluateFunction(point,cellId,subId,pcoord,center,centerRadius);
+      this->CenterlinePointIds[i] = -1;
+      if (cellId == -1)
+        {
+        continue;
+        }
+      this->Centerlines->GetCellPoints(cellId,npts,pts);
+      if (pcoord < 0.5)
+        {
+        this->CenterlinePointIds[i] = pts[subId];
+        }
+      else
+        {
+        this->CenterlinePointIds[i] = pts[subId+1];
+        }
+      }
+  }
+
+private:
+  vtkvmtkPolyBallLineLocator* Locator;
+  vtkPolyData* Input;
+  vtkPolyData* Centerlines;
+  vtkIdType* CenterlinePointIds;
+};
+
 int vtkvmtkPolyDataCenterlineProjection::RequestData(
   vtkInformation *vtkNotUsed(request),
   vtkInformationVector **inputVector,
@@ -98,43 +152,80 @@ int vtkvmtkPolyDataCenterlineProjection::RequestData(
 
   outputPointData->InterpolateAllocate(referencePointData,numberOfInputPoints);
 
-  vtkvmtkPolyBallLine* tube = vtkvmtkPolyBallLine::New();
-  tube->SetInput(this->Centerlines);
-  tube->SetUseRadiusInformation(this->UseRadiusInformation);
-  if (this->UseRadiusInformation)
+  std::vector<vtkIdType> centerlinePointIds(numberOfInputPoints,-1);
+  if (this->ClosestPointMap)
     {
-    tube->SetPolyBallRadiusArrayName(this->CenterlineRadiusArrayName);
-    }
+    if (!this->ClosestPointMap->GetSurface())
+      {
+      this->ClosestPointMap->SetSurface(input);
+      }
+    else if (this->ClosestPointMap->GetSurface() != input)
+      {
+      vtkErrorMacro(<<"ClosestPointMap is set on a surface other than the input.");
+      return 1;
+      }
+    this->ClosestPointMap->SetCenterlines(this->Centerlines);
+    this->ClosestPointMap->SetUseRadiusInformation(this->UseRadiusInformation);
+    if (this->UseRadiusInformation)
+      {
+      this->ClosestPointMap->SetRadiusArrayName(this->CenterlineRadiusArrayName);
+      }
 
-  double point[3];
-  for (int i=0; i<numberOfInputPoints; i++)
+    if (!this->ClosestPointMap->Update())
+      {
+      vtkErrorMacro(<<"Could not update ClosestPointMap.");
+      return 1;
+      }
+
+    vtkIdType cellId, subId;
+    double pcoord, distance;
+    vtkIdType npts, *pts;
+    for (int i=0; i<numberOfInputPoints; i++)
+      {
+      this->ClosestPointMap->GetClosestPoint(i,cellId,subId,pcoord,distance);
+      if (cellId == -1)
+        {
+        continue;
+        }
+      this->Centerlines->GetCellPoints(cellId,npts,pts);
+      centerlinePointIds[i] = pcoord < 0.5 ? pts[subId] : pts[subId+1];
+      }
+    }
+  else
     {
-    input->GetPoint(i,point);
-    tube->EvaluateFunction(point);
-    vtkIdType cellId = tube->GetLastPolyBallCellId();
-    vtkIdType subId = tube->GetLastPolyBallCellSubId();
-    double pcoord = tube->GetLastPolyBallCellPCoord();
-    vtkCell* cell = this->Centerlines->GetCell(cellId);
-//  FIXME: for some reason EvaluateLocation fails on the PolyLine - weights are funny. Copy from the closest subId for the moment.
-//    double pcoords[3];
-//    pcoords[0] = pcoord;
-//    pcoords[1] = pcoords[2] = 0.0;
-//    double* weights = new double[cell->GetNumberOfPoints()];
-//    double locationPoint[3];
-//    cell->EvaluateLocation(subId,pcoords,locationPoint,weights);
-//    outputPointData->InterpolatePoint(referencePointData,i,cell->GetPointIds(),weights); 
-//    delete[] weights;
-    if (pcoord < 0.5)
+    vtkvmtkPolyBallLineLocator* locator = vtkvmtkPolyBallLineLocator::New();
+    locator->SetInput(this->Centerlines);
+    locator->SetUseRadiusInformation(this->UseRadiusInformation);
+    if (this->UseRadiusInformation)
       {
-      outputPointData->CopyData(referencePointData,cell->GetPointId(subId),i);
+      locator->SetPolyBallRadiusArrayName(this->CenterlineRadiusArrayName);
       }
-    else
+    if (!locator->Build())
       {
-      outputPointData->CopyData(referencePointData,cell->GetPointId(subId+1),i);
+      vtkErrorMacro(<<"Could not build the centerline locator.");
+      locator->Delete();
+      return 1;
       }
+
+    if (numberOfInputPoints > 0)
+      {
+      vtkvmtkPolyDataCenterlineProjectionFunctor functor(locator,input,this->Centerlines,&centerlinePointIds[0]);
+      vtkSMPTools::For(0,numberOfInputPoints,functor);
+      }
+
+    locator->Delete();
     }
 
-  tube->Delete();
+//  FIXME: for some reason EvaluateLocation fails on the PolyLine - weights are funny. Copy from the closest subId for the moment.
+  for (int i=0; i<numberOfInputPoints; i++)
+    {
+    if (centerlinePointIds[i] == -1)
+      {
+      outputPointData->NullPoint(i);
+      continue;
+      }
+    outputPointData->CopyData(referencePointData,centerlinePointIds[i],i);
+    }
 
   return 1;
 }
@@ -31,6 +31,8 @@
 
 #include "vtkPolyData.h"
 
+class vtkvmtkPolyDataCenterlineClosestPointMap;
+
 class VTK_VMTK_COMPUTATIONAL_GEOMETRY_EXPORT vtkvmtkPolyDataCenterlineProjection : public vtkPolyDataAlgorithm
 {
 public:
@@ -47,6 +49,14 @@ public:
   vtkSetStringMacro(CenterlineRadiusArrayName);
   vtkGetStringMacro(CenterlineRadiusArrayName);
 
+  // Description:
+  // Optional closest centerline points of the input, shared with other
+  // filters working on the same surface. The filter sets on the map the
+  // parameters it depends on and only recomputes it if they changed. The
+  // map Surface must be the input itself; it is set to the input if unset.
+  virtual void SetClosestPointMap(vtkvmtkPolyDataCenterlineClosestPointMap*);
+  vtkGetObjectMacro(ClosestPointMap,vtkvmtkPolyDataCenterlineClosestPointMap);
+
 protected:
   vtkvmtkPolyDataCenterlineProjection();
   ~vtkvmtkPolyDataCenterlineProjection();
@@ -59,6 +69,8 @@ protected:
 
   int UseRadiusInformation;
 
+  vtkvmtkPolyDataCenterlineClosestPointMap* ClosestPointMap;
+
 private:
   vtkvmtkPolyDataCenterlineProjection(const vtkvmtkPolyDataCenterlineProjection&);  // Not implemented.
   void operator=(const vtkvmtkPolyDataCenterlineProjection&);  // Not implemented.
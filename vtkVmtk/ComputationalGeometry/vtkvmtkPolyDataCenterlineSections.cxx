@@ -21,6 +21,7 @@ Version:   $Revision: 1.1 $
 
 #include "vtkvmtkPolyDataCenterlineSections.h"
 #include "vtkvmtkPolyDataBranchSections.h"
+#include "vtkvmtkPolyDataSectionLocator.h"
 #include "vtkPolyData.h"
 #include "vtkPolyLine.h"
 #include "vtkPolygon.h"
@@ -42,10 +43,13 @@ Version:   $Revision: 1.1 $
 #include "vtkInformation.h"
 #include "vtkInformationVector.h"
 #include "vtkObjectFactory.h"
+#include "vtkSMPTools.h"
 
 #include "vtkvmtkCenterlineUtilities.h"
 #include "vtkvmtkPolyDataBranchUtilities.h"
 
+#include <vector>
+
 
 vtkStandardNewMacro(vtkvmtkPolyDataCenterlineSections);
 
@@ -58,6 +62,8 @@ vtkvmtkPolyDataCenterlineSections::vtkvmtkPolyDataCenterlineSections()
   this->CenterlineSectionMaxSizeArrayName = NULL;
   this->CenterlineSectionShapeArrayName = NULL;
   this->CenterlineSectionClosedArrayName = NULL;
+
+  this->UseSectionLocator = 0;
 }
 
 vtkvmtkPolyDataCenterlineSections::~vtkvmtkPolyDataCenterlineSections()
@@ -204,11 +210,32 @@ int vtkvmtkPolyDataCenterlineSections::RequestData(
   centerlineShapeArray->SetNumberOfTuples(numberOfCenterlinePoints);
   centerlineClosedArray->SetNumberOfTuples(numberOfCenterlinePoints);
 
-  int numberOfCenterlineCells = this->Centerlines->GetNumberOfCells();
-  int i;
-  for (i=0; i<numberOfCenterlineCells; i++)
+  vtkvmtkPolyDataSectionLocator* sectionLocator = NULL;
+  if (this->UseSectionLocator)
+  {
+    sectionLocator = vtkvmtkPolyDataSectionLocator::New();
+    sectionLocator->SetSurface(input);
+    if (!sectionLocator->Build())
+    {
+      vtkWarningMacro(<<"Surface is not triangulated, sections are extracted by cutting the whole surface.");
+      sectionLocator->Delete();
+      sectionLocator = NULL;
+    }
+  }
+
+  if (sectionLocator)
   {
-    this->ComputeCenterlineSections(input,i,output);
+    this->ComputeLocatorCenterlineSections(sectionLocator,output);
+    sectionLocator->Delete();
+  }
+  else
+  {
+    int numberOfCenterlineCells = this->Centerlines->GetNumberOfCells();
+    int i;
+    for (i=0; i<numberOfCenterlineCells; i++)
+    {
+      this->ComputeCenterlineSections(input,i,output);
+    }
   }
 
   outputPoints->Delete();
@@ -229,6 +256,44 @@ int vtkvmtkPolyDataCenterlineSections::RequestData(
   return 1;
 }
 
+void vtkvmtkPolyDataCenterlineSections::ComputeCenterlineTangent(vtkPoints* centerlineCellPoints, int pointId, double tangent[3])
+{
+  int numberOfCellPoints = centerlineCellPoints->GetNumberOfPoints();
+
+  tangent[0] = tangent[1] = tangent[2] = 0.0;
+
+  double weightSum = 0.0;
+  if (pointId>0)
+  {
+    double point0[3], point1[3];
+    centerlineCellPoints->GetPoint(pointId-1,point0);
+    centerlineCellPoints->GetPoint(pointId,point1);
+    double distance = sqrt(vtkMath::Distance2BetweenPoints(point0,point1));
+    tangent[0] += (point1[0] - point0[0]) / distance;
+    tangent[1] += (point1[1] - point0[1]) / distance;
+    tangent[2] += (point1[2] - point0[2]) / distance;
+    weightSum += 1.0;
+  }
+
+  if (pointId<numberOfCellPoints-1)
+  {
+    double point0[3], point1[3];
+    centerlineCellPoints->GetPoint(pointId,point0);
+    centerlineCellPoints->GetPoint(pointId+1,point1);
+    double distance = sqrt(vtkMath::Distance2BetweenPoints(point0,point1));
+    tangent[0] += (point1[0] - point0[0]) / distance;
+    tangent[1] += (point1[1] - point0[1]) / distance;
+    tangent[2] += (point1[2] - point0[2]) / distance;
+    weightSum += 1.0;
+  }
+
+  tangent[0] /= weightSum;
+  tangent[1] /= weightSum;
+  tangent[2] /= weightSum;
+
+  vtkMath::Normalize(tangent);
+}
+
 void vtkvmtkPolyDataCenterlineSections::ComputeCenterlineSections(vtkPolyData* input, int cellId, vtkPolyData* output)
 {
   vtkPoints* centerlineSectionPoints = output->GetPoints();
@@ -260,38 +325,7 @@ void vtkvmtkPolyDataCenterlineSections::ComputeCenterlineSections(vtkPolyData* i
     centerlineCellPoints->GetPoint(i,point);
 
     double tangent[3];
-    tangent[0] = tangent[1] = tangent[2] = 0.0;
-
-    double weightSum = 0.0;
-    if (i>0)
-    {
-      double point0[3], point1[3];
-      centerlineCellPoints->GetPoint(i-1,point0);
-      centerlineCellPoints->GetPoint(i,point1);
-      double distance = sqrt(vtkMath::Distance2BetweenPoints(point0,point1));
-      tangent[0] += (point1[0] - point0[0]) / distance;
-      tangent[1] += (point1[1] - point0[1]) / distance;
-      tangent[2] += (point1[2] - point0[2]) / distance;
-      weightSum += 1.0;
-    }
-
-    if (i<numberOfCellPoints-1)
-    {
-      double point0[3], point1[3];
-      centerlineCellPoints->GetPoint(i,point0);
-      centerlineCellPoints->GetPoint(i+1,point1);
-      double distance = sqrt(vtkMath::Distance2BetweenPoints(point0,point1));
-      tangent[0] += (point1[0] - point0[0]) / distance;
-      tangent[1] += (point1[1] - point0[1]) / distance;
-      tangent[2] += (point1[2] - point0[2]) / distance;
-      weightSum += 1.0;
-    }
-
-    tangent[0] /= weightSum;
-    tangent[1] /= weightSum;
-    tangent[2] /= weightSum;
-
-    vtkMath::Normalize(tangent);
+    this->ComputeCenterlineTangent(centerlineCellPoints,i,tangent);
 
     //now cut branch with plane and get section. Compute section properties and store them.
 
@@ -331,6 +365,156 @@ void vtkvmtkPolyDataCenterlineSections::ComputeCenterlineSections(vtkPolyData* i
   }  
 }
 
+class vtkvmtkPolyDataCenterlineSectionsFunctor
+{
+public:
+  vtkvmtkPolyDataSectionLocator* SectionLocator;
+  const double* Origins;
+  const double* Normals;
+  std::vector<double>* SectionPoints;
+  double* Areas;
+  double* SizeRanges;
+  double* Shapes;
+  int* Closed;
+
+  void operator()(vtkIdType begin, vtkIdType end)
+  {
+    std::vector<vtkIdType> edgePointIds;
+    std::vector<double> edgeParameters;
+    for (vtkIdType s=begin; s<end; s++)
+    {
+      bool closed = false;
+      vtkIdType numberOfSectionPoints = this->SectionLocator->ExtractSection(this->Origins+3*s,this->Normals+3*s,this->SectionPoints[s],edgePointIds,edgeParameters,closed);
+      this->Closed[s] = closed;
+
+      if (numberOfSectionPoints == 0)
+      {
+        this->Areas[s] = 0.0;
+        this->SizeRanges[2*s] = this->SizeRanges[2*s+1] = 0.0;
+        this->Shapes[s] = 0.0;
+        continue;
+      }
+
+      vtkPoints* sectionPoints = vtkPoints::New();
+      sectionPoints->SetNumberOfPoints(numberOfSectionPoints);
+      vtkCellArray* sectionPolys = vtkCellArray::New();
+      sectionPolys->InsertNextCell(numberOfSectionPoints);
+      for (vtkIdType k=0; k<numberOfSectionPoints; k++)
+      {
+        sectionPoints->SetPoint(k,&this->SectionPoints[s][3*k]);
+        sectionPolys->InsertCellPoint(k);
+      }
+
+      vtkPolyData* section = vtkPolyData::New();
+      section->SetPoints(sectionPoints);
+      section->SetPolys(sectionPolys);
+
+      double center[3];
+      center[0] = this->Origins[3*s];
+      center[1] = this->Origins[3*s+1];
+      center[2] = this->Origins[3*s+2];
+      this->Areas[s] = vtkvmtkPolyDataBranchSections::ComputeBranchSectionArea(section);
+      this->Shapes[s] = vtkvmtkPolyDataBranchSections::ComputeBranchSectionShape(section,center,this->SizeRanges+2*s);
+
+      section->Delete();
+      sectionPoints->Delete();
+      sectionPolys->Delete();
+    }
+  }
+};
+
+// Same sections as ComputeCenterlineSections for all centerline cells, in
+// the same order, extracted in parallel with the section locator.
+void vtkvmtkPolyDataCenterlineSections::ComputeLocatorCenterlineSections(vtkvmtkPolyDataSectionLocator* sectionLocator, vtkPolyData* output)
+{
+  vtkPoints* centerlineSectionPoints = output->GetPoints();
+  vtkCellArray* centerlineSectionPolys = output->GetPolys();
+
+  vtkDoubleArray* centerlineSectionAreaArray = vtkDoubleArray::SafeDownCast(output->GetCellData()->GetArray(this->CenterlineSectionAreaArrayName));
+  vtkDoubleArray* centerlineSectionMinSizeArray = vtkDoubleArray::SafeDownCast(output->GetCellData()->GetArray(this->CenterlineSectionMinSizeArrayName));
+  vtkDoubleArray* centerlineSectionMaxSizeArray = vtkDoubleArray::SafeDownCast(output->GetCellData()->GetArray(this->CenterlineSectionMaxSizeArrayName));
+  vtkDoubleArray* centerlineSectionShapeArray = vtkDoubleArray::SafeDownCast(output->GetCellData()->GetArray(this->CenterlineSectionShapeArrayName));
+  vtkIntArray* centerlineSectionClosedArray = vtkIntArray::SafeDownCast(output->GetCellData()->GetArray(this->CenterlineSectionClosedArrayName));
+
+  vtkDoubleArray* centerlineAreaArray = vtkDoubleArray::SafeDownCast(this->Centerlines->GetPointData()->GetArray(this->CenterlineSectionAreaArrayName));
+  vtkDoubleArray* centerlineMinSizeArray = vtkDoubleArray::SafeDownCast(this->Centerlines->GetPointData()->GetArray(this->CenterlineSectionMinSizeArrayName));
+  vtkDoubleArray* centerlineMaxSizeArray = vtkDoubleArray::SafeDownCast(this->Centerlines->GetPointData()->GetArray(this->CenterlineSectionMaxSizeArrayName));
+  vtkDoubleArray* centerlineShapeArray = vtkDoubleArray::SafeDownCast(this->Centerlines->GetPointData()->GetArray(this->CenterlineSectionShapeArrayName));
+  vtkIntArray* centerlineClosedArray = vtkIntArray::SafeDownCast(this->Centerlines->GetPointData()->GetArray(this->CenterlineSectionClosedArrayName));
+
+  std::vector<double> origins;
+  std::vector<double> normals;
+  std::vector<vtkIdType> centerlinePointIds;
+
+  int numberOfCenterlineCells = this->Centerlines->GetNumberOfCells();
+  int i;
+  for (i=0; i<numberOfCenterlineCells; i++)
+  {
+    vtkCell* centerlineCell = this->Centerlines->GetCell(i);
+    vtkPoints* centerlineCellPoints = centerlineCell->GetPoints();
+    int numberOfCellPoints = centerlineCellPoints->GetNumberOfPoints();
+    int j;
+    for (j=0; j<numberOfCellPoints; j++)
+    {
+      double point[3], tangent[3];
+      centerlineCellPoints->GetPoint(j,point);
+      this->ComputeCenterlineTangent(centerlineCellPoints,j,tangent);
+      origins.insert(origins.end(),point,point+3);
+      normals.insert(normals.end(),tangent,tangent+3);
+      centerlinePointIds.push_back(centerlineCell->GetPointId(j));
+    }
+  }
+
+  vtkIdType numberOfSections = static_cast<vtkIdType>(centerlinePointIds.size());
+  if (numberOfSections == 0)
+  {
+    return;
+  }
+
+  std::vector<std::vector<double> > sectionPoints(numberOfSections);
+  std::vector<double> areas(numberOfSections);
+  std::vector<double> sizeRanges(2*numberOfSections);
+  std::vector<double> shapes(numberOfSections);
+  std::vector<int> closed(numberOfSections);
+
+  vtkvmtkPolyDataCenterlineSectionsFunctor functor;
+  functor.SectionLocator = sectionLocator;
+  functor.Origins = &origins[0];
+  functor.Normals = &normals[0];
+  functor.SectionPoints = &sectionPoints[0];
+  functor.Areas = &areas[0];
+  functor.SizeRanges = &sizeRanges[0];
+  functor.Shapes = &shapes[0];
+  functor.Closed = &closed[0];
+  vtkSMPTools::For(0,numberOfSections,functor);
+
+  vtkIdType s;
+  for (s=0; s<numberOfSections; s++)
+  {
+    vtkIdType numberOfSectionPoints = static_cast<vtkIdType>(sectionPoints[s].size() / 3);
+    centerlineSectionPolys->InsertNextCell(numberOfSectionPoints);
+    vtkIdType k;
+    for (k=0; k<numberOfSectionPoints; k++)
+    {
+      vtkIdType branchPointId = centerlineSectionPoints->InsertNextPoint(&sectionPoints[s][3*k]);
+      centerlineSectionPolys->InsertCellPoint(branchPointId);
+    }
+
+    centerlineSectionAreaArray->InsertNextValue(areas[s]);
+    centerlineSectionMinSizeArray->InsertNextValue(sizeRanges[2*s]);
+    centerlineSectionMaxSizeArray->InsertNextValue(sizeRanges[2*s+1]);
+    centerlineSectionShapeArray->InsertNextValue(shapes[s]);
+    centerlineSectionClosedArray->InsertNextValue(closed[s]);
+
+    vtkIdType pointId = centerlinePointIds[s];
+    centerlineAreaArray->InsertValue(pointId,areas[s]);
+    centerlineMinSizeArray->InsertValue(pointId,sizeRanges[2*s]);
+    centerlineMaxSizeArray->InsertValue(pointId,sizeRanges[2*s+1]);
+    centerlineShapeArray->InsertValue(pointId,shapes[s]);
+    centerlineClosedArray->InsertValue(pointId,closed[s]);
+  }
+}
+
 void vtkvmtkPolyDataCenterlineSections::PrintSelf(ostream& os, vtkIndent indent)
 {
   this->Superclass::PrintSelf(os,indent);
@@ -30,6 +30,8 @@ Version:   $Revision: 1.1 $
 #include "vtkvmtkWin32Header.h"
 #include "vtkPolyData.h"
 
+class vtkvmtkPolyDataSectionLocator;
+
 class VTK_VMTK_COMPUTATIONAL_GEOMETRY_EXPORT vtkvmtkPolyDataCenterlineSections : public vtkPolyDataAlgorithm
 {
   public: 
@@ -56,6 +58,15 @@ class VTK_VMTK_COMPUTATIONAL_GEOMETRY_EXPORT vtkvmtkPolyDataCenterlineSections :
   vtkSetStringMacro(CenterlineSectionClosedArrayName);
   vtkGetStringMacro(CenterlineSectionClosedArrayName);
 
+  // Description:
+  // Extract sections with a vtkvmtkPolyDataSectionLocator, which only cuts
+  // the triangles close to each centerline point, and extract all sections
+  // in parallel. Requires a triangulated surface, otherwise the whole
+  // surface is cut for each section.
+  vtkSetMacro(UseSectionLocator,int);
+  vtkGetMacro(UseSectionLocator,int);
+  vtkBooleanMacro(UseSectionLocator,int);
+
   protected:
   vtkvmtkPolyDataCenterlineSections();
   ~vtkvmtkPolyDataCenterlineSections();  
@@ -63,6 +74,9 @@ class VTK_VMTK_COMPUTATIONAL_GEOMETRY_EXPORT vtkvmtkPolyDataCenterlineSections :
   virtual int RequestData(vtkInformation *, vtkInformationVector **, vtkInformationVector *) VTK_OVERRIDE;
 
   void ComputeCenterlineSections(vtkPolyData* input, int cellId, vtkPolyData* output);
+  void ComputeLocatorCenterlineSections(vtkvmtkPolyDataSectionLocator* locator, vtkPolyData* output);
+
+  static void ComputeCenterlineTangent(vtkPoints* centerlineCellPoints, int pointId, double tangent[3]);
 
   vtkPolyData* Centerlines;
 
@@ -72,6 +86,8 @@ class VTK_VMTK_COMPUTATIONAL_GEOMETRY_EXPORT vtkvmtkPolyDataCenterlineSections :
   char* CenterlineSectionShapeArrayName;
   char* CenterlineSectionClosedArrayName;
 
+  int UseSectionLocator;
+
   private:
   vtkvmtkPolyDataCenterlineSections(const vtkvmtkPolyDataCenterlineSections&);  // Not implemented.
   void operator=(const vtkvmtkPolyDataCenterlineSections&);  // Not implemented.
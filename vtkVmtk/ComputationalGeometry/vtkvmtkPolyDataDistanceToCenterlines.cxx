@@ -22,12 +22,15 @@
 #include "vtkvmtkPolyDataDistanceToCenterlines.h"
 #include "vtkPointData.h"
 #include "vtkDoubleArray.h"
-#include "vtkvmtkPolyBallLine.h"
-#include "vtkCell.h"
+#include "vtkIntArray.h"
+#include "vtkvmtkPolyBallLineLocator.h"
 #include "vtkMath.h"
 #include "vtkInformation.h"
 #include "vtkInformationVector.h"
 #include "vtkObjectFactory.h"
+#include "vtkSMPTools.h"
+
+#include <vector>
 
 
 vtkStandardNewMacro(vtkvmtkPolyDataDistanceToCenterlines);
@@ -38,11 +41,15 @@ vtkvmtkPolyDataDistanceToCenterlines::vtkvmtkPolyDataDistanceToCenterlines()
 
   this->Centerlines = NULL;
   this->CenterlineRadiusArrayName = NULL;
+  this->CenterlineAbscissasArrayName = NULL;
+  this->ClosestCenterlineIdsArrayName = NULL;
+  this->ProjectedPointsArrayName = NULL;
 
   this->UseRadiusInformation = 1;
   this->EvaluateTubeFunction = 0;
   this->EvaluateCenterlineRadius = 0;
   this->ProjectPointArrays = 0;
+  this->EvaluateCenterlineAbscissas = 0;
 }
 
 vtkvmtkPolyDataDistanceToCenterlines::~vtkvmtkPolyDataDistanceToCenterlines()
@@ -64,8 +71,77 @@ vtkvmtkPolyDataDistanceToCenterlines::~vtkvmtkPolyDataDistanceToCenterlines()
     delete[] this->CenterlineRadiusArrayName;
     this->CenterlineRadiusArrayName = NULL;
     }
+
+  if (this->CenterlineAbscissasArrayName)
+    {
+    delete[] this->CenterlineAbscissasArrayName;
+    this->CenterlineAbscissasArrayName = NULL;
+    }
+
+  if (this->ClosestCenterlineIdsArrayName)
+    {
+    delete[] this->ClosestCenterlineIdsArrayName;
+    this->ClosestCenterlineIdsArrayName = NULL;
+    }
+
+  if (this->ProjectedPointsArrayName)
+    {
+    delete[] this->ProjectedPointsArrayName;
+    this->ProjectedPointsArrayName = NULL;
+    }
 }
 
+class vtkvmtkPolyDataDistanceToCenterlinesFunctor
+{
+public:
+  vtkvmtkPolyDataDistanceToCenterlinesFunctor(vtkvmtkPolyBallLineLocator* locator, vtkPolyData* input, vtkPolyData* centerlines, int evaluateTubeFunction, vtkDataArray* centerlineAbscissasArray, double* distances, double* radii, double* abscissas, vtkIdType* cellIds, vtkIdType* subIds, double* pcoords, double* centers) :
+    Locator(locator), Input(input), Centerlines(centerlines), EvaluateTubeFunction(evaluateTubeFunction), CenterlineAbscissasArray(centerlineAbscissasArray), Distances(distances), Radii(radii), Abscissas(abscissas), CellIds(cellIds), SubIds(subIds), PCoords(pcoords), Centers(centers) {}
+
+  void operator()(vtkIdType begin, vtkIdType end)
+  {
+    double point[3], centerlinePoint[3];
+    for (vtkIdType i=begin; i<end; i++)
+      {
+      this->Input->GetPoint(i,point);
+      double tubeFunctionValue = this->Locator->EvaluateFunction(point,this->CellIds[i],this->SubIds[i],this->PCoords[i],centerlinePoint,this->Radii[i]);
+      if (this->EvaluateTubeFunction)
+        {
+        this->Distances[i] = tubeFunctionValue;
+        }
+      else
+        {
+        this->Distances[i] = sqrt(vtkMath::Distance2BetweenPoints(point,centerlinePoint));
+        }
+      this->Centers[3*i+0] = centerlinePoint[0];
+      this->Centers[3*i+1] = centerlinePoint[1];
+      this->Centers[3*i+2] = centerlinePoint[2];
+      this->Abscissas[i] = 0.0;
+      if (this->CenterlineAbscissasArray && this->CellIds[i] != -1)
+        {
+        vtkIdType npts, *pts;
+        this->Centerlines->GetCellPoints(this->CellIds[i],npts,pts);
+        double abscissa0 = this->CenterlineAbscissasArray->GetComponent(pts[this->SubIds[i]],0);
+        double abscissa1 = this->CenterlineAbscissasArray->GetComponent(pts[this->SubIds[i]+1],0);
+        this->Abscissas[i] = (1.0 - this->PCoords[i]) * abscissa0 + this->PCoords[i] * abscissa1;
+        }
+      }
+  }
+
+private:
+  vtkvmtkPolyBallLineLocator* Locator;
+  vtkPolyData* Input;
+  vtkPolyData* Centerlines;
+  int EvaluateTubeFunction;
+  vtkDataArray* CenterlineAbscissasArray;
+  double* Distances;
+  double* Radii;
+  double* Abscissas;
+  vtkIdType* CellIds;
+  vtkIdType* SubIds;
+  double* PCoords;
+  double* Centers;
+};
+
 int vtkvmtkPolyDataDistanceToCenterlines::RequestData(
   vtkInformation *vtkNotUsed(request),
   vtkInformationVector **inputVector,
@@ -113,6 +189,38 @@ int vtkvmtkPolyDataDistanceToCenterlines::RequestData(
       }
     }
 
+  vtkDataArray* centerlineAbscissasArray = NULL;
+  if (this->EvaluateCenterlineAbscissas)
+    {
+    if (!this->CenterlineAbscissasArrayName)
+      {
+      vtkErrorMacro(<<"CenterlineAbscissasArrayName not set.");
+      return 1;
+      }
+
+    centerlineAbscissasArray = this->Centerlines->GetPointData()->GetArray(this->CenterlineAbscissasArrayName);
+
+    if (!centerlineAbscissasArray)
+      {
+      vtkErrorMacro(<<"CenterlineAbscissasArray with name specified does not exist.");
+      return 1;
+      }
+    }
+
+  vtkvmtkPolyBallLineLocator* locator = vtkvmtkPolyBallLineLocator::New();
+  locator->SetInput(this->Centerlines);
+  locator->SetUseRadiusInformation(this->UseRadiusInformation);
+  if (this->UseRadiusInformation)
+    {
+    locator->SetPolyBallRadiusArrayName(this->CenterlineRadiusArrayName);
+    }
+  if (!locator->Build())
+    {
+    vtkErrorMacro(<<"Could not build the centerline locator.");
+    locator->Delete();
+    return 1;
+    }
+
   int numberOfInputPoints = input->GetNumberOfPoints();
 
   output->DeepCopy(input);
@@ -137,53 +245,93 @@ int vtkvmtkPolyDataDistanceToCenterlines::RequestData(
     output->GetPointData()->AddArray(surfaceCenterlineRadiusArray);
     }
 
-  vtkvmtkPolyBallLine* tube = vtkvmtkPolyBallLine::New();
-  tube->SetInput(this->Centerlines);
-  tube->SetUseRadiusInformation(this->UseRadiusInformation);
-  if (this->UseRadiusInformation)
+  if (this->ProjectPointArrays) 
     {
-    tube->SetPolyBallRadiusArrayName(this->CenterlineRadiusArrayName);
+    output->GetPointData()->InterpolateAllocate(this->Centerlines->GetPointData(),numberOfInputPoints);
     }
 
-  if (this->ProjectPointArrays) 
+  std::vector<double> distances(numberOfInputPoints);
+  std::vector<double> radii(numberOfInputPoints);
+  std::vector<double> abscissas(numberOfInputPoints);
+  std::vector<vtkIdType> cellIds(numberOfInputPoints);
+  std::vector<vtkIdType> subIds(numberOfInputPoints);
+  std::vector<double> pcoords(numberOfInputPoints);
+  std::vector<double> centers(3*numberOfInputPoints);
+
+  if (numberOfInputPoints > 0)
     {
-    output->GetPointData()->InterpolateAllocate(this->Centerlines->GetPointData(),numberOfInputPoints);
+    vtkvmtkPolyDataDistanceToCenterlinesFunctor functor(locator,input,this->Centerlines,this->EvaluateTubeFunction,centerlineAbscissasArray,&distances[0],&radii[0],&abscissas[0],&cellIds[0],&subIds[0],&pcoords[0],&centers[0]);
+    vtkSMPTools::For(0,numberOfInputPoints,functor);
     }
 
-  double point[3], centerlinePoint[3];
-  double distanceToCenterlines = 0.0;
+  locator->Delete();
+
   for (int i=0; i<numberOfInputPoints; i++)
     {
-    input->GetPoint(i,point);
-    double tubeFunctionValue = tube->EvaluateFunction(point);
-    if (this->EvaluateTubeFunction)
+    distanceToCenterlinesArray->SetValue(i,distances[i]);
+    if (this->EvaluateCenterlineRadius)
+      {
+      surfaceCenterlineRadiusArray->SetValue(i,radii[i]);
+      }
+    }
+
+  if (this->ProjectPointArrays) 
+    {
+    vtkIdType npts, *pts;
+    for (int i=0; i<numberOfInputPoints; i++)
       {
-      distanceToCenterlines = tubeFunctionValue;
+      if (cellIds[i] == -1)
+        {
+        output->GetPointData()->NullPoint(i);
+        continue;
+        }
+      this->Centerlines->GetCellPoints(cellIds[i],npts,pts);
+      output->GetPointData()->InterpolateEdge(this->Centerlines->GetPointData(),i,pts[subIds[i]],pts[subIds[i]+1],pcoords[i]);
       }
-    else
+    }
+
+  if (this->EvaluateCenterlineAbscissas)
+    {
+    vtkDoubleArray* abscissasArray = vtkDoubleArray::New();
+    abscissasArray->SetName(this->CenterlineAbscissasArrayName);
+    abscissasArray->SetNumberOfComponents(1);
+    abscissasArray->SetNumberOfTuples(numberOfInputPoints);
+    for (int i=0; i<numberOfInputPoints; i++)
       {
-      tube->GetLastPolyBallCenter(centerlinePoint);
-      distanceToCenterlines = sqrt(vtkMath::Distance2BetweenPoints(point,centerlinePoint));
+      abscissasArray->SetValue(i,abscissas[i]);
       }
-    distanceToCenterlinesArray->SetComponent(i,0,distanceToCenterlines);
-    if (this->EvaluateCenterlineRadius)
+    output->GetPointData()->AddArray(abscissasArray);
+    abscissasArray->Delete();
+    }
+
+  if (this->ClosestCenterlineIdsArrayName)
+    {
+    vtkIntArray* closestCenterlineIdsArray = vtkIntArray::New();
+    closestCenterlineIdsArray->SetName(this->ClosestCenterlineIdsArrayName);
+    closestCenterlineIdsArray->SetNumberOfComponents(1);
+    closestCenterlineIdsArray->SetNumberOfTuples(numberOfInputPoints);
+    for (int i=0; i<numberOfInputPoints; i++)
       {
-      surfaceCenterlineRadiusArray->SetComponent(i,0,tube->GetLastPolyBallCenterRadius());
+      closestCenterlineIdsArray->SetValue(i,cellIds[i]);
       }
+    output->GetPointData()->AddArray(closestCenterlineIdsArray);
+    closestCenterlineIdsArray->Delete();
+    }
 
-    if (this->ProjectPointArrays) 
+  if (this->ProjectedPointsArrayName)
+    {
+    vtkDoubleArray* projectedPointsArray = vtkDoubleArray::New();
+    projectedPointsArray->SetName(this->ProjectedPointsArrayName);
+    projectedPointsArray->SetNumberOfComponents(3);
+    projectedPointsArray->SetNumberOfTuples(numberOfInputPoints);
+    for (int i=0; i<numberOfInputPoints; i++)
       {
-      vtkIdType cellId = tube->GetLastPolyBallCellId();
-      vtkIdType subId = tube->GetLastPolyBallCellSubId();
-      vtkIdType pcoord = tube->GetLastPolyBallCellPCoord();
-      vtkCell* cell = this->Centerlines->GetCell(cellId);
-      vtkIdType pointId0 = cell->GetPointId(subId);
-      vtkIdType pointId1 = cell->GetPointId(subId+1);
-      output->GetPointData()->InterpolateEdge(this->Centerlines->GetPointData(),i,pointId0,pointId1,pcoord);
+      projectedPointsArray->SetTuple(i,&centers[3*i]);
       }
+    output->GetPointData()->AddArray(projectedPointsArray);
+    projectedPointsArray->Delete();
     }
 
-  tube->Delete();
   distanceToCenterlinesArray->Delete();
   if (surfaceCenterlineRadiusArray)
     {
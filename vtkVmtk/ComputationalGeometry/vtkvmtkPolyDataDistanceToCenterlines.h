@@ -62,6 +62,25 @@ public:
   vtkGetMacro(ProjectPointArrays,int);
   vtkBooleanMacro(ProjectPointArrays,int);
 
+  // Description:
+  // Also output, with the same name, the centerline abscissas interpolated
+  // at the closest poly ball center.
+  vtkSetMacro(EvaluateCenterlineAbscissas,int);
+  vtkGetMacro(EvaluateCenterlineAbscissas,int);
+  vtkBooleanMacro(EvaluateCenterlineAbscissas,int);
+
+  vtkSetStringMacro(CenterlineAbscissasArrayName);
+  vtkGetStringMacro(CenterlineAbscissasArrayName);
+
+  // Description:
+  // If set, also output the id of the closest centerline cell and the
+  // closest poly ball center, computed in the same pass as the distance.
+  vtkSetStringMacro(ClosestCenterlineIdsArrayName);
+  vtkGetStringMacro(ClosestCenterlineIdsArrayName);
+
+  vtkSetStringMacro(ProjectedPointsArrayName);
+  vtkGetStringMacro(ProjectedPointsArrayName);
+
 protected:
   vtkvmtkPolyDataDistanceToCenterlines();
   ~vtkvmtkPolyDataDistanceToCenterlines();
@@ -70,6 +89,9 @@ protected:
 
   char* DistanceToCenterlinesArrayName;
   char* CenterlineRadiusArrayName;
+  char* CenterlineAbscissasArrayName;
+  char* ClosestCenterlineIdsArrayName;
+  char* ProjectedPointsArrayName;
 
   vtkPolyData* Centerlines;
 
@@ -77,6 +99,7 @@ protected:
   int EvaluateTubeFunction;
   int EvaluateCenterlineRadius;
   int ProjectPointArrays;
+  int EvaluateCenterlineAbscissas;
 
 private:
   vtkvmtkPolyDataDistanceToCenterlines(const vtkvmtkPolyDataDistanceToCenterlines&);  // Not implemented.
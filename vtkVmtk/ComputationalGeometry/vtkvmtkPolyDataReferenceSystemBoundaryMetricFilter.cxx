@@ -37,9 +37,11 @@
 #include "vtkvmtkPolyDataBranchUtilities.h"
 #include "vtkvmtkCenterlineUtilities.h"
 #include "vtkvmtkReferenceSystemUtilities.h"
+#include "vtkvmtkPolyDataCenterlineClosestPointMap.h"
 
 
 vtkStandardNewMacro(vtkvmtkPolyDataReferenceSystemBoundaryMetricFilter);
+vtkCxxSetObjectMacro(vtkvmtkPolyDataReferenceSystemBoundaryMetricFilter,ClosestPointMap,vtkvmtkPolyDataCenterlineClosestPointMap);
 
 vtkvmtkPolyDataReferenceSystemBoundaryMetricFilter::vtkvmtkPolyDataReferenceSystemBoundaryMetricFilter() 
 {
@@ -56,6 +58,7 @@ vtkvmtkPolyDataReferenceSystemBoundaryMetricFilter::vtkvmtkPolyDataReferenceSyst
 
   this->ReferenceSystems = NULL;
   this->ReferenceSystemGroupIdsArrayName = NULL;
+  this->ClosestPointMap = NULL;
 }
 
 vtkvmtkPolyDataReferenceSystemBoundaryMetricFilter::~vtkvmtkPolyDataReferenceSystemBoundaryMetricFilter()
@@ -119,6 +122,12 @@ vtkvmtkPolyDataReferenceSystemBoundaryMetricFilter::~vtkvmtkPolyDataReferenceSys
     delete[] this->ReferenceSystemGroupIdsArrayName;
     this->ReferenceSystemGroupIdsArrayName = NULL;
     }
+
+  if (this->ClosestPointMap)
+    {
+    this->ClosestPointMap->Delete();
+    this->ClosestPointMap = NULL;
+    }
 }
 
 int vtkvmtkPolyDataReferenceSystemBoundaryMetricFilter::RequestData(
@@ -252,6 +261,30 @@ int vtkvmtkPolyDataReferenceSystemBoundaryMetricFilter::RequestData(
 
   int numberOfInputPoints = input->GetNumberOfPoints();
 
+  if (this->ClosestPointMap)
+    {
+    if (!this->ClosestPointMap->GetSurface())
+      {
+      this->ClosestPointMap->SetSurface(input);
+      }
+    else if (this->ClosestPointMap->GetSurface() != input)
+      {
+      vtkErrorMacro(<<"ClosestPointMap is set on a surface other than the input.");
+      return 1;
+      }
+    this->ClosestPointMap->SetCenterlines(this->Centerlines);
+    this->ClosestPointMap->UseRadiusInformationOn();
+    this->ClosestPointMap->SetRadiusArrayName(this->CenterlineRadiusArrayName);
+    this->ClosestPointMap->SetGroupIdsArrayName(this->GroupIdsArrayName);
+    this->ClosestPointMap->SetCenterlineGroupIdsArrayName(this->CenterlineGroupIdsArrayName);
+
+    if (!this->ClosestPointMap->Update())
+      {
+      vtkErrorMacro(<<"Could not update ClosestPointMap.");
+      return 1;
+      }
+    }
+
   output->DeepCopy(input);
 
   vtkDoubleArray* boundaryMetricArray = vtkDoubleArray::New();
@@ -311,11 +344,23 @@ int vtkvmtkPolyDataReferenceSystemBoundaryMetricFilter::RequestData(
         return 1;
         }
 
-      tube->EvaluateFunction(boundary->GetPoints()->GetPoint(0));
+      vtkIdType centerlineCellId, centerlineSubId;
+      double centerlinePCoord;
+      if (this->ClosestPointMap)
+        {
+        // boundary point scalars are the ids of the points in the input
+        vtkIdType boundaryPointId = static_cast<vtkIdType>(boundaryExtractor->GetOutput()->GetPointData()->GetScalars()->GetComponent(boundary->GetPointId(0),0));
+        double distance;
+        this->ClosestPointMap->GetGroupClosestPoint(boundaryPointId,centerlineCellId,centerlineSubId,centerlinePCoord,distance);
+        }
+      else
+        {
+        tube->EvaluateFunction(boundary->GetPoints()->GetPoint(0));
       
-      vtkIdType centerlineCellId = tube->GetLastPolyBallCellId();
-      vtkIdType centerlineSubId = tube->GetLastPolyBallCellSubId();
-      double centerlinePCoord = tube->GetLastPolyBallCellPCoord();
+        centerlineCellId = tube->GetLastPolyBallCellId();
+        centerlineSubId = tube->GetLastPolyBallCellSubId();
+        centerlinePCoord = tube->GetLastPolyBallCellPCoord();
+        }
       double abscissa = 0.0;
       vtkvmtkCenterlineUtilities::InterpolateTuple1(this->Centerlines,this->CenterlineAbscissasArrayName,centerlineCellId,centerlineSubId,centerlinePCoord,abscissa);
 
@@ -33,6 +33,7 @@
 
 class vtkDataArray;
 class vtkIdList;
+class vtkvmtkPolyDataCenterlineClosestPointMap;
 
 class VTK_VMTK_COMPUTATIONAL_GEOMETRY_EXPORT vtkvmtkPolyDataReferenceSystemBoundaryMetricFilter : public vtkPolyDataAlgorithm
 {
@@ -70,6 +71,14 @@ public:
   vtkSetStringMacro(ReferenceSystemGroupIdsArrayName);
   vtkGetStringMacro(ReferenceSystemGroupIdsArrayName);
 
+  // Description:
+  // Optional closest centerline points of the input, shared with other
+  // filters working on the same surface. The filter sets on the map the
+  // parameters it depends on and only recomputes it if they changed. The
+  // map Surface must be the input itself; it is set to the input if unset.
+  virtual void SetClosestPointMap(vtkvmtkPolyDataCenterlineClosestPointMap*);
+  vtkGetObjectMacro(ClosestPointMap,vtkvmtkPolyDataCenterlineClosestPointMap);
+
 protected:
   vtkvmtkPolyDataReferenceSystemBoundaryMetricFilter();
   ~vtkvmtkPolyDataReferenceSystemBoundaryMetricFilter();
@@ -90,6 +99,8 @@ protected:
   vtkPolyData* ReferenceSystems;
   char* ReferenceSystemGroupIdsArrayName;
 
+  vtkvmtkPolyDataCenterlineClosestPointMap* ClosestPointMap;
+
 private:
   vtkvmtkPolyDataReferenceSystemBoundaryMetricFilter(const vtkvmtkPolyDataReferenceSystemBoundaryMetricFilter&);  // Not implemented.
   void operator=(const vtkvmtkPolyDataReferenceSystemBoundaryMetricFilter&);  // Not implemented.
@@ -0,0 +1,605 @@
+/*=========================================================================
+
+Program:   VMTK
+Module:    $RCSfile: vtkvmtkPolyDataSectionLocator.cxx,v $
+Language:  C++
+Date:      $Date: 2006/04/06 16:46:43 $
+Version:   $Revision: 1.4 $
+
+  Copyright (c) Luca Antiga, David Steinman. All rights reserved.
+  See LICENCE file for details.
+
+  Portions of this code are covered under the VTK copyright.
+  See VTKCopyright.txt or http://www.kitware.com/VTKCopyright.htm
+  for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+
+#include "vtkvmtkPolyDataSectionLocator.h"
+#include "vtkvmtkConstants.h"
+#include "vtkPointData.h"
+#include "vtkCellArray.h"
+#include "vtkPoints.h"
+#include "vtkMath.h"
+#include "vtkObjectFactory.h"
+
+#include <algorithm>
+
+
+vtkStandardNewMacro(vtkvmtkPolyDataSectionLocator);
+
+static const vtkIdType VTK_VMTK_SECTION_LOCATOR_TRIANGLES_PER_LEAF = 8;
+
+vtkvmtkPolyDataSectionLocator::vtkvmtkPolyDataSectionLocator()
+{
+  this->Surface = NULL;
+}
+
+vtkvmtkPolyDataSectionLocator::~vtkvmtkPolyDataSectionLocator()
+{
+  if (this->Surface)
+    {
+    this->Surface->Delete();
+    this->Surface = NULL;
+    }
+}
+
+// Sorts triangle edges by their (ordered) end point ids to pair neighbors.
+class vtkvmtkPolyDataSectionLocatorEdgeCompare
+{
+public:
+  vtkvmtkPolyDataSectionLocatorEdgeCompare(const vtkIdType* edges) : Edges(edges) {}
+
+  bool operator()(vtkIdType e0, vtkIdType e1) const
+  {
+    if (this->Edges[2*e0] != this->Edges[2*e1])
+      {
+      return this->Edges[2*e0] < this->Edges[2*e1];
+      }
+    return this->Edges[2*e0+1] < this->Edges[2*e1+1];
+  }
+
+private:
+  const vtkIdType* Edges;
+};
+
+class vtkvmtkPolyDataSectionLocatorCenterCompare
+{
+public:
+  vtkvmtkPolyDataSectionLocatorCenterCompare(const double* centers, int axis) : Centers(centers), Axis(axis) {}
+
+  bool operator()(vtkIdType t0, vtkIdType t1) const
+  {
+    return this->Centers[3*t0+this->Axis] < this->Centers[3*t1+this->Axis];
+  }
+
+private:
+  const double* Centers;
+  int Axis;
+};
+
+int vtkvmtkPolyDataSectionLocator::Build()
+{
+  this->TrianglePointIds.clear();
+  this->TriangleNeighbors.clear();
+  this->NodeBounds.clear();
+  this->NodeFirst.clear();
+  this->NodeCount.clear();
+  this->TriangleIds.clear();
+
+  if (!this->Surface)
+    {
+    vtkErrorMacro(<< "Surface not set.");
+    return 0;
+    }
+
+  if (this->Surface->GetNumberOfStrips() > 0)
+    {
+    return 0;
+    }
+
+  vtkCellArray* polys = this->Surface->GetPolys();
+  vtkIdType npts, *pts;
+  polys->InitTraversal();
+  while (polys->GetNextCell(npts,pts))
+    {
+    if (npts != 3)
+      {
+      this->TrianglePointIds.clear();
+      return 0;
+      }
+    this->TrianglePointIds.insert(this->TrianglePointIds.end(),pts,pts+3);
+    }
+
+  vtkIdType numberOfTriangles = static_cast<vtkIdType>(this->TrianglePointIds.size() / 3);
+  vtkIdType i;
+
+  // edge neighbors: edges sharing the same end points, when exactly two
+  std::vector<vtkIdType> edges(6*numberOfTriangles);
+  std::vector<vtkIdType> edgeOrder(3*numberOfTriangles);
+  for (i=0; i<3*numberOfTriangles; i++)
+    {
+    vtkIdType pointId0 = this->TrianglePointIds[i];
+    vtkIdType pointId1 = this->TrianglePointIds[3*(i/3)+(i%3+1)%3];
+    edges[2*i] = std::min(pointId0,pointId1);
+    edges[2*i+1] = std::max(pointId0,pointId1);
+    edgeOrder[i] = i;
+    }
+  if (numberOfTriangles > 0)
+    {
+    vtkvmtkPolyDataSectionLocatorEdgeCompare edgeCompare(&edges[0]);
+    std::sort(edgeOrder.begin(),edgeOrder.end(),edgeCompare);
+    }
+
+  this->TriangleNeighbors.assign(3*numberOfTriangles,-1);
+  vtkIdType begin = 0;
+  while (begin < 3*numberOfTriangles)
+    {
+    vtkIdType end = begin + 1;
+    while (end < 3*numberOfTriangles && edges[2*edgeOrder[end]] == edges[2*edgeOrder[begin]] && edges[2*edgeOrder[end]+1] == edges[2*edgeOrder[begin]+1])
+      {
+      end++;
+      }
+    if (end - begin == 2)
+      {
+      this->TriangleNeighbors[edgeOrder[begin]] = edgeOrder[begin+1] / 3;
+      this->TriangleNeighbors[edgeOrder[begin+1]] = edgeOrder[begin] / 3;
+      }
+    begin = end;
+    }
+
+  // top-down median split along the largest extent of the triangle centers
+  std::vector<double> triangleBounds(6*numberOfTriangles);
+  std::vector<double> triangleCenters(3*numberOfTriangles);
+  this->TriangleIds.resize(numberOfTriangles);
+  for (i=0; i<numberOfTriangles; i++)
+    {
+    double point[3];
+    double* bounds = &triangleBounds[6*i];
+    bounds[0] = bounds[2] = bounds[4] = VTK_DOUBLE_MAX;
+    bounds[1] = bounds[3] = bounds[5] = -VTK_DOUBLE_MAX;
+    for (int j=0; j<3; j++)
+      {
+      this->Surface->GetPoint(this->TrianglePointIds[3*i+j],point);
+      for (int k=0; k<3; k++)
+        {
+        bounds[2*k] = std::min(bounds[2*k],point[k]);
+        bounds[2*k+1] = std::max(bounds[2*k+1],point[k]);
+        }
+      }
+    for (int k=0; k<3; k++)
+      {
+      triangleCenters[3*i+k] = 0.5 * (bounds[2*k] + bounds[2*k+1]);
+      }
+    this->TriangleIds[i] = i;
+    }
+
+  struct BuildItem
+  {
+    vtkIdType Node;
+    vtkIdType Begin;
+    vtkIdType End;
+  };
+  std::vector<BuildItem> stack;
+  if (numberOfTriangles > 0)
+    {
+    this->NodeBounds.resize(6);
+    this->NodeFirst.push_back(0);
+    this->NodeCount.push_back(0);
+    BuildItem root = {0, 0, numberOfTriangles};
+    stack.push_back(root);
+    }
+  while (!stack.empty())
+    {
+    BuildItem item = stack.back();
+    stack.pop_back();
+
+    double bounds[6], centerBounds[6];
+    bounds[0] = bounds[2] = bounds[4] = centerBounds[0] = centerBounds[2] = centerBounds[4] = VTK_DOUBLE_MAX;
+    bounds[1] = bounds[3] = bounds[5] = centerBounds[1] = centerBounds[3] = centerBounds[5] = -VTK_DOUBLE_MAX;
+    for (i=item.Begin; i<item.End; i++)
+      {
+      vtkIdType triangleId = this->TriangleIds[i];
+      for (int k=0; k<3; k++)
+        {
+        bounds[2*k] = std::min(bounds[2*k],triangleBounds[6*triangleId+2*k]);
+        bounds[2*k+1] = std::max(bounds[2*k+1],triangleBounds[6*triangleId+2*k+1]);
+        centerBounds[2*k] = std::min(centerBounds[2*k],triangleCenters[3*triangleId+k]);
+        centerBounds[2*k+1] = std::max(centerBounds[2*k+1],triangleCenters[3*triangleId+k]);
+        }
+      }
+    std::copy(bounds,bounds+6,&this->NodeBounds[6*item.Node]);
+
+    int axis = 0;
+    for (int k=1; k<3; k++)
+      {
+      if (centerBounds[2*k+1] - centerBounds[2*k] > centerBounds[2*axis+1] - centerBounds[2*axis])
+        {
+        axis = k;
+        }
+      }
+
+    vtkIdType count = item.End - item.Begin;
+    if (count <= VTK_VMTK_SECTION_LOCATOR_TRIANGLES_PER_LEAF || centerBounds[2*axis+1] - centerBounds[2*axis] <= 0.0)
+      {
+      this->NodeFirst[item.Node] = item.Begin;
+      this->NodeCount[item.Node] = -count;
+      continue;
+      }
+
+    vtkIdType middle = item.Begin + count / 2;
+    vtkvmtkPolyDataSectionLocatorCenterCompare compare(&triangleCenters[0],axis);
+    std::nth_element(this->TriangleIds.begin()+item.Begin,this->TriangleIds.begin()+middle,this->TriangleIds.begin()+item.End,compare);
+
+    vtkIdType child = static_cast<vtkIdType>(this->NodeFirst.size());
+    this->NodeFirst[item.Node] = child;
+    this->NodeCount[item.Node] = 0;
+    this->NodeFirst.resize(child+2,0);
+    this->NodeCount.resize(child+2,0);
+    this->NodeBounds.resize(6*(child+2));
+    BuildItem left = {child, item.Begin, middle};
+    BuildItem right = {child+1, middle, item.End};
+    stack.push_back(left);
+    stack.push_back(right);
+    }
+
+  return 1;
+}
+
+// Crossed edges of a triangle, classifying points as vtkCutter does (on the
+// positive side if the signed distance is not negative). A triangle is cut
+// by the plane if and only if exactly two of its edges are crossed.
+void vtkvmtkPolyDataSectionLocator::GetContourEdges(vtkIdType triangleId, const double origin[3], const double normal[3], int edges[2])
+{
+  bool positive[3];
+  double point[3];
+  for (int j=0; j<3; j++)
+    {
+    this->Surface->GetPoint(this->TrianglePointIds[3*triangleId+j],point);
+    positive[j] = (point[0]-origin[0])*normal[0] + (point[1]-origin[1])*normal[1] + (point[2]-origin[2])*normal[2] >= 0.0;
+    }
+
+  edges[0] = edges[1] = -1;
+  int numberOfEdges = 0;
+  for (int k=0; k<3; k++)
+    {
+    if (positive[k] != positive[(k+1)%3])
+      {
+      edges[numberOfEdges++] = k;
+      }
+    }
+}
+
+// Identifies a section point by the sorted end point ids of its edge, or
+// by the surface point id (twice) when the crossing is at an edge end, so
+// that crossings of the same edge, or of the same surface point lying on
+// the plane, compare equal regardless of round-off.
+static void vtkvmtkPolyDataSectionLocatorSectionPointKey(const std::vector<vtkIdType>& edgePointIds, const std::vector<double>& edgeParameters, size_t i, vtkIdType key[2])
+{
+  key[0] = edgePointIds[2*i];
+  key[1] = edgePointIds[2*i+1];
+  if (edgeParameters[i] <= 0.0)
+    {
+    key[1] = key[0];
+    }
+  else if (edgeParameters[i] >= 1.0)
+    {
+    key[0] = key[1];
+    }
+}
+
+// Appends the crossing point of an edge. The edge is always interpolated
+// from its lowest point id so that both triangles sharing it give the same
+// point.
+void vtkvmtkPolyDataSectionLocator::AppendEdgePoint(vtkIdType triangleId, int edge, const double origin[3], const double normal[3], std::vector<double>& points, std::vector<vtkIdType>& edgePointIds, std::vector<double>& edgeParameters)
+{
+  vtkIdType pointId0 = this->TrianglePointIds[3*triangleId+edge];
+  vtkIdType pointId1 = this->TrianglePointIds[3*triangleId+(edge+1)%3];
+  if (pointId1 < pointId0)
+    {
+    std::swap(pointId0,pointId1);
+    }
+
+  double point0[3], point1[3];
+  this->Surface->GetPoint(pointId0,point0);
+  this->Surface->GetPoint(pointId1,point1);
+  double value0 = (point0[0]-origin[0])*normal[0] + (point0[1]-origin[1])*normal[1] + (point0[2]-origin[2])*normal[2];
+  double value1 = (point1[0]-origin[0])*normal[0] + (point1[1]-origin[1])*normal[1] + (point1[2]-origin[2])*normal[2];
+  double t = value0 / (value0 - value1);
+
+  double point[3];
+  for (int k=0; k<3; k++)
+    {
+    point[k] = point0[k] + t * (point1[k] - point0[k]);
+    }
+
+  points.insert(points.end(),point,point+3);
+  edgePointIds.push_back(pointId0);
+  edgePointIds.push_back(pointId1);
+  edgeParameters.push_back(t);
+
+  // a surface point lying on the plane is crossed by two consecutive edges
+  size_t numberOfPoints = edgeParameters.size();
+  if (numberOfPoints > 1)
+    {
+    vtkIdType key[2], previousKey[2];
+    vtkvmtkPolyDataSectionLocatorSectionPointKey(edgePointIds,edgeParameters,numberOfPoints-1,key);
+    vtkvmtkPolyDataSectionLocatorSectionPointKey(edgePointIds,edgeParameters,numberOfPoints-2,previousKey);
+    if (key[0] == previousKey[0] && key[1] == previousKey[1])
+      {
+      points.resize(3*(numberOfPoints-1));
+      edgePointIds.resize(2*(numberOfPoints-1));
+      edgeParameters.resize(numberOfPoints-1);
+      }
+    }
+}
+
+// Cut triangle holding the contour point closest to the origin. Nodes whose
+// bounds do not straddle the plane, or are farther than the best point so
+// far, are skipped.
+vtkIdType vtkvmtkPolyDataSectionLocator::FindClosestContourTriangle(const double origin[3], const double normal[3])
+{
+  vtkIdType closestTriangleId = -1;
+  double minDist2 = VTK_DOUBLE_MAX;
+
+  if (this->NodeFirst.empty())
+    {
+    return closestTriangleId;
+    }
+
+  std::vector<double> points;
+  std::vector<vtkIdType> edgePointIds;
+  std::vector<double> edgeParameters;
+
+  vtkIdType stack[128];
+  double stackDist2[128];
+  int stackSize = 0;
+  stack[stackSize] = 0;
+  stackDist2[stackSize++] = 0.0;
+  while (stackSize > 0)
+    {
+    stackSize--;
+    vtkIdType node = stack[stackSize];
+    if (stackDist2[stackSize] >= minDist2)
+      {
+      continue;
+      }
+    if (this->NodeCount[node] < 0)
+      {
+      vtkIdType first = this->NodeFirst[node];
+      vtkIdType last = first - this->NodeCount[node];
+      for (vtkIdType i=first; i<last; i++)
+        {
+        vtkIdType triangleId = this->TriangleIds[i];
+        int edges[2];
+        this->GetContourEdges(triangleId,origin,normal,edges);
+        if (edges[1] == -1)
+          {
+          continue;
+          }
+        points.clear();
+        edgePointIds.clear();
+        edgeParameters.clear();
+        this->AppendEdgePoint(triangleId,edges[0],origin,normal,points,edgePointIds,edgeParameters);
+        this->AppendEdgePoint(triangleId,edges[1],origin,normal,points,edgePointIds,edgeParameters);
+        for (size_t j=0; j<points.size()/3; j++)
+          {
+          double dist2 = vtkMath::Distance2BetweenPoints(&points[3*j],origin);
+          if (dist2 < minDist2)
+            {
+            minDist2 = dist2;
+            closestTriangleId = triangleId;
+            }
+          }
+        }
+      continue;
+      }
+
+    vtkIdType children[2];
+    double childDist2[2];
+    int numberOfChildren = 0;
+    for (vtkIdType child=this->NodeFirst[node]; child<this->NodeFirst[node]+2; child++)
+      {
+      const double* bounds = &this->NodeBounds[6*child];
+      // signed distance range of the box corners, slightly widened
+      double center = 0.0;
+      double radius = 0.0;
+      double dist2 = 0.0;
+      for (int k=0; k<3; k++)
+        {
+        center += (0.5 * (bounds[2*k] + bounds[2*k+1]) - origin[k]) * normal[k];
+        radius += 0.5 * (bounds[2*k+1] - bounds[2*k]) * fabs(normal[k]);
+        double d = 0.0;
+        if (origin[k] < bounds[2*k])
+          {
+          d = bounds[2*k] - origin[k];
+          }
+        else if (origin[k] > bounds[2*k+1])
+          {
+          d = origin[k] - bounds[2*k+1];
+          }
+        dist2 += d * d;
+        }
+      double tolerance = 1E-9 * (fabs(center) + radius);
+      if (center - radius > tolerance || center + radius < -tolerance)
+        {
+        continue;
+        }
+      children[numberOfChildren] = child;
+      childDist2[numberOfChildren++] = dist2;
+      }
+    // visit the closer child first
+    if (numberOfChildren == 2 && childDist2[0] < childDist2[1])
+      {
+      std::swap(children[0],children[1]);
+      std::swap(childDist2[0],childDist2[1]);
+      }
+    for (int j=0; j<numberOfChildren; j++)
+      {
+      stack[stackSize] = children[j];
+      stackDist2[stackSize++] = childDist2[j];
+      }
+    }
+
+  return closestTriangleId;
+}
+
+vtkIdType vtkvmtkPolyDataSectionLocator::ExtractSection(const double origin[3], const double normal[3], std::vector<double>& points, std::vector<vtkIdType>& edgePointIds, std::vector<double>& edgeParameters, bool& closed)
+{
+  points.clear();
+  edgePointIds.clear();
+  edgeParameters.clear();
+  closed = false;
+
+  vtkIdType startTriangleId = this->FindClosestContourTriangle(origin,normal);
+
+  if (startTriangleId == -1)
+    {
+    return 0;
+    }
+
+  vtkIdType numberOfTriangles = static_cast<vtkIdType>(this->TriangleNeighbors.size() / 3);
+
+  // walk across the second crossed edge of the start triangle, then, if the
+  // contour does not come back to it, across the first one, prepending
+  std::vector<double> backwardPoints;
+  std::vector<vtkIdType> backwardEdgePointIds;
+  std::vector<double> backwardEdgeParameters;
+
+  int startEdges[2];
+  this->GetContourEdges(startTriangleId,origin,normal,startEdges);
+
+  for (int direction=0; direction<2; direction++)
+    {
+    std::vector<double>& walkPoints = direction == 0 ? points : backwardPoints;
+    std::vector<vtkIdType>& walkEdgePointIds = direction == 0 ? edgePointIds : backwardEdgePointIds;
+    std::vector<double>& walkEdgeParameters = direction == 0 ? edgeParameters : backwardEdgeParameters;
+
+    vtkIdType triangleId = startTriangleId;
+    int exitEdge = startEdges[1-direction];
+    for (vtkIdType step=0; step<numberOfTriangles; step++)
+      {
+      this->AppendEdgePoint(triangleId,exitEdge,origin,normal,walkPoints,walkEdgePointIds,walkEdgeParameters);
+      vtkIdType neighborId = this->TriangleNeighbors[3*triangleId+exitEdge];
+      if (neighborId == -1)
+        {
+        break;
+        }
+      if (neighborId == startTriangleId)
+        {
+        closed = true;
+        break;
+        }
+      vtkIdType pointId0 = this->TrianglePointIds[3*triangleId+exitEdge];
+      vtkIdType pointId1 = this->TrianglePointIds[3*triangleId+(exitEdge+1)%3];
+      int edges[2];
+      this->GetContourEdges(neighborId,origin,normal,edges);
+      int entryEdge = -1;
+      for (int j=0; j<2; j++)
+        {
+        vtkIdType neighborPointId0 = this->TrianglePointIds[3*neighborId+edges[j]];
+        vtkIdType neighborPointId1 = this->TrianglePointIds[3*neighborId+(edges[j]+1)%3];
+        if ((neighborPointId0 == pointId0 && neighborPointId1 == pointId1) || (neighborPointId0 == pointId1 && neighborPointId1 == pointId0))
+          {
+          entryEdge = j;
+          }
+        }
+      if (entryEdge == -1)
+        {
+        break;
+        }
+      triangleId = neighborId;
+      exitEdge = edges[1-entryEdge];
+      }
+
+    if (closed)
+      {
+      break;
+      }
+    }
+
+  if (!closed)
+    {
+    size_t numberOfBackwardPoints = backwardEdgeParameters.size();
+    std::vector<double> forwardPoints;
+    std::vector<vtkIdType> forwardEdgePointIds;
+    std::vector<double> forwardEdgeParameters;
+    forwardPoints.swap(points);
+    forwardEdgePointIds.swap(edgePointIds);
+    forwardEdgeParameters.swap(edgeParameters);
+    for (size_t i=numberOfBackwardPoints; i>0; i--)
+      {
+      points.insert(points.end(),&backwardPoints[3*(i-1)],&backwardPoints[3*(i-1)]+3);
+      edgePointIds.push_back(backwardEdgePointIds[2*(i-1)]);
+      edgePointIds.push_back(backwardEdgePointIds[2*(i-1)+1]);
+      edgeParameters.push_back(backwardEdgeParameters[i-1]);
+      }
+    points.insert(points.end(),forwardPoints.begin(),forwardPoints.end());
+    edgePointIds.insert(edgePointIds.end(),forwardEdgePointIds.begin(),forwardEdgePointIds.end());
+    edgeParameters.insert(edgeParameters.end(),forwardEdgeParameters.begin(),forwardEdgeParameters.end());
+    }
+
+  // a closed contour through a surface point on the plane ends where it starts
+  vtkIdType numberOfPoints = static_cast<vtkIdType>(edgeParameters.size());
+  vtkIdType firstKey[2], lastKey[2];
+  if (numberOfPoints > 1)
+    {
+    vtkvmtkPolyDataSectionLocatorSectionPointKey(edgePointIds,edgeParameters,0,firstKey);
+    vtkvmtkPolyDataSectionLocatorSectionPointKey(edgePointIds,edgeParameters,numberOfPoints-1,lastKey);
+    }
+  if (closed && numberOfPoints > 1 && firstKey[0] == lastKey[0] && firstKey[1] == lastKey[1])
+    {
+    numberOfPoints--;
+    points.resize(3*numberOfPoints);
+    edgePointIds.resize(2*numberOfPoints);
+    edgeParameters.resize(numberOfPoints);
+    }
+
+  return numberOfPoints;
+}
+
+void vtkvmtkPolyDataSectionLocator::ExtractSection(const double origin[3], const double normal[3], vtkPolyData* section, bool& closed)
+{
+  section->Initialize();
+
+  std::vector<double> points;
+  std::vector<vtkIdType> edgePointIds;
+  std::vector<double> edgeParameters;
+  vtkIdType numberOfPoints = this->ExtractSection(origin,normal,points,edgePointIds,edgeParameters,closed);
+
+  if (numberOfPoints == 0)
+    {
+    return;
+    }
+
+  vtkPoints* sectionPoints = vtkPoints::New();
+  sectionPoints->SetNumberOfPoints(numberOfPoints);
+  vtkCellArray* sectionPolys = vtkCellArray::New();
+  sectionPolys->InsertNextCell(numberOfPoints);
+
+  vtkPointData* surfacePointData = this->Surface->GetPointData();
+  vtkPointData* sectionPointData = section->GetPointData();
+  sectionPointData->InterpolateAllocate(surfacePointData,numberOfPoints);
+
+  for (vtkIdType i=0; i<numberOfPoints; i++)
+    {
+    sectionPoints->SetPoint(i,&points[3*i]);
+    sectionPointData->InterpolateEdge(surfacePointData,i,edgePointIds[2*i],edgePointIds[2*i+1],edgeParameters[i]);
+    sectionPolys->InsertCellPoint(i);
+    }
+
+  section->SetPoints(sectionPoints);
+  section->SetPolys(sectionPolys);
+
+  sectionPoints->Delete();
+  sectionPolys->Delete();
+}
+
+void vtkvmtkPolyDataSectionLocator::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os,indent);
+}
@@ -0,0 +1,102 @@
+/*=========================================================================
+
+Program:   VMTK
+Module:    $RCSfile: vtkvmtkPolyDataSectionLocator.h,v $
+Language:  C++
+Date:      $Date: 2006/04/06 16:46:43 $
+Version:   $Revision: 1.4 $
+
+  Copyright (c) Luca Antiga, David Steinman. All rights reserved.
+  See LICENCE file for details.
+
+  Portions of this code are covered under the VTK copyright.
+  See VTKCopyright.txt or http://www.kitware.com/VTKCopyright.htm
+  for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+  // .NAME vtkvmtkPolyDataSectionLocator - Extracts plane sections of a triangulated surface without cutting the whole surface.
+  // .SECTION Description
+  // Triangles of the surface are kept in a bounding volume hierarchy,
+  // together with their edge neighbors. A section through a plane is the
+  // connected contour of the plane containing the contour point closest to
+  // the plane origin, as obtained by vtkvmtkPolyDataBranchSections::
+  // ExtractCylinderSection with vtkCutter and vtkPolyDataConnectivityFilter.
+  // Here the hierarchy only visits the triangles straddling the plane close
+  // to the origin to find the triangle holding that point, and the contour
+  // is then walked from it across shared edges.
+  //
+  // Sections are returned as a single polygon (or an open polyline, stored
+  // as a polygon as well, with closed set to false). ExtractSection is
+  // thread safe after Build, so independent sections can be extracted in
+  // parallel.
+
+#ifndef __vtkvmtkPolyDataSectionLocator_h
+#define __vtkvmtkPolyDataSectionLocator_h
+
+#include "vtkObject.h"
+#include "vtkPolyData.h"
+#include "vtkvmtkWin32Header.h"
+
+#include <vector>
+
+class VTK_VMTK_COMPUTATIONAL_GEOMETRY_EXPORT vtkvmtkPolyDataSectionLocator : public vtkObject
+{
+  public:
+  vtkTypeMacro(vtkvmtkPolyDataSectionLocator,vtkObject);
+  void PrintSelf(ostream& os, vtkIndent indent) VTK_OVERRIDE;
+
+  static vtkvmtkPolyDataSectionLocator *New();
+
+  vtkSetObjectMacro(Surface,vtkPolyData);
+  vtkGetObjectMacro(Surface,vtkPolyData);
+
+  // Description:
+  // Builds the triangle hierarchy and edge neighbors. Returns 0 if the
+  // surface is not set or has cells other than triangles.
+  int Build();
+
+  // Description:
+  // Thread safe, after Build. Section point coordinates (three per point,
+  // in contour order) and, for each point, the two surface point ids of the
+  // cut edge and the interpolation parameter along it. Returns the number
+  // of section points, 0 if the plane does not cut the surface.
+  vtkIdType ExtractSection(const double origin[3], const double normal[3], std::vector<double>& points, std::vector<vtkIdType>& edgePointIds, std::vector<double>& edgeParameters, bool& closed);
+
+  // Description:
+  // Fills section with the section points, interpolated surface point data
+  // and a single polygon, as vtkvmtkPolyDataBranchSections::ExtractCylinderSection.
+  // The section is left empty if the plane does not cut the surface.
+  void ExtractSection(const double origin[3], const double normal[3], vtkPolyData* section, bool& closed);
+
+  protected:
+  vtkvmtkPolyDataSectionLocator();
+  ~vtkvmtkPolyDataSectionLocator();
+
+  vtkIdType FindClosestContourTriangle(const double origin[3], const double normal[3]);
+  void GetContourEdges(vtkIdType triangleId, const double origin[3], const double normal[3], int edges[2]);
+  void AppendEdgePoint(vtkIdType triangleId, int edge, const double origin[3], const double normal[3], std::vector<double>& points, std::vector<vtkIdType>& edgePointIds, std::vector<double>& edgeParameters);
+
+  vtkPolyData* Surface;
+
+  // triangle point ids and, per edge (k,k+1), the neighbor triangle (-1 on
+  // boundary and non manifold edges)
+  std::vector<vtkIdType> TrianglePointIds;
+  std::vector<vtkIdType> TriangleNeighbors;
+
+  // hierarchy: node bounds, children (or first triangle for leaves, with a
+  // negative count) and triangles in leaf order
+  std::vector<double> NodeBounds;
+  std::vector<vtkIdType> NodeFirst;
+  std::vector<vtkIdType> NodeCount;
+  std::vector<vtkIdType> TriangleIds;
+
+  private:
+  vtkvmtkPolyDataSectionLocator(const vtkvmtkPolyDataSectionLocator&);  // Not implemented.
+  void operator=(const vtkvmtkPolyDataSectionLocator&);  // Not implemented.
+};
+
+#endif
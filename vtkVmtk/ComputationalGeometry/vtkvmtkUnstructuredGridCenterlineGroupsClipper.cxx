@@ -28,6 +28,7 @@ Version:   $Revision: 1.9 $
 #include "vtkClipDataSet.h"
 #include "vtkvmtkAppendFilter.h"
 #include "vtkvmtkPolyBallLine.h"
+#include "vtkvmtkCenterlineGroupTubes.h"
 #include "vtkMath.h"
 #include "vtkInformation.h"
 #include "vtkInformationVector.h"
@@ -51,6 +52,7 @@ vtkvmtkUnstructuredGridCenterlineGroupsClipper::vtkvmtkUnstructuredGridCenterlin
   this->CutoffRadiusFactor = VTK_VMTK_LARGE_DOUBLE;
   this->ClipValue = 0.0; 
   this->UseRadiusInformation = 1; 
+  this->UseNearestTubes = 0;
  
   this->SetNumberOfOutputPorts(2);
   this->GenerateClippedOutput = 0;
@@ -258,6 +260,25 @@ int vtkvmtkUnstructuredGridCenterlineGroupsClipper::RequestData(
     centerlineGroupIds->DeepCopy(this->CenterlineGroupIds);
     }
 
+  // nearest tubes mode: the two nearest group tubes of every point give all
+  // the clipping arrays, exactly where they matter for clipping
+  vtkvmtkCenterlineGroupTubes* nearestTubes = NULL;
+  vtkIdList* groupCellIds = NULL;
+  if (this->UseNearestTubes && this->ClipValue >= 0.0)
+    {
+    nearestTubes = vtkvmtkCenterlineGroupTubes::New();
+    nearestTubes->SetCenterlines(this->Centerlines);
+    nearestTubes->SetCenterlineGroupIdsArrayName(this->CenterlineGroupIdsArrayName);
+    nearestTubes->SetCenterlineRadiusArrayName(this->CenterlineRadiusArrayName);
+    nearestTubes->SetBlankingArrayName(this->BlankingArrayName);
+    nearestTubes->SetUseRadiusInformation(this->UseRadiusInformation);
+    nearestTubes->SetCutoffRadiusFactor(this->CutoffRadiusFactor);
+    nearestTubes->SetClipValue(this->ClipValue);
+    nearestTubes->Build();
+    nearestTubes->ComputeBestTubes(input);
+    groupCellIds = vtkIdList::New();
+    }
+
   for (i=0; i<centerlineGroupIds->GetNumberOfIds(); i++)
     {
     groupId = centerlineGroupIds->GetId(i);
@@ -286,33 +307,68 @@ int vtkvmtkUnstructuredGridCenterlineGroupsClipper::RequestData(
       continue;
       }
 
-    groupTubes->SetInputCellIds(groupTubesGroupIds);
-    nonGroupTubes->SetInputCellIds(nonGroupTubesGroupIds);
+    vtkUnstructuredGrid* groupClippingInput = clippingInput;
 
-    for (int k=0; k<numberOfPoints; k++)
+    if (nearestTubes)
       {
-      input->GetPoint(k,point);
-      groupTubeValue = groupTubes->EvaluateFunction(point);
-      if (groupTubeValue > this->CutoffRadiusFactor * this->CutoffRadiusFactor - 1)
+      nearestTubes->ComputeGroupClippingArray(input,groupId,clippingArray);
+      clippingArray->Modified();
+      if (!this->GenerateClippedOutput)
         {
-        groupTubeValue = VTK_VMTK_LARGE_DOUBLE;
+        // only pass on the cells that may be clipped for the group
+        nearestTubes->GetGroupCellIds(groupId,groupCellIds);
+        groupClippingInput = vtkUnstructuredGrid::New();
+        groupClippingInput->SetPoints(clippingInput->GetPoints());
+        groupClippingInput->GetPointData()->PassData(clippingInput->GetPointData());
+        groupClippingInput->GetPointData()->SetActiveScalars(clippingArrayName);
+        groupClippingInput->GetCellData()->CopyAllocate(clippingInput->GetCellData(),groupCellIds->GetNumberOfIds());
+        groupClippingInput->Allocate(groupCellIds->GetNumberOfIds());
+        vtkIdList* cellPointIds = vtkIdList::New();
+        for (int k=0; k<groupCellIds->GetNumberOfIds(); k++)
+          {
+          vtkIdType cellId = groupCellIds->GetId(k);
+          clippingInput->GetCellPoints(cellId,cellPointIds);
+          vtkIdType newCellId = groupClippingInput->InsertNextCell(clippingInput->GetCellType(cellId),cellPointIds);
+          groupClippingInput->GetCellData()->CopyData(clippingInput->GetCellData(),cellId,newCellId);
+          }
+        cellPointIds->Delete();
+        }
+      }
+    else
+      {
+      groupTubes->SetInputCellIds(groupTubesGroupIds);
+      nonGroupTubes->SetInputCellIds(nonGroupTubesGroupIds);
+
+      for (int k=0; k<numberOfPoints; k++)
+        {
+        input->GetPoint(k,point);
+        groupTubeValue = groupTubes->EvaluateFunction(point);
+        if (groupTubeValue > this->CutoffRadiusFactor * this->CutoffRadiusFactor - 1)
+          {
+          groupTubeValue = VTK_VMTK_LARGE_DOUBLE;
+          }
+        nonGroupTubeValue = nonGroupTubes->EvaluateFunction(point);
+        tubeDifferenceValue = nonGroupTubeValue - groupTubeValue;
+        clippingArray->SetValue(k,tubeDifferenceValue);
         }
-      nonGroupTubeValue = nonGroupTubes->EvaluateFunction(point);
-      tubeDifferenceValue = nonGroupTubeValue - groupTubeValue;
-      clippingArray->SetValue(k,tubeDifferenceValue);
       }
 
     vtkClipDataSet* clipper = vtkClipDataSet::New();
 #if (VTK_MAJOR_VERSION <= 5)
-    clipper->SetInput(clippingInput);
+    clipper->SetInput(groupClippingInput);
 #else
-    clipper->SetInputData(clippingInput);
+    clipper->SetInputData(groupClippingInput);
 #endif
     clipper->SetValue(this->ClipValue);
     clipper->GenerateClipScalarsOff();
     clipper->SetGenerateClippedOutput(this->GenerateClippedOutput);
     clipper->Update();
 
+    if (groupClippingInput != clippingInput)
+      {
+      groupClippingInput->Delete();
+      }
+
     if (clipper->GetOutput()->GetNumberOfPoints()==0)
       {
       clipper->Delete();
@@ -369,6 +425,11 @@ int vtkvmtkUnstructuredGridCenterlineGroupsClipper::RequestData(
   groupTubesGroupIds->Delete();
   nonGroupTubesGroupIds->Delete();
   centerlineGroupIds->Delete();
+  if (nearestTubes)
+    {
+    nearestTubes->Delete();
+    groupCellIds->Delete();
+    }
 
   return 1;
 }
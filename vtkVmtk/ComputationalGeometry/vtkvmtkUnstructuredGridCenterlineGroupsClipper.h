@@ -77,6 +77,16 @@ class VTK_VMTK_COMPUTATIONAL_GEOMETRY_EXPORT vtkvmtkUnstructuredGridCenterlineGr
   vtkGetMacro(UseRadiusInformation,int);
   vtkBooleanMacro(UseRadiusInformation,int);
 
+  // Description:
+  // If on, the two nearest group tubes of every point are found once, with
+  // a segment hierarchy, and all group clipping arrays are derived from
+  // them (see vtkvmtkCenterlineGroupTubes). Branches are the same; only
+  // the clipping array left on the clipped output, away from the branch,
+  // may differ. Requires a non-negative ClipValue, otherwise ignored.
+  vtkSetMacro(UseNearestTubes,int);
+  vtkGetMacro(UseNearestTubes,int);
+  vtkBooleanMacro(UseNearestTubes,int);
+
   protected:
   vtkvmtkUnstructuredGridCenterlineGroupsClipper();
   ~vtkvmtkUnstructuredGridCenterlineGroupsClipper();
@@ -100,6 +110,7 @@ class VTK_VMTK_COMPUTATIONAL_GEOMETRY_EXPORT vtkvmtkUnstructuredGridCenterlineGr
   int GenerateClippedOutput;
 
   int UseRadiusInformation;
+  int UseNearestTubes;
 
   private:
   vtkvmtkUnstructuredGridCenterlineGroupsClipper(const vtkvmtkUnstructuredGridCenterlineGroupsClipper&);  // Not implemented.
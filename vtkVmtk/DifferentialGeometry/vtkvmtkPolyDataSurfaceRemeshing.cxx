@@ -22,12 +22,16 @@
 #include "vtkvmtkPolyDataSurfaceRemeshing.h"
 #include "vtkvmtkPolyDataUmbrellaStencil.h"
 #include "vtkvmtkPolyDataBoundaryExtractor.h"
+#include "vtkvmtkClosestPointProjector.h"
 #include "vtkPolyDataNormals.h"
 #include "vtkIdList.h"
 #include "vtkIntArray.h"
+#include "vtkDoubleArray.h"
+#include "vtkFieldData.h"
 #include "vtkCellArray.h"
 #include "vtkMeshQuality.h"
 #include "vtkCellLocator.h"
+#include "vtkGenericCell.h"
 #include "vtkTriangle.h"
 #include "vtkPointData.h"
 #include "vtkCellData.h"
@@ -35,6 +39,11 @@
 #include "vtkInformationVector.h"
 #include "vtkObjectFactory.h"
 #include "vtkVersion.h"
+#include "vtkSMPTools.h"
+#include "vtkSMPThreadLocal.h"
+#include "vtkSMPThreadLocalObject.h"
+
+#include <algorithm>
 
 
 vtkStandardNewMacro(vtkvmtkPolyDataSurfaceRemeshing);
@@ -68,7 +77,19 @@ vtkvmtkPolyDataSurfaceRemeshing::vtkvmtkPolyDataSurfaceRemeshing()
   this->BoundaryLocator = NULL;
   this->EntityBoundaryLocator = NULL;
 
+  this->Projector = vtkvmtkClosestPointProjector::New();
+  this->EntityBoundaryProjector = vtkvmtkClosestPointProjector::New();
+
   this->ExcludedEntityIds = NULL;
+
+  this->UseParallelOperations = 0;
+
+  this->UseConvergenceCriterion = 0;
+  this->ConvergenceChangeRatio = 1E-3;
+  this->ConvergenceDisplacementRatio = 1E-2;
+
+  this->GeneratePassStatistics = 0;
+  this->PassStatistics = vtkFieldData::New();
 }
 
 vtkvmtkPolyDataSurfaceRemeshing::~vtkvmtkPolyDataSurfaceRemeshing()
@@ -109,6 +130,15 @@ vtkvmtkPolyDataSurfaceRemeshing::~vtkvmtkPolyDataSurfaceRemeshing()
     this->EntityBoundaryLocator = NULL;
     }
 
+  this->Projector->Delete();
+  this->Projector = NULL;
+
+  this->EntityBoundaryProjector->Delete();
+  this->EntityBoundaryProjector = NULL;
+
+  this->PassStatistics->Delete();
+  this->PassStatistics = NULL;
+
   if (this->TargetAreaArrayName)
     {
     delete[] this->TargetAreaArrayName;
@@ -316,40 +346,80 @@ int vtkvmtkPolyDataSurfaceRemeshing::RequestData(
     this->EntityBoundaryLocator->BuildLocator();
     }
 
+  if (this->UseParallelOperations)
+    {
+    this->Projector->SetDataSet(input);
+    this->Projector->BuildLocator();
+    this->EntityBoundaryProjector->SetDataSet(this->InputEntityBoundary);
+    this->EntityBoundaryProjector->BuildLocator();
+    }
+
+  this->InitializePassStatistics();
+
   int relocationSuccess = RELOCATE_SUCCESS;
+  int numberOfPasses = 0;
+  double meanDisplacement = 0.0;
   for (int n=0; n<this->NumberOfIterations; n++)
     {
-    cout<<"Iteration "<<n+1<<"/"<<this->NumberOfIterations<<endl;
-    this->EdgeCollapseIteration();
-    this->EdgeFlipIteration();
-    this->EdgeSplitIteration();
-    this->EdgeFlipIteration();
-    relocationSuccess = this->PointRelocationIteration();
+    int numberOfCollapses = this->EdgeCollapseIteration();
+    int numberOfFlips = this->EdgeFlipIteration();
+    int numberOfSplits = this->EdgeSplitIteration();
+    numberOfFlips += this->EdgeFlipIteration();
+    relocationSuccess = this->PointRelocationIteration(true,meanDisplacement);
     if (relocationSuccess == RELOCATE_FAILURE)
       {
       break;
       }
-    this->EdgeFlipIteration();
+    numberOfFlips += this->EdgeFlipIteration();
 
+    // a pass without flips leaves the mesh as it is, and so would the next ones
     for (int i=0; i<this->NumberOfConnectivityOptimizationIterations; i++)
       {
-      this->EdgeFlipConnectivityOptimizationIteration();
+      int numberOfConnectivityFlips = this->EdgeFlipConnectivityOptimizationIteration();
+      if (numberOfConnectivityFlips == 0)
+        {
+        break;
+        }
+      numberOfFlips += numberOfConnectivityFlips;
+      }
+
+    numberOfPasses++;
+    this->InsertPassStatistics(numberOfCollapses,numberOfFlips,numberOfSplits,meanDisplacement);
+    this->UpdateProgress(0.5 * double(n+1) / double(this->NumberOfIterations));
+
+    if (this->UseConvergenceCriterion && this->IsPassConverged(numberOfCollapses+numberOfFlips+numberOfSplits,meanDisplacement))
+      {
+      vtkDebugMacro(<<"Remeshing converged after "<<numberOfPasses<<" passes.");
+      break;
       }
     }
 
-  cout<<"Final mesh improvement"<<endl;
+  int numberOfFinalPasses = this->NumberOfIterations;
+  if (this->UseConvergenceCriterion)
+    {
+    numberOfFinalPasses = numberOfPasses;
+    }
+
   bool projectToSurface = false;
-  for (int i=0; i<this->NumberOfIterations; i++)
+  for (int i=0; i<numberOfFinalPasses; i++)
     {
-    if (i == this->NumberOfIterations/2)
+    if (i == numberOfFinalPasses/2)
       {
       projectToSurface = true;
       }
-    relocationSuccess = this->PointRelocationIteration(projectToSurface);
+    relocationSuccess = this->PointRelocationIteration(projectToSurface,meanDisplacement);
     if (relocationSuccess == RELOCATE_FAILURE)
       {
       break;
       }
+
+    this->InsertPassStatistics(0,0,0,meanDisplacement);
+    this->UpdateProgress(0.5 + 0.5 * double(i+1) / double(numberOfFinalPasses));
+
+    if (this->UseConvergenceCriterion && projectToSurface && this->IsPassConverged(0,meanDisplacement))
+      {
+      break;
+      }
     }
 
   if (relocationSuccess == RELOCATE_FAILURE)
@@ -384,6 +454,14 @@ int vtkvmtkPolyDataSurfaceRemeshing::RequestData(
   output->SetPoints(newPoints);
   output->SetPolys(newCells);
   output->GetCellData()->AddArray(newCellEntityIdsArray);
+
+  if (this->GeneratePassStatistics)
+    {
+    for (int i=0; i<this->PassStatistics->GetNumberOfArrays(); i++)
+      {
+      output->GetFieldData()->AddArray(this->PassStatistics->GetAbstractArray(i));
+      }
+    }
  
   newPoints->Delete();
   newCells->Delete();
@@ -496,6 +574,11 @@ int vtkvmtkPolyDataSurfaceRemeshing::IsPointOnBoundary(vtkIdType pointId)
 int vtkvmtkPolyDataSurfaceRemeshing::EdgeFlipConnectivityOptimizationIteration()
 {
   //TODO: randomize. 
+  if (this->UseParallelOperations)
+    {
+    return this->BatchedOperationIteration(EDGE_FLIP_CONNECTIVITY_OPERATION);
+    }
+
   int numberOfChanges = 0;
   int numberOfCells = this->Mesh->GetNumberOfCells();
   for (int i=0; i<numberOfCells; i++)
@@ -527,6 +610,11 @@ int vtkvmtkPolyDataSurfaceRemeshing::EdgeFlipConnectivityOptimizationIteration()
 
 int vtkvmtkPolyDataSurfaceRemeshing::EdgeFlipIteration()
 {
+  if (this->UseParallelOperations)
+    {
+    return this->BatchedOperationIteration(EDGE_FLIP_OPERATION);
+    }
+
   int numberOfChanges = 0;
   int numberOfCells = this->Mesh->GetNumberOfCells();
   for (int i=0; i<numberOfCells; i++)
@@ -558,6 +646,11 @@ int vtkvmtkPolyDataSurfaceRemeshing::EdgeFlipIteration()
 
 int vtkvmtkPolyDataSurfaceRemeshing::EdgeCollapseIteration()
 {
+  if (this->UseParallelOperations)
+    {
+    return this->BatchedOperationIteration(EDGE_COLLAPSE_OPERATION);
+    }
+
   int numberOfChanges = 0;
   int numberOfCells = this->Mesh->GetNumberOfCells();
   for (int i=0; i<numberOfCells; i++)
@@ -580,6 +673,11 @@ int vtkvmtkPolyDataSurfaceRemeshing::EdgeCollapseIteration()
 
 int vtkvmtkPolyDataSurfaceRemeshing::EdgeSplitIteration()
 {
+  if (this->UseParallelOperations)
+    {
+    return this->BatchedOperationIteration(EDGE_SPLIT_OPERATION);
+    }
+
   int numberOfChanges = 0;
   int numberOfCells = this->Mesh->GetNumberOfCells();
   for (int i=0; i<numberOfCells; i++)
@@ -602,6 +700,11 @@ int vtkvmtkPolyDataSurfaceRemeshing::EdgeSplitIteration()
 
 int vtkvmtkPolyDataSurfaceRemeshing::TriangleSplitIteration()
 {
+  if (this->UseParallelOperations)
+    {
+    return this->BatchedOperationIteration(TRIANGLE_SPLIT_OPERATION);
+    }
+
   int numberOfChanges = 0;
   int numberOfCells = this->Mesh->GetNumberOfCells();
   for (int i=0; i<numberOfCells; i++)
@@ -623,6 +726,11 @@ int vtkvmtkPolyDataSurfaceRemeshing::TriangleSplitIteration()
 
 int vtkvmtkPolyDataSurfaceRemeshing::PointRelocationIteration(bool projectToSurface)
 {
+  if (this->UseParallelOperations)
+    {
+    return this->ParallelPointRelocationIteration(projectToSurface);
+    }
+
   int numberOfPoints = this->Mesh->GetNumberOfPoints();
   int success = RELOCATE_SUCCESS;
   for (int i=0; i<numberOfPoints; i++)
@@ -636,6 +744,594 @@ int vtkvmtkPolyDataSurfaceRemeshing::PointRelocationIteration(bool projectToSurf
   return RELOCATE_SUCCESS;
 }
 
+int vtkvmtkPolyDataSurfaceRemeshing::PointRelocationIteration(bool projectToSurface, double& meanDisplacement)
+{
+  meanDisplacement = 0.0;
+
+  vtkPoints* points = this->Mesh->GetPoints();
+  vtkIdType numberOfPoints = points->GetNumberOfPoints();
+  std::vector<double> previousPoints(3*numberOfPoints);
+  for (vtkIdType i=0; i<numberOfPoints; i++)
+    {
+    points->GetPoint(i,&previousPoints[3*i]);
+    }
+
+  int success = this->PointRelocationIteration(projectToSurface);
+  if (success == RELOCATE_FAILURE)
+    {
+    return RELOCATE_FAILURE;
+    }
+
+  // points left by collapses have no cells and are not counted
+  vtkIdType numberOfMeshPoints = 0;
+  double point[3];
+  for (vtkIdType i=0; i<numberOfPoints; i++)
+    {
+    unsigned short ncells;
+    vtkIdType* cells;
+    this->Mesh->GetPointCells(i,ncells,cells);
+    if (ncells == 0)
+      {
+      continue;
+      }
+    points->GetPoint(i,point);
+    meanDisplacement += sqrt(vtkMath::Distance2BetweenPoints(point,&previousPoints[3*i]));
+    numberOfMeshPoints++;
+    }
+
+  if (numberOfMeshPoints > 0)
+    {
+    meanDisplacement /= double(numberOfMeshPoints);
+    }
+
+  return RELOCATE_SUCCESS;
+}
+
+// area quality bins: below 1/4, 1/2, 1, 2, 4 and above
+static const int vtkvmtkPolyDataSurfaceRemeshingNumberOfAreaQualityBins = 6;
+
+void vtkvmtkPolyDataSurfaceRemeshing::InitializePassStatistics()
+{
+  this->PassStatistics->Initialize();
+
+  if (!this->GeneratePassStatistics)
+    {
+    return;
+    }
+
+  vtkIntArray* numberOfCollapsesArray = vtkIntArray::New();
+  numberOfCollapsesArray->SetName("NumberOfCollapses");
+  this->PassStatistics->AddArray(numberOfCollapsesArray);
+  numberOfCollapsesArray->Delete();
+
+  vtkIntArray* numberOfFlipsArray = vtkIntArray::New();
+  numberOfFlipsArray->SetName("NumberOfFlips");
+  this->PassStatistics->AddArray(numberOfFlipsArray);
+  numberOfFlipsArray->Delete();
+
+  vtkIntArray* numberOfSplitsArray = vtkIntArray::New();
+  numberOfSplitsArray->SetName("NumberOfSplits");
+  this->PassStatistics->AddArray(numberOfSplitsArray);
+  numberOfSplitsArray->Delete();
+
+  vtkDoubleArray* meanDisplacementArray = vtkDoubleArray::New();
+  meanDisplacementArray->SetName("MeanRelocationDisplacement");
+  this->PassStatistics->AddArray(meanDisplacementArray);
+  meanDisplacementArray->Delete();
+
+  vtkIntArray* areaQualityHistogramArray = vtkIntArray::New();
+  areaQualityHistogramArray->SetName("AreaQualityHistogram");
+  areaQualityHistogramArray->SetNumberOfComponents(vtkvmtkPolyDataSurfaceRemeshingNumberOfAreaQualityBins);
+  this->PassStatistics->AddArray(areaQualityHistogramArray);
+  areaQualityHistogramArray->Delete();
+}
+
+void vtkvmtkPolyDataSurfaceRemeshing::InsertPassStatistics(int numberOfCollapses, int numberOfFlips, int numberOfSplits, double meanDisplacement)
+{
+  if (!this->GeneratePassStatistics)
+    {
+    return;
+    }
+
+  vtkIntArray::SafeDownCast(this->PassStatistics->GetArray("NumberOfCollapses"))->InsertNextValue(numberOfCollapses);
+  vtkIntArray::SafeDownCast(this->PassStatistics->GetArray("NumberOfFlips"))->InsertNextValue(numberOfFlips);
+  vtkIntArray::SafeDownCast(this->PassStatistics->GetArray("NumberOfSplits"))->InsertNextValue(numberOfSplits);
+  vtkDoubleArray::SafeDownCast(this->PassStatistics->GetArray("MeanRelocationDisplacement"))->InsertNextValue(meanDisplacement);
+
+  double histogram[vtkvmtkPolyDataSurfaceRemeshingNumberOfAreaQualityBins];
+  this->ComputeAreaQualityHistogram(histogram);
+  this->PassStatistics->GetArray("AreaQualityHistogram")->InsertNextTuple(histogram);
+}
+
+void vtkvmtkPolyDataSurfaceRemeshing::ComputeAreaQualityHistogram(double* histogram)
+{
+  for (int k=0; k<vtkvmtkPolyDataSurfaceRemeshingNumberOfAreaQualityBins; k++)
+    {
+    histogram[k] = 0.0;
+    }
+
+  if (this->ElementSizeMode == TARGET_AREA_ARRAY && this->UseParallelOperations)
+    {
+    this->ComputeCellTargetAreas();
+    }
+
+  double point1[3], point2[3], point3[3];
+  int numberOfCells = this->Mesh->GetNumberOfCells();
+  for (int i=0; i<numberOfCells; i++)
+    {
+    if (this->Mesh->GetCellType(i) != VTK_TRIANGLE)
+      {
+      continue;
+      }
+    vtkIdType npts, *pts;
+    this->Mesh->GetCellPoints(i,npts,pts);
+    this->Mesh->GetPoint(pts[0],point1);
+    this->Mesh->GetPoint(pts[1],point2);
+    this->Mesh->GetPoint(pts[2],point3);
+    double area = vtkTriangle::TriangleArea(point1,point2,point3);
+    double targetArea = this->ComputeTriangleTargetArea(i);
+    if (targetArea <= 0.0)
+      {
+      continue;
+      }
+    double areaRatio = area / targetArea;
+    int bin = 0;
+    double binUpperRatio = 0.25;
+    while (bin < vtkvmtkPolyDataSurfaceRemeshingNumberOfAreaQualityBins-1 && areaRatio >= binUpperRatio)
+      {
+      bin++;
+      binUpperRatio *= 2.0;
+      }
+    histogram[bin] += 1.0;
+    }
+}
+
+int vtkvmtkPolyDataSurfaceRemeshing::IsPassConverged(int numberOfChanges, double meanDisplacement)
+{
+  double point1[3], point2[3], point3[3];
+  double meanArea = 0.0;
+  int numberOfTriangles = 0;
+  int numberOfCells = this->Mesh->GetNumberOfCells();
+  for (int i=0; i<numberOfCells; i++)
+    {
+    if (this->Mesh->GetCellType(i) != VTK_TRIANGLE)
+      {
+      continue;
+      }
+    vtkIdType npts, *pts;
+    this->Mesh->GetCellPoints(i,npts,pts);
+    this->Mesh->GetPoint(pts[0],point1);
+    this->Mesh->GetPoint(pts[1],point2);
+    this->Mesh->GetPoint(pts[2],point3);
+    meanArea += vtkTriangle::TriangleArea(point1,point2,point3);
+    numberOfTriangles++;
+    }
+
+  if (numberOfTriangles == 0)
+    {
+    return 1;
+    }
+
+  meanArea /= double(numberOfTriangles);
+
+  if (double(numberOfChanges) > this->ConvergenceChangeRatio * double(numberOfTriangles))
+    {
+    return 0;
+    }
+
+  if (meanDisplacement > this->ConvergenceDisplacementRatio * sqrt(meanArea))
+    {
+    return 0;
+    }
+
+  return 1;
+}
+
+class vtkvmtkPolyDataSurfaceRemeshingTestFunctor
+{
+public:
+  vtkvmtkPolyDataSurfaceRemeshingTestFunctor(vtkvmtkPolyDataSurfaceRemeshing* remeshing, int operation, vtkIdType* candidates) :
+    Remeshing(remeshing), Operation(operation), Candidates(candidates) {}
+
+  void operator()(vtkIdType begin, vtkIdType end)
+  {
+    vtkPolyData* mesh = this->Remeshing->Mesh;
+    vtkIdType npts, *pts;
+    for (vtkIdType i=begin; i<end; i++)
+      {
+      vtkIdType& pt1 = this->Candidates[2*i];
+      vtkIdType& pt2 = this->Candidates[2*i+1];
+      pt1 = pt2 = -1;
+      if (mesh->GetCellType(i) != VTK_TRIANGLE)
+        {
+        continue;
+        }
+      switch (this->Operation)
+        {
+        case vtkvmtkPolyDataSurfaceRemeshing::EDGE_COLLAPSE_OPERATION:
+          if (this->Remeshing->TestAspectRatioCollapseEdge(i,pt1,pt2) == vtkvmtkPolyDataSurfaceRemeshing::DO_NOTHING)
+            {
+            pt1 = pt2 = -1;
+            }
+          break;
+        case vtkvmtkPolyDataSurfaceRemeshing::EDGE_SPLIT_OPERATION:
+          if (this->Remeshing->TestAreaSplitEdge(i,pt1,pt2) == vtkvmtkPolyDataSurfaceRemeshing::DO_NOTHING)
+            {
+            pt1 = pt2 = -1;
+            }
+          break;
+        case vtkvmtkPolyDataSurfaceRemeshing::TRIANGLE_SPLIT_OPERATION:
+          // the candidate is the cell itself
+          if (this->Remeshing->TestTriangleSplit(i) == vtkvmtkPolyDataSurfaceRemeshing::DO_CHANGE)
+            {
+            pt1 = pt2 = i;
+            }
+          break;
+        case vtkvmtkPolyDataSurfaceRemeshing::EDGE_FLIP_OPERATION:
+        case vtkvmtkPolyDataSurfaceRemeshing::EDGE_FLIP_CONNECTIVITY_OPERATION:
+          {
+          mesh->GetCellPoints(i,npts,pts);
+          vtkIdType tripts[3];
+          tripts[0] = pts[0];
+          tripts[1] = pts[1];
+          tripts[2] = pts[2];
+          for (int j=0; j<3; j++)
+            {
+            int test;
+            if (this->Operation == vtkvmtkPolyDataSurfaceRemeshing::EDGE_FLIP_OPERATION)
+              {
+              test = this->Remeshing->TestDelaunayFlipEdge(tripts[j],tripts[(j+1)%3]);
+              }
+            else
+              {
+              test = this->Remeshing->TestConnectivityFlipEdge(tripts[j],tripts[(j+1)%3]);
+              }
+            if (test == vtkvmtkPolyDataSurfaceRemeshing::DO_CHANGE)
+              {
+              pt1 = tripts[j];
+              pt2 = tripts[(j+1)%3];
+              break;
+              }
+            }
+          }
+          break;
+        }
+      }
+  }
+
+private:
+  vtkvmtkPolyDataSurfaceRemeshing* Remeshing;
+  int Operation;
+  vtkIdType* Candidates;
+};
+
+class vtkvmtkPolyDataSurfaceRemeshingTargetAreaFunctor
+{
+public:
+  vtkvmtkPolyDataSurfaceRemeshingTargetAreaFunctor(vtkvmtkPolyDataSurfaceRemeshing* remeshing) : Remeshing(remeshing) {}
+
+  void Initialize()
+  {
+    this->LocalWeights.Local().resize(this->Remeshing->Projector->GetMaximumCellSize());
+  }
+
+  void operator()(vtkIdType begin, vtkIdType end)
+  {
+    vtkGenericCell* cell = this->LocalCell.Local();
+    std::vector<double>& weights = this->LocalWeights.Local();
+    vtkPolyData* mesh = this->Remeshing->Mesh;
+    vtkDataArray* targetAreaArray = this->Remeshing->TargetAreaArray;
+    vtkIdType npts, *pts;
+    double point1[3], point2[3], point3[3], center[3], projectedCenter[3];
+    vtkIdType centerCellId;
+    int subId;
+    double dist2;
+    for (vtkIdType i=begin; i<end; i++)
+      {
+      double targetArea = 0.0;
+      if (mesh->GetCellType(i) == VTK_TRIANGLE)
+        {
+        mesh->GetCellPoints(i,npts,pts);
+        mesh->GetPoint(pts[0],point1);
+        mesh->GetPoint(pts[1],point2);
+        mesh->GetPoint(pts[2],point3);
+        vtkTriangle::TriangleCenter(point1,point2,point3,center);
+        this->Remeshing->Projector->FindClosestPoint(center,projectedCenter,cell,centerCellId,subId,dist2,&weights[0]);
+        if (centerCellId != -1)
+          {
+          for (vtkIdType j=0; j<cell->GetNumberOfPoints(); j++)
+            {
+            targetArea += weights[j] * targetAreaArray->GetComponent(cell->GetPointId(j),0);
+            }
+          }
+        }
+      this->Remeshing->CellTargetAreas[i] = targetArea * this->Remeshing->TargetAreaFactor;
+      }
+  }
+
+  void Reduce()
+  {
+  }
+
+private:
+  vtkvmtkPolyDataSurfaceRemeshing* Remeshing;
+  vtkSMPThreadLocalObject<vtkGenericCell> LocalCell;
+  vtkSMPThreadLocal<std::vector<double> > LocalWeights;
+};
+
+class vtkvmtkPolyDataSurfaceRemeshingRelocationFunctor
+{
+public:
+  vtkvmtkPolyDataSurfaceRemeshingRelocationFunctor(vtkvmtkPolyDataSurfaceRemeshing* remeshing, bool projectToSurface, double* relocatedPoints, char* relocated) :
+    Remeshing(remeshing), ProjectToSurface(projectToSurface), RelocatedPoints(relocatedPoints), Relocated(relocated) {}
+
+  void Initialize()
+  {
+    int maximumCellSize = std::max(this->Remeshing->Projector->GetMaximumCellSize(),this->Remeshing->EntityBoundaryProjector->GetMaximumCellSize());
+    this->LocalWeights.Local().resize(maximumCellSize);
+  }
+
+  void operator()(vtkIdType begin, vtkIdType end)
+  {
+    vtkGenericCell* cell = this->LocalCell.Local();
+    std::vector<double>& weights = this->LocalWeights.Local();
+    for (vtkIdType i=begin; i<end; i++)
+      {
+      this->Relocated[i] = this->Remeshing->ComputeRelocatedPoint(i,this->ProjectToSurface,cell,&weights[0],this->RelocatedPoints+3*i);
+      }
+  }
+
+  void Reduce()
+  {
+  }
+
+private:
+  vtkvmtkPolyDataSurfaceRemeshing* Remeshing;
+  bool ProjectToSurface;
+  double* RelocatedPoints;
+  char* Relocated;
+  vtkSMPThreadLocalObject<vtkGenericCell> LocalCell;
+  vtkSMPThreadLocal<std::vector<double> > LocalWeights;
+};
+
+void vtkvmtkPolyDataSurfaceRemeshing::InsertOneRingPoints(vtkIdType pointId, std::vector<vtkIdType>& pointIds)
+{
+  pointIds.push_back(pointId);
+  unsigned short ncells;
+  vtkIdType *cells;
+  vtkIdType npts, *pts;
+  this->Mesh->GetPointCells(pointId,ncells,cells);
+  for (int i=0; i<ncells; i++)
+    {
+    this->Mesh->GetCellPoints(cells[i],npts,pts);
+    pointIds.insert(pointIds.end(),pts,pts+npts);
+    }
+}
+
+void vtkvmtkPolyDataSurfaceRemeshing::ComputeCellTargetAreas()
+{
+  vtkIdType numberOfCells = this->Mesh->GetNumberOfCells();
+  this->CellTargetAreas.resize(numberOfCells);
+  vtkvmtkPolyDataSurfaceRemeshingTargetAreaFunctor functor(this);
+  vtkSMPTools::For(0,numberOfCells,functor);
+}
+
+int vtkvmtkPolyDataSurfaceRemeshing::BatchedOperationIteration(int operation)
+{
+  vtkIdType numberOfCells = this->Mesh->GetNumberOfCells();
+  if (numberOfCells == 0)
+    {
+    return 0;
+    }
+
+  if (this->ElementSizeMode == TARGET_AREA_ARRAY && operation != EDGE_FLIP_OPERATION && operation != EDGE_FLIP_CONNECTIVITY_OPERATION)
+    {
+    this->ComputeCellTargetAreas();
+    }
+
+  // tests only read the mesh, and run concurrently on all cells
+  std::vector<vtkIdType> candidates(2*numberOfCells);
+  vtkvmtkPolyDataSurfaceRemeshingTestFunctor functor(this,operation,&candidates[0]);
+  vtkSMPTools::For(0,numberOfCells,functor);
+
+  // a change only modifies the cells around the points of its edge (or
+  // triangle), and a test only reads the cells around the points of the
+  // tested edge, so a candidate whose neighborhood has no point touched by
+  // the changes applied so far still passes its test. Points added in the
+  // pass are beyond the end of touchedPoints and count as touched.
+  std::vector<char> touchedPoints(this->Mesh->GetNumberOfPoints(),0);
+  std::vector<vtkIdType> neighborhoodPointIds;
+  int numberOfChanges = 0;
+  for (vtkIdType i=0; i<numberOfCells; i++)
+    {
+    vtkIdType pt1 = candidates[2*i];
+    vtkIdType pt2 = candidates[2*i+1];
+    if (pt1 == -1)
+      {
+      continue;
+      }
+
+    neighborhoodPointIds.clear();
+    if (operation == TRIANGLE_SPLIT_OPERATION)
+      {
+      vtkIdType npts, *pts;
+      this->Mesh->GetCellPoints(i,npts,pts);
+      vtkIdType tripts[3];
+      tripts[0] = pts[0];
+      tripts[1] = pts[1];
+      tripts[2] = pts[2];
+      for (int j=0; j<3; j++)
+        {
+        this->InsertOneRingPoints(tripts[j],neighborhoodPointIds);
+        }
+      }
+    else
+      {
+      this->InsertOneRingPoints(pt1,neighborhoodPointIds);
+      this->InsertOneRingPoints(pt2,neighborhoodPointIds);
+      }
+
+    bool touched = false;
+    for (size_t j=0; j<neighborhoodPointIds.size(); j++)
+      {
+      vtkIdType pointId = neighborhoodPointIds[j];
+      if (pointId >= static_cast<vtkIdType>(touchedPoints.size()) || touchedPoints[pointId])
+        {
+        touched = true;
+        break;
+        }
+      }
+    if (touched)
+      {
+      continue;
+      }
+
+    int success = SUCCESS;
+    switch (operation)
+      {
+      case EDGE_COLLAPSE_OPERATION:
+        success = this->CollapseEdge(pt1,pt2);
+        break;
+      case EDGE_SPLIT_OPERATION:
+        success = this->SplitEdge(pt1,pt2);
+        break;
+      case TRIANGLE_SPLIT_OPERATION:
+        success = this->SplitTriangle(i);
+        break;
+      case EDGE_FLIP_OPERATION:
+      case EDGE_FLIP_CONNECTIVITY_OPERATION:
+        success = this->FlipEdge(pt1,pt2);
+        break;
+      }
+    if (success != SUCCESS)
+      {
+      continue;
+      }
+
+    for (size_t j=0; j<neighborhoodPointIds.size(); j++)
+      {
+      touchedPoints[neighborhoodPointIds[j]] = 1;
+      }
+    numberOfChanges++;
+    }
+
+  return numberOfChanges;
+}
+
+// Same relocation as RelocatePoint, which is compiled with USE_STENCIL,
+// computed without modifying the mesh. The umbrella stencil never flags
+// boundary points (vtkvmtkPolyDataNeighborhood::Build does not set
+// IsBoundary), so every point moves towards the uniform average of its
+// neighbors, in stencil order, and is projected onto the entity boundary
+// or, if projectToSurface, onto the surface. Returns 0 if the point is left
+// in place.
+int vtkvmtkPolyDataSurfaceRemeshing::ComputeRelocatedPoint(vtkIdType pointId, bool projectToSurface, vtkGenericCell* cell, double* weights, double relocatedPoint[3])
+{
+  unsigned short ncells;
+  vtkIdType* cells;
+  this->Mesh->GetPointCells(pointId,ncells,cells);
+  int i;
+  for (i=0; i<ncells; i++)
+    {
+    if (this->IsElementExcluded(cells[i]))
+      {
+      return 0;
+      }
+    }
+
+  // stencil points, collected as vtkvmtkPolyDataNeighborhood::Build does
+  std::vector<vtkIdType> stencilIds;
+  for (i=0; i<ncells; i++)
+    {
+    vtkIdType npts, *pts;
+    this->Mesh->GetCellPoints(cells[i],npts,pts);
+    for (vtkIdType j=0; j<npts; j++)
+      {
+      if (pts[j] != pointId && std::find(stencilIds.begin(),stencilIds.end(),pts[j]) == stencilIds.end())
+        {
+        stencilIds.push_back(pts[j]);
+        }
+      }
+    }
+
+  // as with the stencil, a point without neighbors has a zero target
+  double targetPoint[3];
+  targetPoint[0] = targetPoint[1] = targetPoint[2] = 0.0;
+  size_t numberOfStencilPoints = stencilIds.size();
+  if (numberOfStencilPoints > 0)
+    {
+    double stencilWeight = 1.0/double(numberOfStencilPoints);
+    double stencilPoint[3];
+    for (size_t k=0; k<numberOfStencilPoints; k++)
+      {
+      this->Mesh->GetPoint(stencilIds[k],stencilPoint);
+      targetPoint[0] += stencilWeight * stencilPoint[0];
+      targetPoint[1] += stencilWeight * stencilPoint[1];
+      targetPoint[2] += stencilWeight * stencilPoint[2];
+      }
+    }
+
+  double point[3];
+  this->Mesh->GetPoint(pointId,point);
+
+  double smoothedPoint[3];
+  smoothedPoint[0] = point[0] + this->Relaxation * (targetPoint[0] - point[0]);
+  smoothedPoint[1] = point[1] + this->Relaxation * (targetPoint[1] - point[1]);
+  smoothedPoint[2] = point[2] + this->Relaxation * (targetPoint[2] - point[2]);
+
+  vtkvmtkClosestPointProjector* projector = NULL;
+  if (this->IsPointOnEntityBoundary(pointId))
+    {
+    projector = this->EntityBoundaryProjector;
+    }
+  else if (projectToSurface)
+    {
+    projector = this->Projector;
+    }
+
+  if (projector)
+    {
+    vtkIdType cellId;
+    int subId;
+    double dist2;
+    projector->FindClosestPoint(smoothedPoint,relocatedPoint,cell,cellId,subId,dist2,weights);
+    }
+  else
+    {
+    relocatedPoint[0] = smoothedPoint[0];
+    relocatedPoint[1] = smoothedPoint[1];
+    relocatedPoint[2] = smoothedPoint[2];
+    }
+
+  return 1;
+}
+
+int vtkvmtkPolyDataSurfaceRemeshing::ParallelPointRelocationIteration(bool projectToSurface)
+{
+  vtkIdType numberOfPoints = this->Mesh->GetNumberOfPoints();
+  if (numberOfPoints == 0)
+    {
+    return RELOCATE_SUCCESS;
+    }
+
+  std::vector<double> relocatedPoints(3*numberOfPoints);
+  std::vector<char> relocated(numberOfPoints);
+  vtkvmtkPolyDataSurfaceRemeshingRelocationFunctor functor(this,projectToSurface,&relocatedPoints[0],&relocated[0]);
+  vtkSMPTools::For(0,numberOfPoints,functor);
+
+  vtkPoints* points = this->Mesh->GetPoints();
+  for (vtkIdType i=0; i<numberOfPoints; i++)
+    {
+    if (relocated[i])
+      {
+      points->SetPoint(i,&relocatedPoints[3*i]);
+      }
+    }
+  points->Modified();
+
+  return RELOCATE_SUCCESS;
+}
+
 int vtkvmtkPolyDataSurfaceRemeshing::IsElementExcluded(vtkIdType cellId)
 {
   int isElementExcluded = 0;
@@ -681,6 +1377,7 @@ int vtkvmtkPolyDataSurfaceRemeshing::IsPointOnEntityBoundary(vtkIdType pointId)
 
   if (!uniformCellEntityIds)
     {
+    ptCells->Delete();
     return 1;
     }
 
@@ -737,14 +1434,14 @@ int vtkvmtkPolyDataSurfaceRemeshing::FindOneRingNeighbors(vtkIdType pointId, vtk
   bp1 = p2;
 
   // walk around the neighborhood counter-clockwise and get cells
-  vtkCell* cell = NULL;
+  vtkIdType npts, *pts;
   for (j=0; j<numberOfCells; j++)
     {
-    cell = this->Mesh->GetCell(nextCell);
+    this->Mesh->GetCellPoints(nextCell,npts,pts);
     p1 = -1;
     for (i=0; i<3; i++)
       {
-      p1 = cell->GetPointId(i);
+      p1 = pts[i];
       if (p1 != pointId && p1 != p2)
         {
         break;
@@ -769,11 +1466,11 @@ int vtkvmtkPolyDataSurfaceRemeshing::FindOneRingNeighbors(vtkIdType pointId, vtk
   p2 = bp1;
   for (; j<numberOfCells && startCell!=-1; j++)
     {
-    cell = this->Mesh->GetCell(nextCell);
+    this->Mesh->GetCellPoints(nextCell,npts,pts);
     p1 = -1;
     for (i=0; i<3; i++)
       {
-      p1 = cell->GetPointId(i);
+      p1 = pts[i];
       if (p1 != pointId && p1 != p2)
         {
         break;
@@ -1601,6 +2298,10 @@ double vtkvmtkPolyDataSurfaceRemeshing::ComputeTriangleTargetArea(vtkIdType cell
     {
     targetArea = this->TargetArea;
     }
+  else if (this->ElementSizeMode == TARGET_AREA_ARRAY && this->UseParallelOperations)
+    {
+    targetArea = this->CellTargetAreas[cellId];
+    }
   else if (this->ElementSizeMode == TARGET_AREA_ARRAY)
     {
     vtkIdType npts, *pts;
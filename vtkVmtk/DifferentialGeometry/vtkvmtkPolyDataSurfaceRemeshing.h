@@ -30,8 +30,13 @@
 #include "vtkvmtkWin32Header.h"
 #include "vtkIdList.h"
 
+#include <vector>
+
 class vtkCellLocator;
+class vtkFieldData;
+class vtkGenericCell;
 class vtkIntArray;
+class vtkvmtkClosestPointProjector;
 
 class VTK_VMTK_DIFFERENTIAL_GEOMETRY_EXPORT vtkvmtkPolyDataSurfaceRemeshing : public vtkPolyDataAlgorithm
 {
@@ -100,6 +105,50 @@ public:
   vtkSetObjectMacro(ExcludedEntityIds,vtkIdList);
   vtkGetObjectMacro(ExcludedEntityIds,vtkIdList);
 
+  // Description:
+  // Run each pass of edge collapses, flips and splits as a batch: all cells
+  // are tested in parallel, then the changes are applied in cell order,
+  // skipping those whose point neighborhood overlaps the one of a change
+  // already applied in the pass, so that every applied change was tested
+  // on an unchanged neighborhood. Skipped changes are tested again in the
+  // next pass. Points are relocated in parallel from their positions in
+  // the previous pass, and projected onto static bounding volume
+  // hierarchies of the input surface and boundaries.
+  vtkSetMacro(UseParallelOperations,int);
+  vtkGetMacro(UseParallelOperations,int);
+  vtkBooleanMacro(UseParallelOperations,int);
+
+  // Description:
+  // Stop the remeshing passes once a pass makes at most
+  // ConvergenceChangeRatio times the number of triangles collapses, flips
+  // and splits, and moves points by a mean relocation displacement of at
+  // most ConvergenceDisplacementRatio times the square root of the mean
+  // triangle area. The final relocation passes are then as many as the
+  // remeshing passes run, and stop on the same displacement criterion once
+  // points are projected onto the surface.
+  vtkSetMacro(UseConvergenceCriterion,int);
+  vtkGetMacro(UseConvergenceCriterion,int);
+  vtkBooleanMacro(UseConvergenceCriterion,int);
+
+  vtkSetMacro(ConvergenceChangeRatio,double);
+  vtkGetMacro(ConvergenceChangeRatio,double);
+
+  vtkSetMacro(ConvergenceDisplacementRatio,double);
+  vtkGetMacro(ConvergenceDisplacementRatio,double);
+
+  // Description:
+  // Record, for every remeshing and final relocation pass, the number of
+  // collapses, flips and splits, the mean relocation displacement and a
+  // histogram of triangle area over target area (bins below 1/4, 1/2, 1,
+  // 2, 4 and above), in PassStatistics and in the output field data.
+  // PassStatistics can be read from ProgressEvent observers, the event
+  // being invoked after every pass.
+  vtkSetMacro(GeneratePassStatistics,int);
+  vtkGetMacro(GeneratePassStatistics,int);
+  vtkBooleanMacro(GeneratePassStatistics,int);
+
+  vtkGetObjectMacro(PassStatistics,vtkFieldData);
+
   //BTX
   enum {
     SUCCESS = 0,
@@ -133,6 +182,14 @@ public:
     POINT_ON_BOUNDARY,
     NO_NEIGHBORS
   };
+
+  enum {
+    EDGE_COLLAPSE_OPERATION,
+    EDGE_FLIP_OPERATION,
+    EDGE_FLIP_CONNECTIVITY_OPERATION,
+    EDGE_SPLIT_OPERATION,
+    TRIANGLE_SPLIT_OPERATION
+  };
   //ETX
 
 protected:
@@ -149,6 +206,18 @@ protected:
   int TriangleSplitIteration();
   int EdgeSplitIteration();
   int PointRelocationIteration(bool projectToSurface=true);
+  int PointRelocationIteration(bool projectToSurface, double& meanDisplacement);
+
+  void InitializePassStatistics();
+  void InsertPassStatistics(int numberOfCollapses, int numberOfFlips, int numberOfSplits, double meanDisplacement);
+  void ComputeAreaQualityHistogram(double* histogram);
+  int IsPassConverged(int numberOfChanges, double meanDisplacement);
+
+  int BatchedOperationIteration(int operation);
+  int ParallelPointRelocationIteration(bool projectToSurface);
+  void ComputeCellTargetAreas();
+  int ComputeRelocatedPoint(vtkIdType pointId, bool projectToSurface, vtkGenericCell* cell, double* weights, double relocatedPoint[3]);
+  void InsertOneRingPoints(vtkIdType pointId, std::vector<vtkIdType>& pointIds);
 
   int TestFlipEdgeValidity(vtkIdType pt1, vtkIdType pt2, vtkIdType cell1, vtkIdType cell2, vtkIdType pt3, vtkIdType pt4);
   int TestConnectivityFlipEdge(vtkIdType pt1, vtkIdType pt2);
@@ -184,6 +253,8 @@ protected:
   vtkCellLocator* Locator;
   vtkCellLocator* BoundaryLocator;
   vtkCellLocator* EntityBoundaryLocator;
+  vtkvmtkClosestPointProjector* Projector;
+  vtkvmtkClosestPointProjector* EntityBoundaryProjector;
   vtkIntArray* CellEntityIdsArray;
   vtkDataArray* TargetAreaArray;
   vtkIdList* ExcludedEntityIds;
@@ -209,6 +280,22 @@ protected:
 
   char* CellEntityIdsArrayName;
 
+  int UseParallelOperations;
+
+  int UseConvergenceCriterion;
+  double ConvergenceChangeRatio;
+  double ConvergenceDisplacementRatio;
+
+  int GeneratePassStatistics;
+  vtkFieldData* PassStatistics;
+
+  // target areas from TargetAreaArray of the cells tested in a batched pass
+  std::vector<double> CellTargetAreas;
+
+  friend class vtkvmtkPolyDataSurfaceRemeshingTestFunctor;
+  friend class vtkvmtkPolyDataSurfaceRemeshingTargetAreaFunctor;
+  friend class vtkvmtkPolyDataSurfaceRemeshingRelocationFunctor;
+
 private:
   vtkvmtkPolyDataSurfaceRemeshing(const vtkvmtkPolyDataSurfaceRemeshing&);  // Not implemented.
   void operator=(const vtkvmtkPolyDataSurfaceRemeshing&);  // Not implemented.
@@ -35,6 +35,7 @@ Version:   $Revision: 1.7 $
 #include "vtkInformation.h"
 #include "vtkInformationVector.h"
 #include "vtkObjectFactory.h"
+#include "vtkSMPTools.h"
 
 
 vtkStandardNewMacro(vtkvmtkBoundaryLayerGenerator);
@@ -152,7 +153,6 @@ int vtkvmtkBoundaryLayerGenerator::RequestData(
   vtkIdType i;
 
   vtkPoints* outputPoints = vtkPoints::New();
-  vtkPoints* warpedPoints = vtkPoints::New();
 
   vtkCellArray* boundaryLayerCellArray = vtkCellArray::New();
   vtkIdList* boundaryLayerCellTypes = vtkIdList::New();
@@ -239,8 +239,7 @@ int vtkvmtkBoundaryLayerGenerator::RequestData(
       }
     }
 
-  vtkIdList* edgePointIds = vtkIdList::New();
-  vtkIdList* edgeNeighborCellIds = vtkIdList::New();
+  this->BuildAdjacency(input);
 
   double relaxation = this->Relaxation;
   int initialNumberOfSubsteps = this->NumberOfSubsteps / 100;
@@ -276,14 +275,7 @@ int vtkvmtkBoundaryLayerGenerator::RequestData(
   int k;
   for (k=0; k<this->NumberOfSubLayers; k++)
     {
-    warpedPoints->Initialize();
-    this->WarpPoints(inputPoints,warpedPoints,k,warpQuadratic);
-
-    for (i=0; i<numberOfLayerPoints; i++)
-      {
-      warpedPoints->GetPoint(i,point);
-      outputPoints->SetPoint(i + numberOfInputPoints + k*numberOfLayerPoints,point);
-      }
+    this->WarpPoints(outputPoints,numberOfInputPoints + k*numberOfLayerPoints,k,warpQuadratic);
    
     vtkIdType prismNPts, *prismPts;
     vtkIdType quadNPts, *quadPts;
@@ -323,13 +315,7 @@ int vtkvmtkBoundaryLayerGenerator::RequestData(
           for (j=0; j<npts; j++)
             {
             vtkIdType jnext = (j+1) % npts;
-            edgePointIds->Initialize();
-            edgePointIds->SetNumberOfIds(2);
-            edgePointIds->SetId(0,pts[j]);
-            edgePointIds->SetId(1,pts[jnext]);
-            input->GetCellNeighbors(i,edgePointIds,edgeNeighborCellIds);
-
-            if (edgeNeighborCellIds->GetNumberOfIds() > 0)
+            if (!(this->BoundaryEdgeMasks[i] & (1 << j)))
               {
               continue;
               }
@@ -385,13 +371,7 @@ int vtkvmtkBoundaryLayerGenerator::RequestData(
           for (int j=0; j<npts/2; j++)
             {
             vtkIdType jnext = (j+1) % npts;
-            edgePointIds->Initialize();
-            edgePointIds->SetNumberOfIds(2);
-            edgePointIds->SetId(0,pts[j]);
-            edgePointIds->SetId(1,pts[jnext]);
-            input->GetCellNeighbors(i,edgePointIds,edgeNeighborCellIds);
-
-            if (edgeNeighborCellIds->GetNumberOfIds() > 0)
+            if (!(this->BoundaryEdgeMasks[i] & (1 << j)))
               {
               continue;
               }
@@ -504,11 +484,15 @@ int vtkvmtkBoundaryLayerGenerator::RequestData(
   innerSurfaceCellEntityIdsArray->FillComponent(0,this->InnerSurfaceCellEntityId);
   this->InnerSurface->GetCellData()->AddArray(innerSurfaceCellEntityIdsArray);
 
-  edgePointIds->Delete();
-  edgeNeighborCellIds->Delete();
-  
+  // the warp vectors array of the input holds the final warp vectors
+  for (i=0; i<numberOfInputPoints; i++)
+    {
+    this->WarpVectorsArray->SetTuple(i,&this->WarpVectors[3*i]);
+    }
+
+  this->ReleaseAdjacency();
+
   outputPoints->Delete();
-  warpedPoints->Delete();
   boundaryLayerCellArray->Delete();
   boundaryLayerCellTypes->Delete();
   innerSurfacePoints->Delete();
@@ -520,6 +504,130 @@ int vtkvmtkBoundaryLayerGenerator::RequestData(
   return 1;
 }
 
+void vtkvmtkBoundaryLayerGenerator::BuildAdjacency(vtkUnstructuredGrid* input)
+{
+  vtkIdType numberOfInputPoints = input->GetNumberOfPoints();
+  vtkIdType numberOfInputCells = input->GetNumberOfCells();
+
+  input->BuildLinks();
+
+  this->BasePoints.resize(3*numberOfInputPoints);
+  vtkIdType i;
+  for (i=0; i<numberOfInputPoints; i++)
+    {
+    input->GetPoint(i,&this->BasePoints[3*i]);
+    }
+
+  vtkIdList* cellIds = vtkIdList::New();
+  vtkIdList* neighborIds = vtkIdList::New();
+  vtkIdList* edgePointIds = vtkIdList::New();
+  vtkIdList* edgeNeighborCellIds = vtkIdList::New();
+  vtkIdType npts, *pts;
+
+  // point to cell and point to neighbor point adjacency; neighbors are
+  // collected from the first three points of the cells sharing a point and
+  // points on the boundary of the surface are flagged, as they are not
+  // relaxed during warping
+  this->PointCellOffsets.assign(1,0);
+  this->PointCellIds.clear();
+  this->PointNeighborOffsets.assign(1,0);
+  this->PointNeighborIds.clear();
+  this->PointOnEdge.assign(numberOfInputPoints,0);
+  for (i=0; i<numberOfInputPoints; i++)
+    {
+    input->GetPointCells(i,cellIds);
+    neighborIds->Initialize();
+    vtkIdType numberOfNeighborCells = cellIds->GetNumberOfIds();
+    vtkIdType k;
+    for (k=0; k<numberOfNeighborCells; k++)
+      {
+      this->PointCellIds.push_back(cellIds->GetId(k));
+      input->GetCellPoints(cellIds->GetId(k),npts,pts);
+      neighborIds->InsertUniqueId(pts[0]);
+      neighborIds->InsertUniqueId(pts[1]);
+      neighborIds->InsertUniqueId(pts[2]);
+      }
+    neighborIds->DeleteId(i);
+    this->PointCellOffsets.push_back(static_cast<vtkIdType>(this->PointCellIds.size()));
+
+    vtkIdType numberOfNeighbors = neighborIds->GetNumberOfIds();
+    edgePointIds->Initialize();
+    edgePointIds->InsertId(0,i);
+    for (k=0; k<numberOfNeighbors; k++)
+      {
+      this->PointNeighborIds.push_back(neighborIds->GetId(k));
+      if (!this->PointOnEdge[i])
+        {
+        edgePointIds->InsertId(1,neighborIds->GetId(k));
+        input->GetCellNeighbors(-1,edgePointIds,edgeNeighborCellIds);
+        if (edgeNeighborCellIds->GetNumberOfIds() < 2)
+          {
+          this->PointOnEdge[i] = 1;
+          }
+        }
+      }
+    if (numberOfNeighbors == 0)
+      {
+      this->PointOnEdge[i] = 1;
+      }
+    this->PointNeighborOffsets.push_back(static_cast<vtkIdType>(this->PointNeighborIds.size()));
+    }
+
+  // base triangle normals and areas (the input surface does not move), and
+  // for each cell a mask of the edges with no neighbor, which get sidewalls
+  this->BaseNormals.resize(3*numberOfInputCells);
+  this->BaseAreas.resize(numberOfInputCells);
+  this->BoundaryEdgeMasks.assign(numberOfInputCells,0);
+  for (i=0; i<numberOfInputCells; i++)
+    {
+    input->GetCellPoints(i,npts,pts);
+    const double* basePoint1 = &this->BasePoints[3*pts[0]];
+    const double* basePoint2 = &this->BasePoints[3*pts[1]];
+    const double* basePoint3 = &this->BasePoints[3*pts[2]];
+    vtkTriangle::ComputeNormal(const_cast<double*>(basePoint1),const_cast<double*>(basePoint2),const_cast<double*>(basePoint3),&this->BaseNormals[3*i]);
+    this->BaseAreas[i] = vtkTriangle::TriangleArea(const_cast<double*>(basePoint1),const_cast<double*>(basePoint2),const_cast<double*>(basePoint3));
+
+    if (!this->IncludeSidewallCells)
+      {
+      continue;
+      }
+    int numberOfEdges = input->GetCellType(i) == VTK_QUADRATIC_TRIANGLE ? npts/2 : npts;
+    for (int j=0; j<numberOfEdges; j++)
+      {
+      vtkIdType jnext = (j+1) % npts;
+      edgePointIds->Initialize();
+      edgePointIds->SetNumberOfIds(2);
+      edgePointIds->SetId(0,pts[j]);
+      edgePointIds->SetId(1,pts[jnext]);
+      input->GetCellNeighbors(i,edgePointIds,edgeNeighborCellIds);
+      if (edgeNeighborCellIds->GetNumberOfIds() == 0)
+        {
+        this->BoundaryEdgeMasks[i] |= (1 << j);
+        }
+      }
+    }
+
+  cellIds->Delete();
+  neighborIds->Delete();
+  edgePointIds->Delete();
+  edgeNeighborCellIds->Delete();
+}
+
+void vtkvmtkBoundaryLayerGenerator::ReleaseAdjacency()
+{
+  std::vector<double>().swap(this->BasePoints);
+  std::vector<double>().swap(this->WarpVectors);
+  std::vector<vtkIdType>().swap(this->PointCellOffsets);
+  std::vector<vtkIdType>().swap(this->PointCellIds);
+  std::vector<vtkIdType>().swap(this->PointNeighborOffsets);
+  std::vector<vtkIdType>().swap(this->PointNeighborIds);
+  std::vector<char>().swap(this->PointOnEdge);
+  std::vector<double>().swap(this->BaseNormals);
+  std::vector<double>().swap(this->BaseAreas);
+  std::vector<unsigned char>().swap(this->BoundaryEdgeMasks);
+  std::vector<vtkIdType>().swap(this->TangledCellIds);
+}
+
 void vtkvmtkBoundaryLayerGenerator::BuildWarpVectors(vtkUnstructuredGrid* input)
 {
   double warpVector[3];
@@ -527,6 +635,8 @@ void vtkvmtkBoundaryLayerGenerator::BuildWarpVectors(vtkUnstructuredGrid* input)
   
   vtkIdType numberOfInputPoints = input->GetNumberOfPoints();
 
+  this->WarpVectors.resize(3*numberOfInputPoints);
+
   for (vtkIdType i=0; i<numberOfInputPoints; i++)
     {
     this->WarpVectorsArray->GetTuple(i,warpVector);
@@ -555,392 +665,436 @@ void vtkvmtkBoundaryLayerGenerator::BuildWarpVectors(vtkUnstructuredGrid* input)
       layerThickness = this->MaximumLayerThickness;
       } 
     vtkMath::Normalize(warpVector);
-    warpVector[0] = warpVector[0] * layerThickness;
-    warpVector[1] = warpVector[1] * layerThickness;
-    warpVector[2] = warpVector[2] * layerThickness;
-    
-    this->WarpVectorsArray->SetTuple(i,warpVector); 
+    this->WarpVectors[3*i+0] = warpVector[0] * layerThickness;
+    this->WarpVectors[3*i+1] = warpVector[1] * layerThickness;
+    this->WarpVectors[3*i+2] = warpVector[2] * layerThickness;
     } 
 }
 
+// Moves every point by one substep along its warp direction.
+class vtkvmtkBoundaryLayerGeneratorSubstepFunctor
+{
+public:
+  vtkvmtkBoundaryLayerGeneratorSubstepFunctor(const double* basePoints, const double* steps, double* warpedPoints) :
+    BasePoints(basePoints), Steps(steps), WarpedPoints(warpedPoints) {}
+
+  void operator()(vtkIdType begin, vtkIdType end)
+  {
+    for (vtkIdType i=3*begin; i<3*end; i++)
+      {
+      this->WarpedPoints[i] = this->BasePoints[i] + this->Steps[i];
+      }
+  }
+
+private:
+  const double* BasePoints;
+  const double* Steps;
+  double* WarpedPoints;
+};
+
+// Relaxes warped points towards the barycenter of their neighbors. All
+// points are relaxed with respect to the warped points of the same
+// substep, so that points can be processed independently.
+class vtkvmtkBoundaryLayerGeneratorRelaxFunctor
+{
+public:
+  vtkvmtkBoundaryLayerGeneratorRelaxFunctor(const double* warpedPoints, const vtkIdType* neighborOffsets, const vtkIdType* neighborIds, const char* onEdge, double relaxation, double* relaxedPoints) :
+    WarpedPoints(warpedPoints), NeighborOffsets(neighborOffsets), NeighborIds(neighborIds), OnEdge(onEdge), Relaxation(relaxation), RelaxedPoints(relaxedPoints) {}
+
+  void operator()(vtkIdType begin, vtkIdType end)
+  {
+    for (vtkIdType j=begin; j<end; j++)
+      {
+      const double* warpedPoint = this->WarpedPoints + 3*j;
+      double* relaxedPoint = this->RelaxedPoints + 3*j;
+      if (this->OnEdge[j])
+        {
+        relaxedPoint[0] = warpedPoint[0];
+        relaxedPoint[1] = warpedPoint[1];
+        relaxedPoint[2] = warpedPoint[2];
+        continue;
+        }
+      double barycenter[3];
+      barycenter[0] = barycenter[1] = barycenter[2] = 0.0;
+      vtkIdType numberOfNeighbors = this->NeighborOffsets[j+1] - this->NeighborOffsets[j];
+      for (vtkIdType k=this->NeighborOffsets[j]; k<this->NeighborOffsets[j+1]; k++)
+        {
+        const double* neighborPoint = this->WarpedPoints + 3*this->NeighborIds[k];
+        barycenter[0] += neighborPoint[0];
+        barycenter[1] += neighborPoint[1];
+        barycenter[2] += neighborPoint[2];
+        }
+      barycenter[0] /= numberOfNeighbors;
+      barycenter[1] /= numberOfNeighbors;
+      barycenter[2] /= numberOfNeighbors;
+
+      relaxedPoint[0] = warpedPoint[0] + this->Relaxation * (barycenter[0] - warpedPoint[0]);
+      relaxedPoint[1] = warpedPoint[1] + this->Relaxation * (barycenter[1] - warpedPoint[1]);
+      relaxedPoint[2] = warpedPoint[2] + this->Relaxation * (barycenter[2] - warpedPoint[2]);
+      }
+  }
+
+private:
+  const double* WarpedPoints;
+  const vtkIdType* NeighborOffsets;
+  const vtkIdType* NeighborIds;
+  const char* OnEdge;
+  double Relaxation;
+  double* RelaxedPoints;
+};
+
 void vtkvmtkBoundaryLayerGenerator::IncrementalWarpVectors(vtkUnstructuredGrid* input, int numberOfSubsteps, double relaxation)
 {   
-  vtkPoints* inputPoints = input->GetPoints();
-  vtkPoints* warpedPoints = vtkPoints::New();    
-  vtkIdType numberOfInputPoints = inputPoints->GetNumberOfPoints();    
+  vtkIdType numberOfInputPoints = input->GetNumberOfPoints();    
 
-  vtkPoints* basePoints = vtkPoints::New();
-  basePoints->DeepCopy(inputPoints);
+  if (numberOfSubsteps < 1 || numberOfInputPoints == 0)
+    {
+    return;
+    }
 
-  for (int l=0; l<numberOfSubsteps; l++)
+  // the warp vectors do not change during the substeps, so the substep
+  // displacement of each point is computed once
+  std::vector<double> steps(3*numberOfInputPoints);
+  vtkIdType i;
+  for (i=0; i<numberOfInputPoints; i++)
     {
-    this->IncrementalWarpPoints(input, basePoints, warpedPoints, l, numberOfSubsteps, relaxation);
-    basePoints->DeepCopy(warpedPoints);
+    double warpVector[3];
+    warpVector[0] = this->WarpVectors[3*i+0];
+    warpVector[1] = this->WarpVectors[3*i+1];
+    warpVector[2] = this->WarpVectors[3*i+2];
+    double layerThickness = vtkMath::Norm(warpVector); 
+    vtkMath::Normalize(warpVector);
+    layerThickness /= numberOfSubsteps;
+    steps[3*i+0] = warpVector[0] * layerThickness;
+    steps[3*i+1] = warpVector[1] * layerThickness;
+    steps[3*i+2] = warpVector[2] * layerThickness;
     }
 
-  double warpVector[3], basePoint[3], warpedPoint[3];
-  for (vtkIdType j=0; j<numberOfInputPoints; j++)
+  std::vector<double> basePoints(this->BasePoints);
+  std::vector<double> warpedPoints(3*numberOfInputPoints);
+
+  vtkvmtkBoundaryLayerGeneratorSubstepFunctor substepFunctor(&basePoints[0],&steps[0],&warpedPoints[0]);
+  vtkvmtkBoundaryLayerGeneratorRelaxFunctor relaxFunctor(&warpedPoints[0],&this->PointNeighborOffsets[0],this->PointNeighborIds.empty() ? NULL : &this->PointNeighborIds[0],&this->PointOnEdge[0],relaxation,&basePoints[0]);
+
+  for (int l=0; l<numberOfSubsteps; l++)
     {
-    inputPoints->GetPoint(j,basePoint);
-    warpedPoints->GetPoint(j,warpedPoint);
-    this->WarpVectorsArray->GetTuple(j,warpVector);
-    double layerThickness=vtkMath::Norm(warpVector);
-    warpVector[0] = warpedPoint[0] - basePoint[0];
-    warpVector[1] = warpedPoint[1] - basePoint[1];
-    warpVector[2] = warpedPoint[2] - basePoint[2];
-    vtkMath::Normalize(warpVector); 
-    warpVector[0] = warpVector[0] * layerThickness; 
-    warpVector[1] = warpVector[1] * layerThickness; 
-    warpVector[2] = warpVector[2] * layerThickness;  
-    this->WarpVectorsArray->SetTuple(j,warpVector);
+    vtkSMPTools::For(0,numberOfInputPoints,substepFunctor);
+    vtkSMPTools::For(0,numberOfInputPoints,relaxFunctor);
     }
-    
-  warpedPoints->Delete();
-  basePoints->Delete();
-}
 
-int vtkvmtkBoundaryLayerGenerator::CheckTangle(vtkUnstructuredGrid* input, vtkUnsignedCharArray* checkArray)
-{
-  vtkIdList* pointList=vtkIdList::New();
-  
-  double warpVector1[3], warpVector2[3],  warpVector3[3];
-  double basePoint1[3], basePoint2[3], basePoint3[3];
-  double warpedPoint1[3], warpedPoint2[3], warpedPoint3[3];
-  double baseNormal[3], warpedNormal[3];
-  
-  int found = 0;
-  int check = 0;
-  for (vtkIdType j=0; j<input->GetNumberOfCells(); j++)
-    {
-    input->GetCellPoints(j,pointList);
-    //points on base triangle
-    input->GetPoint(pointList->GetId(0),basePoint1);
-    input->GetPoint(pointList->GetId(1),basePoint2);
-    input->GetPoint(pointList->GetId(2),basePoint3);
-    
-    this->WarpVectorsArray->GetTuple(pointList->GetId(0),warpVector1);
-    this->WarpVectorsArray->GetTuple(pointList->GetId(1),warpVector2);
-    this->WarpVectorsArray->GetTuple(pointList->GetId(2),warpVector3);
-                                  
-    //points on extruded triangle
-    warpedPoint1[0] = basePoint1[0] + warpVector1[0];
-    warpedPoint1[1] = basePoint1[1] + warpVector1[1];
-    warpedPoint1[2] = basePoint1[2] + warpVector1[2];
-    warpedPoint2[0] = basePoint2[0] + warpVector2[0];
-    warpedPoint2[1] = basePoint2[1] + warpVector2[1];
-    warpedPoint2[2] = basePoint2[2] + warpVector2[2];           
-    warpedPoint3[0] = basePoint3[0] + warpVector3[0];
-    warpedPoint3[1] = basePoint3[1] + warpVector3[1];
-    warpedPoint3[2] = basePoint3[2] + warpVector3[2];          
-    
-    //normals on base triangle (baseNormal) and normals on extruded triangle (warpedNormal)
-    vtkTriangle::ComputeNormal(basePoint1,basePoint2,basePoint3,baseNormal);
-    vtkTriangle::ComputeNormal(warpedPoint1,warpedPoint2,warpedPoint3,warpedNormal);
-    double prod = vtkMath::Dot(baseNormal,warpedNormal);
-    double baseArea = vtkTriangle::TriangleArea(basePoint1,basePoint2,basePoint3);
-    double warpedArea = vtkTriangle::TriangleArea(warpedPoint1,warpedPoint2,warpedPoint3);
-    double testArea = warpedArea / baseArea;    
-    if (prod < 0 || testArea <= 0.1 )
-      {
-      check = 1;
-      found = found + 1;
-      checkArray->SetValue(j,1); 
-      }
-    else
-      {
-      checkArray->SetValue(j,0);  
-      }
+  for (i=0; i<numberOfInputPoints; i++)
+    {
+    double warpVector[3];
+    double* warp = &this->WarpVectors[3*i];
+    double layerThickness = vtkMath::Norm(warp);
+    warpVector[0] = basePoints[3*i+0] - this->BasePoints[3*i+0];
+    warpVector[1] = basePoints[3*i+1] - this->BasePoints[3*i+1];
+    warpVector[2] = basePoints[3*i+2] - this->BasePoints[3*i+2];
+    vtkMath::Normalize(warpVector); 
+    warp[0] = warpVector[0] * layerThickness; 
+    warp[1] = warpVector[1] * layerThickness; 
+    warp[2] = warpVector[2] * layerThickness;  
     }
-  //std::cout << found <<" tangle triangles found"<<std::endl;
-  
-  pointList->Delete();
-  return check;
 }
 
-void vtkvmtkBoundaryLayerGenerator::LocalUntangle(vtkUnstructuredGrid* input, vtkUnsignedCharArray* checkArray, double alpha)
+// Flags cells whose extruded triangle is flipped or collapsed.
+class vtkvmtkBoundaryLayerGeneratorCheckTangleFunctor
 {
-  vtkIdList* pointList=vtkIdList::New();
-  vtkIdList* pointList2=vtkIdList::New();
-  vtkIdList* cellList=vtkIdList::New();
-  
-  double warpVector1[3], warpVector2[3], warpVector3[3];
-  double w1s[3], w2s[3], w3s[3], n[3]; 
-  double point1[3], point2[3], point3[3];
-  double c1[3], c2[3],  c3[3];
-
-  vtkDoubleArray* correctionArray = vtkDoubleArray::New();
-  correctionArray->SetName("correctionVectors");
-  correctionArray->SetNumberOfComponents(3);
-  correctionArray->SetNumberOfTuples(input->GetNumberOfPoints());
-  correctionArray->FillComponent(0,0.0);
-  correctionArray->FillComponent(1,0.0);
-  correctionArray->FillComponent(2,0.0);
-  input->GetPointData()->AddArray(correctionArray);   
-  
-  for (vtkIdType j=0; j<input->GetNumberOfCells(); j++)
-    {
-    if (checkArray->GetValue(j)==1)
+public:
+  vtkvmtkBoundaryLayerGeneratorCheckTangleFunctor(vtkUnstructuredGrid* input, const double* basePoints, const double* warpVectors, const double* baseNormals, const double* baseAreas, unsigned char* check) :
+    Input(input), BasePoints(basePoints), WarpVectors(warpVectors), BaseNormals(baseNormals), BaseAreas(baseAreas), Check(check) {}
+
+  void operator()(vtkIdType begin, vtkIdType end)
+  {
+    vtkIdType npts, *pts;
+    double warpedPoint[3][3];
+    double warpedNormal[3];
+    for (vtkIdType j=begin; j<end; j++)
       {
-      input->GetCellPoints(j,pointList);
-      this->WarpVectorsArray->GetTuple(pointList->GetId(0),warpVector1);
-      this->WarpVectorsArray->GetTuple(pointList->GetId(1),warpVector2);
-      this->WarpVectorsArray->GetTuple(pointList->GetId(2),warpVector3);
-      //eventually we can do it iteratively (relaxation >1)
-      double relaxation = 1.0;
-      for (int r=0; r<relaxation; r++)
+      this->Input->GetCellPoints(j,npts,pts);
+      for (int k=0; k<3; k++)
         {
-        w1s[0] = w1s[1] = w1s[2] = 0.0;
-        w2s[0] = w2s[1] = w2s[2] = 0.0;
-        w3s[0] = w3s[1] = w3s[2] = 0.0;
-        n[0] = n[1] = n[2] = 0.0;
-        input->GetPointCells(pointList->GetId(0),cellList);
-        for (int i=0; i<cellList->GetNumberOfIds();i++)
-          {
-          input->GetCellPoints(i,pointList2);
-          input->GetPoint(pointList2->GetId(0),point1);
-          input->GetPoint(pointList2->GetId(1),point2);
-          input->GetPoint(pointList2->GetId(2),point3);
-          vtkTriangle::ComputeNormal(point1,point2,point3,n);         
-          w1s[0] += warpVector1[0] - vtkMath::Dot(warpVector1,n) * n[0];
-          w1s[1] += warpVector1[1] - vtkMath::Dot(warpVector1,n) * n[1];
-          w1s[2] += warpVector1[2] - vtkMath::Dot(warpVector1,n) * n[2];
-          }
-        vtkMath::Normalize(w1s);
-        input->GetPointCells(pointList->GetId(1),cellList);
-        for (int i=0; i<cellList->GetNumberOfIds();i++)
-          {                       
-          input->GetCellPoints(i,pointList2);
-          input->GetPoint(pointList2->GetId(0),point1);
-          input->GetPoint(pointList2->GetId(1),point2);
-          input->GetPoint(pointList2->GetId(2),point3);
-          vtkTriangle::ComputeNormal(point1,point2,point3,n); 
-          w2s[0] += warpVector2[0] - vtkMath::Dot(warpVector2,n) * n[0];
-          w2s[1] += warpVector2[1] - vtkMath::Dot(warpVector2,n) * n[1];
-          w2s[2] += warpVector2[2] - vtkMath::Dot(warpVector2,n) * n[2];
-          }
-        vtkMath::Normalize(w2s);
-        input->GetPointCells(pointList->GetId(2),cellList);
-        for (int i=0; i<cellList->GetNumberOfIds();i++)
-          {                       
-          input->GetCellPoints(i,pointList2);
-          input->GetPoint(pointList2->GetId(0),point1);
-          input->GetPoint(pointList2->GetId(1),point2);
-          input->GetPoint(pointList2->GetId(2),point3);
-          vtkTriangle::ComputeNormal(point1,point2,point3,n);
-          w3s[0] += warpVector3[0] - vtkMath::Dot(warpVector3,n) * n[0];
-          w3s[1] += warpVector3[1] - vtkMath::Dot(warpVector3,n) * n[1];
-          w3s[2] += warpVector3[2] - vtkMath::Dot(warpVector3,n) * n[2]; 
-          }
-        vtkMath::Normalize(w3s);
-        correctionArray->GetTuple(pointList->GetId(0),c1);
-        correctionArray->GetTuple(pointList->GetId(1),c2);
-        correctionArray->GetTuple(pointList->GetId(2),c3);
-        c1[0] = c1[0] + alpha * w2s[0] + alpha * w3s[0];
-        c1[1] = c1[1] + alpha * w2s[1] + alpha * w3s[1];
-        c1[2] = c1[2] + alpha * w2s[2] + alpha * w3s[2];
-        c2[0] = c2[0] + alpha * w1s[0] + alpha * w3s[0];
-        c2[1] = c2[1] + alpha * w1s[1] + alpha * w3s[1];
-        c2[2] = c2[2] + alpha * w1s[2] + alpha * w3s[2];
-        c3[0] = c3[0] + alpha * w2s[0] + alpha * w1s[0];
-        c3[1] = c3[1] + alpha * w2s[1] + alpha * w1s[1];
-        c3[2] = c3[2] + alpha * w2s[2] + alpha * w1s[2];
-        correctionArray->SetTuple3(pointList->GetId(0),c1[0],c1[1],c1[2]);
-        correctionArray->SetTuple3(pointList->GetId(1),c2[0],c2[1],c2[2]);
-        correctionArray->SetTuple3(pointList->GetId(2),c3[0],c3[1],c3[2]);                
+        const double* basePoint = this->BasePoints + 3*pts[k];
+        const double* warpVector = this->WarpVectors + 3*pts[k];
+        warpedPoint[k][0] = basePoint[0] + warpVector[0];
+        warpedPoint[k][1] = basePoint[1] + warpVector[1];
+        warpedPoint[k][2] = basePoint[2] + warpVector[2];
         }
-      }         
-    }
+      vtkTriangle::ComputeNormal(warpedPoint[0],warpedPoint[1],warpedPoint[2],warpedNormal);
+      double prod = vtkMath::Dot(this->BaseNormals+3*j,warpedNormal);
+      double warpedArea = vtkTriangle::TriangleArea(warpedPoint[0],warpedPoint[1],warpedPoint[2]);
+      double testArea = warpedArea / this->BaseAreas[j];
+      this->Check[j] = (prod < 0 || testArea <= 0.1) ? 1 : 0;
+      }
+  }
 
-  double warp[3], correction[3];  
-  for (vtkIdType i=0; i<input->GetNumberOfPoints();i++)
-    {
-    this->WarpVectorsArray->GetTuple(i,warp);
-    double layerThickness=vtkMath::Norm(warp);
-    correctionArray->GetTuple(i,correction);
-    warp[0] = warp[0] + correction[0];
-    warp[1] = warp[1] + correction[1];
-    warp[2] = warp[2] + correction[2];       
-    vtkMath::Normalize(warp);
-    warp[0] = warp[0] * layerThickness;
-    warp[1] = warp[1] * layerThickness;
-    warp[2] = warp[2] * layerThickness;
-    this->WarpVectorsArray->SetTuple(i,warp); 
-    }
-  
-  correctionArray->Delete();
-  pointList->Delete();
-  pointList2->Delete();
-  cellList->Delete();  
-}
+private:
+  vtkUnstructuredGrid* Input;
+  const double* BasePoints;
+  const double* WarpVectors;
+  const double* BaseNormals;
+  const double* BaseAreas;
+  unsigned char* Check;
+};
 
-void vtkvmtkBoundaryLayerGenerator::WarpPoints(vtkPoints* inputPoints, vtkPoints* warpedPoints, int subLayerId, bool quadratic)
+int vtkvmtkBoundaryLayerGenerator::CheckTangle(vtkUnstructuredGrid* input, vtkUnsignedCharArray* checkArray)
 {
-  double point[3], warpedPoint[3], warpVector[3];
-  double layerThickness, subLayerThicknessRatio, subLayerThickness;
-  double totalLayerZeroSubLayerRatio, subLayerOffsetRatio, subLayerOffset;
-
-  vtkIdType numberOfInputPoints = inputPoints->GetNumberOfPoints();
-
-  totalLayerZeroSubLayerRatio = 0.0;
-  int i;
-  for (i=0; i<this->NumberOfSubLayers; i++)
-    {
-    totalLayerZeroSubLayerRatio += pow(this->SubLayerRatio,this->NumberOfSubLayers-i-1);
-    }
+  vtkIdType numberOfInputCells = input->GetNumberOfCells();
+  unsigned char* check = checkArray->GetPointer(0);
 
-  subLayerOffsetRatio = 0.0;
-  for (i=0; i<subLayerId; i++)
+  this->TangledCellIds.clear();
+  if (numberOfInputCells == 0)
     {
-    subLayerOffsetRatio += pow(this->SubLayerRatio,this->NumberOfSubLayers-i-1);
+    return 0;
     }
-  subLayerOffsetRatio /= totalLayerZeroSubLayerRatio;
 
-  subLayerThicknessRatio = pow(this->SubLayerRatio,this->NumberOfSubLayers-subLayerId-1) / totalLayerZeroSubLayerRatio;
+  vtkvmtkBoundaryLayerGeneratorCheckTangleFunctor checkFunctor(input,&this->BasePoints[0],&this->WarpVectors[0],&this->BaseNormals[0],&this->BaseAreas[0],check);
+  vtkSMPTools::For(0,numberOfInputCells,checkFunctor);
 
-  if (!quadratic)
-    {
-    warpedPoints->SetNumberOfPoints(numberOfInputPoints);
-    }
-  else
+  // keep the tangled cells, the only ones LocalUntangle looks at
+  for (vtkIdType j=0; j<numberOfInputCells; j++)
     {
-    warpedPoints->SetNumberOfPoints(2*numberOfInputPoints);
+    if (check[j])
+      {
+      this->TangledCellIds.push_back(j);
+      }
     }
 
-  for (i=0; i<numberOfInputPoints; i++)
-    {
-    inputPoints->GetPoint(i,point);
-    this->WarpVectorsArray->GetTuple(i,warpVector);
-
-    layerThickness = vtkMath::Norm(warpVector);
-
-    vtkMath::Normalize(warpVector);
+  return this->TangledCellIds.empty() ? 0 : 1;
+}
 
-    subLayerOffset = subLayerOffsetRatio * layerThickness;
-    subLayerThickness = subLayerThicknessRatio * layerThickness;
+// Direction of the warp vector of a point projected on the tangent planes
+// of the cells sharing it.
+class vtkvmtkBoundaryLayerGeneratorTangentDirectionFunctor
+{
+public:
+  vtkvmtkBoundaryLayerGeneratorTangentDirectionFunctor(const vtkIdType* pointIds, const double* warpVectors, const vtkIdType* cellOffsets, const vtkIdType* cellIds, const double* baseNormals, double* tangentDirections) :
+    PointIds(pointIds), WarpVectors(warpVectors), CellOffsets(cellOffsets), CellIds(cellIds), BaseNormals(baseNormals), TangentDirections(tangentDirections) {}
 
-    if (quadratic)
+  void operator()(vtkIdType begin, vtkIdType end)
+  {
+    for (vtkIdType i=begin; i<end; i++)
       {
-      warpedPoint[0] = point[0] + 0.5 * warpVector[0] * (subLayerOffset + subLayerThickness);
-      warpedPoint[1] = point[1] + 0.5 * warpVector[1] * (subLayerOffset + subLayerThickness);
-      warpedPoint[2] = point[2] + 0.5 * warpVector[2] * (subLayerOffset + subLayerThickness);
-      warpedPoints->SetPoint(i,warpedPoint);
-      warpedPoint[0] = point[0] + warpVector[0] * (subLayerOffset + subLayerThickness);
-      warpedPoint[1] = point[1] + warpVector[1] * (subLayerOffset + subLayerThickness);
-      warpedPoint[2] = point[2] + warpVector[2] * (subLayerOffset + subLayerThickness);
-      warpedPoints->SetPoint(i+numberOfInputPoints,warpedPoint);
+      vtkIdType pointId = this->PointIds[i];
+      const double* warpVector = this->WarpVectors + 3*pointId;
+      double* ws = this->TangentDirections + 3*pointId;
+      ws[0] = ws[1] = ws[2] = 0.0;
+      for (vtkIdType k=this->CellOffsets[pointId]; k<this->CellOffsets[pointId+1]; k++)
+        {
+        const double* n = this->BaseNormals + 3*this->CellIds[k];
+        double dot = vtkMath::Dot(warpVector,n);
+        ws[0] += warpVector[0] - dot * n[0];
+        ws[1] += warpVector[1] - dot * n[1];
+        ws[2] += warpVector[2] - dot * n[2];
+        }
+      vtkMath::Normalize(ws);
       }
-    else
+  }
+
+private:
+  const vtkIdType* PointIds;
+  const double* WarpVectors;
+  const vtkIdType* CellOffsets;
+  const vtkIdType* CellIds;
+  const double* BaseNormals;
+  double* TangentDirections;
+};
+
+// Pushes the points of tangled cells along the tangent directions of the
+// other points of the cell, keeping the length of the warp vectors.
+class vtkvmtkBoundaryLayerGeneratorCorrectionFunctor
+{
+public:
+  vtkvmtkBoundaryLayerGeneratorCorrectionFunctor(vtkUnstructuredGrid* input, const unsigned char* check, const vtkIdType* cellOffsets, const vtkIdType* cellIds, const double* tangentDirections, double alpha, double* warpVectors) :
+    Input(input), Check(check), CellOffsets(cellOffsets), CellIds(cellIds), TangentDirections(tangentDirections), Alpha(alpha), WarpVectors(warpVectors) {}
+
+  void operator()(vtkIdType begin, vtkIdType end)
+  {
+    vtkIdType npts, *pts;
+    for (vtkIdType i=begin; i<end; i++)
       {
-      warpedPoint[0] = point[0] + warpVector[0] * (subLayerOffset + subLayerThickness);
-      warpedPoint[1] = point[1] + warpVector[1] * (subLayerOffset + subLayerThickness);
-      warpedPoint[2] = point[2] + warpVector[2] * (subLayerOffset + subLayerThickness);
-      warpedPoints->SetPoint(i,warpedPoint);
+      double correction[3];
+      correction[0] = correction[1] = correction[2] = 0.0;
+      for (vtkIdType k=this->CellOffsets[i]; k<this->CellOffsets[i+1]; k++)
+        {
+        vtkIdType cellId = this->CellIds[k];
+        if (!this->Check[cellId])
+          {
+          continue;
+          }
+        this->Input->GetCellPoints(cellId,npts,pts);
+        // the other two points of the triangle, in the order used for
+        // accumulating the correction of each corner
+        vtkIdType other1, other2;
+        if (pts[0] == i)
+          {
+          other1 = pts[1];
+          other2 = pts[2];
+          }
+        else if (pts[1] == i)
+          {
+          other1 = pts[0];
+          other2 = pts[2];
+          }
+        else if (pts[2] == i)
+          {
+          other1 = pts[1];
+          other2 = pts[0];
+          }
+        else
+          {
+          continue;
+          }
+        const double* ws1 = this->TangentDirections + 3*other1;
+        const double* ws2 = this->TangentDirections + 3*other2;
+        correction[0] = correction[0] + this->Alpha * ws1[0] + this->Alpha * ws2[0];
+        correction[1] = correction[1] + this->Alpha * ws1[1] + this->Alpha * ws2[1];
+        correction[2] = correction[2] + this->Alpha * ws1[2] + this->Alpha * ws2[2];
+        }
+
+      double* warp = this->WarpVectors + 3*i;
+      double layerThickness = vtkMath::Norm(warp);
+      warp[0] = warp[0] + correction[0];
+      warp[1] = warp[1] + correction[1];
+      warp[2] = warp[2] + correction[2];
+      vtkMath::Normalize(warp);
+      warp[0] = warp[0] * layerThickness;
+      warp[1] = warp[1] * layerThickness;
+      warp[2] = warp[2] * layerThickness;
       }
-    }
-}
+  }
+
+private:
+  vtkUnstructuredGrid* Input;
+  const unsigned char* Check;
+  const vtkIdType* CellOffsets;
+  const vtkIdType* CellIds;
+  const double* TangentDirections;
+  double Alpha;
+  double* WarpVectors;
+};
 
-void vtkvmtkBoundaryLayerGenerator::IncrementalWarpPoints(vtkUnstructuredGrid* input, vtkPoints* basePoints, vtkPoints* warpedPoints, int substep, int numberOfSubsteps, double relaxation)
+void vtkvmtkBoundaryLayerGenerator::LocalUntangle(vtkUnstructuredGrid* input, vtkUnsignedCharArray* checkArray, double alpha)
 {
-  double point[3], warpedPoint[3], warpVector[3];
-  double layerThickness;
-
-  vtkIdType numberOfInputPoints = basePoints->GetNumberOfPoints();
-
-  warpedPoints->SetNumberOfPoints(numberOfInputPoints);
+  vtkIdType numberOfInputPoints = input->GetNumberOfPoints();
 
-  for (vtkIdType i=0; i<numberOfInputPoints; i++)
+  // points of the tangled cells found by the last CheckTangle
+  std::vector<char> isTangledPoint(numberOfInputPoints,0);
+  std::vector<vtkIdType> tangledPointIds;
+  vtkIdType npts, *pts;
+  size_t i;
+  for (i=0; i<this->TangledCellIds.size(); i++)
     {
-    basePoints->GetPoint(i,point);
-    this->WarpVectorsArray->GetTuple(i,warpVector);
-    
-    layerThickness = vtkMath::Norm(warpVector); 
-    vtkMath::Normalize(warpVector);
-    
-    layerThickness /= numberOfSubsteps;
-
-    warpedPoint[0] = point[0] + warpVector[0] * layerThickness;
-    warpedPoint[1] = point[1] + warpVector[1] * layerThickness;
-    warpedPoint[2] = point[2] + warpVector[2] * layerThickness;
-    warpedPoints->SetPoint(i,warpedPoint);
+    input->GetCellPoints(this->TangledCellIds[i],npts,pts);
+    for (int k=0; k<3; k++)
+      {
+      if (!isTangledPoint[pts[k]])
+        {
+        isTangledPoint[pts[k]] = 1;
+        tangledPointIds.push_back(pts[k]);
+        }
+      }
     }
 
-  vtkIdType npts, *pts;
-  vtkIdList* cellIds = vtkIdList::New();
-  vtkIdType cellId;
-
-  vtkIdList* neighborIds = vtkIdList::New();
-  vtkIdList* edgePointIds = vtkIdList::New();
-  vtkIdList* edgeNeighborCellIds = vtkIdList::New();
-
-  for (vtkIdType j=0; j<numberOfInputPoints; j++)
+  if (tangledPointIds.empty())
     {
-    input->GetPointCells(j,cellIds);
+    return;
+    }
 
-    neighborIds->Initialize();
+  std::vector<double> tangentDirections(3*numberOfInputPoints,0.0);
+  vtkvmtkBoundaryLayerGeneratorTangentDirectionFunctor tangentFunctor(&tangledPointIds[0],&this->WarpVectors[0],&this->PointCellOffsets[0],&this->PointCellIds[0],&this->BaseNormals[0],&tangentDirections[0]);
+  vtkSMPTools::For(0,static_cast<vtkIdType>(tangledPointIds.size()),tangentFunctor);
 
-    vtkIdType numberOfNeighborCells = cellIds->GetNumberOfIds();
-    for (int k=0; k<numberOfNeighborCells; k++)
+  vtkvmtkBoundaryLayerGeneratorCorrectionFunctor correctionFunctor(input,checkArray->GetPointer(0),&this->PointCellOffsets[0],&this->PointCellIds[0],&tangentDirections[0],alpha,&this->WarpVectors[0]);
+  vtkSMPTools::For(0,numberOfInputPoints,correctionFunctor);
+}
+
+// Computes the points of a sublayer, writing them into the output points.
+class vtkvmtkBoundaryLayerGeneratorWarpFunctor
+{
+public:
+  vtkvmtkBoundaryLayerGeneratorWarpFunctor(const double* basePoints, const double* warpVectors, vtkIdType numberOfInputPoints, double subLayerOffsetRatio, double subLayerThicknessRatio, bool quadratic, vtkPoints* outputPoints, vtkIdType offset) :
+    BasePoints(basePoints), WarpVectors(warpVectors), NumberOfInputPoints(numberOfInputPoints), SubLayerOffsetRatio(subLayerOffsetRatio), SubLayerThicknessRatio(subLayerThicknessRatio), Quadratic(quadratic), OutputPoints(outputPoints), Offset(offset) {}
+
+  void operator()(vtkIdType begin, vtkIdType end)
+  {
+    double warpedPoint[3], warpVector[3];
+    for (vtkIdType i=begin; i<end; i++)
       {
-      cellId = cellIds->GetId(k);
-      input->GetCellPoints(cellId,npts,pts);
+      const double* point = this->BasePoints + 3*i;
+      warpVector[0] = this->WarpVectors[3*i+0];
+      warpVector[1] = this->WarpVectors[3*i+1];
+      warpVector[2] = this->WarpVectors[3*i+2];
 
-      neighborIds->InsertUniqueId(pts[0]);
-      neighborIds->InsertUniqueId(pts[1]);
-      neighborIds->InsertUniqueId(pts[2]);
-      }
-    neighborIds->DeleteId(j);
+      double layerThickness = vtkMath::Norm(warpVector);
 
-    int numberOfNeighbors = neighborIds->GetNumberOfIds();
+      vtkMath::Normalize(warpVector);
 
-    bool onEdge = false;
-    edgePointIds->Initialize();
-    edgeNeighborCellIds->Initialize();
-    edgePointIds->InsertId(0,j);
-    for (int k=0; k<numberOfNeighbors; k++)
-      {
-      edgePointIds->InsertId(1,neighborIds->GetId(k));
-      input->GetCellNeighbors(-1,edgePointIds,edgeNeighborCellIds);
-      if (edgeNeighborCellIds->GetNumberOfIds() < 2)
+      double subLayerOffset = this->SubLayerOffsetRatio * layerThickness;
+      double subLayerThickness = this->SubLayerThicknessRatio * layerThickness;
+
+      if (this->Quadratic)
         {
-        onEdge = true;
-        break;
+        warpedPoint[0] = point[0] + 0.5 * warpVector[0] * (subLayerOffset + subLayerThickness);
+        warpedPoint[1] = point[1] + 0.5 * warpVector[1] * (subLayerOffset + subLayerThickness);
+        warpedPoint[2] = point[2] + 0.5 * warpVector[2] * (subLayerOffset + subLayerThickness);
+        this->OutputPoints->SetPoint(this->Offset+i,warpedPoint);
+        warpedPoint[0] = point[0] + warpVector[0] * (subLayerOffset + subLayerThickness);
+        warpedPoint[1] = point[1] + warpVector[1] * (subLayerOffset + subLayerThickness);
+        warpedPoint[2] = point[2] + warpVector[2] * (subLayerOffset + subLayerThickness);
+        this->OutputPoints->SetPoint(this->Offset+i+this->NumberOfInputPoints,warpedPoint);
+        }
+      else
+        {
+        warpedPoint[0] = point[0] + warpVector[0] * (subLayerOffset + subLayerThickness);
+        warpedPoint[1] = point[1] + warpVector[1] * (subLayerOffset + subLayerThickness);
+        warpedPoint[2] = point[2] + warpVector[2] * (subLayerOffset + subLayerThickness);
+        this->OutputPoints->SetPoint(this->Offset+i,warpedPoint);
         }
       }
+  }
+
+private:
+  const double* BasePoints;
+  const double* WarpVectors;
+  vtkIdType NumberOfInputPoints;
+  double SubLayerOffsetRatio;
+  double SubLayerThicknessRatio;
+  bool Quadratic;
+  vtkPoints* OutputPoints;
+  vtkIdType Offset;
+};
+
+void vtkvmtkBoundaryLayerGenerator::WarpPoints(vtkPoints* outputPoints, vtkIdType offset, int subLayerId, bool quadratic)
+{
+  double subLayerThicknessRatio;
+  double totalLayerZeroSubLayerRatio, subLayerOffsetRatio;
 
-    if (onEdge)
-      {
-      continue;
-      }
-
-    double barycenter[3];
-    barycenter[0] = barycenter[1] = barycenter[2] = 0.0;
-    double neighborPoint[3];
-    for (int k=0; k<numberOfNeighbors; k++)
-      {
-      warpedPoints->GetPoint(neighborIds->GetId(k),neighborPoint);
-      barycenter[0] += neighborPoint[0];
-      barycenter[1] += neighborPoint[1];
-      barycenter[2] += neighborPoint[2];
-      }
-    barycenter[0] /= numberOfNeighbors;
-    barycenter[1] /= numberOfNeighbors;
-    barycenter[2] /= numberOfNeighbors;
+  vtkIdType numberOfInputPoints = static_cast<vtkIdType>(this->BasePoints.size() / 3);
 
-    warpedPoints->GetPoint(j,warpedPoint);
+  totalLayerZeroSubLayerRatio = 0.0;
+  int i;
+  for (i=0; i<this->NumberOfSubLayers; i++)
+    {
+    totalLayerZeroSubLayerRatio += pow(this->SubLayerRatio,this->NumberOfSubLayers-i-1);
+    }
 
-    // TODO: find out if the current surface is intersecting the original 
-    // input surface (not the input surface at this iteration) and in that 
-    // case (before it gets too close) stop the warp
+  subLayerOffsetRatio = 0.0;
+  for (i=0; i<subLayerId; i++)
+    {
+    subLayerOffsetRatio += pow(this->SubLayerRatio,this->NumberOfSubLayers-i-1);
+    }
+  subLayerOffsetRatio /= totalLayerZeroSubLayerRatio;
 
-    warpedPoint[0] += relaxation * (barycenter[0] - warpedPoint[0]);
-    warpedPoint[1] += relaxation * (barycenter[1] - warpedPoint[1]);
-    warpedPoint[2] += relaxation * (barycenter[2] - warpedPoint[2]);
+  subLayerThicknessRatio = pow(this->SubLayerRatio,this->NumberOfSubLayers-subLayerId-1) / totalLayerZeroSubLayerRatio;
 
-    warpedPoints->SetPoint(j,warpedPoint);
+  if (numberOfInputPoints == 0)
+    {
+    return;
     }
 
-  cellIds->Delete();
-  neighborIds->Delete();
+  vtkvmtkBoundaryLayerGeneratorWarpFunctor warpFunctor(&this->BasePoints[0],&this->WarpVectors[0],numberOfInputPoints,subLayerOffsetRatio,subLayerThicknessRatio,quadratic,outputPoints,offset);
+  vtkSMPTools::For(0,numberOfInputPoints,warpFunctor);
 }
 
 void vtkvmtkBoundaryLayerGenerator::PrintSelf(ostream& os, vtkIndent indent)
@@ -28,6 +28,8 @@ Version:   $Revision: 1.4 $
 #include "vtkUnstructuredGridAlgorithm.h"
 #include "vtkvmtkWin32Header.h"
 
+#include <vector>
+
 class vtkPoints;
 class vtkUnsignedCharArray;
 class vtkDataArray;
@@ -113,12 +115,18 @@ class VTK_VMTK_MISC_EXPORT vtkvmtkBoundaryLayerGenerator : public vtkUnstructure
 
   virtual int RequestData(vtkInformation *, vtkInformationVector **, vtkInformationVector *) VTK_OVERRIDE;
 
+  // Description:
+  // Precomputes the topology used by all warping substeps: point to cell
+  // and point to neighbor adjacency, surface boundary points, base triangle
+  // normals and areas, and the edges of each cell which need sidewalls.
+  void BuildAdjacency(vtkUnstructuredGrid* input);
+  void ReleaseAdjacency();
+
   void BuildWarpVectors(vtkUnstructuredGrid* input);
-  void IncrementalWarpPoints(vtkUnstructuredGrid* input, vtkPoints* basePoints, vtkPoints* warpedPoints, int substep, int numberOfSubsteps, double relaxation);
   void IncrementalWarpVectors(vtkUnstructuredGrid* input, int numberOfSubsteps, double relaxation);
   int CheckTangle(vtkUnstructuredGrid* input, vtkUnsignedCharArray* checkArray);
   void LocalUntangle(vtkUnstructuredGrid* input, vtkUnsignedCharArray* checkArray, double alpha); 
-  void WarpPoints(vtkPoints* inputPoints, vtkPoints* warpedPoints, int subLayerId, bool quadratic);
+  void WarpPoints(vtkPoints* outputPoints, vtkIdType offset, int subLayerId, bool quadratic);
   void UnwrapSublayers(vtkUnstructuredGrid* input, vtkPoints* outputPoints);
 
   vtkDataArray* WarpVectorsArray;
@@ -153,6 +161,18 @@ class VTK_VMTK_MISC_EXPORT vtkvmtkBoundaryLayerGenerator : public vtkUnstructure
   double Relaxation;
   double LocalCorrectionFactor;
 
+  std::vector<double> BasePoints;
+  std::vector<double> WarpVectors;
+  std::vector<vtkIdType> PointCellOffsets;
+  std::vector<vtkIdType> PointCellIds;
+  std::vector<vtkIdType> PointNeighborOffsets;
+  std::vector<vtkIdType> PointNeighborIds;
+  std::vector<char> PointOnEdge;
+  std::vector<double> BaseNormals;
+  std::vector<double> BaseAreas;
+  std::vector<unsigned char> BoundaryEdgeMasks;
+  std::vector<vtkIdType> TangledCellIds;
+
   private:
   vtkvmtkBoundaryLayerGenerator(const vtkvmtkBoundaryLayerGenerator&);  // Not implemented.
   void operator=(const vtkvmtkBoundaryLayerGenerator&);  // Not implemented.
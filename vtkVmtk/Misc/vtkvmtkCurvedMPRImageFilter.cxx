@@ -1,6 +1,10 @@
 #include "vtkvmtkCurvedMPRImageFilter.h"
 #include "vtkObjectFactory.h"
 #include "vtkVersion.h"
+#include "vtkSMPTools.h"
+
+#include <vector>
+#include <limits>
 
 //------------------------------------------------------------------------------
 
@@ -15,6 +19,7 @@ vtkvmtkCurvedMPRImageFilter::vtkvmtkCurvedMPRImageFilter()
   this->InplaneOutputSize[0] = 100;
   this->InplaneOutputSize[1] = 100;
   this->ReslicingBackgroundLevel = 0.0;
+  this->InterpolationMode = VTK_RESLICE_CUBIC;
 
   for (int i = 0;i<6;i++)
     {
@@ -55,6 +60,20 @@ vtkvmtkCurvedMPRImageFilter::~vtkvmtkCurvedMPRImageFilter()
     }
 }
 
+void vtkvmtkCurvedMPRImageFilter::SetInterpolationMode(int mode)
+{
+  // only linear and cubic sampling are implemented
+  if (mode != VTK_RESLICE_CUBIC)
+    {
+    mode = VTK_RESLICE_LINEAR;
+    }
+  if (this->InterpolationMode != mode)
+    {
+    this->InterpolationMode = mode;
+    this->Modified();
+    }
+}
+
 //This is called by the superclass
 //----------------------------------------------------------------------------
 int vtkvmtkCurvedMPRImageFilter::RequestUpdateExtent (
@@ -196,16 +215,160 @@ int vtkvmtkCurvedMPRImageFilter::RequestInformation (
 }
 
 template <class T>
-void vtkvmtkCurvedMPRImageFilter::FillSlice(T* outReslicePtr, T* outputImagePtr, int* resliceUpdateExtent, int* outExtent, vtkIdType* outputInc, int slice)
+inline void vtkvmtkCurvedMPRImageFilterCastValue(double value, T& result)
 {
-  //write result to the new dataset
-  int size = (outExtent[1]-outExtent[0]+1)*(outExtent[3]-outExtent[2]+1);
-  for(int i=0; i<size; i++)
+  // round and clamp to the range of integer types, as vtkImageReslice
+  if (std::numeric_limits<T>::is_integer)
+    {
+    if (value < static_cast<double>(std::numeric_limits<T>::min()))
+      {
+      value = static_cast<double>(std::numeric_limits<T>::min());
+      }
+    else if (value > static_cast<double>(std::numeric_limits<T>::max()))
+      {
+      value = static_cast<double>(std::numeric_limits<T>::max());
+      }
+    result = static_cast<T>(floor(value + 0.5));
+    }
+  else
     {
-    outputImagePtr[i + (slice-outExtent[4]) * outputInc[2]] = outReslicePtr[i];
+    result = static_cast<T>(value);
     }
 }
 
+// Samples one output slice per centerline point. Each slice is the plane
+// through the point spanned by the normal and the binormal of its frame.
+template <class T>
+class vtkvmtkCurvedMPRImageFilterResliceFunctor
+{
+public:
+  vtkvmtkCurvedMPRImageFilterResliceFunctor(const T* inPtr, const int* inExtent, const vtkIdType* inInc, const double* inOrigin, const double* inSpacing, int numberOfComponents, T* outPtr, const int* outExtent, const vtkIdType* outInc, const double* outOrigin, const double* outSpacing, const double* frames, int cubic, double background) :
+    InPtr(inPtr), InExtent(inExtent), InInc(inInc), InOrigin(inOrigin), InSpacing(inSpacing), NumberOfComponents(numberOfComponents), OutPtr(outPtr), OutExtent(outExtent), OutInc(outInc), OutOrigin(outOrigin), OutSpacing(outSpacing), Frames(frames), Cubic(cubic), Background(background) {}
+
+  void operator()(vtkIdType begin, vtkIdType end)
+  {
+    int numberOfWeights = this->Cubic ? 4 : 2;
+    vtkIdType offsets[3][4];
+    double weights[3][4];
+    std::vector<double> value(this->NumberOfComponents);
+    T background;
+    vtkvmtkCurvedMPRImageFilterCastValue(this->Background,background);
+
+    for (vtkIdType slice=begin; slice<end; slice++)
+      {
+      const double* frame = this->Frames + 9*(slice-this->OutExtent[4]);
+      T* outSlicePtr = this->OutPtr + (slice-this->OutExtent[4]) * this->OutInc[2];
+      for (int j=this->OutExtent[2]; j<=this->OutExtent[3]; j++)
+        {
+        double y = this->OutOrigin[1] + j * this->OutSpacing[1];
+        T* outRowPtr = outSlicePtr + (j-this->OutExtent[2]) * this->OutInc[1];
+        for (int i=this->OutExtent[0]; i<=this->OutExtent[1]; i++)
+          {
+          double x = this->OutOrigin[0] + i * this->OutSpacing[0];
+          T* outPixelPtr = outRowPtr + (i-this->OutExtent[0]) * this->OutInc[0];
+
+          // continuous index of the sample in the input, points within half
+          // a voxel of the boundary are inside (as vtkImageReslice border)
+          bool inside = true;
+          int k, c;
+          for (k=0; k<3 && inside; k++)
+            {
+            double point = frame[k] + x * frame[3+k] + y * frame[6+k];
+            double index = (point - this->InOrigin[k]) / this->InSpacing[k];
+            if (index < this->InExtent[2*k] - 0.5 || index > this->InExtent[2*k+1] + 0.5)
+              {
+              inside = false;
+              break;
+              }
+            int baseIndex = static_cast<int>(floor(index));
+            double f = index - baseIndex;
+            if (this->Cubic)
+              {
+              double f2 = f * f;
+              double f3 = f2 * f;
+              weights[k][0] = -0.5 * f3 + f2 - 0.5 * f;
+              weights[k][1] = 1.5 * f3 - 2.5 * f2 + 1.0;
+              weights[k][2] = -1.5 * f3 + 2.0 * f2 + 0.5 * f;
+              weights[k][3] = 0.5 * f3 - 0.5 * f2;
+              baseIndex -= 1;
+              }
+            else
+              {
+              weights[k][0] = 1.0 - f;
+              weights[k][1] = f;
+              }
+            for (int n=0; n<numberOfWeights; n++)
+              {
+              int neighborIndex = baseIndex + n;
+              neighborIndex = neighborIndex < this->InExtent[2*k] ? this->InExtent[2*k] : neighborIndex;
+              neighborIndex = neighborIndex > this->InExtent[2*k+1] ? this->InExtent[2*k+1] : neighborIndex;
+              offsets[k][n] = (neighborIndex - this->InExtent[2*k]) * this->InInc[k];
+              }
+            }
+
+          if (!inside)
+            {
+            for (c=0; c<this->NumberOfComponents; c++)
+              {
+              outPixelPtr[c] = background;
+              }
+            continue;
+            }
+
+          for (c=0; c<this->NumberOfComponents; c++)
+            {
+            value[c] = 0.0;
+            }
+          for (int nz=0; nz<numberOfWeights; nz++)
+            {
+            for (int ny=0; ny<numberOfWeights; ny++)
+              {
+              double wyz = weights[2][nz] * weights[1][ny];
+              const T* inRowPtr = this->InPtr + offsets[2][nz] + offsets[1][ny];
+              for (int nx=0; nx<numberOfWeights; nx++)
+                {
+                double w = wyz * weights[0][nx];
+                const T* inPixelPtr = inRowPtr + offsets[0][nx];
+                for (c=0; c<this->NumberOfComponents; c++)
+                  {
+                  value[c] += w * static_cast<double>(inPixelPtr[c]);
+                  }
+                }
+              }
+            }
+          for (c=0; c<this->NumberOfComponents; c++)
+            {
+            vtkvmtkCurvedMPRImageFilterCastValue(value[c],outPixelPtr[c]);
+            }
+          }
+        }
+      }
+  }
+
+private:
+  const T* InPtr;
+  const int* InExtent;
+  const vtkIdType* InInc;
+  const double* InOrigin;
+  const double* InSpacing;
+  int NumberOfComponents;
+  T* OutPtr;
+  const int* OutExtent;
+  const vtkIdType* OutInc;
+  const double* OutOrigin;
+  const double* OutSpacing;
+  const double* Frames;
+  int Cubic;
+  double Background;
+};
+
+template <class T>
+void vtkvmtkCurvedMPRImageFilterReslice(const T* inPtr, const int* inExtent, const vtkIdType* inInc, const double* inOrigin, const double* inSpacing, int numberOfComponents, T* outPtr, const int* outExtent, const vtkIdType* outInc, const double* outOrigin, const double* outSpacing, const double* frames, int cubic, double background)
+{
+  vtkvmtkCurvedMPRImageFilterResliceFunctor<T> functor(inPtr,inExtent,inInc,inOrigin,inSpacing,numberOfComponents,outPtr,outExtent,outInc,outOrigin,outSpacing,frames,cubic,background);
+  vtkSMPTools::For(outExtent[4],outExtent[5]+1,functor);
+}
+
 //----------------------------------------------------------------------------
 int vtkvmtkCurvedMPRImageFilter::RequestData(
   vtkInformation* vtkNotUsed( request ),
@@ -325,20 +488,11 @@ int vtkvmtkCurvedMPRImageFilter::RequestData(
 #if (VTK_MAJOR_VERSION <= 5)
   outputImage->SetWholeExtent(outExtent);
   outputImage->SetUpdateExtent(outExtent);
+  outputImage->SetScalarType(inputImage->GetScalarType());
+  outputImage->SetNumberOfScalarComponents(inputImage->GetNumberOfScalarComponents());
   outputImage->AllocateScalars();
-#elif (VTK_MAJOR_VERSION < 7)
-  this->UpdateInformation();
-  vtkStreamingDemandDrivenPipeline::SetUpdateExtent(outInfo, outExtent);
-  this->Update();  
-  outputImage->AllocateScalars(outInfo);
 #else
-if (this->GetOutputInformation(0))
-  {
-  this->GetOutputInformation(0)->Set(
-    vtkStreamingDemandDrivenPipeline::UPDATE_EXTENT(),
-    this->GetOutputInformation(0)->Get(
-    vtkStreamingDemandDrivenPipeline::WHOLE_EXTENT()), 6);
-  }
+  outputImage->AllocateScalars(inputImage->GetScalarType(),inputImage->GetNumberOfScalarComponents());
 #endif
 
   vtkDataArray* frenetTangentArray = this->Centerline->GetPointData()->GetArray(this->FrenetTangentArrayName); 
@@ -360,29 +514,21 @@ if (this->GetOutputInformation(0))
     return 1;
     }
 
-  vtkImageReslice* reslice = vtkImageReslice::New();
-  reslice->SetOutputDimensionality(2);
-#if (VTK_MAJOR_VERSION <= 5)
-  reslice->SetInput(inputImage);
-#else
-  reslice->SetInputData(inputImage);
-#endif
-  reslice->SetInterpolationModeToCubic();
-  //turn off transformation of the input spacin, origin and extent, so we can define what we want
-  reslice->TransformInputSamplingOff();
-  //set the value of the voxels that are out of the input data
-  reslice->SetBackgroundLevel(this->ReslicingBackgroundLevel);
-  //set the outputspacing
-  //reslice->SetOutputSpacing(this->OutputSpacing[0],this->OutputSpacing[1],this->OutputSpacing[2]);
-  reslice->SetOutputSpacing(this->OutputSpacing);
-// going to MPR
+  if (linePoints->GetNumberOfPoints() < outExtent[5] + 1)
+    {
+    vtkErrorMacro(<< "RequestData: Centerline has fewer points than output slices.");
+    return 1;
+    }
+
+  // sampling frame of each slice: origin, then the in-plane x axis (the
+  // parallel transport normal p) and y axis (t x p) in input coordinates
+  int numberOfSlices = outExtent[5] - outExtent[4] + 1;
+  std::vector<double> frames(9*numberOfSlices);
   for (int slice=outExtent[4]; slice<(outExtent[5] + 1);slice++) 
     {// for each slice (or point on the line)
-    double centerSlice[3];
-    linePoints->GetPoint(slice,centerSlice);
+    double* frame = &frames[9*(slice-outExtent[4])];
+    linePoints->GetPoint(slice,frame);
 
-    // To calculate the outputorigin & the necessarry transform 
-    // the vectors are retreived from the array's
     //t is the vector in the direction of the Centerline, so along the z-axis in the MPR volume
     double t[3];
     frenetTangentArray->GetTuple(slice,t);
@@ -391,50 +537,43 @@ if (this->GetOutputInformation(0))
     double p[3];
     parallelTransportNormalsArray->GetTuple(slice,p);
 
-    double tp[3];
     //tp is the crossproduct of  t and p, and will be directed to the 'West' direction of the inputvolume,in the MPR volume this will be along the y-axis 
+    double* tp = frame + 6;
     tp[0] = (t[1]*p[2]- t[2]*p[1]); 
     tp[1] = (t[2]*p[0]- t[0]*p[2]); 
     tp[2] = (t[0]*p[1]- t[1]*p[0]); 
 
-    //set the axis of the first slice according to the vectors of the first point in the line
-    reslice->SetResliceAxesDirectionCosines(p[0],p[1],p[2],tp[0],tp[1],tp[2],t[0],t[1],t[2]);
-    // the firstPoint on the Centerline coresponds to the origin of the output axes unit vectors
-    reslice->SetResliceAxesOrigin(centerSlice[0],centerSlice[1],centerSlice[2]); 
-    //the outputextent will be one slice
-    reslice->SetOutputExtent(this->OutputExtent[0],this->OutputExtent[1],this->OutputExtent[2],this->OutputExtent[3],0,0);
-    //the outputorigin in the input coordinate system is set to zero
-    double outputorigin[3];
-    outputorigin[0] = 0.0;
-    outputorigin[1] = 0.0;
-    outputorigin[2] = 0.0;
-
-    reslice->SetOutputOrigin(this->OutputOrigin);
-    reslice->Update();
-        
-    int resliceUpdateExtent[6];
-    resliceUpdateExtent[0] = outExtent[0];
-    resliceUpdateExtent[1] = outExtent[1];
-    resliceUpdateExtent[2] = outExtent[2];
-    resliceUpdateExtent[3] = outExtent[3];
-    resliceUpdateExtent[4] = 0;
-    resliceUpdateExtent[5] = 0;
-
-    vtkIdType outputInc[3];
-    outputImage->GetIncrements(outputInc);
-
-    int scalarType =  reslice->GetOutput()->GetScalarType();
-    switch (scalarType)
-      {
-      vtkTemplateMacro(
-        FillSlice(
-          static_cast<VTK_TT*>(reslice->GetOutput()->GetScalarPointerForExtent(resliceUpdateExtent)),
-          static_cast<VTK_TT*>(outputImage->GetScalarPointerForExtent(outExtent)),
-          resliceUpdateExtent, outExtent, outputInc, slice));
-      } 
-    }// for each slice
-
-  reslice->Delete();
+    frame[3] = p[0];
+    frame[4] = p[1];
+    frame[5] = p[2];
+    }
+
+  // the input is requested with its whole extent
+  int inDataExtent[6];
+  inputImage->GetExtent(inDataExtent);
+  double inOrigin[3], inSpacing[3];
+  inputImage->GetOrigin(inOrigin);
+  inputImage->GetSpacing(inSpacing);
+  vtkIdType inInc[3], outInc[3];
+  inputImage->GetIncrements(inInc);
+  outputImage->GetIncrements(outInc);
+  int numberOfComponents = inputImage->GetNumberOfScalarComponents();
+  int cubic = this->InterpolationMode == VTK_RESLICE_CUBIC ? 1 : 0;
+
+  switch (inputImage->GetScalarType())
+    {
+    vtkTemplateMacro(
+      vtkvmtkCurvedMPRImageFilterReslice(
+        static_cast<const VTK_TT*>(inputImage->GetScalarPointer()),
+        inDataExtent, inInc, inOrigin, inSpacing, numberOfComponents,
+        static_cast<VTK_TT*>(outputImage->GetScalarPointer()),
+        outExtent, outInc, this->OutputOrigin, this->OutputSpacing,
+        &frames[0], cubic, this->ReslicingBackgroundLevel));
+    default:
+      vtkErrorMacro(<< "RequestData: Unsupported input scalar type.");
+      return 1;
+    }
+
   return 1;
 }
 
@@ -449,6 +588,7 @@ void vtkvmtkCurvedMPRImageFilter::PrintSelf(ostream& os, vtkIndent indent)
   os << indent << "OutputSpacing: (" << this->OutputSpacing[0] << ", "
      << this->OutputSpacing[1] << ", " << this->OutputSpacing[2] << ")\n";
   os << indent << "ReslicingBackgroundLevel: (" << this->ReslicingBackgroundLevel << ")\n";
+  os << indent << "InterpolationMode: " << this->InterpolationMode << "\n";
   os << indent << "OutputExtent: (" << this->OutputExtent[0] << ", "
      << this->OutputExtent[1] << ", " << this->OutputExtent[2] << ")\n";
   os << indent << "OutputExtent(3-5): (" << this->OutputExtent[3] << ", "
@@ -49,6 +49,15 @@ public:
   // Set/Get the Back Ground Level of the Resliced Data
   vtkSetMacro(ReslicingBackgroundLevel,double);
   vtkGetMacro(ReslicingBackgroundLevel,double);
+
+  // Description:
+  // Set/Get the interpolation used to sample the input, VTK_RESLICE_LINEAR
+  // or VTK_RESLICE_CUBIC (default). Any mode other than VTK_RESLICE_CUBIC
+  // is taken as VTK_RESLICE_LINEAR.
+  virtual void SetInterpolationMode(int mode);
+  vtkGetMacro(InterpolationMode,int);
+  void SetInterpolationModeToLinear() { this->SetInterpolationMode(VTK_RESLICE_LINEAR); }
+  void SetInterpolationModeToCubic() { this->SetInterpolationMode(VTK_RESLICE_CUBIC); }
  
    // Description:
   // Set/Get the name of the FrenetTangentArray
@@ -79,17 +88,15 @@ public:
  protected:
   vtkvmtkCurvedMPRImageFilter();
   ~vtkvmtkCurvedMPRImageFilter();
-//BTX
-  template<class T>
-  void FillSlice(T* outReslicePtr, T* outputImagePtr, int* resliceUpdateExtent, int* outExtent, vtkIdType* outputInc, int slice);
-//ETX
   // Description:
   // This method is called by the superclass and sets the update extent of the input image to the wholeextent 
   virtual int RequestUpdateExtent (vtkInformation *, 
                                    vtkInformationVector **, 
                                    vtkInformationVector *) VTK_OVERRIDE;
   // Description:
-  // This method is called by the superclass and performs the actual computation of the MPR image
+  // This method is called by the superclass and performs the actual computation of the MPR image.
+  // The sampling frames of all centerline points are computed first, then the input is sampled
+  // directly into the output, in parallel over slices
   virtual int RequestData(vtkInformation *, 
                           vtkInformationVector **, 
                           vtkInformationVector *) VTK_OVERRIDE;
@@ -103,6 +110,7 @@ public:
   double InplaneOutputSpacing[2];
   int InplaneOutputSize[2];
   double ReslicingBackgroundLevel;
+  int InterpolationMode;
   int OutputExtent[6];
   double OutputOrigin[3];
   double OutputSpacing[3];
@@ -39,6 +39,13 @@ Version:   $Revision: 1.6 $
 #include "vtkInformation.h"
 #include "vtkInformationVector.h"
 #include "vtkObjectFactory.h"
+#include "vtkQuadraticTetra.h"
+#include "vtkUnsignedCharArray.h"
+#include "vtkIdTypeArray.h"
+#include "vtkSMPTools.h"
+#include "vtkSMPThreadLocal.h"
+
+#include <vector>
 
 
 vtkStandardNewMacro(vtkvmtkLinearToQuadraticMeshFilter);
@@ -54,6 +61,7 @@ vtkvmtkLinearToQuadraticMeshFilter::vtkvmtkLinearToQuadraticMeshFilter()
   this->NegativeJacobianTolerance = 0.0;
   this->JacobianRelaxation = 1;
   this->TestFinalJacobians = 0;
+  this->UseFlatEdgeTable = 0;
 }
 
 vtkvmtkLinearToQuadraticMeshFilter::~vtkvmtkLinearToQuadraticMeshFilter()
@@ -96,6 +104,25 @@ int vtkvmtkLinearToQuadraticMeshFilter::RequestData(
       }
     }
 
+  if (this->UseFlatEdgeTable)
+    {
+    vtkIdTypeArray* flatTetraIds = vtkIdTypeArray::New();
+    input->GetIdsOfCellsOfType(VTK_TETRA,flatTetraIds);
+    vtkIdTypeArray* flatTriangleIds = vtkIdTypeArray::New();
+    input->GetIdsOfCellsOfType(VTK_TRIANGLE,flatTriangleIds);
+    if (flatTetraIds->GetNumberOfTuples() + flatTriangleIds->GetNumberOfTuples() == input->GetNumberOfCells())
+      {
+      int ret = this->FlatEdgeTableRequestData(input,output,flatTetraIds,flatTriangleIds);
+      flatTetraIds->Delete();
+      flatTriangleIds->Delete();
+      cellEntityIdsArray->Delete();
+      return ret;
+      }
+    vtkDebugMacro(<<"Mesh contains cells other than tetrahedra and triangles, not using the flat edge table.");
+    flatTetraIds->Delete();
+    flatTriangleIds->Delete();
+    }
+
   vtkPoints* outputPoints = vtkPoints::New();
 
   int numberOfInputPoints = input->GetNumberOfPoints();
@@ -1822,9 +1849,9 @@ bool vtkvmtkLinearToQuadraticMeshFilter::HasJacobianChangedSign(vtkCell* linearV
   int numberOfCellPoints = quadraticVolumeCell->GetNumberOfPoints();
   for (q=0; q<numberOfCellPoints; q++)
     {
-    quadraturePCoords[0] = parametricCoords[q*numberOfCellPoints + 0];
-    quadraturePCoords[1] = parametricCoords[q*numberOfCellPoints + 1];
-    quadraturePCoords[2] = parametricCoords[q*numberOfCellPoints + 2];
+    quadraturePCoords[0] = parametricCoords[3*q + 0];
+    quadraturePCoords[1] = parametricCoords[3*q + 1];
+    quadraturePCoords[2] = parametricCoords[3*q + 2];
     double linearJacobian = this->ComputeJacobian(linearVolumeCell,quadraturePCoords);
     double quadraticJacobian = this->ComputeJacobian(quadraticVolumeCell,quadraturePCoords);
     if (linearJacobian*quadraticJacobian < this->NegativeJacobianTolerance)
@@ -1837,6 +1864,652 @@ bool vtkvmtkLinearToQuadraticMeshFilter::HasJacobianChangedSign(vtkCell* linearV
   return signChanged;
 }
 
+// Local edges of linear tetrahedra and triangles, in the order the default
+// path visits them, which determines the numbering of midside nodes.
+static const int vtkvmtkLinearToQuadraticMeshFilterTetraEdges[6][2] = { {0,1}, {0,2}, {0,3}, {1,2}, {1,3}, {2,3} };
+static const int vtkvmtkLinearToQuadraticMeshFilterTriangleEdges[3][2] = { {0,1}, {0,2}, {1,2} };
+
+// Flat edge table: the edges (a,b) with a<b are stored per lower vertex a,
+// in EdgeOffsets[a]..EdgeOffsets[a+1]. For each edge, the other vertex b,
+// the first slot (ordered cell index times edges per cell plus local edge
+// index) referencing it and the id of its midside node are kept.
+class vtkvmtkLinearToQuadraticMeshFilterEdgeTable
+{
+public:
+  vtkvmtkLinearToQuadraticMeshFilterEdgeTable(vtkUnstructuredGrid* input, const vtkIdType* orderedCellIds, vtkIdType numberOfTetras, vtkIdType numberOfCells) :
+    Input(input), OrderedCellIds(orderedCellIds), NumberOfTetras(numberOfTetras), NumberOfCells(numberOfCells) {}
+
+  vtkIdType GetSlot(vtkIdType k, int e) const
+  {
+    return k < this->NumberOfTetras ? 6*k+e : 6*this->NumberOfTetras + 3*(k-this->NumberOfTetras) + e;
+  }
+
+  int GetCellEdges(vtkIdType k, const int (*&edges)[2]) const
+  {
+    if (k < this->NumberOfTetras)
+      {
+      edges = vtkvmtkLinearToQuadraticMeshFilterTetraEdges;
+      return 6;
+      }
+    edges = vtkvmtkLinearToQuadraticMeshFilterTriangleEdges;
+    return 3;
+  }
+
+  vtkIdType FindEdge(vtkIdType pointId0, vtkIdType pointId1) const
+  {
+    vtkIdType a = pointId0 < pointId1 ? pointId0 : pointId1;
+    vtkIdType b = pointId0 < pointId1 ? pointId1 : pointId0;
+    for (vtkIdType i=this->EdgeOffsets[a]; i<this->EdgeOffsets[a+1]; i++)
+      {
+      if (this->EdgeOtherPointIds[i] == b)
+        {
+        return i;
+        }
+      }
+    return -1;
+  }
+
+  vtkUnstructuredGrid* Input;
+  const vtkIdType* OrderedCellIds;
+  vtkIdType NumberOfTetras;
+  vtkIdType NumberOfCells;
+  std::vector<vtkIdType> CellOrder;
+  std::vector<vtkIdType> EdgeOffsets;
+  std::vector<vtkIdType> EdgeOtherPointIds;
+  std::vector<vtkIdType> EdgeFirstSlots;
+  std::vector<vtkIdType> EdgeIds;
+};
+
+// Collects the unique edges of which each point is the lower vertex, first
+// counting them and then filling the table.
+class vtkvmtkLinearToQuadraticMeshFilterPointEdgesFunctor
+{
+public:
+  vtkvmtkLinearToQuadraticMeshFilterPointEdgesFunctor(vtkvmtkLinearToQuadraticMeshFilterEdgeTable* table, vtkIdType* counts, bool fill) :
+    Table(table), Counts(counts), Fill(fill) {}
+
+  void operator()(vtkIdType begin, vtkIdType end)
+  {
+    std::vector<vtkIdType>& edges = this->LocalEdges.Local();
+    unsigned short ncells;
+    vtkIdType *cells, npts, *pts;
+    for (vtkIdType a=begin; a<end; a++)
+      {
+      edges.clear();
+      this->Table->Input->GetPointCells(a,ncells,cells);
+      for (unsigned short c=0; c<ncells; c++)
+        {
+        vtkIdType k = this->Table->CellOrder[cells[c]];
+        if (k < 0)
+          {
+          continue;
+          }
+        this->Table->Input->GetCellPoints(cells[c],npts,pts);
+        const int (*cellEdges)[2];
+        int numberOfCellEdges = this->Table->GetCellEdges(k,cellEdges);
+        for (int e=0; e<numberOfCellEdges; e++)
+          {
+          vtkIdType pointId0 = pts[cellEdges[e][0]];
+          vtkIdType pointId1 = pts[cellEdges[e][1]];
+          vtkIdType lower = pointId0 < pointId1 ? pointId0 : pointId1;
+          vtkIdType upper = pointId0 < pointId1 ? pointId1 : pointId0;
+          if (lower != a || upper == a)
+            {
+            continue;
+            }
+          vtkIdType slot = this->Table->GetSlot(k,e);
+          size_t i;
+          for (i=0; i<edges.size(); i+=2)
+            {
+            if (edges[i] == upper)
+              {
+              if (slot < edges[i+1])
+                {
+                edges[i+1] = slot;
+                }
+              break;
+              }
+            }
+          if (i == edges.size())
+            {
+            edges.push_back(upper);
+            edges.push_back(slot);
+            }
+          }
+        }
+      if (!this->Fill)
+        {
+        this->Counts[a] = static_cast<vtkIdType>(edges.size() / 2);
+        continue;
+        }
+      vtkIdType offset = this->Table->EdgeOffsets[a];
+      for (size_t i=0; i<edges.size(); i+=2)
+        {
+        this->Table->EdgeOtherPointIds[offset] = edges[i];
+        this->Table->EdgeFirstSlots[offset] = edges[i+1];
+        offset++;
+        }
+      }
+  }
+
+private:
+  vtkvmtkLinearToQuadraticMeshFilterEdgeTable* Table;
+  vtkIdType* Counts;
+  bool Fill;
+  vtkSMPThreadLocal<std::vector<vtkIdType> > LocalEdges;
+};
+
+// Numbers midside nodes in the order edges are first referenced by the
+// ordered cells: each cell first counts the edges it references first, then,
+// given the running offsets, assigns their ids.
+class vtkvmtkLinearToQuadraticMeshFilterEdgeIdsFunctor
+{
+public:
+  vtkvmtkLinearToQuadraticMeshFilterEdgeIdsFunctor(vtkvmtkLinearToQuadraticMeshFilterEdgeTable* table, vtkIdType* cellEdgeOffsets, vtkIdType* edgePointIds, bool assign) :
+    Table(table), CellEdgeOffsets(cellEdgeOffsets), EdgePointIds(edgePointIds), Assign(assign) {}
+
+  void operator()(vtkIdType begin, vtkIdType end)
+  {
+    vtkIdType npts, *pts;
+    for (vtkIdType k=begin; k<end; k++)
+      {
+      this->Table->Input->GetCellPoints(this->Table->OrderedCellIds[k],npts,pts);
+      const int (*cellEdges)[2];
+      int numberOfCellEdges = this->Table->GetCellEdges(k,cellEdges);
+      vtkIdType edgeId = this->Assign ? this->CellEdgeOffsets[k] : 0;
+      for (int e=0; e<numberOfCellEdges; e++)
+        {
+        vtkIdType pointId0 = pts[cellEdges[e][0]];
+        vtkIdType pointId1 = pts[cellEdges[e][1]];
+        vtkIdType i = this->Table->FindEdge(pointId0,pointId1);
+        if (i == -1 || this->Table->EdgeFirstSlots[i] != this->Table->GetSlot(k,e))
+          {
+          continue;
+          }
+        if (this->Assign)
+          {
+          this->Table->EdgeIds[i] = edgeId;
+          this->EdgePointIds[2*edgeId] = pointId0;
+          this->EdgePointIds[2*edgeId+1] = pointId1;
+          }
+        edgeId++;
+        }
+      if (!this->Assign)
+        {
+        this->CellEdgeOffsets[k] = edgeId;
+        }
+      }
+  }
+
+private:
+  vtkvmtkLinearToQuadraticMeshFilterEdgeTable* Table;
+  vtkIdType* CellEdgeOffsets;
+  vtkIdType* EdgePointIds;
+  bool Assign;
+};
+
+// Writes quadratic tetrahedra followed by quadratic triangles straight into
+// the legacy cell array layout.
+class vtkvmtkLinearToQuadraticMeshFilterConnectivityFunctor
+{
+public:
+  vtkvmtkLinearToQuadraticMeshFilterConnectivityFunctor(vtkvmtkLinearToQuadraticMeshFilterEdgeTable* table, vtkIdType numberOfInputPoints, vtkIdType* connectivity, vtkIdType* locations, unsigned char* types) :
+    Table(table), NumberOfInputPoints(numberOfInputPoints), Connectivity(connectivity), Locations(locations), Types(types) {}
+
+  void operator()(vtkIdType begin, vtkIdType end)
+  {
+    vtkIdType npts, *pts;
+    for (vtkIdType k=begin; k<end; k++)
+      {
+      this->Table->Input->GetCellPoints(this->Table->OrderedCellIds[k],npts,pts);
+      bool tetra = k < this->Table->NumberOfTetras;
+      vtkIdType location = tetra ? 11*k : 11*this->Table->NumberOfTetras + 7*(k-this->Table->NumberOfTetras);
+      vtkIdType* cellPts = this->Connectivity + location;
+      this->Locations[k] = location;
+      if (tetra)
+        {
+        this->Types[k] = VTK_QUADRATIC_TETRA;
+        cellPts[0] = 10;
+        cellPts[1] = pts[0];
+        cellPts[2] = pts[1];
+        cellPts[3] = pts[2];
+        cellPts[4] = pts[3];
+        cellPts[5] = this->GetEdgePointId(pts[0],pts[1]);
+        cellPts[6] = this->GetEdgePointId(pts[1],pts[2]);
+        cellPts[7] = this->GetEdgePointId(pts[0],pts[2]);
+        cellPts[8] = this->GetEdgePointId(pts[0],pts[3]);
+        cellPts[9] = this->GetEdgePointId(pts[1],pts[3]);
+        cellPts[10] = this->GetEdgePointId(pts[2],pts[3]);
+        }
+      else
+        {
+        this->Types[k] = VTK_QUADRATIC_TRIANGLE;
+        cellPts[0] = 6;
+        cellPts[1] = pts[0];
+        cellPts[2] = pts[1];
+        cellPts[3] = pts[2];
+        cellPts[4] = this->GetEdgePointId(pts[0],pts[1]);
+        cellPts[5] = this->GetEdgePointId(pts[1],pts[2]);
+        cellPts[6] = this->GetEdgePointId(pts[0],pts[2]);
+        }
+      }
+  }
+
+private:
+  vtkIdType GetEdgePointId(vtkIdType pointId0, vtkIdType pointId1) const
+  {
+    return this->NumberOfInputPoints + this->Table->EdgeIds[this->Table->FindEdge(pointId0,pointId1)];
+  }
+
+  vtkvmtkLinearToQuadraticMeshFilterEdgeTable* Table;
+  vtkIdType NumberOfInputPoints;
+  vtkIdType* Connectivity;
+  vtkIdType* Locations;
+  unsigned char* Types;
+};
+
+class vtkvmtkLinearToQuadraticMeshFilterPointsFunctor
+{
+public:
+  vtkvmtkLinearToQuadraticMeshFilterPointsFunctor(vtkUnstructuredGrid* input, const vtkIdType* edgePointIds, double* coords) :
+    Input(input), EdgePointIds(edgePointIds), Coords(coords) {}
+
+  void operator()(vtkIdType begin, vtkIdType end)
+  {
+    vtkIdType numberOfInputPoints = this->Input->GetNumberOfPoints();
+    double point0[3], point1[3];
+    for (vtkIdType i=begin; i<end; i++)
+      {
+      if (i < numberOfInputPoints)
+        {
+        this->Input->GetPoint(i,this->Coords+3*i);
+        continue;
+        }
+      vtkIdType edgeId = i - numberOfInputPoints;
+      this->Input->GetPoint(this->EdgePointIds[2*edgeId],point0);
+      this->Input->GetPoint(this->EdgePointIds[2*edgeId+1],point1);
+      for (int j=0; j<3; j++)
+        {
+        this->Coords[3*i+j] = 0.5 * (point0[j] + point1[j]);
+        }
+      }
+  }
+
+private:
+  vtkUnstructuredGrid* Input;
+  const vtkIdType* EdgePointIds;
+  double* Coords;
+};
+
+// Same test as HasJacobianChangedSign for a linear and a quadratic
+// tetrahedron, with the shape function derivatives tabulated once at the
+// quadrature points and at the nodes, and node coordinates read from a flat
+// array.
+class vtkvmtkLinearToQuadraticMeshFilterTetraJacobianFunctor
+{
+public:
+  vtkvmtkLinearToQuadraticMeshFilterTetraJacobianFunctor(int quadratureOrder, double negativeJacobianTolerance, const double* coords, const vtkIdType* connectivity, const vtkIdType* cellIds, unsigned char* signChanged) :
+    NegativeJacobianTolerance(negativeJacobianTolerance), Coords(coords), Connectivity(connectivity), CellIds(cellIds), SignChanged(signChanged)
+  {
+    vtkvmtkGaussQuadrature* gaussQuadrature = vtkvmtkGaussQuadrature::New();
+    gaussQuadrature->SetOrder(quadratureOrder);
+    gaussQuadrature->Initialize(VTK_QUADRATIC_TETRA);
+    this->NumberOfQuadraturePoints = gaussQuadrature->GetNumberOfQuadraturePoints();
+    vtkQuadraticTetra* quadraticTetra = vtkQuadraticTetra::New();
+    double* parametricCoords = quadraticTetra->GetParametricCoords();
+    this->NumberOfEvaluationPoints = this->NumberOfQuadraturePoints + 10;
+    this->Derivs.resize(30*this->NumberOfEvaluationPoints);
+    double pcoords[3];
+    for (int q=0; q<this->NumberOfEvaluationPoints; q++)
+      {
+      if (q < this->NumberOfQuadraturePoints)
+        {
+        gaussQuadrature->GetQuadraturePoint(q,pcoords);
+        }
+      else
+        {
+        int n = q - this->NumberOfQuadraturePoints;
+        pcoords[0] = parametricCoords[3*n+0];
+        pcoords[1] = parametricCoords[3*n+1];
+        pcoords[2] = parametricCoords[3*n+2];
+        }
+      vtkQuadraticTetra::InterpolationDerivs(pcoords,&this->Derivs[30*q]);
+      }
+    quadraticTetra->Delete();
+    gaussQuadrature->Delete();
+  }
+
+  bool HasJacobianChangedSign(const vtkIdType* cellPts) const
+  {
+    double x[3][10];
+    for (int j=0; j<10; j++)
+      {
+      const double* point = this->Coords + 3*cellPts[j];
+      x[0][j] = point[0];
+      x[1][j] = point[1];
+      x[2][j] = point[2];
+      }
+
+    double linearJacobianMatrix[3][3];
+    for (int i=0; i<3; i++)
+      {
+      linearJacobianMatrix[0][i] = x[i][1] - x[i][0];
+      linearJacobianMatrix[1][i] = x[i][2] - x[i][0];
+      linearJacobianMatrix[2][i] = x[i][3] - x[i][0];
+      }
+    double linearJacobian = vtkMath::Determinant3x3(linearJacobianMatrix);
+
+    for (int q=0; q<this->NumberOfEvaluationPoints; q++)
+      {
+      const double* derivs = &this->Derivs[30*q];
+      double jacobianMatrix[3][3];
+      for (int r=0; r<3; r++)
+        {
+        const double* rderivs = derivs + 10*r;
+        for (int i=0; i<3; i++)
+          {
+          double sum = 0.0;
+          for (int j=0; j<10; j++)
+            {
+            sum += x[i][j] * rderivs[j];
+            }
+          jacobianMatrix[r][i] = sum;
+          }
+        }
+      double quadraticJacobian = vtkMath::Determinant3x3(jacobianMatrix);
+      double tolerance = q < this->NumberOfQuadraturePoints ? 0.0 : this->NegativeJacobianTolerance;
+      if (linearJacobian*quadraticJacobian < tolerance)
+        {
+        return true;
+        }
+      }
+    return false;
+  }
+
+  void operator()(vtkIdType begin, vtkIdType end)
+  {
+    for (vtkIdType i=begin; i<end; i++)
+      {
+      vtkIdType cellId = this->CellIds ? this->CellIds[i] : i;
+      this->SignChanged[i] = this->HasJacobianChangedSign(this->Connectivity + 11*cellId + 1) ? 1 : 0;
+      }
+  }
+
+private:
+  double NegativeJacobianTolerance;
+  const double* Coords;
+  const vtkIdType* Connectivity;
+  const vtkIdType* CellIds;
+  unsigned char* SignChanged;
+  int NumberOfQuadraturePoints;
+  int NumberOfEvaluationPoints;
+  std::vector<double> Derivs;
+};
+
+int vtkvmtkLinearToQuadraticMeshFilter::FlatEdgeTableRequestData(vtkUnstructuredGrid* input, vtkUnstructuredGrid* output, vtkIdTypeArray* tetraIds, vtkIdTypeArray* triangleIds)
+{
+  vtkIdType numberOfInputPoints = input->GetNumberOfPoints();
+  vtkIdType numberOfInputTetras = tetraIds->GetNumberOfTuples();
+  vtkIdType numberOfInputTriangles = triangleIds->GetNumberOfTuples();
+  vtkIdType numberOfOrderedCells = numberOfInputTetras + numberOfInputTriangles;
+
+  vtkDataArray* cellEntityIdsArray = NULL;
+  if (this->ReferenceSurface && this->CellEntityIdsArrayName)
+    {
+    cellEntityIdsArray = input->GetCellData()->GetArray(this->CellEntityIdsArrayName);
+    }
+
+  // tetrahedra first, then triangles, as in the default path
+  std::vector<vtkIdType> orderedCellIds(numberOfOrderedCells);
+  vtkIdType k;
+  for (k=0; k<numberOfInputTetras; k++)
+    {
+    orderedCellIds[k] = tetraIds->GetValue(k);
+    }
+  for (k=0; k<numberOfInputTriangles; k++)
+    {
+    orderedCellIds[numberOfInputTetras+k] = triangleIds->GetValue(k);
+    }
+
+  input->BuildLinks();
+
+  vtkvmtkLinearToQuadraticMeshFilterEdgeTable table(input,orderedCellIds.empty() ? NULL : &orderedCellIds[0],numberOfInputTetras,numberOfOrderedCells);
+  table.CellOrder.assign(input->GetNumberOfCells(),-1);
+  for (k=0; k<numberOfOrderedCells; k++)
+    {
+    table.CellOrder[orderedCellIds[k]] = k;
+    }
+
+  std::vector<vtkIdType> counts(numberOfInputPoints+1,0);
+  vtkvmtkLinearToQuadraticMeshFilterPointEdgesFunctor countFunctor(&table,&counts[0],false);
+  vtkSMPTools::For(0,numberOfInputPoints,countFunctor);
+
+  table.EdgeOffsets.resize(numberOfInputPoints+1);
+  table.EdgeOffsets[0] = 0;
+  vtkIdType i;
+  for (i=0; i<numberOfInputPoints; i++)
+    {
+    table.EdgeOffsets[i+1] = table.EdgeOffsets[i] + counts[i];
+    }
+  vtkIdType numberOfEdges = table.EdgeOffsets[numberOfInputPoints];
+  table.EdgeOtherPointIds.resize(numberOfEdges);
+  table.EdgeFirstSlots.resize(numberOfEdges);
+  table.EdgeIds.assign(numberOfEdges,-1);
+
+  vtkvmtkLinearToQuadraticMeshFilterPointEdgesFunctor fillFunctor(&table,NULL,true);
+  vtkSMPTools::For(0,numberOfInputPoints,fillFunctor);
+
+  std::vector<vtkIdType> cellEdgeOffsets(numberOfOrderedCells+1,0);
+  std::vector<vtkIdType> edgePointIds(2*numberOfEdges);
+  vtkvmtkLinearToQuadraticMeshFilterEdgeIdsFunctor edgeCountFunctor(&table,&cellEdgeOffsets[0],NULL,false);
+  vtkSMPTools::For(0,numberOfOrderedCells,edgeCountFunctor);
+  vtkIdType offset = 0;
+  for (k=0; k<numberOfOrderedCells; k++)
+    {
+    vtkIdType count = cellEdgeOffsets[k];
+    cellEdgeOffsets[k] = offset;
+    offset += count;
+    }
+  vtkvmtkLinearToQuadraticMeshFilterEdgeIdsFunctor edgeAssignFunctor(&table,&cellEdgeOffsets[0],edgePointIds.empty() ? NULL : &edgePointIds[0],true);
+  vtkSMPTools::For(0,numberOfOrderedCells,edgeAssignFunctor);
+
+  // connectivity
+  vtkIdTypeArray* connectivityArray = vtkIdTypeArray::New();
+  connectivityArray->SetNumberOfTuples(11*numberOfInputTetras + 7*numberOfInputTriangles);
+  vtkIdTypeArray* locationsArray = vtkIdTypeArray::New();
+  locationsArray->SetNumberOfTuples(numberOfOrderedCells);
+  vtkUnsignedCharArray* typesArray = vtkUnsignedCharArray::New();
+  typesArray->SetNumberOfTuples(numberOfOrderedCells);
+
+  vtkvmtkLinearToQuadraticMeshFilterConnectivityFunctor connectivityFunctor(&table,numberOfInputPoints,connectivityArray->GetPointer(0),locationsArray->GetPointer(0),typesArray->GetPointer(0));
+  vtkSMPTools::For(0,numberOfOrderedCells,connectivityFunctor);
+
+  // point coordinates are kept in a flat array while projecting and relaxing
+  vtkIdType numberOfOutputPoints = numberOfInputPoints + numberOfEdges;
+  std::vector<double> coords(3*numberOfOutputPoints);
+  vtkvmtkLinearToQuadraticMeshFilterPointsFunctor pointsFunctor(input,edgePointIds.empty() ? NULL : &edgePointIds[0],&coords[0]);
+  vtkSMPTools::For(0,numberOfOutputPoints,pointsFunctor);
+
+  vtkPointData* inputPointData = input->GetPointData();
+  vtkPointData* outputPointData = output->GetPointData();
+  outputPointData->InterpolateAllocate(inputPointData,numberOfOutputPoints);
+  for (i=0; i<numberOfInputPoints; i++)
+    {
+    outputPointData->CopyData(inputPointData,i,i);
+    }
+  vtkIdType edgeId;
+  for (edgeId=0; edgeId<numberOfEdges; edgeId++)
+    {
+    outputPointData->InterpolateEdge(inputPointData,numberOfInputPoints+edgeId,edgePointIds[2*edgeId],edgePointIds[2*edgeId+1],0.5);
+    }
+
+  vtkCellData* inputCellData = input->GetCellData();
+  vtkCellData* outputCellData = output->GetCellData();
+  outputCellData->CopyAllocate(inputCellData,numberOfOrderedCells);
+  for (k=0; k<numberOfOrderedCells; k++)
+    {
+    outputCellData->CopyData(inputCellData,orderedCellIds[k],k);
+    }
+
+  // projection of the midside nodes of surface edges, each node once
+  std::vector<char> projectedEdges;
+  vtkIdType numberOfProjectedEdges = 0;
+  if (this->ReferenceSurface)
+    {
+    projectedEdges.assign(numberOfEdges,0);
+    vtkIdType npts, *pts;
+    for (k=numberOfInputTetras; k<numberOfOrderedCells; k++)
+      {
+      vtkIdType cellId = orderedCellIds[k];
+      if (cellEntityIdsArray && static_cast<int>(cellEntityIdsArray->GetComponent(cellId,0)) != this->ProjectedCellEntityId)
+        {
+        continue;
+        }
+      input->GetCellPoints(cellId,npts,pts);
+      for (int e=0; e<3; e++)
+        {
+        vtkIdType edgeIndex = table.FindEdge(pts[vtkvmtkLinearToQuadraticMeshFilterTriangleEdges[e][0]],pts[vtkvmtkLinearToQuadraticMeshFilterTriangleEdges[e][1]]);
+        if (!projectedEdges[table.EdgeIds[edgeIndex]])
+          {
+          projectedEdges[table.EdgeIds[edgeIndex]] = 1;
+          numberOfProjectedEdges++;
+          }
+        }
+      }
+
+    vtkCellLocator* locator = vtkCellLocator::New();
+    locator->SetDataSet(this->ReferenceSurface);
+    locator->BuildLocator();
+    double projectedPoint[3];
+    vtkIdType referenceCellId;
+    int subId;
+    double dist2;
+    for (edgeId=0; edgeId<numberOfEdges; edgeId++)
+      {
+      if (!projectedEdges[edgeId])
+        {
+        continue;
+        }
+      double* edgePoint = &coords[3*(numberOfInputPoints+edgeId)];
+      locator->FindClosestPoint(edgePoint,projectedPoint,referenceCellId,subId,dist2);
+      edgePoint[0] = projectedPoint[0];
+      edgePoint[1] = projectedPoint[1];
+      edgePoint[2] = projectedPoint[2];
+      }
+    locator->Delete();
+    }
+
+  const vtkIdType* connectivity = connectivityArray->GetPointer(0);
+
+  // relaxation of projected nodes of tetrahedra whose Jacobian changed sign
+  if (numberOfProjectedEdges > 0 && numberOfInputTetras > 0)
+    {
+    std::vector<vtkIdType> projectedTetraIds;
+    for (k=0; k<numberOfInputTetras; k++)
+      {
+      const vtkIdType* cellPts = connectivity + 11*k + 1;
+      for (int e=4; e<10; e++)
+        {
+        if (projectedEdges[cellPts[e]-numberOfInputPoints])
+          {
+          projectedTetraIds.push_back(k);
+          break;
+          }
+        }
+      }
+
+    vtkIdType numberOfProjectedTetras = static_cast<vtkIdType>(projectedTetraIds.size());
+    std::vector<unsigned char> signChanged(numberOfProjectedTetras+1,0);
+    vtkvmtkLinearToQuadraticMeshFilterTetraJacobianFunctor jacobianFunctor(this->QuadratureOrder,this->NegativeJacobianTolerance,&coords[0],connectivity,numberOfProjectedTetras > 0 ? &projectedTetraIds[0] : NULL,&signChanged[0]);
+
+    int numberOfRelaxationSteps = 10;
+    int maxSignChangeIterations = 20;
+    int signChangeCounter = 0;
+    bool anySignChange = numberOfProjectedTetras > 0;
+    while (anySignChange)
+      {
+      if (signChangeCounter >= maxSignChangeIterations)
+        {
+        break;
+        }
+      signChangeCounter++;
+      anySignChange = false;
+
+      vtkSMPTools::For(0,numberOfProjectedTetras,jacobianFunctor);
+
+      // flagged tetrahedra are relaxed serially, as they may share nodes
+      for (i=0; i<numberOfProjectedTetras; i++)
+        {
+        if (!signChanged[i])
+          {
+          continue;
+          }
+        const vtkIdType* cellPts = connectivity + 11*projectedTetraIds[i] + 1;
+        int s;
+        for (s=0; s<numberOfRelaxationSteps; s++)
+          {
+          if (!jacobianFunctor.HasJacobianChangedSign(cellPts))
+            {
+            break;
+            }
+          anySignChange = true;
+          vtkWarningMacro(<<"Warning: projection causes element "<<orderedCellIds[projectedTetraIds[i]]<<" to have a negative Jacobian somewhere. Relaxing projection for this element.");
+          double relaxation = (double)(s+1)/(double)numberOfRelaxationSteps;
+          for (int e=4; e<10; e++)
+            {
+            edgeId = cellPts[e] - numberOfInputPoints;
+            if (!projectedEdges[edgeId])
+              {
+              continue;
+              }
+            double* edgePoint = &coords[3*cellPts[e]];
+            const double* point0 = &coords[3*edgePointIds[2*edgeId]];
+            const double* point1 = &coords[3*edgePointIds[2*edgeId+1]];
+            for (int j=0; j<3; j++)
+              {
+              edgePoint[j] = (1.0 - relaxation) * edgePoint[j] + relaxation * (0.5 * (point0[j] + point1[j]));
+              }
+            }
+          }
+        }
+      }
+    }
+
+  if (this->TestFinalJacobians && numberOfInputTetras > 0)
+    {
+    std::vector<unsigned char> signChanged(numberOfInputTetras);
+    vtkvmtkLinearToQuadraticMeshFilterTetraJacobianFunctor jacobianFunctor(this->QuadratureOrder,this->NegativeJacobianTolerance,&coords[0],connectivity,NULL,&signChanged[0]);
+    vtkSMPTools::For(0,numberOfInputTetras,jacobianFunctor);
+    for (k=0; k<numberOfInputTetras; k++)
+      {
+      if (signChanged[k])
+        {
+        vtkErrorMacro("Error: negative Jacobian detected in cell "<<k<<" even after relaxation. Output quadratic mesh will have negative Jacobians.");
+        }
+      }
+    }
+
+  vtkPoints* outputPoints = vtkPoints::New();
+  outputPoints->SetNumberOfPoints(numberOfOutputPoints);
+  for (i=0; i<numberOfOutputPoints; i++)
+    {
+    outputPoints->SetPoint(i,&coords[3*i]);
+    }
+  output->SetPoints(outputPoints);
+  outputPoints->Delete();
+
+  vtkCellArray* cellArray = vtkCellArray::New();
+  cellArray->SetCells(numberOfOrderedCells,connectivityArray);
+  output->SetCells(typesArray,locationsArray,cellArray);
+
+  cellArray->Delete();
+  connectivityArray->Delete();
+  locationsArray->Delete();
+  typesArray->Delete();
+
+  return 1;
+}
+
 void vtkvmtkLinearToQuadraticMeshFilter::PrintSelf(ostream& os, vtkIndent indent)
 {
   this->Superclass::PrintSelf(os,indent);
@@ -30,6 +30,8 @@ Version:   $Revision: 1.4 $
 #include "vtkCell.h"
 #include "vtkvmtkWin32Header.h"
 
+class vtkIdTypeArray;
+
 class VTK_VMTK_MISC_EXPORT vtkvmtkLinearToQuadraticMeshFilter : public vtkUnstructuredGridAlgorithm
 {
   public: 
@@ -68,6 +70,17 @@ class VTK_VMTK_MISC_EXPORT vtkvmtkLinearToQuadraticMeshFilter : public vtkUnstru
   vtkGetMacro(TestFinalJacobians,int);
   vtkBooleanMacro(TestFinalJacobians,int);
 
+  // Description:
+  // If on, meshes made only of tetrahedra and triangles are converted with a
+  // flat, per-vertex edge table built in parallel: connectivity is generated
+  // in a single pass, each surface midside node is projected once and
+  // Jacobians are checked on raw coordinate arrays. Point and cell numbering
+  // is the same as with the default path. Meshes with other cell types always
+  // use the default path.
+  vtkSetMacro(UseFlatEdgeTable,int);
+  vtkGetMacro(UseFlatEdgeTable,int);
+  vtkBooleanMacro(UseFlatEdgeTable,int);
+
   protected:
   vtkvmtkLinearToQuadraticMeshFilter();
   ~vtkvmtkLinearToQuadraticMeshFilter();
@@ -77,6 +90,8 @@ class VTK_VMTK_MISC_EXPORT vtkvmtkLinearToQuadraticMeshFilter : public vtkUnstru
   bool HasJacobianChangedSign(vtkCell* linearVolumeCell, vtkCell* quadraticVolumeCell);
   double ComputeJacobian(vtkCell* cell, double pcoords[3]);
 
+  int FlatEdgeTableRequestData(vtkUnstructuredGrid* input, vtkUnstructuredGrid* output, vtkIdTypeArray* tetraIds, vtkIdTypeArray* triangleIds);
+
   int UseBiquadraticWedge;
 
   int NumberOfNodesHexahedra;
@@ -91,6 +106,8 @@ class VTK_VMTK_MISC_EXPORT vtkvmtkLinearToQuadraticMeshFilter : public vtkUnstru
   int JacobianRelaxation;
   int TestFinalJacobians;
 
+  int UseFlatEdgeTable;
+
   private:
   vtkvmtkLinearToQuadraticMeshFilter(const vtkvmtkLinearToQuadraticMeshFilter&);  // Not implemented.
   void operator=(const vtkvmtkLinearToQuadraticMeshFilter&);  // Not implemented.
@@ -21,12 +21,9 @@ Version:   $Revision: 1.1 $
 
 #include "vtkvmtkMeshProjection.h"
 
-#include "vtkCellLocator.h"
-#include "vtkDoubleArray.h"
-#include "vtkGenericCell.h"
+#include "vtkvmtkClosestPointProjector.h"
 #include "vtkUnstructuredGrid.h"
 #include "vtkPointData.h"
-#include "vtkMath.h"
 #include "vtkInformation.h"
 #include "vtkInformationVector.h"
 #include "vtkObjectFactory.h"
@@ -37,6 +34,7 @@ vtkStandardNewMacro(vtkvmtkMeshProjection);
 vtkvmtkMeshProjection::vtkvmtkMeshProjection()
 {
   this->ReferenceMesh = NULL;
+  this->Projector = vtkvmtkClosestPointProjector::New();
   this->Tolerance = 1E-6;
 }
 
@@ -47,6 +45,9 @@ vtkvmtkMeshProjection::~vtkvmtkMeshProjection()
     this->ReferenceMesh->Delete();
     this->ReferenceMesh = NULL;
     }
+
+  this->Projector->Delete();
+  this->Projector = NULL;
 }
 
 int vtkvmtkMeshProjection::RequestData(
@@ -62,15 +63,6 @@ int vtkvmtkMeshProjection::RequestData(
   vtkUnstructuredGrid *output = vtkUnstructuredGrid::SafeDownCast(
     outInfo->Get(vtkDataObject::DATA_OBJECT()));
 
-  vtkIdType i;
-  vtkIdType cellId;
-  int subId;
-  double point[3], closestPoint[3];
-  double pcoords[3];
-  double distance2;
-  vtkCellLocator *locator;
-  vtkGenericCell *genericCell;
-
   if (!this->ReferenceMesh)
     {
     vtkErrorMacro(<<"No reference mesh!");
@@ -85,28 +77,12 @@ int vtkvmtkMeshProjection::RequestData(
   vtkPointData* referencePointData = this->ReferenceMesh->GetPointData();
 
   outputPointData->InterpolateAllocate(referencePointData,numberOfPoints);
-  
-  locator = vtkCellLocator::New();
-  genericCell = vtkGenericCell::New();
-
-  locator->SetDataSet(this->ReferenceMesh);
-  locator->BuildLocator();
-  locator->SetTolerance(this->Tolerance);
-
-  for (i=0; i<numberOfPoints; i++)
-    {
-    input->GetPoint(i,point);
-    locator->FindClosestPoint(point,closestPoint,genericCell,cellId,subId,distance2);
-    double* weights = new double[genericCell->GetNumberOfPoints()];
-    genericCell->EvaluatePosition(closestPoint,NULL,subId,pcoords,distance2,weights);
-
-    outputPointData->InterpolatePoint(referencePointData,i,genericCell->GetPointIds(),weights);
-
-    delete[] weights;
-    }
 
-  locator->Delete();
-  genericCell->Delete();
+  // the projection is kept by the projector, so re-executing with new point
+  // data on the same reference geometry only interpolates
+  this->Projector->SetDataSet(this->ReferenceMesh);
+  this->Projector->ComputeProjection(input->GetPoints());
+  this->Projector->InterpolatePointData(referencePointData,outputPointData);
 
   return 1;
 }
@@ -29,6 +29,8 @@ Version:   $Revision: 1.1 $
 #include "vtkUnstructuredGrid.h"
 #include "vtkvmtkWin32Header.h"
 
+class vtkvmtkClosestPointProjector;
+
 class VTK_VMTK_MISC_EXPORT vtkvmtkMeshProjection : public vtkUnstructuredGridAlgorithm
 {
   public: 
@@ -40,6 +42,9 @@ class VTK_VMTK_MISC_EXPORT vtkvmtkMeshProjection : public vtkUnstructuredGridAlg
   vtkSetObjectMacro(ReferenceMesh,vtkUnstructuredGrid);
   vtkGetObjectMacro(ReferenceMesh,vtkUnstructuredGrid);
 
+  // Description:
+  // Deprecated, has no effect. Closest points are now found exactly by a
+  // vtkvmtkClosestPointProjector; kept so that existing callers still work.
   vtkSetMacro(Tolerance,double);
   vtkGetMacro(Tolerance,double);
 
@@ -50,6 +55,7 @@ class VTK_VMTK_MISC_EXPORT vtkvmtkMeshProjection : public vtkUnstructuredGridAlg
   virtual int RequestData(vtkInformation *, vtkInformationVector **, vtkInformationVector *) VTK_OVERRIDE;
 
   vtkUnstructuredGrid *ReferenceMesh;
+  vtkvmtkClosestPointProjector *Projector;
   double Tolerance;
 
   private:
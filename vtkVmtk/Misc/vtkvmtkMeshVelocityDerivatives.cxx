@@ -0,0 +1,838 @@
+/*=========================================================================
+
+Program:   VMTK
+Module:    $RCSfile: vtkvmtkMeshVelocityDerivatives.cxx,v $
+Language:  C++
+Date:      $Date: 2006/04/06 16:47:48 $
+Version:   $Revision: 1.1 $
+
+  Copyright (c) Luca Antiga, David Steinman. All rights reserved.
+  See LICENCE file for details.
+
+  Portions of this code are covered under the VTK copyright.
+  See VTKCopyright.txt or http://www.kitware.com/VTKCopyright.htm
+  for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+
+#include "vtkvmtkMeshVelocityDerivatives.h"
+
+#include "vtkvmtkGaussQuadrature.h"
+#include "vtkvmtkFEShapeFunctions.h"
+
+#include "vtkUnstructuredGrid.h"
+#include "vtkPolyData.h"
+#include "vtkPointData.h"
+#include "vtkCellArray.h"
+#include "vtkDoubleArray.h"
+#include "vtkGenericCell.h"
+#include "vtkMath.h"
+#include "vtkGeometryFilter.h"
+#include "vtkPolyDataNormals.h"
+#include "vtkInformation.h"
+#include "vtkInformationVector.h"
+#include "vtkObjectFactory.h"
+#include "vtkSMPTools.h"
+#include "vtkVersion.h"
+
+#include <algorithm>
+
+
+vtkStandardNewMacro(vtkvmtkMeshVelocityDerivatives);
+
+vtkvmtkMeshVelocityDerivatives::vtkvmtkMeshVelocityDerivatives()
+{
+  this->VelocityArrayName = NULL;
+  this->VelocityGradientArrayName = NULL;
+  this->Lambda2ArrayName = NULL;
+  this->VorticityArrayName = NULL;
+  this->QCriterionArrayName = NULL;
+  this->HelicityArrayName = NULL;
+  this->WallShearRateArrayName = NULL;
+
+  this->ComputeLambda2 = 1;
+  this->ComputeVorticity = 1;
+  this->ComputeQCriterion = 1;
+  this->ComputeHelicity = 1;
+  this->ComputeWallShearRate = 0;
+
+  this->ConvergenceTolerance = 1E-6;
+  this->QuadratureOrder = 3;
+  this->ReuseMassMatrix = 0;
+
+  this->BuiltDataSet = NULL;
+  this->BuiltGeometryMTime = 0;
+  this->BuiltNumberOfPoints = -1;
+  this->BuiltNumberOfCells = -1;
+  this->BuiltQuadratureOrder = -1;
+
+  this->SetNumberOfOutputPorts(2);
+}
+
+vtkvmtkMeshVelocityDerivatives::~vtkvmtkMeshVelocityDerivatives()
+{
+  if (this->VelocityArrayName)
+    {
+    delete[] this->VelocityArrayName;
+    this->VelocityArrayName = NULL;
+    }
+  if (this->VelocityGradientArrayName)
+    {
+    delete[] this->VelocityGradientArrayName;
+    this->VelocityGradientArrayName = NULL;
+    }
+  if (this->Lambda2ArrayName)
+    {
+    delete[] this->Lambda2ArrayName;
+    this->Lambda2ArrayName = NULL;
+    }
+  if (this->VorticityArrayName)
+    {
+    delete[] this->VorticityArrayName;
+    this->VorticityArrayName = NULL;
+    }
+  if (this->QCriterionArrayName)
+    {
+    delete[] this->QCriterionArrayName;
+    this->QCriterionArrayName = NULL;
+    }
+  if (this->HelicityArrayName)
+    {
+    delete[] this->HelicityArrayName;
+    this->HelicityArrayName = NULL;
+    }
+  if (this->WallShearRateArrayName)
+    {
+    delete[] this->WallShearRateArrayName;
+    this->WallShearRateArrayName = NULL;
+    }
+}
+
+int vtkvmtkMeshVelocityDerivatives::FillOutputPortInformation(int port, vtkInformation *info)
+{
+  if (port == 1)
+    {
+    info->Set(vtkDataObject::DATA_TYPE_NAME(), "vtkPolyData");
+    return 1;
+    }
+  return this->Superclass::FillOutputPortInformation(port,info);
+}
+
+vtkPolyData* vtkvmtkMeshVelocityDerivatives::GetSurfaceOutput()
+{
+  return vtkPolyData::SafeDownCast(this->GetOutputDataObject(1));
+}
+
+void vtkvmtkMeshVelocityDerivatives::ReleaseOperators()
+{
+  std::vector<vtkIdType>().swap(this->RowOffsets);
+  std::vector<vtkIdType>().swap(this->ColumnIds);
+  std::vector<double>().swap(this->MassValues);
+  std::vector<double>().swap(this->DerivativeValues);
+  std::vector<double>().swap(this->InverseDiagonal);
+  std::vector<double>().swap(this->Gradient);
+  this->BuiltDataSet = NULL;
+  this->BuiltGeometryMTime = 0;
+  this->BuiltNumberOfPoints = -1;
+  this->BuiltNumberOfCells = -1;
+  this->BuiltQuadratureOrder = -1;
+}
+
+bool vtkvmtkMeshVelocityDerivatives::OperatorsUpToDate(vtkUnstructuredGrid* input)
+{
+  if (this->RowOffsets.empty() || this->BuiltQuadratureOrder != this->QuadratureOrder)
+    {
+    return false;
+    }
+  if (this->BuiltNumberOfPoints != input->GetNumberOfPoints() || this->BuiltNumberOfCells != input->GetNumberOfCells())
+    {
+    return false;
+    }
+  if (this->ReuseMassMatrix)
+    {
+    return true;
+    }
+  unsigned long geometryMTime = input->GetPoints() ? input->GetPoints()->GetMTime() : 0;
+  if (input->GetCells())
+    {
+    geometryMTime = std::max(geometryMTime,static_cast<unsigned long>(input->GetCells()->GetMTime()));
+    }
+  return this->BuiltDataSet == input && this->BuiltGeometryMTime == geometryMTime;
+}
+
+class vtkvmtkMeshVelocityDerivativesPatternFunctor
+{
+public:
+  vtkvmtkMeshVelocityDerivativesPatternFunctor(vtkUnstructuredGrid* input, const char* cellIs3D, const vtkIdType* rowOffsets, vtkIdType* rowSizes, vtkIdType* columnIds) :
+    Input(input), CellIs3D(cellIs3D), RowOffsets(rowOffsets), RowSizes(rowSizes), ColumnIds(columnIds) {}
+
+  // first pass (no offsets yet) counts the neighbors of each point, second
+  // pass writes them in ascending order
+  void operator()(vtkIdType begin, vtkIdType end)
+  {
+    std::vector<vtkIdType> row;
+    unsigned short ncells;
+    vtkIdType *cells;
+    vtkIdType npts, *pts;
+    for (vtkIdType i=begin; i<end; i++)
+      {
+      row.clear();
+      this->Input->GetPointCells(i,ncells,cells);
+      for (unsigned short c=0; c<ncells; c++)
+        {
+        if (!this->CellIs3D[cells[c]])
+          {
+          continue;
+          }
+        this->Input->GetCellPoints(cells[c],npts,pts);
+        row.insert(row.end(),pts,pts+npts);
+        }
+      std::sort(row.begin(),row.end());
+      row.erase(std::unique(row.begin(),row.end()),row.end());
+      if (!this->RowOffsets)
+        {
+        this->RowSizes[i] = static_cast<vtkIdType>(row.size());
+        }
+      else
+        {
+        std::copy(row.begin(),row.end(),this->ColumnIds+this->RowOffsets[i]);
+        }
+      }
+  }
+
+private:
+  vtkUnstructuredGrid* Input;
+  const char* CellIs3D;
+  const vtkIdType* RowOffsets;
+  vtkIdType* RowSizes;
+  vtkIdType* ColumnIds;
+};
+
+void vtkvmtkMeshVelocityDerivatives::BuildOperators(vtkUnstructuredGrid* input)
+{
+  vtkIdType numberOfPoints = input->GetNumberOfPoints();
+  vtkIdType numberOfCells = input->GetNumberOfCells();
+
+  std::vector<char> cellIs3D(numberOfCells);
+  vtkGenericCell* genericCell = vtkGenericCell::New();
+  for (vtkIdType k=0; k<numberOfCells; k++)
+    {
+    genericCell->SetCellType(input->GetCellType(k));
+    cellIs3D[k] = genericCell->GetCellDimension() == 3 ? 1 : 0;
+    }
+  genericCell->Delete();
+
+  // the pattern of the mass matrix is shared by the derivative operators
+  input->BuildLinks();
+
+  std::vector<vtkIdType> rowSizes(numberOfPoints);
+  vtkvmtkMeshVelocityDerivativesPatternFunctor countFunctor(input,&cellIs3D[0],NULL,&rowSizes[0],NULL);
+  vtkSMPTools::For(0,numberOfPoints,countFunctor);
+
+  this->RowOffsets.assign(numberOfPoints+1,0);
+  for (vtkIdType i=0; i<numberOfPoints; i++)
+    {
+    this->RowOffsets[i+1] = this->RowOffsets[i] + rowSizes[i];
+    }
+  vtkIdType numberOfEntries = this->RowOffsets[numberOfPoints];
+
+  this->ColumnIds.resize(numberOfEntries);
+  if (numberOfEntries > 0)
+    {
+    vtkvmtkMeshVelocityDerivativesPatternFunctor fillFunctor(input,&cellIs3D[0],&this->RowOffsets[0],NULL,&this->ColumnIds[0]);
+    vtkSMPTools::For(0,numberOfPoints,fillFunctor);
+    }
+
+  this->MassValues.assign(numberOfEntries,0.0);
+  this->DerivativeValues.assign(3*numberOfEntries,0.0);
+
+  vtkvmtkGaussQuadrature* gaussQuadrature = vtkvmtkGaussQuadrature::New();
+  gaussQuadrature->SetOrder(this->QuadratureOrder);
+
+  vtkvmtkFEShapeFunctions* feShapeFunctions = vtkvmtkFEShapeFunctions::New();
+
+  std::vector<vtkIdType> entries;
+  for (vtkIdType k=0; k<numberOfCells; k++)
+    {
+    if (!cellIs3D[k])
+      {
+      continue;
+      }
+    vtkCell* cell = input->GetCell(k);
+    gaussQuadrature->Initialize(cell->GetCellType());
+    feShapeFunctions->Initialize(cell,gaussQuadrature->GetQuadraturePoints());
+    int numberOfQuadraturePoints = gaussQuadrature->GetNumberOfQuadraturePoints();
+    int numberOfCellPoints = cell->GetNumberOfPoints();
+
+    // locate the entries of the element once for all quadrature points
+    entries.resize(numberOfCellPoints*numberOfCellPoints);
+    int i, j;
+    for (i=0; i<numberOfCellPoints; i++)
+      {
+      vtkIdType iId = cell->GetPointId(i);
+      const vtkIdType* rowBegin = &this->ColumnIds[0] + this->RowOffsets[iId];
+      const vtkIdType* rowEnd = &this->ColumnIds[0] + this->RowOffsets[iId+1];
+      for (j=0; j<numberOfCellPoints; j++)
+        {
+        entries[i*numberOfCellPoints+j] = std::lower_bound(rowBegin,rowEnd,cell->GetPointId(j)) - &this->ColumnIds[0];
+        }
+      }
+
+    int q;
+    double dphij[3];
+    for (q=0; q<numberOfQuadraturePoints; q++)
+      {
+      double weight = feShapeFunctions->GetJacobian(q) * gaussQuadrature->GetQuadratureWeight(q);
+      for (i=0; i<numberOfCellPoints; i++)
+        {
+        double phii = feShapeFunctions->GetPhi(q,i);
+        for (j=0; j<numberOfCellPoints; j++)
+          {
+          vtkIdType entry = entries[i*numberOfCellPoints+j];
+          feShapeFunctions->GetDPhi(q,j,dphij);
+          this->MassValues[entry] += weight * phii * feShapeFunctions->GetPhi(q,j);
+          this->DerivativeValues[3*entry+0] += weight * phii * dphij[0];
+          this->DerivativeValues[3*entry+1] += weight * phii * dphij[1];
+          this->DerivativeValues[3*entry+2] += weight * phii * dphij[2];
+          }
+        }
+      }
+    }
+
+  gaussQuadrature->Delete();
+  feShapeFunctions->Delete();
+
+  // Jacobi preconditioner; points outside 3D cells have empty rows and are
+  // left out of the projections
+  this->InverseDiagonal.assign(numberOfPoints,0.0);
+  for (vtkIdType i=0; i<numberOfPoints; i++)
+    {
+    for (vtkIdType e=this->RowOffsets[i]; e<this->RowOffsets[i+1]; e++)
+      {
+      if (this->ColumnIds[e] == i && this->MassValues[e] != 0.0)
+        {
+        this->InverseDiagonal[i] = 1.0 / this->MassValues[e];
+        }
+      }
+    }
+
+  unsigned long geometryMTime = input->GetPoints() ? input->GetPoints()->GetMTime() : 0;
+  if (input->GetCells())
+    {
+    geometryMTime = std::max(geometryMTime,static_cast<unsigned long>(input->GetCells()->GetMTime()));
+    }
+  this->BuiltDataSet = input;
+  this->BuiltGeometryMTime = geometryMTime;
+  this->BuiltNumberOfPoints = numberOfPoints;
+  this->BuiltNumberOfCells = numberOfCells;
+  this->BuiltQuadratureOrder = this->QuadratureOrder;
+  this->Gradient.clear();
+}
+
+class vtkvmtkMeshVelocityDerivativesRHSFunctor
+{
+public:
+  vtkvmtkMeshVelocityDerivativesRHSFunctor(vtkDataArray* velocityArray, const vtkIdType* rowOffsets, const vtkIdType* columnIds, const double* derivativeValues, vtkIdType numberOfPoints, double* rhs) :
+    VelocityArray(velocityArray), RowOffsets(rowOffsets), ColumnIds(columnIds), DerivativeValues(derivativeValues), NumberOfPoints(numberOfPoints), RHS(rhs) {}
+
+  void operator()(vtkIdType begin, vtkIdType end)
+  {
+    double velocity[3];
+    double value[9];
+    for (vtkIdType i=begin; i<end; i++)
+      {
+      for (int l=0; l<9; l++)
+        {
+        value[l] = 0.0;
+        }
+      for (vtkIdType e=this->RowOffsets[i]; e<this->RowOffsets[i+1]; e++)
+        {
+        this->VelocityArray->GetTuple(this->ColumnIds[e],velocity);
+        const double* derivative = this->DerivativeValues + 3*e;
+        for (int c=0; c<3; c++)
+          {
+          value[3*c+0] += derivative[0] * velocity[c];
+          value[3*c+1] += derivative[1] * velocity[c];
+          value[3*c+2] += derivative[2] * velocity[c];
+          }
+        }
+      for (int l=0; l<9; l++)
+        {
+        this->RHS[l*this->NumberOfPoints+i] = value[l];
+        }
+      }
+  }
+
+private:
+  vtkDataArray* VelocityArray;
+  const vtkIdType* RowOffsets;
+  const vtkIdType* ColumnIds;
+  const double* DerivativeValues;
+  vtkIdType NumberOfPoints;
+  double* RHS;
+};
+
+class vtkvmtkMeshVelocityDerivativesSolveFunctor
+{
+public:
+  vtkvmtkMeshVelocityDerivativesSolveFunctor(const vtkIdType* rowOffsets, const vtkIdType* columnIds, const double* massValues, const double* inverseDiagonal, vtkIdType numberOfPoints, double tolerance, const double* rhs, double* solution) :
+    RowOffsets(rowOffsets), ColumnIds(columnIds), MassValues(massValues), InverseDiagonal(inverseDiagonal), NumberOfPoints(numberOfPoints), Tolerance(tolerance), RHS(rhs), Solution(solution) {}
+
+  void Multiply(const double* x, double* y)
+  {
+    for (vtkIdType i=0; i<this->NumberOfPoints; i++)
+      {
+      double value = 0.0;
+      for (vtkIdType e=this->RowOffsets[i]; e<this->RowOffsets[i+1]; e++)
+        {
+        value += this->MassValues[e] * x[this->ColumnIds[e]];
+        }
+      y[i] = value;
+      }
+  }
+
+  static double Dot(const double* a, const double* b, vtkIdType n)
+  {
+    double value = 0.0;
+    for (vtkIdType i=0; i<n; i++)
+      {
+      value += a[i] * b[i];
+      }
+    return value;
+  }
+
+  // one Jacobi preconditioned conjugate gradient solve per derivative, with
+  // the stopping criterion of the OpenNL solver used by the gradient filter
+  void operator()(vtkIdType begin, vtkIdType end)
+  {
+    vtkIdType n = this->NumberOfPoints;
+    std::vector<double> r(n), z(n), p(n), ap(n);
+    for (vtkIdType l=begin; l<end; l++)
+      {
+      const double* b = this->RHS + l*n;
+      double* x = this->Solution + l*n;
+      vtkIdType i;
+      for (i=0; i<n; i++)
+        {
+        if (this->InverseDiagonal[i] == 0.0)
+          {
+          x[i] = 0.0;
+          }
+        }
+      double bb = Dot(b,b,n);
+      if (bb == 0.0)
+        {
+        std::fill(x,x+n,0.0);
+        continue;
+        }
+      this->Multiply(x,&ap[0]);
+      for (i=0; i<n; i++)
+        {
+        r[i] = b[i] - ap[i];
+        z[i] = this->InverseDiagonal[i] * r[i];
+        p[i] = z[i];
+        }
+      double rz = Dot(&r[0],&z[0],n);
+      double threshold = this->Tolerance * this->Tolerance * bb;
+      vtkIdType iteration = 0;
+      while (Dot(&r[0],&r[0],n) > threshold && iteration < n)
+        {
+        this->Multiply(&p[0],&ap[0]);
+        double pap = Dot(&p[0],&ap[0],n);
+        if (pap <= 0.0)
+          {
+          break;
+          }
+        double alpha = rz / pap;
+        for (i=0; i<n; i++)
+          {
+          x[i] += alpha * p[i];
+          r[i] -= alpha * ap[i];
+          z[i] = this->InverseDiagonal[i] * r[i];
+          }
+        double rzNew = Dot(&r[0],&z[0],n);
+        double beta = rzNew / rz;
+        rz = rzNew;
+        for (i=0; i<n; i++)
+          {
+          p[i] = z[i] + beta * p[i];
+          }
+        iteration++;
+        }
+      }
+  }
+
+private:
+  const vtkIdType* RowOffsets;
+  const vtkIdType* ColumnIds;
+  const double* MassValues;
+  const double* InverseDiagonal;
+  vtkIdType NumberOfPoints;
+  double Tolerance;
+  const double* RHS;
+  double* Solution;
+};
+
+void vtkvmtkMeshVelocityDerivatives::ComputeVelocityGradient(vtkDataArray* velocityArray, bool warmStart)
+{
+  vtkIdType numberOfPoints = this->BuiltNumberOfPoints;
+
+  if (!warmStart || this->Gradient.size() != static_cast<size_t>(9*numberOfPoints))
+    {
+    this->Gradient.assign(9*numberOfPoints,0.0);
+    }
+
+  if (this->ColumnIds.empty())
+    {
+    return;
+    }
+
+  std::vector<double> rhs(9*numberOfPoints);
+  vtkvmtkMeshVelocityDerivativesRHSFunctor rhsFunctor(velocityArray,&this->RowOffsets[0],&this->ColumnIds[0],&this->DerivativeValues[0],numberOfPoints,&rhs[0]);
+  vtkSMPTools::For(0,numberOfPoints,rhsFunctor);
+
+  // the nine projections share the mass matrix and are independent
+  vtkvmtkMeshVelocityDerivativesSolveFunctor solveFunctor(&this->RowOffsets[0],&this->ColumnIds[0],&this->MassValues[0],&this->InverseDiagonal[0],numberOfPoints,this->ConvergenceTolerance,&rhs[0],&this->Gradient[0]);
+  vtkSMPTools::For(0,9,1,solveFunctor);
+}
+
+class vtkvmtkMeshVelocityDerivativesFunctor
+{
+public:
+  vtkvmtkMeshVelocityDerivativesFunctor(vtkDataArray* velocityArray, const double* gradient, vtkIdType numberOfPoints, double* gradientOut, double* lambda2, double* vorticity, double* qCriterion, double* helicity) :
+    VelocityArray(velocityArray), Gradient(gradient), NumberOfPoints(numberOfPoints), GradientOut(gradientOut), Lambda2(lambda2), Vorticity(vorticity), QCriterion(qCriterion), Helicity(helicity) {}
+
+  void operator()(vtkIdType begin, vtkIdType end)
+  {
+    double velocityGradient[9];
+    double symmetricVelocityGradient[3][3];
+    double antiSymmetricVelocityGradient[3][3];
+    double A[3][3];
+    double eigenVectors[3][3];
+    double eigenValues[3];
+    double vorticity[3];
+    double velocity[3];
+    int j, k, l;
+    for (vtkIdType i=begin; i<end; i++)
+      {
+      for (l=0; l<9; l++)
+        {
+        velocityGradient[l] = this->Gradient[l*this->NumberOfPoints+i];
+        }
+      if (this->GradientOut)
+        {
+        std::copy(velocityGradient,velocityGradient+9,this->GradientOut+9*i);
+        }
+
+      double symmetricNorm2 = 0.0;
+      double antiSymmetricNorm2 = 0.0;
+      for (j=0; j<3; j++)
+        {
+        for (k=0; k<3; k++)
+          {
+          int index0 = k + j*3;
+          int index1 = j + k*3;
+          symmetricVelocityGradient[j][k] = 0.5 * (velocityGradient[index0] + velocityGradient[index1]);
+          antiSymmetricVelocityGradient[j][k] = 0.5 * (velocityGradient[index0] - velocityGradient[index1]);
+          symmetricNorm2 += symmetricVelocityGradient[j][k] * symmetricVelocityGradient[j][k];
+          antiSymmetricNorm2 += antiSymmetricVelocityGradient[j][k] * antiSymmetricVelocityGradient[j][k];
+          }
+        }
+
+      if (this->Lambda2)
+        {
+        for (j=0; j<3; j++)
+          {
+          for (k=0; k<3; k++)
+            {
+            A[j][k] = 0.0;
+            for (l=0; l<3; l++)
+              {
+              A[j][k] += symmetricVelocityGradient[j][l]*symmetricVelocityGradient[l][k] +
+                         antiSymmetricVelocityGradient[j][l]*antiSymmetricVelocityGradient[l][k];
+              }
+            }
+          }
+        vtkMath::Diagonalize3x3(A,eigenValues,eigenVectors);
+        std::sort(eigenValues,eigenValues+3);
+        this->Lambda2[i] = eigenValues[1];
+        }
+
+      if (this->QCriterion)
+        {
+        this->QCriterion[i] = 0.5 * (antiSymmetricNorm2 - symmetricNorm2);
+        }
+
+      vorticity[0] = velocityGradient[7] - velocityGradient[5];
+      vorticity[1] = velocityGradient[2] - velocityGradient[6];
+      vorticity[2] = velocityGradient[3] - velocityGradient[1];
+      if (this->Vorticity)
+        {
+        std::copy(vorticity,vorticity+3,this->Vorticity+3*i);
+        }
+
+      if (this->Helicity)
+        {
+        this->VelocityArray->GetTuple(i,velocity);
+        this->Helicity[i] = vtkMath::Dot(velocity,vorticity);
+        }
+      }
+  }
+
+private:
+  vtkDataArray* VelocityArray;
+  const double* Gradient;
+  vtkIdType NumberOfPoints;
+  double* GradientOut;
+  double* Lambda2;
+  double* Vorticity;
+  double* QCriterion;
+  double* Helicity;
+};
+
+class vtkvmtkMeshVelocityDerivativesWallShearRateFunctor
+{
+public:
+  vtkvmtkMeshVelocityDerivativesWallShearRateFunctor(vtkDataArray* velocityGradientArray, vtkDataArray* normalsArray, double* wallShearRate) :
+    VelocityGradientArray(velocityGradientArray), NormalsArray(normalsArray), WallShearRate(wallShearRate) {}
+
+  void operator()(vtkIdType begin, vtkIdType end)
+  {
+    double velocityGradient[9];
+    double normal[3];
+    for (vtkIdType i=begin; i<end; i++)
+      {
+      this->VelocityGradientArray->GetTuple(i,velocityGradient);
+      this->NormalsArray->GetTuple(i,normal);
+      for (int j=0; j<3; j++)
+        {
+        this->WallShearRate[3*i+j] = - normal[0] * velocityGradient[3*j + 0] - normal[1] * velocityGradient[3*j + 1] - normal[2] * velocityGradient[3*j + 2];
+        }
+      }
+  }
+
+private:
+  vtkDataArray* VelocityGradientArray;
+  vtkDataArray* NormalsArray;
+  double* WallShearRate;
+};
+
+void vtkvmtkMeshVelocityDerivatives::ComputeWallShearRateSurface(vtkUnstructuredGrid* mesh, vtkPolyData* surface)
+{
+  vtkGeometryFilter* geometryFilter = vtkGeometryFilter::New();
+#if (VTK_MAJOR_VERSION <= 5)
+  geometryFilter->SetInput(mesh);
+#else
+  geometryFilter->SetInputData(mesh);
+#endif
+  geometryFilter->Update();
+
+  vtkPolyDataNormals* normalsFilter = vtkPolyDataNormals::New();
+#if (VTK_MAJOR_VERSION <= 5)
+  normalsFilter->SetInput(geometryFilter->GetOutput());
+#else
+  normalsFilter->SetInputConnection(geometryFilter->GetOutputPort());
+#endif
+  normalsFilter->AutoOrientNormalsOn();
+  normalsFilter->ConsistencyOn();
+  normalsFilter->SplittingOff();
+  normalsFilter->Update();
+
+  surface->ShallowCopy(normalsFilter->GetOutput());
+
+  geometryFilter->Delete();
+  normalsFilter->Delete();
+
+  vtkIdType numberOfSurfacePoints = surface->GetNumberOfPoints();
+
+  vtkDoubleArray* wallShearRateArray = vtkDoubleArray::New();
+  if (this->WallShearRateArrayName)
+    {
+    wallShearRateArray->SetName(this->WallShearRateArrayName);
+    }
+  else
+    {
+    wallShearRateArray->SetName("WallShearRate");
+    }
+  wallShearRateArray->SetNumberOfComponents(3);
+  wallShearRateArray->SetNumberOfTuples(numberOfSurfacePoints);
+
+  vtkDataArray* velocityGradientArray = surface->GetPointData()->GetArray(this->VelocityGradientArrayName ? this->VelocityGradientArrayName : "VelocityGradient");
+  vtkDataArray* normalsArray = surface->GetPointData()->GetNormals();
+
+  if (velocityGradientArray && normalsArray && numberOfSurfacePoints > 0)
+    {
+    vtkvmtkMeshVelocityDerivativesWallShearRateFunctor wallShearRateFunctor(velocityGradientArray,normalsArray,wallShearRateArray->GetPointer(0));
+    vtkSMPTools::For(0,numberOfSurfacePoints,wallShearRateFunctor);
+    }
+  else
+    {
+    wallShearRateArray->FillComponent(0,0.0);
+    wallShearRateArray->FillComponent(1,0.0);
+    wallShearRateArray->FillComponent(2,0.0);
+    }
+
+  surface->GetPointData()->AddArray(wallShearRateArray);
+  wallShearRateArray->Delete();
+}
+
+int vtkvmtkMeshVelocityDerivatives::RequestData(
+  vtkInformation *vtkNotUsed(request),
+  vtkInformationVector **inputVector,
+  vtkInformationVector *outputVector)
+{
+  vtkInformation *inInfo = inputVector[0]->GetInformationObject(0);
+  vtkInformation *outInfo = outputVector->GetInformationObject(0);
+  vtkInformation *surfaceInfo = outputVector->GetInformationObject(1);
+
+  vtkUnstructuredGrid *input = vtkUnstructuredGrid::SafeDownCast(
+    inInfo->Get(vtkDataObject::DATA_OBJECT()));
+  vtkUnstructuredGrid *output = vtkUnstructuredGrid::SafeDownCast(
+    outInfo->Get(vtkDataObject::DATA_OBJECT()));
+  vtkPolyData *surface = vtkPolyData::SafeDownCast(
+    surfaceInfo->Get(vtkDataObject::DATA_OBJECT()));
+
+  if (this->VelocityArrayName == NULL)
+    {
+    vtkErrorMacro("VelocityArrayName not specified");
+    return 1;
+    }
+
+  vtkDataArray* velocityArray = input->GetPointData()->GetArray(this->VelocityArrayName);
+
+  if (velocityArray == NULL)
+    {
+    vtkErrorMacro("VelocityArray with name specified does not exist");
+    return 1;
+    }
+
+  if (velocityArray->GetNumberOfComponents() != 3)
+    {
+    vtkErrorMacro("VelocityArray must have three components");
+    return 1;
+    }
+
+  vtkIdType numberOfPoints = input->GetNumberOfPoints();
+
+  output->ShallowCopy(input);
+
+  if (numberOfPoints == 0)
+    {
+    return 1;
+    }
+
+  bool warmStart = false;
+  if (this->OperatorsUpToDate(input))
+    {
+    warmStart = this->ReuseMassMatrix != 0;
+    }
+  else
+    {
+    this->BuildOperators(input);
+    }
+
+  this->ComputeVelocityGradient(velocityArray,warmStart);
+
+  vtkDoubleArray* velocityGradientArray = NULL;
+  if (this->VelocityGradientArrayName || this->ComputeWallShearRate)
+    {
+    velocityGradientArray = vtkDoubleArray::New();
+    velocityGradientArray->SetName(this->VelocityGradientArrayName ? this->VelocityGradientArrayName : "VelocityGradient");
+    velocityGradientArray->SetNumberOfComponents(9);
+    velocityGradientArray->SetNumberOfTuples(numberOfPoints);
+    }
+
+  vtkDoubleArray* lambda2Array = NULL;
+  if (this->ComputeLambda2)
+    {
+    lambda2Array = vtkDoubleArray::New();
+    lambda2Array->SetName(this->Lambda2ArrayName ? this->Lambda2ArrayName : "Lambda2");
+    lambda2Array->SetNumberOfComponents(1);
+    lambda2Array->SetNumberOfTuples(numberOfPoints);
+    }
+
+  vtkDoubleArray* vorticityArray = NULL;
+  if (this->ComputeVorticity)
+    {
+    vorticityArray = vtkDoubleArray::New();
+    vorticityArray->SetName(this->VorticityArrayName ? this->VorticityArrayName : "Vorticity");
+    vorticityArray->SetNumberOfComponents(3);
+    vorticityArray->SetNumberOfTuples(numberOfPoints);
+    }
+
+  vtkDoubleArray* qCriterionArray = NULL;
+  if (this->ComputeQCriterion)
+    {
+    qCriterionArray = vtkDoubleArray::New();
+    qCriterionArray->SetName(this->QCriterionArrayName ? this->QCriterionArrayName : "QCriterion");
+    qCriterionArray->SetNumberOfComponents(1);
+    qCriterionArray->SetNumberOfTuples(numberOfPoints);
+    }
+
+  vtkDoubleArray* helicityArray = NULL;
+  if (this->ComputeHelicity)
+    {
+    helicityArray = vtkDoubleArray::New();
+    helicityArray->SetName(this->HelicityArrayName ? this->HelicityArrayName : "Helicity");
+    helicityArray->SetNumberOfComponents(1);
+    helicityArray->SetNumberOfTuples(numberOfPoints);
+    }
+
+  vtkvmtkMeshVelocityDerivativesFunctor derivativesFunctor(velocityArray,&this->Gradient[0],numberOfPoints,
+    velocityGradientArray ? velocityGradientArray->GetPointer(0) : NULL,
+    lambda2Array ? lambda2Array->GetPointer(0) : NULL,
+    vorticityArray ? vorticityArray->GetPointer(0) : NULL,
+    qCriterionArray ? qCriterionArray->GetPointer(0) : NULL,
+    helicityArray ? helicityArray->GetPointer(0) : NULL);
+  vtkSMPTools::For(0,numberOfPoints,derivativesFunctor);
+
+  if (lambda2Array)
+    {
+    output->GetPointData()->AddArray(lambda2Array);
+    lambda2Array->Delete();
+    }
+  if (vorticityArray)
+    {
+    output->GetPointData()->AddArray(vorticityArray);
+    vorticityArray->Delete();
+    }
+  if (qCriterionArray)
+    {
+    output->GetPointData()->AddArray(qCriterionArray);
+    qCriterionArray->Delete();
+    }
+  if (helicityArray)
+    {
+    output->GetPointData()->AddArray(helicityArray);
+    helicityArray->Delete();
+    }
+
+  if (this->ComputeWallShearRate)
+    {
+    vtkUnstructuredGrid* gradientMesh = vtkUnstructuredGrid::New();
+    gradientMesh->ShallowCopy(output);
+    gradientMesh->GetPointData()->AddArray(velocityGradientArray);
+    this->ComputeWallShearRateSurface(gradientMesh,surface);
+    gradientMesh->Delete();
+    }
+
+  if (velocityGradientArray)
+    {
+    if (this->VelocityGradientArrayName)
+      {
+      output->GetPointData()->AddArray(velocityGradientArray);
+      }
+    velocityGradientArray->Delete();
+    }
+
+  return 1;
+}
+
+void vtkvmtkMeshVelocityDerivatives::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os,indent);
+}
@@ -0,0 +1,180 @@
+/*=========================================================================
+
+Program:   VMTK
+Module:    $RCSfile: vtkvmtkMeshVelocityDerivatives.h,v $
+Language:  C++
+Date:      $Date: 2006/04/06 16:47:48 $
+Version:   $Revision: 1.1 $
+
+  Copyright (c) Luca Antiga, David Steinman. All rights reserved.
+  See LICENCE file for details.
+
+  Portions of this code are covered under the VTK copyright.
+  See VTKCopyright.txt or http://www.kitware.com/VTKCopyright.htm
+  for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+  // .NAME vtkvmtkMeshVelocityDerivatives - Computes the velocity gradient once and derives lambda2, vorticity, Q-criterion, helicity and wall shear rate from it.
+  // .SECTION Description
+  // The velocity gradient is recovered at mesh nodes by L2 projection, as
+  // in vtkvmtkUnstructuredGridGradientFilter, but the consistent mass
+  // matrix and the operators mapping nodal velocities to the projection
+  // right hand sides are assembled once, with a single sparsity pattern,
+  // and kept. Each execution then only applies these operators to the
+  // velocity and solves the nine projections, in parallel, before deriving
+  // all the requested quantities in one parallel pass over the points.
+  //
+  // The assembled operators are reused as long as the geometry of the input
+  // does not change. With ReuseMassMatrix on, they are also reused for any
+  // input with the same number of points and cells, which is the case for
+  // the time steps of a simulation read one file at a time; the previous
+  // gradient is then used as the initial guess of the projections.
+  //
+  // If ComputeWallShearRate is on, the wall shear rate is evaluated on the
+  // boundary surface of the mesh, available as the second output.
+
+#ifndef __vtkvmtkMeshVelocityDerivatives_h
+#define __vtkvmtkMeshVelocityDerivatives_h
+
+#include "vtkUnstructuredGridAlgorithm.h"
+#include "vtkUnstructuredGrid.h"
+#include "vtkvmtkWin32Header.h"
+
+#include <vector>
+
+class vtkPolyData;
+
+class VTK_VMTK_MISC_EXPORT vtkvmtkMeshVelocityDerivatives : public vtkUnstructuredGridAlgorithm
+{
+  public:
+  vtkTypeMacro(vtkvmtkMeshVelocityDerivatives,vtkUnstructuredGridAlgorithm);
+  void PrintSelf(ostream& os, vtkIndent indent) VTK_OVERRIDE;
+
+  static vtkvmtkMeshVelocityDerivatives *New();
+
+  vtkSetStringMacro(VelocityArrayName);
+  vtkGetStringMacro(VelocityArrayName);
+
+  // Description:
+  // If set, the velocity gradient (nine components, du_i/dx_j at 3*i+j) is
+  // added to the output with this name.
+  vtkSetStringMacro(VelocityGradientArrayName);
+  vtkGetStringMacro(VelocityGradientArrayName);
+
+  vtkSetStringMacro(Lambda2ArrayName);
+  vtkGetStringMacro(Lambda2ArrayName);
+
+  vtkSetStringMacro(VorticityArrayName);
+  vtkGetStringMacro(VorticityArrayName);
+
+  vtkSetStringMacro(QCriterionArrayName);
+  vtkGetStringMacro(QCriterionArrayName);
+
+  vtkSetStringMacro(HelicityArrayName);
+  vtkGetStringMacro(HelicityArrayName);
+
+  vtkSetStringMacro(WallShearRateArrayName);
+  vtkGetStringMacro(WallShearRateArrayName);
+
+  vtkSetMacro(ComputeLambda2,int);
+  vtkGetMacro(ComputeLambda2,int);
+  vtkBooleanMacro(ComputeLambda2,int);
+
+  vtkSetMacro(ComputeVorticity,int);
+  vtkGetMacro(ComputeVorticity,int);
+  vtkBooleanMacro(ComputeVorticity,int);
+
+  vtkSetMacro(ComputeQCriterion,int);
+  vtkGetMacro(ComputeQCriterion,int);
+  vtkBooleanMacro(ComputeQCriterion,int);
+
+  // Description:
+  // Helicity density, the dot product of velocity and vorticity.
+  vtkSetMacro(ComputeHelicity,int);
+  vtkGetMacro(ComputeHelicity,int);
+  vtkBooleanMacro(ComputeHelicity,int);
+
+  vtkSetMacro(ComputeWallShearRate,int);
+  vtkGetMacro(ComputeWallShearRate,int);
+  vtkBooleanMacro(ComputeWallShearRate,int);
+
+  vtkSetMacro(ConvergenceTolerance,double);
+  vtkGetMacro(ConvergenceTolerance,double);
+
+  vtkSetMacro(QuadratureOrder,int);
+  vtkGetMacro(QuadratureOrder,int);
+
+  // Description:
+  // Time series mode: reuse the assembled operators for any input with the
+  // same number of points and cells as the one they were assembled on.
+  vtkSetMacro(ReuseMassMatrix,int);
+  vtkGetMacro(ReuseMassMatrix,int);
+  vtkBooleanMacro(ReuseMassMatrix,int);
+
+  // Description:
+  // Boundary surface carrying the wall shear rate.
+  vtkPolyData* GetSurfaceOutput();
+
+  // Description:
+  // Discards the assembled operators.
+  void ReleaseOperators();
+
+  protected:
+  vtkvmtkMeshVelocityDerivatives();
+  ~vtkvmtkMeshVelocityDerivatives();
+
+  virtual int FillOutputPortInformation(int port, vtkInformation *info) VTK_OVERRIDE;
+  virtual int RequestData(vtkInformation *, vtkInformationVector **, vtkInformationVector *) VTK_OVERRIDE;
+
+  bool OperatorsUpToDate(vtkUnstructuredGrid* input);
+  void BuildOperators(vtkUnstructuredGrid* input);
+  void ComputeVelocityGradient(vtkDataArray* velocityArray, bool warmStart);
+  void ComputeWallShearRateSurface(vtkUnstructuredGrid* input, vtkPolyData* surface);
+
+  char* VelocityArrayName;
+  char* VelocityGradientArrayName;
+  char* Lambda2ArrayName;
+  char* VorticityArrayName;
+  char* QCriterionArrayName;
+  char* HelicityArrayName;
+  char* WallShearRateArrayName;
+
+  int ComputeLambda2;
+  int ComputeVorticity;
+  int ComputeQCriterion;
+  int ComputeHelicity;
+  int ComputeWallShearRate;
+
+  double ConvergenceTolerance;
+  int QuadratureOrder;
+  int ReuseMassMatrix;
+
+  // operators, in compressed rows over the point adjacency of 3D cells:
+  // mass matrix entries and, interleaved by three, the entries mapping
+  // nodal values to the right hand sides of the projected derivatives
+  std::vector<vtkIdType> RowOffsets;
+  std::vector<vtkIdType> ColumnIds;
+  std::vector<double> MassValues;
+  std::vector<double> DerivativeValues;
+  std::vector<double> InverseDiagonal;
+
+  vtkUnstructuredGrid* BuiltDataSet;
+  unsigned long BuiltGeometryMTime;
+  vtkIdType BuiltNumberOfPoints;
+  vtkIdType BuiltNumberOfCells;
+  int BuiltQuadratureOrder;
+
+  // gradient of the last execution, stored per derivative (3*i+j) over
+  // the points
+  std::vector<double> Gradient;
+
+  private:
+  vtkvmtkMeshVelocityDerivatives(const vtkvmtkMeshVelocityDerivatives&);  // Not implemented.
+  void operator=(const vtkvmtkMeshVelocityDerivatives&);  // Not implemented.
+};
+
+#endif
@@ -29,6 +29,9 @@ Version:   $Revision: 1.1 $
 #include "vtkInformation.h"
 #include "vtkInformationVector.h"
 #include "vtkObjectFactory.h"
+#include "vtkSMPTools.h"
+
+#include <algorithm>
 
 
 vtkStandardNewMacro(vtkvmtkMeshVelocityStatistics);
@@ -36,6 +39,10 @@ vtkStandardNewMacro(vtkvmtkMeshVelocityStatistics);
 vtkvmtkMeshVelocityStatistics::vtkvmtkMeshVelocityStatistics()
 {
   this->VelocityArrayIds = NULL;
+  this->ComputeMinMax = 0;
+  this->ComputeOscillatoryIndex = 0;
+  this->NumberOfAccumulatedTimeSteps = 0;
+  this->NumberOfAccumulatedPoints = 0;
 }
 
 vtkvmtkMeshVelocityStatistics::~vtkvmtkMeshVelocityStatistics()
@@ -47,6 +54,221 @@ vtkvmtkMeshVelocityStatistics::~vtkvmtkMeshVelocityStatistics()
     }
 }
 
+template<class T>
+class vtkvmtkMeshVelocityStatisticsAccumulateFunctor
+{
+public:
+  vtkvmtkMeshVelocityStatisticsAccumulateFunctor(const T* velocity, double count, double* mean, double* m2, double* minimum, double* maximum, double* magnitudeMean) :
+    Velocity(velocity), Count(count), Mean(mean), M2(m2), Minimum(minimum), Maximum(maximum), MagnitudeMean(magnitudeMean) {}
+
+  void operator()(vtkIdType begin, vtkIdType end)
+  {
+    // Welford update, Count already includes the current time step
+    double weight = 1.0 / this->Count;
+    for (vtkIdType i=begin; i<end; i++)
+      {
+      double magnitude2 = 0.0;
+      for (int c=0; c<3; c++)
+        {
+        vtkIdType index = 3*i+c;
+        double value = static_cast<double>(this->Velocity[index]);
+        double delta = value - this->Mean[index];
+        this->Mean[index] += weight * delta;
+        this->M2[index] += delta * (value - this->Mean[index]);
+        magnitude2 += value * value;
+        }
+      if (this->Minimum)
+        {
+        for (int c=0; c<3; c++)
+          {
+          vtkIdType index = 3*i+c;
+          double value = static_cast<double>(this->Velocity[index]);
+          this->Minimum[index] = value < this->Minimum[index] ? value : this->Minimum[index];
+          this->Maximum[index] = value > this->Maximum[index] ? value : this->Maximum[index];
+          }
+        }
+      if (this->MagnitudeMean)
+        {
+        this->MagnitudeMean[i] += weight * (sqrt(magnitude2) - this->MagnitudeMean[i]);
+        }
+      }
+  }
+
+private:
+  const T* Velocity;
+  double Count;
+  double* Mean;
+  double* M2;
+  double* Minimum;
+  double* Maximum;
+  double* MagnitudeMean;
+};
+
+template<class T>
+void vtkvmtkMeshVelocityStatisticsAccumulate(const T* velocity, vtkIdType numberOfPoints, double count, double* mean, double* m2, double* minimum, double* maximum, double* magnitudeMean)
+{
+  vtkvmtkMeshVelocityStatisticsAccumulateFunctor<T> functor(velocity,count,mean,m2,minimum,maximum,magnitudeMean);
+  vtkSMPTools::For(0,numberOfPoints,functor);
+}
+
+void vtkvmtkMeshVelocityStatistics::ResetStatistics()
+{
+  this->NumberOfAccumulatedTimeSteps = 0;
+  this->NumberOfAccumulatedPoints = 0;
+  std::vector<double>().swap(this->Mean);
+  std::vector<double>().swap(this->M2);
+  std::vector<double>().swap(this->Minimum);
+  std::vector<double>().swap(this->Maximum);
+  std::vector<double>().swap(this->MagnitudeMean);
+}
+
+int vtkvmtkMeshVelocityStatistics::AccumulateVelocity(vtkDataArray* velocityArray)
+{
+  if (!velocityArray)
+    {
+    vtkErrorMacro("No velocity array specified.");
+    return 0;
+    }
+
+  if (velocityArray->GetNumberOfComponents() != 3)
+    {
+    vtkErrorMacro("Velocity array must have 3 components.");
+    return 0;
+    }
+
+  vtkIdType numberOfPoints = velocityArray->GetNumberOfTuples();
+
+  if (this->NumberOfAccumulatedTimeSteps == 0)
+    {
+    this->NumberOfAccumulatedPoints = numberOfPoints;
+    this->Mean.assign(3*numberOfPoints,0.0);
+    this->M2.assign(3*numberOfPoints,0.0);
+    if (this->ComputeMinMax)
+      {
+      this->Minimum.assign(3*numberOfPoints,VTK_DOUBLE_MAX);
+      this->Maximum.assign(3*numberOfPoints,-VTK_DOUBLE_MAX);
+      }
+    if (this->ComputeOscillatoryIndex)
+      {
+      this->MagnitudeMean.assign(numberOfPoints,0.0);
+      }
+    }
+  else if (numberOfPoints != this->NumberOfAccumulatedPoints)
+    {
+    vtkErrorMacro("Velocity array size differs from the previous time steps.");
+    return 0;
+    }
+
+  this->NumberOfAccumulatedTimeSteps++;
+
+  double* minimum = this->Minimum.empty() ? NULL : &this->Minimum[0];
+  double* maximum = this->Maximum.empty() ? NULL : &this->Maximum[0];
+  double* magnitudeMean = this->MagnitudeMean.empty() ? NULL : &this->MagnitudeMean[0];
+
+  if (numberOfPoints == 0)
+    {
+    return 1;
+    }
+
+  switch (velocityArray->GetDataType())
+    {
+    vtkTemplateMacro(vtkvmtkMeshVelocityStatisticsAccumulate(static_cast<const VTK_TT*>(velocityArray->GetVoidPointer(0)),numberOfPoints,static_cast<double>(this->NumberOfAccumulatedTimeSteps),&this->Mean[0],&this->M2[0],minimum,maximum,magnitudeMean));
+    default:
+      vtkErrorMacro("Unsupported velocity array type.");
+      this->NumberOfAccumulatedTimeSteps--;
+      return 0;
+    }
+
+  return 1;
+}
+
+void vtkvmtkMeshVelocityStatistics::AddStatisticsArrays(vtkPointData* pointData)
+{
+  if (this->NumberOfAccumulatedTimeSteps == 0)
+    {
+    vtkWarningMacro("No time steps accumulated.");
+    return;
+    }
+
+  vtkIdType numberOfPoints = this->NumberOfAccumulatedPoints;
+  double count = static_cast<double>(this->NumberOfAccumulatedTimeSteps);
+
+  vtkDoubleArray* avgVelocityArray = vtkDoubleArray::New();
+  avgVelocityArray->SetName("AVGVelocity");
+  avgVelocityArray->SetNumberOfComponents(3);
+  avgVelocityArray->SetNumberOfTuples(numberOfPoints);
+
+  vtkDoubleArray* rmsVelocityArray = vtkDoubleArray::New();
+  rmsVelocityArray->SetName("RMSVelocity");
+  rmsVelocityArray->SetNumberOfComponents(3);
+  rmsVelocityArray->SetNumberOfTuples(numberOfPoints);
+
+  double* avgVelocity = avgVelocityArray->GetPointer(0);
+  double* rmsVelocity = rmsVelocityArray->GetPointer(0);
+
+  vtkIdType i;
+  for (i=0; i<3*numberOfPoints; i++)
+    {
+    avgVelocity[i] = this->Mean[i];
+    rmsVelocity[i] = sqrt(this->M2[i] / count);
+    }
+
+  pointData->AddArray(avgVelocityArray);
+  pointData->AddArray(rmsVelocityArray);
+
+  avgVelocityArray->Delete();
+  rmsVelocityArray->Delete();
+
+  if (!this->Minimum.empty())
+    {
+    vtkDoubleArray* minVelocityArray = vtkDoubleArray::New();
+    minVelocityArray->SetName("MinVelocity");
+    minVelocityArray->SetNumberOfComponents(3);
+    minVelocityArray->SetNumberOfTuples(numberOfPoints);
+
+    vtkDoubleArray* maxVelocityArray = vtkDoubleArray::New();
+    maxVelocityArray->SetName("MaxVelocity");
+    maxVelocityArray->SetNumberOfComponents(3);
+    maxVelocityArray->SetNumberOfTuples(numberOfPoints);
+
+    std::copy(this->Minimum.begin(),this->Minimum.end(),minVelocityArray->GetPointer(0));
+    std::copy(this->Maximum.begin(),this->Maximum.end(),maxVelocityArray->GetPointer(0));
+
+    pointData->AddArray(minVelocityArray);
+    pointData->AddArray(maxVelocityArray);
+
+    minVelocityArray->Delete();
+    maxVelocityArray->Delete();
+    }
+
+  if (!this->MagnitudeMean.empty())
+    {
+    vtkDoubleArray* magnitudeArray = vtkDoubleArray::New();
+    magnitudeArray->SetName("TAVelocityMagnitude");
+    magnitudeArray->SetNumberOfComponents(1);
+    magnitudeArray->SetNumberOfTuples(numberOfPoints);
+
+    vtkDoubleArray* oscillatoryIndexArray = vtkDoubleArray::New();
+    oscillatoryIndexArray->SetName("OSIVelocity");
+    oscillatoryIndexArray->SetNumberOfComponents(1);
+    oscillatoryIndexArray->SetNumberOfTuples(numberOfPoints);
+
+    for (i=0; i<numberOfPoints; i++)
+      {
+      double magnitudeMean = this->MagnitudeMean[i];
+      double meanMagnitude = vtkMath::Norm(&this->Mean[3*i]);
+      magnitudeArray->SetValue(i,magnitudeMean);
+      oscillatoryIndexArray->SetValue(i,magnitudeMean > 0.0 ? 0.5 * (1.0 - meanMagnitude / magnitudeMean) : 0.0);
+      }
+
+    pointData->AddArray(magnitudeArray);
+    pointData->AddArray(oscillatoryIndexArray);
+
+    magnitudeArray->Delete();
+    oscillatoryIndexArray->Delete();
+    }
+}
+
 int vtkvmtkMeshVelocityStatistics::RequestData(
   vtkInformation *vtkNotUsed(request),
   vtkInformationVector **inputVector,
@@ -89,74 +311,22 @@ int vtkvmtkMeshVelocityStatistics::RequestData(
       return 1;
       }
     }
- 
-  int numberOfPoints = input->GetNumberOfPoints();
-  
-  vtkDoubleArray* avgVelocityArray = vtkDoubleArray::New();
-  avgVelocityArray->SetName("AVGVelocity");
-  avgVelocityArray->SetNumberOfComponents(3);
-  avgVelocityArray->SetNumberOfTuples(numberOfPoints);
-  avgVelocityArray->FillComponent(0,0.0);
-  avgVelocityArray->FillComponent(1,0.0);
-  avgVelocityArray->FillComponent(2,0.0);
 
-  vtkDoubleArray* rmsVelocityArray = vtkDoubleArray::New();
-  rmsVelocityArray->SetName("RMSVelocity");
-  rmsVelocityArray->SetNumberOfComponents(3);
-  rmsVelocityArray->SetNumberOfTuples(numberOfPoints);
-  rmsVelocityArray->FillComponent(0,0.0);
-  rmsVelocityArray->FillComponent(1,0.0);
-  rmsVelocityArray->FillComponent(2,0.0);
+  this->ResetStatistics();
 
-  double avgVelocity[3], rmsVelocity[3], velocity[3];
-  
-  double weight = 1.0 / double(numberOfArrayIds);
-  
-  int j;
-  for (i=0; i<numberOfPoints; i++)
+  for (i=0; i<numberOfArrayIds; i++)
     {
-    for (j=0; j<numberOfArrayIds; j++)
+    if (!this->AccumulateVelocity(inputPointData->GetArray(this->VelocityArrayIds->GetId(i))))
       {
-      vtkDataArray* velocityArray = inputPointData->GetArray(this->VelocityArrayIds->GetId(j));
-      avgVelocityArray->GetTuple(i,avgVelocity);
-      velocityArray->GetTuple(i,velocity);
-      avgVelocity[0] += weight * velocity[0];
-      avgVelocity[1] += weight * velocity[1];
-      avgVelocity[2] += weight * velocity[2];
-      avgVelocityArray->SetTuple(i,avgVelocity);
+      this->ResetStatistics();
+      return 1;
       }
     }
 
-  for (i=0; i<numberOfPoints; i++)
-    {
-    for (j=0; j<numberOfArrayIds; j++)
-      {
-      vtkDataArray* velocityArray = inputPointData->GetArray(this->VelocityArrayIds->GetId(j));
-      rmsVelocityArray->GetTuple(i,rmsVelocity);
-      avgVelocityArray->GetTuple(i,avgVelocity);
-      velocityArray->GetTuple(i,velocity);
-      rmsVelocity[0] += weight * (velocity[0] - avgVelocity[0]) * (velocity[0] - avgVelocity[0]);
-      rmsVelocity[1] += weight * (velocity[1] - avgVelocity[1]) * (velocity[1] - avgVelocity[1]);
-      rmsVelocity[2] += weight * (velocity[2] - avgVelocity[2]) * (velocity[2] - avgVelocity[2]);
-      rmsVelocityArray->SetTuple(i,rmsVelocity);
-      }
-    }
+  this->AddStatisticsArrays(output->GetPointData());
 
-  for (i=0; i<numberOfPoints; i++)
-    {
-    rmsVelocityArray->GetTuple(i,rmsVelocity);
-    rmsVelocity[0] = sqrt(rmsVelocity[0]);
-    rmsVelocity[1] = sqrt(rmsVelocity[1]);
-    rmsVelocity[2] = sqrt(rmsVelocity[2]);
-    rmsVelocityArray->SetTuple(i,rmsVelocity);
-    }
+  this->ResetStatistics();
 
-  output->GetPointData()->AddArray(avgVelocityArray);
-  output->GetPointData()->AddArray(rmsVelocityArray);
-  
-  avgVelocityArray->Delete();
-  rmsVelocityArray->Delete();
-  
   return 1;
 }
 
@@ -18,9 +18,18 @@ Version:   $Revision: 1.1 $
      PURPOSE.  See the above copyright notices for more information.
 
 =========================================================================*/
-  // .NAME vtkvmtkMeshVelocityStatistics - ...
+  // .NAME vtkvmtkMeshVelocityStatistics - Temporal statistics of a velocity field on a mesh.
   // .SECTION Description
-  // .
+  // Computes the time average (AVGVelocity) and root mean square
+  // fluctuation (RMSVelocity) of a velocity field, optionally its
+  // component-wise extrema (MinVelocity, MaxVelocity), the time-averaged
+  // magnitude (TAVelocityMagnitude) and the oscillatory index
+  // 0.5 * (1 - |avg v| / avg |v|) (OSIVelocity).
+  // As a filter, the time steps are the point data arrays in
+  // VelocityArrayIds. Statistics can also be accumulated one time step at a
+  // time (ResetStatistics, AccumulateVelocity for each step, then
+  // AddStatisticsArrays), so that only one time step needs to be in memory;
+  // accumulation is single pass (Welford) and multithreaded over points.
 
 #ifndef __vtkvmtkMeshVelocityStatistics_h
 #define __vtkvmtkMeshVelocityStatistics_h
@@ -31,6 +40,11 @@ Version:   $Revision: 1.1 $
 
 #include "vtkIdList.h"
 
+#include <vector>
+
+class vtkDataArray;
+class vtkPointData;
+
 class VTK_VMTK_MISC_EXPORT vtkvmtkMeshVelocityStatistics : public vtkUnstructuredGridAlgorithm
 {
   public: 
@@ -41,6 +55,29 @@ class VTK_VMTK_MISC_EXPORT vtkvmtkMeshVelocityStatistics : public vtkUnstructure
 
   vtkSetObjectMacro(VelocityArrayIds,vtkIdList);
   vtkGetObjectMacro(VelocityArrayIds,vtkIdList);
+
+  vtkSetMacro(ComputeMinMax,int);
+  vtkGetMacro(ComputeMinMax,int);
+  vtkBooleanMacro(ComputeMinMax,int);
+
+  vtkSetMacro(ComputeOscillatoryIndex,int);
+  vtkGetMacro(ComputeOscillatoryIndex,int);
+  vtkBooleanMacro(ComputeOscillatoryIndex,int);
+
+  // Description:
+  // Discard accumulated statistics.
+  void ResetStatistics();
+
+  // Description:
+  // Add one time step. The array must have 3 components and the same number
+  // of tuples for all time steps. Returns 0 on error.
+  int AccumulateVelocity(vtkDataArray* velocityArray);
+
+  // Description:
+  // Add the statistics of the time steps accumulated so far to pointData.
+  void AddStatisticsArrays(vtkPointData* pointData);
+
+  vtkGetMacro(NumberOfAccumulatedTimeSteps,int);
   
   protected:
   vtkvmtkMeshVelocityStatistics();
@@ -49,6 +86,16 @@ class VTK_VMTK_MISC_EXPORT vtkvmtkMeshVelocityStatistics : public vtkUnstructure
   virtual int RequestData(vtkInformation *, vtkInformationVector **, vtkInformationVector *) VTK_OVERRIDE;
 
   vtkIdList* VelocityArrayIds;
+  int ComputeMinMax;
+  int ComputeOscillatoryIndex;
+
+  int NumberOfAccumulatedTimeSteps;
+  vtkIdType NumberOfAccumulatedPoints;
+  std::vector<double> Mean;
+  std::vector<double> M2;
+  std::vector<double> Minimum;
+  std::vector<double> Maximum;
+  std::vector<double> MagnitudeMean;
 
   private:
   vtkvmtkMeshVelocityStatistics(const vtkvmtkMeshVelocityStatistics&);  // Not implemented.
@@ -23,7 +23,13 @@ Version:   $Revision: 1.2 $
 #include "vtkPointData.h"
 #include "vtkMath.h"
 #include "vtkObjectFactory.h"
+#include "vtkPoints.h"
+#include "vtkSMPTools.h"
 #include "vtkVersion.h"
+#include "vtkvmtkSparseMatrix.h"
+#include "vtkvmtkDoubleVector.h"
+#include "vtkvmtkLinearSystem.h"
+#include "vtkvmtkOpenNLLinearSystemSolver.h"
 
 
 vtkStandardNewMacro(vtkvmtkRBFInterpolation);
@@ -32,8 +38,14 @@ vtkvmtkRBFInterpolation::vtkvmtkRBFInterpolation()
 {
   this->Source = NULL;
   this->RBFType = THIN_PLATE_SPLINE;
+  this->SupportRadius = 0.0;
   this->Coefficients = NULL;
   this->RBFInterpolationValue = 1.0;
+
+  this->EffectiveSupportRadius = 0.0;
+  this->CenterGridSpacing = 0.0;
+  this->CenterGridOrigin[0] = this->CenterGridOrigin[1] = this->CenterGridOrigin[2] = 0.0;
+  this->CenterGridDimensions[0] = this->CenterGridDimensions[1] = this->CenterGridDimensions[2] = 0;
 }
 
 vtkvmtkRBFInterpolation::~vtkvmtkRBFInterpolation()
@@ -70,6 +82,17 @@ double vtkvmtkRBFInterpolation::EvaluateRBF(double c[3], double x[3])
     {
     return pow(vtkMath::Distance2BetweenPoints(c,x),1.5);
     }
+  else if (this->RBFType == WENDLAND)
+    {
+    // Wendland C2, positive definite in 3D
+    double r = sqrt(vtkMath::Distance2BetweenPoints(c,x)) / this->EffectiveSupportRadius;
+    if (r >= 1.0)
+      {
+      return 0.0;
+      }
+    double s = 1.0 - r;
+    return s * s * s * s * (4.0 * r + 1.0);
+    }
   else
     {
     vtkErrorMacro(<<"Error: Unsupported RBFType!");
@@ -77,6 +100,220 @@ double vtkvmtkRBFInterpolation::EvaluateRBF(double c[3], double x[3])
     }
 }
 
+void vtkvmtkRBFInterpolation::BuildCenterGrid()
+{
+  vtkIdType numberOfPoints = this->Source->GetNumberOfPoints();
+
+  double bounds[6];
+  this->Source->GetBounds(bounds);
+
+  this->EffectiveSupportRadius = this->SupportRadius;
+  if (this->EffectiveSupportRadius <= 0.0)
+    {
+    this->EffectiveSupportRadius = 0.1 * sqrt((bounds[1]-bounds[0])*(bounds[1]-bounds[0]) + (bounds[3]-bounds[2])*(bounds[3]-bounds[2]) + (bounds[5]-bounds[4])*(bounds[5]-bounds[4]));
+    }
+  if (this->EffectiveSupportRadius <= 0.0)
+    {
+    this->EffectiveSupportRadius = 1.0;
+    }
+
+  // cells must be at least as large as the support radius, so that the
+  // centers within reach of a point lie in the 3x3x3 cells around it; they
+  // are coarsened if needed to keep the number of cells bounded
+  this->CenterGridSpacing = this->EffectiveSupportRadius;
+  double numberOfCells;
+  int i;
+  while (true)
+    {
+    numberOfCells = 1.0;
+    for (i=0; i<3; i++)
+      {
+      this->CenterGridDimensions[i] = static_cast<int>(floor((bounds[2*i+1]-bounds[2*i]) / this->CenterGridSpacing)) + 1;
+      numberOfCells *= this->CenterGridDimensions[i];
+      }
+    if (numberOfCells <= 8.0 * numberOfPoints + 1.0)
+      {
+      break;
+      }
+    this->CenterGridSpacing *= 2.0;
+    }
+
+  this->CenterGridOrigin[0] = bounds[0];
+  this->CenterGridOrigin[1] = bounds[2];
+  this->CenterGridOrigin[2] = bounds[4];
+
+  // bin the centers (counting sort)
+  this->Centers.resize(3*numberOfPoints);
+  this->CenterGridOffsets.assign(static_cast<vtkIdType>(numberOfCells)+1,0);
+  this->CenterGridIds.resize(numberOfPoints);
+
+  std::vector<vtkIdType> pointCells(numberOfPoints);
+  vtkIdType pointId;
+  for (pointId=0; pointId<numberOfPoints; pointId++)
+    {
+    double* center = &this->Centers[3*pointId];
+    this->Source->GetPoint(pointId,center);
+    int ijk[3];
+    for (i=0; i<3; i++)
+      {
+      ijk[i] = static_cast<int>(floor((center[i] - this->CenterGridOrigin[i]) / this->CenterGridSpacing));
+      ijk[i] = ijk[i] < 0 ? 0 : (ijk[i] >= this->CenterGridDimensions[i] ? this->CenterGridDimensions[i] - 1 : ijk[i]);
+      }
+    pointCells[pointId] = (static_cast<vtkIdType>(ijk[2]) * this->CenterGridDimensions[1] + ijk[1]) * this->CenterGridDimensions[0] + ijk[0];
+    this->CenterGridOffsets[pointCells[pointId]+1]++;
+    }
+
+  vtkIdType cellId;
+  for (cellId=0; cellId<static_cast<vtkIdType>(numberOfCells); cellId++)
+    {
+    this->CenterGridOffsets[cellId+1] += this->CenterGridOffsets[cellId];
+    }
+
+  std::vector<vtkIdType> cellFill(this->CenterGridOffsets.begin(),this->CenterGridOffsets.end()-1);
+  for (pointId=0; pointId<numberOfPoints; pointId++)
+    {
+    this->CenterGridIds[cellFill[pointCells[pointId]]++] = pointId;
+    }
+}
+
+int vtkvmtkRBFInterpolation::GetCenterGridRange(const double x[3], int range[6])
+{
+  // range of grid cells (inclusive) that may hold centers within reach of x
+  for (int i=0; i<3; i++)
+    {
+    double cell = floor((x[i] - this->CenterGridOrigin[i]) / this->CenterGridSpacing);
+    if (cell < -1.0 || cell > this->CenterGridDimensions[i])
+      {
+      return 0;
+      }
+    int ijk = static_cast<int>(cell);
+    range[2*i] = ijk - 1 < 0 ? 0 : ijk - 1;
+    range[2*i+1] = ijk + 1 > this->CenterGridDimensions[i] - 1 ? this->CenterGridDimensions[i] - 1 : ijk + 1;
+    if (range[2*i] > range[2*i+1])
+      {
+      return 0;
+      }
+    }
+  return 1;
+}
+
+double vtkvmtkRBFInterpolation::EvaluateCompactlySupportedFunction(double x[3])
+{
+  int range[6];
+  if (this->CenterGridOffsets.empty() || !this->GetCenterGridRange(x,range))
+    {
+    return 0.0;
+    }
+
+  double rbfValue = 0.0;
+  for (int k=range[4]; k<=range[5]; k++)
+    {
+    for (int j=range[2]; j<=range[3]; j++)
+      {
+      vtkIdType cellId = (static_cast<vtkIdType>(k) * this->CenterGridDimensions[1] + j) * this->CenterGridDimensions[0] + range[0];
+      vtkIdType begin = this->CenterGridOffsets[cellId];
+      vtkIdType end = this->CenterGridOffsets[cellId + range[1] - range[0] + 1];
+      for (vtkIdType n=begin; n<end; n++)
+        {
+        vtkIdType id = this->CenterGridIds[n];
+        rbfValue += this->Coefficients->GetValue(id) * this->EvaluateRBF(&this->Centers[3*id],x);
+        }
+      }
+    }
+
+  return rbfValue;
+}
+
+void vtkvmtkRBFInterpolation::ComputeCompactlySupportedCoefficients()
+{
+  this->BuildCenterGrid();
+
+  vtkIdType numberOfPoints = this->Source->GetNumberOfPoints();
+
+  vtkvmtkSparseMatrix* sparseMatrix = vtkvmtkSparseMatrix::New();
+  sparseMatrix->SetNumberOfRows(numberOfPoints);
+
+  std::vector<vtkIdType> rowIds;
+  std::vector<double> rowValues;
+  int range[6];
+  vtkIdType i;
+  for (i=0; i<numberOfPoints; i++)
+    {
+    double* center = &this->Centers[3*i];
+    rowIds.clear();
+    rowValues.clear();
+    this->GetCenterGridRange(center,range);
+    for (int k=range[4]; k<=range[5]; k++)
+      {
+      for (int j=range[2]; j<=range[3]; j++)
+        {
+        vtkIdType cellId = (static_cast<vtkIdType>(k) * this->CenterGridDimensions[1] + j) * this->CenterGridDimensions[0] + range[0];
+        vtkIdType begin = this->CenterGridOffsets[cellId];
+        vtkIdType end = this->CenterGridOffsets[cellId + range[1] - range[0] + 1];
+        for (vtkIdType n=begin; n<end; n++)
+          {
+          vtkIdType id = this->CenterGridIds[n];
+          if (id == i)
+            {
+            continue;
+            }
+          double value = this->EvaluateRBF(center,&this->Centers[3*id]);
+          if (value > 0.0)
+            {
+            rowIds.push_back(id);
+            rowValues.push_back(value);
+            }
+          }
+        }
+      }
+
+    vtkvmtkSparseMatrixRow* row = sparseMatrix->GetRow(i);
+    row->SetNumberOfElements(rowIds.size());
+    for (size_t n=0; n<rowIds.size(); n++)
+      {
+      row->SetElementId(n,rowIds[n]);
+      row->SetElement(n,rowValues[n]);
+      }
+    row->SetDiagonalElement(this->EvaluateRBF(center,center));
+    }
+
+  vtkvmtkDoubleVector* rhsVector = vtkvmtkDoubleVector::New();
+  rhsVector->Allocate(numberOfPoints);
+  rhsVector->Fill(this->RBFInterpolationValue);
+
+  vtkvmtkDoubleVector* solutionVector = vtkvmtkDoubleVector::New();
+  solutionVector->Allocate(numberOfPoints);
+  solutionVector->Fill(0.0);
+
+  vtkvmtkLinearSystem* linearSystem = vtkvmtkLinearSystem::New();
+  linearSystem->SetA(sparseMatrix);
+  linearSystem->SetB(rhsVector);
+  linearSystem->SetX(solutionVector);
+
+  vtkvmtkOpenNLLinearSystemSolver* solver = vtkvmtkOpenNLLinearSystemSolver::New();
+  solver->SetLinearSystem(linearSystem);
+  solver->SetConvergenceTolerance(1E-10);
+  solver->SetMaximumNumberOfIterations(numberOfPoints);
+  solver->SetSolverTypeToCG();
+  solver->SetPreconditionerTypeToJacobi();
+
+  if (solver->Solve() == -1)
+    {
+    vtkErrorMacro(<<"Cannot compute coefficients: error during linear system solve");
+    }
+
+  for (i=0; i<numberOfPoints; i++)
+    {
+    this->Coefficients->SetValue(i,solutionVector->GetElement(i));
+    }
+
+  solver->Delete();
+  linearSystem->Delete();
+  solutionVector->Delete();
+  rhsVector->Delete();
+  sparseMatrix->Delete();
+}
+
 void vtkvmtkRBFInterpolation::ComputeCoefficients()
 {
   if (this->Coefficients)
@@ -101,6 +338,12 @@ void vtkvmtkRBFInterpolation::ComputeCoefficients()
   this->Coefficients = vtkDoubleArray::New();
   this->Coefficients->SetNumberOfValues(numberOfPoints);
 
+  if (this->RBFType == WENDLAND)
+    {
+    this->ComputeCompactlySupportedCoefficients();
+    return;
+    }
+
   double **A, *x;
   x = new double[numberOfPoints];
   A = new double* [numberOfPoints];
@@ -164,6 +407,16 @@ double vtkvmtkRBFInterpolation::EvaluateFunction(double x[3])
     this->ComputeCoefficients();
     }
 
+  if (!this->Coefficients)
+    {
+    return 0.0;
+    }
+
+  if (this->RBFType == WENDLAND)
+    {
+    return this->EvaluateCompactlySupportedFunction(x) - this->RBFInterpolationValue;
+    }
+
   double rbfValue = 0.0;
   double center[3];
   int i;
@@ -178,6 +431,60 @@ double vtkvmtkRBFInterpolation::EvaluateFunction(double x[3])
   return rbfValue;
 }
 
+class vtkvmtkRBFInterpolationEvaluateFunctor
+{
+public:
+  vtkvmtkRBFInterpolationEvaluateFunctor(vtkvmtkRBFInterpolation* rbf, vtkPoints* points, vtkDoubleArray* values) : RBF(rbf), Points(points), Values(values) {}
+
+  void operator()(vtkIdType begin, vtkIdType end)
+  {
+    double x[3];
+    for (vtkIdType i=begin; i<end; i++)
+      {
+      this->Points->GetPoint(i,x);
+      this->Values->SetValue(i,this->RBF->EvaluateFunction(x));
+      }
+  }
+
+private:
+  vtkvmtkRBFInterpolation* RBF;
+  vtkPoints* Points;
+  vtkDoubleArray* Values;
+};
+
+void vtkvmtkRBFInterpolation::EvaluateFunctionOnPoints(vtkPoints* points, vtkDoubleArray* values)
+{
+  if (!points || !values)
+    {
+    vtkErrorMacro("Points and values must be specified.");
+    return;
+    }
+
+  if (!this->Source || !this->Source->GetNumberOfPoints())
+    {
+    vtkErrorMacro("No Source specified!");
+    return;
+    }
+
+  // coefficients are computed once here, evaluation is then read only
+  if (!this->Coefficients)
+    {
+    this->ComputeCoefficients();
+    }
+
+  values->SetNumberOfComponents(1);
+  values->SetNumberOfTuples(points->GetNumberOfPoints());
+
+  if (!this->Coefficients)
+    {
+    values->FillComponent(0,0.0);
+    return;
+    }
+
+  vtkvmtkRBFInterpolationEvaluateFunctor functor(this,points,values);
+  vtkSMPTools::For(0,points->GetNumberOfPoints(),functor);
+}
+
 void vtkvmtkRBFInterpolation::EvaluateGradient(double x[3], double n[3])
 {
   vtkWarningMacro("RBF gradient computation not implemented.");
@@ -205,4 +512,6 @@ void vtkvmtkRBFInterpolation::PrintSelf(ostream& os, vtkIndent indent)
 {
   this->Superclass::PrintSelf(os,indent);
 
+  os << indent << "RBFType: " << this->RBFType << endl;
+  os << indent << "SupportRadius: " << this->SupportRadius << endl;
 }
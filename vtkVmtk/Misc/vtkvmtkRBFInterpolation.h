@@ -20,7 +20,14 @@ Version:   $Revision: 1.3 $
 =========================================================================*/
   // .NAME vtkvmtkRBFInterpolation - 
   // .SECTION Description
-  // ..
+  // Radial basis function interpolant through the points of Source.
+  // Thin plate spline, biharmonic and triharmonic kernels use a dense
+  // system and sum over all centers at each evaluation. The Wendland kernel
+  // is compactly supported within SupportRadius: its system is sparse and
+  // positive definite, solved by preconditioned conjugate gradients, and
+  // evaluation only visits the centers in the neighboring cells of a
+  // uniform grid with SupportRadius spacing. EvaluateFunction is thread safe
+  // once ComputeCoefficients has been called.
 
 #ifndef __vtkvmtkRBFInterpolation_h
 #define __vtkvmtkRBFInterpolation_h
@@ -31,6 +38,10 @@ Version:   $Revision: 1.3 $
 #include "vtkvmtkWin32Header.h"
 #include "vtkVersion.h"
 
+#include <vector>
+
+class vtkPoints;
+
 class VTK_VMTK_MISC_EXPORT vtkvmtkRBFInterpolation : public vtkImplicitFunction
 {
   public:
@@ -51,6 +62,10 @@ class VTK_VMTK_MISC_EXPORT vtkvmtkRBFInterpolation : public vtkImplicitFunction
 
   void ComputeCoefficients();
 
+  // Description:
+  // Evaluate the function at all the given points, in parallel.
+  void EvaluateFunctionOnPoints(vtkPoints* points, vtkDoubleArray* values);
+
   // Description:
   // Set / get source poly data.
   vtkSetObjectMacro(Source,vtkPolyData);
@@ -64,13 +79,22 @@ class VTK_VMTK_MISC_EXPORT vtkvmtkRBFInterpolation : public vtkImplicitFunction
   { this->SetRBFType(BIHARMONIC); }
   void SetRBFTypeToTriharmonic()
   { this->SetRBFType(TRIHARMONIC); }
+  void SetRBFTypeToWendland()
+  { this->SetRBFType(WENDLAND); }
+
+  // Description:
+  // Support radius of the Wendland kernel. If not positive, a tenth of the
+  // diagonal of the Source bounds is used.
+  vtkSetMacro(SupportRadius,double);
+  vtkGetMacro(SupportRadius,double);
 
 //BTX
   enum 
   {
     THIN_PLATE_SPLINE,
     BIHARMONIC,
-    TRIHARMONIC
+    TRIHARMONIC,
+    WENDLAND
   };
 //ETX
 
@@ -86,8 +110,23 @@ class VTK_VMTK_MISC_EXPORT vtkvmtkRBFInterpolation : public vtkImplicitFunction
 
   double EvaluateRBF(double c[3], double x[3]);
 
+  void BuildCenterGrid();
+  int GetCenterGridRange(const double x[3], int range[6]);
+  double EvaluateCompactlySupportedFunction(double x[3]);
+  void ComputeCompactlySupportedCoefficients();
+
   vtkPolyData* Source;
   int RBFType;
+  double SupportRadius;
+
+  // centers binned on a uniform grid of EffectiveSupportRadius spacing
+  double EffectiveSupportRadius;
+  double CenterGridSpacing;
+  double CenterGridOrigin[3];
+  int CenterGridDimensions[3];
+  std::vector<double> Centers;
+  std::vector<vtkIdType> CenterGridOffsets;
+  std::vector<vtkIdType> CenterGridIds;
 
   vtkDoubleArray* Coefficients;
   double RBFInterpolationValue;
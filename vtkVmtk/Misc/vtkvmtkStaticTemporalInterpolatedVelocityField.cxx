@@ -19,11 +19,18 @@
 #include "vtkGenericCell.h"
 #include "vtkPointData.h"
 #include "vtkDataArray.h"
+#include "vtkDoubleArray.h"
+#include "vtkFloatArray.h"
+#include "vtkAbstractCellLocator.h"
+#include "vtkIdList.h"
 #include "vtkMath.h"
 #include "vtkObjectFactory.h"
 
+#include <algorithm>
+
 vtkStandardNewMacro(vtkvmtkStaticTemporalInterpolatedVelocityField); 
 vtkCxxSetObjectMacro(vtkvmtkStaticTemporalInterpolatedVelocityField, TimeStepsTable, vtkTable);
+vtkCxxSetObjectMacro(vtkvmtkStaticTemporalInterpolatedVelocityField, CellLocator, vtkAbstractCellLocator);
 
 vtkvmtkStaticTemporalInterpolatedVelocityField::vtkvmtkStaticTemporalInterpolatedVelocityField()
 {
@@ -35,6 +42,13 @@ vtkvmtkStaticTemporalInterpolatedVelocityField::vtkvmtkStaticTemporalInterpolate
   this->Component0Prefix = NULL;
   this->Component1Prefix = NULL;
   this->Component2Prefix = NULL;
+  this->CellLocator = NULL;
+  this->MaximumNumberOfWalkSteps = 20;
+  this->WalkFaceIds = vtkIdList::New();
+  this->WalkNeighborIds = vtkIdList::New();
+  this->VelocityArrayCacheDataSet = NULL;
+  this->VelocityArrayCacheNumberOfArrays = 0;
+  this->VelocityArrayCacheUseVectorComponents = 0;
 }
 
 vtkvmtkStaticTemporalInterpolatedVelocityField::~vtkvmtkStaticTemporalInterpolatedVelocityField()
@@ -60,6 +74,10 @@ vtkvmtkStaticTemporalInterpolatedVelocityField::~vtkvmtkStaticTemporalInterpolat
   }
 
   this->SetTimeStepsTable(NULL);
+  this->SetCellLocator(NULL);
+
+  this->WalkFaceIds->Delete();
+  this->WalkNeighborIds->Delete();
 }
 
 #if (VTK_MAJOR_VERSION <= 5)
@@ -104,7 +122,6 @@ void vtkvmtkStaticTemporalInterpolatedVelocityField::SetLastCellId( vtkIdType c,
 
 void vtkvmtkStaticTemporalInterpolatedVelocityField::FindTimeRowId(double time, int& prevRowId, int& nextRowId, double& p)
 {
-  //cout<<"Time "<<time<<endl;
   prevRowId = 0;
   nextRowId = 0;
   p = 0.0;
@@ -112,60 +129,42 @@ void vtkvmtkStaticTemporalInterpolatedVelocityField::FindTimeRowId(double time,
     {
     return;
     }
-  int numberOfRows = this->TimeStepsTable->GetNumberOfRows();
-  if (this->TimeStepsTable->GetNumberOfColumns() < 2 || numberOfRows == 1)
+  int numberOfRows = static_cast<int>(this->TimeStepTimes.size());
+  if (this->TimeStepsTable->GetNumberOfColumns() < 2 || numberOfRows < 2)
     {
     return;
     }
-  int previousRowIndex = this->TimeStepsTable->GetValue(0,0).ToInt();
-  double previousRowTime = this->TimeStepsTable->GetValue(0,1).ToDouble();
-  if (numberOfRows < 2 || previousRowTime == time)
+  double firstRowTime = this->TimeStepTimes[0];
+  if (firstRowTime == time)
     {
     return;
     }
 
   double shiftedTime = time;
 
-  double period = this->TimeStepsTable->GetValue(numberOfRows-1,1).ToDouble() - previousRowTime;
+  double period = this->TimeStepTimes[numberOfRows-1] - firstRowTime;
 
   if (this->Periodic)
     {
-    double ratio = (time - previousRowTime) / period;
-    shiftedTime = (ratio - floor(ratio)) * period + previousRowTime;
+    double ratio = (time - firstRowTime) / period;
+    shiftedTime = (ratio - floor(ratio)) * period + firstRowTime;
     }
 
-  bool found = false;
-  int pRowId = 0;
-  for (int i=1; i<numberOfRows; i++)
-    {
-    int rowId = i;
-    //if (i == numberOfRows)
-    //  {
-    //  rowId = 0;
-    //  }
-    int rowIndex = this->TimeStepsTable->GetValue(rowId,0).ToInt();
-    double rowTime = this->TimeStepsTable->GetValue(rowId,1).ToDouble();
-    if (shiftedTime > previousRowTime && shiftedTime <= rowTime)
-      {
-      prevRowId = pRowId;
-      nextRowId = rowId;
-      p = (shiftedTime - previousRowTime) / (rowTime - previousRowTime);
-      found = true;
-      break;
-      }
-    pRowId = rowId;
-    previousRowIndex = rowIndex;
-    previousRowTime = rowTime;
-    }
+  // first row after the first one whose time is not less than shiftedTime,
+  // the previous row being the one before it (times are increasing)
+  std::vector<double>::const_iterator it = std::lower_bound(this->TimeStepTimes.begin()+1,this->TimeStepTimes.end(),shiftedTime);
 
-  //cout<<"Index "<<prevRowId<<" "<<nextRowId<<endl;
-  if (!found)
+  if (it == this->TimeStepTimes.end() || !(shiftedTime > *(it-1)))
     {
-    //cout<<"Shifted time "<<shiftedTime<<endl;
     prevRowId = numberOfRows - 2;
     nextRowId = numberOfRows - 2;
     p = 1.0;
+    return;
     }
+
+  nextRowId = static_cast<int>(it - this->TimeStepTimes.begin());
+  prevRowId = nextRowId - 1;
+  p = (shiftedTime - this->TimeStepTimes[prevRowId]) / (this->TimeStepTimes[nextRowId] - this->TimeStepTimes[prevRowId]);
 }
 
 void vtkvmtkStaticTemporalInterpolatedVelocityField::BuildArrayName(char* prefix, int index, char* name)
@@ -173,6 +172,136 @@ void vtkvmtkStaticTemporalInterpolatedVelocityField::BuildArrayName(char* prefix
   sprintf(name,"%s%d",prefix,index);
 }
 
+static bool vtkvmtkStaticTemporalPrefixEquals(const std::string& cached, const char* prefix)
+{
+  return prefix ? cached == prefix : cached.empty();
+}
+
+void vtkvmtkStaticTemporalInterpolatedVelocityField::UpdateVelocityArrayCache(vtkDataSet* dataset)
+{
+  char* prefixes[4] = {this->VectorPrefix, this->Component0Prefix, this->Component1Prefix, this->Component2Prefix};
+
+  // the point data MTime includes the MTime of its arrays, so the cache is
+  // also refreshed when a velocity array is modified or reallocated in place
+  bool upToDate = dataset == this->VelocityArrayCacheDataSet &&
+    dataset->GetPointData()->GetNumberOfArrays() == this->VelocityArrayCacheNumberOfArrays &&
+    this->UseVectorComponents == this->VelocityArrayCacheUseVectorComponents &&
+    this->VelocityArrayCacheTime > this->TimeStepsTable->GetMTime() &&
+    this->VelocityArrayCacheTime > dataset->GetPointData()->GetMTime();
+
+  for (int k=0; k<4 && upToDate; k++)
+    {
+    upToDate = vtkvmtkStaticTemporalPrefixEquals(this->VelocityArrayCachePrefixes[k],prefixes[k]);
+    }
+
+  if (upToDate)
+    {
+    return;
+    }
+
+  int numberOfRows = this->TimeStepsTable->GetNumberOfRows();
+  this->TimeStepIndices.resize(numberOfRows);
+  this->TimeStepTimes.resize(numberOfRows);
+  bool hasTimes = this->TimeStepsTable->GetNumberOfColumns() >= 2;
+  int i;
+  for (i=0; i<numberOfRows; i++)
+    {
+    this->TimeStepIndices[i] = this->TimeStepsTable->GetValue(i,0).ToInt();
+    this->TimeStepTimes[i] = hasTimes ? this->TimeStepsTable->GetValue(i,1).ToDouble() : 0.0;
+    }
+
+  char arrayName[1024];
+  this->VelocityArrays.resize(3*numberOfRows);
+  for (i=0; i<numberOfRows; i++)
+    {
+    for (int k=0; k<3; k++)
+      {
+      VelocityArrayType& entry = this->VelocityArrays[3*i+k];
+      entry.Array = NULL;
+      if (this->UseVectorComponents)
+        {
+        if (prefixes[k+1])
+          {
+          this->BuildArrayName(prefixes[k+1],this->TimeStepIndices[i],arrayName);
+          entry.Array = dataset->GetPointData()->GetArray(arrayName);
+          }
+        }
+      else if (k == 0 && this->VectorPrefix)
+        {
+        this->BuildArrayName(this->VectorPrefix,this->TimeStepIndices[i],arrayName);
+        entry.Array = dataset->GetPointData()->GetArray(arrayName);
+        }
+      vtkDoubleArray* doubleArray = vtkDoubleArray::SafeDownCast(entry.Array);
+      vtkFloatArray* floatArray = vtkFloatArray::SafeDownCast(entry.Array);
+      entry.DoublePointer = doubleArray ? doubleArray->GetPointer(0) : NULL;
+      entry.FloatPointer = floatArray ? floatArray->GetPointer(0) : NULL;
+      entry.NumberOfComponents = entry.Array ? entry.Array->GetNumberOfComponents() : 0;
+      }
+    }
+
+  this->VelocityArrayCacheDataSet = dataset;
+  this->VelocityArrayCacheNumberOfArrays = dataset->GetPointData()->GetNumberOfArrays();
+  this->VelocityArrayCacheUseVectorComponents = this->UseVectorComponents;
+  for (int k=0; k<4; k++)
+    {
+    this->VelocityArrayCachePrefixes[k] = prefixes[k] ? prefixes[k] : "";
+    }
+  this->VelocityArrayCacheTime.Modified();
+}
+
+void vtkvmtkStaticTemporalInterpolatedVelocityField::GetCachedVelocity(int rowId, vtkIdType pointId, double* velocity)
+{
+  for (int k=0; k<3; k++)
+    {
+    // components are in three arrays, or in the first array of the row
+    const VelocityArrayType& entry = this->UseVectorComponents ? this->VelocityArrays[3*rowId+k] : this->VelocityArrays[3*rowId];
+    int component = this->UseVectorComponents ? 0 : k;
+    vtkIdType index = entry.NumberOfComponents * pointId + component;
+    if (entry.DoublePointer)
+      {
+      velocity[k] = entry.DoublePointer[index];
+      }
+    else if (entry.FloatPointer)
+      {
+      velocity[k] = static_cast<double>(entry.FloatPointer[index]);
+      }
+    else
+      {
+      velocity[k] = entry.Array->GetComponent(pointId,component);
+      }
+    }
+}
+
+int vtkvmtkStaticTemporalInterpolatedVelocityField::WalkToCell(vtkDataSet* dataset, double* x, int& subId, double& dist2)
+{
+  vtkIdType cellId = this->LastCellId;
+  for (int step=0; step<this->MaximumNumberOfWalkSteps; step++)
+    {
+    // LastPCoords holds the parametric coordinates of x in the current
+    // cell, which select the face to cross
+    this->GenCell->CellBoundary(subId,this->LastPCoords,this->WalkFaceIds);
+    dataset->GetCellNeighbors(cellId,this->WalkFaceIds,this->WalkNeighborIds);
+    if (this->WalkNeighborIds->GetNumberOfIds() != 1)
+      {
+      // boundary face (or non-manifold)
+      return 0;
+      }
+    cellId = this->WalkNeighborIds->GetId(0);
+    dataset->GetCell(cellId,this->GenCell);
+    int ret = this->GenCell->EvaluatePosition(x,0,subId,this->LastPCoords,dist2,this->Weights);
+    if (ret == 1)
+      {
+      this->LastCellId = cellId;
+      return 1;
+      }
+    if (ret == -1)
+      {
+      return 0;
+      }
+    }
+  return 0;
+}
+
 #if (VTK_MAJOR_VERSION <= 5)
 int vtkvmtkStaticTemporalInterpolatedVelocityField::FunctionValues( double * x, double * f )
 {
@@ -221,18 +350,9 @@ int vtkvmtkStaticTemporalInterpolatedVelocityField::FunctionValues( double * x,
 int vtkvmtkStaticTemporalInterpolatedVelocityField::FunctionValues( vtkDataSet * dataset, double * x, double * f )
 {
   int i, j, subId , numPts, id;
-  vtkDataArray * vectorsPrev = NULL;
-  vtkDataArray * vectorsNext = NULL;
-  vtkDataArray * component0Prev = NULL;
-  vtkDataArray * component0Next = NULL;
-  vtkDataArray * component1Prev = NULL;
-  vtkDataArray * component1Next = NULL;
-  vtkDataArray * component2Prev = NULL;
-  vtkDataArray * component2Next = NULL;
   double vecPrev[3], vecNext[3];
   double dist2;
-  int ret;
-  char arrayName[1024];
+  int ret = 0;
   
   f[0] = f[1] = f[2] = 0.0;
 
@@ -243,62 +363,33 @@ int vtkvmtkStaticTemporalInterpolatedVelocityField::FunctionValues( vtkDataSet *
     return 0;
     }
 
+  if ( !this->TimeStepsTable || this->TimeStepsTable->GetNumberOfRows() == 0 )
+    {
+    vtkErrorMacro( << "No time steps table specified." );
+    return 0;
+    }
+
+  this->UpdateVelocityArrayCache(dataset);
+
   double time = x[3];
 
   int prevRowId, nextRowId;
   double timeP;
   this->FindTimeRowId(time,prevRowId,nextRowId,timeP);
 
-  int prevTimeIndex = this->TimeStepsTable->GetValue(prevRowId,0).ToInt();
-  int nextTimeIndex = this->TimeStepsTable->GetValue(nextRowId,0).ToInt();
-
-  if (this->UseVectorComponents)
+  int numberOfArraysPerRow = this->UseVectorComponents ? 3 : 1;
+  for (i=0; i<numberOfArraysPerRow; i++)
     {
-    this->BuildArrayName(this->Component0Prefix,prevTimeIndex,arrayName);
-    component0Prev = dataset->GetPointData()->GetArray(arrayName);
-    this->BuildArrayName(this->Component1Prefix,prevTimeIndex,arrayName);
-    component1Prev = dataset->GetPointData()->GetArray(arrayName);
-    this->BuildArrayName(this->Component2Prefix,prevTimeIndex,arrayName);
-    component2Prev = dataset->GetPointData()->GetArray(arrayName);
-
-    if (!component0Prev || !component1Prev || !component2Prev)
+    if (!this->VelocityArrays[3*prevRowId+i].Array)
       {
-      vtkErrorMacro(<<"Component array not found for index "<<prevTimeIndex);
+      vtkErrorMacro(<<"Velocity array not found for index "<<this->TimeStepIndices[prevRowId]);
       return 0;
-      } 
-
-    this->BuildArrayName(this->Component0Prefix,nextTimeIndex,arrayName);
-    component0Next = dataset->GetPointData()->GetArray(arrayName);
-    this->BuildArrayName(this->Component1Prefix,nextTimeIndex,arrayName);
-    component1Next = dataset->GetPointData()->GetArray(arrayName);
-    this->BuildArrayName(this->Component2Prefix,nextTimeIndex,arrayName);
-    component2Next = dataset->GetPointData()->GetArray(arrayName);
-
-    if (timeP > 0.0 && (!component0Next || !component1Next || !component2Next))
-      {
-      vtkErrorMacro(<<"Component array not found for index "<<nextTimeIndex);
-      return 0;
-      } 
-    }
-  else
-    {
-    this->BuildArrayName(this->VectorPrefix,prevTimeIndex,arrayName);
-    vectorsPrev = dataset->GetPointData()->GetArray(arrayName);
-
-    if (timeP > 0.0 && !vectorsPrev)
-      {
-      vtkErrorMacro(<<"Vector array not found for index "<<prevTimeIndex);
-      return 0;
-      } 
-
-    this->BuildArrayName(this->VectorPrefix,nextTimeIndex,arrayName);
-    vectorsNext = dataset->GetPointData()->GetArray(arrayName);
-
-    if (!vectorsNext)
+      }
+    if (timeP > 0.0 && !this->VelocityArrays[3*nextRowId+i].Array)
       {
-      vtkErrorMacro(<<"Vector array not found for index "<<nextTimeIndex);
+      vtkErrorMacro(<<"Velocity array not found for index "<<this->TimeStepIndices[nextRowId]);
       return 0;
-      } 
+      }
     }
 
   double tol2 = dataset->GetLength() * 
@@ -316,22 +407,29 @@ int vtkvmtkStaticTemporalInterpolatedVelocityField::FunctionValues( vtkDataSet *
         || ret == -1
        )
       {
-      // if not, find and get it
+      // if not, walk towards it from the cached cell, then find it
       if ( this->LastCellId != - 1 )
         {
         this->CacheMiss ++;
 
-        dataset->GetCell( this->LastCellId, this->Cell );
-        
-        this->LastCellId = 
-          dataset->FindCell( x, this->Cell, this->GenCell, this->LastCellId, 
-                             tol2, subId, this->LastPCoords, this->Weights );
-                             
-        if ( this->LastCellId != -1 )
+        if ( ret == 0 && this->WalkToCell( dataset, x, subId, dist2 ) )
           {
-          dataset->GetCell( this->LastCellId, this->GenCell );
           found = 1;
           }
+        else if ( !this->CellLocator || this->CellLocator->GetDataSet() != dataset )
+          {
+          dataset->GetCell( this->LastCellId, this->Cell );
+        
+          this->LastCellId = 
+            dataset->FindCell( x, this->Cell, this->GenCell, this->LastCellId, 
+                               tol2, subId, this->LastPCoords, this->Weights );
+                             
+          if ( this->LastCellId != -1 )
+            {
+            dataset->GetCell( this->LastCellId, this->GenCell );
+            found = 1;
+            }
+          }
         }
       }
     else
@@ -345,9 +443,18 @@ int vtkvmtkStaticTemporalInterpolatedVelocityField::FunctionValues( vtkDataSet *
     {
     // if the cell is not found, do a global search (ignore initial
     // cell if there is one)
-    this->LastCellId = 
-      dataset->FindCell( x, 0, this->GenCell, -1, tol2, 
-                         subId, this->LastPCoords, this->Weights );
+    if ( this->CellLocator && this->CellLocator->GetDataSet() == dataset )
+      {
+      this->LastCellId = 
+        this->CellLocator->FindCell( x, tol2, this->GenCell, 
+                                     this->LastPCoords, this->Weights );
+      }
+    else
+      {
+      this->LastCellId = 
+        dataset->FindCell( x, 0, this->GenCell, -1, tol2, 
+                           subId, this->LastPCoords, this->Weights );
+      }
                          
     if ( this->LastCellId != -1 )
       {
@@ -368,37 +475,10 @@ int vtkvmtkStaticTemporalInterpolatedVelocityField::FunctionValues( vtkDataSet *
     for ( j = 0; j < numPts; j ++ )
       {
       id = this->GenCell->PointIds->GetId( j );
-      if (this->UseVectorComponents)
-        {
-        vecPrev[0] = this->VelocityScale * component0Prev->GetTuple1(id);
-        vecPrev[1] = this->VelocityScale * component1Prev->GetTuple1(id);
-        vecPrev[2] = this->VelocityScale * component2Prev->GetTuple1(id);
-
-        if (timeP > 0.0)
-          {
-          vecNext[0] = this->VelocityScale * component0Next->GetTuple1(id);
-          vecNext[1] = this->VelocityScale * component1Next->GetTuple1(id);
-          vecNext[2] = this->VelocityScale * component2Next->GetTuple1(id);
-          }
-        }
-      else
-        {
-        vectorsPrev->GetTuple( id, vecPrev );
-        for ( i = 0; i < 3; i ++ )
-          {
-          vecPrev[i] *= this->VelocityScale;
-          }
-        if (timeP > 0.0)
-          {
-          vectorsNext->GetTuple( id, vecNext );
-          for ( i = 0; i < 3; i ++ )
-            {
-            vecNext[i] *= this->VelocityScale;
-            }
-          }
-        }
+      this->GetCachedVelocity( prevRowId, id, vecPrev );
       if (timeP > 0.0)
         {
+        this->GetCachedVelocity( nextRowId, id, vecNext );
         for ( i = 0; i < 3; i ++ )
           {
           f[i] +=  (timeP * vecNext[i] + (1.0 - timeP) * vecPrev[i]) * this->Weights[j];
@@ -412,6 +492,11 @@ int vtkvmtkStaticTemporalInterpolatedVelocityField::FunctionValues( vtkDataSet *
           }
         }
       }
+
+    for ( i = 0; i < 3; i ++ )
+      {
+      f[i] *= this->VelocityScale;
+      }
       
     if ( this->NormalizeVector == true )
       {
@@ -446,6 +531,8 @@ void vtkvmtkStaticTemporalInterpolatedVelocityField::CopyParameters( vtkAbstract
     this->SetComponent0Prefix(fromCast->Component0Prefix);
     this->SetComponent1Prefix(fromCast->Component1Prefix);
     this->SetComponent2Prefix(fromCast->Component2Prefix);
+    this->SetCellLocator(fromCast->GetCellLocator());
+    this->SetMaximumNumberOfWalkSteps(fromCast->GetMaximumNumberOfWalkSteps());
     timeStepsTable->Delete();
     }
 }
@@ -453,4 +540,6 @@ void vtkvmtkStaticTemporalInterpolatedVelocityField::CopyParameters( vtkAbstract
 void vtkvmtkStaticTemporalInterpolatedVelocityField::PrintSelf( ostream & os, vtkIndent indent )
 {
   this->Superclass::PrintSelf( os, indent );
+
+  os << indent << "Maximum number of walk steps: " << this->MaximumNumberOfWalkSteps << endl;
 }
@@ -31,6 +31,18 @@ Language:  C++
 =========================================================================*/
 // .NAME vtkvmtkStaticTemporalInterpolatedVelocityField - A concrete class for obtaining
 //  the interpolated velocity values at a point.
+// .SECTION Description
+// Velocity is interpolated in time between the point data arrays of the
+// two time steps in TimeStepsTable bracketing the requested time. Arrays
+// and time steps are resolved once per dataset and cached, so evaluation
+// does not go through named array lookups.
+// When the point leaves the cached cell, the cell containing it is first
+// searched by walking across faces from the cached cell (at most
+// MaximumNumberOfWalkSteps steps), then using CellLocator if one is set for
+// the dataset, and finally using vtkDataSet::FindCell. CellLocator is passed
+// on by CopyParameters, so a single prebuilt locator is shared among copies
+// of the interpolator. When copies are used from multiple threads, the cell
+// links of the dataset must be built beforehand for walking.
 //
 
 
@@ -46,7 +58,12 @@ Language:  C++
 #include "vtkInterpolatedVelocityField.h"
 #endif
 
+#include <vector>
+#include <string>
+
 class vtkTable;
+class vtkAbstractCellLocator;
+class vtkIdList;
 #if (VTK_MAJOR_VERSION > 5)
 class vtkAbstractInterpolatedVelocityFieldDataSetsType;
 #endif
@@ -109,6 +126,18 @@ public:
   vtkSetStringMacro(Component2Prefix);
   vtkGetStringMacro(Component2Prefix);
 
+  // Description:
+  // Prebuilt cell locator used when the point is not found by walking from
+  // the cached cell. Only used for the dataset the locator was built on.
+  virtual void SetCellLocator(vtkAbstractCellLocator*);
+  vtkGetObjectMacro(CellLocator, vtkAbstractCellLocator);
+
+  // Description:
+  // Maximum number of neighbour cells visited when walking from the cached
+  // cell towards the point. Zero disables walking.
+  vtkSetMacro(MaximumNumberOfWalkSteps, int);
+  vtkGetMacro(MaximumNumberOfWalkSteps, int);
+
 #if (VTK_MAJOR_VERSION <= 5)
   // Description:
   // Evaluate the velocity field f at point (x, y, z, t).
@@ -142,6 +171,20 @@ protected:
 
   void BuildArrayName(char* prefix, int index, char* name);
 
+  // Description:
+  // Resolve the time steps and the velocity arrays of each time step for
+  // dataset, unless already cached.
+  void UpdateVelocityArrayCache(vtkDataSet* dataset);
+
+  // Description:
+  // Velocity of pointId at time step rowId (not scaled).
+  void GetCachedVelocity(int rowId, vtkIdType pointId, double* velocity);
+
+  // Description:
+  // Walk across faces from the cached cell towards x. Returns 1 if the
+  // containing cell is found, in which case it is loaded in GenCell.
+  int WalkToCell(vtkDataSet* dataset, double* x, int& subId, double& dist2);
+
   vtkTable* TimeStepsTable;
 
   int Periodic;
@@ -158,6 +201,31 @@ protected:
   int LastDataSetIndex;
 #endif
 
+  vtkAbstractCellLocator* CellLocator;
+  int MaximumNumberOfWalkSteps;
+
+  vtkIdList* WalkFaceIds;
+  vtkIdList* WalkNeighborIds;
+
+  struct VelocityArrayType
+  {
+    vtkDataArray* Array;
+    const double* DoublePointer;
+    const float* FloatPointer;
+    int NumberOfComponents;
+  };
+
+  // time step indices and times, one per row of TimeStepsTable
+  std::vector<int> TimeStepIndices;
+  std::vector<double> TimeStepTimes;
+  // three entries per row, only the first is used for vector arrays
+  std::vector<VelocityArrayType> VelocityArrays;
+  vtkDataSet* VelocityArrayCacheDataSet;
+  int VelocityArrayCacheNumberOfArrays;
+  int VelocityArrayCacheUseVectorComponents;
+  std::string VelocityArrayCachePrefixes[4];
+  vtkTimeStamp VelocityArrayCacheTime;
+
 private:
   vtkvmtkStaticTemporalInterpolatedVelocityField
     ( const vtkvmtkStaticTemporalInterpolatedVelocityField & );  // Not implemented.
@@ -25,17 +25,31 @@ PURPOSE.  See the above copyright notice for more information.
 #include "vtkInformationVector.h"
 #include "vtkMath.h"
 #include "vtkObjectFactory.h"
+#include "vtkInitialValueProblemSolver.h"
+#include "vtkIntArray.h"
 #include "vtkPointData.h"
+#include "vtkPointSet.h"
+#include "vtkPolyData.h"
+#include "vtkUnstructuredGrid.h"
 #include "vtkSmartPointer.h"
+#include "vtkSMPTools.h"
+#include "vtkSMPThreadLocal.h"
 #include "vtkVersion.h"
 #if (VTK_MAJOR_VERSION > 5)
 #include "vtkInterpolatedVelocityField.h"
 #endif
+#if VTK_MAJOR_VERSION > 8 || (VTK_MAJOR_VERSION == 8 && VTK_MINOR_VERSION >= 1)
+#include "vtkStaticCellLocator.h"
+#else
+#include "vtkCellLocator.h"
+#endif
 
 #include "vtkvmtkStaticTemporalInterpolatedVelocityField.h"
 
 #include "vtkTable.h"
 
+#include <vector>
+
 vtkStandardNewMacro(vtkvmtkStaticTemporalStreamTracer);
 vtkCxxSetObjectMacro(vtkvmtkStaticTemporalStreamTracer, TimeStepsTable, vtkTable);
 
@@ -51,6 +65,9 @@ vtkvmtkStaticTemporalStreamTracer::vtkvmtkStaticTemporalStreamTracer()
   this->Component0Prefix = NULL;
   this->Component1Prefix = NULL;
   this->Component2Prefix = NULL;
+  this->UseCellLocator = 1;
+  this->ParallelIntegration = 1;
+  this->SeedChunkSize = 16;
 }
 
 vtkvmtkStaticTemporalStreamTracer::~vtkvmtkStaticTemporalStreamTracer()
@@ -151,15 +168,6 @@ int vtkvmtkStaticTemporalStreamTracer::CheckInputs(vtkAbstractInterpolatedVeloci
   if ( !this->InterpolatorPrototype )
     {
     func = vtkvmtkStaticTemporalInterpolatedVelocityField::New();
-
-    // turn on the following segment, in place of the above line, if an
-    // interpolator equipped with a cell locator is dedired as the default
-    //
-    // func = vtkCellLocatorInterpolatedVelocityField::New();
-    // vtkSmartPointer< vtkModifiedBSPTree > locator =
-    // vtkSmartPointer< vtkModifiedBSPTree >::New();
-    // vtkCellLocatorInterpolatedVelocityField::SafeDownCast( func )
-    //   ->SetCellLocatorPrototype( locator.GetPointer() );
     }
   else
     {
@@ -277,6 +285,54 @@ int vtkvmtkStaticTemporalStreamTracer::RequestData(
       input0 = vtkDataSet::SafeDownCast(iterP->GetCurrentDataObject());
       }
 
+    // Build the cell links used for walking and a cell locator shared by
+    // all interpolators once, instead of searching from scratch on misses
+    vtkAbstractCellLocator* cellLocator = NULL;
+    vtkvmtkStaticTemporalInterpolatedVelocityField* staticTemporalFunc = vtkvmtkStaticTemporalInterpolatedVelocityField::SafeDownCast(func);
+    if (staticTemporalFunc && vtkPointSet::SafeDownCast(input0))
+      {
+      if (vtkUnstructuredGrid::SafeDownCast(input0))
+        {
+        vtkUnstructuredGrid::SafeDownCast(input0)->BuildLinks();
+        }
+      else if (vtkPolyData::SafeDownCast(input0))
+        {
+        vtkPolyData::SafeDownCast(input0)->BuildLinks();
+        }
+      if (this->UseCellLocator)
+        {
+#if VTK_MAJOR_VERSION > 8 || (VTK_MAJOR_VERSION == 8 && VTK_MINOR_VERSION >= 1)
+        cellLocator = vtkStaticCellLocator::New();
+#else
+        cellLocator = vtkCellLocator::New();
+#endif
+        cellLocator->SetDataSet(input0);
+        cellLocator->BuildLocator();
+        staticTemporalFunc->SetCellLocator(cellLocator);
+        }
+      }
+
+    // Seeds are integrated in parallel when the interpolators can share the
+    // prebuilt locator, which requires a single input dataset and a
+    // thread-safe locator
+    vtkAbstractCellLocator* parallelCellLocator = NULL;
+#if VTK_MAJOR_VERSION > 8 || (VTK_MAJOR_VERSION == 8 && VTK_MINOR_VERSION >= 1)
+    int numberOfInputs = 0;
+    for (iterP->GoToFirstItem(); !iterP->IsDoneWithTraversal(); iterP->GoToNextItem())
+      {
+      if (vtkDataSet::SafeDownCast(iterP->GetCurrentDataObject()))
+        {
+        numberOfInputs++;
+        }
+      }
+    if (this->ParallelIntegration && cellLocator && numberOfInputs == 1)
+      {
+      // make sure bounds are computed before threads query them
+      input0->GetLength();
+      parallelCellLocator = cellLocator;
+      }
+#endif
+
     double propagation = 0;
     vtkIdType numSteps = 0;
     this->Integrate(input0, output,
@@ -284,8 +340,14 @@ int vtkvmtkStaticTemporalStreamTracer::RequestData(
                     startTimes,
                     integrationDirections,
                     lastPoint, func,
+                    parallelCellLocator,
                     maxCellSize,
                     propagation, numSteps);
+    if (cellLocator)
+      {
+      staticTemporalFunc->SetCellLocator(NULL);
+      cellLocator->Delete();
+      }
     func->Delete();
     seeds->Delete();
     }
@@ -298,476 +360,665 @@ int vtkvmtkStaticTemporalStreamTracer::RequestData(
   return 1;
 }
 
-void vtkvmtkStaticTemporalStreamTracer::Integrate(vtkDataSet *input0,
-                                                  vtkPolyData* output,
-                                                  vtkDataArray* seedSource,
-                                                  vtkIdList* seedIds,
-                                                  vtkDoubleArray* startTimes,
-                                                  vtkIntArray* integrationDirections,
-                                                  double lastPoint[3],
-                                                  vtkAbstractInterpolatedVelocityField* func,
-                                                  int maxCellSize,
-                                                  double& inPropagation,
-                                                  vtkIdType& inNumSteps)
+// Points and point attributes of the trace of one seed, merged into the
+// output in seed order once all seeds are integrated.
+class vtkvmtkStaticTemporalStreamLine
 {
-  int i;
-  vtkIdType numLines = seedIds->GetNumberOfIds();
-  double propagation = inPropagation;
-  vtkIdType numSteps = inNumSteps;
+public:
+  vtkvmtkStaticTemporalStreamLine()
+  {
+    this->ReasonForTermination = 0;
+    this->HasLastPoint = 0;
+    this->LastPoint[0] = this->LastPoint[1] = this->LastPoint[2] = 0.0;
+    this->HasLastUsedStepSize = 0;
+    this->LastUsedStepSize = 0.0;
+    this->Propagation = 0.0;
+    this->NumberOfSteps = 0;
+  }
 
-  // Useful pointers
-  vtkDataSetAttributes* outputPD = output->GetPointData();
-  vtkDataSetAttributes* outputCD = output->GetCellData();
-  vtkPointData* inputPD;
-  vtkDataSet* input;
-  //TODO: this one will potentially change at every evaluation.
+  vtkIdType GetNumberOfPoints() const
+  {
+    return static_cast<vtkIdType>(this->Times.size());
+  }
 
-  int direction=1;
+  std::vector<double> Points;
+  std::vector<double> Times;
+  std::vector<double> Velocities;
+  std::vector<double> Speeds;
+  std::vector<double> Vorticities;
+  std::vector<double> Rotations;
+  std::vector<double> AngularVelocities;
+  int ReasonForTermination;
+  int HasLastPoint;
+  double LastPoint[3];
+  int HasLastUsedStepSize;
+  double LastUsedStepSize;
+  double Propagation;
+  vtkIdType NumberOfSteps;
+};
+
+class vtkvmtkStaticTemporalStreamTracerThreadData
+{
+public:
+  vtkvmtkStaticTemporalStreamTracerThreadData() : Function(NULL), Integrator(NULL), Cell(NULL), Weights(NULL) {}
 
-  double* weights = 0;
-  if ( maxCellSize > 0 )
-    {
-    weights = new double[maxCellSize];
-    }
+  vtkAbstractInterpolatedVelocityField* Function;
+  vtkInitialValueProblemSolver* Integrator;
+  vtkGenericCell* Cell;
+  double* Weights;
+};
 
-  if (this->GetIntegrator() == 0)
-    {
-    vtkErrorMacro("No integrator is specified.");
-    return;
-    }
+class vtkvmtkStaticTemporalStreamTracerIntegrateFunctor
+{
+public:
+  vtkvmtkStaticTemporalStreamTracerIntegrateFunctor(vtkvmtkStaticTemporalStreamTracer* tracer, vtkDataSet* input, vtkAbstractInterpolatedVelocityField* func, int maxCellSize, vtkDataArray* seedSource, vtkIdList* seedIds, vtkDoubleArray* startTimes, vtkIntArray* integrationDirections, std::vector<vtkvmtkStaticTemporalStreamLine>& lines) :
+    Tracer(tracer), Input(input), Function(func), MaxCellSize(maxCellSize), SeedSource(seedSource), SeedIds(seedIds), StartTimes(startTimes), IntegrationDirections(integrationDirections), Lines(lines), Aborted(0) {}
+
+  ~vtkvmtkStaticTemporalStreamTracerIntegrateFunctor()
+  {
+    vtkSMPThreadLocal<vtkvmtkStaticTemporalStreamTracerThreadData>::iterator it;
+    for (it = this->ThreadData.begin(); it != this->ThreadData.end(); ++it)
+      {
+      (*it).Function->Delete();
+      (*it).Integrator->Delete();
+      (*it).Cell->Delete();
+      delete[] (*it).Weights;
+      }
+  }
 
-  // Used in GetCell()
-  vtkGenericCell* cell = vtkGenericCell::New();
+  void Initialize()
+  {
+    // each thread integrates with its own copy of the interpolator, which
+    // keeps the cached cell and weights; the prebuilt locator is passed on
+    // by CopyParameters and shared
+    vtkvmtkStaticTemporalStreamTracerThreadData& data = this->ThreadData.Local();
+    data.Function = this->Function->NewInstance();
+    data.Function->CopyParameters(this->Function);
+#if (VTK_MAJOR_VERSION <= 5)
+    vtkAbstractInterpolatedVelocityField* function = vtkAbstractInterpolatedVelocityField::SafeDownCast(data.Function);
+#else
+    vtkInterpolatedVelocityField* function = vtkInterpolatedVelocityField::SafeDownCast(data.Function);
+#endif
+    function->AddDataSet(this->Input);
+    data.Integrator = this->Tracer->GetIntegrator()->NewInstance();
+    data.Integrator->SetFunctionSet(data.Function);
+    data.Cell = vtkGenericCell::New();
+    data.Weights = new double[this->MaxCellSize > 0 ? this->MaxCellSize : 1];
+    this->LocalAborted.Local() = 0;
+  }
 
-  // Create a new integrator, the type is the same as Integrator
-  vtkInitialValueProblemSolver* integrator =
-    this->GetIntegrator()->NewInstance();
-  integrator->SetFunctionSet(func);
+  void operator()(vtkIdType begin, vtkIdType end)
+  {
+    vtkvmtkStaticTemporalStreamTracerThreadData& data = this->ThreadData.Local();
+    // each thread only writes its own flag, flags are combined in Reduce
+    int& aborted = this->LocalAborted.Local();
+    vtkIdType numLines = this->SeedIds->GetNumberOfIds();
+    for (vtkIdType currentLine=begin; currentLine<end; currentLine++)
+      {
+      if (aborted || this->Tracer->GetAbortExecute())
+        {
+        aborted = 1;
+        return;
+        }
+      if (!this->Tracer->IntegrateLine(currentLine,numLines,this->SeedSource,this->SeedIds,this->StartTimes,this->IntegrationDirections,data.Function,data.Integrator,data.Cell,data.Weights,0,this->Lines[currentLine]))
+        {
+        aborted = 1;
+        return;
+        }
+      }
+  }
 
-  // Since we do not know what the total number of points
-  // will be, we do not allocate any. This is important for
-  // cases where a lot of streamers are used at once. If we
-  // were to allocate any points here, potentially, we can
-  // waste a lot of memory if a lot of streamers are used.
-  // Always insert the first point
-  vtkPoints* outputPoints = vtkPoints::New();
-  vtkCellArray* outputLines = vtkCellArray::New();
+  void Reduce()
+  {
+    vtkSMPThreadLocal<int>::iterator it;
+    for (it = this->LocalAborted.begin(); it != this->LocalAborted.end(); ++it)
+      {
+      if (*it)
+        {
+        this->Aborted = 1;
+        }
+      }
+  }
 
-  // We will keep track of integration time in this array
-  vtkDoubleArray* time = vtkDoubleArray::New();
-  time->SetName("IntegrationTime");
+  int GetAborted() const
+  {
+    return this->Aborted;
+  }
 
-  // This array explains why the integration stopped
-  vtkIntArray* retVals = vtkIntArray::New();
-  retVals->SetName("ReasonForTermination");
+private:
+  vtkvmtkStaticTemporalStreamTracer* Tracer;
+  vtkDataSet* Input;
+  vtkAbstractInterpolatedVelocityField* Function;
+  int MaxCellSize;
+  vtkDataArray* SeedSource;
+  vtkIdList* SeedIds;
+  vtkDoubleArray* StartTimes;
+  vtkIntArray* IntegrationDirections;
+  std::vector<vtkvmtkStaticTemporalStreamLine>& Lines;
+  int Aborted;
+  vtkSMPThreadLocal<int> LocalAborted;
+  vtkSMPThreadLocal<vtkvmtkStaticTemporalStreamTracerThreadData> ThreadData;
+};
+
+int vtkvmtkStaticTemporalStreamTracer::IntegrateLine(vtkIdType currentLine,
+                                                     vtkIdType numLines,
+                                                     vtkDataArray* seedSource,
+                                                     vtkIdList* seedIds,
+                                                     vtkDoubleArray* startTimes,
+                                                     vtkIntArray* integrationDirections,
+                                                     vtkAbstractInterpolatedVelocityField* func,
+                                                     vtkInitialValueProblemSolver* integrator,
+                                                     vtkGenericCell* cell,
+                                                     double* weights,
+                                                     int reportProgress,
+                                                     vtkvmtkStaticTemporalStreamLine& line)
+{
+  int i;
+  double propagation = 0.0;
+  vtkIdType numSteps = 0;
+  double velocity[3];
+  double progress;
+  vtkDataSet* input;
 
-  vtkDoubleArray* cellVectors = 0;
-  vtkDoubleArray* velocityArray = 0;
-  vtkDoubleArray* speedArray = 0;
-  vtkDoubleArray* vorticity = 0;
-  vtkDoubleArray* rotation = 0;
-  vtkDoubleArray* angularVel = 0;
+  int direction=1;
+  switch (integrationDirections->GetValue(currentLine))
+    {
+    case FORWARD:
+      direction = 1;
+      break;
+    case BACKWARD:
+      direction = -1;
+      break;
+    }
 
-  velocityArray = vtkDoubleArray::New();
-  velocityArray->SetName("Velocity");
-  velocityArray->SetNumberOfComponents(3);
+  // temporary variables used in the integration
+  double point1[3], point2[3], pcoords[3], vort[3], omega;
 
-  speedArray = vtkDoubleArray::New();
-  speedArray->SetName("Speed");
+  // Clear the last cell to avoid starting a search from
+  // the last point in the streamline
+  func->ClearLastCellId();
 
-  if (this->ComputeVorticity)
-    {
-    cellVectors = vtkDoubleArray::New();
-    cellVectors->SetNumberOfComponents(3);
-    cellVectors->Allocate(3*VTK_CELL_SIZE);
+  double startTime = startTimes->GetValue(currentLine);
 
-    vorticity = vtkDoubleArray::New();
-    vorticity->SetName("Vorticity");
-    vorticity->SetNumberOfComponents(3);
+  // Initial point
+  seedSource->GetTuple(seedIds->GetId(currentLine), point1);
+  memcpy(point2, point1, 3*sizeof(double));
 
-    rotation = vtkDoubleArray::New();
-    rotation->SetName("Rotation");
+  double point1t[4];
+  memcpy(point1t, point1, 3*sizeof(double)); 
+  point1t[3] = startTime;
 
-    angularVel = vtkDoubleArray::New();
-    angularVel->SetName("AngularVelocity");
+  if (!func->FunctionValues(point1t, velocity))
+    {
+    return 1;
     }
 
-  // We will interpolate all point attributes of the input on each point of
-  // the output (unless they are turned off). Note that we are using only
-  // the first input, if there are more than one, the attributes have to match.
-  //
-  // Note: We have to use a specific value (safe to employ the maximum number
-  //       of steps) as the size of the initial memory allocation here. The
-  //       use of the default argument might incur a crash problem (due to
-  //       "insufficient memory") in the parallel mode. This is the case when
-  //       a streamline intensely shuttles between two processes in an exactly
-  //       interleaving fashion --- only one point is produced on each process
-  //       (and actually two points, after point duplication, are saved to a
-  //       vtkPolyData in vtkDistributedStreamTracer::NoBlockProcessTask) and
-  //       as a consequence a large number of such small vtkPolyData objects
-  //       are needed to represent a streamline, consuming up the memory before
-  //       the intermediate memory is timely released.
-
-  // TODO: this one should be avoided - or at least we should interpolate all vectors that are not in the list of temporal vector fields
-  //outputPD->InterpolateAllocate( input0->GetPointData(),
-  //                               this->MaximumNumberOfSteps );
-
-  vtkIdType numPtsTotal=0;
-  double velocity[3];
-
-  int shouldAbort = 0;
+  if ( propagation >= this->MaximumPropagation ||
+       numSteps    >  this->MaximumNumberOfSteps)
+    {
+    return 1;
+    }
 
-  for(int currentLine = 0; currentLine < numLines; currentLine++)
+  line.Points.insert(line.Points.end(), point1, point1+3);
+  line.Times.push_back(startTime);
+
+  // We will always pass an arc-length step size to the integrator.
+  // If the user specifies a step size in cell length unit, we will
+  // have to convert it to arc length.
+  IntervalInformation stepSize;  // either positive or negative
+  stepSize.Unit  = LENGTH_UNIT;
+  stepSize.Interval = 0;
+  IntervalInformation aStep; // always positive
+  aStep.Unit = LENGTH_UNIT;
+  double step, minStep=0, maxStep=0;
+  double stepTaken, accumTime=startTime;
+  double speed;
+  double cellLength;
+  int retVal=OUT_OF_LENGTH, tmp;
+
+  // Make sure we use the dataset found by the vtkAbstractInterpolatedVelocityField
+  input = func->GetLastDataSet();
+
+  // Convert intervals to arc-length unit
+  input->GetCell(func->GetLastCellId(), cell);
+  cellLength = sqrt(static_cast<double>(cell->GetLength2()));
+  speed = vtkMath::Norm(velocity);
+  // Never call conversion methods if speed == 0
+  if ( speed != 0.0 )
     {
-    double progress = static_cast<double>(currentLine)/numLines;
-    this->UpdateProgress(progress);
+    this->ConvertIntervals( stepSize.Interval, minStep, maxStep,
+                            direction, cellLength );
+    }
+
+  // Interpolate all point attributes on first point
+  func->GetLastWeights(weights);
+  //TODO: avoid this at least for time vectors
+  //outputPD->InterpolatePoint(inputPD, nextPoint, cell->PointIds, weights);
 
-    switch (integrationDirections->GetValue(currentLine))
+  line.Velocities.insert(line.Velocities.end(), velocity, velocity+3);
+  line.Speeds.push_back(speed);
+
+  // Compute vorticity if required
+  // This can be used later for streamribbon generation.
+  if (this->ComputeVorticity)
+    {
+    //TODO: for vorticity to work, inVectors should be updated with the vector field at the correct time step
+    //inVectors->GetTuples(cell->PointIds, cellVectors);
+    func->GetLastLocalCoordinates(pcoords);
+    vort[0] = vort[1] = vort[2] = 0.0;
+    //vtkStreamTracer::CalculateVorticity(cell, pcoords, cellVectors, vort);
+    line.Vorticities.insert(line.Vorticities.end(), vort, vort+3);
+    // rotation
+    // local rotation = vorticity . unit tangent ( i.e. velocity/speed )
+    if (speed != 0.0)
       {
-      case FORWARD:
-        direction = 1;
-        break;
-      case BACKWARD:
-        direction = -1;
-        break;
+      omega = vtkMath::Dot(vort, velocity);
+      omega /= speed;
+      omega *= this->RotationScale;
       }
+    else
+      {
+      omega = 0.0;
+      }
+    line.AngularVelocities.push_back(omega);
+    line.Rotations.push_back(0.0);
+    }
 
-    // temporary variables used in the integration
-    double point1[3], point2[3], pcoords[3], vort[3], omega;
-    vtkIdType index, numPts=0;
+  double error = 0;
+  // Integrate until the maximum propagation length is reached,
+  // maximum number of steps is reached or until a boundary is encountered.
+  // Begin Integration
+  while ( propagation < this->MaximumPropagation )
+    {
 
-    // Clear the last cell to avoid starting a search from
-    // the last point in the streamline
-    func->ClearLastCellId();
+    if (numSteps > this->MaximumNumberOfSteps)
+      {
+      retVal = OUT_OF_STEPS;
+      break;
+      }
 
-    double startTime = startTimes->GetValue(currentLine);
+    if ( numSteps++ % 1000 == 1 )
+      {
+      if (reportProgress)
+        {
+        progress =
+          ( currentLine + propagation / this->MaximumPropagation ) / numLines;
+        this->UpdateProgress(progress);
+        }
 
-    // Initial point
-    seedSource->GetTuple(seedIds->GetId(currentLine), point1);
-    memcpy(point2, point1, 3*sizeof(double));
+      if (this->GetAbortExecute())
+        {
+        return 0;
+        }
+      }
 
-    double point1t[4];
-    memcpy(point1t, point1, 3*sizeof(double)); 
-    point1t[3] = startTime;
+    // Never call conversion methods if speed == 0
+    if ( (speed == 0) || (speed <= this->TerminalSpeed) )
+      {
+      retVal = STAGNATION;
+      break;
+      }
+
+    // If, with the next step, propagation will be larger than
+    // max, reduce it so that it is (approximately) equal to max.
+    aStep.Interval = fabs( stepSize.Interval );
 
-    if (!func->FunctionValues(point1t, velocity))
+    if ( ( propagation + aStep.Interval ) > this->MaximumPropagation )
+      {
+      aStep.Interval = this->MaximumPropagation - propagation;
+      if ( stepSize.Interval >= 0 )
+        {
+        stepSize.Interval = this->ConvertToLength( aStep, cellLength );
+        }
+      else
+        {
+        stepSize.Interval = this->ConvertToLength( aStep, cellLength ) * ( -1.0 );
+        }
+      maxStep = stepSize.Interval;
+      }
+    line.HasLastUsedStepSize = 1;
+    line.LastUsedStepSize = stepSize.Interval;
+
+    // Calculate the next step using the integrator provided
+    // Break if the next point is out of bounds.
+    func->SetNormalizeVector( true );
+    tmp = integrator->ComputeNextStep( point1, point2, accumTime, stepSize.Interval,
+                                       stepTaken, minStep, maxStep,
+                                       this->MaximumError, error );
+    func->SetNormalizeVector( false );
+    if ( tmp != 0 )
       {
-      continue;
+      retVal = tmp;
+      line.HasLastPoint = 1;
+      memcpy(line.LastPoint, point2, 3*sizeof(double));
+      break;
       }
 
-    if ( propagation >= this->MaximumPropagation ||
-         numSteps    >  this->MaximumNumberOfSteps)
+    // It is not enough to use the starting point for stagnation calculation
+    // Use delX/stepSize to calculate speed and check if it is below
+    // stagnation threshold
+    double disp[3];
+    for (i=0; i<3; i++)
+      {
+      disp[i] = point2[i] - point1[i];
+      }
+    if ( (stepSize.Interval == 0) ||
+         (vtkMath::Norm(disp) / fabs(stepSize.Interval) <= this->TerminalSpeed) )
       {
-      continue;
+      retVal = STAGNATION;
+      break;
       }
 
-    numPts++;
-    numPtsTotal++;
-    vtkIdType nextPoint = outputPoints->InsertNextPoint(point1);
+    accumTime += stepTaken / speed;
+    // Calculate propagation (using the same units as MaximumPropagation
+    propagation += fabs( stepSize.Interval );
 
-    time->InsertNextValue(startTime);
+    // This is the next starting point
+    for(i=0; i<3; i++)
+      {
+      point1[i] = point2[i];
+      }
 
-    // We will always pass an arc-length step size to the integrator.
-    // If the user specifies a step size in cell length unit, we will
-    // have to convert it to arc length.
-    IntervalInformation stepSize;  // either positive or negative
-    stepSize.Unit  = LENGTH_UNIT;
-    stepSize.Interval = 0;
-    IntervalInformation aStep; // always positive
-    aStep.Unit = LENGTH_UNIT;
-    double step, minStep=0, maxStep=0;
-    double stepTaken, accumTime=startTime;
-    double speed;
-    double cellLength;
-    int retVal=OUT_OF_LENGTH, tmp;
+    double point2t[4];
+    memcpy(point2t, point2, 3*sizeof(double)); 
+    point2t[3] = accumTime;
 
+    // Interpolate the velocity at the next point
+    if ( !func->FunctionValues(point2t, velocity) )
+      {
+      retVal = OUT_OF_DOMAIN;
+      line.HasLastPoint = 1;
+      memcpy(line.LastPoint, point2, 3*sizeof(double));
+      break;
+      }
     // Make sure we use the dataset found by the vtkAbstractInterpolatedVelocityField
     input = func->GetLastDataSet();
-    inputPD = input->GetPointData();
 
-    // Convert intervals to arc-length unit
+    // Point is valid. Insert it.
+    line.Points.insert(line.Points.end(), point1, point1+3);
+    line.Times.push_back(accumTime);
+
+    // Calculate cell length and speed to be used in unit conversions
     input->GetCell(func->GetLastCellId(), cell);
     cellLength = sqrt(static_cast<double>(cell->GetLength2()));
+
+    line.Velocities.insert(line.Velocities.end(), velocity, velocity+3);
+
     speed = vtkMath::Norm(velocity);
-    // Never call conversion methods if speed == 0
-    if ( speed != 0.0 )
-      {
-      this->ConvertIntervals( stepSize.Interval, minStep, maxStep,
-                              direction, cellLength );
-      }
 
-    // Interpolate all point attributes on first point
+    line.Speeds.push_back(speed);
+
+    // Interpolate all point attributes on current point
     func->GetLastWeights(weights);
     //TODO: avoid this at least for time vectors
     //outputPD->InterpolatePoint(inputPD, nextPoint, cell->PointIds, weights);
 
-    velocityArray->InsertNextTuple(velocity);
-    speedArray->InsertNextValue(speed);
-
     // Compute vorticity if required
     // This can be used later for streamribbon generation.
     if (this->ComputeVorticity)
       {
-      //TODO: for vorticity to work, inVectors should be updated with the vector field at the correct time step
+      //TODO
       //inVectors->GetTuples(cell->PointIds, cellVectors);
       func->GetLastLocalCoordinates(pcoords);
       vort[0] = vort[1] = vort[2] = 0.0;
       //vtkStreamTracer::CalculateVorticity(cell, pcoords, cellVectors, vort);
-      vorticity->InsertNextTuple(vort);
+      line.Vorticities.insert(line.Vorticities.end(), vort, vort+3);
       // rotation
-      // local rotation = vorticity . unit tangent ( i.e. velocity/speed )
-      if (speed != 0.0)
+      // angular velocity = vorticity . unit tangent ( i.e. velocity/speed )
+      // rotation = sum ( angular velocity * stepSize )
+      omega = vtkMath::Dot(vort, velocity);
+      omega /= speed;
+      omega *= this->RotationScale;
+      size_t index = line.AngularVelocities.size();
+      line.AngularVelocities.push_back(omega);
+      line.Rotations.push_back(line.Rotations[index-1] +
+                               (line.AngularVelocities[index-1] + omega)/2 *
+                               (accumTime - line.Times[index-1]));
+      }
+
+    // Never call conversion methods if speed == 0
+    if ( (speed == 0) || (speed <= this->TerminalSpeed) )
+      {
+      retVal = STAGNATION;
+      break;
+      }
+
+    // Convert all intervals to arc length
+    this->ConvertIntervals( step, minStep, maxStep, direction, cellLength );
+
+
+    // If the solver is adaptive and the next step size (stepSize.Interval)
+    // that the solver wants to use is smaller than minStep or larger
+    // than maxStep, re-adjust it. This has to be done every step
+    // because minStep and maxStep can change depending on the cell
+    // size (unless it is specified in arc-length unit)
+    if (integrator->IsAdaptive())
+      {
+      if (fabs(stepSize.Interval) < fabs(minStep))
         {
-        omega = vtkMath::Dot(vort, velocity);
-        omega /= speed;
-        omega *= this->RotationScale;
+        stepSize.Interval = fabs( minStep ) *
+                              stepSize.Interval / fabs( stepSize.Interval );
         }
-      else
+      else if (fabs(stepSize.Interval) > fabs(maxStep))
         {
-        omega = 0.0;
+        stepSize.Interval = fabs( maxStep ) *
+                              stepSize.Interval / fabs( stepSize.Interval );
         }
-      angularVel->InsertNextValue(omega);
-      rotation->InsertNextValue(0.0);
       }
-
-    double error = 0;
-    // Integrate until the maximum propagation length is reached,
-    // maximum number of steps is reached or until a boundary is encountered.
-    // Begin Integration
-    while ( propagation < this->MaximumPropagation )
+    else
       {
+      stepSize.Interval = step;
+      }
 
-      if (numSteps > this->MaximumNumberOfSteps)
-        {
-        retVal = OUT_OF_STEPS;
-        break;
-        }
+    // End Integration
+    }
 
-      if ( numSteps++ % 1000 == 1 )
-        {
-        progress =
-          ( currentLine + propagation / this->MaximumPropagation ) / numLines;
-        this->UpdateProgress(progress);
+  line.ReasonForTermination = retVal;
+  line.Propagation = propagation;
+  line.NumberOfSteps = numSteps;
 
-        if (this->GetAbortExecute())
-          {
-          shouldAbort = 1;
-          break;
-          }
-        }
+  return 1;
+}
 
-      // Never call conversion methods if speed == 0
-      if ( (speed == 0) || (speed <= this->TerminalSpeed) )
-        {
-        retVal = STAGNATION;
-        break;
-        }
+void vtkvmtkStaticTemporalStreamTracer::Integrate(vtkDataSet *input0,
+                                                  vtkPolyData* output,
+                                                  vtkDataArray* seedSource,
+                                                  vtkIdList* seedIds,
+                                                  vtkDoubleArray* startTimes,
+                                                  vtkIntArray* integrationDirections,
+                                                  double lastPoint[3],
+                                                  vtkAbstractInterpolatedVelocityField* func,
+                                                  vtkAbstractCellLocator* parallelCellLocator,
+                                                  int maxCellSize,
+                                                  double& inPropagation,
+                                                  vtkIdType& inNumSteps)
+{
+  vtkIdType i;
+  vtkIdType numLines = seedIds->GetNumberOfIds();
 
-      // If, with the next step, propagation will be larger than
-      // max, reduce it so that it is (approximately) equal to max.
-      aStep.Interval = fabs( stepSize.Interval );
+  // Useful pointers
+  vtkDataSetAttributes* outputPD = output->GetPointData();
+  vtkDataSetAttributes* outputCD = output->GetCellData();
 
-      if ( ( propagation + aStep.Interval ) > this->MaximumPropagation )
-        {
-        aStep.Interval = this->MaximumPropagation - propagation;
-        if ( stepSize.Interval >= 0 )
-          {
-          stepSize.Interval = this->ConvertToLength( aStep, cellLength );
-          }
-        else
-          {
-          stepSize.Interval = this->ConvertToLength( aStep, cellLength ) * ( -1.0 );
-          }
-        maxStep = stepSize.Interval;
-        }
-      this->LastUsedStepSize = stepSize.Interval;
-
-      // Calculate the next step using the integrator provided
-      // Break if the next point is out of bounds.
-      func->SetNormalizeVector( true );
-      tmp = integrator->ComputeNextStep( point1, point2, accumTime, stepSize.Interval,
-                                         stepTaken, minStep, maxStep,
-                                         this->MaximumError, error );
-      func->SetNormalizeVector( false );
-      if ( tmp != 0 )
-        {
-        retVal = tmp;
-        memcpy(lastPoint, point2, 3*sizeof(double));
-        break;
-        }
+  if (this->GetIntegrator() == 0)
+    {
+    vtkErrorMacro("No integrator is specified.");
+    return;
+    }
 
-      // It is not enough to use the starting point for stagnation calculation
-      // Use delX/stepSize to calculate speed and check if it is below
-      // stagnation threshold
-      double disp[3];
-      for (i=0; i<3; i++)
-        {
-        disp[i] = point2[i] - point1[i];
-        }
-      if ( (stepSize.Interval == 0) ||
-           (vtkMath::Norm(disp) / fabs(stepSize.Interval) <= this->TerminalSpeed) )
-        {
-        retVal = STAGNATION;
-        break;
-        }
+  // Seeds are integrated independently, each into its own line, and lines
+  // are appended to the output in seed order, so the output does not
+  // depend on how seeds are scheduled.
+  std::vector<vtkvmtkStaticTemporalStreamLine> lines(numLines);
 
-      accumTime += stepTaken / speed;
-      // Calculate propagation (using the same units as MaximumPropagation
-      propagation += fabs( stepSize.Interval );
+  int shouldAbort = 0;
 
-      // This is the next starting point
-      for(i=0; i<3; i++)
-        {
-        point1[i] = point2[i];
-        }
+  if (parallelCellLocator && numLines > 1)
+    {
+    vtkvmtkStaticTemporalStreamTracerIntegrateFunctor functor(this,input0,func,maxCellSize,seedSource,seedIds,startTimes,integrationDirections,lines);
+    // trace lengths vary widely, so seeds are handed out in small chunks
+    vtkSMPTools::For(0,numLines,this->SeedChunkSize > 0 ? this->SeedChunkSize : 1,functor);
+    shouldAbort = functor.GetAborted();
+    }
+  else
+    {
+    double* weights = 0;
+    if ( maxCellSize > 0 )
+      {
+      weights = new double[maxCellSize];
+      }
+
+    // Used in GetCell()
+    vtkGenericCell* cell = vtkGenericCell::New();
 
-      double point2t[4];
-      memcpy(point2t, point2, 3*sizeof(double)); 
-      point2t[3] = accumTime;
+    // Create a new integrator, the type is the same as Integrator
+    vtkInitialValueProblemSolver* integrator =
+      this->GetIntegrator()->NewInstance();
+    integrator->SetFunctionSet(func);
 
-      // Interpolate the velocity at the next point
-      if ( !func->FunctionValues(point2t, velocity) )
+    for (i=0; i<numLines; i++)
+      {
+      this->UpdateProgress(static_cast<double>(i)/numLines);
+      if (!this->IntegrateLine(i,numLines,seedSource,seedIds,startTimes,integrationDirections,func,integrator,cell,weights,1,lines[i]))
         {
-        retVal = OUT_OF_DOMAIN;
-        memcpy(lastPoint, point2, 3*sizeof(double));
+        shouldAbort = 1;
         break;
         }
-      // Make sure we use the dataset found by the vtkAbstractInterpolatedVelocityField
-      input = func->GetLastDataSet();
-      inputPD = input->GetPointData();
+      }
 
-      // Point is valid. Insert it.
-      numPts++;
-      numPtsTotal++;
-      nextPoint = outputPoints->InsertNextPoint(point1);
-      time->InsertNextValue(accumTime);
+    integrator->Delete();
+    cell->Delete();
 
-      // Calculate cell length and speed to be used in unit conversions
-      input->GetCell(func->GetLastCellId(), cell);
-      cellLength = sqrt(static_cast<double>(cell->GetLength2()));
+    delete[] weights;
+    }
 
-      velocityArray->InsertNextTuple(velocity);
+  if (shouldAbort)
+    {
+    output->Squeeze();
+    return;
+    }
 
-      speed = vtkMath::Norm(velocity);
+  vtkIdType numPtsTotal = 0;
+  for (i=0; i<numLines; i++)
+    {
+    numPtsTotal += lines[i].GetNumberOfPoints();
+    }
 
-      speedArray->InsertNextValue(speed);
+  vtkPoints* outputPoints = vtkPoints::New();
+  outputPoints->SetNumberOfPoints(numPtsTotal);
 
-      // Interpolate all point attributes on current point
-      func->GetLastWeights(weights);
-      //TODO: avoid this at least for time vectors
-      //outputPD->InterpolatePoint(inputPD, nextPoint, cell->PointIds, weights);
+  vtkCellArray* outputLines = vtkCellArray::New();
 
-      // Compute vorticity if required
-      // This can be used later for streamribbon generation.
-      if (this->ComputeVorticity)
-        {
-        //TODO
-        //inVectors->GetTuples(cell->PointIds, cellVectors);
-        func->GetLastLocalCoordinates(pcoords);
-        vort[0] = vort[1] = vort[2] = 0.0;
-        //vtkStreamTracer::CalculateVorticity(cell, pcoords, cellVectors, vort);
-        vorticity->InsertNextTuple(vort);
-        // rotation
-        // angular velocity = vorticity . unit tangent ( i.e. velocity/speed )
-        // rotation = sum ( angular velocity * stepSize )
-        omega = vtkMath::Dot(vort, velocity);
-        omega /= speed;
-        omega *= this->RotationScale;
-        index = angularVel->InsertNextValue(omega);
-        rotation->InsertNextValue(rotation->GetValue(index-1) +
-                                  (angularVel->GetValue(index-1) + omega)/2 *
-                                  (accumTime - time->GetValue(index-1)));
-        }
+  // We will keep track of integration time in this array
+  vtkDoubleArray* time = vtkDoubleArray::New();
+  time->SetName("IntegrationTime");
+  time->SetNumberOfTuples(numPtsTotal);
 
-      // Never call conversion methods if speed == 0
-      if ( (speed == 0) || (speed <= this->TerminalSpeed) )
-        {
-        retVal = STAGNATION;
-        break;
-        }
+  // This array explains why the integration stopped
+  vtkIntArray* retVals = vtkIntArray::New();
+  retVals->SetName("ReasonForTermination");
 
-      // Convert all intervals to arc length
-      this->ConvertIntervals( step, minStep, maxStep, direction, cellLength );
+  vtkDoubleArray* velocityArray = vtkDoubleArray::New();
+  velocityArray->SetName("Velocity");
+  velocityArray->SetNumberOfComponents(3);
+  velocityArray->SetNumberOfTuples(numPtsTotal);
 
+  vtkDoubleArray* speedArray = vtkDoubleArray::New();
+  speedArray->SetName("Speed");
+  speedArray->SetNumberOfTuples(numPtsTotal);
 
-      // If the solver is adaptive and the next step size (stepSize.Interval)
-      // that the solver wants to use is smaller than minStep or larger
-      // than maxStep, re-adjust it. This has to be done every step
-      // because minStep and maxStep can change depending on the cell
-      // size (unless it is specified in arc-length unit)
-      if (integrator->IsAdaptive())
-        {
-        if (fabs(stepSize.Interval) < fabs(minStep))
-          {
-          stepSize.Interval = fabs( minStep ) *
-                                stepSize.Interval / fabs( stepSize.Interval );
-          }
-        else if (fabs(stepSize.Interval) > fabs(maxStep))
-          {
-          stepSize.Interval = fabs( maxStep ) *
-                                stepSize.Interval / fabs( stepSize.Interval );
-          }
-        }
-      else
-        {
-        stepSize.Interval = step;
-        }
+  vtkDoubleArray* vorticity = 0;
+  vtkDoubleArray* rotation = 0;
+  vtkDoubleArray* angularVel = 0;
 
-      // End Integration
-      }
+  if (this->ComputeVorticity)
+    {
+    vorticity = vtkDoubleArray::New();
+    vorticity->SetName("Vorticity");
+    vorticity->SetNumberOfComponents(3);
+    vorticity->SetNumberOfTuples(numPtsTotal);
 
-    if (shouldAbort)
+    rotation = vtkDoubleArray::New();
+    rotation->SetName("Rotation");
+    rotation->SetNumberOfTuples(numPtsTotal);
+
+    angularVel = vtkDoubleArray::New();
+    angularVel->SetName("AngularVelocity");
+    angularVel->SetNumberOfTuples(numPtsTotal);
+    }
+
+  // Merge lines in seed order
+  vtkIdType offset = 0;
+  for (i=0; i<numLines; i++)
+    {
+    const vtkvmtkStaticTemporalStreamLine& line = lines[i];
+    vtkIdType numPts = line.GetNumberOfPoints();
+    for (vtkIdType j=0; j<numPts; j++)
       {
-      break;
+      outputPoints->SetPoint(offset+j,&line.Points[3*j]);
+      time->SetValue(offset+j,line.Times[j]);
+      velocityArray->SetTuple(offset+j,&line.Velocities[3*j]);
+      speedArray->SetValue(offset+j,line.Speeds[j]);
+      if (vorticity)
+        {
+        vorticity->SetTuple(offset+j,&line.Vorticities[3*j]);
+        rotation->SetValue(offset+j,line.Rotations[j]);
+        angularVel->SetValue(offset+j,line.AngularVelocities[j]);
+        }
       }
 
     if (numPts > 1)
       {
       outputLines->InsertNextCell(numPts);
-      for (i=numPtsTotal-numPts; i<numPtsTotal; i++)
+      for (vtkIdType j=offset; j<offset+numPts; j++)
         {
-        outputLines->InsertCellPoint(i);
+        outputLines->InsertCellPoint(j);
         }
-      retVals->InsertNextValue(retVal);
+      retVals->InsertNextValue(line.ReasonForTermination);
       }
 
-    // Initialize these to 0 before starting the next line.
-    // The values passed in the function call are only used
-    // for the first line.
-    inPropagation = propagation;
-    inNumSteps = numSteps;
+    if (line.HasLastPoint)
+      {
+      memcpy(lastPoint, line.LastPoint, 3*sizeof(double));
+      }
+    if (line.HasLastUsedStepSize)
+      {
+      this->LastUsedStepSize = line.LastUsedStepSize;
+      }
+    if (numPts > 0)
+      {
+      inPropagation = line.Propagation;
+      inNumSteps = line.NumberOfSteps;
+      }
 
-    propagation = 0;
-    numSteps = 0;
+    offset += numPts;
     }
 
-  if (!shouldAbort)
+  this->UpdateProgress(1.0);
+
+  // Create the output polyline
+  output->SetPoints(outputPoints);
+  outputPD->AddArray(time);
+  outputPD->AddArray(velocityArray);
+  outputPD->AddArray(speedArray);
+  if (vorticity)
     {
-    // Create the output polyline
-    output->SetPoints(outputPoints);
-    outputPD->AddArray(time);
-    outputPD->AddArray(velocityArray);
-    outputPD->AddArray(speedArray);
-    if (vorticity)
-      {
-      outputPD->AddArray(vorticity);
-      outputPD->AddArray(rotation);
-      outputPD->AddArray(angularVel);
-      }
+    outputPD->AddArray(vorticity);
+    outputPD->AddArray(rotation);
+    outputPD->AddArray(angularVel);
+    }
 
-    vtkIdType numPts = outputPoints->GetNumberOfPoints();
-    if ( numPts > 1 )
+  if ( numPtsTotal > 1 )
+    {
+    // Assign geometry and attributes
+    output->SetLines(outputLines);
+    if (this->GenerateNormalsInIntegrate)
       {
-      // Assign geometry and attributes
-      output->SetLines(outputLines);
-      if (this->GenerateNormalsInIntegrate)
-        {
-        ////////////////////////////// TODO //////////////////////////////
-        //this->GenerateNormals(output, 0, vecName);
-        }
-
-      outputCD->AddArray(retVals);
+      ////////////////////////////// TODO //////////////////////////////
+      //this->GenerateNormals(output, 0, vecName);
       }
+
+    outputCD->AddArray(retVals);
     }
 
   velocityArray->Delete();
@@ -780,10 +1031,6 @@ void vtkvmtkStaticTemporalStreamTracer::Integrate(vtkDataSet *input0,
     angularVel->Delete();
     }
 
-  if (cellVectors)
-    {
-    cellVectors->Delete();
-    }
   retVals->Delete();
 
   outputPoints->Delete();
@@ -791,12 +1038,6 @@ void vtkvmtkStaticTemporalStreamTracer::Integrate(vtkDataSet *input0,
 
   time->Delete();
 
-
-  integrator->Delete();
-  cell->Delete();
-
-  delete[] weights;
-
   output->Squeeze();
   return;
 }
@@ -807,5 +1048,8 @@ void vtkvmtkStaticTemporalStreamTracer::PrintSelf(ostream& os, vtkIndent indent)
 
   os << indent << "Seed time: " << this->SeedTime
      << " unit: time." << endl;
+  os << indent << "Use cell locator: " << this->UseCellLocator << endl;
+  os << indent << "Parallel integration: " << this->ParallelIntegration << endl;
+  os << indent << "Seed chunk size: " << this->SeedChunkSize << endl;
 }
 
@@ -35,6 +35,15 @@ Language:  C++
 // vtkvmtkStaticTemporalStreamTracer is a filter that integrates a vector field to generate
 // streamlines. The integration is performed using a specified integrator,
 // by default Runge-Kutta2.
+// If UseCellLocator is on, a cell locator (vtkStaticCellLocator from VTK 8.1,
+// vtkCellLocator before) is built once on the input and shared by the
+// interpolators, which otherwise fall back to vtkDataSet::FindCell whenever
+// walking from the last cell fails.
+// If ParallelIntegration is also on (and the input is a single dataset,
+// with VTK 8.1 or later),
+// seeds are integrated concurrently, each thread with its own copy of the
+// interpolator and integrator, handing out SeedChunkSize seeds at a time.
+// Traces are merged in seed order, so the output matches serial integration.
 //
 
 #ifndef __vtkvmtkStaticTemporalStreamTracer_h
@@ -44,6 +53,9 @@ Language:  C++
 #include "vtkvmtkWin32Header.h"
 
 class vtkTable;
+class vtkAbstractCellLocator;
+class vtkGenericCell;
+class vtkvmtkStaticTemporalStreamLine;
 
 class VTK_VMTK_MISC_EXPORT vtkvmtkStaticTemporalStreamTracer : public vtkStreamTracer
 {
@@ -85,6 +97,17 @@ public:
   vtkSetStringMacro(Component2Prefix);
   vtkGetStringMacro(Component2Prefix);
 
+  vtkSetMacro(UseCellLocator, int);
+  vtkGetMacro(UseCellLocator, int);
+  vtkBooleanMacro(UseCellLocator, int);
+
+  vtkSetMacro(ParallelIntegration, int);
+  vtkGetMacro(ParallelIntegration, int);
+  vtkBooleanMacro(ParallelIntegration, int);
+
+  vtkSetMacro(SeedChunkSize, int);
+  vtkGetMacro(SeedChunkSize, int);
+
 protected:
 
   vtkvmtkStaticTemporalStreamTracer();
@@ -110,9 +133,26 @@ protected:
                  vtkIntArray* integrationDirections,
                  double lastPoint[3],
                  vtkAbstractInterpolatedVelocityField* func,
+                 vtkAbstractCellLocator* parallelCellLocator,
                  int maxCellSize,
                  double& propagation,
                  vtkIdType& numSteps);
+
+  // Description:
+  // Integrate the seed with index currentLine into line. Returns 0 if
+  // execution was aborted.
+  int IntegrateLine(vtkIdType currentLine,
+                    vtkIdType numLines,
+                    vtkDataArray* seedSource,
+                    vtkIdList* seedIds,
+                    vtkDoubleArray* startTimes,
+                    vtkIntArray* integrationDirections,
+                    vtkAbstractInterpolatedVelocityField* func,
+                    vtkInitialValueProblemSolver* integrator,
+                    vtkGenericCell* cell,
+                    double* weights,
+                    int reportProgress,
+                    vtkvmtkStaticTemporalStreamLine& line);
  
   double SeedTime;
   char* SeedTimesArrayName;
@@ -129,6 +169,12 @@ protected:
 
   double VelocityScale;
 
+  int UseCellLocator;
+  int ParallelIntegration;
+  int SeedChunkSize;
+
+  friend class vtkvmtkStaticTemporalStreamTracerIntegrateFunctor;
+
 private:
   vtkvmtkStaticTemporalStreamTracer(const vtkvmtkStaticTemporalStreamTracer&);  // Not implemented.
   void operator=(const vtkvmtkStaticTemporalStreamTracer&);  // Not implemented.
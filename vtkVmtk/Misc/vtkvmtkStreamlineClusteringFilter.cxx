@@ -32,9 +32,13 @@ Version:   $Revision: 1.6 $
 #include "vtkCellData.h"
 #include "vtkMath.h"
 #include "vtkSplineFilter.h"
-//#include "vtkPointLocator.h"
 #include "vtkCellArray.h"
 #include "vtkCell.h"
+#include "vtkIntArray.h"
+#include "vtkSMPTools.h"
+
+#include <vector>
+#include <algorithm>
 
 
 vtkStandardNewMacro(vtkvmtkStreamlineClusteringFilter);
@@ -53,6 +57,160 @@ vtkvmtkStreamlineClusteringFilter::~vtkvmtkStreamlineClusteringFilter()
     }
 }
 
+// Assigns each streamline chunk to the closest cluster center. Center
+// points are stored coordinate by coordinate for the inner nearest point
+// loop. Centers are visited in order of a lower bound of their distance
+// computed from their bounding boxes, so that a close center is found
+// early, and the computation for a center stops as soon as its lower bound
+// exceeds the best distance found so far.
+// Ties are broken by center index as in the exhaustive search.
+class vtkvmtkStreamlineClusteringFilterAssignFunctor
+{
+public:
+  vtkvmtkStreamlineClusteringFilterAssignFunctor(const std::vector<double>& streamlinePoints, const std::vector<vtkIdType>& streamlineOffsets, const std::vector<double>& centerPoints, const std::vector<vtkIdType>& centerOffsets, const std::vector<double>& centerBounds, vtkIdList* centerLabelIds, vtkIntArray* labelArray, vtkDoubleArray* distanceArray) :
+    StreamlinePoints(streamlinePoints), StreamlineOffsets(streamlineOffsets), CenterPoints(centerPoints), CenterOffsets(centerOffsets), CenterBounds(centerBounds), CenterLabelIds(centerLabelIds), LabelArray(labelArray), DistanceArray(distanceArray) {}
+
+  static double BoxDistance2(const double* point, const double* bounds)
+  {
+    double distance2 = 0.0;
+    for (int k=0; k<3; k++)
+      {
+      double d = 0.0;
+      if (point[k] < bounds[2*k])
+        {
+        d = bounds[2*k] - point[k];
+        }
+      else if (point[k] > bounds[2*k+1])
+        {
+        d = point[k] - bounds[2*k+1];
+        }
+      distance2 += d * d;
+      }
+    return distance2;
+  }
+
+  void operator()(vtkIdType begin, vtkIdType end)
+  {
+    int numberOfClusters = static_cast<int>(this->CenterOffsets.size()) - 1;
+    std::vector<std::pair<double,int> > centerOrder(numberOfClusters);
+    std::vector<double> remainingBoxDistance2;
+    std::vector<char> matched;
+
+    for (vtkIdType i=begin; i<end; i++)
+      {
+      const double* streamlinePoints = &this->StreamlinePoints[3*this->StreamlineOffsets[i]];
+      int numberOfStreamlinePoints = static_cast<int>(this->StreamlineOffsets[i+1] - this->StreamlineOffsets[i]);
+      remainingBoxDistance2.resize(numberOfStreamlinePoints+1);
+
+      // order centers by the lower bound of their summed squared distance
+      int j;
+      for (j=0; j<numberOfClusters; j++)
+        {
+        double boxDistance2Sum = 0.0;
+        for (int ip=0; ip<numberOfStreamlinePoints; ip++)
+          {
+          boxDistance2Sum += BoxDistance2(streamlinePoints+3*ip,&this->CenterBounds[6*j]);
+          }
+        centerOrder[j] = std::make_pair(boxDistance2Sum,j);
+        }
+      std::sort(centerOrder.begin(),centerOrder.end());
+
+      double minClusterCenterDistance = VTK_VMTK_LARGE_DOUBLE;
+      int minClusterCenterIndex = -1;
+      for (int k=0; k<numberOfClusters; k++)
+        {
+        j = centerOrder[k].second;
+        const double* centerPoints = &this->CenterPoints[3*this->CenterOffsets[j]];
+        int numberOfClusterCenterLinePoints = static_cast<int>(this->CenterOffsets[j+1] - this->CenterOffsets[j]);
+        const double* centerX = centerPoints;
+        const double* centerY = centerPoints + numberOfClusterCenterLinePoints;
+        const double* centerZ = centerPoints + 2*numberOfClusterCenterLinePoints;
+
+        // the penalty factor is at least this large, since a streamline
+        // point can match at most numberOfClusterCenterLinePoints distinct
+        // center points
+        int minimumPenaltyPoints = numberOfClusterCenterLinePoints > numberOfStreamlinePoints ? numberOfClusterCenterLinePoints - numberOfStreamlinePoints : 0;
+        double lowerBoundFactor = (1.0 + static_cast<double>(minimumPenaltyPoints) / numberOfStreamlinePoints) / numberOfStreamlinePoints;
+
+        if (minClusterCenterIndex != -1 && sqrt(centerOrder[k].first) * lowerBoundFactor * (1.0 - 1E-12) > minClusterCenterDistance)
+          {
+          continue;
+          }
+
+        remainingBoxDistance2[numberOfStreamlinePoints] = 0.0;
+        for (int ip=numberOfStreamlinePoints-1; ip>=0; ip--)
+          {
+          remainingBoxDistance2[ip] = remainingBoxDistance2[ip+1] + BoxDistance2(streamlinePoints+3*ip,&this->CenterBounds[6*j]);
+          }
+
+        matched.assign(numberOfClusterCenterLinePoints,0);
+        double squaredDistanceSum = 0.0;
+        int numberOfRepeatedMatches = 0;
+        bool pruned = false;
+        for (int ip=0; ip<numberOfStreamlinePoints; ip++)
+          {
+          const double* point = streamlinePoints + 3*ip;
+          double minPointDistanceSquared = VTK_VMTK_LARGE_DOUBLE;
+          int minPointDistanceId = -1;
+          for (int jp=0; jp<numberOfClusterCenterLinePoints; jp++)
+            {
+            double dx = point[0] - centerX[jp];
+            double dy = point[1] - centerY[jp];
+            double dz = point[2] - centerZ[jp];
+            double distanceSquared = dx * dx + dy * dy + dz * dz;
+            if (distanceSquared < minPointDistanceSquared)
+              {
+              minPointDistanceSquared = distanceSquared;
+              minPointDistanceId = jp;
+              }
+            }
+          squaredDistanceSum += minPointDistanceSquared;
+          if (matched[minPointDistanceId])
+            {
+            numberOfRepeatedMatches++;
+            }
+          else
+            {
+            matched[minPointDistanceId] = 1;
+            }
+          if (minClusterCenterIndex != -1 && sqrt(squaredDistanceSum + remainingBoxDistance2[ip+1]) * lowerBoundFactor * (1.0 - 1E-12) > minClusterCenterDistance)
+            {
+            pruned = true;
+            break;
+            }
+          }
+        if (pruned)
+          {
+          continue;
+          }
+
+        double clusterCenterDistance = sqrt(squaredDistanceSum);
+        double averageDistance = clusterCenterDistance / numberOfStreamlinePoints;
+        double distancePenalty = (numberOfClusterCenterLinePoints - numberOfStreamlinePoints + numberOfRepeatedMatches) * averageDistance;
+        double distance = (clusterCenterDistance + distancePenalty) / numberOfStreamlinePoints;
+        if (distance < minClusterCenterDistance || (distance == minClusterCenterDistance && j < minClusterCenterIndex))
+          {
+          minClusterCenterDistance = distance;
+          minClusterCenterIndex = j;
+          }
+        }
+
+      this->LabelArray->SetValue(i,minClusterCenterIndex != -1 ? this->CenterLabelIds->GetId(minClusterCenterIndex) : -1);
+      this->DistanceArray->SetValue(i,minClusterCenterDistance);
+      }
+  }
+
+private:
+  const std::vector<double>& StreamlinePoints;
+  const std::vector<vtkIdType>& StreamlineOffsets;
+  const std::vector<double>& CenterPoints;
+  const std::vector<vtkIdType>& CenterOffsets;
+  const std::vector<double>& CenterBounds;
+  vtkIdList* CenterLabelIds;
+  vtkIntArray* LabelArray;
+  vtkDoubleArray* DistanceArray;
+};
+
 int vtkvmtkStreamlineClusteringFilter::RequestData(
   vtkInformation *vtkNotUsed(request),
   vtkInformationVector **inputVector,
@@ -97,13 +255,15 @@ int vtkvmtkStreamlineClusteringFilter::RequestData(
   
   int numberOfCells = resampledInput->GetNumberOfCells();
 
+  int clusterStride = numberOfCells/numberOfClusters > 0 ? numberOfCells/numberOfClusters : 1;
+
   vtkIdList* inputCellIds = vtkIdList::New();
   vtkIdList* inputLabelIds = vtkIdList::New();
   int currentLabelId = -1;
   for (int i=0; i<numberOfCells; i++)
     {
     bool isCluster = false;
-    if (i%(numberOfCells/numberOfClusters) == 0)
+    if (i%clusterStride == 0)
       {
       isCluster = true;
       currentLabelId++;
@@ -162,17 +322,6 @@ int vtkvmtkStreamlineClusteringFilter::RequestData(
 
   clusterCenters->GetCellData()->AddArray(centerLabelArray);
 
-//  vtkDoubleArray* covariance = vtkDoubleArray::New();
-//  covariance->SetName("PointCovariance");
-//  covariance->SetNumberOfComponents(3);
-//  covariance->SetNumberOfTuples(clusterCenterPoints->GetNumberOfPoints());
-
-//  clusterCenters->GetPointData()->AddArray(covariance);
-
-//  vtkPointLocator* pointLocator = vtkPointLocator::New();
-//  pointLocator->SetDataSet(clusterCenters);
-//  pointLocator->BuildLocator();
-
   vtkIntArray* labelArray = vtkIntArray::New();
   labelArray->SetName("Label");
   labelArray->SetNumberOfValues(numberOfCells);
@@ -181,60 +330,51 @@ int vtkvmtkStreamlineClusteringFilter::RequestData(
   distance->SetName("Distance");
   distance->SetNumberOfTuples(numberOfCells);
 
-  for (int i=0; i<numberOfCells; i++)
+  // Gather streamline chunks and cluster centers in contiguous arrays,
+  // center coordinates stored as x block, y block, z block per center
+  std::vector<double> streamlinePoints;
+  std::vector<vtkIdType> streamlineOffsets(1,0);
+  streamlinePoints.reserve(3*streamlinesLines->GetNumberOfConnectivityEntries());
+  vtkIdType npts, *pts;
+  streamlinesLines->InitTraversal();
+  while (streamlinesLines->GetNextCell(npts,pts))
     {
-    double point[3], clusterCenterPoint[3];
-    vtkCell* streamline = streamlines->GetCell(i);
-    double minClusterCenterDistance = VTK_VMTK_LARGE_DOUBLE; 
-    int minClusterCenterDistanceId = -1;
-    for (int j=0; j<numberOfClusters; j++)
+    for (vtkIdType ip=0; ip<npts; ip++)
       {
-      vtkCell* clusterCenterLine = clusterCenters->GetCell(j);
-      int numberOfClusterCenterLinePoints = clusterCenterLine->GetNumberOfPoints();
-      double squaredDistanceSum = 0.0;
-      int numberOfRepeatedMatches = 0;
-      int numberOfStreamlinePoints = streamline->GetNumberOfPoints();
-      vtkIdList* correspondenceIds = vtkIdList::New();
-      for (int ip=0; ip<numberOfStreamlinePoints; ip++)
-        {
-        streamlines->GetPoint(streamline->GetPointId(ip),point);
-        double minPointDistanceSquared = VTK_VMTK_LARGE_DOUBLE;
-        int minPointDistanceId = -1;
-        for (int jp=0; jp<numberOfClusterCenterLinePoints; jp++)
-          {
-          clusterCenters->GetPoint(clusterCenterLine->GetPointId(jp),clusterCenterPoint);
-          double distanceSquared = vtkMath::Distance2BetweenPoints(point,clusterCenterPoint);
-          if (distanceSquared < minPointDistanceSquared)
-            {
-            minPointDistanceSquared = distanceSquared;
-            minPointDistanceId = jp;
-            }
-          }
-        squaredDistanceSum += minPointDistanceSquared;
-        if (correspondenceIds->IsId(minPointDistanceId) != -1)
-          {
-          numberOfRepeatedMatches++;
-          }
-        else
-          {
-          correspondenceIds->InsertNextId(minPointDistanceId);
-          }
-        }
-      correspondenceIds->Delete();
-      double clusterCenterDistance = sqrt(squaredDistanceSum);
-      double averageDistance = clusterCenterDistance / numberOfStreamlinePoints;
-      double distancePenalty = (numberOfClusterCenterLinePoints - numberOfStreamlinePoints + numberOfRepeatedMatches) * averageDistance;
-      double distance = (clusterCenterDistance + distancePenalty) / numberOfStreamlinePoints;
-      if (distance < minClusterCenterDistance)
+      double point[3];
+      streamlinesPoints->GetPoint(pts[ip],point);
+      streamlinePoints.insert(streamlinePoints.end(),point,point+3);
+      }
+    streamlineOffsets.push_back(streamlineOffsets.back()+npts);
+    }
+
+  std::vector<double> centerPoints(3*clusterCenterPoints->GetNumberOfPoints());
+  std::vector<vtkIdType> centerOffsets(1,0);
+  std::vector<double> centerBounds(6*numberOfClusters);
+  clusterCenterLines->InitTraversal();
+  for (int j=0; clusterCenterLines->GetNextCell(npts,pts); j++)
+    {
+    double* centerX = &centerPoints[3*centerOffsets.back()];
+    double* bounds = &centerBounds[6*j];
+    bounds[0] = bounds[2] = bounds[4] = VTK_VMTK_LARGE_DOUBLE;
+    bounds[1] = bounds[3] = bounds[5] = -VTK_VMTK_LARGE_DOUBLE;
+    for (vtkIdType jp=0; jp<npts; jp++)
+      {
+      double point[3];
+      clusterCenterPoints->GetPoint(pts[jp],point);
+      for (int k=0; k<3; k++)
         {
-        minClusterCenterDistance = distance;
-        minClusterCenterDistanceId = inputLabelIds->GetId(j);
+        centerX[k*npts+jp] = point[k];
+        bounds[2*k] = std::min(bounds[2*k],point[k]);
+        bounds[2*k+1] = std::max(bounds[2*k+1],point[k]);
         }
       }
-    labelArray->InsertValue(i,minClusterCenterDistanceId);
-    distance->InsertValue(i,minClusterCenterDistance);
+    centerOffsets.push_back(centerOffsets.back()+npts);
     }
 
+  vtkvmtkStreamlineClusteringFilterAssignFunctor assignFunctor(streamlinePoints,streamlineOffsets,centerPoints,centerOffsets,centerBounds,inputLabelIds,labelArray,distance);
+  vtkSMPTools::For(0,numberOfCells,assignFunctor);
+
   output->DeepCopy(streamlines);
   output->GetCellData()->AddArray(labelArray);
   output->GetCellData()->AddArray(distance);
@@ -250,12 +390,15 @@ int vtkvmtkStreamlineClusteringFilter::RequestData(
 
   splineFilter->Delete(); 
   inputCellIds->Delete();
+  inputLabelIds->Delete();
+  streamlines->Delete();
+  streamlinesPoints->Delete();
+  streamlinesLines->Delete();
   clusterCenters->Delete();
   clusterCenterPoints->Delete();
   clusterCenterLines->Delete();
-//  covariance->Delete();
-//  pointLocator->Delete();
   labelArray->Delete();
+  distance->Delete();
   centerLabelArray->Delete();
 
   return 1;
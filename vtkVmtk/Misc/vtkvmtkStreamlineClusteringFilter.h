@@ -20,7 +20,10 @@ Version:   $Revision: 1.5 $
 =========================================================================*/
   // .NAME vtkvmtkStreamlineClusteringFilter - Cluster streamlines based on Mahalanobis distance metric and K-Means clustering.
   // .SECTION Description
-  // This class clusters streamlines.
+  // This class clusters streamlines. Streamlines are resampled and split in
+  // chunks, a subset of which is used as cluster centers; every chunk is
+  // labelled with the closest center. The assignment is multithreaded over
+  // chunks and prunes centers using bounding box lower bounds.
 
 #ifndef __vtkvmtkStreamlineClusteringFilter_h
 #define __vtkvmtkStreamlineClusteringFilter_h
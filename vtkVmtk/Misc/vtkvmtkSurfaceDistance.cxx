@@ -21,7 +21,7 @@ Version:   $Revision: 1.3 $
 
 #include "vtkvmtkSurfaceDistance.h"
 
-#include "vtkCellLocator.h"
+#include "vtkvmtkClosestPointProjector.h"
 #include "vtkDoubleArray.h"
 #include "vtkGenericCell.h"
 #include "vtkPolyData.h"
@@ -30,6 +30,11 @@ Version:   $Revision: 1.3 $
 #include "vtkInformation.h"
 #include "vtkInformationVector.h"
 #include "vtkObjectFactory.h"
+#include "vtkSMPTools.h"
+#include "vtkSMPThreadLocal.h"
+#include "vtkSMPThreadLocalObject.h"
+
+#include <vector>
 
 
 vtkStandardNewMacro(vtkvmtkSurfaceDistance);
@@ -40,6 +45,7 @@ vtkvmtkSurfaceDistance::vtkvmtkSurfaceDistance()
   this->DistanceVectorsArrayName = NULL;
   this->SignedDistanceArrayName = NULL;
   this->ReferenceSurface = NULL;
+  this->Projector = vtkvmtkClosestPointProjector::New();
 }
 
 vtkvmtkSurfaceDistance::~vtkvmtkSurfaceDistance()
@@ -67,8 +73,100 @@ vtkvmtkSurfaceDistance::~vtkvmtkSurfaceDistance()
     delete[] this->SignedDistanceArrayName;
     this->SignedDistanceArrayName = NULL;
     }
+
+  this->Projector->Delete();
+  this->Projector = NULL;
 }
 
+class vtkvmtkSurfaceDistanceFunctor
+{
+public:
+  vtkvmtkSurfaceDistanceFunctor(vtkvmtkClosestPointProjector* projector, vtkPolyData* input, vtkDataArray* normals, double* distances, double* distanceVectors, double* signedDistances) :
+    Projector(projector), Input(input), Normals(normals), Distances(distances), DistanceVectors(distanceVectors), SignedDistances(signedDistances) {}
+
+  void Initialize()
+  {
+    this->LocalWeights.Local().resize(this->Projector->GetMaximumCellSize());
+  }
+
+  void operator()(vtkIdType begin, vtkIdType end)
+  {
+    vtkGenericCell* cell = this->LocalCell.Local();
+    std::vector<double>& weights = this->LocalWeights.Local();
+    vtkIdType cellId;
+    int subId;
+    double point[3], closestPoint[3];
+    double distance2, distance, signedDistance;
+    double pcoords[3];
+    double pointNormal[3], normal[3];
+    double distanceVector[3];
+    double dot;
+    for (vtkIdType i=begin; i<end; i++)
+      {
+      this->Input->GetPoint(i,point);
+      this->Projector->FindClosestPoint(point,closestPoint,cell,cellId,subId,distance2,&weights[0]);
+      distanceVector[0] = point[0] - closestPoint[0];
+      distanceVector[1] = point[1] - closestPoint[1];
+      distanceVector[2] = point[2] - closestPoint[2];
+      distance = sqrt(distance2);
+
+      if (this->Distances)
+        {
+        this->Distances[i] = distance;
+        }
+
+      if (this->DistanceVectors)
+        {
+        this->DistanceVectors[3*i+0] = -distanceVector[0];
+        this->DistanceVectors[3*i+1] = -distanceVector[1];
+        this->DistanceVectors[3*i+2] = -distanceVector[2];
+        }
+
+      if (this->SignedDistances && cellId == -1)
+        {
+        this->SignedDistances[i] = distance;
+        }
+      else if (this->SignedDistances)
+        {
+        vtkIdType numberOfCellPoints = cell->GetNumberOfPoints();
+        cell->EvaluatePosition(point,NULL,subId,pcoords,distance2,&weights[0]);
+        pointNormal[0] = 0.0;
+        pointNormal[1] = 0.0;
+        pointNormal[2] = 0.0;
+        for (vtkIdType j=0; j<numberOfCellPoints; j++)
+          {
+          this->Normals->GetTuple(cell->GetPointId(j),normal);
+          pointNormal[0] += weights[j] * normal[0];
+          pointNormal[1] += weights[j] * normal[1];
+          pointNormal[2] += weights[j] * normal[2];
+          }
+        dot = vtkMath::Dot(distanceVector,pointNormal);
+        signedDistance = distance;
+        // distance is positive if distanceVector and normal have negative dot
+        if (dot>0.0)
+          {
+          signedDistance *= -1.0;
+          }
+        this->SignedDistances[i] = signedDistance;
+        }
+      }
+  }
+
+  void Reduce()
+  {
+  }
+
+private:
+  vtkvmtkClosestPointProjector* Projector;
+  vtkPolyData* Input;
+  vtkDataArray* Normals;
+  double* Distances;
+  double* DistanceVectors;
+  double* SignedDistances;
+  vtkSMPThreadLocalObject<vtkGenericCell> LocalCell;
+  vtkSMPThreadLocal<std::vector<double> > LocalWeights;
+};
+
 int vtkvmtkSurfaceDistance::RequestData(
   vtkInformation *vtkNotUsed(request),
   vtkInformationVector **inputVector,
@@ -82,23 +180,10 @@ int vtkvmtkSurfaceDistance::RequestData(
   vtkPolyData *output = vtkPolyData::SafeDownCast(
     outInfo->Get(vtkDataObject::DATA_OBJECT()));
 
-  vtkIdType i, j;
-  vtkIdType numberOfPoints, numberOfCellPoints;
-  vtkIdType cellId, pointId;
-  int subId;
-  double point[3], closestPoint[3];
-  double distance2, distance, signedDistance;
-  double pcoords[3];
-  double pointNormal[3], *normal;
-  double distanceVector[3];
-  double *weights;
-  double dot;
+  vtkIdType numberOfPoints;
   bool computeDistance, computeDistanceVectors, computeSignedDistance;
   vtkDoubleArray *distanceArray, *distanceVectorsArray, *signedDistanceArray;
   vtkDataArray *normals;
-  vtkCellLocator *locator;
-  vtkGenericCell *genericCell;
-  vtkCell *cell;
 
   if (!this->ReferenceSurface)
     {
@@ -117,9 +202,6 @@ int vtkvmtkSurfaceDistance::RequestData(
   signedDistanceArray = vtkDoubleArray::New();
   normals = NULL;
 
-  locator = vtkCellLocator::New();
-  genericCell = vtkGenericCell::New();
-
   numberOfPoints = input->GetNumberOfPoints();
 
   computeDistance = false;
@@ -152,60 +234,21 @@ int vtkvmtkSurfaceDistance::RequestData(
     if (!normals)
       {
       vtkErrorMacro(<<"Signed distance requires point normals to be defined over ReferenceSurface!");
+      distanceArray->Delete();
+      distanceVectorsArray->Delete();
+      signedDistanceArray->Delete();
       return 1;
       }
     }
 
-  locator->SetDataSet(this->ReferenceSurface);
-  locator->BuildLocator();
-
-  for (i=0; i<numberOfPoints; i++)
-    {
-    input->GetPoint(i,point);
-    locator->FindClosestPoint(point,closestPoint,genericCell,cellId,subId,distance2);
-    distanceVector[0] = point[0] - closestPoint[0];
-    distanceVector[1] = point[1] - closestPoint[1];
-    distanceVector[2] = point[2] - closestPoint[2];
-    distance = sqrt(distance2);
-    
-    if (computeDistance)
-      {
-      distanceArray->SetTuple1(i,distance);
-      }
-
-    if (computeDistanceVectors)
-      {
-      distanceVectorsArray->SetTuple3(i,-distanceVector[0],-distanceVector[1],-distanceVector[2]);
-      }
+  this->Projector->SetDataSet(this->ReferenceSurface);
+  this->Projector->BuildLocator();
 
-    if (computeSignedDistance)
-      {
-      cell = this->ReferenceSurface->GetCell(cellId);
-      numberOfCellPoints = cell->GetNumberOfPoints();
-      weights = new double[numberOfCellPoints];
-      cell->EvaluatePosition(point,NULL,subId,pcoords,distance2,weights);
-      pointNormal[0] = 0.0;
-      pointNormal[1] = 0.0;
-      pointNormal[2] = 0.0;
-      for (j=0; j<numberOfCellPoints; j++)
-        {
-        pointId = cell->GetPointId(j);
-        normal = normals->GetTuple3(pointId);
-        pointNormal[0] += weights[j] * normal[0];
-        pointNormal[1] += weights[j] * normal[1];
-        pointNormal[2] += weights[j] * normal[2];
-        }
-      dot = vtkMath::Dot(distanceVector,pointNormal);
-      signedDistance = distance;
-      // distance is positive if distanceVector and normal have negative dot
-      if (dot>0.0)
-        {
-        signedDistance *= -1.0;
-        }
-      signedDistanceArray->SetTuple1(i,signedDistance);
-      delete[] weights;
-      }
-    }
+  vtkvmtkSurfaceDistanceFunctor functor(this->Projector,input,normals,
+    computeDistance ? distanceArray->GetPointer(0) : NULL,
+    computeDistanceVectors ? distanceVectorsArray->GetPointer(0) : NULL,
+    computeSignedDistance ? signedDistanceArray->GetPointer(0) : NULL);
+  vtkSMPTools::For(0,numberOfPoints,functor);
 
   output->DeepCopy(input);
 
@@ -227,8 +270,6 @@ int vtkvmtkSurfaceDistance::RequestData(
   distanceArray->Delete();
   distanceVectorsArray->Delete();
   signedDistanceArray->Delete();
-  locator->Delete();
-  genericCell->Delete();
 
   return 1;
 }
@@ -29,6 +29,8 @@ Version:   $Revision: 1.4 $
 #include "vtkPolyData.h"
 #include "vtkvmtkWin32Header.h"
 
+class vtkvmtkClosestPointProjector;
+
 class vtkPolyData;
 
 class VTK_VMTK_MISC_EXPORT vtkvmtkSurfaceDistance : public vtkPolyDataAlgorithm
@@ -69,6 +71,7 @@ class VTK_VMTK_MISC_EXPORT vtkvmtkSurfaceDistance : public vtkPolyDataAlgorithm
   char *DistanceVectorsArrayName;
   char *SignedDistanceArrayName;
   vtkPolyData *ReferenceSurface;
+  vtkvmtkClosestPointProjector *Projector;
 
   private:
   vtkvmtkSurfaceDistance(const vtkvmtkSurfaceDistance&);  // Not implemented.
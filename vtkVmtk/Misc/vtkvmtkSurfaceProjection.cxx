@@ -21,12 +21,9 @@ Version:   $Revision: 1.4 $
 
 #include "vtkvmtkSurfaceProjection.h"
 
-#include "vtkCellLocator.h"
-#include "vtkDoubleArray.h"
-#include "vtkGenericCell.h"
+#include "vtkvmtkClosestPointProjector.h"
 #include "vtkPolyData.h"
 #include "vtkPointData.h"
-#include "vtkMath.h"
 #include "vtkInformation.h"
 #include "vtkInformationVector.h"
 #include "vtkObjectFactory.h"
@@ -37,6 +34,7 @@ vtkStandardNewMacro(vtkvmtkSurfaceProjection);
 vtkvmtkSurfaceProjection::vtkvmtkSurfaceProjection()
 {
   this->ReferenceSurface = NULL;
+  this->Projector = vtkvmtkClosestPointProjector::New();
 }
 
 vtkvmtkSurfaceProjection::~vtkvmtkSurfaceProjection()
@@ -46,6 +44,9 @@ vtkvmtkSurfaceProjection::~vtkvmtkSurfaceProjection()
     this->ReferenceSurface->Delete();
     this->ReferenceSurface = NULL;
     }
+
+  this->Projector->Delete();
+  this->Projector = NULL;
 }
 
 int vtkvmtkSurfaceProjection::RequestData(
@@ -61,15 +62,6 @@ int vtkvmtkSurfaceProjection::RequestData(
   vtkPolyData *output = vtkPolyData::SafeDownCast(
     outInfo->Get(vtkDataObject::DATA_OBJECT()));
 
-  vtkIdType i;
-  vtkIdType cellId;
-  int subId;
-  double point[3], closestPoint[3];
-  double pcoords[3];
-  double distance2;
-  vtkCellLocator *locator;
-  vtkGenericCell *genericCell;
-
   if (!this->ReferenceSurface)
     {
     vtkErrorMacro(<<"No reference surface!");
@@ -84,42 +76,13 @@ int vtkvmtkSurfaceProjection::RequestData(
   vtkPointData* referencePointData = this->ReferenceSurface->GetPointData();
 
   outputPointData->InterpolateAllocate(referencePointData,numberOfPoints);
-  
-  this->ReferenceSurface->BuildCells();
-
-  locator = vtkCellLocator::New();
-  genericCell = vtkGenericCell::New();
-
-  locator->SetDataSet(this->ReferenceSurface);
-  locator->BuildLocator();
-
-  for (i=0; i<numberOfPoints; i++)
-    {
-    input->GetPoint(i,point);
-    locator->FindClosestPoint(point,closestPoint,genericCell,cellId,subId,distance2);
-    if (this->ReferenceSurface->GetCellType(cellId) != VTK_POLY_LINE)
-      {
-      double* weights = new double[genericCell->GetNumberOfPoints()];
-      genericCell->EvaluatePosition(closestPoint,NULL,subId,pcoords,distance2,weights);
-      outputPointData->InterpolatePoint(referencePointData,i,genericCell->GetPointIds(),weights);
-      delete[] weights;
-      }
-    else
-      {
-      double testPoint0[3], testPoint1[3];
-      vtkIdType pointId = genericCell->GetPointId(subId);
-      input->GetPoint(genericCell->GetPointId(subId),testPoint0);
-      input->GetPoint(genericCell->GetPointId(subId+1),testPoint1);
-      if (vtkMath::Distance2BetweenPoints(closestPoint,testPoint1) < vtkMath::Distance2BetweenPoints(closestPoint,testPoint0))
-        {
-        pointId = genericCell->GetPointId(subId+1);
-        }
-      outputPointData->CopyData(referencePointData,pointId,i);
-      }
-    }
 
-  locator->Delete();
-  genericCell->Delete();
+  // the projection is kept by the projector, so re-executing with new point
+  // data on the same reference geometry only interpolates
+  this->Projector->SetDataSet(this->ReferenceSurface);
+  this->Projector->SnapToPolyLineVerticesOn();
+  this->Projector->ComputeProjection(input->GetPoints());
+  this->Projector->InterpolatePointData(referencePointData,outputPointData);
 
   return 1;
 }
@@ -29,6 +29,8 @@ Version:   $Revision: 1.4 $
 #include "vtkPolyData.h"
 #include "vtkvmtkWin32Header.h"
 
+class vtkvmtkClosestPointProjector;
+
 class vtkPolyData;
 
 class VTK_VMTK_MISC_EXPORT vtkvmtkSurfaceProjection : public vtkPolyDataAlgorithm
@@ -51,6 +53,7 @@ class VTK_VMTK_MISC_EXPORT vtkvmtkSurfaceProjection : public vtkPolyDataAlgorith
   virtual int RequestData(vtkInformation *, vtkInformationVector **, vtkInformationVector *) VTK_OVERRIDE;
 
   vtkPolyData *ReferenceSurface;
+  vtkvmtkClosestPointProjector *Projector;
 
   private:
   vtkvmtkSurfaceProjection(const vtkvmtkSurfaceProjection&);  // Not implemented.
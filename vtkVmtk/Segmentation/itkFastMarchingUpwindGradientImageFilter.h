@@ -164,6 +164,15 @@ public:
   /** Get the number of targets. */
   itkGetConstReferenceMacro( NumberOfTargets, long );
 
+  /** Region typedef support. */
+  typedef typename LevelSetImageType::RegionType AliveRegionType;
+
+  /** Get the smallest region containing all the points that were set alive
+   * during the last update. Its size is zero if no point was set alive.
+   * With target points, this bounds the part of the image swept by the front
+   * and lets callers avoid scanning the whole output. */
+  AliveRegionType GetAliveRegion() const;
+
   /** Get the arrival time corresponding to the last reached target. 
    *  If TargetReachedMode is set to NoTargets, TargetValue contains
    *  the last (aka largest) Eikonal solution value generated. 
@@ -221,6 +230,10 @@ private:
 
   long m_NumberOfTargets;
 
+  bool m_AliveRegionEmpty;
+  IndexType m_AliveIndexMin;
+  IndexType m_AliveIndexMax;
+
 };
 
 } // namespace itk
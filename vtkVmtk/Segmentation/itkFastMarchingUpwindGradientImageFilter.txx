@@ -43,6 +43,7 @@ FastMarchingUpwindGradientImageFilter<TLevelSet,TSpeedImage>
   m_TargetReachedMode = NoTargets;
   m_TargetValue = 0.0;
   m_NumberOfTargets = 0;
+  m_AliveRegionEmpty = true;
 }
 
 
@@ -104,6 +105,8 @@ FastMarchingUpwindGradientImageFilter<TLevelSet,TSpeedImage>
   // Need to reset the target value.
   m_TargetValue = 0.0; 
 
+  m_AliveRegionEmpty = true;
+
   if ( m_TargetReachedMode == SomeTargets || m_TargetReachedMode == AllTargets)
     {
     m_ReachedTargetPoints = NodeContainer::New();
@@ -153,6 +156,22 @@ FastMarchingUpwindGradientImageFilter<TLevelSet,TSpeedImage>
 {
   Superclass::UpdateNeighbors(index,speedImage,output);
 
+  // index has just been set alive, grow the alive bounding region
+  if (m_AliveRegionEmpty)
+    {
+    m_AliveIndexMin = index;
+    m_AliveIndexMax = index;
+    m_AliveRegionEmpty = false;
+    }
+  else
+    {
+    for ( unsigned int j = 0; j < SetDimension; j++ )
+      {
+      m_AliveIndexMin[j] = std::min(m_AliveIndexMin[j],index[j]);
+      m_AliveIndexMax[j] = std::max(m_AliveIndexMax[j],index[j]);
+      }
+    }
+
   if (m_GenerateGradientImage)
     {
     this->ComputeGradient(index, output, this->GetLabelImage(), m_GradientImage);
@@ -241,6 +260,34 @@ FastMarchingUpwindGradientImageFilter<TLevelSet,TSpeedImage>
     }
 }
 
+/**
+ *
+ */
+template <class TLevelSet, class TSpeedImage>
+typename FastMarchingUpwindGradientImageFilter<TLevelSet,TSpeedImage>::AliveRegionType
+FastMarchingUpwindGradientImageFilter<TLevelSet,TSpeedImage>
+::GetAliveRegion() const
+{
+  AliveRegionType region;
+  typename AliveRegionType::SizeType size;
+  size.Fill(0);
+
+  if (m_AliveRegionEmpty)
+    {
+    region.SetSize(size);
+    return region;
+    }
+
+  for ( unsigned int j = 0; j < SetDimension; j++ )
+    {
+    size[j] = static_cast<typename AliveRegionType::SizeValueType>(m_AliveIndexMax[j] - m_AliveIndexMin[j] + 1);
+    }
+  region.SetIndex(m_AliveIndexMin);
+  region.SetSize(size);
+
+  return region;
+}
+
 /**
  *
  */
@@ -11,6 +11,8 @@
 #define __itkVesselEnhancingDiffusion3DImageFilter_h
 
 #include "itkImageToImageFilter.h"
+#include "itkHessianRecursiveGaussianImageFilter.h"
+#include "itkMultiThreader.h"
 #include <vector>
 
 namespace itk
@@ -43,13 +45,20 @@ namespace itk
  *   on vnl datatypes and its eigensystem calculations
  * - note: most of computation time is spent at calculation of vesselness
  *   response
+ * - Hessian/tensor images, the vesselness image and the update image are
+ *   allocated once and reused across iterations; the update image is
+ *   swapped with the current image instead of being copied back.
+ *   Vesselness, diffusion tensor and diffusion passes are multithreaded
+ *   over slabs of the image, and the diffusion tensor is built within the
+ *   vesselness pass of the last scale.
+ * - if ConvergenceThreshold is positive, iterations stop as soon as the
+ *   root mean square change of the image over one iteration drops below it
  *
  * - PixelType      short, 3D
  *   Precision      float, 3D
  *
  *
  * - todo
- *   - using parallelism/threading eg over scales
  *   - completely itk-fying, eg eigenvalues calculation
  *   - possibly embedding within itk-diffusion framework
  *   - itk expert to have a look at use of iterators
@@ -94,6 +103,12 @@ public:
     itkSetMacro(Omega, Precision);
     itkSetMacro(Sensitivity, Precision);
 
+    itkSetMacro(ConvergenceThreshold, Precision);
+    itkGetConstMacro(ConvergenceThreshold, Precision);
+
+    itkGetConstMacro(ElapsedIterations, unsigned int);
+    itkGetConstMacro(RMSChange, Precision);
+
     void SetScales(const std::vector<Precision> scales) 
     { 
         m_Scales = scales; 
@@ -116,6 +131,7 @@ public:
         m_Epsilon                   = 0.01;
         m_Omega                     = 25.0;
         m_Sensitivity               = 5.0;
+        m_ConvergenceThreshold      = 0.0;
 
         m_Scales.resize(5);
         m_Scales[0] = 0.300;
@@ -148,11 +164,14 @@ private:
     Precision           	    m_Epsilon;
     Precision           	    m_Omega;
     Precision           	    m_Sensitivity;
+    Precision                       m_ConvergenceThreshold;
     std::vector<Precision>          m_Scales;   
     bool                            m_DarkObjectLightBackground;
     bool                            m_Verbose;
 
     unsigned int                    m_CurrentIteration;
+    unsigned int                    m_ElapsedIterations;
+    Precision                       m_RMSChange;
 
     // current hessian for which we have max vesselresponse
     typename PrecisionImageType::Pointer m_Dxx;
@@ -162,17 +181,54 @@ private:
     typename PrecisionImageType::Pointer m_Dyz;
     typename PrecisionImageType::Pointer m_Dzz;
 
-    void VED3DSingleIteration (typename ImageType::Pointer );
+    // max vesselness response and next iterate, allocated once
+    typename PrecisionImageType::Pointer m_Vesselness;
+    typename PrecisionImageType::Pointer m_Update;
+
+    typedef HessianRecursiveGaussianImageFilter<PrecisionImageType> 
+                                                            HessianFilterType;
+    typedef typename HessianFilterType::OutputImageType     HessianImageType;
+    typedef typename PrecisionImageType::RegionType         RegionType;
+
+    // performs one diffusion step on ci; on return ci holds the
+    // new iterate (buffers are swapped, not copied)
+    void VED3DSingleIteration (typename PrecisionImageType::Pointer &);
+
+    // allocates hessian/tensor, vesselness and update buffers
+    // with the geometry of the given image
+    void AllocateBuffers (const PrecisionImageType *);
 
     // Calculates maxvessel response of the range
     // of scales and stores the hessian of each voxel
-    // into the member images m_Dij. 
-    void MaxVesselResponse (const typename ImageType::Pointer);
+    // into the member images m_Dij. At the last scale
+    // the hessian is replaced by the diffusion tensor.
+    void MaxVesselResponse (const typename PrecisionImageType::Pointer);
 
-    // calculates diffusion tensor
-    // based on current values of hessian (for which we have
-    // maximim vessel response). 
-    void DiffusionTensor();
+    // calculates diffusion tensor (six components, xx xy xz yy yz zz)
+    // from the hessian (for which we have maximim vessel response). 
+    void DiffusionTensor (const Precision h[6], Precision d[6]);
+
+    void ThreadedMaxVesselResponse (const RegionType &, 
+            const HessianImageType *, bool);
+
+    // returns the sum of squared changes over the region
+    double ThreadedDiffusion (const RegionType &, 
+            const PrecisionImageType *, PrecisionImageType *);
+
+    struct VEDThreadStruct
+    {
+        Self *                          Filter;
+        const HessianImageType *        Hessian;
+        bool                            ComputeTensor;
+        const PrecisionImageType *      Input;
+        PrecisionImageType *            Output;
+        std::vector<double>             SquaredChangeList;
+    };
+
+    unsigned int SplitRegion (unsigned int, unsigned int, RegionType &) const;
+
+    static ITK_THREAD_RETURN_TYPE MaxVesselResponseThreaderCallback (void *);
+    static ITK_THREAD_RETURN_TYPE DiffusionThreaderCallback (void *);
 
     inline Precision VesselnessFunction3D ( // sorted magn increasing
             const Precision,    // l1
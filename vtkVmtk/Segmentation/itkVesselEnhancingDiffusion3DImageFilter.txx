@@ -13,7 +13,6 @@
 
 #include "itkCastImageFilter.h"
 #include "itkConstShapedNeighborhoodIterator.h"
-#include "itkHessianRecursiveGaussianImageFilter.h"
 #include "itkImageRegionConstIterator.h"
 #include "itkImageRegionIterator.h"
 #include "itkMinimumMaximumImageFilter.h"
@@ -25,6 +24,7 @@
 #include <vnl/vnl_matrix.h>
 #include <vnl/algo/vnl_symmetric_eigensystem.h>
 
+#include <algorithm>
 #include<iostream>
 
 namespace itk
@@ -40,7 +40,10 @@ VesselEnhancingDiffusion3DImageFilter<PixelType, Dimension>
     m_Epsilon(0.0),
     m_Omega(0.0),
     m_Sensitivity(0.0),
-    m_DarkObjectLightBackground(false)
+    m_ConvergenceThreshold(0.0),
+    m_DarkObjectLightBackground(false),
+    m_ElapsedIterations(0),
+    m_RMSChange(0.0)
 {
 	this->SetNumberOfRequiredInputs(1);
 }
@@ -61,12 +64,13 @@ void VesselEnhancingDiffusion3DImageFilter<PixelType, Dimension>
 	os << indent << "Epsilon 		            : " << m_Epsilon << std::endl;
 	os << indent << "Omega 			            : " << m_Omega << std::endl;
 	os << indent << "Sensitivity 		        : " << m_Sensitivity << std::endl;
+	os << indent << "ConvergenceThreshold       : " << m_ConvergenceThreshold << std::endl;
   	os << indent << "DarkObjectLightBackground  : " << m_DarkObjectLightBackground << std::endl;
 }
 // singleiter
 template <class PixelType, unsigned int Dimension>
 void VesselEnhancingDiffusion3DImageFilter<PixelType, Dimension>
-::VED3DSingleIteration(typename ImageType::Pointer ci)
+::VED3DSingleIteration(typename PrecisionImageType::Pointer & ci)
 {
     bool rec(false);
     if ( 
@@ -84,7 +88,6 @@ void VesselEnhancingDiffusion3DImageFilter<PixelType, Dimension>
             
         }
         MaxVesselResponse (ci);
-        DiffusionTensor (); 
     }
     if (m_Verbose)
     {
@@ -96,17 +99,38 @@ void VesselEnhancingDiffusion3DImageFilter<PixelType, Dimension>
     }
 
 
-    // calculate d = nonlineardiffusion(ci)
-    // using 3x3x3 stencil, afterwards copy
-    // result from d back to ci
-    typename PrecisionImageType::Pointer d = PrecisionImageType::New();
-    d->SetOrigin(ci->GetOrigin());
-    d->SetSpacing(ci->GetSpacing());
-    d->SetDirection(ci->GetDirection());
-    d->SetRegions(ci->GetLargestPossibleRegion());
-    d->Allocate();
-    d->FillBuffer(NumericTraits<Precision>::Zero);
+    // calculate d = nonlineardiffusion(ci) into the
+    // preallocated update buffer using 3x3x3 stencil,
+    // afterwards swap d and ci
+    VEDThreadStruct str;
+    str.Filter = this;
+    str.Hessian = ITK_NULLPTR;
+    str.ComputeTensor = false;
+    str.Input = ci;
+    str.Output = m_Update;
 
+    this->GetMultiThreader()->SetNumberOfThreads(this->GetNumberOfThreads());
+    this->GetMultiThreader()->SetSingleMethod(this->DiffusionThreaderCallback, &str);
+    str.SquaredChangeList.assign(this->GetMultiThreader()->GetNumberOfThreads(), 0.0);
+    this->GetMultiThreader()->SingleMethodExecute();
+
+    double sumOfSquaredChanges = 0.0;
+    for (unsigned int i=0; i<str.SquaredChangeList.size(); ++i)
+    {
+        sumOfSquaredChanges += str.SquaredChangeList[i];
+    }
+    m_RMSChange = static_cast<Precision>(vcl_sqrt(sumOfSquaredChanges / 
+                ci->GetLargestPossibleRegion().GetNumberOfPixels()));
+
+    std::swap(ci, m_Update);
+
+    return;
+} 
+// threadeddiffusion
+template <class PixelType, unsigned int Dimension>
+double VesselEnhancingDiffusion3DImageFilter<PixelType, Dimension>
+::ThreadedDiffusion(const RegionType & region, const PrecisionImageType * ci, PrecisionImageType * d)
+{
     // shapedneighborhood iter, zeroflux boundary condition
     // division into faces and inner region
     typedef ZeroFluxNeumannBoundaryCondition<PrecisionImageType>    BT;
@@ -141,6 +165,12 @@ void VesselEnhancingDiffusion3DImageFilter<PixelType, Dimension>
     const typename NT::OffsetType oypzm = {{0,1,-1}};
     const typename NT::OffsetType oymzp = {{0,-1,1}};
 
+    const typename NT::OffsetType active[18] = {
+        oxp, oxm, oyp, oym, ozp, ozm,
+        oxpyp, oxmym, oxpym, oxmyp,
+        oxpzp, oxmzm, oxpzm, oxmzp,
+        oypzp, oymzm, oypzm, oymzp };
+
     // fixed weights (timers)
 	const typename PrecisionImageType::SpacingType ispacing = ci->GetSpacing();
     const Precision rxx = m_TimeStep / (2.0 * ispacing[0] * ispacing[0]);
@@ -150,197 +180,38 @@ void VesselEnhancingDiffusion3DImageFilter<PixelType, Dimension>
     const Precision rxz = m_TimeStep / (4.0 * ispacing[0] * ispacing[2]);
     const Precision ryz = m_TimeStep / (4.0 * ispacing[1] * ispacing[2]);
 
-    // faces
+    // faces of this thread's region, shared by all
+    // images since they have the same geometry
     FT                            fc;
-    typename FT::FaceListType     fci = fc(ci,d->GetLargestPossibleRegion(),r);
-    typename FT::FaceListType     fxx = fc(m_Dxx,d->GetLargestPossibleRegion(),r);
-    typename FT::FaceListType     fxy = fc(m_Dxy,d->GetLargestPossibleRegion(),r);
-    typename FT::FaceListType     fxz = fc(m_Dxz,d->GetLargestPossibleRegion(),r);
-    typename FT::FaceListType     fyy = fc(m_Dyy,d->GetLargestPossibleRegion(),r);
-    typename FT::FaceListType     fyz = fc(m_Dyz,d->GetLargestPossibleRegion(),r);
-    typename FT::FaceListType     fzz = fc(m_Dzz,d->GetLargestPossibleRegion(),r);
-
-    typename FT::FaceListType::iterator fitci,fitxx,fitxy,fitxz,fityy,fityz,fitzz;
-
-    for ( fitci = fci.begin(),
-            fitxx = fxx.begin(), fitxy = fxy.begin(), fitxz = fxz.begin(),
-            fityy = fyy.begin(), fityz = fyz.begin(), fitzz = fzz.begin();
-            fitci != fci.end();
-            ++fitci, ++fitxx, ++fitxy, ++fitxz, ++fityy, ++fityz, ++fitzz)
+    typename FT::FaceListType     faces = fc(ci,region,r);
+    typename FT::FaceListType::iterator fit;
+
+    double sumOfSquaredChanges = 0.0;
+
+    for ( fit = faces.begin(); fit != faces.end(); ++fit )
     {
         // output iter
-        ImageRegionIterator<PrecisionImageType> dit(d,*fitci);
+        ImageRegionIterator<PrecisionImageType> dit(d,*fit);
 
         // input iters
-        NT itci (r,ci,*fitci);
-        NT itxx (r,m_Dxx,*fitxx);
-        NT itxy (r,m_Dxy,*fitxy);
-        NT itxz (r,m_Dxz,*fitxz);
-        NT ityy (r,m_Dyy,*fityy);
-        NT ityz (r,m_Dyz,*fityz);
-        NT itzz (r,m_Dzz,*fitzz);
-
-        itci.OverrideBoundaryCondition(&b);
-        itxx.OverrideBoundaryCondition(&b);
-        itxy.OverrideBoundaryCondition(&b);
-        itxz.OverrideBoundaryCondition(&b);
-        ityy.OverrideBoundaryCondition(&b);
-        ityz.OverrideBoundaryCondition(&b);
-        itzz.OverrideBoundaryCondition(&b);
-
-        // setting active offsets (yeah there must
-        // be some smarter way of doing this)
-        itci.ClearActiveList();
-        itxx.ClearActiveList();
-        itxy.ClearActiveList();
-        itxz.ClearActiveList();
-        ityy.ClearActiveList();
-        ityz.ClearActiveList();
-        itzz.ClearActiveList();
-
-        itci.ActivateOffset(oxp);
-        itxx.ActivateOffset(oxp);
-        itxy.ActivateOffset(oxp);
-        itxz.ActivateOffset(oxp);
-        ityy.ActivateOffset(oxp);
-        ityz.ActivateOffset(oxp);
-        itzz.ActivateOffset(oxp);
-
-        itci.ActivateOffset(oxm);
-        itxx.ActivateOffset(oxm);
-        itxy.ActivateOffset(oxm);
-        itxz.ActivateOffset(oxm);
-        ityy.ActivateOffset(oxm);
-        ityz.ActivateOffset(oxm);
-        itzz.ActivateOffset(oxm);
-
-        itci.ActivateOffset(oyp);
-        itxx.ActivateOffset(oyp);
-        itxy.ActivateOffset(oyp);
-        itxz.ActivateOffset(oyp);
-        ityy.ActivateOffset(oyp);
-        ityz.ActivateOffset(oyp);
-        itzz.ActivateOffset(oyp);
-
-        itci.ActivateOffset(oym);
-        itxx.ActivateOffset(oym);
-        itxy.ActivateOffset(oym);
-        itxz.ActivateOffset(oym);
-        ityy.ActivateOffset(oym);
-        ityz.ActivateOffset(oym);
-        itzz.ActivateOffset(oym);
-
-        itci.ActivateOffset(ozp);
-        itxx.ActivateOffset(ozp);
-        itxy.ActivateOffset(ozp);
-        itxz.ActivateOffset(ozp);
-        ityy.ActivateOffset(ozp);
-        ityz.ActivateOffset(ozp);
-        itzz.ActivateOffset(ozp);
-
-        itci.ActivateOffset(ozm);
-        itxx.ActivateOffset(ozm);
-        itxy.ActivateOffset(ozm);
-        itxz.ActivateOffset(ozm);
-        ityy.ActivateOffset(ozm);
-        ityz.ActivateOffset(ozm);
-        itzz.ActivateOffset(ozm);
-
-        itci.ActivateOffset(oxpyp);
-        itxx.ActivateOffset(oxpyp);
-        itxy.ActivateOffset(oxpyp);
-        itxz.ActivateOffset(oxpyp);
-        ityy.ActivateOffset(oxpyp);
-        ityz.ActivateOffset(oxpyp);
-        itzz.ActivateOffset(oxpyp);
-
-        itci.ActivateOffset(oxmym);
-        itxx.ActivateOffset(oxmym);
-        itxy.ActivateOffset(oxmym);
-        itxz.ActivateOffset(oxmym);
-        ityy.ActivateOffset(oxmym);
-        ityz.ActivateOffset(oxmym);
-        itzz.ActivateOffset(oxmym);
-
-        itci.ActivateOffset(oxpym);
-        itxx.ActivateOffset(oxpym);
-        itxy.ActivateOffset(oxpym);
-        itxz.ActivateOffset(oxpym);
-        ityy.ActivateOffset(oxpym);
-        ityz.ActivateOffset(oxpym);
-        itzz.ActivateOffset(oxpym);
-
-        itci.ActivateOffset(oxmyp);
-        itxx.ActivateOffset(oxmyp);
-        itxy.ActivateOffset(oxmyp);
-        itxz.ActivateOffset(oxmyp);
-        ityy.ActivateOffset(oxmyp);
-        ityz.ActivateOffset(oxmyp);
-        itzz.ActivateOffset(oxmyp);
-
-        itci.ActivateOffset(oxpzp);
-        itxx.ActivateOffset(oxpzp);
-        itxy.ActivateOffset(oxpzp);
-        itxz.ActivateOffset(oxpzp);
-        ityy.ActivateOffset(oxpzp);
-        ityz.ActivateOffset(oxpzp);
-        itzz.ActivateOffset(oxpzp);
-
-        itci.ActivateOffset(oxmzm);
-        itxx.ActivateOffset(oxmzm);
-        itxy.ActivateOffset(oxmzm);
-        itxz.ActivateOffset(oxmzm);
-        ityy.ActivateOffset(oxmzm);
-        ityz.ActivateOffset(oxmzm);
-        itzz.ActivateOffset(oxmzm);
-
-        itci.ActivateOffset(oxpzm);
-        itxx.ActivateOffset(oxpzm);
-        itxy.ActivateOffset(oxpzm);
-        itxz.ActivateOffset(oxpzm);
-        ityy.ActivateOffset(oxpzm);
-        ityz.ActivateOffset(oxpzm);
-        itzz.ActivateOffset(oxpzm);
-
-        itci.ActivateOffset(oxmzp);
-        itxx.ActivateOffset(oxmzp);
-        itxy.ActivateOffset(oxmzp);
-        itxz.ActivateOffset(oxmzp);
-        ityy.ActivateOffset(oxmzp);
-        ityz.ActivateOffset(oxmzp);
-        itzz.ActivateOffset(oxmzp);
-
-        itci.ActivateOffset(oypzp);
-        itxx.ActivateOffset(oypzp);
-        itxy.ActivateOffset(oypzp);
-        itxz.ActivateOffset(oypzp);
-        ityy.ActivateOffset(oypzp);
-        ityz.ActivateOffset(oypzp);
-        itzz.ActivateOffset(oypzp);
-
-        itci.ActivateOffset(oymzm);
-        itxx.ActivateOffset(oymzm);
-        itxy.ActivateOffset(oymzm);
-        itxz.ActivateOffset(oymzm);
-        ityy.ActivateOffset(oymzm);
-        ityz.ActivateOffset(oymzm);
-        itzz.ActivateOffset(oymzm);
-
-        itci.ActivateOffset(oypzm);
-        itxx.ActivateOffset(oypzm);
-        itxy.ActivateOffset(oypzm);
-        itxz.ActivateOffset(oypzm);
-        ityy.ActivateOffset(oypzm);
-        ityz.ActivateOffset(oypzm);
-        itzz.ActivateOffset(oypzm);
-
-        itci.ActivateOffset(oymzp);
-        itxx.ActivateOffset(oymzp);
-        itxy.ActivateOffset(oymzp);
-        itxz.ActivateOffset(oymzp);
-        ityy.ActivateOffset(oymzp);
-        ityz.ActivateOffset(oymzp);
-        itzz.ActivateOffset(oymzp);
+        NT itci (r,ci,*fit);
+        NT itxx (r,m_Dxx,*fit);
+        NT itxy (r,m_Dxy,*fit);
+        NT itxz (r,m_Dxz,*fit);
+        NT ityy (r,m_Dyy,*fit);
+        NT ityz (r,m_Dyz,*fit);
+        NT itzz (r,m_Dzz,*fit);
+
+        NT * its[7] = { &itci, &itxx, &itxy, &itxz, &ityy, &ityz, &itzz };
+        for (unsigned int k=0; k<7; ++k)
+        {
+            its[k]->OverrideBoundaryCondition(&b);
+            its[k]->ClearActiveList();
+            for (unsigned int j=0; j<18; ++j)
+            {
+                its[k]->ActivateOffset(active[j]);
+            }
+        }
 
         // run for each face diffusion
         for (itci.GoToBegin(), dit.GoToBegin(),
@@ -374,7 +245,7 @@ void VesselEnhancingDiffusion3DImageFilter<PixelType, Dimension>
 
             // evolution
             const Precision cv = itci.GetCenterPixel();
-            dit.Value() = cv + 
+            const Precision nv = cv 
                 + rxx * ( xp * (itci.GetPixel(oxp) - cv)
                         + xm * (itci.GetPixel(oxm) - cv) )
                 + ryy * ( yp * (itci.GetPixel(oyp) - cv)
@@ -394,113 +265,169 @@ void VesselEnhancingDiffusion3DImageFilter<PixelType, Dimension>
                         + ypzm * (itci.GetPixel(oypzm) - cv)
                         + ymzp * (itci.GetPixel(oymzp) - cv) );
 
+            dit.Value() = nv;
+            sumOfSquaredChanges += (nv - cv) * (nv - cv);
         }
     }
 
-    // copying
-    ImageRegionConstIterator<PrecisionImageType> iti (d,d->GetLargestPossibleRegion());
-    ImageRegionIterator<PrecisionImageType>      ito (ci,ci->GetLargestPossibleRegion());
-    for (iti.GoToBegin(), ito.GoToBegin(); !iti.IsAtEnd(); ++iti,++ito)
+    return sumOfSquaredChanges;
+}
+// allocatebuffers
+template <class PixelType, unsigned int Dimension>
+void VesselEnhancingDiffusion3DImageFilter<PixelType, Dimension>
+::AllocateBuffers(const PrecisionImageType * im)
+{
+    typename PrecisionImageType::Pointer * buffers[8] = {
+        &m_Dxx, &m_Dxy, &m_Dxz, &m_Dyy, &m_Dyz, &m_Dzz, 
+        &m_Vesselness, &m_Update };
+
+    for (unsigned int i=0; i<8; ++i)
     {
-        ito.Value() = iti.Value();
+        typename PrecisionImageType::Pointer buffer = PrecisionImageType::New();
+        buffer->SetOrigin(im->GetOrigin());
+        buffer->SetSpacing(im->GetSpacing());
+        buffer->SetDirection(im->GetDirection());
+        buffer->SetRegions(im->GetLargestPossibleRegion());
+        buffer->Allocate();
+        *buffers[i] = buffer;
     }
 
     return;
-} 
+}
+// splitregion
+template <class PixelType, unsigned int Dimension>
+unsigned int VesselEnhancingDiffusion3DImageFilter<PixelType, Dimension>
+::SplitRegion(unsigned int i, unsigned int num, RegionType & region) const
+{
+    region = m_Vesselness->GetLargestPossibleRegion();
+    return this->GetImageRegionSplitter()->GetSplit(i, num, region);
+}
+// threadercallbacks
+template <class PixelType, unsigned int Dimension>
+ITK_THREAD_RETURN_TYPE
+VesselEnhancingDiffusion3DImageFilter<PixelType, Dimension>
+::MaxVesselResponseThreaderCallback(void * arg)
+{
+    const ThreadIdType threadId = ((MultiThreader::ThreadInfoStruct *)(arg))->ThreadID;
+    const ThreadIdType threadCount = ((MultiThreader::ThreadInfoStruct *)(arg))->NumberOfThreads;
+
+    VEDThreadStruct * str = (VEDThreadStruct *)(((MultiThreader::ThreadInfoStruct *)(arg))->UserData);
+
+    RegionType splitRegion;
+    const unsigned int total = str->Filter->SplitRegion(threadId, threadCount, splitRegion);
+
+    if (threadId < total)
+    {
+        str->Filter->ThreadedMaxVesselResponse(splitRegion, str->Hessian, str->ComputeTensor);
+    }
+
+    return ITK_THREAD_RETURN_VALUE;
+}
+
+template <class PixelType, unsigned int Dimension>
+ITK_THREAD_RETURN_TYPE
+VesselEnhancingDiffusion3DImageFilter<PixelType, Dimension>
+::DiffusionThreaderCallback(void * arg)
+{
+    const ThreadIdType threadId = ((MultiThreader::ThreadInfoStruct *)(arg))->ThreadID;
+    const ThreadIdType threadCount = ((MultiThreader::ThreadInfoStruct *)(arg))->NumberOfThreads;
+
+    VEDThreadStruct * str = (VEDThreadStruct *)(((MultiThreader::ThreadInfoStruct *)(arg))->UserData);
+
+    RegionType splitRegion;
+    const unsigned int total = str->Filter->SplitRegion(threadId, threadCount, splitRegion);
+
+    if (threadId < total)
+    {
+        str->SquaredChangeList[threadId] = 
+            str->Filter->ThreadedDiffusion(splitRegion, str->Input, str->Output);
+    }
+
+    return ITK_THREAD_RETURN_VALUE;
+}
 // maxvesselresponse
 template <class PixelType, unsigned int Dimension>
 void VesselEnhancingDiffusion3DImageFilter<PixelType, Dimension>
-::MaxVesselResponse(const typename ImageType::Pointer im)	
+::MaxVesselResponse(const typename PrecisionImageType::Pointer im)	
 {
 
-    // alloc memory for hessian/tensor
-    m_Dxx = PrecisionImageType::New();
-    m_Dxx->SetOrigin(im->GetOrigin());
-    m_Dxx->SetSpacing(im->GetSpacing());
-    m_Dxx->SetDirection(im->GetDirection());
-    m_Dxx->SetRegions(im->GetLargestPossibleRegion());
-    m_Dxx->Allocate();
+    // reset hessian/tensor and vesselness buffers
     m_Dxx->FillBuffer(NumericTraits<Precision>::One);
-
-    m_Dxy = PrecisionImageType::New();
-    m_Dxy->SetOrigin(im->GetOrigin());
-    m_Dxy->SetSpacing(im->GetSpacing());
-    m_Dxy->SetDirection(im->GetDirection());
-    m_Dxy->SetRegions(im->GetLargestPossibleRegion());
-    m_Dxy->Allocate();
     m_Dxy->FillBuffer(NumericTraits<Precision>::Zero);
-
-    m_Dxz = PrecisionImageType::New();
-    m_Dxz->SetOrigin(im->GetOrigin());
-    m_Dxz->SetSpacing(im->GetSpacing());
-    m_Dxz->SetDirection(im->GetDirection());
-    m_Dxz->SetRegions(im->GetLargestPossibleRegion());
-    m_Dxz->Allocate();
     m_Dxz->FillBuffer(NumericTraits<Precision>::Zero);
-
-    m_Dyy = PrecisionImageType::New();
-    m_Dyy->SetOrigin(im->GetOrigin());
-    m_Dyy->SetSpacing(im->GetSpacing());
-    m_Dyy->SetDirection(im->GetDirection());
-    m_Dyy->SetRegions(im->GetLargestPossibleRegion());
-    m_Dyy->Allocate();
     m_Dyy->FillBuffer(NumericTraits<Precision>::One);
-
-    m_Dyz = PrecisionImageType::New();
-    m_Dyz->SetOrigin(im->GetOrigin());
-    m_Dyz->SetSpacing(im->GetSpacing());
-    m_Dyz->SetDirection(im->GetDirection());
-    m_Dyz->SetRegions(im->GetLargestPossibleRegion());
-    m_Dyz->Allocate();
     m_Dyz->FillBuffer(NumericTraits<Precision>::Zero);
-
-    m_Dzz = PrecisionImageType::New();
-    m_Dzz->SetOrigin(im->GetOrigin());
-    m_Dzz->SetSpacing(im->GetSpacing());
-    m_Dzz->SetDirection(im->GetDirection());
-    m_Dzz->SetRegions(im->GetLargestPossibleRegion());
-    m_Dzz->Allocate();
     m_Dzz->FillBuffer(NumericTraits<Precision>::One);
+    m_Vesselness->FillBuffer(NumericTraits<Precision>::Zero);
 
+    VEDThreadStruct str;
+    str.Filter = this;
+    str.Hessian = ITK_NULLPTR;
+    str.ComputeTensor = true;
+    str.Input = ITK_NULLPTR;
+    str.Output = ITK_NULLPTR;
 
-	// create temp vesselness image to store maxvessel
-	typename PrecisionImageType::Pointer vi = PrecisionImageType::New();
+    this->GetMultiThreader()->SetNumberOfThreads(this->GetNumberOfThreads());
 
-	vi->SetOrigin(im->GetOrigin());
-	vi->SetSpacing(im->GetSpacing());
-	vi->SetDirection(im->GetDirection());
-	vi->SetRegions(im->GetLargestPossibleRegion());
-	vi->Allocate();
-    vi->FillBuffer(NumericTraits<Precision>::Zero);
-    
+    // no scales, the tensor is built from the identity hessian
+    if (m_Scales.empty())
+    {
+        this->GetMultiThreader()->SetSingleMethod(this->MaxVesselResponseThreaderCallback, &str);
+        this->GetMultiThreader()->SingleMethodExecute();
+        return;
+    }
 
 	for (unsigned int i=0; i< m_Scales.size(); ++i)
 	{
-        typedef HessianRecursiveGaussianImageFilter<PrecisionImageType> HessianType;
-        typename HessianType::Pointer hessian = HessianType::New();
+        typename HessianFilterType::Pointer hessian = HessianFilterType::New();
         hessian->SetInput(im);
         hessian->SetNormalizeAcrossScale(true);
         hessian->SetSigma(m_Scales[i]);
+        hessian->SetNumberOfThreads(this->GetNumberOfThreads());
         hessian->Update();
 
-        ImageRegionIterator<PrecisionImageType> itxx (m_Dxx, m_Dxx->GetLargestPossibleRegion());
-        ImageRegionIterator<PrecisionImageType> itxy (m_Dxy, m_Dxy->GetLargestPossibleRegion());
-        ImageRegionIterator<PrecisionImageType> itxz (m_Dxz, m_Dxz->GetLargestPossibleRegion());
-        ImageRegionIterator<PrecisionImageType> ityy (m_Dyy, m_Dyy->GetLargestPossibleRegion());
-        ImageRegionIterator<PrecisionImageType> ityz (m_Dyz, m_Dyz->GetLargestPossibleRegion());
-        ImageRegionIterator<PrecisionImageType> itzz (m_Dzz, m_Dzz->GetLargestPossibleRegion());
-        ImageRegionIterator<PrecisionImageType> vit(vi, vi->GetLargestPossibleRegion());
-
-        ImageRegionConstIterator<typename HessianType::OutputImageType> hit 
-            (hessian->GetOutput(), hessian->GetOutput()->GetLargestPossibleRegion());
-
-        for (itxx.GoToBegin(), itxy.GoToBegin(), itxz.GoToBegin(), 
-                ityy.GoToBegin(), ityz.GoToBegin(), itzz.GoToBegin(),
-                vit.GoToBegin(), hit.GoToBegin(); !vit.IsAtEnd(); 
-                ++itxx, ++itxy, ++itxz, ++ityy, ++ityz, ++itzz, ++hit, ++vit)
-        {
-            vnl_matrix<Precision> H(3,3);
+        // at the last scale the max response is final, so
+        // the diffusion tensor is computed in the same pass
+        str.Hessian = hessian->GetOutput();
+        str.ComputeTensor = (i == m_Scales.size() - 1);
+
+        this->GetMultiThreader()->SetSingleMethod(this->MaxVesselResponseThreaderCallback, &str);
+        this->GetMultiThreader()->SingleMethodExecute();
+	} 
+ 
+    return;
 
+}
+// threadedmaxvesselresponse
+template <class PixelType, unsigned int Dimension>
+void VesselEnhancingDiffusion3DImageFilter<PixelType, Dimension>
+::ThreadedMaxVesselResponse(const RegionType & region, const HessianImageType * hessian, bool computeTensor)
+{
+    ImageRegionIterator<PrecisionImageType> itxx (m_Dxx, region);
+    ImageRegionIterator<PrecisionImageType> itxy (m_Dxy, region);
+    ImageRegionIterator<PrecisionImageType> itxz (m_Dxz, region);
+    ImageRegionIterator<PrecisionImageType> ityy (m_Dyy, region);
+    ImageRegionIterator<PrecisionImageType> ityz (m_Dyz, region);
+    ImageRegionIterator<PrecisionImageType> itzz (m_Dzz, region);
+    ImageRegionIterator<PrecisionImageType> vit(m_Vesselness, region);
+
+    ImageRegionConstIterator<HessianImageType> hit; 
+    if (hessian)
+    {
+        hit = ImageRegionConstIterator<HessianImageType>(hessian, region);
+        hit.GoToBegin();
+    }
+
+    vnl_matrix<Precision> H(3,3);
+    vnl_vector<Precision> ev(3);
+
+    for (itxx.GoToBegin(), itxy.GoToBegin(), itxz.GoToBegin(), 
+            ityy.GoToBegin(), ityz.GoToBegin(), itzz.GoToBegin(),
+            vit.GoToBegin(); !vit.IsAtEnd(); 
+            ++itxx, ++itxy, ++itxz, ++ityy, ++ityz, ++itzz, ++vit)
+    {
+        if (hessian)
+        {
             H(0,0) = hit.Value()(0,0);
             H(0,1) = H(1,0) = hit.Value()(0,1);
             H(0,2) = H(2,0) = hit.Value()(0,2);
@@ -509,7 +436,6 @@ void VesselEnhancingDiffusion3DImageFilter<PixelType, Dimension>
             H(2,2) = hit.Value()(2,2);
 
             vnl_symmetric_eigensystem<Precision> ES(H);
-            vnl_vector<Precision> ev(3);
 
             ev[0] = ES.get_eigenvalue(0); 
             ev[1] = ES.get_eigenvalue(1); 
@@ -532,11 +458,28 @@ void VesselEnhancingDiffusion3DImageFilter<PixelType, Dimension>
                 ityz.Value() = hit.Value()(1,2);
                 itzz.Value() = hit.Value()(2,2);
 			}
-		} 
+
+            ++hit;
+        }
+
+        if (computeTensor)
+        {
+            const Precision h[6] = { itxx.Value(), itxy.Value(), itxz.Value(),
+                                     ityy.Value(), ityz.Value(), itzz.Value() };
+            Precision d[6];
+
+            DiffusionTensor(h, d);
+
+            itxx.Value() = d[0];
+            itxy.Value() = d[1];
+            itxz.Value() = d[2];
+            ityy.Value() = d[3];
+            ityz.Value() = d[4];
+            itzz.Value() = d[5];
+        }
 	} 
- 
-    return;
 
+    return;
 }
 // vesselnessfunction
 template <class PixelType, unsigned int Dimension>
@@ -584,68 +527,56 @@ return vesselness;
 // diffusiontensor
 template <class PixelType, unsigned int Dimension>
 void VesselEnhancingDiffusion3DImageFilter<PixelType, Dimension>
-::DiffusionTensor() 
+::DiffusionTensor(const Precision h[6], Precision d[6]) 
 {
-    ImageRegionIterator<PrecisionImageType> itxx (m_Dxx, m_Dxx->GetLargestPossibleRegion());
-    ImageRegionIterator<PrecisionImageType> itxy (m_Dxy, m_Dxy->GetLargestPossibleRegion());
-    ImageRegionIterator<PrecisionImageType> itxz (m_Dxz, m_Dxz->GetLargestPossibleRegion());
-    ImageRegionIterator<PrecisionImageType> ityy (m_Dyy, m_Dyy->GetLargestPossibleRegion());
-    ImageRegionIterator<PrecisionImageType> ityz (m_Dyz, m_Dyz->GetLargestPossibleRegion());
-    ImageRegionIterator<PrecisionImageType> itzz (m_Dzz, m_Dzz->GetLargestPossibleRegion());
-
-    for  ( itxx.GoToBegin(), itxy.GoToBegin(), itxz.GoToBegin(),
-            ityy.GoToBegin(), ityz.GoToBegin(), itzz.GoToBegin();
-            !itxx.IsAtEnd();
-            ++itxx, ++itxy, ++itxz, ++ityy, ++ityz, ++itzz)
-    {
-        vnl_matrix<Precision> H(3,3);
-        H(0,0) = itxx.Value();
-        H(0,1) = H(1,0) = itxy.Value();
-        H(0,2) = H(2,0) = itxz.Value();
-        H(1,1) = ityy.Value();
-        H(1,2) = H(2,1) = ityz.Value();
-        H(2,2) = itzz.Value();
-
-        vnl_symmetric_eigensystem<Precision> ES(H);
-
-        vnl_matrix<Precision> EV(3,3);
-        EV.set_column(0,ES.get_eigenvector(0));
-        EV.set_column(1,ES.get_eigenvector(1));
-        EV.set_column(2,ES.get_eigenvector(2));
-
-        vnl_vector<Precision> ev(3);
-        ev[0] = ES.get_eigenvalue(0);
-        ev[1] = ES.get_eigenvalue(1);
-        ev[2] = ES.get_eigenvalue(2);
-
-        if ( vcl_abs(ev[0]) > vcl_abs(ev[1])  ) std::swap(ev[0], ev[1]);
-        if ( vcl_abs(ev[1]) > vcl_abs(ev[2])  ) std::swap(ev[1], ev[2]);
-        if ( vcl_abs(ev[0]) > vcl_abs(ev[1])  ) std::swap(ev[0], ev[1]);
-
-        const Precision V=VesselnessFunction3D(ev[0],ev[1],ev[2]);
-        vnl_vector<Precision> evn(3);
-
-        // adjusting eigenvalues
-        // static_cast required to prevent error with gcc 4.1.2
-        evn[0]   = 1.0 + (m_Epsilon - 1.0) * vcl_pow(V,static_cast<Precision>(1.0/m_Sensitivity));
-        evn[1]   = 1.0 + (m_Epsilon - 1.0) * vcl_pow(V,static_cast<Precision>(1.0/m_Sensitivity)); 
-        evn[2]   = 1.0 + (m_Omega - 1.0 ) * vcl_pow(V,static_cast<Precision>(1.0/m_Sensitivity)); 
-
-        vnl_matrix<Precision> LAM(3,3);
-        LAM.fill(0);
-        LAM(0,0) = evn[0];
-        LAM(1,1) = evn[1];
-        LAM(2,2) = evn[2];
-
-        const vnl_matrix<Precision> HN = EV * LAM * EV.transpose();
-
-        itxx.Value() = HN(0,0);
-        itxy.Value() = HN(0,1);
-        itxz.Value() = HN(0,2);
-        ityy.Value() = HN(1,1);
-        ityz.Value() = HN(1,2);
-        itzz.Value() = HN(2,2);
-    }
+    vnl_matrix<Precision> H(3,3);
+    H(0,0) = h[0];
+    H(0,1) = H(1,0) = h[1];
+    H(0,2) = H(2,0) = h[2];
+    H(1,1) = h[3];
+    H(1,2) = H(2,1) = h[4];
+    H(2,2) = h[5];
+
+    vnl_symmetric_eigensystem<Precision> ES(H);
+
+    vnl_matrix<Precision> EV(3,3);
+    EV.set_column(0,ES.get_eigenvector(0));
+    EV.set_column(1,ES.get_eigenvector(1));
+    EV.set_column(2,ES.get_eigenvector(2));
+
+    vnl_vector<Precision> ev(3);
+    ev[0] = ES.get_eigenvalue(0);
+    ev[1] = ES.get_eigenvalue(1);
+    ev[2] = ES.get_eigenvalue(2);
+
+    if ( vcl_abs(ev[0]) > vcl_abs(ev[1])  ) std::swap(ev[0], ev[1]);
+    if ( vcl_abs(ev[1]) > vcl_abs(ev[2])  ) std::swap(ev[1], ev[2]);
+    if ( vcl_abs(ev[0]) > vcl_abs(ev[1])  ) std::swap(ev[0], ev[1]);
+
+    const Precision V=VesselnessFunction3D(ev[0],ev[1],ev[2]);
+    vnl_vector<Precision> evn(3);
+
+    // adjusting eigenvalues
+    // static_cast required to prevent error with gcc 4.1.2
+    evn[0]   = 1.0 + (m_Epsilon - 1.0) * vcl_pow(V,static_cast<Precision>(1.0/m_Sensitivity));
+    evn[1]   = 1.0 + (m_Epsilon - 1.0) * vcl_pow(V,static_cast<Precision>(1.0/m_Sensitivity)); 
+    evn[2]   = 1.0 + (m_Omega - 1.0 ) * vcl_pow(V,static_cast<Precision>(1.0/m_Sensitivity)); 
+
+    vnl_matrix<Precision> LAM(3,3);
+    LAM.fill(0);
+    LAM(0,0) = evn[0];
+    LAM(1,1) = evn[1];
+    LAM(2,2) = evn[2];
+
+    const vnl_matrix<Precision> HN = EV * LAM * EV.transpose();
+
+    d[0] = HN(0,0);
+    d[1] = HN(0,1);
+    d[2] = HN(0,2);
+    d[3] = HN(1,1);
+    d[4] = HN(1,2);
+    d[5] = HN(2,2);
+
     return;
 
 } 
@@ -707,6 +638,9 @@ void VesselEnhancingDiffusion3DImageFilter<PixelType, Dimension>
 
     typename PrecisionImageType::Pointer ci = cast->GetOutput();
 
+    AllocateBuffers (ci);
+    m_ElapsedIterations = 0;
+    m_RMSChange = NumericTraits<Precision>::Zero;
 
     if (m_Verbose)
     {
@@ -716,8 +650,25 @@ void VesselEnhancingDiffusion3DImageFilter<PixelType, Dimension>
 	for (m_CurrentIteration=1; m_CurrentIteration<=m_Iterations; m_CurrentIteration++)
     {
         VED3DSingleIteration (ci);
+        m_ElapsedIterations = m_CurrentIteration;
+        this->UpdateProgress(static_cast<float>(m_CurrentIteration) / m_Iterations);
+
+        if ( m_ConvergenceThreshold > NumericTraits<Precision>::Zero &&
+                m_RMSChange < m_ConvergenceThreshold )
+        {
+            if (m_Verbose)
+            {
+                std::cout << std::endl << "converged at iteration " << m_CurrentIteration
+                          << ", rms change " << m_RMSChange;
+            }
+            break;
+        }
     } 
 
+    // the update and vesselness buffers are not needed anymore
+    m_Update = ITK_NULLPTR;
+    m_Vesselness = ITK_NULLPTR;
+
     typedef MinimumMaximumImageFilter<PrecisionImageType> MMT;
     typename MMT::Pointer mm = MMT::New();
     mm->SetInput(ci);
@@ -27,6 +27,7 @@ Version:   $Revision: 1.3 $
 #include "vtkvmtkActiveTubeFilter.h"
 
 #include "vtkvmtkCardinalSpline.h"
+#include "vtkvmtkImageTrilinearStencil.h"
 
 #include "vtkvmtkConstants.h"
 #include "vtkMath.h"
@@ -36,14 +37,14 @@ Version:   $Revision: 1.3 $
 #include "vtkImageGradient.h"
 #include "vtkDoubleArray.h"
 
-#include "vtkPolyLine.h"
-#include "vtkVoxel.h"
+#include "vtkSMPTools.h"
 
 #include "vtkInformation.h"
 #include "vtkInformationVector.h"
 #include "vtkObjectFactory.h"
 #include "vtkVersion.h"
 
+#include <vector>
 
 vtkStandardNewMacro(vtkvmtkActiveTubeFilter);
 
@@ -95,99 +96,83 @@ vtkCxxSetObjectMacro(vtkvmtkActiveTubeFilter,PotentialImage,vtkImageData);
 
 void vtkvmtkActiveTubeFilter::EvaluateForce(double point[3], double force[3], bool normalize)
 {
-  int ijk[3];
-  double pcoords[3];
+  this->EvaluateForces(1,point,force,normalize);
+}
+
+void vtkvmtkActiveTubeFilter::EvaluateForces(vtkIdType numberOfPoints, const double* points, double* forces, bool normalize)
+{
+  vtkIdType pointIds[8];
   double weights[8];
-  int inBounds;
+  vtkIdType p;
   int i;
 
-  force[0] = force[1] = force[2] = 0.0;
-
-  inBounds = this->PotentialGradientImage->ComputeStructuredCoordinates(point,ijk,pcoords);
+  // the gradient image is always double, see RequestData
+  double* gradientVectors = static_cast<vtkDoubleArray*>(this->PotentialGradientImage->GetPointData()->GetScalars())->GetPointer(0);
 
-  if (!inBounds)
+  for (p=0; p<numberOfPoints; p++)
     {
-    //vtkWarningMacro("Point out of extent");
-    return;
-    }
+    double* force = forces + 3*p;
 
-  vtkCell* cell = this->PotentialGradientImage->GetCell(this->PotentialGradientImage->ComputeCellId(ijk));
+    force[0] = force[1] = force[2] = 0.0;
 
-  if (cell->GetCellType() == VTK_VOXEL)
-  {
-    vtkVoxel::InterpolationFunctions(pcoords,weights);
-  }
-  else
-  {
-    vtkErrorMacro("Non voxel cell found in PotentialImage");
-  }
-
-  int numberOfCellPoints = cell->GetNumberOfPoints();
-
-  vtkDataArray* gradientVectorsArray = this->PotentialGradientImage->GetPointData()->GetScalars();
-
-  for (i=0; i<numberOfCellPoints; i++)
-  {
-    double vectorValue[3];
-    gradientVectorsArray->GetTuple(cell->GetPointId(i),vectorValue);
-    force[0] += weights[i] * vectorValue[0];
-    force[1] += weights[i] * vectorValue[1];
-    force[2] += weights[i] * vectorValue[2];
-  }
-
-  if (normalize && this->PotentialMaxNorm > VTK_VMTK_DOUBLE_TOL)
-  {
-    force[0] /= this->PotentialMaxNorm;
-    force[1] /= this->PotentialMaxNorm;
-    force[2] /= this->PotentialMaxNorm;
-  }
-
-  force[0] *= -1.0;
-  force[1] *= -1.0;
-  force[2] *= -1.0;
+    if (!vtkvmtkImageTrilinearStencil::Compute(this->PotentialGradientImage,points+3*p,pointIds,weights))
+      {
+      //vtkWarningMacro("Point out of extent");
+      continue;
+      }
+
+    for (i=0; i<8; i++)
+      {
+      const double* vectorValue = gradientVectors + 3*pointIds[i];
+      force[0] += weights[i] * vectorValue[0];
+      force[1] += weights[i] * vectorValue[1];
+      force[2] += weights[i] * vectorValue[2];
+      }
+
+    if (normalize && this->PotentialMaxNorm > VTK_VMTK_DOUBLE_TOL)
+      {
+      force[0] /= this->PotentialMaxNorm;
+      force[1] /= this->PotentialMaxNorm;
+      force[2] /= this->PotentialMaxNorm;
+      }
+
+    force[0] *= -1.0;
+    force[1] *= -1.0;
+    force[2] *= -1.0;
+    }
 }
 
 double vtkvmtkActiveTubeFilter::EvaluatePotential(double point[3])
 {
-  int ijk[3];
-  double pcoords[3];
+  double potential = 0.0;
+  this->EvaluatePotentials(1,point,&potential);
+  return potential;
+}
+
+void vtkvmtkActiveTubeFilter::EvaluatePotentials(vtkIdType numberOfPoints, const double* points, double* potentials)
+{
+  vtkIdType pointIds[8];
   double weights[8];
-  int inBounds;
+  vtkIdType p;
   int i;
 
-  double potential = 0.0;
-
-  inBounds = this->PotentialImage->ComputeStructuredCoordinates(point,ijk,pcoords);
+  vtkDataArray* potentialArray = this->PotentialImage->GetPointData()->GetScalars();
 
-  if (!inBounds)
+  for (p=0; p<numberOfPoints; p++)
     {
-    //vtkWarningMacro("Point out of extent");
-    return 0.0;
-    }
-
-  vtkCell* cell = this->PotentialImage->GetCell(this->PotentialImage->ComputeCellId(ijk));
+    potentials[p] = 0.0;
 
-  if (cell->GetCellType() == VTK_VOXEL)
-  {
-    vtkVoxel::InterpolationFunctions(pcoords,weights);
-  }
-  else
-  {
-    vtkErrorMacro("Non voxel cell found in PotentialImage");
-    return 0.0;
-  }
-
-  int numberOfCellPoints = cell->GetNumberOfPoints();
-
-  vtkDataArray* potentialArray = this->PotentialImage->GetPointData()->GetScalars();
-
-  for (i=0; i<numberOfCellPoints; i++)
-  {
-    double value = potentialArray->GetTuple1(cell->GetPointId(i));
-    potential += weights[i] * value;
-  }
+    if (!vtkvmtkImageTrilinearStencil::Compute(this->PotentialImage,points+3*p,pointIds,weights))
+      {
+      //vtkWarningMacro("Point out of extent");
+      continue;
+      }
 
-  return potential;
+    for (i=0; i<8; i++)
+      {
+      potentials[p] += weights[i] * potentialArray->GetComponent(pointIds[i],0);
+      }
+    }
 }
 
 void vtkvmtkActiveTubeFilter::EvolveCellSpline(vtkPolyData* lines, vtkIdType cellId)
@@ -195,33 +180,42 @@ void vtkvmtkActiveTubeFilter::EvolveCellSpline(vtkPolyData* lines, vtkIdType cel
   //TODO: whip strategy - from start to end of spline, create displacement field simulating
   //inertia (i.e. force on a point dependent on displacement on previous point)
 
-  vtkDataArray* radiusArray = lines->GetPointData()->GetArray(this->RadiusArrayName);
+  // only thread-safe accessors are used here, since independent
+  // cells are evolved concurrently (see RequestData)
 
-  vtkPolyLine* polyLine = vtkPolyLine::SafeDownCast(lines->GetCell(cellId));
+  vtkDataArray* radiusArray = lines->GetPointData()->GetArray(this->RadiusArrayName);
 
-  if (!polyLine)
+  if (lines->GetCellType(cellId) != VTK_POLY_LINE)
     {
     return;
     }
 
-  vtkPoints* polyLinePoints = polyLine->GetPoints();
+  vtkIdType npts, *pointIds;
+  lines->GetCellPoints(cellId,npts,pointIds);
+
+  int numberOfPoints = static_cast<int>(npts);
+  int numberOfSubIds = numberOfPoints - 1;
+
+  std::vector<double> cellPoints(3*numberOfPoints);
+  std::vector<double> cellRadii(numberOfPoints);
+  std::vector<double> parametricCoordinates(numberOfPoints);
+
+  int i, j;
+  for (i=0; i<numberOfPoints; i++)
+    {
+    lines->GetPoint(pointIds[i],&cellPoints[3*i]);
+    cellRadii[i] = radiusArray->GetComponent(pointIds[i],0);
+    }
 
   vtkvmtkCardinalSpline* xSpline = vtkvmtkCardinalSpline::New();
   vtkvmtkCardinalSpline* ySpline = vtkvmtkCardinalSpline::New();
   vtkvmtkCardinalSpline* zSpline = vtkvmtkCardinalSpline::New();
   vtkvmtkCardinalSpline* rSpline = vtkvmtkCardinalSpline::New();
 
-  int numberOfPoints = polyLine->GetNumberOfPoints();
-  int numberOfSubIds = numberOfPoints - 1;
-
   double cellLength = 0.0;
-  double point0[3], point1[3];
-  int i;
   for (i=0; i<numberOfSubIds; i++)
     {
-    polyLinePoints->GetPoint(i,point0);
-    polyLinePoints->GetPoint(i+1,point1);
-    cellLength += sqrt(vtkMath::Distance2BetweenPoints(point0,point1));
+    cellLength += sqrt(vtkMath::Distance2BetweenPoints(&cellPoints[3*i],&cellPoints[3*(i+1)]));
     }
 
   xSpline->SetParametricRange(0.0,cellLength);
@@ -229,89 +223,82 @@ void vtkvmtkActiveTubeFilter::EvolveCellSpline(vtkPolyData* lines, vtkIdType cel
   zSpline->SetParametricRange(0.0,cellLength);
   rSpline->SetParametricRange(0.0,cellLength);
 
-  vtkDoubleArray* parametricCoordinates = vtkDoubleArray::New();
-  parametricCoordinates->SetNumberOfTuples(numberOfPoints);
-
   double currentLength = 0.0; 
-  polyLinePoints->GetPoint(0,point0);
-  double radius = radiusArray->GetTuple1(polyLine->GetPointId(0));
   double t = 0.0;
-  xSpline->AddPoint(0.0,point0[0]);
-  ySpline->AddPoint(0.0,point0[1]);
-  zSpline->AddPoint(0.0,point0[2]);
-  rSpline->AddPoint(0.0,radius);
-  parametricCoordinates->SetValue(0,0.0);
+  xSpline->AddPoint(0.0,cellPoints[0]);
+  ySpline->AddPoint(0.0,cellPoints[1]);
+  zSpline->AddPoint(0.0,cellPoints[2]);
+  rSpline->AddPoint(0.0,cellRadii[0]);
+  parametricCoordinates[0] = 0.0;
   for (i=1; i<numberOfPoints; i++)
     {
-    polyLinePoints->GetPoint(i-1,point0);
-    polyLinePoints->GetPoint(i,point1);
-    radius = radiusArray->GetTuple1(polyLine->GetPointId(i));
-    currentLength += sqrt(vtkMath::Distance2BetweenPoints(point0,point1));
+    currentLength += sqrt(vtkMath::Distance2BetweenPoints(&cellPoints[3*(i-1)],&cellPoints[3*i]));
     t = currentLength;
-    xSpline->AddPoint(t,point1[0]);
-    ySpline->AddPoint(t,point1[1]);
-    zSpline->AddPoint(t,point1[2]);
-    rSpline->AddPoint(t,radius);
-    parametricCoordinates->SetValue(i,t);
+    xSpline->AddPoint(t,cellPoints[3*i]);
+    ySpline->AddPoint(t,cellPoints[3*i+1]);
+    zSpline->AddPoint(t,cellPoints[3*i+2]);
+    rSpline->AddPoint(t,cellRadii[i]);
+    parametricCoordinates[i] = t;
     }
 
   if (this->SplineResamplingWhileIterating)
     {
-    double point[3];
     for (i=0; i<numberOfPoints; i++)
       {
       t = (double)i / (numberOfPoints-1) * cellLength;
-      point[0] = xSpline->Evaluate(t);
-      point[1] = ySpline->Evaluate(t);
-      point[2] = zSpline->Evaluate(t);
-      radius = rSpline->Evaluate(t);
-      polyLinePoints->SetPoint(i,point);
-      radiusArray->SetTuple1(i,radius);
-      parametricCoordinates->SetValue(i,t);
+      cellPoints[3*i] = xSpline->Evaluate(t);
+      cellPoints[3*i+1] = ySpline->Evaluate(t);
+      cellPoints[3*i+2] = zSpline->Evaluate(t);
+      cellRadii[i] = rSpline->Evaluate(t);
+      parametricCoordinates[i] = t;
       }
     }
- 
-  vtkDoubleArray* probedForces = vtkDoubleArray::New();
-  probedForces->SetNumberOfComponents(3);
-  probedForces->SetNumberOfTuples(this->NumberOfAngularEvaluations);
-
-  vtkDoubleArray* tubeNormals = vtkDoubleArray::New();
-  tubeNormals->SetNumberOfComponents(3);
-  tubeNormals->SetNumberOfTuples(this->NumberOfAngularEvaluations);
-  
-  vtkDoubleArray* dxArray = vtkDoubleArray::New();
-  dxArray->SetNumberOfTuples(numberOfPoints);
-  dxArray->FillComponent(0,0.0);
-  vtkDoubleArray* dyArray = vtkDoubleArray::New();
-  dyArray->SetNumberOfTuples(numberOfPoints);
-  dyArray->FillComponent(0,0.0);
-  vtkDoubleArray* dzArray = vtkDoubleArray::New();
-  dzArray->SetNumberOfTuples(numberOfPoints);
-  dzArray->FillComponent(0,0.0);
-  vtkDoubleArray* drArray = vtkDoubleArray::New();
-  drArray->SetNumberOfTuples(numberOfPoints);
-  drArray->FillComponent(0,0.0);
 
   //TODO: choose numberOfLongitudinalEvaluations with a strategy 
   //      (fixed number, based on length, adaptive - higher curve or radius derivatives, more points)
   int numberOfLongitudinalEvaluations = numberOfPoints * 3 / 2;
- 
+  int numberOfAngularEvaluations = this->NumberOfAngularEvaluations;
+
+  // values and first and second derivatives of the splines at all
+  // longitudinal samples, evaluated in one sweep per spline
+  std::vector<double> longitudinalCoordinates(numberOfLongitudinalEvaluations);
   for (i=0; i<numberOfLongitudinalEvaluations; i++)
     {
-    t = (double)i / (numberOfLongitudinalEvaluations-1) * cellLength;
-    double x = xSpline->Evaluate(t);
-    double y = ySpline->Evaluate(t);
-    double z = zSpline->Evaluate(t);
-    double r = rSpline->Evaluate(t);
-    double xp = xSpline->EvaluateDerivative(t);
-    double yp = ySpline->EvaluateDerivative(t);
-    double zp = zSpline->EvaluateDerivative(t);
-    double rp = rSpline->EvaluateDerivative(t);
-    double xpp = xSpline->EvaluateSecondDerivative(t);
-    double ypp = ySpline->EvaluateSecondDerivative(t);
-    double zpp = zSpline->EvaluateSecondDerivative(t);
-    double rpp = rSpline->EvaluateSecondDerivative(t);
-  
+    longitudinalCoordinates[i] = (double)i / (numberOfLongitudinalEvaluations-1) * cellLength;
+    }
+
+  std::vector<double> xSamples(3*numberOfLongitudinalEvaluations);
+  std::vector<double> ySamples(3*numberOfLongitudinalEvaluations);
+  std::vector<double> zSamples(3*numberOfLongitudinalEvaluations);
+  std::vector<double> rSamples(3*numberOfLongitudinalEvaluations);
+
+  if (numberOfLongitudinalEvaluations > 0)
+    {
+    xSpline->EvaluateValuesAndDerivatives(numberOfLongitudinalEvaluations,&longitudinalCoordinates[0],&xSamples[0]);
+    ySpline->EvaluateValuesAndDerivatives(numberOfLongitudinalEvaluations,&longitudinalCoordinates[0],&ySamples[0]);
+    zSpline->EvaluateValuesAndDerivatives(numberOfLongitudinalEvaluations,&longitudinalCoordinates[0],&zSamples[0]);
+    rSpline->EvaluateValuesAndDerivatives(numberOfLongitudinalEvaluations,&longitudinalCoordinates[0],&rSamples[0]);
+    }
+
+  // tube surface samples for all valid longitudinal samples
+  std::vector<int> validSampleIds;
+  validSampleIds.reserve(numberOfLongitudinalEvaluations);
+  std::vector<double> tubeNormals;
+  tubeNormals.reserve(static_cast<size_t>(3*numberOfLongitudinalEvaluations*numberOfAngularEvaluations));
+  std::vector<double> probePoints;
+  probePoints.reserve(static_cast<size_t>(3*numberOfLongitudinalEvaluations*numberOfAngularEvaluations));
+
+  for (i=0; i<numberOfLongitudinalEvaluations; i++)
+    {
+    double x = xSamples[3*i];
+    double y = ySamples[3*i];
+    double z = zSamples[3*i];
+    double r = rSamples[3*i];
+    double xp = xSamples[3*i+1];
+    double yp = ySamples[3*i+1];
+    double zp = zSamples[3*i+1];
+    double rp = rSamples[3*i+1];
+
     double tangent[3], normal[3];
  
     tangent[0] = xp; 
@@ -332,16 +319,13 @@ void vtkvmtkActiveTubeFilter::EvolveCellSpline(vtkPolyData* lines, vtkIdType cel
     
     double tubeNorm = sqrt(tubeNormSquared);
 
-    double isotropicForce = 0.0;
-    double anisotropicForce[3];
-    anisotropicForce[0] = anisotropicForce[1] = anisotropicForce[2] = 0.0;
+    validSampleIds.push_back(i);
 
-    double tubeNormal[3], probePoint[3], probedForce[3];
+    double tubeNormal[3];
     double theta;
-    int j;
-    for (j=0; j<this->NumberOfAngularEvaluations; j++)
+    for (j=0; j<numberOfAngularEvaluations; j++)
       {
-      theta = j * 2.0 * vtkMath::Pi() / this->NumberOfAngularEvaluations;
+      theta = j * 2.0 * vtkMath::Pi() / numberOfAngularEvaluations;
 
       vtkMath::Perpendiculars(tangent,normal,NULL,theta);
 
@@ -351,63 +335,86 @@ void vtkvmtkActiveTubeFilter::EvolveCellSpline(vtkPolyData* lines, vtkIdType cel
       //optional, but better be on the safe side
       vtkMath::Normalize(tubeNormal);
 
-      probePoint[0] = x + tubeNormal[0] * r;
-      probePoint[1] = y + tubeNormal[1] * r;
-      probePoint[2] = z + tubeNormal[2] * r;
+      tubeNormals.push_back(tubeNormal[0]);
+      tubeNormals.push_back(tubeNormal[1]);
+      tubeNormals.push_back(tubeNormal[2]);
+
+      probePoints.push_back(x + tubeNormal[0] * r);
+      probePoints.push_back(y + tubeNormal[1] * r);
+      probePoints.push_back(z + tubeNormal[2] * r);
+      }
+    }
+
+  int numberOfValidSamples = static_cast<int>(validSampleIds.size());
+  vtkIdType numberOfProbes = static_cast<vtkIdType>(numberOfValidSamples) * numberOfAngularEvaluations;
+
+  std::vector<double> probedForces(3*numberOfProbes);
+  if (numberOfProbes > 0)
+    {
+    this->EvaluateForces(numberOfProbes,&probePoints[0],&probedForces[0],false);
+    }
+
+  std::vector<double> dxArray(numberOfPoints,0.0);
+  std::vector<double> dyArray(numberOfPoints,0.0);
+  std::vector<double> dzArray(numberOfPoints,0.0);
+  std::vector<double> drArray(numberOfPoints,0.0);
 
-      //double probedPotential = this->EvaluatePotential(probePoint);
+  int k;
+  for (k=0; k<numberOfValidSamples; k++)
+    {
+    i = validSampleIds[k];
+    t = longitudinalCoordinates[i];
+    double xpp = xSamples[3*i+2];
+    double ypp = ySamples[3*i+2];
+    double zpp = zSamples[3*i+2];
+    double rpp = rSamples[3*i+2];
 
-      this->EvaluateForce(probePoint,probedForce,false);
+    const double* sampleForces = &probedForces[3*k*numberOfAngularEvaluations];
+    const double* sampleNormals = &tubeNormals[3*k*numberOfAngularEvaluations];
 
-      probedForces->SetTuple(j,probedForce);
-      tubeNormals->SetTuple(j,tubeNormal);
+    double isotropicForce = 0.0;
+    double anisotropicForce[3];
+    anisotropicForce[0] = anisotropicForce[1] = anisotropicForce[2] = 0.0;
 
-      isotropicForce += vtkMath::Dot(probedForce,tubeNormal);
+    for (j=0; j<numberOfAngularEvaluations; j++)
+      {
+      isotropicForce += vtkMath::Dot(sampleForces+3*j,sampleNormals+3*j);
       }
 
-    isotropicForce /= this->NumberOfAngularEvaluations;
+    isotropicForce /= numberOfAngularEvaluations;
 
-    for (j=0; j<this->NumberOfAngularEvaluations; j++)
+    for (j=0; j<numberOfAngularEvaluations; j++)
       {
-      probedForces->GetTuple(j,probedForce);
-      tubeNormals->GetTuple(j,tubeNormal);
+      const double* probedForce = sampleForces + 3*j;
+      const double* tubeNormal = sampleNormals + 3*j;
       anisotropicForce[0] += probedForce[0] - tubeNormal[0] * isotropicForce;
       anisotropicForce[1] += probedForce[1] - tubeNormal[1] * isotropicForce;
       anisotropicForce[2] += probedForce[2] - tubeNormal[2] * isotropicForce;
       }
 
-    anisotropicForce[0] /= this->NumberOfAngularEvaluations;
-    anisotropicForce[1] /= this->NumberOfAngularEvaluations;
-    anisotropicForce[2] /= this->NumberOfAngularEvaluations;
+    anisotropicForce[0] /= numberOfAngularEvaluations;
+    anisotropicForce[1] /= numberOfAngularEvaluations;
+    anisotropicForce[2] /= numberOfAngularEvaluations;
 
     //TODO: define influence (based on parametric distance? Or also consider derivatives?)
     //      implement Gaussian RBF?
     for (j=0; j<numberOfPoints; j++)
       {
-      double parametricCoordinate = parametricCoordinates->GetValue(j);
+      double parametricCoordinate = parametricCoordinates[j];
       double influence = 0.1 * cellLength;
       if (fabs(parametricCoordinate-t) > influence)
         {
         continue;
         }
       double weight = (influence - fabs(parametricCoordinate-t)) / influence; 
-      double dx, dy, dz, dr;
-      dx = dxArray->GetValue(j);
-      dy = dyArray->GetValue(j);
-      dz = dzArray->GetValue(j);
-      dr = drArray->GetValue(j);
-      dx += anisotropicForce[0] * weight * this->PotentialWeight;
-      dy += anisotropicForce[1] * weight * this->PotentialWeight;
-      dz += anisotropicForce[2] * weight * this->PotentialWeight;
-      dr += isotropicForce * weight * this->PotentialWeight;
-      dx += xpp * weight * this->StiffnessWeight;
-      dy += ypp * weight * this->StiffnessWeight;
-      dz += zpp * weight * this->StiffnessWeight;
-      dr += rpp * weight * this->StiffnessWeight;
-      dxArray->SetValue(j,dx); 
-      dyArray->SetValue(j,dy); 
-      dzArray->SetValue(j,dz); 
-      drArray->SetValue(j,dr); 
+      dxArray[j] += anisotropicForce[0] * weight * this->PotentialWeight;
+      dyArray[j] += anisotropicForce[1] * weight * this->PotentialWeight;
+      dzArray[j] += anisotropicForce[2] * weight * this->PotentialWeight;
+      drArray[j] += isotropicForce * weight * this->PotentialWeight;
+      dxArray[j] += xpp * weight * this->StiffnessWeight;
+      dyArray[j] += ypp * weight * this->StiffnessWeight;
+      dzArray[j] += zpp * weight * this->StiffnessWeight;
+      drArray[j] += rpp * weight * this->StiffnessWeight;
       }
     }
 
@@ -432,10 +439,10 @@ void vtkvmtkActiveTubeFilter::EvolveCellSpline(vtkPolyData* lines, vtkIdType cel
   double maxChange = 0.0;
   for (i=0; i<numberOfPoints; i++)
     {
-    double dx = dxArray->GetValue(i);
-    double dy = dyArray->GetValue(i);
-    double dz = dzArray->GetValue(i);
-    double dr = drArray->GetValue(i);
+    double dx = dxArray[i];
+    double dy = dyArray[i];
+    double dz = dzArray[i];
+    double dr = drArray[i];
     double change = sqrt(dx*dx + dy*dy + dz*dz) + dr;
     maxChange = change > maxChange ? change : maxChange;
     }
@@ -451,16 +458,14 @@ void vtkvmtkActiveTubeFilter::EvolveCellSpline(vtkPolyData* lines, vtkIdType cel
     }
 
   vtkIdType pointId;
-  double point[3];
+  double point[3], radius;
   for (i=0; i<numberOfPoints; i++)
     {
-    pointId = polyLine->GetPointId(i);
-    polyLinePoints->GetPoint(i,point);
-    radius = radiusArray->GetTuple1(pointId);
-    point[0] += dxArray->GetValue(i) * timeStep;
-    point[1] += dyArray->GetValue(i) * timeStep;
-    point[2] += dzArray->GetValue(i) * timeStep;
-    radius += drArray->GetValue(i) * timeStep;
+    pointId = pointIds[i];
+    point[0] = cellPoints[3*i] + dxArray[i] * timeStep;
+    point[1] = cellPoints[3*i+1] + dyArray[i] * timeStep;
+    point[2] = cellPoints[3*i+2] + dzArray[i] * timeStep;
+    radius = cellRadii[i] + drArray[i] * timeStep;
     if (radius < this->MinimumRadius)
       {
       radius = this->MinimumRadius;
@@ -471,7 +476,7 @@ void vtkvmtkActiveTubeFilter::EvolveCellSpline(vtkPolyData* lines, vtkIdType cel
       }
     if (!(this->FixedEndpointRadius && (i==0 || i==numberOfPoints-1)))
       {
-      radiusArray->SetTuple1(pointId,radius);
+      radiusArray->SetComponent(pointId,0,radius);
       }
     }
 
@@ -481,15 +486,29 @@ void vtkvmtkActiveTubeFilter::EvolveCellSpline(vtkPolyData* lines, vtkIdType cel
   ySpline->Delete();
   zSpline->Delete();
   rSpline->Delete();
-  parametricCoordinates->Delete();
-  probedForces->Delete();
-  tubeNormals->Delete();
-  dxArray->Delete();
-  dyArray->Delete();
-  dzArray->Delete();
-  drArray->Delete();
 }
 
+class vtkvmtkActiveTubeFilterEvolveCellsFunctor
+{
+public:
+  vtkvmtkActiveTubeFilterEvolveCellsFunctor(vtkvmtkActiveTubeFilter* filter, vtkPolyData* lines)
+    {
+    this->Filter = filter;
+    this->Lines = lines;
+    }
+
+  void operator()(vtkIdType begin, vtkIdType end)
+    {
+    for (vtkIdType c=begin; c<end; c++)
+      {
+      this->Filter->EvolveCellSpline(this->Lines,c);
+      }
+    }
+
+  vtkvmtkActiveTubeFilter* Filter;
+  vtkPolyData* Lines;
+};
+
 int vtkvmtkActiveTubeFilter::RequestData(vtkInformation *vtkNotUsed(request), vtkInformationVector **inputVector, vtkInformationVector *outputVector)
 {
   vtkInformation *inInfo = inputVector[0]->GetInformationObject(0);
@@ -532,22 +551,56 @@ int vtkvmtkActiveTubeFilter::RequestData(vtkInformation *vtkNotUsed(request), vt
   this->PotentialGradientImage = vtkImageData::New();
   this->PotentialGradientImage->DeepCopy(gradientFilter->GetOutput());
 
+  gradientFilter->Delete();
+
+  if (!vtkDoubleArray::SafeDownCast(this->PotentialGradientImage->GetPointData()->GetScalars()))
+    {
+    vtkErrorMacro("Error: potential gradient is not of type double.");
+    return 0;
+    }
+
   this->PotentialMaxNorm = this->PotentialGradientImage->GetPointData()->GetScalars()->GetMaxNorm();
 
-  int numberOfCells = output->GetNumberOfCells();  
+  vtkIdType numberOfCells = output->GetNumberOfCells();
+
+  // cells can be evolved concurrently as long as they do not share points
+  output->BuildCells();
+  bool independentCells = true;
+  std::vector<char> pointVisited(output->GetNumberOfPoints(),0);
+  vtkIdType c;
+  for (c=0; c<numberOfCells && independentCells; c++)
+    {
+    vtkIdType npts, *pts;
+    output->GetCellPoints(c,npts,pts);
+    for (vtkIdType j=0; j<npts; j++)
+      {
+      if (pointVisited[pts[j]])
+        {
+        independentCells = false;
+        break;
+        }
+      pointVisited[pts[j]] = 1;
+      }
+    }
+
+  vtkvmtkActiveTubeFilterEvolveCellsFunctor evolveCells(this,output);
 
   int i;
   for (i=0; i<this->NumberOfIterations; i++)
     {
-    int c;
-    for (c=0; c<numberOfCells; c++)
+    if (independentCells)
       {
-      this->EvolveCellSpline(output,c);
+      vtkSMPTools::For(0,numberOfCells,evolveCells);
+      }
+    else
+      {
+      for (c=0; c<numberOfCells; c++)
+        {
+        this->EvolveCellSpline(output,c);
+        }
       }
     }
 
-  gradientFilter->Delete();
-
   return 1;
 }
 
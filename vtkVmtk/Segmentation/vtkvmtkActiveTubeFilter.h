@@ -98,6 +98,12 @@ class VTK_VMTK_SEGMENTATION_EXPORT vtkvmtkActiveTubeFilter : public vtkPolyDataA
   void EvaluateForce(double point[3], double force[3], bool normalize);
   double EvaluatePotential(double point[3]);
 
+  // Description:
+  // Batched versions of EvaluateForce and EvaluatePotential, sampling the
+  // images by direct trilinear indexing. They are safe to call concurrently.
+  void EvaluateForces(vtkIdType numberOfPoints, const double* points, double* forces, bool normalize);
+  void EvaluatePotentials(vtkIdType numberOfPoints, const double* points, double* potentials);
+
   static bool IsInExtent(vtkIdType extent[6], int ijk[3], vtkIdType border)
     {
     return (ijk[0]>=extent[0]+border && ijk[0]<=extent[1]-border) && (ijk[1]>=extent[2]+border && ijk[1]<=extent[3]-border) && (ijk[2]>=extent[4]+border && ijk[2]<=extent[5]-border) ? true : false;
@@ -110,6 +116,8 @@ class VTK_VMTK_SEGMENTATION_EXPORT vtkvmtkActiveTubeFilter : public vtkPolyDataA
 
   void EvolveCellSpline(vtkPolyData* lines, vtkIdType cellId);
 
+  friend class vtkvmtkActiveTubeFilterEvolveCellsFunctor;
+
   char* RadiusArrayName;
 
   vtkImageData *PotentialImage;
@@ -43,7 +43,8 @@ void vtkvmtkBoundedReciprocalImageFilter::SimpleExecute(vtkImageData* input, vtk
   typedef itk::BoundedReciprocalImageFilter<ImageType, ImageType> BoundedReciprocalFilterType;
   BoundedReciprocalFilterType::Pointer boundedReciprocalFilter = BoundedReciprocalFilterType::New();
   boundedReciprocalFilter->SetInput(inImage);
+  boundedReciprocalFilter->GetOutput()->SetRequestedRegion(vtkvmtkITKFilterUtilities::ExtentToRegion<ImageType>(output->GetExtent()));
   boundedReciprocalFilter->Update();
 
-  vtkvmtkITKFilterUtilities::ITKToVTKImage<ImageType>(boundedReciprocalFilter->GetOutput(),output);
+  vtkvmtkITKFilterUtilities::ITKToVTKImageExtent<ImageType>(boundedReciprocalFilter->GetOutput(),output);
 }
@@ -31,14 +31,14 @@ Version:   $Revision: 1.3 $
 #ifndef __vtkvmtkBoundedReciprocalImageFilter_h
 #define __vtkvmtkBoundedReciprocalImageFilter_h
 
-#include "vtkSimpleImageToImageFilter.h"
+#include "vtkvmtkStreamingImageToImageFilter.h"
 #include "vtkvmtkWin32Header.h"
 
-class VTK_VMTK_SEGMENTATION_EXPORT vtkvmtkBoundedReciprocalImageFilter : public vtkSimpleImageToImageFilter
+class VTK_VMTK_SEGMENTATION_EXPORT vtkvmtkBoundedReciprocalImageFilter : public vtkvmtkStreamingImageToImageFilter
 {
  public:
   static vtkvmtkBoundedReciprocalImageFilter *New();
-  vtkTypeMacro(vtkvmtkBoundedReciprocalImageFilter, vtkSimpleImageToImageFilter);
+  vtkTypeMacro(vtkvmtkBoundedReciprocalImageFilter, vtkvmtkStreamingImageToImageFilter);
 
 protected:
 
@@ -175,6 +175,72 @@ void vtkvmtkCardinalSpline::EvaluateValueAndDerivatives(double t, double valueAn
                               2 * *(coefficients + index * 4 + 2);
 }
 
+void vtkvmtkCardinalSpline::EvaluateValuesAndDerivatives(vtkIdType numberOfValues, const double* t, double* valuesAndDerivatives)
+{
+  int index;
+  double *intervals;
+  double *coefficients;
+  vtkIdType i;
+
+  if (this->ComputeTime < this->GetMTime())
+    {
+    this->Compute();
+    }
+
+  int size = this->PiecewiseFunction->GetSize();
+  if (size < 2)
+    {
+    for (i=0; i<3*numberOfValues; i++)
+      {
+      valuesAndDerivatives[i] = 0.0;
+      }
+    return;
+    }
+
+  intervals = this->Intervals;
+  coefficients = this->Coefficients;
+
+  if (this->Closed)
+    {
+    size = size + 1;
+    }
+
+  index = -1;
+  for (i=0; i<numberOfValues; i++)
+    {
+    double ti = t[i];
+
+    if (ti < intervals[0])
+      {
+      ti = intervals[0];
+      }
+    if (ti > intervals[size - 1])
+      {
+      ti = intervals[size - 1];
+      }
+
+    if (index < 0 || ti < intervals[index])
+      {
+      index = this->FindIndex(size,ti);
+      }
+    else
+      {
+      while (index < size - 2 && ti > intervals[index + 1])
+        {
+        index++;
+        }
+      }
+
+    ti = (ti - intervals[index]);
+
+    double* coefficient = coefficients + index * 4;
+
+    valuesAndDerivatives[3*i] = (ti * (ti * (ti * coefficient[3] + coefficient[2]) + coefficient[1]) + coefficient[0]);
+    valuesAndDerivatives[3*i+1] = 3 * ti * ti * coefficient[3] + 2 * ti * coefficient[2] + coefficient[1];
+    valuesAndDerivatives[3*i+2] = 6 * ti * coefficient[3] + 2 * coefficient[2];
+    }
+}
+
 void vtkvmtkCardinalSpline::PrintSelf(ostream& os, vtkIndent indent)
 {
   this->Superclass::PrintSelf(os,indent);
@@ -48,6 +48,12 @@ public:
 
   virtual void EvaluateValueAndDerivatives(double t, double valueAndDerivatives[3]);
 
+  // Description:
+  // Evaluate value, first and second derivative at numberOfValues parametric
+  // coordinates, stored as consecutive triplets in valuesAndDerivatives.
+  // The interval search is incremental when t is non-decreasing.
+  virtual void EvaluateValuesAndDerivatives(vtkIdType numberOfValues, const double* t, double* valuesAndDerivatives);
+
 protected:
   vtkvmtkCardinalSpline();
   ~vtkvmtkCardinalSpline() {}
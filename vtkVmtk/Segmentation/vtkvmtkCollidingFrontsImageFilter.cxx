@@ -27,7 +27,11 @@ Version:   $Revision: 1.1 $
 #include "vtkvmtkITKFilterUtilities.h"
 #include "vtkObjectFactory.h"
 
-#include "itkCollidingFrontsImageFilter.h"
+#include "itkFastMarchingUpwindGradientImageFilter.h"
+#include "itkConnectedThresholdImageFilter.h"
+#include "itkImageRegionConstIterator.h"
+#include "itkImageRegionIterator.h"
+#include "itkMultiThreader.h"
 
 // TODO Remove
 #include "vtkPointData.h"
@@ -35,6 +39,58 @@ Version:   $Revision: 1.1 $
 
 vtkStandardNewMacro(vtkvmtkCollidingFrontsImageFilter);
 
+typedef itk::Image<float,3> vtkvmtkCollidingFrontsImageType;
+typedef itk::FastMarchingUpwindGradientImageFilter<vtkvmtkCollidingFrontsImageType,vtkvmtkCollidingFrontsImageType> vtkvmtkCollidingFrontsFastMarchingFilterType;
+
+struct vtkvmtkCollidingFrontsThreadStruct
+{
+  vtkvmtkCollidingFrontsFastMarchingFilterType* Filters[2];
+  bool Failed[2];
+};
+
+static ITK_THREAD_RETURN_TYPE vtkvmtkCollidingFrontsThreaderCallback(void* arg)
+{
+  itk::MultiThreader::ThreadInfoStruct* info = static_cast<itk::MultiThreader::ThreadInfoStruct*>(arg);
+  vtkvmtkCollidingFrontsThreadStruct* str = static_cast<vtkvmtkCollidingFrontsThreadStruct*>(info->UserData);
+
+  // one front per thread, both on the same thread if only one was spawned
+  for (unsigned int i=info->ThreadID; i<2; i+=info->NumberOfThreads)
+    {
+    try
+      {
+      str->Filters[i]->Update();
+      }
+    catch (itk::ExceptionObject& excep)
+      {
+      std::cerr << excep << std::endl;
+      str->Failed[i] = true;
+      }
+    }
+
+  return ITK_THREAD_RETURN_VALUE;
+}
+
+static vtkvmtkCollidingFrontsFastMarchingFilterType::NodeContainerPointer vtkvmtkCollidingFrontsBuildNodes(vtkImageData* input, vtkvmtkCollidingFrontsImageType* image, vtkIdList* seeds)
+{
+  typedef vtkvmtkCollidingFrontsFastMarchingFilterType FastMarchingFilterType;
+
+  FastMarchingFilterType::NodeContainerPointer nodes = FastMarchingFilterType::NodeContainer::New();
+  nodes->Initialize();
+  for (int i=0; i<seeds->GetNumberOfIds(); i++)
+    {
+    // TODO: here we get the point. We should get the cell center instead.
+    vtkvmtkCollidingFrontsImageType::PointType seedPoint(input->GetPoint(seeds->GetId(i)));
+    FastMarchingFilterType::NodeType::IndexType seedIndex;
+    image->TransformPhysicalPointToIndex(seedPoint,seedIndex);
+    FastMarchingFilterType::NodeType seed;
+    seed.SetValue(itk::NumericTraits<FastMarchingFilterType::PixelType>::Zero);
+    seed.SetIndex(seedIndex);
+    nodes->InsertElement(i,seed);
+    }
+
+  return nodes;
+}
+
 vtkvmtkCollidingFrontsImageFilter::vtkvmtkCollidingFrontsImageFilter()
 {
   this->Seeds1 = NULL;
@@ -43,6 +99,7 @@ vtkvmtkCollidingFrontsImageFilter::vtkvmtkCollidingFrontsImageFilter()
   this->ApplyConnectivity = 0;
   this->NegativeEpsilon = -1E-6;
   this->StopOnTargets = 0;
+  this->TargetOffset = 1.0;
 }
 
 vtkvmtkCollidingFrontsImageFilter::~vtkvmtkCollidingFrontsImageFilter()
@@ -62,53 +119,127 @@ vtkvmtkCollidingFrontsImageFilter::~vtkvmtkCollidingFrontsImageFilter()
 
 void vtkvmtkCollidingFrontsImageFilter::SimpleExecute(vtkImageData* input, vtkImageData* output)
 {
-  std::cout<<input->GetScalarType()<<std::endl;
-  typedef itk::Image<float,3> ImageType;
+  typedef vtkvmtkCollidingFrontsImageType ImageType;
+  typedef vtkvmtkCollidingFrontsFastMarchingFilterType FastMarchingFilterType;
+  typedef FastMarchingFilterType::GradientImageType GradientImageType;
+
+  if (!this->Seeds1 || !this->Seeds2)
+    {
+    vtkErrorMacro(<<"Seeds1 and Seeds2 must be set.");
+    return;
+    }
 
-  ImageType::Pointer inImage = ImageType::New();
+  // each front gets its own image object on the shared input buffer, so that
+  // the two pipelines do not touch common ITK state while running concurrently
+  ImageType::Pointer inImage1 = ImageType::New();
+  vtkvmtkITKFilterUtilities::VTKToITKImage<ImageType>(input,inImage1);
+  ImageType::Pointer inImage2 = ImageType::New();
+  vtkvmtkITKFilterUtilities::VTKToITKImage<ImageType>(input,inImage2);
+
+  FastMarchingFilterType::NodeContainerPointer seeds1 = vtkvmtkCollidingFrontsBuildNodes(input,inImage1,this->Seeds1);
+  FastMarchingFilterType::NodeContainerPointer seeds2 = vtkvmtkCollidingFrontsBuildNodes(input,inImage2,this->Seeds2);
+
+  // same setup as itk::CollidingFrontsImageFilter, the two marches are independent
+  FastMarchingFilterType::Pointer fastMarchingFilter1 = FastMarchingFilterType::New();
+  fastMarchingFilter1->SetInput(inImage1);
+  fastMarchingFilter1->SetTrialPoints(seeds1);
+  fastMarchingFilter1->SetTargetPoints(seeds2);
+  fastMarchingFilter1->SetTargetOffset(this->TargetOffset);
+  fastMarchingFilter1->GenerateGradientImageOn();
+
+  FastMarchingFilterType::Pointer fastMarchingFilter2 = FastMarchingFilterType::New();
+  fastMarchingFilter2->SetInput(inImage2);
+  fastMarchingFilter2->SetTrialPoints(seeds2);
+  fastMarchingFilter2->SetTargetPoints(seeds1);
+  fastMarchingFilter2->SetTargetOffset(this->TargetOffset);
+  fastMarchingFilter2->GenerateGradientImageOn();
+
+  if (this->StopOnTargets)
+    {
+    fastMarchingFilter1->SetTargetReachedModeToAllTargets();
+    fastMarchingFilter2->SetTargetReachedModeToAllTargets();
+    }
+  else
+    {
+    fastMarchingFilter1->SetTargetReachedModeToNoTargets();
+    fastMarchingFilter2->SetTargetReachedModeToNoTargets();
+    }
 
-  vtkvmtkITKFilterUtilities::VTKToITKImage<ImageType>(input,inImage);
+  vtkvmtkCollidingFrontsThreadStruct str;
+  str.Filters[0] = fastMarchingFilter1;
+  str.Filters[1] = fastMarchingFilter2;
+  str.Failed[0] = str.Failed[1] = false;
 
-  typedef itk::CollidingFrontsImageFilter<ImageType, ImageType> CollidingFrontsFilterType;
-  CollidingFrontsFilterType::Pointer collidingFrontsFilter = CollidingFrontsFilterType::New();
-  collidingFrontsFilter->SetInput(inImage);
+  itk::MultiThreader::Pointer threader = itk::MultiThreader::New();
+  threader->SetNumberOfThreads(2);
+  threader->SetSingleMethod(vtkvmtkCollidingFrontsThreaderCallback,&str);
+  threader->SingleMethodExecute();
 
-  CollidingFrontsFilterType::NodeContainerPointer seeds1 = CollidingFrontsFilterType::NodeContainer::New();
-  int i;
-  for (i=0; i<this->Seeds1->GetNumberOfIds(); i++)
+  if (str.Failed[0] || str.Failed[1])
     {
-    // TODO: here we get the point. We should get the cell center instead.
-    ImageType::PointType seedPoint(input->GetPoint(this->Seeds1->GetId(i)));
-    CollidingFrontsFilterType::NodeType::IndexType seedIndex;
-    inImage->TransformPhysicalPointToIndex(seedPoint,seedIndex);
-    CollidingFrontsFilterType::PixelType seedValue = itk::NumericTraits<CollidingFrontsFilterType::PixelType>::Zero;
-    CollidingFrontsFilterType::NodeType seed;
-    seed.SetValue(seedValue);
-    seed.SetIndex(seedIndex);
-    seeds1->InsertElement(i,seed);
+    vtkErrorMacro(<<"Fast marching failed.");
+    return;
     }
-  collidingFrontsFilter->SetSeedPoints1(seeds1);
 
-  CollidingFrontsFilterType::NodeContainerPointer seeds2 = CollidingFrontsFilterType::NodeContainer::New();
-  for (i=0; i<this->Seeds2->GetNumberOfIds(); i++)
+  // output is zero wherever either gradient is zero, i.e. outside the region
+  // swept by both fronts
+  ImageType::Pointer outImage = ImageType::New();
+  vtkvmtkITKFilterUtilities::VTKToITKImage<ImageType>(output,outImage);
+  outImage->FillBuffer(itk::NumericTraits<ImageType::PixelType>::Zero);
+
+  ImageType::RegionType region = fastMarchingFilter1->GetAliveRegion();
+  if (region.GetNumberOfPixels() == 0 || fastMarchingFilter2->GetAliveRegion().GetNumberOfPixels() == 0 || !region.Crop(fastMarchingFilter2->GetAliveRegion()))
     {
-    // TODO: here we get the point. We should get the cell center instead.
-    ImageType::PointType seedPoint(input->GetPoint(this->Seeds2->GetId(i)));
-    CollidingFrontsFilterType::NodeType::IndexType seedIndex;
-    inImage->TransformPhysicalPointToIndex(seedPoint,seedIndex);
-    CollidingFrontsFilterType::PixelType seedValue = itk::NumericTraits<CollidingFrontsFilterType::PixelType>::Zero;
-    CollidingFrontsFilterType::NodeType seed;
-    seed.SetValue(seedValue);
-    seed.SetIndex(seedIndex);
-    seeds2->InsertElement(i,seed);
+    return;
+    }
+
+  if (this->ApplyConnectivity && this->NegativeEpsilon >= 0.0)
+    {
+    // zero dot products pass the threshold, connectivity may leave the region
+    region = outImage->GetLargestPossibleRegion();
     }
-  collidingFrontsFilter->SetSeedPoints2(seeds2);
 
-  collidingFrontsFilter->SetApplyConnectivity(this->ApplyConnectivity);
-  collidingFrontsFilter->SetNegativeEpsilon(this->NegativeEpsilon);
-  collidingFrontsFilter->SetStopOnTargets(this->StopOnTargets);
-  collidingFrontsFilter->Update();
+  ImageType::Pointer dotImage = ImageType::New();
+  dotImage->CopyInformation(inImage1);
+  dotImage->SetRegions(region);
+  dotImage->Allocate();
 
-  vtkvmtkITKFilterUtilities::ITKToVTKImage<ImageType>(collidingFrontsFilter->GetOutput(),output);
-}
+  itk::ImageRegionConstIterator<GradientImageType> gradientIt1(fastMarchingFilter1->GetGradientImage(),region);
+  itk::ImageRegionConstIterator<GradientImageType> gradientIt2(fastMarchingFilter2->GetGradientImage(),region);
+  itk::ImageRegionIterator<ImageType> dotIt(dotImage,region);
+  for (gradientIt1.GoToBegin(), gradientIt2.GoToBegin(), dotIt.GoToBegin(); !dotIt.IsAtEnd(); ++gradientIt1, ++gradientIt2, ++dotIt)
+    {
+    dotIt.Set(gradientIt1.Get() * gradientIt2.Get());
+    }
+
+  ImageType::Pointer resultImage = dotImage;
 
+  if (this->ApplyConnectivity)
+    {
+    typedef itk::ConnectedThresholdImageFilter<ImageType,ImageType> ConnectedThresholdFilterType;
+    ConnectedThresholdFilterType::Pointer connectedThresholdFilter = ConnectedThresholdFilterType::New();
+    connectedThresholdFilter->SetInput(dotImage);
+    connectedThresholdFilter->SetLower(itk::NumericTraits<ImageType::PixelType>::NonpositiveMin());
+    connectedThresholdFilter->SetUpper(this->NegativeEpsilon);
+    connectedThresholdFilter->SetReplaceValue(itk::NumericTraits<ImageType::PixelType>::One);
+
+    FastMarchingFilterType::NodeContainer::ConstIterator pointsIter = seeds1->Begin();
+    for (; pointsIter != seeds1->End(); ++pointsIter)
+      {
+      if (region.IsInside(pointsIter.Value().GetIndex()))
+        {
+        connectedThresholdFilter->AddSeed(pointsIter.Value().GetIndex());
+        }
+      }
+    connectedThresholdFilter->Update();
+
+    resultImage = connectedThresholdFilter->GetOutput();
+    }
+
+  itk::ImageRegionConstIterator<ImageType> resultIt(resultImage,region);
+  itk::ImageRegionIterator<ImageType> outIt(outImage,region);
+  for (resultIt.GoToBegin(), outIt.GoToBegin(); !outIt.IsAtEnd(); ++resultIt, ++outIt)
+    {
+    outIt.Set(resultIt.Get());
+    }
+}
@@ -25,7 +25,9 @@ Version:   $Revision: 1.4 $
 
 // .NAME vtkvmtkCollidingFrontsImageFilter - Wrapper class around itk::CollidingFrontsImageFilter
 // .SECTION Description
-// vtkvmtkCollidingFrontsImageFilter
+// vtkvmtkCollidingFrontsImageFilter reproduces itk::CollidingFrontsImageFilter,
+// running the fast marching passes from Seeds1 and Seeds2 concurrently and
+// combining their upwind gradients only over the region swept by both fronts.
 
 
 #ifndef __vtkvmtkCollidingFrontsImageFilter_h
@@ -52,6 +54,12 @@ class VTK_VMTK_SEGMENTATION_EXPORT vtkvmtkCollidingFrontsImageFilter : public vt
   vtkSetMacro(StopOnTargets,int);
   vtkBooleanMacro(StopOnTargets,int);
 
+  // Description:
+  // With StopOnTargets, each front keeps marching until its arrival time
+  // exceeds the one at the last of the other front's seeds by TargetOffset.
+  vtkGetMacro(TargetOffset,double);
+  vtkSetMacro(TargetOffset,double);
+
   vtkSetObjectMacro(Seeds1,vtkIdList);
   vtkGetObjectMacro(Seeds1,vtkIdList);
 
@@ -75,6 +83,7 @@ private:
   int ApplyConnectivity;
   double NegativeEpsilon;
   int StopOnTargets;
+  double TargetOffset;
 };
 
 #endif
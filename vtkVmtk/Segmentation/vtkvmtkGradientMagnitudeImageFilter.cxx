@@ -25,6 +25,7 @@ Version:   $Revision: 1.1 $
 
 #include "vtkvmtkGradientMagnitudeImageFilter.h"
 #include "vtkObjectFactory.h"
+#include "vtkInformation.h"
 
 #include "vtkvmtkITKFilterUtilities.h"
 
@@ -32,6 +33,12 @@ Version:   $Revision: 1.1 $
 
 vtkStandardNewMacro(vtkvmtkGradientMagnitudeImageFilter);
 
+void vtkvmtkGradientMagnitudeImageFilter::ComputeHaloRadius(vtkInformation* vtkNotUsed(inInfo), int haloRadius[3])
+{
+  // central differences
+  haloRadius[0] = haloRadius[1] = haloRadius[2] = 1;
+}
+
 void vtkvmtkGradientMagnitudeImageFilter::SimpleExecute(vtkImageData* input, vtkImageData* output)
 {
   typedef itk::Image<float,3> ImageType;
@@ -43,8 +50,9 @@ void vtkvmtkGradientMagnitudeImageFilter::SimpleExecute(vtkImageData* input, vtk
 
   GradientMagnitudeFilterType::Pointer gradientMagnitudeFilter = GradientMagnitudeFilterType::New();
   gradientMagnitudeFilter->SetInput(inImage);
+  gradientMagnitudeFilter->GetOutput()->SetRequestedRegion(vtkvmtkITKFilterUtilities::ExtentToRegion<ImageType>(output->GetExtent()));
   gradientMagnitudeFilter->Update();
 
-  vtkvmtkITKFilterUtilities::ITKToVTKImage<ImageType>(gradientMagnitudeFilter->GetOutput(),output);
+  vtkvmtkITKFilterUtilities::ITKToVTKImageExtent<ImageType>(gradientMagnitudeFilter->GetOutput(),output);
 }
 
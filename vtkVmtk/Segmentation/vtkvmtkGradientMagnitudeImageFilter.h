@@ -31,20 +31,21 @@ Version:   $Revision: 1.3 $
 #ifndef __vtkvmtkGradientMagnitudeImageFilter_h
 #define __vtkvmtkGradientMagnitudeImageFilter_h
 
-#include "vtkSimpleImageToImageFilter.h"
+#include "vtkvmtkStreamingImageToImageFilter.h"
 #include "vtkvmtkWin32Header.h"
 
-class VTK_VMTK_SEGMENTATION_EXPORT vtkvmtkGradientMagnitudeImageFilter : public vtkSimpleImageToImageFilter
+class VTK_VMTK_SEGMENTATION_EXPORT vtkvmtkGradientMagnitudeImageFilter : public vtkvmtkStreamingImageToImageFilter
 {
  public:
   static vtkvmtkGradientMagnitudeImageFilter *New();
-  vtkTypeMacro(vtkvmtkGradientMagnitudeImageFilter, vtkSimpleImageToImageFilter);
+  vtkTypeMacro(vtkvmtkGradientMagnitudeImageFilter, vtkvmtkStreamingImageToImageFilter);
 
 protected:
   vtkvmtkGradientMagnitudeImageFilter() {};
   ~vtkvmtkGradientMagnitudeImageFilter() {};
 
   virtual void SimpleExecute(vtkImageData* input, vtkImageData* output) VTK_OVERRIDE;
+  virtual void ComputeHaloRadius(vtkInformation* inInfo, int haloRadius[3]) VTK_OVERRIDE;
 
 private:
   vtkvmtkGradientMagnitudeImageFilter(const vtkvmtkGradientMagnitudeImageFilter&);  // Not implemented.
@@ -25,6 +25,8 @@ Version:   $Revision: 1.1 $
 
 #include "vtkvmtkGradientMagnitudeRecursiveGaussianImageFilter.h"
 #include "vtkObjectFactory.h"
+#include "vtkInformation.h"
+#include "vtkMath.h"
 
 #include "vtkvmtkITKFilterUtilities.h"
 
@@ -38,6 +40,18 @@ vtkvmtkGradientMagnitudeRecursiveGaussianImageFilter::vtkvmtkGradientMagnitudeRe
   this->NormalizeAcrossScale = 0;
 }
 
+void vtkvmtkGradientMagnitudeRecursiveGaussianImageFilter::ComputeHaloRadius(vtkInformation* inInfo, int haloRadius[3])
+{
+  // the recursive filters have infinite support, truncate the halo at four
+  // standard deviations (Sigma is in physical units)
+  double spacing[3];
+  inInfo->Get(vtkDataObject::SPACING(),spacing);
+  for (int i=0; i<3; i++)
+    {
+    haloRadius[i] = vtkMath::Ceil(4.0 * this->Sigma / spacing[i]) + 1;
+    }
+}
+
 void vtkvmtkGradientMagnitudeRecursiveGaussianImageFilter::SimpleExecute(vtkImageData* input, vtkImageData* output)
 {
   typedef itk::Image<float,3> ImageType;
@@ -52,8 +66,9 @@ void vtkvmtkGradientMagnitudeRecursiveGaussianImageFilter::SimpleExecute(vtkImag
   gradientMagnitudeFilter->SetInput(inImage);
   gradientMagnitudeFilter->SetSigma(this->Sigma);
   gradientMagnitudeFilter->SetNormalizeAcrossScale(this->NormalizeAcrossScale);
+  gradientMagnitudeFilter->GetOutput()->SetRequestedRegion(vtkvmtkITKFilterUtilities::ExtentToRegion<ImageType>(output->GetExtent()));
   gradientMagnitudeFilter->Update();
 
-  vtkvmtkITKFilterUtilities::ITKToVTKImage<ImageType>(gradientMagnitudeFilter->GetOutput(),output);
+  vtkvmtkITKFilterUtilities::ITKToVTKImageExtent<ImageType>(gradientMagnitudeFilter->GetOutput(),output);
 }
 
@@ -31,14 +31,14 @@ Version:   $Revision: 1.3 $
 #ifndef __vtkvmtkGradientMagnitudeRecursiveGaussianImageFilter_h
 #define __vtkvmtkGradientMagnitudeRecursiveGaussianImageFilter_h
 
-#include "vtkSimpleImageToImageFilter.h"
+#include "vtkvmtkStreamingImageToImageFilter.h"
 #include "vtkvmtkWin32Header.h"
 
-class VTK_VMTK_SEGMENTATION_EXPORT vtkvmtkGradientMagnitudeRecursiveGaussianImageFilter : public vtkSimpleImageToImageFilter
+class VTK_VMTK_SEGMENTATION_EXPORT vtkvmtkGradientMagnitudeRecursiveGaussianImageFilter : public vtkvmtkStreamingImageToImageFilter
 {
  public:
   static vtkvmtkGradientMagnitudeRecursiveGaussianImageFilter *New();
-  vtkTypeMacro(vtkvmtkGradientMagnitudeRecursiveGaussianImageFilter, vtkSimpleImageToImageFilter);
+  vtkTypeMacro(vtkvmtkGradientMagnitudeRecursiveGaussianImageFilter, vtkvmtkStreamingImageToImageFilter);
 
   vtkGetMacro(Sigma,double);
   vtkSetMacro(Sigma,double);
@@ -52,6 +52,7 @@ protected:
   ~vtkvmtkGradientMagnitudeRecursiveGaussianImageFilter() {};
 
   virtual void SimpleExecute(vtkImageData* input, vtkImageData* output) VTK_OVERRIDE;
+  virtual void ComputeHaloRadius(vtkInformation* inInfo, int haloRadius[3]) VTK_OVERRIDE;
 
 private:
   vtkvmtkGradientMagnitudeRecursiveGaussianImageFilter(const vtkvmtkGradientMagnitudeRecursiveGaussianImageFilter&);  // Not implemented.
@@ -61,6 +61,16 @@ int vtkvmtkGrayscaleMorphologyImageFilter::RequestInformation (
   return 1;
 }
 
+void vtkvmtkGrayscaleMorphologyImageFilter::ComputeHaloRadius(vtkInformation* vtkNotUsed(inInfo), int haloRadius[3])
+{
+  // closing and opening chain two operations, each needing the ball radius
+  int factor = (this->Operation == CLOSE || this->Operation == OPEN) ? 2 : 1;
+  for (int i=0; i<3; i++)
+    {
+    haloRadius[i] = factor * this->BallRadius[i];
+    }
+}
+
 void vtkvmtkGrayscaleMorphologyImageFilter::SimpleExecute(vtkImageData *input, vtkImageData *output)
 {
   typedef float PixelType;
@@ -85,6 +95,8 @@ void vtkvmtkGrayscaleMorphologyImageFilter::SimpleExecute(vtkImageData *input, v
   ball.SetRadius(ballRadius);
   ball.CreateStructuringElement();
 
+  ImageType::RegionType outputRegion = vtkvmtkITKFilterUtilities::ExtentToRegion<ImageType>(output->GetExtent());
+
   ImageType::Pointer outputImage;
 
   if (this->Operation == CLOSE)
@@ -92,6 +104,7 @@ void vtkvmtkGrayscaleMorphologyImageFilter::SimpleExecute(vtkImageData *input, v
     ClosingFilterType::Pointer imageFilter = ClosingFilterType::New();
     imageFilter->SetKernel(ball);
     imageFilter->SetInput(inImage);
+    imageFilter->GetOutput()->SetRequestedRegion(outputRegion);
     imageFilter->SafeBorderOff();
     try {
       imageFilter->Update();
@@ -100,6 +113,7 @@ void vtkvmtkGrayscaleMorphologyImageFilter::SimpleExecute(vtkImageData *input, v
     {
       std::cerr << "Exception catched !" << std::endl;
       std::cerr << excep << std::endl;
+      return;
     }
     outputImage = imageFilter->GetOutput();
     }
@@ -108,6 +122,7 @@ void vtkvmtkGrayscaleMorphologyImageFilter::SimpleExecute(vtkImageData *input, v
     OpeningFilterType::Pointer imageFilter = OpeningFilterType::New();
     imageFilter->SetKernel(ball);
     imageFilter->SetInput(inImage);
+    imageFilter->GetOutput()->SetRequestedRegion(outputRegion);
     imageFilter->SafeBorderOff();
     try {
       imageFilter->Update();
@@ -116,6 +131,7 @@ void vtkvmtkGrayscaleMorphologyImageFilter::SimpleExecute(vtkImageData *input, v
     {
       std::cerr << "Exception catched !" << std::endl;
       std::cerr << excep << std::endl;
+      return;
     }
     outputImage = imageFilter->GetOutput();
     }
@@ -124,6 +140,7 @@ void vtkvmtkGrayscaleMorphologyImageFilter::SimpleExecute(vtkImageData *input, v
     DilateFilterType::Pointer imageFilter = DilateFilterType::New();
     imageFilter->SetKernel(ball);
     imageFilter->SetInput(inImage);
+    imageFilter->GetOutput()->SetRequestedRegion(outputRegion);
     try {
       imageFilter->Update();
     }
@@ -131,6 +148,7 @@ void vtkvmtkGrayscaleMorphologyImageFilter::SimpleExecute(vtkImageData *input, v
     {
       std::cerr << "Exception catched !" << std::endl;
       std::cerr << excep << std::endl;
+      return;
     }
     outputImage = imageFilter->GetOutput();
     }
@@ -139,6 +157,7 @@ void vtkvmtkGrayscaleMorphologyImageFilter::SimpleExecute(vtkImageData *input, v
     ErodeFilterType::Pointer imageFilter = ErodeFilterType::New();
     imageFilter->SetKernel(ball);
     imageFilter->SetInput(inImage);
+    imageFilter->GetOutput()->SetRequestedRegion(outputRegion);
     try {
       imageFilter->Update();
     }
@@ -146,10 +165,11 @@ void vtkvmtkGrayscaleMorphologyImageFilter::SimpleExecute(vtkImageData *input, v
     {
       std::cerr << "Exception catched !" << std::endl;
       std::cerr << excep << std::endl;
+      return;
     }
     outputImage = imageFilter->GetOutput();
     }
 
-  vtkvmtkITKFilterUtilities::ITKToVTKImage<ImageType>(outputImage,output);
+  vtkvmtkITKFilterUtilities::ITKToVTKImageExtent<ImageType>(outputImage,output);
 }
 
@@ -31,14 +31,14 @@ Version:   $Revision: 1.2 $
 #ifndef __vtkvmtkGrayscaleMorphologyImageFilter_h
 #define __vtkvmtkGrayscaleMorphologyImageFilter_h
 
-#include "vtkSimpleImageToImageFilter.h"
+#include "vtkvmtkStreamingImageToImageFilter.h"
 #include "vtkvmtkWin32Header.h"
 
-class VTK_VMTK_SEGMENTATION_EXPORT vtkvmtkGrayscaleMorphologyImageFilter : public vtkSimpleImageToImageFilter
+class VTK_VMTK_SEGMENTATION_EXPORT vtkvmtkGrayscaleMorphologyImageFilter : public vtkvmtkStreamingImageToImageFilter
 {
  public:
   static vtkvmtkGrayscaleMorphologyImageFilter *New();
-  vtkTypeMacro(vtkvmtkGrayscaleMorphologyImageFilter, vtkSimpleImageToImageFilter);
+  vtkTypeMacro(vtkvmtkGrayscaleMorphologyImageFilter, vtkvmtkStreamingImageToImageFilter);
 
   vtkGetVectorMacro(BallRadius,int,3);
   vtkSetVectorMacro(BallRadius,int,3);
@@ -67,6 +67,7 @@ protected:
   ~vtkvmtkGrayscaleMorphologyImageFilter();
 
   virtual void SimpleExecute(vtkImageData* input, vtkImageData* output) VTK_OVERRIDE;
+  virtual void ComputeHaloRadius(vtkInformation* inInfo, int haloRadius[3]) VTK_OVERRIDE;
   virtual int RequestInformation(vtkInformation * vtkNotUsed(request), vtkInformationVector **inputVector, vtkInformationVector *outputVector) VTK_OVERRIDE;
 
   int BallRadius[3];
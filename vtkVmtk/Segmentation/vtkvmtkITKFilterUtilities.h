@@ -36,6 +36,7 @@ Version:   $Revision: 1.2 $
 
 #include "vtkImageData.h"
 #include "itkImage.h"
+#include "itkImageRegionConstIterator.h"
 #include "itkCommand.h"
 
 class VTK_VMTK_SEGMENTATION_EXPORT vtkvmtkITKFilterUtilities
@@ -179,6 +180,45 @@ public:
     memcpy(static_cast<PixelType*>(output->GetScalarPointer()),input->GetBufferPointer(),input->GetBufferedRegion().GetNumberOfPixels()*sizeof(PixelType));
   }
 
+  template<typename TImage>
+  static typename TImage::RegionType
+  ExtentToRegion(const int extent[6]) {
+
+    typename TImage::RegionType region;
+    typename TImage::IndexType index;
+    typename TImage::SizeType size;
+    index[0] = extent[0];
+    index[1] = extent[2];
+    index[2] = extent[4];
+    size[0] = extent[1] - extent[0] + 1;
+    size[1] = extent[3] - extent[2] + 1;
+    size[2] = extent[5] - extent[4] + 1;
+    region.SetIndex(index);
+    region.SetSize(size);
+    return region;
+  }
+
+  // Copies the portion of input matching the extent of output, which must
+  // already be allocated (used by streaming filters, whose ITK output may be
+  // buffered over a larger region than the requested one).
+  template<typename TImage>
+  static void
+  ITKToVTKImageExtent(typename TImage::Pointer input, vtkImageData* output) {
+
+    typedef TImage ImageType;
+    typedef typename ImageType::PixelType PixelType;
+
+    typename ImageType::RegionType region = ExtentToRegion<ImageType>(output->GetExtent());
+
+    PixelType* outputPointer = static_cast<PixelType*>(output->GetScalarPointer());
+
+    itk::ImageRegionConstIterator<ImageType> it(input,region);
+    for (it.GoToBegin(); !it.IsAtEnd(); ++it)
+      {
+      *outputPointer++ = it.Get();
+      }
+  }
+
   static void
   ProgressCallback(itk::Object *o, const itk::EventObject &, void *data)
   {
@@ -0,0 +1,83 @@
+/*=========================================================================
+
+  Program:   VMTK
+  Module:    $RCSfile: vtkvmtkImageTrilinearStencil.h,v $
+  Language:  C++
+  Date:      $Date: 2006/04/06 16:46:43 $
+  Version:   $Revision: 1.1 $
+
+  Copyright (c) Luca Antiga, David Steinman. All rights reserved.
+  See LICENCE file for details.
+
+  Portions of this code are covered under the VTK copyright.
+  See VTKCopyright.txt or http://www.kitware.com/VTKCopyright.htm 
+  for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even 
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR 
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+// .NAME vtkvmtkImageTrilinearStencil - trilinear interpolation stencil on a vtkImageData
+// .SECTION Description
+// Computes the ids of the (up to) eight image points surrounding a point and
+// their trilinear weights by direct index arithmetic on the image extent.
+// Only const accessors of the image are used, so it can be called
+// concurrently on the same image. Not wrapped.
+
+#ifndef __vtkvmtkImageTrilinearStencil_h
+#define __vtkvmtkImageTrilinearStencil_h
+
+#include "vtkImageData.h"
+#include "vtkVoxel.h"
+
+class vtkvmtkImageTrilinearStencil
+{
+public:
+
+  // Description:
+  // Returns 0 if point is outside the image extent. Point ids follow the
+  // vtkVoxel ordering.
+  static int Compute(vtkImageData* image, const double point[3], vtkIdType pointIds[8], double weights[8])
+    {
+    int ijk[3];
+    double pcoords[3];
+    double x[3];
+
+    x[0] = point[0];
+    x[1] = point[1];
+    x[2] = point[2];
+
+    if (!image->ComputeStructuredCoordinates(x,ijk,pcoords))
+      {
+      return 0;
+      }
+
+    int extent[6];
+    image->GetExtent(extent);
+
+    // flat directions (e.g. 2D images) get a zero increment and a zero
+    // parametric coordinate, which reduces the stencil to pixel interpolation
+    vtkIdType increments[3];
+    increments[0] = extent[1] > extent[0] ? 1 : 0;
+    increments[1] = extent[3] > extent[2] ? extent[1] - extent[0] + 1 : 0;
+    increments[2] = extent[5] > extent[4] ? (extent[1] - extent[0] + 1) * (extent[3] - extent[2] + 1) : 0;
+
+    vtkIdType baseId = (ijk[0] - extent[0]) + (ijk[1] - extent[2]) * (extent[1] - extent[0] + 1) + (ijk[2] - extent[4]) * (extent[1] - extent[0] + 1) * (extent[3] - extent[2] + 1);
+
+    pointIds[0] = baseId;
+    pointIds[1] = baseId + increments[0];
+    pointIds[2] = baseId + increments[1];
+    pointIds[3] = baseId + increments[0] + increments[1];
+    pointIds[4] = baseId + increments[2];
+    pointIds[5] = baseId + increments[0] + increments[2];
+    pointIds[6] = baseId + increments[1] + increments[2];
+    pointIds[7] = baseId + increments[0] + increments[1] + increments[2];
+
+    vtkVoxel::InterpolationFunctions(pcoords,weights);
+
+    return 1;
+    }
+};
+
+#endif
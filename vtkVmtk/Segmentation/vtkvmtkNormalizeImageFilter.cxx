@@ -25,23 +25,203 @@ Version:   $Revision: 1.1 $
 
 #include "vtkvmtkNormalizeImageFilter.h"
 #include "vtkImageData.h"
+#include "vtkDemandDrivenPipeline.h"
+#include "vtkExtentTranslator.h"
+#include "vtkInformation.h"
+#include "vtkInformationVector.h"
 #include "vtkObjectFactory.h"
+#include "vtkSmartPointer.h"
+#include "vtkStreamingDemandDrivenPipeline.h"
 
 #include "vtkvmtkITKFilterUtilities.h"
 
-#include "itkNormalizeImageFilter.h"
+#include "itkShiftScaleImageFilter.h"
+
+#include <cmath>
 
 
 vtkStandardNewMacro(vtkvmtkNormalizeImageFilter);
 
 vtkvmtkNormalizeImageFilter::vtkvmtkNormalizeImageFilter()
 {
+  this->NumberOfStatisticsDivisions = 8;
+  this->CurrentStatisticsDivision = 0;
+  this->ComputingStatistics = 0;
+  this->StatisticsStreamed = 0;
+  this->StatisticsExtent[0] = this->StatisticsExtent[2] = this->StatisticsExtent[4] = 0;
+  this->StatisticsExtent[1] = this->StatisticsExtent[3] = this->StatisticsExtent[5] = -1;
+  this->StatisticsCount = 0.0;
+  this->StatisticsMean = 0.0;
+  this->StatisticsM2 = 0.0;
+  this->Mean = 0.0;
+  this->Sigma = 1.0;
 }
 
 vtkvmtkNormalizeImageFilter::~vtkvmtkNormalizeImageFilter()
 {
 }
 
+int vtkvmtkNormalizeImageFilter::StatisticsNeedUpdate()
+{
+  vtkDemandDrivenPipeline* executive = vtkDemandDrivenPipeline::SafeDownCast(this->GetExecutive());
+  if (!executive)
+    {
+    return 1;
+    }
+  return executive->GetPipelineMTime() > this->StatisticsTime.GetMTime() ? 1 : 0;
+}
+
+void vtkvmtkNormalizeImageFilter::ResetStatistics()
+{
+  this->StatisticsCount = 0.0;
+  this->StatisticsMean = 0.0;
+  this->StatisticsM2 = 0.0;
+}
+
+void vtkvmtkNormalizeImageFilter::AccumulateStatistics(vtkImageData* input, int extent[6])
+{
+  if (extent[1] < extent[0] || extent[3] < extent[2] || extent[5] < extent[4])
+    {
+    return;
+    }
+
+  vtkIdType incX, incY, incZ;
+  input->GetContinuousIncrements(extent,incX,incY,incZ);
+  float* inputPointer = static_cast<float*>(input->GetScalarPointerForExtent(extent));
+
+  // sums are shifted by the first value of the piece to limit cancellation
+  double shift = *inputPointer;
+  double sum = 0.0;
+  double sumOfSquares = 0.0;
+  for (int k=extent[4]; k<=extent[5]; k++)
+    {
+    for (int j=extent[2]; j<=extent[3]; j++)
+      {
+      for (int i=extent[0]; i<=extent[1]; i++)
+        {
+        double value = *inputPointer++ - shift;
+        sum += value;
+        sumOfSquares += value * value;
+        }
+      inputPointer += incY;
+      }
+    inputPointer += incZ;
+    }
+
+  double count = (double)(extent[1]-extent[0]+1) * (double)(extent[3]-extent[2]+1) * (double)(extent[5]-extent[4]+1);
+  double mean = shift + sum / count;
+  double m2 = sumOfSquares - sum * sum / count;
+
+  // merge with the pieces accumulated so far (Chan et al.)
+  double totalCount = this->StatisticsCount + count;
+  double delta = mean - this->StatisticsMean;
+  this->StatisticsMean += delta * count / totalCount;
+  this->StatisticsM2 += m2 + delta * delta * this->StatisticsCount * count / totalCount;
+  this->StatisticsCount = totalCount;
+}
+
+void vtkvmtkNormalizeImageFilter::FinalizeStatistics()
+{
+  // same estimators as itk::StatisticsImageFilter
+  this->Mean = this->StatisticsMean;
+  this->Sigma = this->StatisticsCount > 1.0 ? std::sqrt(this->StatisticsM2 / (this->StatisticsCount - 1.0)) : 0.0;
+  this->StatisticsTime.Modified();
+}
+
+int vtkvmtkNormalizeImageFilter::RequestUpdateExtent (
+  vtkInformation *request,
+  vtkInformationVector **inputVector,
+  vtkInformationVector *outputVector)
+{
+  vtkInformation *inInfo = inputVector[0]->GetInformationObject(0);
+  vtkInformation *outInfo = outputVector->GetInformationObject(0);
+
+  int wholeExtent[6], updateExtent[6];
+  inInfo->Get(vtkStreamingDemandDrivenPipeline::WHOLE_EXTENT(),wholeExtent);
+  outInfo->Get(vtkStreamingDemandDrivenPipeline::UPDATE_EXTENT(),updateExtent);
+
+  int wholeExtentRequested = 1;
+  for (int i=0; i<6; i++)
+    {
+    if (updateExtent[i] != wholeExtent[i])
+      {
+      wholeExtentRequested = 0;
+      }
+    }
+
+  this->ComputingStatistics = 0;
+
+  if (!this->StatisticsNeedUpdate() || wholeExtentRequested)
+    {
+    return this->Superclass::RequestUpdateExtent(request,inputVector,outputVector);
+    }
+
+  // statistics pass: request the next slab of the whole extent
+  this->ComputingStatistics = 1;
+
+  vtkSmartPointer<vtkExtentTranslator> translator = vtkSmartPointer<vtkExtentTranslator>::New();
+  if (!translator->PieceToExtentThreadSafe(this->CurrentStatisticsDivision,this->NumberOfStatisticsDivisions,0,wholeExtent,this->StatisticsExtent,vtkExtentTranslator::Z_SLAB_MODE,0))
+    {
+    this->StatisticsExtent[0] = this->StatisticsExtent[2] = this->StatisticsExtent[4] = 0;
+    this->StatisticsExtent[1] = this->StatisticsExtent[3] = this->StatisticsExtent[5] = -1;
+    }
+
+  inInfo->Set(vtkStreamingDemandDrivenPipeline::UPDATE_EXTENT(),this->StatisticsExtent,6);
+
+  return 1;
+}
+
+int vtkvmtkNormalizeImageFilter::RequestData (
+  vtkInformation *request,
+  vtkInformationVector **inputVector,
+  vtkInformationVector *outputVector)
+{
+  vtkImageData *input = vtkImageData::GetData(inputVector[0]);
+
+  if (this->ComputingStatistics)
+    {
+    if (this->CurrentStatisticsDivision == 0)
+      {
+      this->ResetStatistics();
+      }
+
+    if (input)
+      {
+      this->AccumulateStatistics(input,this->StatisticsExtent);
+      }
+
+    this->CurrentStatisticsDivision++;
+    this->UpdateProgress((double)this->CurrentStatisticsDivision / (double)(this->NumberOfStatisticsDivisions + 1));
+
+    if (this->CurrentStatisticsDivision == this->NumberOfStatisticsDivisions)
+      {
+      this->CurrentStatisticsDivision = 0;
+      this->FinalizeStatistics();
+      this->StatisticsStreamed = 1;
+      }
+
+    // execute again, either for the next slab or for the requested extent
+    request->Set(vtkStreamingDemandDrivenPipeline::CONTINUE_EXECUTING(),1);
+    return 1;
+    }
+
+  if (this->StatisticsStreamed)
+    {
+    request->Remove(vtkStreamingDemandDrivenPipeline::CONTINUE_EXECUTING());
+    this->StatisticsStreamed = 0;
+    }
+
+  if (this->StatisticsNeedUpdate() && input)
+    {
+    // the whole extent was requested, statistics come with the data
+    this->ResetStatistics();
+    this->AccumulateStatistics(input,input->GetExtent());
+    this->FinalizeStatistics();
+    }
+
+  return this->Superclass::RequestData(request,inputVector,outputVector);
+}
+
 void vtkvmtkNormalizeImageFilter::SimpleExecute(vtkImageData *input, vtkImageData *output)
 {
   typedef float PixelType;
@@ -52,14 +232,17 @@ void vtkvmtkNormalizeImageFilter::SimpleExecute(vtkImageData *input, vtkImageDat
 
   vtkvmtkITKFilterUtilities::VTKToITKImage<ImageType>(input,inImage);
 
-  typedef itk::NormalizeImageFilter<ImageType, ImageType> NormalizeFilterType;
+  // the shift and scale itk::NormalizeImageFilter would apply, with global statistics
+  typedef itk::ShiftScaleImageFilter<ImageType, ImageType> ShiftScaleFilterType;
 
-  NormalizeFilterType::Pointer imageFilter = NormalizeFilterType::New();
+  ShiftScaleFilterType::Pointer imageFilter = ShiftScaleFilterType::New();
   imageFilter->SetInput(inImage);
+  imageFilter->SetShift(-this->Mean);
+  imageFilter->SetScale(1.0 / this->Sigma);
+  imageFilter->GetOutput()->SetRequestedRegion(vtkvmtkITKFilterUtilities::ExtentToRegion<ImageType>(output->GetExtent()));
   imageFilter->Update();
 
   ImageType::Pointer outputImage = imageFilter->GetOutput();
 
-  vtkvmtkITKFilterUtilities::ITKToVTKImage<ImageType>(outputImage,output);
+  vtkvmtkITKFilterUtilities::ITKToVTKImageExtent<ImageType>(outputImage,output);
 }
-
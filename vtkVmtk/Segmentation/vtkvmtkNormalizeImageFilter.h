@@ -25,33 +25,63 @@ Version:   $Revision: 1.2 $
 
 // .NAME vtkvmtkNormalizeImageFilter - Wrapper class around itk::NormalizeImageFilter
 // .SECTION Description
-// vtkvmtkNormalizeImageFilter
-
+// vtkvmtkNormalizeImageFilter shifts and scales the input to zero mean and
+// unit standard deviation, as itk::NormalizeImageFilter does. Mean and
+// standard deviation are global, so when a sub-extent is requested (e.g. by
+// vtkImageDataStreamer) they are first accumulated by streaming the whole
+// extent through the filter in NumberOfStatisticsDivisions slabs; they are
+// then cached until the pipeline is modified, and each requested piece only
+// requires its own extent.
 
 #ifndef __vtkvmtkNormalizeImageFilter_h
 #define __vtkvmtkNormalizeImageFilter_h
 
-#include "vtkSimpleImageToImageFilter.h"
+#include "vtkvmtkStreamingImageToImageFilter.h"
 #include "vtkvmtkWin32Header.h"
 
-class vtkFloatArray;
-
-class VTK_VMTK_SEGMENTATION_EXPORT vtkvmtkNormalizeImageFilter : public vtkSimpleImageToImageFilter
+class VTK_VMTK_SEGMENTATION_EXPORT vtkvmtkNormalizeImageFilter : public vtkvmtkStreamingImageToImageFilter
 {
  public:
   static vtkvmtkNormalizeImageFilter *New();
-  vtkTypeMacro(vtkvmtkNormalizeImageFilter, vtkSimpleImageToImageFilter);
+  vtkTypeMacro(vtkvmtkNormalizeImageFilter, vtkvmtkStreamingImageToImageFilter);
+
+  vtkSetClampMacro(NumberOfStatisticsDivisions,int,1,VTK_INT_MAX);
+  vtkGetMacro(NumberOfStatisticsDivisions,int);
+
+  vtkGetMacro(Mean,double);
+  vtkGetMacro(Sigma,double);
 
 protected:
   vtkvmtkNormalizeImageFilter();
   ~vtkvmtkNormalizeImageFilter();
 
+  virtual int RequestUpdateExtent(vtkInformation *, vtkInformationVector **, vtkInformationVector *) VTK_OVERRIDE;
+  virtual int RequestData(vtkInformation *, vtkInformationVector **, vtkInformationVector *) VTK_OVERRIDE;
+
   virtual void SimpleExecute(vtkImageData* input, vtkImageData* output) VTK_OVERRIDE;
 
+  int StatisticsNeedUpdate();
+  void ResetStatistics();
+  void AccumulateStatistics(vtkImageData* input, int extent[6]);
+  void FinalizeStatistics();
+
+  int NumberOfStatisticsDivisions;
+  int CurrentStatisticsDivision;
+  int ComputingStatistics;
+  int StatisticsStreamed;
+  int StatisticsExtent[6];
+
+  double StatisticsCount;
+  double StatisticsMean;
+  double StatisticsM2;
+  vtkTimeStamp StatisticsTime;
+
+  double Mean;
+  double Sigma;
+
 private:
   vtkvmtkNormalizeImageFilter(const vtkvmtkNormalizeImageFilter&);  // Not implemented.
   void operator=(const vtkvmtkNormalizeImageFilter&);  // Not implemented.
 };
 
 #endif
-
@@ -27,14 +27,15 @@ Version:   $Revision: 1.3 $
 #include "vtkvmtkPolyDataPotentialFit.h"
 
 #include "vtkvmtkNeighborhoods.h"
+#include "vtkvmtkImageTrilinearStencil.h"
 #include "vtkvmtkConstants.h"
 #include "vtkMath.h"
 #include "vtkPolyData.h"
 #include "vtkImageData.h"
 #include "vtkImageGradient.h"
 #include "vtkDoubleArray.h"
-#include "vtkVoxel.h"
-#include "vtkPixel.h"
+#include "vtkSMPTools.h"
+#include "vtkSMPThreadLocal.h"
 #include "vtkPointData.h"
 #include "vtkCellData.h"
 #include "vtkPolyDataNormals.h"
@@ -114,51 +115,38 @@ vtkvmtkPolyDataPotentialFit::~vtkvmtkPolyDataPotentialFit()
 vtkCxxSetObjectMacro(vtkvmtkPolyDataPotentialFit,PotentialImage,vtkImageData);
 vtkCxxSetObjectMacro(vtkvmtkPolyDataPotentialFit,InflationImage,vtkImageData);
 
-void vtkvmtkPolyDataPotentialFit::EvaluateForce(double point[3], double force[3], bool normalize)
+void vtkvmtkPolyDataPotentialFit::EvaluateForce(double point[3], double force[3], vtkIdType& numberOfPointsOutOfExtent, bool normalize)
 {
-  int ijk[3];
-  double pcoords[3];
+  vtkIdType pointIds[8];
   double weights[8];
-  int inBounds;
-  int i;
+  int i, j;
 
   force[0] = force[1] = force[2] = 0.0;
 
-  inBounds = this->PotentialGradientImage->ComputeStructuredCoordinates(point,ijk,pcoords);
-
-  if (!inBounds)
-//  if (!inBounds || !this->IsCellInExtent(this->PotentialGradientImage->GetExtent(),ijk,0))
+  if (!vtkvmtkImageTrilinearStencil::Compute(this->PotentialGradientImage,point,pointIds,weights))
     {
-    vtkWarningMacro("Point out of extent.");
+    numberOfPointsOutOfExtent++;
     return;
     }
 
-  vtkCell* cell = this->PotentialGradientImage->GetCell(this->PotentialGradientImage->ComputeCellId(ijk));
-
-  if (cell->GetCellType() == VTK_VOXEL)
-  {
-    vtkVoxel::InterpolationFunctions(pcoords,weights);
-  }
-  else if (cell->GetCellType() == VTK_PIXEL)
-  {
-    vtkPixel::InterpolationFunctions(pcoords,weights);
-  }
-  else
-  {
-    vtkErrorMacro("Non voxel or pixel cell found in PotentialImage");
-  }
-
-  int numberOfCellPoints = cell->GetNumberOfPoints();
-
-  vtkDataArray* gradientVectorsArray = this->PotentialGradientImage->GetPointData()->GetScalars();
+  // the gradient image is always double, see RequestData; it has
+  // Dimensionality components
+  vtkDoubleArray* gradientVectorsArray = static_cast<vtkDoubleArray*>(this->PotentialGradientImage->GetPointData()->GetScalars());
+  int numberOfComponents = gradientVectorsArray->GetNumberOfComponents();
+  if (numberOfComponents > 3)
+    {
+    numberOfComponents = 3;
+    }
+  const double* gradientVectors = gradientVectorsArray->GetPointer(0);
+  int stride = gradientVectorsArray->GetNumberOfComponents();
 
-  for (i=0; i<numberOfCellPoints; i++)
+  for (i=0; i<8; i++)
   {
-    double vectorValue[3];
-    gradientVectorsArray->GetTuple(cell->GetPointId(i),vectorValue);
-    force[0] += weights[i] * vectorValue[0];
-    force[1] += weights[i] * vectorValue[1];
-    force[2] += weights[i] * vectorValue[2];
+    const double* vectorValue = gradientVectors + stride * pointIds[i];
+    for (j=0; j<numberOfComponents; j++)
+    {
+      force[j] += weights[i] * vectorValue[j];
+    }
   }
 
   if (normalize && this->PotentialMaxNorm > VTK_VMTK_DOUBLE_TOL)
@@ -173,127 +161,67 @@ void vtkvmtkPolyDataPotentialFit::EvaluateForce(double point[3], double force[3]
   force[2] *= -1.0;
 }
 
-double vtkvmtkPolyDataPotentialFit::EvaluatePotential(double point[3])
+double vtkvmtkPolyDataPotentialFit::InterpolateScalars(vtkDataArray* scalars, vtkIdType pointIds[8], double weights[8])
 {
-  int ijk[3];
-  double pcoords[3];
-  double weights[8];
-  int inBounds;
-  int i;
-
-  double potential = 0.0;
+  double value = 0.0;
+  for (int i=0; i<8; i++)
+  {
+    value += weights[i] * scalars->GetComponent(pointIds[i],0);
+  }
+  return value;
+}
 
-  inBounds = this->PotentialImage->ComputeStructuredCoordinates(point,ijk,pcoords);
+double vtkvmtkPolyDataPotentialFit::EvaluatePotential(double point[3], vtkIdType& numberOfPointsOutOfExtent)
+{
+  vtkIdType pointIds[8];
+  double weights[8];
 
-  if (!inBounds)
-//  if (!inBounds || !this->IsCellInExtent(this->PotentialImage->GetExtent(),ijk,0))
+  if (!vtkvmtkImageTrilinearStencil::Compute(this->PotentialImage,point,pointIds,weights))
     {
-    vtkWarningMacro("Point out of extent.");
+    numberOfPointsOutOfExtent++;
     return 0.0;
     }
 
-  vtkCell* cell = this->PotentialImage->GetCell(this->PotentialImage->ComputeCellId(ijk));
-
-  if (cell->GetCellType() == VTK_VOXEL)
-  {
-    vtkVoxel::InterpolationFunctions(pcoords,weights);
-  }
-  else if (cell->GetCellType() == VTK_PIXEL)
-  {
-    vtkPixel::InterpolationFunctions(pcoords,weights);
-  }
-  else
-  {
-    vtkErrorMacro("Non voxel or pixel cell found in PotentialImage");
-    return 0.0;
-  }
-
-  int numberOfCellPoints = cell->GetNumberOfPoints();
-
-  vtkDataArray* potentialArray = this->PotentialImage->GetPointData()->GetScalars();
-
-  for (i=0; i<numberOfCellPoints; i++)
-  {
-    double value = potentialArray->GetTuple1(cell->GetPointId(i));
-    potential += weights[i] * value;
-  }
-
-  return potential;
+  return this->InterpolateScalars(this->PotentialImage->GetPointData()->GetScalars(),pointIds,weights);
 }
 
-double vtkvmtkPolyDataPotentialFit::EvaluateInflation(double point[3])
+double vtkvmtkPolyDataPotentialFit::EvaluateInflation(double point[3], vtkIdType& numberOfPointsOutOfExtent)
 {
   if (this->InflationImage == NULL) {
     return 1.0;
   }
 
-  int ijk[3];
-  double pcoords[3];
+  vtkIdType pointIds[8];
   double weights[8];
-  int inBounds;
-  int i;
-
-  double inflation = 0.0;
-
-  inBounds = this->InflationImage->ComputeStructuredCoordinates(point,ijk,pcoords);
 
-  if (!inBounds)
-//  if (!inBounds || !this->IsCellInExtent(this->PotentialImage->GetExtent(),ijk,0))
+  if (!vtkvmtkImageTrilinearStencil::Compute(this->InflationImage,point,pointIds,weights))
     {
-    vtkWarningMacro("Point out of extent.");
+    numberOfPointsOutOfExtent++;
     return 0.0;
     }
 
-  vtkCell* cell = this->InflationImage->GetCell(this->InflationImage->ComputeCellId(ijk));
-
-  if (cell->GetCellType() == VTK_VOXEL)
-  {
-    vtkVoxel::InterpolationFunctions(pcoords,weights);
-  }
-  else if (cell->GetCellType() == VTK_PIXEL)
-  {
-    vtkPixel::InterpolationFunctions(pcoords,weights);
-  }
-  else
-  {
-    vtkErrorMacro("Non voxel or pixel cell found in PotentialImage");
-    return 0.0;
-  }
-
-  int numberOfCellPoints = cell->GetNumberOfPoints();
-
-  vtkDataArray* inflationArray = this->InflationImage->GetPointData()->GetScalars();
-
-  for (i=0; i<numberOfCellPoints; i++)
-  {
-    double value = inflationArray->GetTuple1(cell->GetPointId(i));
-    inflation += weights[i] * value;
-  }
-
-  return inflation - this->InflationThreshold;
+  return this->InterpolateScalars(this->InflationImage->GetPointData()->GetScalars(),pointIds,weights) - this->InflationThreshold;
 }
 
-void vtkvmtkPolyDataPotentialFit::ComputePotentialDisplacement(vtkIdType pointId, double potentialDisplacement[3])
+void vtkvmtkPolyDataPotentialFit::ComputePotentialDisplacement(vtkPolyData* surface, vtkIdType pointId, double potentialDisplacement[3], vtkIdType& numberOfPointsOutOfExtent)
 {
   double point[3];
   double force[3];
-  this->GetOutput()->GetPoint(pointId, point);
-  this->EvaluateForce(point, force);
+  surface->GetPoint(pointId, point);
+  this->EvaluateForce(point, force, numberOfPointsOutOfExtent);
   potentialDisplacement[0] = force[0];
   potentialDisplacement[1] = force[1];
   potentialDisplacement[2] = force[2];
 }
 
-void vtkvmtkPolyDataPotentialFit::ComputeStiffnessDisplacement(vtkIdType pointId, double stiffnessDisplacement[3])
+void vtkvmtkPolyDataPotentialFit::ComputeStiffnessDisplacement(vtkPolyData* output, vtkIdType pointId, double stiffnessDisplacement[3])
 {
   vtkIdType j;
   double point[3];
   double laplacianPoint[3], neighborhoodPoint[3];
   vtkIdType numberOfNeighborhoodPoints;
   vtkvmtkNeighborhood *neighborhood;
-  vtkPolyData *output;
 
-  output = this->GetOutput();
   neighborhood = this->Neighborhoods->GetNeighborhood(pointId);
   
   output->GetPoint(pointId,point);
@@ -332,7 +260,7 @@ void vtkvmtkPolyDataPotentialFit::ComputeStiffnessDisplacement(vtkIdType pointId
   stiffnessDisplacement[2] = laplacianPoint[2] - point[2];
 }
 
-void vtkvmtkPolyDataPotentialFit::ComputeInflationDisplacement(vtkIdType pointId, double inflationDisplacement[3])
+void vtkvmtkPolyDataPotentialFit::ComputeInflationDisplacement(vtkPolyData* output, vtkIdType pointId, double inflationDisplacement[3], vtkIdType& numberOfPointsOutOfExtent)
 {
   vtkIdType j;
   double point[3], inputOutwardNormal[3];
@@ -342,9 +270,7 @@ void vtkvmtkPolyDataPotentialFit::ComputeInflationDisplacement(vtkIdType pointId
   double dot;
   vtkIdType numberOfNeighborhoodPoints;
   vtkvmtkNeighborhood *neighborhood;
-  vtkPolyData *output;
 
-  output = this->GetOutput();
   neighborhood = this->Neighborhoods->GetNeighborhood(pointId);
  
   if (neighborhood->GetNumberOfPoints() == 0)
@@ -358,10 +284,10 @@ void vtkvmtkPolyDataPotentialFit::ComputeInflationDisplacement(vtkIdType pointId
   output->GetPoint(pointId,point);
   this->Normals->GetTuple(pointId,inputOutwardNormal);
 
-  double inflation = this->EvaluateInflation(point);
+  double inflation = this->EvaluateInflation(point,numberOfPointsOutOfExtent);
   double potential = 1.0;
   if (this->UsePotentialInInflation) {
-    potential = this->EvaluatePotential(point);
+    potential = this->EvaluatePotential(point,numberOfPointsOutOfExtent);
   }
 
   neighborhoodNormal[0] = 0.0;
@@ -401,55 +327,118 @@ void vtkvmtkPolyDataPotentialFit::ComputeInflationDisplacement(vtkIdType pointId
   inflationDisplacement[2] = inflation * potential * neighborhoodNormal[2];
 }
 
-void vtkvmtkPolyDataPotentialFit::ComputeDisplacements(bool potential, bool stiffness, bool inflation)
+void vtkvmtkPolyDataPotentialFit::ComputeDisplacement(vtkPolyData* surface, vtkIdType pointId, bool potential, bool stiffness, bool inflation, double displacement[3], vtkIdType& numberOfPointsOutOfExtent)
 {
-  vtkIdType i;
-  vtkIdType numberOfPoints;
-  double displacement[3];
   double potentialDisplacement[3];
   double stiffnessDisplacement[3];
   double inflationDisplacement[3];
-  double displacementNorm;
 
-  numberOfPoints = this->GetOutput()->GetNumberOfPoints();
+  displacement[0] = displacement[1] = displacement[2] = 0.0;
 
-  this->MaxDisplacementNorm = 0.0;
+  if (potential)
+    {
+    this->ComputePotentialDisplacement(surface, pointId, potentialDisplacement, numberOfPointsOutOfExtent);
+    displacement[0] += this->PotentialWeight * potentialDisplacement[0];
+    displacement[1] += this->PotentialWeight * potentialDisplacement[1];
+    displacement[2] += this->PotentialWeight * potentialDisplacement[2];
+    }
+  
+  if (stiffness)
+    {
+    this->ComputeStiffnessDisplacement(surface, pointId, stiffnessDisplacement);
+    displacement[0] += this->StiffnessWeight * stiffnessDisplacement[0];
+    displacement[1] += this->StiffnessWeight * stiffnessDisplacement[1];
+    displacement[2] += this->StiffnessWeight * stiffnessDisplacement[2];
+    }
+
+  if (inflation)
+    {
+    this->ComputeInflationDisplacement(surface, pointId, inflationDisplacement, numberOfPointsOutOfExtent);
+    displacement[0] += this->InflationWeight * inflationDisplacement[0];
+    displacement[1] += this->InflationWeight * inflationDisplacement[1];
+    displacement[2] += this->InflationWeight * inflationDisplacement[2];
+    }
+}
 
-  for (i=0; i<numberOfPoints; i++)
+class vtkvmtkPolyDataPotentialFitDisplacementsFunctor
+{
+public:
+  vtkvmtkPolyDataPotentialFitDisplacementsFunctor(vtkvmtkPolyDataPotentialFit* filter, vtkPolyData* surface, bool potential, bool stiffness, bool inflation)
     {
-    displacement[0] = displacement[1] = displacement[2] = 0.0;
+    this->Filter = filter;
+    this->Surface = surface;
+    this->Potential = potential;
+    this->Stiffness = stiffness;
+    this->Inflation = inflation;
+    this->MaxDisplacementNorm = 0.0;
+    this->NumberOfPointsOutOfExtent = 0;
+    }
+
+  void Initialize()
+    {
+    this->LocalMaxDisplacementNorm.Local() = 0.0;
+    this->LocalNumberOfPointsOutOfExtent.Local() = 0;
+    }
 
-    if (potential)
+  void operator()(vtkIdType begin, vtkIdType end)
+    {
+    double* displacements = this->Filter->Displacements->GetPointer(0);
+    double& maxDisplacementNorm = this->LocalMaxDisplacementNorm.Local();
+    vtkIdType& numberOfPointsOutOfExtent = this->LocalNumberOfPointsOutOfExtent.Local();
+    for (vtkIdType i=begin; i<end; i++)
       {
-      this->ComputePotentialDisplacement(i, potentialDisplacement);
-      displacement[0] += this->PotentialWeight * potentialDisplacement[0];
-      displacement[1] += this->PotentialWeight * potentialDisplacement[1];
-      displacement[2] += this->PotentialWeight * potentialDisplacement[2];
+      double* displacement = displacements + 3*i;
+      this->Filter->ComputeDisplacement(this->Surface,i,this->Potential,this->Stiffness,this->Inflation,displacement,numberOfPointsOutOfExtent);
+      double displacementNorm = vtkMath::Norm(displacement);
+      if (displacementNorm > maxDisplacementNorm)
+        {
+        maxDisplacementNorm = displacementNorm;
+        }
       }
-    
-    if (stiffness)
+    }
+
+  void Reduce()
+    {
+    vtkSMPThreadLocal<double>::iterator it;
+    for (it=this->LocalMaxDisplacementNorm.begin(); it!=this->LocalMaxDisplacementNorm.end(); ++it)
       {
-      this->ComputeStiffnessDisplacement(i, stiffnessDisplacement);
-      displacement[0] += this->StiffnessWeight * stiffnessDisplacement[0];
-      displacement[1] += this->StiffnessWeight * stiffnessDisplacement[1];
-      displacement[2] += this->StiffnessWeight * stiffnessDisplacement[2];
+      if (*it > this->MaxDisplacementNorm)
+        {
+        this->MaxDisplacementNorm = *it;
+        }
       }
-
-    if (inflation)
+    vtkSMPThreadLocal<vtkIdType>::iterator countIt;
+    for (countIt=this->LocalNumberOfPointsOutOfExtent.begin(); countIt!=this->LocalNumberOfPointsOutOfExtent.end(); ++countIt)
       {
-      this->ComputeInflationDisplacement(i, inflationDisplacement);
-      displacement[0] += this->InflationWeight * inflationDisplacement[0];
-      displacement[1] += this->InflationWeight * inflationDisplacement[1];
-      displacement[2] += this->InflationWeight * inflationDisplacement[2];
+      this->NumberOfPointsOutOfExtent += *countIt;
       }
+    }
 
-    this->Displacements->SetTuple(i, displacement);
-    displacementNorm = vtkMath::Norm(displacement);
+  vtkvmtkPolyDataPotentialFit* Filter;
+  vtkPolyData* Surface;
+  bool Potential;
+  bool Stiffness;
+  bool Inflation;
+  vtkSMPThreadLocal<double> LocalMaxDisplacementNorm;
+  double MaxDisplacementNorm;
+  vtkSMPThreadLocal<vtkIdType> LocalNumberOfPointsOutOfExtent;
+  vtkIdType NumberOfPointsOutOfExtent;
+};
 
-    if (displacementNorm > this->MaxDisplacementNorm)
-      {
-      this->MaxDisplacementNorm = displacementNorm;
-      }
+void vtkvmtkPolyDataPotentialFit::ComputeDisplacements(bool potential, bool stiffness, bool inflation)
+{
+  vtkPolyData* output = this->GetOutput();
+
+  vtkvmtkPolyDataPotentialFitDisplacementsFunctor functor(this,output,potential,stiffness,inflation);
+  vtkSMPTools::For(0,output->GetNumberOfPoints(),functor);
+
+  this->MaxDisplacementNorm = functor.MaxDisplacementNorm;
+
+  // warnings are not thread-safe, so out of extent samples are only
+  // counted in the parallel loop and reported once here
+  if (functor.NumberOfPointsOutOfExtent > 0)
+    {
+    vtkWarningMacro(<<functor.NumberOfPointsOutOfExtent<<" points out of extent.");
     }
 }
 
@@ -474,25 +463,44 @@ void vtkvmtkPolyDataPotentialFit::ComputeTimeStep()
     }
 }
 
-void vtkvmtkPolyDataPotentialFit::ApplyDisplacements()
+class vtkvmtkPolyDataPotentialFitApplyDisplacementsFunctor
 {
-  vtkIdType i;
-  vtkIdType numberOfPoints;
-  double point[3], displacement[3], newPoint[3];
-  vtkPoints *points;
-
-  points = this->GetOutput()->GetPoints();
-  numberOfPoints = points->GetNumberOfPoints();
+public:
+  vtkvmtkPolyDataPotentialFitApplyDisplacementsFunctor(vtkPoints* points, vtkDoubleArray* displacements, double factor)
+    {
+    this->Points = points;
+    this->Displacements = displacements;
+    this->Factor = factor;
+    }
 
-  for (i=0; i<numberOfPoints; i++)
+  void operator()(vtkIdType begin, vtkIdType end)
     {
-    points->GetPoint(i,point);
-    this->Displacements->GetTuple(i,displacement);
-    newPoint[0] = point[0] + this->Relaxation * this->TimeStep * displacement[0];
-    newPoint[1] = point[1] + this->Relaxation * this->TimeStep * displacement[1];
-    newPoint[2] = point[2] + this->Relaxation * this->TimeStep * displacement[2];
-    points->SetPoint(i,newPoint);
+    double point[3], newPoint[3];
+    const double* displacements = this->Displacements->GetPointer(0);
+    for (vtkIdType i=begin; i<end; i++)
+      {
+      const double* displacement = displacements + 3*i;
+      this->Points->GetPoint(i,point);
+      newPoint[0] = point[0] + this->Factor * displacement[0];
+      newPoint[1] = point[1] + this->Factor * displacement[1];
+      newPoint[2] = point[2] + this->Factor * displacement[2];
+      this->Points->SetPoint(i,newPoint);
+      }
     }
+
+  vtkPoints* Points;
+  vtkDoubleArray* Displacements;
+  double Factor;
+};
+
+void vtkvmtkPolyDataPotentialFit::ApplyDisplacements()
+{
+  vtkPoints *points = this->GetOutput()->GetPoints();
+
+  vtkvmtkPolyDataPotentialFitApplyDisplacementsFunctor functor(points,this->Displacements,this->Relaxation * this->TimeStep);
+  vtkSMPTools::For(0,points->GetNumberOfPoints(),functor);
+
+  points->Modified();
 }
 
 double vtkvmtkPolyDataPotentialFit::ComputeMinSpacing(double spacing[3])
@@ -560,6 +568,13 @@ int vtkvmtkPolyDataPotentialFit::RequestData(
 
   gradientFilter->Delete();
 
+  if (!vtkDoubleArray::SafeDownCast(this->PotentialGradientImage->GetPointData()->GetScalars()))
+    {
+    vtkErrorMacro("Error: potential gradient is not of type double.");
+    newPoints->Delete();
+    return 0;
+    }
+
   output->SetPoints(newPoints);
   output->SetVerts(input->GetVerts());
   output->SetLines(input->GetLines());
@@ -105,16 +105,28 @@ class VTK_VMTK_SEGMENTATION_EXPORT vtkvmtkPolyDataPotentialFit : public vtkPolyD
 
   virtual int RequestData(vtkInformation *, vtkInformationVector **, vtkInformationVector *) VTK_OVERRIDE;
 
-  void EvaluateForce(double point[3], double force[3], bool normalize = true);
-  double EvaluatePotential(double point[3]);
-  double EvaluateInflation(double point[3]);
+  // Description:
+  // Samples outside the image extent evaluate to zero and increment
+  // numberOfPointsOutOfExtent.
+  void EvaluateForce(double point[3], double force[3], vtkIdType& numberOfPointsOutOfExtent, bool normalize = true);
+  double EvaluatePotential(double point[3], vtkIdType& numberOfPointsOutOfExtent);
+  double EvaluateInflation(double point[3], vtkIdType& numberOfPointsOutOfExtent);
+  static double InterpolateScalars(vtkDataArray* scalars, vtkIdType pointIds[8], double weights[8]);
+
+  // Description:
+  // Displacements for all points are computed from the current point
+  // positions (Jacobi-style) and only then applied, so both passes run in
+  // parallel over points and the result does not depend on the number of threads.
   void ComputeDisplacements(bool potential, bool stiffness, bool inflation);
-  void ComputePotentialDisplacement(vtkIdType pointId, double potentialDisplacement[3]);
-  void ComputeStiffnessDisplacement(vtkIdType pointId, double stiffnessDisplacement[3]);
-  void ComputeInflationDisplacement(vtkIdType pointId, double inflationDisplacement[3]);
+  void ComputeDisplacement(vtkPolyData* surface, vtkIdType pointId, bool potential, bool stiffness, bool inflation, double displacement[3], vtkIdType& numberOfPointsOutOfExtent);
+  void ComputePotentialDisplacement(vtkPolyData* surface, vtkIdType pointId, double potentialDisplacement[3], vtkIdType& numberOfPointsOutOfExtent);
+  void ComputeStiffnessDisplacement(vtkPolyData* surface, vtkIdType pointId, double stiffnessDisplacement[3]);
+  void ComputeInflationDisplacement(vtkPolyData* surface, vtkIdType pointId, double inflationDisplacement[3], vtkIdType& numberOfPointsOutOfExtent);
   void ComputeTimeStep();
   void ApplyDisplacements();
 
+  friend class vtkvmtkPolyDataPotentialFitDisplacementsFunctor;
+
   int TestConvergence();
 
   static double ComputeMinSpacing(double spacing[3]);
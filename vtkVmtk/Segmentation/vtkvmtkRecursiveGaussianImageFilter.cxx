@@ -25,6 +25,8 @@ Version:   $Revision: 1.1 $
 
 #include "vtkvmtkRecursiveGaussianImageFilter.h"
 #include "vtkObjectFactory.h"
+#include "vtkInformation.h"
+#include "vtkMath.h"
 
 #include "vtkvmtkITKFilterUtilities.h"
 
@@ -38,6 +40,16 @@ vtkvmtkRecursiveGaussianImageFilter::vtkvmtkRecursiveGaussianImageFilter()
   this->NormalizeAcrossScale = 0;
 }
 
+void vtkvmtkRecursiveGaussianImageFilter::ComputeHaloRadius(vtkInformation* inInfo, int haloRadius[3])
+{
+  // itk::RecursiveGaussianImageFilter only smooths along its direction (the
+  // first axis by default); the halo is truncated at four standard deviations
+  double spacing[3];
+  inInfo->Get(vtkDataObject::SPACING(),spacing);
+  haloRadius[0] = vtkMath::Ceil(4.0 * this->Sigma / spacing[0]) + 1;
+  haloRadius[1] = haloRadius[2] = 0;
+}
+
 void vtkvmtkRecursiveGaussianImageFilter::SimpleExecute(vtkImageData* input, vtkImageData* output)
 {
   typedef float PixelType;
@@ -54,10 +66,11 @@ void vtkvmtkRecursiveGaussianImageFilter::SimpleExecute(vtkImageData* input, vtk
   gaussianFilter->SetInput(inImage);
   gaussianFilter->SetSigma(this->Sigma);
   gaussianFilter->SetNormalizeAcrossScale(this->NormalizeAcrossScale);
+  gaussianFilter->GetOutput()->SetRequestedRegion(vtkvmtkITKFilterUtilities::ExtentToRegion<ImageType>(output->GetExtent()));
   gaussianFilter->Update();
 
   ImageType::Pointer outputImage = gaussianFilter->GetOutput();
 
-  vtkvmtkITKFilterUtilities::ITKToVTKImage<ImageType>(outputImage,output);
+  vtkvmtkITKFilterUtilities::ITKToVTKImageExtent<ImageType>(outputImage,output);
 }
 
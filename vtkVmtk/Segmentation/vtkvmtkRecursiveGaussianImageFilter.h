@@ -31,14 +31,14 @@ Version:   $Revision: 1.2 $
 #ifndef __vtkvmtkRecursiveGaussianImageFilter_h
 #define __vtkvmtkRecursiveGaussianImageFilter_h
 
-#include "vtkSimpleImageToImageFilter.h"
+#include "vtkvmtkStreamingImageToImageFilter.h"
 #include "vtkvmtkWin32Header.h"
 
-class VTK_VMTK_SEGMENTATION_EXPORT vtkvmtkRecursiveGaussianImageFilter : public vtkSimpleImageToImageFilter
+class VTK_VMTK_SEGMENTATION_EXPORT vtkvmtkRecursiveGaussianImageFilter : public vtkvmtkStreamingImageToImageFilter
 {
  public:
   static vtkvmtkRecursiveGaussianImageFilter *New();
-  vtkTypeMacro(vtkvmtkRecursiveGaussianImageFilter, vtkSimpleImageToImageFilter);
+  vtkTypeMacro(vtkvmtkRecursiveGaussianImageFilter, vtkvmtkStreamingImageToImageFilter);
 
   vtkGetMacro(Sigma,double);
   vtkSetMacro(Sigma,double);
@@ -52,6 +52,7 @@ class VTK_VMTK_SEGMENTATION_EXPORT vtkvmtkRecursiveGaussianImageFilter : public
   ~vtkvmtkRecursiveGaussianImageFilter() {};
 
   virtual void SimpleExecute(vtkImageData* input, vtkImageData* output) VTK_OVERRIDE;
+  virtual void ComputeHaloRadius(vtkInformation* inInfo, int haloRadius[3]) VTK_OVERRIDE;
 
  private:
   vtkvmtkRecursiveGaussianImageFilter(const vtkvmtkRecursiveGaussianImageFilter&);  // Not implemented.
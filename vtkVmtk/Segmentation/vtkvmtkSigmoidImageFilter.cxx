@@ -57,8 +57,9 @@ void vtkvmtkSigmoidImageFilter::SimpleExecute(vtkImageData* input, vtkImageData*
   sigmoidFilter->SetBeta(this->Beta);
   sigmoidFilter->SetOutputMinimum(this->OutputMinimum);
   sigmoidFilter->SetOutputMaximum(this->OutputMaximum);
+  sigmoidFilter->GetOutput()->SetRequestedRegion(vtkvmtkITKFilterUtilities::ExtentToRegion<ImageType>(output->GetExtent()));
   sigmoidFilter->Update();
 
-  vtkvmtkITKFilterUtilities::ITKToVTKImage<ImageType>(sigmoidFilter->GetOutput(),output);
+  vtkvmtkITKFilterUtilities::ITKToVTKImageExtent<ImageType>(sigmoidFilter->GetOutput(),output);
 }
 
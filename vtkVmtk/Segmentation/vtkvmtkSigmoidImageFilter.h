@@ -31,14 +31,14 @@ Version:   $Revision: 1.3 $
 #ifndef __vtkvmtkSigmoidImageFilter_h
 #define __vtkvmtkSigmoidImageFilter_h
 
-#include "vtkSimpleImageToImageFilter.h"
+#include "vtkvmtkStreamingImageToImageFilter.h"
 #include "vtkvmtkWin32Header.h"
 
-class VTK_VMTK_SEGMENTATION_EXPORT vtkvmtkSigmoidImageFilter : public vtkSimpleImageToImageFilter
+class VTK_VMTK_SEGMENTATION_EXPORT vtkvmtkSigmoidImageFilter : public vtkvmtkStreamingImageToImageFilter
 {
  public:
   static vtkvmtkSigmoidImageFilter *New();
-  vtkTypeMacro(vtkvmtkSigmoidImageFilter, vtkSimpleImageToImageFilter);
+  vtkTypeMacro(vtkvmtkSigmoidImageFilter, vtkvmtkStreamingImageToImageFilter);
 
   vtkGetMacro(Alpha,double);
   vtkSetMacro(Alpha,double);
@@ -0,0 +1,105 @@
+/*=========================================================================
+
+Program:   VMTK
+Module:    $RCSfile: vtkvmtkStreamingImageToImageFilter.cxx,v $
+Language:  C++
+Date:      $Date: 2006/04/06 16:48:25 $
+Version:   $Revision: 1.1 $
+
+  Copyright (c) Luca Antiga, David Steinman. All rights reserved.
+  See LICENCE file for details.
+
+  Portions of this code are covered under the VTK copyright.
+  See VTKCopyright.txt or http://www.kitware.com/VTKCopyright.htm
+  for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+
+#include "vtkvmtkStreamingImageToImageFilter.h"
+#include "vtkImageData.h"
+#include "vtkInformation.h"
+#include "vtkInformationVector.h"
+#include "vtkStreamingDemandDrivenPipeline.h"
+
+
+void vtkvmtkStreamingImageToImageFilter::ComputeHaloRadius(vtkInformation* vtkNotUsed(inInfo), int haloRadius[3])
+{
+  haloRadius[0] = haloRadius[1] = haloRadius[2] = 0;
+}
+
+int vtkvmtkStreamingImageToImageFilter::RequestUpdateExtent (
+  vtkInformation * vtkNotUsed(request),
+  vtkInformationVector **inputVector,
+  vtkInformationVector *outputVector)
+{
+  vtkInformation *inInfo = inputVector[0]->GetInformationObject(0);
+  vtkInformation *outInfo = outputVector->GetInformationObject(0);
+
+  int wholeExtent[6], updateExtent[6];
+  inInfo->Get(vtkStreamingDemandDrivenPipeline::WHOLE_EXTENT(),wholeExtent);
+  outInfo->Get(vtkStreamingDemandDrivenPipeline::UPDATE_EXTENT(),updateExtent);
+
+  int haloRadius[3];
+  this->ComputeHaloRadius(inInfo,haloRadius);
+
+  int inputExtent[6];
+  for (int i=0; i<3; i++)
+    {
+    inputExtent[2*i] = updateExtent[2*i] - haloRadius[i];
+    inputExtent[2*i+1] = updateExtent[2*i+1] + haloRadius[i];
+    if (inputExtent[2*i] < wholeExtent[2*i])
+      {
+      inputExtent[2*i] = wholeExtent[2*i];
+      }
+    if (inputExtent[2*i+1] > wholeExtent[2*i+1])
+      {
+      inputExtent[2*i+1] = wholeExtent[2*i+1];
+      }
+    }
+
+  inInfo->Set(vtkStreamingDemandDrivenPipeline::UPDATE_EXTENT(),inputExtent,6);
+
+  return 1;
+}
+
+int vtkvmtkStreamingImageToImageFilter::RequestData (
+  vtkInformation * vtkNotUsed(request),
+  vtkInformationVector **inputVector,
+  vtkInformationVector *outputVector)
+{
+  vtkInformation *outInfo = outputVector->GetInformationObject(0);
+
+  vtkImageData *input = vtkImageData::GetData(inputVector[0]);
+  vtkImageData *output = vtkImageData::GetData(outputVector);
+
+  if (!input || !output)
+    {
+    return 1;
+    }
+
+  int inputExtent[6];
+  input->GetExtent(inputExtent);
+  if (inputExtent[1] < inputExtent[0] || inputExtent[3] < inputExtent[2] || inputExtent[5] < inputExtent[4])
+    {
+    return 1;
+    }
+
+  int updateExtent[6];
+  outInfo->Get(vtkStreamingDemandDrivenPipeline::UPDATE_EXTENT(),updateExtent);
+
+  output->SetExtent(updateExtent);
+  output->AllocateScalars(outInfo);
+
+  this->SimpleExecute(input,output);
+
+  return 1;
+}
+
+void vtkvmtkStreamingImageToImageFilter::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os,indent);
+}
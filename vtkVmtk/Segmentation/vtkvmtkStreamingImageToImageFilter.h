@@ -0,0 +1,64 @@
+/*=========================================================================
+
+Program:   VMTK
+Module:    $RCSfile: vtkvmtkStreamingImageToImageFilter.h,v $
+Language:  C++
+Date:      $Date: 2006/04/06 16:48:25 $
+Version:   $Revision: 1.1 $
+
+  Copyright (c) Luca Antiga, David Steinman. All rights reserved.
+  See LICENCE file for details.
+
+  Portions of this code are covered under the VTK copyright.
+  See VTKCopyright.txt or http://www.kitware.com/VTKCopyright.htm
+  for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+
+// .NAME vtkvmtkStreamingImageToImageFilter - Base class for ITK wrappers supporting extent requests
+// .SECTION Description
+// Drop-in replacement for vtkSimpleImageToImageFilter for filters with
+// pointwise or local support. Instead of always requesting the whole
+// extent, the requested output extent is padded by a halo (see
+// ComputeHaloRadius), clamped to the whole extent, and requested from
+// the input. The output is allocated over the requested extent only, so
+// these filters can be driven piece by piece by vtkImageDataStreamer.
+// SimpleExecute receives an input covering at least the padded extent and
+// an output already allocated over the requested extent.
+
+#ifndef __vtkvmtkStreamingImageToImageFilter_h
+#define __vtkvmtkStreamingImageToImageFilter_h
+
+#include "vtkImageAlgorithm.h"
+#include "vtkvmtkWin32Header.h"
+
+class VTK_VMTK_SEGMENTATION_EXPORT vtkvmtkStreamingImageToImageFilter : public vtkImageAlgorithm
+{
+ public:
+  vtkTypeMacro(vtkvmtkStreamingImageToImageFilter, vtkImageAlgorithm);
+  void PrintSelf(ostream& os, vtkIndent indent) VTK_OVERRIDE;
+
+protected:
+  vtkvmtkStreamingImageToImageFilter() {};
+  ~vtkvmtkStreamingImageToImageFilter() {};
+
+  // Description:
+  // Number of voxels the requested extent is padded with along each axis.
+  // Defaults to zero (pointwise filters).
+  virtual void ComputeHaloRadius(vtkInformation* inInfo, int haloRadius[3]);
+
+  virtual int RequestUpdateExtent(vtkInformation *, vtkInformationVector **, vtkInformationVector *) VTK_OVERRIDE;
+  virtual int RequestData(vtkInformation *, vtkInformationVector **, vtkInformationVector *) VTK_OVERRIDE;
+
+  virtual void SimpleExecute(vtkImageData* input, vtkImageData* output) = 0;
+
+private:
+  vtkvmtkStreamingImageToImageFilter(const vtkvmtkStreamingImageToImageFilter&);  // Not implemented.
+  void operator=(const vtkvmtkStreamingImageToImageFilter&);  // Not implemented.
+};
+
+#endif
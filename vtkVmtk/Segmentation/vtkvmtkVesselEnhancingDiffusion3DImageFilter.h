@@ -107,6 +107,16 @@ class VTK_VMTK_SEGMENTATION_EXPORT vtkvmtkVesselEnhancingDiffusion3DImageFilter
     DelegateITKInputMacro(SetRecalculateVesselness,value);
   }
 
+  void SetConvergenceThreshold(double value)
+  {
+    DelegateITKInputMacro(SetConvergenceThreshold,value);
+  }
+
+  int GetElapsedIterations()
+  {
+    return this->GetImageFilterPointer()->GetElapsedIterations();
+  }
+
   double ComputeSigmaValue(int scaleLevel)
   {
     double sigmaValue;